@@ -86,6 +86,7 @@ blhandler(PG_FUNCTION_ARGS)
 	amroutine->amstorage = false;
 	amroutine->amclusterable = false;
 	amroutine->ampredlocks = false;
+	amroutine->amcanparallelvacuum = true;
 	amroutine->amkeytype = 0;
 
 	amroutine->aminsert = blinsert;
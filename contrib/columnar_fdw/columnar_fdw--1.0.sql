@@ -0,0 +1,25 @@
+/* contrib/columnar_fdw/columnar_fdw--1.0.sql */
+
+-- complain if script is sourced in psql, rather than via CREATE EXTENSION
+\echo Use "CREATE EXTENSION columnar_fdw" to load this file. \quit
+
+CREATE FUNCTION columnar_fdw_handler()
+RETURNS fdw_handler
+AS 'MODULE_PATHNAME'
+LANGUAGE C STRICT;
+
+CREATE FUNCTION columnar_fdw_validator(text[], oid)
+RETURNS void
+AS 'MODULE_PATHNAME'
+LANGUAGE C STRICT;
+
+CREATE FOREIGN DATA WRAPPER columnar_fdw
+  HANDLER columnar_fdw_handler
+  VALIDATOR columnar_fdw_validator;
+
+CREATE FUNCTION columnar_fdw_remove_orphans()
+RETURNS integer
+AS 'MODULE_PATHNAME'
+LANGUAGE C STRICT VOLATILE;
+
+REVOKE ALL ON FUNCTION columnar_fdw_remove_orphans() FROM PUBLIC;
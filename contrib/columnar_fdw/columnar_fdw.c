@@ -0,0 +1,918 @@
+/*-------------------------------------------------------------------------
+ *
+ * columnar_fdw.c
+ *		  foreign-data wrapper for column-oriented tables stored in the
+ *		  data directory.
+ *
+ * Rows are stored in stripes of up to stripe_row_count rows each, and
+ * within a stripe column by column, optionally compressed with pglz.  A
+ * scan reads only the columns the query refers to, and skips stripes whose
+ * minimum and maximum values show that a simple "column op constant"
+ * condition can't be true for any of their rows.  Rows are added with
+ * INSERT; UPDATE and DELETE are not supported.
+ *
+ * The on-disk format and transaction handling are in columnar_storage.c.
+ *
+ * Copyright (c) 2016, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *		  contrib/columnar_fdw/columnar_fdw.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "columnar_fdw.h"
+
+#include "access/htup_details.h"
+#include "access/nbtree.h"
+#include "access/reloptions.h"
+#include "access/sysattr.h"
+#include "catalog/objectaccess.h"
+#include "catalog/pg_class.h"
+#include "catalog/pg_foreign_table.h"
+#include "commands/defrem.h"
+#include "commands/explain.h"
+#include "foreign/fdwapi.h"
+#include "foreign/foreign.h"
+#include "miscadmin.h"
+#include "nodes/makefuncs.h"
+#include "optimizer/cost.h"
+#include "optimizer/pathnode.h"
+#include "optimizer/planmain.h"
+#include "optimizer/restrictinfo.h"
+#include "optimizer/var.h"
+#include "storage/fd.h"
+#include "utils/guc.h"
+#include "utils/lsyscache.h"
+#include "utils/memutils.h"
+#include "utils/rel.h"
+#include "utils/typcache.h"
+
+PG_MODULE_MAGIC;
+
+/*
+ * FDW-specific information for RelOptInfo.fdw_private.
+ */
+typedef struct ColumnarPlanState
+{
+	double		ntuples;		/* number of rows in the table */
+	uint64		data_length;	/* size of the table's data */
+} ColumnarPlanState;
+
+/*
+ * A "column op constant" condition of the scan's quals, with op a btree
+ * operator of the column's type.  Stripes whose minimum and maximum of the
+ * column show that the condition is false for all their rows are skipped.
+ */
+typedef struct ColumnarPruneKey
+{
+	AttrNumber	attnum;
+	StrategyNumber strategy;	/* btree strategy of the operator */
+	Datum		value;			/* the constant */
+	FmgrInfo   *cmp;			/* btree comparison function of the type */
+	Oid			collation;
+} ColumnarPruneKey;
+
+/*
+ * FDW-specific information for ForeignScanState.fdw_state.
+ */
+typedef struct ColumnarScanState
+{
+	ColumnarMetadata *metadata;
+	char		path[MAXPGPATH];	/* of the data file */
+	int			fd;				/* data file, or -1 if not opened yet */
+	bool	   *needed;			/* per column, do we need to read it? */
+	List	   *prune_keys;		/* list of ColumnarPruneKey */
+	MemoryContext stripe_cxt;	/* holds the current stripe's columns */
+
+	int			next_stripe;	/* index of the next stripe to consider */
+	ColumnarStripe *stripe;		/* current stripe, or NULL */
+	uint32		row;			/* next row of the current stripe */
+	bits8	  **bitmaps;		/* per column, null bitmap, or NULL */
+	char	  **data;			/* per column, values */
+	uint32	   *offsets;		/* per column, offset of the next value */
+
+	long		stripes_read;	/* for EXPLAIN ANALYZE */
+	long		stripes_skipped;
+} ColumnarScanState;
+
+/*
+ * SQL functions
+ */
+PG_FUNCTION_INFO_V1(columnar_fdw_handler);
+PG_FUNCTION_INFO_V1(columnar_fdw_validator);
+PG_FUNCTION_INFO_V1(columnar_fdw_remove_orphans);
+
+void		_PG_init(void);
+
+/* Saved hook value in case of unload */
+static object_access_hook_type prev_object_access_hook = NULL;
+
+/*
+ * FDW callback routines
+ */
+static void columnarGetForeignRelSize(PlannerInfo *root,
+						  RelOptInfo *baserel,
+						  Oid foreigntableid);
+static void columnarGetForeignPaths(PlannerInfo *root,
+						RelOptInfo *baserel,
+						Oid foreigntableid);
+static ForeignScan *columnarGetForeignPlan(PlannerInfo *root,
+					   RelOptInfo *baserel,
+					   Oid foreigntableid,
+					   ForeignPath *best_path,
+					   List *tlist,
+					   List *scan_clauses,
+					   Plan *outer_plan);
+static void columnarExplainForeignScan(ForeignScanState *node,
+						   ExplainState *es);
+static void columnarBeginForeignScan(ForeignScanState *node, int eflags);
+static TupleTableSlot *columnarIterateForeignScan(ForeignScanState *node);
+static void columnarReScanForeignScan(ForeignScanState *node);
+static void columnarEndForeignScan(ForeignScanState *node);
+static bool columnarIsForeignScanParallelSafe(PlannerInfo *root,
+								  RelOptInfo *rel,
+								  RangeTblEntry *rte);
+static int	columnarIsForeignRelUpdatable(Relation rel);
+static void columnarBeginForeignModify(ModifyTableState *mtstate,
+						   ResultRelInfo *rinfo,
+						   List *fdw_private,
+						   int subplan_index,
+						   int eflags);
+static TupleTableSlot *columnarExecForeignInsert(EState *estate,
+						  ResultRelInfo *rinfo,
+						  TupleTableSlot *slot,
+						  TupleTableSlot *planSlot);
+static void columnarEndForeignModify(EState *estate, ResultRelInfo *rinfo);
+
+/*
+ * Helper functions
+ */
+static void columnar_get_options(Oid foreigntableid, ColumnarOptions *options);
+static void columnar_parse_option(DefElem *def, ColumnarOptions *options);
+static List *columnar_needed_columns(RelOptInfo *baserel, int natts);
+static List *columnar_prune_keys(List *quals, Index scanrelid);
+static bool columnar_stripe_excluded(ColumnarStripe *stripe, List *prune_keys);
+static bool columnar_next_stripe(ColumnarScanState *cstate, TupleDesc tupdesc);
+static void columnar_object_access(ObjectAccessType access, Oid classId,
+					   Oid objectId, int subId, void *arg);
+
+
+/*
+ * Module load callback
+ */
+void
+_PG_init(void)
+{
+	columnar_storage_init();
+
+	prev_object_access_hook = object_access_hook;
+	object_access_hook = columnar_object_access;
+}
+
+/*
+ * Foreign-data wrapper handler function: return a struct with pointers
+ * to my callback routines.
+ */
+Datum
+columnar_fdw_handler(PG_FUNCTION_ARGS)
+{
+	FdwRoutine *fdwroutine = makeNode(FdwRoutine);
+
+	fdwroutine->GetForeignRelSize = columnarGetForeignRelSize;
+	fdwroutine->GetForeignPaths = columnarGetForeignPaths;
+	fdwroutine->GetForeignPlan = columnarGetForeignPlan;
+	fdwroutine->ExplainForeignScan = columnarExplainForeignScan;
+	fdwroutine->BeginForeignScan = columnarBeginForeignScan;
+	fdwroutine->IterateForeignScan = columnarIterateForeignScan;
+	fdwroutine->ReScanForeignScan = columnarReScanForeignScan;
+	fdwroutine->EndForeignScan = columnarEndForeignScan;
+	fdwroutine->IsForeignScanParallelSafe = columnarIsForeignScanParallelSafe;
+
+	fdwroutine->IsForeignRelUpdatable = columnarIsForeignRelUpdatable;
+	fdwroutine->BeginForeignModify = columnarBeginForeignModify;
+	fdwroutine->ExecForeignInsert = columnarExecForeignInsert;
+	fdwroutine->EndForeignModify = columnarEndForeignModify;
+
+	PG_RETURN_POINTER(fdwroutine);
+}
+
+/*
+ * Validate the generic options given to a FOREIGN DATA WRAPPER, SERVER,
+ * USER MAPPING or FOREIGN TABLE that uses columnar_fdw.
+ *
+ * Raise an ERROR if the option or its value is considered invalid.
+ */
+Datum
+columnar_fdw_validator(PG_FUNCTION_ARGS)
+{
+	List	   *options_list = untransformRelOptions(PG_GETARG_DATUM(0));
+	Oid			catalog = PG_GETARG_OID(1);
+	ColumnarOptions options;
+	ListCell   *cell;
+
+	foreach(cell, options_list)
+	{
+		DefElem    *def = (DefElem *) lfirst(cell);
+
+		if (catalog != ForeignTableRelationId)
+			ereport(ERROR,
+					(errcode(ERRCODE_FDW_INVALID_OPTION_NAME),
+					 errmsg("invalid option \"%s\"", def->defname),
+				  errhint("There are no valid options in this context.")));
+
+		columnar_parse_option(def, &options);
+	}
+
+	PG_RETURN_VOID();
+}
+
+/*
+ * Remove the files of dropped tables that were left behind, and return the
+ * number of tables whose files were removed.
+ */
+Datum
+columnar_fdw_remove_orphans(PG_FUNCTION_ARGS)
+{
+	if (!superuser())
+		ereport(ERROR,
+				(errcode(ERRCODE_INSUFFICIENT_PRIVILEGE),
+				 errmsg("must be superuser to remove columnar_fdw files")));
+
+	PG_RETURN_INT32(columnar_remove_orphans());
+}
+
+/*
+ * Check one option of a columnar foreign table and store its value.
+ */
+static void
+columnar_parse_option(DefElem *def, ColumnarOptions *options)
+{
+	if (strcmp(def->defname, "stripe_row_count") == 0)
+	{
+		char	   *value = defGetString(def);
+		int			stripe_row_count;
+
+		if (!parse_int(value, &stripe_row_count, 0, NULL) ||
+			stripe_row_count < COLUMNAR_MIN_STRIPE_ROW_COUNT ||
+			stripe_row_count > COLUMNAR_MAX_STRIPE_ROW_COUNT)
+			ereport(ERROR,
+					(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+					 errmsg("invalid value for option \"%s\": \"%s\"",
+							def->defname, value),
+					 errdetail("Valid values are between %d and %d.",
+							   COLUMNAR_MIN_STRIPE_ROW_COUNT,
+							   COLUMNAR_MAX_STRIPE_ROW_COUNT)));
+		options->stripe_row_count = stripe_row_count;
+	}
+	else if (strcmp(def->defname, "compression") == 0)
+	{
+		char	   *value = defGetString(def);
+
+		if (strcmp(value, "pglz") == 0)
+			options->compression = true;
+		else if (strcmp(value, "none") == 0)
+			options->compression = false;
+		else
+			ereport(ERROR,
+					(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+					 errmsg("invalid value for option \"%s\": \"%s\"",
+							def->defname, value),
+					 errdetail("Valid values are \"pglz\" and \"none\".")));
+	}
+	else
+		ereport(ERROR,
+				(errcode(ERRCODE_FDW_INVALID_OPTION_NAME),
+				 errmsg("invalid option \"%s\"", def->defname),
+				 errhint("Valid options in this context are: %s",
+						 "stripe_row_count, compression")));
+}
+
+/*
+ * Fetch the options of a columnar foreign table.
+ */
+static void
+columnar_get_options(Oid foreigntableid, ColumnarOptions *options)
+{
+	ForeignTable *table = GetForeignTable(foreigntableid);
+	ListCell   *lc;
+
+	options->stripe_row_count = COLUMNAR_DEFAULT_STRIPE_ROW_COUNT;
+	options->compression = true;
+
+	foreach(lc, table->options)
+		columnar_parse_option((DefElem *) lfirst(lc), options);
+}
+
+/*
+ * columnarGetForeignRelSize
+ *		Obtain relation size estimates for a foreign table
+ */
+static void
+columnarGetForeignRelSize(PlannerInfo *root,
+						  RelOptInfo *baserel,
+						  Oid foreigntableid)
+{
+	ColumnarPlanState *fdw_private;
+	ColumnarMetadata *metadata;
+	Relation	rel;
+
+	rel = heap_open(foreigntableid, AccessShareLock);
+	metadata = columnar_read_metadata(rel);
+	heap_close(rel, AccessShareLock);
+
+	fdw_private = (ColumnarPlanState *) palloc(sizeof(ColumnarPlanState));
+	fdw_private->ntuples = (double) metadata->nrows;
+	fdw_private->data_length = metadata->data_length;
+	baserel->fdw_private = (void *) fdw_private;
+
+	/* The metadata knows the row count exactly, no need for ANALYZE */
+	baserel->tuples = fdw_private->ntuples;
+	baserel->rows = clamp_row_est(fdw_private->ntuples *
+								  clauselist_selectivity(root,
+												 baserel->baserestrictinfo,
+														 0,
+														 JOIN_INNER,
+														 NULL));
+}
+
+/*
+ * columnarGetForeignPaths
+ *		Create possible access paths for a scan on the foreign table
+ *
+ *		There is only one possible access path, which returns all records in
+ *		the order they were inserted.  Its I/O cost is proportional to the
+ *		share of the columns it has to read.
+ */
+static void
+columnarGetForeignPaths(PlannerInfo *root,
+						RelOptInfo *baserel,
+						Oid foreigntableid)
+{
+	ColumnarPlanState *fdw_private = (ColumnarPlanState *) baserel->fdw_private;
+	Relation	rel;
+	int			natts;
+	List	   *columns;
+	double		pages;
+	Cost		startup_cost;
+	Cost		run_cost;
+
+	rel = heap_open(foreigntableid, AccessShareLock);
+	natts = RelationGetNumberOfAttributes(rel);
+	heap_close(rel, AccessShareLock);
+
+	columns = columnar_needed_columns(baserel, natts);
+
+	pages = ceil((double) fdw_private->data_length / BLCKSZ);
+	if (natts > 0)
+		pages = ceil(pages * list_length(columns) / natts);
+
+	startup_cost = baserel->baserestrictcost.startup;
+	run_cost = seq_page_cost * pages +
+		(cpu_tuple_cost + baserel->baserestrictcost.per_tuple) *
+		fdw_private->ntuples;
+
+	/*
+	 * The list of columns to read goes into the fdw_private list of the path;
+	 * it will be propagated into the fdw_private list of the Plan node.
+	 */
+	add_path(baserel, (Path *)
+			 create_foreignscan_path(root, baserel,
+									 NULL,		/* default pathtarget */
+									 baserel->rows,
+									 startup_cost,
+									 startup_cost + run_cost,
+									 NIL,		/* no pathkeys */
+									 NULL,		/* no outer rel either */
+									 NULL,		/* no extra plan */
+									 list_make1(columns)));
+}
+
+/*
+ * columnarGetForeignPlan
+ *		Create a ForeignScan plan node for scanning the foreign table
+ */
+static ForeignScan *
+columnarGetForeignPlan(PlannerInfo *root,
+					   RelOptInfo *baserel,
+					   Oid foreigntableid,
+					   ForeignPath *best_path,
+					   List *tlist,
+					   List *scan_clauses,
+					   Plan *outer_plan)
+{
+	Index		scan_relid = baserel->relid;
+
+	/*
+	 * All the scan_clauses go into the plan node's qual list for the
+	 * executor to check.  The scan also looks at them to skip stripes, but
+	 * that doesn't make checking them unnecessary.
+	 */
+	scan_clauses = extract_actual_clauses(scan_clauses, false);
+
+	/* Create the ForeignScan node */
+	return make_foreignscan(tlist,
+							scan_clauses,
+							scan_relid,
+							NIL,	/* no expressions to evaluate */
+							best_path->fdw_private,
+							NIL,	/* no custom tlist */
+							NIL,	/* no remote quals */
+							outer_plan);
+}
+
+/*
+ * columnarExplainForeignScan
+ *		Produce extra output for EXPLAIN
+ */
+static void
+columnarExplainForeignScan(ForeignScanState *node, ExplainState *es)
+{
+	ForeignScan *plan = (ForeignScan *) node->ss.ps.plan;
+	ColumnarScanState *cstate = (ColumnarScanState *) node->fdw_state;
+	TupleDesc	tupdesc = RelationGetDescr(node->ss.ss_currentRelation);
+	List	   *columns = (List *) linitial(plan->fdw_private);
+	List	   *names = NIL;
+	ListCell   *lc;
+
+	foreach(lc, columns)
+	{
+		Form_pg_attribute attr = tupdesc->attrs[lfirst_int(lc) - 1];
+
+		names = lappend(names, NameStr(attr->attname));
+	}
+	ExplainPropertyList("Columns Read", names, es);
+
+	if (es->analyze && cstate != NULL)
+	{
+		ExplainPropertyLong("Stripes Read", cstate->stripes_read, es);
+		ExplainPropertyLong("Stripes Skipped", cstate->stripes_skipped, es);
+	}
+}
+
+/*
+ * columnarBeginForeignScan
+ *		Read the table's metadata and prepare to read its stripes
+ */
+static void
+columnarBeginForeignScan(ForeignScanState *node, int eflags)
+{
+	ForeignScan *plan = (ForeignScan *) node->ss.ps.plan;
+	Relation	rel = node->ss.ss_currentRelation;
+	int			natts = RelationGetNumberOfAttributes(rel);
+	ColumnarScanState *cstate;
+	ListCell   *lc;
+
+	/*
+	 * Do nothing in EXPLAIN (no ANALYZE) case.  node->fdw_state stays NULL.
+	 */
+	if (eflags & EXEC_FLAG_EXPLAIN_ONLY)
+		return;
+
+	cstate = (ColumnarScanState *) palloc0(sizeof(ColumnarScanState));
+	cstate->metadata = columnar_read_metadata(rel);
+	columnar_file_path(RelationGetRelid(rel), "data", cstate->path);
+	cstate->fd = -1;
+
+	cstate->needed = (bool *) palloc0(natts * sizeof(bool));
+	foreach(lc, (List *) linitial(plan->fdw_private))
+		cstate->needed[lfirst_int(lc) - 1] = true;
+
+	cstate->prune_keys = columnar_prune_keys(plan->scan.plan.qual,
+											 plan->scan.scanrelid);
+
+	cstate->stripe_cxt = AllocSetContextCreate(CurrentMemoryContext,
+											   "columnar_fdw stripe",
+											   ALLOCSET_DEFAULT_MINSIZE,
+											   ALLOCSET_DEFAULT_INITSIZE,
+											   ALLOCSET_DEFAULT_MAXSIZE);
+	cstate->bitmaps = (bits8 **) palloc0(natts * sizeof(bits8 *));
+	cstate->data = (char **) palloc0(natts * sizeof(char *));
+	cstate->offsets = (uint32 *) palloc0(natts * sizeof(uint32));
+
+	node->fdw_state = (void *) cstate;
+}
+
+/*
+ * columnarIterateForeignScan
+ *		Return the next row as a virtual tuple in the ScanTupleSlot.  Columns
+ *		that aren't needed are returned as nulls.
+ */
+static TupleTableSlot *
+columnarIterateForeignScan(ForeignScanState *node)
+{
+	ColumnarScanState *cstate = (ColumnarScanState *) node->fdw_state;
+	TupleTableSlot *slot = node->ss.ss_ScanTupleSlot;
+	TupleDesc	tupdesc = slot->tts_tupleDescriptor;
+	uint32		row;
+	int			i;
+
+	ExecClearTuple(slot);
+
+	while (cstate->stripe == NULL || cstate->row >= cstate->stripe->nrows)
+	{
+		if (!columnar_next_stripe(cstate, tupdesc))
+			return slot;
+	}
+
+	row = cstate->row++;
+	for (i = 0; i < tupdesc->natts; i++)
+	{
+		if (cstate->bitmaps[i] == NULL || att_isnull(row, cstate->bitmaps[i]))
+		{
+			slot->tts_values[i] = (Datum) 0;
+			slot->tts_isnull[i] = true;
+		}
+		else
+		{
+			slot->tts_values[i] = columnar_fetch_datum(cstate->data[i],
+													   &cstate->offsets[i],
+													   tupdesc->attrs[i]);
+			slot->tts_isnull[i] = false;
+		}
+	}
+
+	return ExecStoreVirtualTuple(slot);
+}
+
+/*
+ * Move on to the next stripe that can't be skipped, and read the columns
+ * we need from it.  Returns false if there are no more stripes.
+ */
+static bool
+columnar_next_stripe(ColumnarScanState *cstate, TupleDesc tupdesc)
+{
+	ColumnarMetadata *metadata = cstate->metadata;
+	ColumnarStripe *stripe = NULL;
+	MemoryContext oldcontext;
+	int			i;
+
+	cstate->stripe = NULL;
+	MemoryContextReset(cstate->stripe_cxt);
+	memset(cstate->bitmaps, 0, tupdesc->natts * sizeof(bits8 *));
+
+	while (cstate->next_stripe < metadata->nstripes)
+	{
+		stripe = &metadata->stripes[cstate->next_stripe++];
+		if (!columnar_stripe_excluded(stripe, cstate->prune_keys))
+			break;
+		cstate->stripes_skipped++;
+		stripe = NULL;
+	}
+	if (stripe == NULL)
+		return false;
+
+	if (cstate->fd < 0)
+	{
+		cstate->fd = OpenTransientFile(cstate->path, O_RDONLY | PG_BINARY, 0);
+		if (cstate->fd < 0)
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not open file \"%s\": %m", cstate->path)));
+	}
+
+	oldcontext = MemoryContextSwitchTo(cstate->stripe_cxt);
+	for (i = 0; i < tupdesc->natts && i < stripe->ncolumns; i++)
+	{
+		char	   *raw;
+
+		if (!cstate->needed[i])
+			continue;
+
+		raw = columnar_read_chunk(cstate->fd, cstate->path,
+								  &stripe->chunks[i]);
+		cstate->bitmaps[i] = (bits8 *) raw;
+		cstate->data[i] = raw + MAXALIGN(BITMAPLEN(stripe->nrows));
+		cstate->offsets[i] = 0;
+	}
+	MemoryContextSwitchTo(oldcontext);
+
+	cstate->stripe = stripe;
+	cstate->row = 0;
+	cstate->stripes_read++;
+
+	return true;
+}
+
+/*
+ * columnarReScanForeignScan
+ *		Rescan table, possibly with new parameters
+ */
+static void
+columnarReScanForeignScan(ForeignScanState *node)
+{
+	ColumnarScanState *cstate = (ColumnarScanState *) node->fdw_state;
+
+	cstate->next_stripe = 0;
+	cstate->stripe = NULL;
+}
+
+/*
+ * columnarEndForeignScan
+ *		Finish scanning foreign table and dispose objects used for this scan
+ */
+static void
+columnarEndForeignScan(ForeignScanState *node)
+{
+	ColumnarScanState *cstate = (ColumnarScanState *) node->fdw_state;
+
+	/* if cstate is NULL, we are in EXPLAIN; nothing to do */
+	if (cstate == NULL)
+		return;
+
+	if (cstate->fd >= 0)
+		CloseTransientFile(cstate->fd);
+	MemoryContextDelete(cstate->stripe_cxt);
+}
+
+/*
+ * columnarIsForeignScanParallelSafe
+ *		A parallel worker can read the table just like the leader, unless
+ *		the leader's transaction has written to it: the worker wouldn't see
+ *		the rows that aren't committed yet.
+ */
+static bool
+columnarIsForeignScanParallelSafe(PlannerInfo *root, RelOptInfo *rel,
+								  RangeTblEntry *rte)
+{
+	return !columnar_has_pending_writes(rte->relid);
+}
+
+/*
+ * columnarIsForeignRelUpdatable
+ *		Rows can only be added.
+ */
+static int
+columnarIsForeignRelUpdatable(Relation rel)
+{
+	return (1 << CMD_INSERT);
+}
+
+/*
+ * columnarBeginForeignModify
+ *		Prepare to insert rows
+ */
+static void
+columnarBeginForeignModify(ModifyTableState *mtstate,
+						   ResultRelInfo *rinfo,
+						   List *fdw_private,
+						   int subplan_index,
+						   int eflags)
+{
+	Relation	rel = rinfo->ri_RelationDesc;
+	ColumnarOptions options;
+
+	/* Do nothing in EXPLAIN (no ANALYZE) case. */
+	if (eflags & EXEC_FLAG_EXPLAIN_ONLY)
+		return;
+
+	columnar_get_options(RelationGetRelid(rel), &options);
+	rinfo->ri_FdwState = columnar_begin_write(rel, &options);
+}
+
+/*
+ * columnarExecForeignInsert
+ *		Add one row to the table
+ */
+static TupleTableSlot *
+columnarExecForeignInsert(EState *estate,
+						  ResultRelInfo *rinfo,
+						  TupleTableSlot *slot,
+						  TupleTableSlot *planSlot)
+{
+	ColumnarWriteState *wstate = (ColumnarWriteState *) rinfo->ri_FdwState;
+
+	slot_getallattrs(slot);
+	columnar_write_row(wstate, slot->tts_values, slot->tts_isnull);
+
+	return slot;
+}
+
+/*
+ * columnarEndForeignModify
+ *		Write out the rows not written yet
+ */
+static void
+columnarEndForeignModify(EState *estate, ResultRelInfo *rinfo)
+{
+	ColumnarWriteState *wstate = (ColumnarWriteState *) rinfo->ri_FdwState;
+
+	/* if wstate is NULL, we are in EXPLAIN; nothing to do */
+	if (wstate != NULL)
+		columnar_end_write(wstate);
+}
+
+/*
+ * Determine the columns a scan has to read: those needed for joins or the
+ * final output, and those used by restriction clauses.  Returns an integer
+ * list of attribute numbers, in ascending order.
+ */
+static List *
+columnar_needed_columns(RelOptInfo *baserel, int natts)
+{
+	Bitmapset  *attrs_used = NULL;
+	List	   *columns = NIL;
+	ListCell   *lc;
+	int			attnum;
+
+	pull_varattnos((Node *) baserel->reltarget->exprs, baserel->relid,
+				   &attrs_used);
+	foreach(lc, baserel->baserestrictinfo)
+	{
+		RestrictInfo *rinfo = (RestrictInfo *) lfirst(lc);
+
+		pull_varattnos((Node *) rinfo->clause, baserel->relid,
+					   &attrs_used);
+	}
+
+	/* A whole-row reference needs all the columns */
+	if (bms_is_member(0 - FirstLowInvalidHeapAttributeNumber, attrs_used))
+	{
+		for (attnum = 1; attnum <= natts; attnum++)
+			columns = lappend_int(columns, attnum);
+		return columns;
+	}
+
+	for (attnum = 1; attnum <= natts; attnum++)
+	{
+		if (bms_is_member(attnum - FirstLowInvalidHeapAttributeNumber,
+						  attrs_used))
+			columns = lappend_int(columns, attnum);
+	}
+
+	return columns;
+}
+
+/*
+ * Find the quals that can be checked against the minimum and maximum
+ * values of a stripe: "column op constant" or "constant op column", where
+ * op is a btree comparison operator for the column's type and collation.
+ */
+static List *
+columnar_prune_keys(List *quals, Index scanrelid)
+{
+	List	   *keys = NIL;
+	ListCell   *lc;
+
+	foreach(lc, quals)
+	{
+		OpExpr	   *opexpr = (OpExpr *) lfirst(lc);
+		Node	   *left;
+		Node	   *right;
+		Var		   *var;
+		Const	   *con;
+		Oid			opno;
+		TypeCacheEntry *typentry;
+		int			strategy;
+		Oid			lefttype;
+		Oid			righttype;
+		ColumnarPruneKey *key;
+
+		if (!IsA(opexpr, OpExpr) || list_length(opexpr->args) != 2)
+			continue;
+
+		left = (Node *) linitial(opexpr->args);
+		right = (Node *) lsecond(opexpr->args);
+		opno = opexpr->opno;
+		if (IsA(left, Const) && IsA(right, Var))
+		{
+			Node	   *tmp = left;
+
+			left = right;
+			right = tmp;
+			opno = get_commutator(opno);
+			if (!OidIsValid(opno))
+				continue;
+		}
+		if (!IsA(left, Var) || !IsA(right, Const))
+			continue;
+
+		var = (Var *) left;
+		con = (Const *) right;
+		if (var->varno != scanrelid || var->varlevelsup != 0 ||
+			var->varattno <= 0 || con->constisnull)
+			continue;
+
+		/* min and max were computed with the column's collation */
+		if (opexpr->inputcollid != var->varcollid)
+			continue;
+
+		typentry = lookup_type_cache(var->vartype,
+									 TYPECACHE_BTREE_OPFAMILY |
+									 TYPECACHE_CMP_PROC_FINFO);
+		if (!OidIsValid(typentry->btree_opf) ||
+			!OidIsValid(typentry->cmp_proc_finfo.fn_oid) ||
+			!op_in_opfamily(opno, typentry->btree_opf))
+			continue;
+
+		get_op_opfamily_properties(opno, typentry->btree_opf, false,
+								   &strategy, &lefttype, &righttype);
+		if (lefttype != typentry->btree_opintype ||
+			righttype != typentry->btree_opintype)
+			continue;
+
+		key = (ColumnarPruneKey *) palloc(sizeof(ColumnarPruneKey));
+		key->attnum = var->varattno;
+		key->strategy = strategy;
+		key->value = con->constvalue;
+		key->cmp = &typentry->cmp_proc_finfo;
+		key->collation = var->varcollid;
+		keys = lappend(keys, key);
+	}
+
+	return keys;
+}
+
+/*
+ * Can the stripe be skipped, because one of the prune keys is false for
+ * all its rows?
+ */
+static bool
+columnar_stripe_excluded(ColumnarStripe *stripe, List *prune_keys)
+{
+	ListCell   *lc;
+
+	foreach(lc, prune_keys)
+	{
+		ColumnarPruneKey *key = (ColumnarPruneKey *) lfirst(lc);
+		ColumnarChunk *chunk;
+		int			cmp_min;
+		int			cmp_max;
+
+		/* Columns added after the stripe was written are all null */
+		if (key->attnum > stripe->ncolumns)
+			return true;
+
+		chunk = &stripe->chunks[key->attnum - 1];
+
+		/*
+		 * min and max are useless if the column's collation was changed
+		 * since the stripe was written.
+		 */
+		if (!chunk->has_minmax || chunk->collation != key->collation)
+			continue;
+
+		cmp_min = DatumGetInt32(FunctionCall2Coll(key->cmp, key->collation,
+												  chunk->min_value,
+												  key->value));
+		cmp_max = DatumGetInt32(FunctionCall2Coll(key->cmp, key->collation,
+												  chunk->max_value,
+												  key->value));
+
+		switch (key->strategy)
+		{
+			case BTLessStrategyNumber:
+				if (cmp_min >= 0)
+					return true;
+				break;
+			case BTLessEqualStrategyNumber:
+				if (cmp_min > 0)
+					return true;
+				break;
+			case BTEqualStrategyNumber:
+				if (cmp_min > 0 || cmp_max < 0)
+					return true;
+				break;
+			case BTGreaterEqualStrategyNumber:
+				if (cmp_max < 0)
+					return true;
+				break;
+			case BTGreaterStrategyNumber:
+				if (cmp_max <= 0)
+					return true;
+				break;
+		}
+	}
+
+	return false;
+}
+
+/*
+ * Object access hook: when a columnar table is dropped, remove its files at
+ * commit.  We don't know for sure that the foreign table belongs to us, but
+ * if there are files named after its OID, they can't belong to anything else.
+ */
+static void
+columnar_object_access(ObjectAccessType access, Oid classId, Oid objectId,
+					   int subId, void *arg)
+{
+	if (prev_object_access_hook)
+		(*prev_object_access_hook) (access, classId, objectId, subId, arg);
+
+	if (access == OAT_DROP && classId == RelationRelationId && subId == 0 &&
+		get_rel_relkind(objectId) == RELKIND_FOREIGN_TABLE)
+	{
+		char		data_path[MAXPGPATH];
+		char		meta_path[MAXPGPATH];
+		struct stat st;
+
+		columnar_file_path(objectId, "data", data_path);
+		columnar_file_path(objectId, "meta", meta_path);
+		if (stat(data_path, &st) == 0 || stat(meta_path, &st) == 0)
+			columnar_schedule_unlink(objectId);
+	}
+}
@@ -0,0 +1,139 @@
+/*-------------------------------------------------------------------------
+ *
+ * columnar_fdw.h
+ *		  Definitions shared by the parts of columnar_fdw.
+ *
+ * Copyright (c) 2016, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *		  contrib/columnar_fdw/columnar_fdw.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef COLUMNAR_FDW_H
+#define COLUMNAR_FDW_H
+
+#include "access/tupdesc.h"
+#include "access/tupmacs.h"
+#include "fmgr.h"
+#include "lib/stringinfo.h"
+#include "utils/relcache.h"
+
+/* Defaults and limits of the foreign table options */
+#define COLUMNAR_DEFAULT_STRIPE_ROW_COUNT	150000
+#define COLUMNAR_MIN_STRIPE_ROW_COUNT		1000
+#define COLUMNAR_MAX_STRIPE_ROW_COUNT		10000000
+
+/*
+ * Metadata of the data of one column in one stripe, called a chunk.  The
+ * chunk holds a null bitmap followed, at the next MAXALIGN'd offset, by the
+ * non-null values laid out as they would be in a heap tuple.  The minimum
+ * and maximum values are only kept for types with a btree comparison
+ * function.
+ */
+typedef struct ColumnarChunk
+{
+	uint64		offset;			/* position in the data file */
+	uint32		stored_size;	/* size in the data file */
+	uint32		raw_size;		/* size after decompression */
+	Oid			typid;			/* data type of the column when written */
+	Oid			collation;		/* collation min_value and max_value obey */
+	bool		compressed;		/* compressed with pglz? */
+	bool		has_minmax;		/* are min_value and max_value valid? */
+	Datum		min_value;
+	Datum		max_value;
+} ColumnarChunk;
+
+/*
+ * A stripe is a group of consecutive rows, stored column by column.  Columns
+ * added to the table after the stripe was written read as nulls.
+ */
+typedef struct ColumnarStripe
+{
+	uint32		nrows;
+	int			ncolumns;		/* number of attributes when written */
+	ColumnarChunk *chunks;		/* ncolumns entries */
+} ColumnarStripe;
+
+/*
+ * Metadata of a columnar table: the stripes, in the order they were written.
+ */
+typedef struct ColumnarMetadata
+{
+	uint64		data_length;	/* used length of the data file */
+	uint64		nrows;			/* sum of the stripes' row counts */
+	int			nstripes;
+	int			maxstripes;		/* allocated length of stripes[] */
+	ColumnarStripe *stripes;
+} ColumnarMetadata;
+
+/*
+ * Options of a columnar foreign table.
+ */
+typedef struct ColumnarOptions
+{
+	int			stripe_row_count;
+	bool		compression;
+} ColumnarOptions;
+
+/* State of an INSERT into a columnar table, see columnar_storage.c */
+typedef struct ColumnarWriteState ColumnarWriteState;
+
+/*
+ * Append a datum to buf, laid out as heap_fill_tuple would lay it out in a
+ * tuple whose data starts at the beginning of buf.  The value must not be a
+ * toast pointer.  Padding bytes are zeroed, so that att_align_pointer can
+ * tell them from a short varlena header when the values are read back.
+ */
+static inline void
+columnar_append_datum(StringInfo buf, Datum value, Form_pg_attribute attr)
+{
+	int			off;
+	Size		data_length;
+
+	off = att_align_datum(buf->len, attr->attalign, attr->attlen, value);
+	data_length = att_addlength_datum(0, attr->attlen, value);
+
+	enlargeStringInfo(buf, (off - buf->len) + data_length);
+	memset(buf->data + buf->len, 0, off - buf->len);
+	if (attr->attbyval)
+		store_att_byval(buf->data + off, value, attr->attlen);
+	else
+		memcpy(buf->data + off, DatumGetPointer(value), data_length);
+	buf->len = off + data_length;
+	buf->data[buf->len] = '\0';
+}
+
+/*
+ * Read back a datum stored by columnar_append_datum at offset *off of data,
+ * which must be MAXALIGN'd, and advance *off past it.  Values passed by
+ * reference point into data.
+ */
+static inline Datum
+columnar_fetch_datum(const char *data, uint32 *off, Form_pg_attribute attr)
+{
+	Datum		value;
+
+	*off = att_align_pointer(*off, attr->attalign, attr->attlen, data + *off);
+	value = fetchatt(attr, data + *off);
+	*off = att_addlength_pointer(*off, attr->attlen, data + *off);
+
+	return value;
+}
+
+/* columnar_storage.c */
+extern void columnar_storage_init(void);
+extern void columnar_file_path(Oid relid, const char *kind, char *path);
+extern ColumnarMetadata *columnar_read_metadata(Relation rel);
+extern bool columnar_has_pending_writes(Oid relid);
+extern ColumnarWriteState *columnar_begin_write(Relation rel,
+					 ColumnarOptions *options);
+extern void columnar_write_row(ColumnarWriteState *wstate,
+				   Datum *values, bool *isnull);
+extern void columnar_end_write(ColumnarWriteState *wstate);
+extern char *columnar_read_chunk(int fd, const char *path,
+					ColumnarChunk *chunk);
+extern void columnar_schedule_unlink(Oid relid);
+extern int	columnar_remove_orphans(void);
+
+#endif   /* COLUMNAR_FDW_H */
@@ -0,0 +1,1250 @@
+/*-------------------------------------------------------------------------
+ *
+ * columnar_storage.c
+ *		  On-disk format of columnar_fdw tables.
+ *
+ * Each table is stored in files in the directory of its database, named
+ * "columnar_<table OID>" with a suffix.  The ".data" file holds the column
+ * chunks of all the stripes.  It is only ever appended to.  The ".meta" file
+ * lists the stripes and, for each of their columns, where its chunk is in
+ * the data file, its size, and its minimum and maximum values.  Keeping the
+ * files in the database directory makes DROP DATABASE remove them, and
+ * CREATE DATABASE copy them along with the catalogs that describe them.
+ *
+ * Writers don't touch the metadata file until their transaction commits.
+ * They append stripes after the part of the data file the current metadata
+ * covers, and remember the new metadata as pending.  Just before commit,
+ * the data file is flushed, and the new metadata is written to a ".pending"
+ * file that records the writer's transaction ID.  Readers only believe the
+ * pending file once that transaction has committed, so all the tables a
+ * transaction wrote to change at the same moment, and not at all if it
+ * fails to commit.  After commit, the pending file is renamed over the
+ * metadata file; if that doesn't happen, because of a crash say, the next
+ * writer does it, or removes the file if its transaction didn't commit.  A
+ * reader in the writing transaction sees its own rows.  Writers lock the
+ * table in ShareUpdateExclusiveLock mode, which lets readers in but keeps
+ * other writers out until commit.
+ *
+ * None of this is WAL-logged, so columnar tables are not crash-safe beyond
+ * the fsyncs done at commit, and are not replicated to standbys.
+ *
+ * Copyright (c) 2016, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *		  contrib/columnar_fdw/columnar_storage.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "columnar_fdw.h"
+
+#include "access/heapam.h"
+#include "access/transam.h"
+#include "access/tuptoaster.h"
+#include "access/xact.h"
+#include "access/xlog.h"
+#include "common/pg_lzcompress.h"
+#include "common/relpath.h"
+#include "miscadmin.h"
+#include "port/pg_crc32c.h"
+#include "storage/fd.h"
+#include "storage/lmgr.h"
+#include "storage/procarray.h"
+#include "utils/datum.h"
+#include "utils/memutils.h"
+#include "utils/rel.h"
+#include "utils/syscache.h"
+#include "utils/typcache.h"
+
+#define COLUMNAR_META_MAGIC		0x434F4C4D	/* "COLM" */
+#define COLUMNAR_META_VERSION	2
+
+/*
+ * Larger varlena values are not kept as the minimum or maximum of a chunk,
+ * to keep the metadata small.  Chunks are flushed early if their data gets
+ * this large, to stay well within the limits of palloc and pglz.
+ */
+#define COLUMNAR_MAX_MINMAX_SIZE	256
+#define COLUMNAR_MAX_CHUNK_SIZE		(256 * 1024 * 1024)
+
+/*
+ * Metadata written by the current transaction, not yet published.  There is
+ * one entry for each table and subtransaction level that wrote to it; the
+ * most recent comes first.
+ */
+typedef struct ColumnarPendingWrite
+{
+	Oid			relid;
+	SubTransactionId subid;
+	ColumnarMetadata *metadata; /* allocated in TopTransactionContext */
+} ColumnarPendingWrite;
+
+/* Tables dropped by the current transaction, whose files go at commit */
+typedef struct ColumnarPendingUnlink
+{
+	Oid			relid;
+	SubTransactionId subid;
+} ColumnarPendingUnlink;
+
+static List *pending_writes = NIL;
+static List *pending_unlinks = NIL;
+
+/* Tables whose pending file the committing transaction has written */
+static List *staged_relids = NIL;
+
+/*
+ * State of an INSERT into a columnar table.  Rows are collected column by
+ * column until there are enough for a stripe.
+ */
+struct ColumnarWriteState
+{
+	Relation	rel;
+	TupleDesc	tupdesc;
+	ColumnarOptions options;
+	ColumnarMetadata *metadata; /* allocated in TopTransactionContext */
+	char		path[MAXPGPATH];	/* of the data file */
+	int			fd;
+	MemoryContext stripe_cxt;	/* for the stripe being collected */
+
+	uint32		nrows;			/* rows collected so far */
+	StringInfoData *values;		/* per column, the non-null values */
+	bits8	  **nullbitmaps;	/* per column, set bit means not null */
+	FmgrInfo  **cmp_procs;		/* per column, btree comparison or NULL */
+	bool	   *minmax_valid;	/* per column, are min and max tracked? */
+	bool	   *minmax_set;		/* per column, have we seen a value? */
+	Datum	   *min_values;
+	Datum	   *max_values;
+};
+
+static ColumnarMetadata *columnar_read_metadata_file(const char *path,
+							TupleDesc tupdesc, TransactionId *xid);
+static ColumnarMetadata *columnar_copy_metadata(ColumnarMetadata *metadata);
+static ColumnarMetadata *columnar_parse_metadata(char *data, Size len,
+						TupleDesc tupdesc, const char *path,
+						TransactionId *xid);
+static void columnar_serialize_metadata(ColumnarMetadata *metadata,
+							TupleDesc tupdesc, TransactionId xid,
+							StringInfo buf);
+static void columnar_write_file(const char *path, int fd, uint64 offset,
+					char *data, Size len);
+static void columnar_flush_stripe(ColumnarWriteState *wstate);
+static void columnar_set_pending(Oid relid, ColumnarMetadata *metadata);
+static void columnar_stage(Relation rel, ColumnarMetadata *metadata);
+static void columnar_settle(Relation rel);
+static void columnar_install_pending(Oid relid);
+static void columnar_unlink_files(Oid relid);
+static void columnar_xact_callback(XactEvent event, void *arg);
+static void columnar_subxact_callback(SubXactEvent event,
+						  SubTransactionId mySubid,
+						  SubTransactionId parentSubid, void *arg);
+
+
+/*
+ * Module initialization, called from _PG_init
+ */
+void
+columnar_storage_init(void)
+{
+	RegisterXactCallback(columnar_xact_callback, NULL);
+	RegisterSubXactCallback(columnar_subxact_callback, NULL);
+}
+
+/*
+ * Construct the path of one of the files of a table in the current database
+ * into path, which must have room for MAXPGPATH bytes.  kind is the suffix:
+ * "data", "meta", "pending", or "tmp" for a pending file being written.
+ */
+void
+columnar_file_path(Oid relid, const char *kind, char *path)
+{
+	char	   *dbpath = GetDatabasePath(MyDatabaseId, MyDatabaseTableSpace);
+
+	snprintf(path, MAXPGPATH, "%s/columnar_%u.%s", dbpath, relid, kind);
+	pfree(dbpath);
+}
+
+/*
+ * Return the metadata of a table, as seen by the current transaction: what
+ * it wrote itself if anything, else what was last committed.  The result is
+ * allocated in the current memory context; min and max values may point to
+ * memory that lives until the end of the transaction.
+ */
+ColumnarMetadata *
+columnar_read_metadata(Relation rel)
+{
+	Oid			relid = RelationGetRelid(rel);
+	TupleDesc	tupdesc = RelationGetDescr(rel);
+	char		path[MAXPGPATH];
+	ListCell   *lc;
+	ColumnarMetadata *metadata;
+	TransactionId xid;
+
+	foreach(lc, pending_writes)
+	{
+		ColumnarPendingWrite *pending = (ColumnarPendingWrite *) lfirst(lc);
+
+		if (pending->relid == relid)
+			return columnar_copy_metadata(pending->metadata);
+	}
+
+	/* metadata that hasn't been renamed into place yet, if it committed */
+	columnar_file_path(relid, "pending", path);
+	metadata = columnar_read_metadata_file(path, tupdesc, &xid);
+	if (metadata != NULL)
+	{
+		if (!TransactionIdIsInProgress(xid) && TransactionIdDidCommit(xid))
+			return metadata;
+		pfree(metadata);
+	}
+
+	columnar_file_path(relid, "meta", path);
+	metadata = columnar_read_metadata_file(path, tupdesc, &xid);
+	if (metadata == NULL)
+	{
+		/* Nothing has been committed yet */
+		metadata = (ColumnarMetadata *) palloc0(sizeof(ColumnarMetadata));
+	}
+
+	return metadata;
+}
+
+/*
+ * Read and parse a metadata or pending file, and return the ID of the
+ * transaction that wrote it in *xid.  Returns NULL if there is no such file.
+ */
+static ColumnarMetadata *
+columnar_read_metadata_file(const char *path, TupleDesc tupdesc,
+							TransactionId *xid)
+{
+	int			fd;
+	struct stat st;
+	char	   *data;
+	ColumnarMetadata *metadata;
+
+	fd = OpenTransientFile((char *) path, O_RDONLY | PG_BINARY, 0);
+	if (fd < 0)
+	{
+		if (errno != ENOENT)
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not open file \"%s\": %m", path)));
+		return NULL;
+	}
+
+	if (fstat(fd, &st) < 0)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not stat file \"%s\": %m", path)));
+
+	data = palloc(st.st_size);
+	if (read(fd, data, st.st_size) != st.st_size)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not read file \"%s\": %m", path)));
+	CloseTransientFile(fd);
+
+	metadata = columnar_parse_metadata(data, st.st_size, tupdesc, path, xid);
+	pfree(data);
+
+	return metadata;
+}
+
+/*
+ * Has the current transaction written to the table?
+ */
+bool
+columnar_has_pending_writes(Oid relid)
+{
+	ListCell   *lc;
+
+	foreach(lc, pending_writes)
+	{
+		ColumnarPendingWrite *pending = (ColumnarPendingWrite *) lfirst(lc);
+
+		if (pending->relid == relid)
+			return true;
+	}
+	return false;
+}
+
+/*
+ * Copy metadata into the current memory context.  The stripes themselves
+ * are never changed once written, so they are shared.
+ */
+static ColumnarMetadata *
+columnar_copy_metadata(ColumnarMetadata *metadata)
+{
+	ColumnarMetadata *copy;
+
+	copy = (ColumnarMetadata *) palloc(sizeof(ColumnarMetadata));
+	memcpy(copy, metadata, sizeof(ColumnarMetadata));
+	copy->maxstripes = Max(metadata->nstripes, 8);
+	copy->stripes = (ColumnarStripe *)
+		palloc(copy->maxstripes * sizeof(ColumnarStripe));
+	if (metadata->nstripes > 0)
+		memcpy(copy->stripes, metadata->stripes,
+			   metadata->nstripes * sizeof(ColumnarStripe));
+
+	return copy;
+}
+
+/*
+ * Helper for columnar_parse_metadata: copy len bytes from the current
+ * position into dest, complaining if there aren't that many left.
+ */
+static void
+columnar_read_bytes(StringInfo buf, void *dest, int len, const char *path)
+{
+	if (buf->cursor + len > buf->len)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg("columnar metadata file \"%s\" is truncated", path)));
+	memcpy(dest, buf->data + buf->cursor, len);
+	buf->cursor += len;
+}
+
+/*
+ * Read a minimum or maximum value serialized by columnar_serialize_metadata.
+ */
+static Datum
+columnar_read_minmax(StringInfo buf, Form_pg_attribute attr, const char *path)
+{
+	uint32		len;
+	uint32		off = 0;
+	char	   *value;
+
+	columnar_read_bytes(buf, &len, sizeof(len), path);
+	value = palloc(len + 1);	/* palloc'd, hence MAXALIGN'd */
+	columnar_read_bytes(buf, value, len, path);
+
+	return columnar_fetch_datum(value, &off, attr);
+}
+
+/*
+ * Parse the contents of a metadata file.
+ */
+static ColumnarMetadata *
+columnar_parse_metadata(char *data, Size len, TupleDesc tupdesc,
+						const char *path, TransactionId *xid)
+{
+	StringInfoData buf;
+	ColumnarMetadata *metadata;
+	uint32		magic;
+	uint32		version;
+	uint32		nstripes;
+	pg_crc32c	crc;
+	pg_crc32c	stored_crc;
+	int			i;
+
+	if (len < sizeof(pg_crc32c))
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg("columnar metadata file \"%s\" is truncated", path)));
+
+	INIT_CRC32C(crc);
+	COMP_CRC32C(crc, data, len - sizeof(pg_crc32c));
+	FIN_CRC32C(crc);
+	memcpy(&stored_crc, data + len - sizeof(pg_crc32c), sizeof(pg_crc32c));
+	if (!EQ_CRC32C(crc, stored_crc))
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg("incorrect checksum in columnar metadata file \"%s\"",
+						path)));
+
+	buf.data = data;
+	buf.len = len - sizeof(pg_crc32c);
+	buf.maxlen = len;
+	buf.cursor = 0;
+
+	columnar_read_bytes(&buf, &magic, sizeof(magic), path);
+	columnar_read_bytes(&buf, &version, sizeof(version), path);
+	if (magic != COLUMNAR_META_MAGIC || version != COLUMNAR_META_VERSION)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg("columnar metadata file \"%s\" has wrong version",
+						path)));
+	columnar_read_bytes(&buf, xid, sizeof(TransactionId), path);
+
+	metadata = (ColumnarMetadata *) palloc0(sizeof(ColumnarMetadata));
+	columnar_read_bytes(&buf, &metadata->data_length,
+						sizeof(metadata->data_length), path);
+	columnar_read_bytes(&buf, &nstripes, sizeof(nstripes), path);
+
+	metadata->nstripes = nstripes;
+	metadata->maxstripes = Max(nstripes, 8);
+	metadata->stripes = (ColumnarStripe *)
+		palloc(metadata->maxstripes * sizeof(ColumnarStripe));
+
+	for (i = 0; i < metadata->nstripes; i++)
+	{
+		ColumnarStripe *stripe = &metadata->stripes[i];
+		uint32		ncolumns;
+		int			j;
+
+		columnar_read_bytes(&buf, &stripe->nrows, sizeof(stripe->nrows), path);
+		columnar_read_bytes(&buf, &ncolumns, sizeof(ncolumns), path);
+		if (ncolumns > tupdesc->natts)
+			ereport(ERROR,
+					(errcode(ERRCODE_DATA_CORRUPTED),
+					 errmsg("columnar metadata file \"%s\" has more columns than the table",
+							path)));
+		stripe->ncolumns = ncolumns;
+		stripe->chunks = (ColumnarChunk *)
+			palloc0(ncolumns * sizeof(ColumnarChunk));
+		metadata->nrows += stripe->nrows;
+
+		for (j = 0; j < stripe->ncolumns; j++)
+		{
+			ColumnarChunk *chunk = &stripe->chunks[j];
+			Form_pg_attribute attr = tupdesc->attrs[j];
+			uint8		flags[2];
+
+			columnar_read_bytes(&buf, &chunk->offset, sizeof(chunk->offset),
+								path);
+			columnar_read_bytes(&buf, &chunk->stored_size,
+								sizeof(chunk->stored_size), path);
+			columnar_read_bytes(&buf, &chunk->raw_size,
+								sizeof(chunk->raw_size), path);
+			columnar_read_bytes(&buf, &chunk->typid, sizeof(chunk->typid),
+								path);
+			columnar_read_bytes(&buf, &chunk->collation,
+								sizeof(chunk->collation), path);
+			columnar_read_bytes(&buf, flags, sizeof(flags), path);
+			chunk->compressed = (flags[0] != 0);
+			chunk->has_minmax = (flags[1] != 0);
+
+			/*
+			 * The values are only readable with the type they were written
+			 * with.  Dropped columns are never read, so they don't matter.
+			 */
+			if (chunk->typid != attr->atttypid && !attr->attisdropped)
+				ereport(ERROR,
+						(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+						 errmsg("data type of column \"%s\" has changed since data was stored in columnar metadata file \"%s\"",
+								NameStr(attr->attname), path),
+						 errhint("Changing the data type of a column of a columnar table is not supported.")));
+
+			if (chunk->has_minmax)
+			{
+				chunk->min_value = columnar_read_minmax(&buf, attr, path);
+				chunk->max_value = columnar_read_minmax(&buf, attr, path);
+			}
+		}
+	}
+
+	return metadata;
+}
+
+/*
+ * Serialize metadata into buf, in the format columnar_parse_metadata reads.
+ */
+static void
+columnar_serialize_metadata(ColumnarMetadata *metadata, TupleDesc tupdesc,
+							TransactionId xid, StringInfo buf)
+{
+	uint32		magic = COLUMNAR_META_MAGIC;
+	uint32		version = COLUMNAR_META_VERSION;
+	uint32		nstripes = metadata->nstripes;
+	StringInfoData value;
+	pg_crc32c	crc;
+	int			i;
+
+	initStringInfo(&value);
+
+	appendBinaryStringInfo(buf, (char *) &magic, sizeof(magic));
+	appendBinaryStringInfo(buf, (char *) &version, sizeof(version));
+	appendBinaryStringInfo(buf, (char *) &xid, sizeof(xid));
+	appendBinaryStringInfo(buf, (char *) &metadata->data_length,
+						   sizeof(metadata->data_length));
+	appendBinaryStringInfo(buf, (char *) &nstripes, sizeof(nstripes));
+
+	for (i = 0; i < metadata->nstripes; i++)
+	{
+		ColumnarStripe *stripe = &metadata->stripes[i];
+		uint32		ncolumns = stripe->ncolumns;
+		int			j;
+
+		appendBinaryStringInfo(buf, (char *) &stripe->nrows,
+							   sizeof(stripe->nrows));
+		appendBinaryStringInfo(buf, (char *) &ncolumns, sizeof(ncolumns));
+
+		for (j = 0; j < stripe->ncolumns; j++)
+		{
+			ColumnarChunk *chunk = &stripe->chunks[j];
+			uint8		flags[2];
+
+			appendBinaryStringInfo(buf, (char *) &chunk->offset,
+								   sizeof(chunk->offset));
+			appendBinaryStringInfo(buf, (char *) &chunk->stored_size,
+								   sizeof(chunk->stored_size));
+			appendBinaryStringInfo(buf, (char *) &chunk->raw_size,
+								   sizeof(chunk->raw_size));
+			appendBinaryStringInfo(buf, (char *) &chunk->typid,
+								   sizeof(chunk->typid));
+			appendBinaryStringInfo(buf, (char *) &chunk->collation,
+								   sizeof(chunk->collation));
+			flags[0] = chunk->compressed ? 1 : 0;
+			flags[1] = chunk->has_minmax ? 1 : 0;
+			appendBinaryStringInfo(buf, (char *) flags, sizeof(flags));
+
+			if (chunk->has_minmax)
+			{
+				Datum		minmax[2];
+				int			k;
+
+				minmax[0] = chunk->min_value;
+				minmax[1] = chunk->max_value;
+				for (k = 0; k < 2; k++)
+				{
+					uint32		len;
+
+					resetStringInfo(&value);
+					columnar_append_datum(&value, minmax[k],
+										  tupdesc->attrs[j]);
+					len = value.len;
+					appendBinaryStringInfo(buf, (char *) &len, sizeof(len));
+					appendBinaryStringInfo(buf, value.data, value.len);
+				}
+			}
+		}
+	}
+
+	INIT_CRC32C(crc);
+	COMP_CRC32C(crc, buf->data, buf->len);
+	FIN_CRC32C(crc);
+	appendBinaryStringInfo(buf, (char *) &crc, sizeof(crc));
+
+	pfree(value.data);
+}
+
+/*
+ * Write len bytes at the given offset of an open file.
+ */
+static void
+columnar_write_file(const char *path, int fd, uint64 offset, char *data,
+					Size len)
+{
+	if (lseek(fd, (off_t) offset, SEEK_SET) < 0)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not seek in file \"%s\": %m", path)));
+
+	errno = 0;
+	if (write(fd, data, len) != len)
+	{
+		/* if write didn't set errno, assume problem is no disk space */
+		if (errno == 0)
+			errno = ENOSPC;
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not write to file \"%s\": %m", path)));
+	}
+}
+
+/*
+ * Read the chunk of a column from an open data file.  Returns it
+ * decompressed, in a palloc'd buffer.
+ */
+char *
+columnar_read_chunk(int fd, const char *path, ColumnarChunk *chunk)
+{
+	char	   *stored;
+	char	   *raw;
+
+	stored = palloc(chunk->stored_size);
+	if (lseek(fd, (off_t) chunk->offset, SEEK_SET) < 0)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not seek in file \"%s\": %m", path)));
+	if (read(fd, stored, chunk->stored_size) != chunk->stored_size)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not read file \"%s\": %m", path)));
+
+	if (!chunk->compressed)
+		return stored;
+
+	raw = palloc(chunk->raw_size);
+	if (pglz_decompress(stored, chunk->stored_size,
+						raw, chunk->raw_size, true) != chunk->raw_size)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg("compressed data in file \"%s\" is corrupt", path)));
+	pfree(stored);
+
+	return raw;
+}
+
+/*
+ * Prepare to insert rows into a columnar table.
+ */
+ColumnarWriteState *
+columnar_begin_write(Relation rel, ColumnarOptions *options)
+{
+	ColumnarWriteState *wstate;
+	TupleDesc	tupdesc = RelationGetDescr(rel);
+	int			natts = tupdesc->natts;
+	MemoryContext oldcontext;
+	int			i;
+
+	/* Keep other writers out until we commit */
+	LockRelation(rel, ShareUpdateExclusiveLock);
+
+	/*
+	 * Our rows become visible when this transaction ID commits, so make sure
+	 * there is one.  Before going on, clean up after the last writer if it
+	 * didn't get to it.
+	 */
+	(void) GetTopTransactionId();
+	if (!columnar_has_pending_writes(RelationGetRelid(rel)))
+		columnar_settle(rel);
+
+	wstate = (ColumnarWriteState *) palloc0(sizeof(ColumnarWriteState));
+	wstate->rel = rel;
+	wstate->tupdesc = tupdesc;
+	wstate->options = *options;
+
+	oldcontext = MemoryContextSwitchTo(TopTransactionContext);
+	wstate->metadata = columnar_read_metadata(rel);
+	MemoryContextSwitchTo(oldcontext);
+
+	columnar_file_path(RelationGetRelid(rel), "data", wstate->path);
+	wstate->fd = OpenTransientFile(wstate->path,
+								   O_RDWR | O_CREAT | PG_BINARY,
+								   S_IRUSR | S_IWUSR);
+	if (wstate->fd < 0)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not open file \"%s\": %m", wstate->path)));
+
+	wstate->stripe_cxt = AllocSetContextCreate(CurrentMemoryContext,
+											   "columnar_fdw stripe",
+											   ALLOCSET_DEFAULT_MINSIZE,
+											   ALLOCSET_DEFAULT_INITSIZE,
+											   ALLOCSET_DEFAULT_MAXSIZE);
+
+	wstate->values = (StringInfoData *) palloc(natts * sizeof(StringInfoData));
+	wstate->nullbitmaps = (bits8 **) palloc(natts * sizeof(bits8 *));
+	wstate->cmp_procs = (FmgrInfo **) palloc0(natts * sizeof(FmgrInfo *));
+	wstate->minmax_valid = (bool *) palloc(natts * sizeof(bool));
+	wstate->minmax_set = (bool *) palloc(natts * sizeof(bool));
+	wstate->min_values = (Datum *) palloc(natts * sizeof(Datum));
+	wstate->max_values = (Datum *) palloc(natts * sizeof(Datum));
+
+	for (i = 0; i < natts; i++)
+	{
+		Form_pg_attribute attr = tupdesc->attrs[i];
+		TypeCacheEntry *typentry;
+
+		if (attr->attisdropped)
+			continue;
+
+		typentry = lookup_type_cache(attr->atttypid,
+									 TYPECACHE_CMP_PROC_FINFO);
+		if (OidIsValid(typentry->cmp_proc_finfo.fn_oid))
+			wstate->cmp_procs[i] = &typentry->cmp_proc_finfo;
+	}
+
+	return wstate;
+}
+
+/*
+ * Start collecting a new stripe.
+ */
+static void
+columnar_start_stripe(ColumnarWriteState *wstate)
+{
+	int			bitmaplen = BITMAPLEN(wstate->options.stripe_row_count);
+	MemoryContext oldcontext;
+	int			i;
+
+	MemoryContextReset(wstate->stripe_cxt);
+	oldcontext = MemoryContextSwitchTo(wstate->stripe_cxt);
+
+	for (i = 0; i < wstate->tupdesc->natts; i++)
+	{
+		initStringInfo(&wstate->values[i]);
+		wstate->nullbitmaps[i] = (bits8 *) palloc0(bitmaplen);
+		wstate->minmax_valid[i] = (wstate->cmp_procs[i] != NULL);
+		wstate->minmax_set[i] = false;
+		wstate->min_values[i] = (Datum) 0;
+		wstate->max_values[i] = (Datum) 0;
+	}
+
+	MemoryContextSwitchTo(oldcontext);
+}
+
+/*
+ * Add one row to the stripe being collected, writing the stripe out if it
+ * is full.
+ */
+void
+columnar_write_row(ColumnarWriteState *wstate, Datum *values, bool *isnull)
+{
+	TupleDesc	tupdesc = wstate->tupdesc;
+	MemoryContext oldcontext;
+	bool		chunk_full = false;
+	int			i;
+
+	if (wstate->nrows == 0)
+		columnar_start_stripe(wstate);
+
+	oldcontext = MemoryContextSwitchTo(wstate->stripe_cxt);
+
+	for (i = 0; i < tupdesc->natts; i++)
+	{
+		Form_pg_attribute attr = tupdesc->attrs[i];
+		Datum		value = values[i];
+
+		if (isnull[i] || attr->attisdropped)
+			continue;
+
+		/* Values are stored in line */
+		if (attr->attlen == -1 &&
+			VARATT_IS_EXTERNAL(DatumGetPointer(value)))
+			value = PointerGetDatum(heap_tuple_fetch_attr((struct varlena *)
+												  DatumGetPointer(value)));
+
+		wstate->nullbitmaps[i][wstate->nrows >> 3] |=
+			(1 << (wstate->nrows & 7));
+		columnar_append_datum(&wstate->values[i], value, attr);
+		if (wstate->values[i].len > COLUMNAR_MAX_CHUNK_SIZE)
+			chunk_full = true;
+
+		if (!wstate->minmax_valid[i])
+			continue;
+
+		if (!attr->attbyval &&
+			att_addlength_datum(0, attr->attlen, value) >
+			COLUMNAR_MAX_MINMAX_SIZE)
+		{
+			wstate->minmax_valid[i] = false;
+			continue;
+		}
+
+		if (!wstate->minmax_set[i])
+		{
+			wstate->min_values[i] = datumCopy(value, attr->attbyval,
+											  attr->attlen);
+			wstate->max_values[i] = wstate->min_values[i];
+			wstate->minmax_set[i] = true;
+		}
+		else
+		{
+			FmgrInfo   *cmp = wstate->cmp_procs[i];
+			Oid			collation = attr->attcollation;
+
+			if (DatumGetInt32(FunctionCall2Coll(cmp, collation, value,
+											wstate->min_values[i])) < 0)
+				wstate->min_values[i] = datumCopy(value, attr->attbyval,
+												  attr->attlen);
+			else if (DatumGetInt32(FunctionCall2Coll(cmp, collation, value,
+											 wstate->max_values[i])) > 0)
+				wstate->max_values[i] = datumCopy(value, attr->attbyval,
+												  attr->attlen);
+		}
+	}
+
+	MemoryContextSwitchTo(oldcontext);
+
+	wstate->nrows++;
+	if (wstate->nrows >= wstate->options.stripe_row_count || chunk_full)
+		columnar_flush_stripe(wstate);
+}
+
+/*
+ * Write out the stripe collected so far, and add it to the metadata.
+ */
+static void
+columnar_flush_stripe(ColumnarWriteState *wstate)
+{
+	TupleDesc	tupdesc = wstate->tupdesc;
+	ColumnarMetadata *metadata = wstate->metadata;
+	ColumnarStripe *stripe;
+	int			bitmaplen = BITMAPLEN(wstate->nrows);
+	MemoryContext oldcontext;
+	int			i;
+
+	if (wstate->nrows == 0)
+		return;
+
+	/* Make room for the new stripe, in the metadata's memory context */
+	oldcontext = MemoryContextSwitchTo(TopTransactionContext);
+	if (metadata->nstripes >= metadata->maxstripes)
+	{
+		metadata->maxstripes = Max(metadata->maxstripes * 2, 8);
+		if (metadata->stripes == NULL)
+			metadata->stripes = (ColumnarStripe *)
+				palloc(metadata->maxstripes * sizeof(ColumnarStripe));
+		else
+			metadata->stripes = (ColumnarStripe *)
+				repalloc(metadata->stripes,
+						 metadata->maxstripes * sizeof(ColumnarStripe));
+	}
+	stripe = &metadata->stripes[metadata->nstripes];
+	stripe->nrows = wstate->nrows;
+	stripe->ncolumns = tupdesc->natts;
+	stripe->chunks = (ColumnarChunk *)
+		palloc0(tupdesc->natts * sizeof(ColumnarChunk));
+	MemoryContextSwitchTo(oldcontext);
+
+	for (i = 0; i < tupdesc->natts; i++)
+	{
+		Form_pg_attribute attr = tupdesc->attrs[i];
+		ColumnarChunk *chunk = &stripe->chunks[i];
+		StringInfoData raw;
+		char	   *stored;
+		int32		stored_size = -1;
+
+		CHECK_FOR_INTERRUPTS();
+
+		/* The null bitmap, then the values at a MAXALIGN'd offset */
+		initStringInfo(&raw);
+		enlargeStringInfo(&raw, MAXALIGN(bitmaplen) + wstate->values[i].len);
+		memset(raw.data, 0, MAXALIGN(bitmaplen));
+		memcpy(raw.data, wstate->nullbitmaps[i], bitmaplen);
+		raw.len = MAXALIGN(bitmaplen);
+		appendBinaryStringInfo(&raw, wstate->values[i].data,
+							   wstate->values[i].len);
+
+		stored = raw.data;
+		if (wstate->options.compression)
+		{
+			char	   *compressed = palloc(PGLZ_MAX_OUTPUT(raw.len));
+
+			stored_size = pglz_compress(raw.data, raw.len, compressed,
+										PGLZ_strategy_default);
+			if (stored_size >= 0)
+				stored = compressed;
+			else
+				pfree(compressed);
+		}
+
+		chunk->offset = metadata->data_length;
+		chunk->raw_size = raw.len;
+		chunk->typid = attr->atttypid;
+		chunk->collation = attr->attcollation;
+		chunk->compressed = (stored != raw.data);
+		chunk->stored_size = chunk->compressed ? stored_size : raw.len;
+
+		columnar_write_file(wstate->path, wstate->fd, chunk->offset,
+							stored, chunk->stored_size);
+		metadata->data_length += chunk->stored_size;
+
+		/* an all-null chunk has no minimum and maximum */
+		if (wstate->minmax_valid[i] && wstate->minmax_set[i])
+		{
+			oldcontext = MemoryContextSwitchTo(TopTransactionContext);
+			chunk->has_minmax = true;
+			chunk->min_value = datumCopy(wstate->min_values[i],
+										 attr->attbyval, attr->attlen);
+			chunk->max_value = datumCopy(wstate->max_values[i],
+										 attr->attbyval, attr->attlen);
+			MemoryContextSwitchTo(oldcontext);
+		}
+
+		if (stored != raw.data)
+			pfree(stored);
+		pfree(raw.data);
+	}
+
+	metadata->nstripes++;
+	metadata->nrows += wstate->nrows;
+	wstate->nrows = 0;
+
+	/* Make the stripe visible to later scans in this transaction */
+	columnar_set_pending(RelationGetRelid(wstate->rel), metadata);
+}
+
+/*
+ * Finish inserting rows: write out the last stripe.  The new metadata is
+ * published when the transaction commits.
+ */
+void
+columnar_end_write(ColumnarWriteState *wstate)
+{
+	columnar_flush_stripe(wstate);
+
+	if (CloseTransientFile(wstate->fd) != 0)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not close file \"%s\": %m", wstate->path)));
+
+	MemoryContextDelete(wstate->stripe_cxt);
+}
+
+/*
+ * Remember the metadata written by the current (sub)transaction.
+ */
+static void
+columnar_set_pending(Oid relid, ColumnarMetadata *metadata)
+{
+	SubTransactionId subid = GetCurrentSubTransactionId();
+	ColumnarPendingWrite *pending;
+	MemoryContext oldcontext;
+
+	if (pending_writes != NIL)
+	{
+		pending = (ColumnarPendingWrite *) linitial(pending_writes);
+		if (pending->relid == relid && pending->subid == subid)
+		{
+			pending->metadata = metadata;
+			return;
+		}
+	}
+
+	oldcontext = MemoryContextSwitchTo(TopTransactionContext);
+	pending = (ColumnarPendingWrite *) palloc(sizeof(ColumnarPendingWrite));
+	pending->relid = relid;
+	pending->subid = subid;
+	pending->metadata = metadata;
+	pending_writes = lcons(pending, pending_writes);
+	MemoryContextSwitchTo(oldcontext);
+}
+
+/*
+ * Write the metadata written by the committing transaction to the table's
+ * pending file.  The data file is flushed first, so that the new metadata
+ * never points to data that might not be on disk.
+ */
+static void
+columnar_stage(Relation rel, ColumnarMetadata *metadata)
+{
+	Oid			relid = RelationGetRelid(rel);
+	char		data_path[MAXPGPATH];
+	char		tmp_path[MAXPGPATH];
+	char		pending_path[MAXPGPATH];
+	StringInfoData buf;
+	int			fd;
+	MemoryContext oldcontext;
+
+	columnar_file_path(relid, "data", data_path);
+	fd = OpenTransientFile(data_path, O_RDWR | PG_BINARY, 0);
+	if (fd < 0)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not open file \"%s\": %m", data_path)));
+	if (pg_fsync(fd) != 0)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not fsync file \"%s\": %m", data_path)));
+	CloseTransientFile(fd);
+
+	initStringInfo(&buf);
+	columnar_serialize_metadata(metadata, RelationGetDescr(rel),
+								GetTopTransactionId(), &buf);
+
+	columnar_file_path(relid, "tmp", tmp_path);
+	fd = OpenTransientFile(tmp_path, O_RDWR | O_CREAT | O_TRUNC | PG_BINARY,
+						   S_IRUSR | S_IWUSR);
+	if (fd < 0)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not create file \"%s\": %m", tmp_path)));
+	columnar_write_file(tmp_path, fd, 0, buf.data, buf.len);
+	if (pg_fsync(fd) != 0)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not fsync file \"%s\": %m", tmp_path)));
+	CloseTransientFile(fd);
+
+	/* from here on, an abort has to remove the pending file */
+	oldcontext = MemoryContextSwitchTo(TopTransactionContext);
+	staged_relids = lappend_oid(staged_relids, relid);
+	MemoryContextSwitchTo(oldcontext);
+
+	columnar_file_path(relid, "pending", pending_path);
+	(void) durable_rename(tmp_path, pending_path, ERROR);
+
+	pfree(buf.data);
+}
+
+/*
+ * Rename the pending file of a table, whose writer is known to have
+ * committed durably, over its metadata file.  Failures are only reported,
+ * because this runs after commit; readers still find the pending file.
+ */
+static void
+columnar_install_pending(Oid relid)
+{
+	char		pending_path[MAXPGPATH];
+	char		meta_path[MAXPGPATH];
+
+	columnar_file_path(relid, "pending", pending_path);
+	columnar_file_path(relid, "meta", meta_path);
+	(void) durable_rename(pending_path, meta_path, WARNING);
+}
+
+/*
+ * Deal with a pending file left behind by the last writer of a table, which
+ * didn't get to rename it into place after committing, or to remove it after
+ * aborting.  The caller must hold the writers' lock on the table.
+ */
+static void
+columnar_settle(Relation rel)
+{
+	Oid			relid = RelationGetRelid(rel);
+	char		path[MAXPGPATH];
+	ColumnarMetadata *metadata;
+	TransactionId xid;
+
+	columnar_file_path(relid, "pending", path);
+	metadata = columnar_read_metadata_file(path, RelationGetDescr(rel), &xid);
+	if (metadata == NULL)
+		return;
+	pfree(metadata);
+
+	/*
+	 * The writer has released its lock, so it is done, and if it committed,
+	 * it flushed its commit record before trying to rename the file.
+	 */
+	if (TransactionIdDidCommit(xid))
+		columnar_install_pending(relid);
+	else if (unlink(path) < 0 && errno != ENOENT)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not remove file \"%s\": %m", path)));
+}
+
+/*
+ * Arrange for the files of a table to be removed if the current transaction
+ * commits.
+ */
+void
+columnar_schedule_unlink(Oid relid)
+{
+	ColumnarPendingUnlink *pending;
+	MemoryContext oldcontext;
+
+	oldcontext = MemoryContextSwitchTo(TopTransactionContext);
+	pending = (ColumnarPendingUnlink *) palloc(sizeof(ColumnarPendingUnlink));
+	pending->relid = relid;
+	pending->subid = GetCurrentSubTransactionId();
+	pending_unlinks = lcons(pending, pending_unlinks);
+	MemoryContextSwitchTo(oldcontext);
+}
+
+/*
+ * Remove the files of a table.  This runs after commit, so failures are
+ * only reported.
+ */
+static void
+columnar_unlink_files(Oid relid)
+{
+	static const char *const kinds[] = {"data", "meta", "pending", "tmp"};
+	char		path[MAXPGPATH];
+	int			i;
+
+	for (i = 0; i < lengthof(kinds); i++)
+	{
+		columnar_file_path(relid, kinds[i], path);
+		if (unlink(path) < 0 && errno != ENOENT)
+			ereport(WARNING,
+					(errcode_for_file_access(),
+					 errmsg("could not remove file \"%s\": %m", path)));
+	}
+}
+
+/*
+ * Remove the files of tables that no longer exist in the current database,
+ * and return how many tables' files were removed.  The files of a table are
+ * normally removed when it is dropped, but only if columnar_fdw is loaded in
+ * the session that drops it.
+ */
+int
+columnar_remove_orphans(void)
+{
+	char	   *dir;
+	DIR		   *dirdesc;
+	struct dirent *de;
+	List	   *orphans = NIL;
+	ListCell   *lc;
+
+	dir = GetDatabasePath(MyDatabaseId, MyDatabaseTableSpace);
+	dirdesc = AllocateDir(dir);
+
+	while ((de = ReadDir(dirdesc, dir)) != NULL)
+	{
+		Oid			relid;
+		char		suffix[8];
+
+		if (sscanf(de->d_name, "columnar_%u.%7s", &relid, suffix) != 2 ||
+			list_member_oid(orphans, relid))
+			continue;
+
+		/*
+		 * A table that is being created and written to by a transaction that
+		 * hasn't committed yet isn't visible to us, but its writer holds a
+		 * lock on it.
+		 */
+		if (!ConditionalLockRelationOid(relid, AccessExclusiveLock))
+			continue;
+		if (!SearchSysCacheExists1(RELOID, ObjectIdGetDatum(relid)))
+			orphans = lappend_oid(orphans, relid);
+		UnlockRelationOid(relid, AccessExclusiveLock);
+	}
+	FreeDir(dirdesc);
+	pfree(dir);
+
+	foreach(lc, orphans)
+		columnar_unlink_files(lfirst_oid(lc));
+
+	return list_length(orphans);
+}
+
+/*
+ * Write pending metadata just before commit, rename it into place and
+ * remove the files of dropped tables after commit, and forget it all at the
+ * end of the transaction.
+ */
+static void
+columnar_xact_callback(XactEvent event, void *arg)
+{
+	ListCell   *lc;
+
+	switch (event)
+	{
+		case XACT_EVENT_PRE_COMMIT:
+			foreach(lc, pending_writes)
+			{
+				ColumnarPendingWrite *pending = lfirst(lc);
+				ListCell   *lc2;
+				bool		dropped = false;
+				Relation	rel;
+
+				foreach(lc2, pending_unlinks)
+				{
+					if (((ColumnarPendingUnlink *) lfirst(lc2))->relid ==
+						pending->relid)
+						dropped = true;
+				}
+				if (dropped)
+					continue;
+
+				rel = relation_open(pending->relid, NoLock);
+				columnar_stage(rel, pending->metadata);
+				relation_close(rel, NoLock);
+			}
+			break;
+
+		case XACT_EVENT_PRE_PREPARE:
+			if (pending_writes != NIL || pending_unlinks != NIL)
+				ereport(ERROR,
+						(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+						 errmsg("cannot PREPARE a transaction that has modified a columnar_fdw table")));
+			break;
+
+		case XACT_EVENT_COMMIT:
+
+			/*
+			 * With asynchronous commit, the commit might still be lost in a
+			 * crash, which must not leave our rows behind.
+			 */
+			if (staged_relids != NIL)
+				XLogFlush(XactLastCommitEnd);
+			foreach(lc, staged_relids)
+				columnar_install_pending(lfirst_oid(lc));
+			foreach(lc, pending_unlinks)
+				columnar_unlink_files(((ColumnarPendingUnlink *) lfirst(lc))->relid);
+			pending_writes = NIL;
+			pending_unlinks = NIL;
+			staged_relids = NIL;
+			break;
+
+		case XACT_EVENT_ABORT:
+			foreach(lc, staged_relids)
+			{
+				char		path[MAXPGPATH];
+
+				/* if this fails, the next writer removes the file */
+				columnar_file_path(lfirst_oid(lc), "pending", path);
+				if (unlink(path) < 0 && errno != ENOENT)
+					ereport(WARNING,
+							(errcode_for_file_access(),
+							 errmsg("could not remove file \"%s\": %m",
+									path)));
+			}
+			/* FALLTHROUGH */
+
+		case XACT_EVENT_PREPARE:
+			/* the lists were allocated in TopTransactionContext */
+			pending_writes = NIL;
+			pending_unlinks = NIL;
+			staged_relids = NIL;
+			break;
+
+		default:
+			break;
+	}
+}
+
+/*
+ * At subtransaction abort, forget what it did.  At subtransaction commit,
+ * hand it over to the parent, replacing whatever the parent had written to
+ * the same tables.
+ */
+static void
+columnar_subxact_callback(SubXactEvent event, SubTransactionId mySubid,
+						  SubTransactionId parentSubid, void *arg)
+{
+	List	   *writes = NIL;
+	List	   *unlinks = NIL;
+	ListCell   *lc;
+	MemoryContext oldcontext;
+
+	if (event != SUBXACT_EVENT_ABORT_SUB && event != SUBXACT_EVENT_COMMIT_SUB)
+		return;
+
+	oldcontext = MemoryContextSwitchTo(TopTransactionContext);
+
+	foreach(lc, pending_writes)
+	{
+		ColumnarPendingWrite *pending = lfirst(lc);
+
+		if (pending->subid == mySubid)
+		{
+			if (event == SUBXACT_EVENT_ABORT_SUB)
+				continue;
+			pending->subid = parentSubid;
+		}
+		else if (pending->subid == parentSubid &&
+				 event == SUBXACT_EVENT_COMMIT_SUB)
+		{
+			ListCell   *lc2;
+			bool		superseded = false;
+
+			/* entries of the child come earlier in the list */
+			foreach(lc2, writes)
+			{
+				if (((ColumnarPendingWrite *) lfirst(lc2))->relid ==
+					pending->relid)
+					superseded = true;
+			}
+			if (superseded)
+				continue;
+		}
+		writes = lappend(writes, pending);
+	}
+
+	foreach(lc, pending_unlinks)
+	{
+		ColumnarPendingUnlink *pending = lfirst(lc);
+
+		if (pending->subid == mySubid)
+		{
+			if (event == SUBXACT_EVENT_ABORT_SUB)
+				continue;
+			pending->subid = parentSubid;
+		}
+		unlinks = lappend(unlinks, pending);
+	}
+
+	pending_writes = writes;
+	pending_unlinks = unlinks;
+
+	MemoryContextSwitchTo(oldcontext);
+}
@@ -0,0 +1,82 @@
+--
+-- Test columnar_fdw
+--
+CREATE EXTENSION columnar_fdw;
+CREATE SERVER columnar_server FOREIGN DATA WRAPPER columnar_fdw;
+
+-- validator tests
+CREATE SERVER bad_server FOREIGN DATA WRAPPER columnar_fdw OPTIONS (compression 'none');  -- ERROR
+CREATE FOREIGN TABLE tbl (a int) SERVER columnar_server OPTIONS (stripe_row_count '10');  -- ERROR
+CREATE FOREIGN TABLE tbl (a int) SERVER columnar_server OPTIONS (compression 'zip');  -- ERROR
+CREATE FOREIGN TABLE tbl (a int) SERVER columnar_server OPTIONS (format 'csv');  -- ERROR
+
+CREATE FOREIGN TABLE measurements (id int, val float8, label text)
+  SERVER columnar_server OPTIONS (stripe_row_count '1000');
+SELECT count(*) FROM measurements;
+
+INSERT INTO measurements
+  SELECT i, i / 10.0, 'label ' || (i % 7) FROM generate_series(1, 10000) i;
+SELECT count(*), sum(id), min(val), max(val), count(DISTINCT label) FROM measurements;
+SELECT * FROM measurements WHERE id IN (1, 5000, 10000) ORDER BY id;
+
+-- only the columns the query uses are read
+EXPLAIN (COSTS OFF) SELECT sum(val) FROM measurements WHERE id BETWEEN 2500 AND 2600;
+SELECT sum(val) FROM measurements WHERE id BETWEEN 2500 AND 2600;
+
+-- stripes that can't contain matching rows are skipped
+CREATE FUNCTION explain_stripes(query text) RETURNS SETOF text
+LANGUAGE plpgsql AS
+$$
+DECLARE
+    ln text;
+BEGIN
+    FOR ln IN EXECUTE 'EXPLAIN (ANALYZE, COSTS OFF, TIMING OFF) ' || query
+    LOOP
+        IF ln ~ 'Stripes' THEN
+            RETURN NEXT ln;
+        END IF;
+    END LOOP;
+END;
+$$;
+SELECT explain_stripes('SELECT sum(val) FROM measurements WHERE id BETWEEN 2500 AND 2600');
+SELECT explain_stripes('SELECT count(*) FROM measurements WHERE 9500 < id');
+SELECT explain_stripes('SELECT count(*) FROM measurements WHERE label = ''label 3''');
+
+-- rows inserted by an aborted transaction disappear
+BEGIN;
+INSERT INTO measurements VALUES (20000, 0, 'rolled back');
+SELECT count(*) FROM measurements;
+ROLLBACK;
+SELECT count(*) FROM measurements;
+
+-- columns added later read as nulls in older stripes
+ALTER FOREIGN TABLE measurements ADD COLUMN extra int;
+INSERT INTO measurements VALUES (10001, 0, 'new', 42);
+SELECT id, extra FROM measurements WHERE id >= 9999 ORDER BY id;
+SELECT id, label FROM measurements WHERE extra = 42;
+
+-- only INSERT is supported
+UPDATE measurements SET val = 0;  -- ERROR
+DELETE FROM measurements;  -- ERROR
+
+-- uncompressed storage
+CREATE FOREIGN TABLE plain (a int, b text)
+  SERVER columnar_server OPTIONS (compression 'none');
+INSERT INTO plain SELECT i, repeat('x', i) FROM generate_series(1, 100) i;
+SELECT count(*), sum(length(b)) FROM plain WHERE a > 50;
+
+-- min and max are ignored after the column's collation changes
+CREATE FOREIGN TABLE collated (t text COLLATE "C")
+  SERVER columnar_server OPTIONS (stripe_row_count '1000');
+INSERT INTO collated SELECT lpad(i::text, 5, '0') FROM generate_series(1, 3000) i;
+SELECT explain_stripes('SELECT count(*) FROM collated WHERE t < ''01000''');
+ALTER FOREIGN TABLE collated ALTER COLUMN t TYPE text COLLATE "POSIX";
+SELECT explain_stripes('SELECT count(*) FROM collated WHERE t < ''01000''');
+SELECT count(*) FROM collated WHERE t < '01000';
+
+-- cleanup
+DROP FOREIGN TABLE measurements, plain, collated;
+SELECT columnar_fdw_remove_orphans();
+DROP FUNCTION explain_stripes(text);
+DROP SERVER columnar_server;
+DROP EXTENSION columnar_fdw;
@@ -0,0 +1,56 @@
+CREATE EXTENSION pageinspect;
+
+-- Pruning a page freezes the tuples left on it, if all of them are visible
+-- to everyone.  With fillfactor 10, the HOT updates leave the first page
+-- with less free space than the fillfactor target, so the next scan prunes
+-- it.  Nothing else runs concurrently, so the updates are older than
+-- anyone's snapshot by then.
+CREATE TABLE test_freeze (id int) WITH (fillfactor = 10, autovacuum_enabled = off);
+INSERT INTO test_freeze SELECT generate_series(1, 100);
+UPDATE test_freeze SET id = id + 1;
+SELECT count(*) FROM test_freeze;
+-- 768 is HEAP_XMIN_FROZEN
+SELECT lp_flags, bool_and(t_infomask & 768 = 768) AS frozen
+  FROM heap_page_items(get_raw_page('test_freeze', 0))
+  GROUP BY lp_flags ORDER BY lp_flags;
+
+-- the same without opportunistic_freeze prunes but doesn't freeze
+TRUNCATE test_freeze;
+INSERT INTO test_freeze SELECT generate_series(1, 100);
+UPDATE test_freeze SET id = id + 1;
+SET opportunistic_freeze = off;
+SELECT count(*) FROM test_freeze;
+RESET opportunistic_freeze;
+SELECT lp_flags, bool_and(t_infomask & 768 = 768) AS frozen
+  FROM heap_page_items(get_raw_page('test_freeze', 0))
+  GROUP BY lp_flags ORDER BY lp_flags;
+
+DROP TABLE test_freeze;
+
+-- With few dead tuples, VACUUM can leave them as dead item identifiers
+-- rather than scan the index for them.  The index keeps its entries for
+-- them, and its statistics count them.
+CREATE TABLE test_skip (id int PRIMARY KEY) WITH (autovacuum_enabled = off);
+INSERT INTO test_skip SELECT generate_series(1, 100);
+DELETE FROM test_skip WHERE id = 50;
+SET vacuum_skip_index_fraction = 0.1;
+VACUUM test_skip;
+SELECT lp_flags, count(*)
+  FROM heap_page_items(get_raw_page('test_skip', 0))
+  GROUP BY lp_flags ORDER BY lp_flags;
+SELECT relname, reltuples FROM pg_class
+  WHERE relname IN ('test_skip', 'test_skip_pkey') ORDER BY relname;
+SET enable_seqscan = off;
+SELECT count(*) FROM test_skip WHERE id BETWEEN 49 AND 51;
+RESET enable_seqscan;
+
+-- with the setting back at zero, the next VACUUM removes them
+RESET vacuum_skip_index_fraction;
+VACUUM test_skip;
+SELECT lp_flags, count(*)
+  FROM heap_page_items(get_raw_page('test_skip', 0))
+  GROUP BY lp_flags ORDER BY lp_flags;
+SELECT relname, reltuples FROM pg_class
+  WHERE relname IN ('test_skip', 'test_skip_pkey') ORDER BY relname;
+
+DROP TABLE test_skip;
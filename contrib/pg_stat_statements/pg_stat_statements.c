@@ -33,19 +33,38 @@
  * strings in a temporary external query-texts file.  Offsets into this
  * file are kept in shared memory.
  *
- * Note about locking issues: to create or delete an entry in the shared
- * hashtable, one must hold pgss->lock exclusively.  Modifying any field
- * in an entry except the counters requires the same.  To look up an entry,
- * one must hold the lock shared.  To read or update the counters within
- * an entry, one must hold the lock shared or exclusive (so the entry doesn't
- * disappear!) and also take the entry's mutex spinlock.
+ * Note about locking issues: the shared hashtable is partitioned, and each
+ * partition has its own LWLock, so that backends executing different
+ * statements don't contend for the same lock.  To create or delete an entry
+ * in the hashtable, one must hold the lock of the entry's partition
+ * exclusively.  Modifying any field in an entry except the counters requires
+ * the same.  To look up an entry, one must hold the partition lock shared.
+ * To read or update the counters within an entry, one must hold the
+ * partition lock shared or exclusive (so the entry doesn't disappear!) and
+ * also take the entry's mutex spinlock.  Operations on the table as a whole,
+ * such as discarding the least-used entries to make room, need the locks of
+ * all partitions, which are always acquired in partition order; we say
+ * that the whole table is locked.
  * The shared state variable pgss->extent (the next free spot in the external
  * query-text file) should be accessed only while holding either the
- * pgss->mutex spinlock, or exclusive lock on pgss->lock.  We use the mutex to
- * allow reserving file space while holding only shared lock on pgss->lock.
- * Rewriting the entire external query-text file, eg for garbage collection,
- * requires holding pgss->lock exclusively; this allows individual entries
- * in the file to be read or written while holding only shared lock.
+ * pgss->mutex spinlock, or exclusive lock on the whole table.  We use the
+ * mutex to allow reserving file space while holding only a shared partition
+ * lock.  Rewriting the entire external query-text file, eg for garbage
+ * collection, requires holding the whole table exclusively; this allows
+ * individual entries in the file to be read or written while holding any
+ * one partition lock.
+ *
+ * Planning time is counted separately from execution time, if
+ * pg_stat_statements.track_planning is on.
+ *
+ * Optionally, a sample of executions can be run with per-node instrumentation,
+ * as with EXPLAIN ANALYZE, and the rows, time and buffer usage of each plan
+ * node are then totalled in a second hashtable, keyed by the statement, a
+ * fingerprint of the plan's shape and the node's plan_node_id.  This "plan
+ * profile" shows which node of a hot statement is expensive without having
+ * to rerun it.  The plan profile hashtable is protected by pgss->plan_lock
+ * in the same way as the main hashtable is by its partition locks; when both
+ * are needed, the partition locks are taken first.
  *
  *
  * Copyright (c) 2008-2016, PostgreSQL Global Development Group
@@ -66,6 +85,8 @@
 #include "funcapi.h"
 #include "mb/pg_wchar.h"
 #include "miscadmin.h"
+#include "nodes/nodeFuncs.h"
+#include "optimizer/planner.h"
 #include "parser/analyze.h"
 #include "parser/parsetree.h"
 #include "parser/scanner.h"
@@ -93,7 +114,7 @@ PG_MODULE_MAGIC;
 #define PGSS_TEXT_FILE	PG_STAT_TMP_DIR "/pgss_query_texts.stat"
 
 /* Magic number identifying the stats file format */
-static const uint32 PGSS_FILE_HEADER = 0x20140125;
+static const uint32 PGSS_FILE_HEADER = 0x20160512;
 
 /* PostgreSQL major version number, changes in which invalidate all entries */
 static const uint32 PGSS_PG_MAJOR_VERSION = PG_VERSION_NUM / 100;
@@ -109,6 +130,9 @@ static const uint32 PGSS_PG_MAJOR_VERSION = PG_VERSION_NUM / 100;
 
 #define JUMBLE_SIZE				1024	/* query serialization buffer size */
 
+/* Number of partitions of the shared hashtable, must be a power of 2 */
+#define PGSS_NUM_PARTITIONS		16
+
 /*
  * Extension version number, for supporting older extension versions' objects
  */
@@ -117,7 +141,8 @@ typedef enum pgssVersion
 	PGSS_V1_0 = 0,
 	PGSS_V1_1,
 	PGSS_V1_2,
-	PGSS_V1_3
+	PGSS_V1_3,
+	PGSS_V1_4
 } pgssVersion;
 
 /*
@@ -136,6 +161,13 @@ typedef struct pgssHashKey
  */
 typedef struct Counters
 {
+	int64		plans;			/* # of times planned */
+	double		total_plan_time;	/* total planning time, in msec */
+	double		min_plan_time;	/* minimum planning time in msec */
+	double		max_plan_time;	/* maximum planning time in msec */
+	double		mean_plan_time; /* mean planning time in msec */
+	double		sum_var_plan_time;		/* sum of variances in planning time
+										 * in msec */
 	int64		calls;			/* # of times executed */
 	double		total_time;		/* total execution time, in msec */
 	double		min_time;		/* minimim execution time in msec */
@@ -175,12 +207,62 @@ typedef struct pgssEntry
 	slock_t		mutex;			/* protects the counters only */
 } pgssEntry;
 
+/*
+ * Hashtable key of a plan node's entry in the plan profile.  A statement can
+ * be run with different plans, such as custom and generic plans, or plans
+ * made before and after its tables changed.  Each of those gets a profile of
+ * its own, identified by planid, a hash of the plan's shape: the type,
+ * position and scanned relation or index of every node.
+ */
+typedef struct pgssPlanHashKey
+{
+	Oid			userid;			/* user OID */
+	Oid			dbid;			/* database OID */
+	uint32		queryid;		/* query identifier */
+	uint32		planid;			/* plan shape identifier */
+	int			plan_node_id;	/* Plan.plan_node_id */
+	NodeTag		node_tag;		/* type of plan node */
+} pgssPlanHashKey;
+
+/*
+ * The stats counters kept within pgssPlanEntry.  As in EXPLAIN ANALYZE, the
+ * times and buffer counts of a node include those of its children.
+ */
+typedef struct PlanCounters
+{
+	int64		calls;			/* # of sampled executions of the statement */
+	double		loops;			/* # of times the node was run */
+	double		rows;			/* total # of rows returned */
+	double		startup_time;	/* total time until first row, in msec */
+	double		total_time;		/* total time spent in the node, in msec */
+	int64		shared_blks_hit;	/* # of shared buffer hits */
+	int64		shared_blks_read;		/* # of shared disk blocks read */
+	int64		local_blks_hit; /* # of local buffer hits */
+	int64		local_blks_read;	/* # of local disk blocks read */
+	int64		temp_blks_read; /* # of temp blocks read */
+	int64		temp_blks_written;		/* # of temp blocks written */
+	double		blk_read_time;	/* time spent reading, in msec */
+	double		blk_write_time; /* time spent writing, in msec */
+} PlanCounters;
+
+/*
+ * Statistics per plan node of a statement
+ */
+typedef struct pgssPlanEntry
+{
+	pgssPlanHashKey key;		/* hash key of entry - MUST BE FIRST */
+	int			parent_node_id; /* plan_node_id of parent node, or -1 */
+	PlanCounters counters;		/* the statistics for this node */
+	slock_t		mutex;			/* protects the counters only */
+} pgssPlanEntry;
+
 /*
  * Global shared state
  */
 typedef struct pgssSharedState
 {
-	LWLock	   *lock;			/* protects hashtable search/modification */
+	LWLockPadded *locks;		/* partition locks of the hashtable */
+	LWLock	   *plan_lock;		/* protects the plan profile hashtable */
 	double		cur_median_usage;		/* current median usage in hashtable */
 	Size		mean_query_len; /* current mean entry text length */
 	slock_t		mutex;			/* protects following fields only: */
@@ -220,6 +302,44 @@ typedef struct pgssJumbleState
 	int			clocations_count;
 } pgssJumbleState;
 
+/*
+ * Counters of one plan node of the statement being profiled, collected from
+ * its instrumentation before they're added to the shared hashtable
+ */
+typedef struct pgssPlanNodeSample
+{
+	int			plan_node_id;	/* Plan.plan_node_id */
+	int			parent_node_id; /* plan_node_id of parent node, or -1 */
+	NodeTag		node_tag;		/* type of plan node */
+	bool		stored;			/* already added to the hashtable? */
+	PlanCounters counters;
+} pgssPlanNodeSample;
+
+/*
+ * What the plan shape identifier is computed from, for each plan node
+ */
+typedef struct pgssPlanShapeItem
+{
+	NodeTag		node_tag;		/* type of plan node */
+	int			plan_node_id;	/* Plan.plan_node_id */
+	int			parent_node_id; /* plan_node_id of parent node, or -1 */
+	Oid			relid;			/* OID of scanned relation, if any */
+	Oid			indexid;		/* OID of scanned index, if any */
+} pgssPlanShapeItem;
+
+/*
+ * Working state for collecting the plan node samples of a statement
+ */
+typedef struct pgssPlanWalkState
+{
+	pgssPlanNodeSample *samples;	/* array of samples */
+	int			nsamples;		/* number of valid entries in samples[] */
+	int			maxsamples;		/* allocated length of samples[] */
+	int			parent_node_id; /* plan_node_id of node being walked */
+	List	   *rtable;			/* range table of the statement */
+	StringInfoData shape;		/* pgssPlanShapeItems of all nodes */
+} pgssPlanWalkState;
+
 /*---- Local variables ----*/
 
 /* Current nesting depth of ExecutorRun+ProcessUtility calls */
@@ -228,6 +348,7 @@ static int	nested_level = 0;
 /* Saved hook values in case of unload */
 static shmem_startup_hook_type prev_shmem_startup_hook = NULL;
 static post_parse_analyze_hook_type prev_post_parse_analyze_hook = NULL;
+static planner_hook_type prev_planner_hook = NULL;
 static ExecutorStart_hook_type prev_ExecutorStart = NULL;
 static ExecutorRun_hook_type prev_ExecutorRun = NULL;
 static ExecutorFinish_hook_type prev_ExecutorFinish = NULL;
@@ -237,6 +358,7 @@ static ProcessUtility_hook_type prev_ProcessUtility = NULL;
 /* Links to shared memory state */
 static pgssSharedState *pgss = NULL;
 static HTAB *pgss_hash = NULL;
+static HTAB *pgss_plan_hash = NULL;
 
 /*---- GUC variables ----*/
 
@@ -259,12 +381,20 @@ static int	pgss_max;			/* max # statements to track */
 static int	pgss_track;			/* tracking level */
 static bool pgss_track_utility; /* whether to track utility commands */
 static bool pgss_save;			/* whether to save stats across shutdown */
+static bool pgss_track_planning;	/* whether to track planning time */
+static int	pgss_plan_max;		/* max # plan nodes to profile */
+static double pgss_plan_sample_rate;	/* fraction of executions to profile */
 
 
 #define pgss_enabled() \
 	(pgss_track == PGSS_TRACK_ALL || \
 	(pgss_track == PGSS_TRACK_TOP && nested_level == 0))
 
+#define PGSS_PARTITION_LOCK_BY_INDEX(i) \
+	(&pgss->locks[(i)].lock)
+#define PGSS_PARTITION_LOCK(hashcode) \
+	PGSS_PARTITION_LOCK_BY_INDEX((hashcode) % PGSS_NUM_PARTITIONS)
+
 #define record_gc_qtexts() \
 	do { \
 		volatile pgssSharedState *s = (volatile pgssSharedState *) pgss; \
@@ -281,11 +411,15 @@ void		_PG_fini(void);
 PG_FUNCTION_INFO_V1(pg_stat_statements_reset);
 PG_FUNCTION_INFO_V1(pg_stat_statements_1_2);
 PG_FUNCTION_INFO_V1(pg_stat_statements_1_3);
+PG_FUNCTION_INFO_V1(pg_stat_statements_1_4);
 PG_FUNCTION_INFO_V1(pg_stat_statements);
+PG_FUNCTION_INFO_V1(pg_stat_statements_plan_profile);
 
 static void pgss_shmem_startup(void);
 static void pgss_shmem_shutdown(int code, Datum arg);
 static void pgss_post_parse_analyze(ParseState *pstate, Query *query);
+static PlannedStmt *pgss_planner(Query *parse, int cursorOptions,
+			 ParamListInfo boundParams);
 static void pgss_ExecutorStart(QueryDesc *queryDesc, int eflags);
 static void pgss_ExecutorRun(QueryDesc *queryDesc,
 				 ScanDirection direction,
@@ -306,8 +440,10 @@ static void pg_stat_statements_internal(FunctionCallInfo fcinfo,
 							pgssVersion api_version,
 							bool showtext);
 static Size pgss_memsize(void);
-static pgssEntry *entry_alloc(pgssHashKey *key, Size query_offset, int query_len,
-			int encoding, bool sticky);
+static void pgss_store_planning(uint32 queryId, double plan_time);
+static pgssEntry *entry_alloc(pgssHashKey *key, uint32 hashcode,
+			Size query_offset, int query_len, int encoding, bool sticky,
+			bool all_locked);
 static void entry_dealloc(void);
 static bool qtext_store(const char *query, int query_len,
 			Size *query_offset, int *gc_count);
@@ -317,6 +453,13 @@ static char *qtext_fetch(Size query_offset, int query_len,
 static bool need_gc_qtexts(void);
 static void gc_qtexts(void);
 static void entry_reset(void);
+static void pgss_lock_all(LWLockMode mode);
+static void pgss_unlock_all(void);
+static void pgss_store_plan_profile(QueryDesc *queryDesc);
+static bool pgss_plan_walker(PlanState *planstate, pgssPlanWalkState *state);
+static void pgss_plan_entry_add(pgssPlanEntry *entry, PlanCounters *counters);
+static void plan_entry_purge(void);
+static const char *plan_node_name(NodeTag tag);
 static void AppendJumble(pgssJumbleState *jstate,
 			 const unsigned char *item, Size size);
 static void JumbleQuery(pgssJumbleState *jstate, Query *query);
@@ -396,6 +539,43 @@ _PG_init(void)
 							 NULL,
 							 NULL);
 
+	DefineCustomBoolVariable("pg_stat_statements.track_planning",
+		   "Selects whether planning time is tracked by pg_stat_statements.",
+							 NULL,
+							 &pgss_track_planning,
+							 false,
+							 PGC_SUSET,
+							 0,
+							 NULL,
+							 NULL,
+							 NULL);
+
+	DefineCustomIntVariable("pg_stat_statements.plan_max",
+							"Sets the maximum number of plan nodes profiled by pg_stat_statements.",
+							NULL,
+							&pgss_plan_max,
+							10000,
+							100,
+							INT_MAX,
+							PGC_POSTMASTER,
+							0,
+							NULL,
+							NULL,
+							NULL);
+
+	DefineCustomRealVariable("pg_stat_statements.plan_sample_rate",
+							 "Fraction of statement executions whose plan nodes are profiled.",
+							 NULL,
+							 &pgss_plan_sample_rate,
+							 0.0,
+							 0.0,
+							 1.0,
+							 PGC_SUSET,
+							 0,
+							 NULL,
+							 NULL,
+							 NULL);
+
 	EmitWarningsOnPlaceholders("pg_stat_statements");
 
 	/*
@@ -404,7 +584,7 @@ _PG_init(void)
 	 * resources in pgss_shmem_startup().
 	 */
 	RequestAddinShmemSpace(pgss_memsize());
-	RequestNamedLWLockTranche("pg_stat_statements", 1);
+	RequestNamedLWLockTranche("pg_stat_statements", PGSS_NUM_PARTITIONS + 1);
 
 	/*
 	 * Install hooks.
@@ -413,6 +593,8 @@ _PG_init(void)
 	shmem_startup_hook = pgss_shmem_startup;
 	prev_post_parse_analyze_hook = post_parse_analyze_hook;
 	post_parse_analyze_hook = pgss_post_parse_analyze;
+	prev_planner_hook = planner_hook;
+	planner_hook = pgss_planner;
 	prev_ExecutorStart = ExecutorStart_hook;
 	ExecutorStart_hook = pgss_ExecutorStart;
 	prev_ExecutorRun = ExecutorRun_hook;
@@ -434,6 +616,7 @@ _PG_fini(void)
 	/* Uninstall hooks. */
 	shmem_startup_hook = prev_shmem_startup_hook;
 	post_parse_analyze_hook = prev_post_parse_analyze_hook;
+	planner_hook = prev_planner_hook;
 	ExecutorStart_hook = prev_ExecutorStart;
 	ExecutorRun_hook = prev_ExecutorRun;
 	ExecutorFinish_hook = prev_ExecutorFinish;
@@ -467,6 +650,7 @@ pgss_shmem_startup(void)
 	/* reset in case this is a restart within the postmaster */
 	pgss = NULL;
 	pgss_hash = NULL;
+	pgss_plan_hash = NULL;
 
 	/*
 	 * Create or attach to the shared memory state, including hash table
@@ -480,7 +664,10 @@ pgss_shmem_startup(void)
 	if (!found)
 	{
 		/* First time through ... */
-		pgss->lock = &(GetNamedLWLockTranche("pg_stat_statements"))->lock;
+		LWLockPadded *locks = GetNamedLWLockTranche("pg_stat_statements");
+
+		pgss->locks = locks;
+		pgss->plan_lock = &locks[PGSS_NUM_PARTITIONS].lock;
 		pgss->cur_median_usage = ASSUMED_MEDIAN_INIT;
 		pgss->mean_query_len = ASSUMED_LENGTH_INIT;
 		SpinLockInit(&pgss->mutex);
@@ -494,10 +681,26 @@ pgss_shmem_startup(void)
 	info.entrysize = sizeof(pgssEntry);
 	info.hash = pgss_hash_fn;
 	info.match = pgss_match_fn;
+	info.num_partitions = PGSS_NUM_PARTITIONS;
+
+	/*
+	 * Backends holding only their partition's lock may find the table one
+	 * short of pgss_max at the same time, so the size is also enforced by
+	 * the hashtable itself: entry_alloc gets NULL once it is full.
+	 */
 	pgss_hash = ShmemInitHash("pg_stat_statements hash",
 							  pgss_max, pgss_max,
 							  &info,
-							  HASH_ELEM | HASH_FUNCTION | HASH_COMPARE);
+							  HASH_ELEM | HASH_FUNCTION | HASH_COMPARE |
+							  HASH_PARTITION | HASH_FIXED_SIZE);
+
+	memset(&info, 0, sizeof(info));
+	info.keysize = sizeof(pgssPlanHashKey);
+	info.entrysize = sizeof(pgssPlanEntry);
+	pgss_plan_hash = ShmemInitHash("pg_stat_statements plan hash",
+								   pgss_plan_max, pgss_plan_max,
+								   &info,
+								   HASH_ELEM | HASH_BLOBS);
 
 	LWLockRelease(AddinShmemInitLock);
 
@@ -600,9 +803,10 @@ pgss_shmem_startup(void)
 		pgss->extent += temp.query_len + 1;
 
 		/* make the hashtable entry (discards old entries if too many) */
-		entry = entry_alloc(&temp.key, query_offset, temp.query_len,
+		entry = entry_alloc(&temp.key, get_hash_value(pgss_hash, &temp.key),
+							query_offset, temp.query_len,
 							temp.encoding,
-							false);
+							false, true);
 
 		/* copy in the actual stats */
 		entry->counters = temp.counters;
@@ -828,12 +1032,74 @@ pgss_post_parse_analyze(ParseState *pstate, Query *query)
 				   &jstate);
 }
 
+/*
+ * Planner hook: track planning time if needed
+ */
+static PlannedStmt *
+pgss_planner(Query *parse, int cursorOptions, ParamListInfo boundParams)
+{
+	PlannedStmt *result;
+
+	if (pgss_track_planning && pgss_enabled() && parse->queryId != 0)
+	{
+		instr_time	start;
+		instr_time	duration;
+
+		INSTR_TIME_SET_CURRENT(start);
+
+		/*
+		 * Statements the planner runs itself, for instance to inline SQL
+		 * functions, are nested ones.
+		 */
+		nested_level++;
+		PG_TRY();
+		{
+			if (prev_planner_hook)
+				result = prev_planner_hook(parse, cursorOptions, boundParams);
+			else
+				result = standard_planner(parse, cursorOptions, boundParams);
+			nested_level--;
+		}
+		PG_CATCH();
+		{
+			nested_level--;
+			PG_RE_THROW();
+		}
+		PG_END_TRY();
+
+		INSTR_TIME_SET_CURRENT(duration);
+		INSTR_TIME_SUBTRACT(duration, start);
+
+		pgss_store_planning(parse->queryId, INSTR_TIME_GET_MILLISEC(duration));
+	}
+	else
+	{
+		if (prev_planner_hook)
+			result = prev_planner_hook(parse, cursorOptions, boundParams);
+		else
+			result = standard_planner(parse, cursorOptions, boundParams);
+	}
+
+	return result;
+}
+
 /*
  * ExecutorStart hook: start up tracking if needed
  */
 static void
 pgss_ExecutorStart(QueryDesc *queryDesc, int eflags)
 {
+	/*
+	 * If the plan profile is enabled, randomly choose executions to run with
+	 * per-node instrumentation.  This has to be requested before the plan
+	 * state tree is built.
+	 */
+	if (pgss_plan_sample_rate > 0 &&
+		pgss_enabled() && queryDesc->plannedstmt->queryId != 0 &&
+		(eflags & EXEC_FLAG_EXPLAIN_ONLY) == 0 &&
+		random() < pgss_plan_sample_rate * MAX_RANDOM_VALUE)
+		queryDesc->instrument_options |= INSTRUMENT_TIMER | INSTRUMENT_BUFFERS;
+
 	if (prev_ExecutorStart)
 		prev_ExecutorStart(queryDesc, eflags);
 	else
@@ -930,6 +1196,15 @@ pgss_ExecutorEnd(QueryDesc *queryDesc)
 				   queryDesc->estate->es_processed,
 				   &queryDesc->totaltime->bufusage,
 				   NULL);
+
+		/*
+		 * If per-node timing was collected, whether because we sampled this
+		 * execution or because some other module asked for it, add it to the
+		 * plan profile.
+		 */
+		if (pgss_plan_sample_rate > 0 &&
+			(queryDesc->instrument_options & INSTRUMENT_TIMER) != 0)
+			pgss_store_plan_profile(queryDesc);
 	}
 
 	if (prev_ExecutorEnd)
@@ -1109,6 +1384,9 @@ pgss_store(const char *query, uint32 queryId,
 		   pgssJumbleState *jstate)
 {
 	pgssHashKey key;
+	uint32		hashcode;
+	LWLock	   *partition_lock;
+	bool		all_locked = false;
 	pgssEntry  *entry;
 	char	   *norm_query = NULL;
 	int			encoding = GetDatabaseEncoding();
@@ -1127,10 +1405,15 @@ pgss_store(const char *query, uint32 queryId,
 	key.dbid = MyDatabaseId;
 	key.queryid = queryId;
 
+	hashcode = get_hash_value(pgss_hash, &key);
+	partition_lock = PGSS_PARTITION_LOCK(hashcode);
+
 	/* Lookup the hash table entry with shared lock. */
-	LWLockAcquire(pgss->lock, LW_SHARED);
+	LWLockAcquire(partition_lock, LW_SHARED);
 
-	entry = (pgssEntry *) hash_search(pgss_hash, &key, HASH_FIND, NULL);
+	entry = (pgssEntry *) hash_search_with_hash_value(pgss_hash, &key,
+													  hashcode,
+													  HASH_FIND, NULL);
 
 	/* Create new entry, if not present */
 	if (!entry)
@@ -1149,11 +1432,11 @@ pgss_store(const char *query, uint32 queryId,
 		 */
 		if (jstate)
 		{
-			LWLockRelease(pgss->lock);
+			LWLockRelease(partition_lock);
 			norm_query = generate_normalized_query(jstate, query,
 												   &query_len,
 												   encoding);
-			LWLockAcquire(pgss->lock, LW_SHARED);
+			LWLockAcquire(partition_lock, LW_SHARED);
 		}
 
 		/* Append new query text to file with only shared lock held */
@@ -1167,9 +1450,20 @@ pgss_store(const char *query, uint32 queryId,
 		 */
 		do_gc = need_gc_qtexts();
 
-		/* Need exclusive lock to make a new hashtable entry - promote */
-		LWLockRelease(pgss->lock);
-		LWLockAcquire(pgss->lock, LW_EXCLUSIVE);
+		/*
+		 * Need exclusive lock to make a new hashtable entry - promote.  The
+		 * partition's lock is enough, unless we have to make room in the
+		 * hashtable or garbage collect, which requires locking the whole
+		 * table.
+		 */
+		LWLockRelease(partition_lock);
+		if (do_gc || hash_get_num_entries(pgss_hash) >= pgss_max)
+		{
+			pgss_lock_all(LW_EXCLUSIVE);
+			all_locked = true;
+		}
+		else
+			LWLockAcquire(partition_lock, LW_EXCLUSIVE);
 
 		/*
 		 * A garbage collection may have occurred while we weren't holding the
@@ -1187,8 +1481,16 @@ pgss_store(const char *query, uint32 queryId,
 			goto done;
 
 		/* OK to create a new hashtable entry */
-		entry = entry_alloc(&key, query_offset, query_len, encoding,
-							jstate != NULL);
+		entry = entry_alloc(&key, hashcode, query_offset, query_len, encoding,
+							jstate != NULL, all_locked);
+
+		/*
+		 * If the hashtable filled up since we looked, don't bother to lock it
+		 * all and retry; just forget about this execution.  The next one will
+		 * make room.
+		 */
+		if (!entry)
+			goto done;
 
 		/* If needed, perform garbage collection while exclusive lock held */
 		if (do_gc)
@@ -1256,13 +1558,324 @@ pgss_store(const char *query, uint32 queryId,
 	}
 
 done:
-	LWLockRelease(pgss->lock);
+	if (all_locked)
+		pgss_unlock_all();
+	else
+		LWLockRelease(partition_lock);
 
 	/* We postpone this clean-up until we're out of the lock */
 	if (norm_query)
 		pfree(norm_query);
 }
 
+/*
+ * Add the planning time of a statement to its entry.
+ *
+ * The query text isn't available at planning time, so we can't create an
+ * entry here.  Planning is therefore counted only once the statement has an
+ * entry: from its first planning on if it contains constants, since parse
+ * analysis then makes the entry, and otherwise from the first planning after
+ * its first execution.
+ */
+static void
+pgss_store_planning(uint32 queryId, double plan_time)
+{
+	pgssHashKey key;
+	uint32		hashcode;
+	LWLock	   *partition_lock;
+	pgssEntry  *entry;
+
+	/* Safety check... */
+	if (!pgss || !pgss_hash)
+		return;
+
+	key.userid = GetUserId();
+	key.dbid = MyDatabaseId;
+	key.queryid = queryId;
+
+	hashcode = get_hash_value(pgss_hash, &key);
+	partition_lock = PGSS_PARTITION_LOCK(hashcode);
+
+	LWLockAcquire(partition_lock, LW_SHARED);
+
+	entry = (pgssEntry *) hash_search_with_hash_value(pgss_hash, &key,
+													  hashcode,
+													  HASH_FIND, NULL);
+	if (entry)
+	{
+		volatile pgssEntry *e = (volatile pgssEntry *) entry;
+
+		SpinLockAcquire(&e->mutex);
+
+		e->counters.plans += 1;
+		e->counters.total_plan_time += plan_time;
+		if (e->counters.plans == 1)
+		{
+			e->counters.min_plan_time = plan_time;
+			e->counters.max_plan_time = plan_time;
+			e->counters.mean_plan_time = plan_time;
+		}
+		else
+		{
+			/* Welford's method, as in pgss_store */
+			double		old_mean = e->counters.mean_plan_time;
+
+			e->counters.mean_plan_time +=
+				(plan_time - old_mean) / e->counters.plans;
+			e->counters.sum_var_plan_time +=
+				(plan_time - old_mean) * (plan_time - e->counters.mean_plan_time);
+
+			if (e->counters.min_plan_time > plan_time)
+				e->counters.min_plan_time = plan_time;
+			if (e->counters.max_plan_time < plan_time)
+				e->counters.max_plan_time = plan_time;
+		}
+
+		SpinLockRelease(&e->mutex);
+	}
+
+	LWLockRelease(partition_lock);
+}
+
+/*
+ * Add the per-node instrumentation of a just-finished execution to the plan
+ * profile.
+ */
+static void
+pgss_store_plan_profile(QueryDesc *queryDesc)
+{
+	pgssPlanWalkState state;
+	pgssPlanHashKey key;
+	pgssPlanEntry *entry;
+	int			nmissing = 0;
+	int			i;
+
+	/* Safety check... */
+	if (!pgss || !pgss_plan_hash || queryDesc->planstate == NULL)
+		return;
+
+	/* Collect the counters of all nodes before touching the hashtable */
+	state.maxsamples = 16;
+	state.samples = (pgssPlanNodeSample *)
+		palloc(state.maxsamples * sizeof(pgssPlanNodeSample));
+	state.nsamples = 0;
+	state.parent_node_id = -1;
+	state.rtable = queryDesc->plannedstmt->rtable;
+	initStringInfo(&state.shape);
+	pgss_plan_walker(queryDesc->planstate, &state);
+
+	if (state.nsamples == 0)
+	{
+		pfree(state.samples);
+		pfree(state.shape.data);
+		return;
+	}
+
+	memset(&key, 0, sizeof(key));
+	key.userid = GetUserId();
+	key.dbid = MyDatabaseId;
+	key.queryid = queryDesc->plannedstmt->queryId;
+	key.planid = DatumGetUInt32(hash_any((unsigned char *) state.shape.data,
+										 state.shape.len));
+
+	/* Normally the entries exist already and a shared lock is enough */
+	LWLockAcquire(pgss->plan_lock, LW_SHARED);
+
+	for (i = 0; i < state.nsamples; i++)
+	{
+		pgssPlanNodeSample *sample = &state.samples[i];
+
+		key.plan_node_id = sample->plan_node_id;
+		key.node_tag = sample->node_tag;
+		entry = (pgssPlanEntry *) hash_search(pgss_plan_hash, &key,
+											  HASH_FIND, NULL);
+		if (entry)
+		{
+			pgss_plan_entry_add(entry, &sample->counters);
+			sample->stored = true;
+		}
+		else
+			nmissing++;
+	}
+
+	LWLockRelease(pgss->plan_lock);
+
+	if (nmissing > 0)
+	{
+		LWLockAcquire(pgss->plan_lock, LW_EXCLUSIVE);
+
+		for (i = 0; i < state.nsamples; i++)
+		{
+			pgssPlanNodeSample *sample = &state.samples[i];
+			bool		found;
+
+			if (sample->stored)
+				continue;
+
+			key.plan_node_id = sample->plan_node_id;
+			key.node_tag = sample->node_tag;
+
+			/*
+			 * Rather than evicting anything, just stop adding nodes once the
+			 * hashtable is full; entries go away together with their
+			 * statement's entry in the main hashtable.
+			 */
+			entry = (pgssPlanEntry *) hash_search(pgss_plan_hash, &key,
+												  HASH_FIND, NULL);
+			if (!entry)
+			{
+				if (hash_get_num_entries(pgss_plan_hash) >= pgss_plan_max)
+					continue;
+
+				entry = (pgssPlanEntry *) hash_search(pgss_plan_hash, &key,
+													  HASH_ENTER, &found);
+				Assert(!found);
+				entry->parent_node_id = sample->parent_node_id;
+				memset(&entry->counters, 0, sizeof(PlanCounters));
+				SpinLockInit(&entry->mutex);
+			}
+
+			pgss_plan_entry_add(entry, &sample->counters);
+		}
+
+		LWLockRelease(pgss->plan_lock);
+	}
+
+	pfree(state.samples);
+	pfree(state.shape.data);
+}
+
+/*
+ * planstate_tree_walker callback collecting the counters of each node
+ */
+static bool
+pgss_plan_walker(PlanState *planstate, pgssPlanWalkState *state)
+{
+	Instrumentation *instr = planstate->instrument;
+	Plan	   *plan = planstate->plan;
+	int			save_parent_node_id = state->parent_node_id;
+	pgssPlanShapeItem item;
+
+	/* Every node counts towards the plan shape, whether it was run or not */
+	memset(&item, 0, sizeof(item));
+	item.node_tag = nodeTag(plan);
+	item.plan_node_id = plan->plan_node_id;
+	item.parent_node_id = state->parent_node_id;
+	switch (nodeTag(plan))
+	{
+		case T_IndexScan:
+			item.indexid = ((IndexScan *) plan)->indexid;
+			break;
+		case T_IndexOnlyScan:
+			item.indexid = ((IndexOnlyScan *) plan)->indexid;
+			break;
+		case T_BitmapIndexScan:
+			item.indexid = ((BitmapIndexScan *) plan)->indexid;
+			break;
+		default:
+			break;
+	}
+	switch (nodeTag(plan))
+	{
+		case T_SeqScan:
+		case T_SampleScan:
+		case T_IndexScan:
+		case T_IndexOnlyScan:
+		case T_BitmapHeapScan:
+		case T_TidScan:
+		case T_ForeignScan:
+			if (((Scan *) plan)->scanrelid > 0)
+				item.relid = rt_fetch(((Scan *) plan)->scanrelid,
+									  state->rtable)->relid;
+			break;
+		default:
+			break;
+	}
+	appendBinaryStringInfo(&state->shape, (char *) &item, sizeof(item));
+
+	if (instr)
+	{
+		/* Finish the node's current loop, as EXPLAIN ANALYZE does */
+		InstrEndLoop(instr);
+
+		/* Nodes that were never run are of no interest */
+		if (instr->nloops > 0)
+		{
+			pgssPlanNodeSample *sample;
+			PlanCounters *c;
+
+			if (state->nsamples >= state->maxsamples)
+			{
+				state->maxsamples *= 2;
+				state->samples = (pgssPlanNodeSample *)
+					repalloc(state->samples,
+							 state->maxsamples * sizeof(pgssPlanNodeSample));
+			}
+
+			sample = &state->samples[state->nsamples++];
+			sample->plan_node_id = planstate->plan->plan_node_id;
+			sample->parent_node_id = state->parent_node_id;
+			sample->node_tag = nodeTag(planstate->plan);
+			sample->stored = false;
+
+			c = &sample->counters;
+			c->calls = 1;
+			c->loops = instr->nloops;
+			c->rows = instr->ntuples;
+			c->startup_time = instr->startup * 1000.0;	/* convert to msec */
+			c->total_time = instr->total * 1000.0;
+			c->shared_blks_hit = instr->bufusage.shared_blks_hit;
+			c->shared_blks_read = instr->bufusage.shared_blks_read;
+			c->local_blks_hit = instr->bufusage.local_blks_hit;
+			c->local_blks_read = instr->bufusage.local_blks_read;
+			c->temp_blks_read = instr->bufusage.temp_blks_read;
+			c->temp_blks_written = instr->bufusage.temp_blks_written;
+			c->blk_read_time =
+				INSTR_TIME_GET_MILLISEC(instr->bufusage.blk_read_time);
+			c->blk_write_time =
+				INSTR_TIME_GET_MILLISEC(instr->bufusage.blk_write_time);
+		}
+	}
+
+	state->parent_node_id = planstate->plan->plan_node_id;
+	planstate_tree_walker(planstate, pgss_plan_walker, state);
+	state->parent_node_id = save_parent_node_id;
+
+	return false;
+}
+
+/*
+ * Add one sample's counters to a plan profile entry.
+ * caller must hold pgss->plan_lock
+ */
+static void
+pgss_plan_entry_add(pgssPlanEntry *entry, PlanCounters *counters)
+{
+	/*
+	 * Grab the spinlock while updating the counters (see comment about
+	 * locking rules at the head of the file)
+	 */
+	volatile pgssPlanEntry *e = (volatile pgssPlanEntry *) entry;
+
+	SpinLockAcquire(&e->mutex);
+
+	e->counters.calls += counters->calls;
+	e->counters.loops += counters->loops;
+	e->counters.rows += counters->rows;
+	e->counters.startup_time += counters->startup_time;
+	e->counters.total_time += counters->total_time;
+	e->counters.shared_blks_hit += counters->shared_blks_hit;
+	e->counters.shared_blks_read += counters->shared_blks_read;
+	e->counters.local_blks_hit += counters->local_blks_hit;
+	e->counters.local_blks_read += counters->local_blks_read;
+	e->counters.temp_blks_read += counters->temp_blks_read;
+	e->counters.temp_blks_written += counters->temp_blks_written;
+	e->counters.blk_read_time += counters->blk_read_time;
+	e->counters.blk_write_time += counters->blk_write_time;
+
+	SpinLockRelease(&e->mutex);
+}
+
 /*
  * Reset all statement statistics.
  */
@@ -1282,7 +1895,8 @@ pg_stat_statements_reset(PG_FUNCTION_ARGS)
 #define PG_STAT_STATEMENTS_COLS_V1_1	18
 #define PG_STAT_STATEMENTS_COLS_V1_2	19
 #define PG_STAT_STATEMENTS_COLS_V1_3	23
-#define PG_STAT_STATEMENTS_COLS			23		/* maximum of above */
+#define PG_STAT_STATEMENTS_COLS_V1_4	29
+#define PG_STAT_STATEMENTS_COLS			29		/* maximum of above */
 
 /*
  * Retrieve statement statistics.
@@ -1294,6 +1908,16 @@ pg_stat_statements_reset(PG_FUNCTION_ARGS)
  * expected API version is identified by embedding it in the C name of the
  * function.  Unfortunately we weren't bright enough to do that for 1.1.
  */
+Datum
+pg_stat_statements_1_4(PG_FUNCTION_ARGS)
+{
+	bool		showtext = PG_GETARG_BOOL(0);
+
+	pg_stat_statements_internal(fcinfo, PGSS_V1_4, showtext);
+
+	return (Datum) 0;
+}
+
 Datum
 pg_stat_statements_1_3(PG_FUNCTION_ARGS)
 {
@@ -1397,6 +2021,10 @@ pg_stat_statements_internal(FunctionCallInfo fcinfo,
 			if (api_version != PGSS_V1_3)
 				elog(ERROR, "incorrect number of output arguments");
 			break;
+		case PG_STAT_STATEMENTS_COLS_V1_4:
+			if (api_version != PGSS_V1_4)
+				elog(ERROR, "incorrect number of output arguments");
+			break;
 		default:
 			elog(ERROR, "incorrect number of output arguments");
 	}
@@ -1410,7 +2038,7 @@ pg_stat_statements_internal(FunctionCallInfo fcinfo,
 
 	/*
 	 * We'd like to load the query text file (if needed) while not holding any
-	 * lock on pgss->lock.  In the worst case we'll have to do this again
+	 * lock on the hashtable.  In the worst case we'll have to do this again
 	 * after we have the lock, but it's unlikely enough to make this a win
 	 * despite occasional duplicated work.  We need to reload if anybody
 	 * writes to the file (either a retail qtext_store(), or a garbage
@@ -1439,17 +2067,15 @@ pg_stat_statements_internal(FunctionCallInfo fcinfo,
 	}
 
 	/*
-	 * Get shared lock, load or reload the query text file if we must, and
-	 * iterate over the hashtable entries.
+	 * Lock the whole table shared, load or reload the query text file if we
+	 * must, and iterate over the hashtable entries.
 	 *
-	 * With a large hash table, we might be holding the lock rather longer
+	 * With a large hash table, we might be holding the locks rather longer
 	 * than one could wish.  However, this only blocks creation of new hash
 	 * table entries, and the larger the hash table the less likely that is to
-	 * be needed.  So we can hope this is okay.  Perhaps someday we'll decide
-	 * we need to partition the hash table to limit the time spent holding any
-	 * one lock.
+	 * be needed.  So we can hope this is okay.
 	 */
-	LWLockAcquire(pgss->lock, LW_SHARED);
+	pgss_lock_all(LW_SHARED);
 
 	if (showtext)
 	{
@@ -1555,6 +2181,19 @@ pg_stat_statements_internal(FunctionCallInfo fcinfo,
 		if (tmp.calls == 0)
 			continue;
 
+		if (api_version >= PGSS_V1_4)
+		{
+			values[i++] = Int64GetDatumFast(tmp.plans);
+			values[i++] = Float8GetDatumFast(tmp.total_plan_time);
+			values[i++] = Float8GetDatumFast(tmp.min_plan_time);
+			values[i++] = Float8GetDatumFast(tmp.max_plan_time);
+			values[i++] = Float8GetDatumFast(tmp.mean_plan_time);
+			if (tmp.plans > 1)
+				stddev = sqrt(tmp.sum_var_plan_time / tmp.plans);
+			else
+				stddev = 0.0;
+			values[i++] = Float8GetDatumFast(stddev);
+		}
 		values[i++] = Int64GetDatumFast(tmp.calls);
 		values[i++] = Float8GetDatumFast(tmp.total_time);
 		if (api_version >= PGSS_V1_3)
@@ -1598,13 +2237,14 @@ pg_stat_statements_internal(FunctionCallInfo fcinfo,
 					 api_version == PGSS_V1_1 ? PG_STAT_STATEMENTS_COLS_V1_1 :
 					 api_version == PGSS_V1_2 ? PG_STAT_STATEMENTS_COLS_V1_2 :
 					 api_version == PGSS_V1_3 ? PG_STAT_STATEMENTS_COLS_V1_3 :
+					 api_version == PGSS_V1_4 ? PG_STAT_STATEMENTS_COLS_V1_4 :
 					 -1 /* fail if you forget to update this assert */ ));
 
 		tuplestore_putvalues(tupstore, tupdesc, values, nulls);
 	}
 
 	/* clean up and return the tuplestore */
-	LWLockRelease(pgss->lock);
+	pgss_unlock_all();
 
 	if (qbuffer)
 		free(qbuffer);
@@ -1612,6 +2252,119 @@ pg_stat_statements_internal(FunctionCallInfo fcinfo,
 	tuplestore_donestoring(tupstore);
 }
 
+#define PG_STAT_STATEMENTS_PLAN_PROFILE_COLS	20
+
+/*
+ * Retrieve the plan profile of all statements.
+ *
+ * Unlike the query texts, plan node statistics reveal nothing that EXPLAIN
+ * wouldn't, so they're shown to all users.
+ */
+Datum
+pg_stat_statements_plan_profile(PG_FUNCTION_ARGS)
+{
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	TupleDesc	tupdesc;
+	Tuplestorestate *tupstore;
+	MemoryContext per_query_ctx;
+	MemoryContext oldcontext;
+	HASH_SEQ_STATUS hash_seq;
+	pgssPlanEntry *entry;
+
+	/* hash table must exist already */
+	if (!pgss || !pgss_plan_hash)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("pg_stat_statements must be loaded via shared_preload_libraries")));
+
+	/* check to see if caller supports us returning a tuplestore */
+	if (rsinfo == NULL || !IsA(rsinfo, ReturnSetInfo))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("set-valued function called in context that cannot accept a set")));
+	if (!(rsinfo->allowedModes & SFRM_Materialize))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("materialize mode required, but it is not " \
+						"allowed in this context")));
+
+	/* Switch into long-lived context to construct returned data structures */
+	per_query_ctx = rsinfo->econtext->ecxt_per_query_memory;
+	oldcontext = MemoryContextSwitchTo(per_query_ctx);
+
+	/* Build a tuple descriptor for our result type */
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+
+	if (tupdesc->natts != PG_STAT_STATEMENTS_PLAN_PROFILE_COLS)
+		elog(ERROR, "incorrect number of output arguments");
+
+	tupstore = tuplestore_begin_heap(true, false, work_mem);
+	rsinfo->returnMode = SFRM_Materialize;
+	rsinfo->setResult = tupstore;
+	rsinfo->setDesc = tupdesc;
+
+	MemoryContextSwitchTo(oldcontext);
+
+	LWLockAcquire(pgss->plan_lock, LW_SHARED);
+
+	hash_seq_init(&hash_seq, pgss_plan_hash);
+	while ((entry = hash_seq_search(&hash_seq)) != NULL)
+	{
+		Datum		values[PG_STAT_STATEMENTS_PLAN_PROFILE_COLS];
+		bool		nulls[PG_STAT_STATEMENTS_PLAN_PROFILE_COLS];
+		int			i = 0;
+		PlanCounters tmp;
+
+		memset(values, 0, sizeof(values));
+		memset(nulls, 0, sizeof(nulls));
+
+		/* copy counters to a local variable to keep locking time short */
+		{
+			volatile pgssPlanEntry *e = (volatile pgssPlanEntry *) entry;
+
+			SpinLockAcquire(&e->mutex);
+			tmp = e->counters;
+			SpinLockRelease(&e->mutex);
+		}
+
+		values[i++] = ObjectIdGetDatum(entry->key.userid);
+		values[i++] = ObjectIdGetDatum(entry->key.dbid);
+		values[i++] = Int64GetDatumFast((int64) entry->key.queryid);
+		values[i++] = Int64GetDatumFast((int64) entry->key.planid);
+		values[i++] = Int32GetDatum(entry->key.plan_node_id);
+		if (entry->parent_node_id >= 0)
+			values[i++] = Int32GetDatum(entry->parent_node_id);
+		else
+			nulls[i++] = true;
+		values[i++] = CStringGetTextDatum(plan_node_name(entry->key.node_tag));
+		values[i++] = Int64GetDatumFast(tmp.calls);
+		values[i++] = Float8GetDatumFast(tmp.loops);
+		values[i++] = Float8GetDatumFast(tmp.rows);
+		values[i++] = Float8GetDatumFast(tmp.total_time);
+		values[i++] = Float8GetDatumFast(tmp.startup_time);
+		values[i++] = Int64GetDatumFast(tmp.shared_blks_hit);
+		values[i++] = Int64GetDatumFast(tmp.shared_blks_read);
+		values[i++] = Int64GetDatumFast(tmp.local_blks_hit);
+		values[i++] = Int64GetDatumFast(tmp.local_blks_read);
+		values[i++] = Int64GetDatumFast(tmp.temp_blks_read);
+		values[i++] = Int64GetDatumFast(tmp.temp_blks_written);
+		values[i++] = Float8GetDatumFast(tmp.blk_read_time);
+		values[i++] = Float8GetDatumFast(tmp.blk_write_time);
+
+		Assert(i == PG_STAT_STATEMENTS_PLAN_PROFILE_COLS);
+
+		tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+	}
+
+	/* clean up and return the tuplestore */
+	LWLockRelease(pgss->plan_lock);
+
+	tuplestore_donestoring(tupstore);
+
+	return (Datum) 0;
+}
+
 /*
  * Estimate shared memory space needed.
  */
@@ -1622,13 +2375,16 @@ pgss_memsize(void)
 
 	size = MAXALIGN(sizeof(pgssSharedState));
 	size = add_size(size, hash_estimate_size(pgss_max, sizeof(pgssEntry)));
+	size = add_size(size, hash_estimate_size(pgss_plan_max,
+											 sizeof(pgssPlanEntry)));
 
 	return size;
 }
 
 /*
  * Allocate a new hashtable entry.
- * caller must hold an exclusive lock on pgss->lock
+ * caller must hold an exclusive lock on the entry's partition, or on the
+ * whole table if all_locked is true
  *
  * "query" need not be null-terminated; we rely on query_len instead
  *
@@ -1642,20 +2398,31 @@ pgss_memsize(void)
  * entry to already exist.  This is because pgss_store releases and
  * reacquires lock after failing to find a match; so someone else could
  * have made the entry while we waited to get exclusive lock.
+ *
+ * Making space for the new entry requires the whole table to be locked.
+ * Without that, NULL is returned if the hashtable is full.
  */
 static pgssEntry *
-entry_alloc(pgssHashKey *key, Size query_offset, int query_len, int encoding,
-			bool sticky)
+entry_alloc(pgssHashKey *key, uint32 hashcode, Size query_offset,
+			int query_len, int encoding, bool sticky, bool all_locked)
 {
 	pgssEntry  *entry;
 	bool		found;
 
 	/* Make space if needed */
-	while (hash_get_num_entries(pgss_hash) >= pgss_max)
-		entry_dealloc();
+	if (all_locked)
+	{
+		while (hash_get_num_entries(pgss_hash) >= pgss_max)
+			entry_dealloc();
+	}
+	else if (hash_get_num_entries(pgss_hash) >= pgss_max)
+		return NULL;
 
 	/* Find or create an entry with desired hash code */
-	entry = (pgssEntry *) hash_search(pgss_hash, key, HASH_ENTER, &found);
+	entry = (pgssEntry *) hash_search_with_hash_value(pgss_hash, key, hashcode,
+													  HASH_ENTER_NULL, &found);
+	if (!entry)
+		return NULL;
 
 	if (!found)
 	{
@@ -1697,7 +2464,7 @@ entry_cmp(const void *lhs, const void *rhs)
 /*
  * Deallocate least-used entries.
  *
- * Caller must hold an exclusive lock on pgss->lock.
+ * Caller must hold an exclusive lock on the whole table.
  */
 static void
 entry_dealloc(void)
@@ -1767,6 +2534,37 @@ entry_dealloc(void)
 	}
 
 	pfree(entries);
+
+	/* Also forget the plan profiles of the statements we just zapped */
+	plan_entry_purge();
+}
+
+/*
+ * Remove plan profile entries whose statement is no longer in the main
+ * hashtable.
+ * caller must hold an exclusive lock on the whole table
+ */
+static void
+plan_entry_purge(void)
+{
+	HASH_SEQ_STATUS hash_seq;
+	pgssPlanEntry *entry;
+	pgssHashKey key;
+
+	LWLockAcquire(pgss->plan_lock, LW_EXCLUSIVE);
+
+	hash_seq_init(&hash_seq, pgss_plan_hash);
+	while ((entry = hash_seq_search(&hash_seq)) != NULL)
+	{
+		key.userid = entry->key.userid;
+		key.dbid = entry->key.dbid;
+		key.queryid = entry->key.queryid;
+
+		if (hash_search(pgss_hash, &key, HASH_FIND, NULL) == NULL)
+			hash_search(pgss_plan_hash, &entry->key, HASH_REMOVE, NULL);
+	}
+
+	LWLockRelease(pgss->plan_lock);
 }
 
 /*
@@ -1782,11 +2580,12 @@ entry_dealloc(void)
  *
  * On failure, returns false.
  *
- * At least a shared lock on pgss->lock must be held by the caller, so as
- * to prevent a concurrent garbage collection.  Share-lock-holding callers
- * should pass a gc_count pointer to obtain the number of garbage collections,
- * so that they can recheck the count after obtaining exclusive lock to
- * detect whether a garbage collection occurred (and removed this entry).
+ * At least a shared lock on one partition of the hashtable must be held by
+ * the caller, so as to prevent a concurrent garbage collection.
+ * Share-lock-holding callers should pass a gc_count pointer to obtain the
+ * number of garbage collections, so that they can recheck the count after
+ * obtaining exclusive lock to detect whether a garbage collection occurred
+ * (and removed this entry).
  */
 static bool
 qtext_store(const char *query, int query_len,
@@ -1867,7 +2666,7 @@ error:
  *
  * On success, the buffer size is also returned into *buffer_size.
  *
- * This can be called without any lock on pgss->lock, but in that case
+ * This can be called without any lock on the hashtable, but in that case
  * the caller is responsible for verifying that the result is sane.
  */
 static char *
@@ -1968,7 +2767,7 @@ qtext_fetch(Size query_offset, int query_len,
 /*
  * Do we need to garbage-collect the external query text file?
  *
- * Caller should hold at least a shared lock on pgss->lock.
+ * Caller should hold at least a shared lock on one partition.
  */
 static bool
 need_gc_qtexts(void)
@@ -2011,7 +2810,7 @@ need_gc_qtexts(void)
  * becomes unreasonably large, with no other method of compaction likely to
  * occur in the foreseeable future.
  *
- * The caller must hold an exclusive lock on pgss->lock.
+ * The caller must hold an exclusive lock on the whole table.
  *
  * At the first sign of trouble we unlink the query text file to get a clean
  * slate (although existing statistics are retained), rather than risk
@@ -2138,7 +2937,7 @@ gc_qtexts(void)
 
 	/*
 	 * OK, count a garbage collection cycle.  (Note: even though we have
-	 * exclusive lock on pgss->lock, we must take pgss->mutex for this, since
+	 * exclusive lock on the whole table, we must take pgss->mutex for this, since
 	 * other processes may examine gc_count while holding only the mutex.
 	 * Also, we have to advance the count *after* we've rewritten the file,
 	 * else other processes might not realize they read a stale file.)
@@ -2188,12 +2987,12 @@ gc_fail:
 	 * Bump the GC count even though we failed.
 	 *
 	 * This is needed to make concurrent readers of file without any lock on
-	 * pgss->lock notice existence of new version of file.  Once readers
-	 * subsequently observe a change in GC count with pgss->lock held, that
+	 * the hashtable notice existence of new version of file.  Once readers
+	 * subsequently observe a change in GC count with the table locked, that
 	 * forces a safe reopen of file.  Writers also require that we bump here,
 	 * of course.  (As required by locking protocol, readers and writers don't
 	 * trust earlier file contents until gc_count is found unchanged after
-	 * pgss->lock acquired in shared or exclusive mode respectively.)
+	 * acquiring a partition lock in shared or exclusive mode respectively.)
 	 */
 	record_gc_qtexts();
 }
@@ -2208,7 +3007,7 @@ entry_reset(void)
 	pgssEntry  *entry;
 	FILE	   *qfile;
 
-	LWLockAcquire(pgss->lock, LW_EXCLUSIVE);
+	pgss_lock_all(LW_EXCLUSIVE);
 
 	hash_seq_init(&hash_seq, pgss_hash);
 	while ((entry = hash_seq_search(&hash_seq)) != NULL)
@@ -2216,6 +3015,8 @@ entry_reset(void)
 		hash_search(pgss_hash, &entry->key, HASH_REMOVE, NULL);
 	}
 
+	plan_entry_purge();
+
 	/*
 	 * Write new empty query file, perhaps even creating a new one to recover
 	 * if the file was missing.
@@ -2244,7 +3045,114 @@ done:
 	/* This counts as a query text garbage collection for our purposes */
 	record_gc_qtexts();
 
-	LWLockRelease(pgss->lock);
+	pgss_unlock_all();
+}
+
+/*
+ * Lock all partitions of the hashtable, in order.
+ */
+static void
+pgss_lock_all(LWLockMode mode)
+{
+	int			i;
+
+	for (i = 0; i < PGSS_NUM_PARTITIONS; i++)
+		LWLockAcquire(PGSS_PARTITION_LOCK_BY_INDEX(i), mode);
+}
+
+/*
+ * Release the locks taken by pgss_lock_all().
+ */
+static void
+pgss_unlock_all(void)
+{
+	int			i;
+
+	for (i = PGSS_NUM_PARTITIONS; --i >= 0;)
+		LWLockRelease(PGSS_PARTITION_LOCK_BY_INDEX(i));
+}
+
+/*
+ * Name of a plan node type, as shown by EXPLAIN
+ */
+static const char *
+plan_node_name(NodeTag tag)
+{
+	switch (tag)
+	{
+		case T_Result:
+			return "Result";
+		case T_ModifyTable:
+			return "ModifyTable";
+		case T_Append:
+			return "Append";
+		case T_MergeAppend:
+			return "Merge Append";
+		case T_RecursiveUnion:
+			return "Recursive Union";
+		case T_BitmapAnd:
+			return "BitmapAnd";
+		case T_BitmapOr:
+			return "BitmapOr";
+		case T_NestLoop:
+			return "Nested Loop";
+		case T_MergeJoin:
+			return "Merge Join";
+		case T_HashJoin:
+			return "Hash Join";
+		case T_SeqScan:
+			return "Seq Scan";
+		case T_SampleScan:
+			return "Sample Scan";
+		case T_Gather:
+			return "Gather";
+		case T_IndexScan:
+			return "Index Scan";
+		case T_IndexOnlyScan:
+			return "Index Only Scan";
+		case T_BitmapIndexScan:
+			return "Bitmap Index Scan";
+		case T_BitmapHeapScan:
+			return "Bitmap Heap Scan";
+		case T_TidScan:
+			return "Tid Scan";
+		case T_SubqueryScan:
+			return "Subquery Scan";
+		case T_FunctionScan:
+			return "Function Scan";
+		case T_ValuesScan:
+			return "Values Scan";
+		case T_CteScan:
+			return "CTE Scan";
+		case T_WorkTableScan:
+			return "WorkTable Scan";
+		case T_ForeignScan:
+			return "Foreign Scan";
+		case T_CustomScan:
+			return "Custom Scan";
+		case T_Material:
+			return "Materialize";
+		case T_Sort:
+			return "Sort";
+		case T_Group:
+			return "Group";
+		case T_Agg:
+			return "Aggregate";
+		case T_WindowAgg:
+			return "WindowAgg";
+		case T_Unique:
+			return "Unique";
+		case T_SetOp:
+			return "SetOp";
+		case T_LockRows:
+			return "LockRows";
+		case T_Limit:
+			return "Limit";
+		case T_Hash:
+			return "Hash";
+		default:
+			return "???";
+	}
 }
 
 /*
@@ -0,0 +1,50 @@
+CREATE EXTENSION pg_stat_statements;
+
+--
+-- plan profiles
+--
+SET pg_stat_statements.plan_sample_rate = 1;
+SET enable_seqscan = off;
+SET enable_bitmapscan = off;
+CREATE TABLE pgss_tab (a int, b int);
+INSERT INTO pgss_tab SELECT g, g FROM generate_series(1, 1000) g;
+CREATE INDEX pgss_tab_i1 ON pgss_tab (a);
+ANALYZE pgss_tab;
+SELECT pg_stat_statements_reset();
+
+-- executions of the same plan add up
+SELECT b FROM pgss_tab WHERE a = 1;
+SELECT b FROM pgss_tab WHERE a = 2;
+
+-- a plan of the same shape on another index is profiled apart
+DROP INDEX pgss_tab_i1;
+CREATE INDEX pgss_tab_i2 ON pgss_tab (a);
+SELECT b FROM pgss_tab WHERE a = 3;
+
+SELECT p.plan_node_id, p.node_type, p.calls, p.rows
+FROM pg_stat_statements_plan_profile p
+  JOIN pg_stat_statements s USING (userid, dbid, queryid)
+WHERE s.query LIKE 'SELECT b FROM pgss_tab WHERE a = %'
+ORDER BY p.calls;
+
+RESET pg_stat_statements.plan_sample_rate;
+RESET enable_seqscan;
+RESET enable_bitmapscan;
+DROP TABLE pgss_tab;
+
+--
+-- the number of statements tracked is bounded by pg_stat_statements.max,
+-- which is 100 here
+--
+SELECT pg_stat_statements_reset();
+SET pg_stat_statements.track = 'all';
+DO $$
+BEGIN
+  FOR i IN 1..150 LOOP
+    EXECUTE 'SELECT ' || array_to_string(array_fill(1, ARRAY[i]), ', ');
+  END LOOP;
+END $$;
+RESET pg_stat_statements.track;
+SELECT count(*) <= 100 AS within_max FROM pg_stat_statements;
+
+DROP EXTENSION pg_stat_statements;
@@ -17,6 +17,7 @@
 #include "access/xact.h"
 #include "access/multixact.h"
 #include "access/htup_details.h"
+#include "access/tableam.h"
 #include "catalog/namespace.h"
 #include "funcapi.h"
 #include "miscadmin.h"
@@ -252,6 +253,12 @@ pgstattuple_approx(PG_FUNCTION_ARGS)
 				 errmsg("\"%s\" is not a table or materialized view",
 						RelationGetRelationName(rel))));
 
+	if (!RelationUsesHeapAm(rel))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("\"%s\" is not stored in the heap",
+						RelationGetRelationName(rel))));
+
 	statapprox_heap(rel, &stat);
 
 	relation_close(rel, AccessShareLock);
@@ -64,6 +64,7 @@ hashhandler(PG_FUNCTION_ARGS)
 	amroutine->amstorage = false;
 	amroutine->amclusterable = false;
 	amroutine->ampredlocks = false;
+	amroutine->amcanparallelvacuum = true;
 	amroutine->amkeytype = INT4OID;
 
 	amroutine->ambuild = hashbuild;
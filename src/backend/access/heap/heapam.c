@@ -2365,6 +2365,13 @@ FreeBulkInsertState(BulkInsertState bistate)
  * Speculatively inserted tuples behave as "value locks" of short duration,
  * used to implement INSERT .. ON CONFLICT.
  *
+ * HEAP_INSERT_PARALLEL allows the insertion in parallel mode.  Unlike
+ * heap_update() and heap_delete(), an insert never creates a combo CID, so
+ * this is safe as long as the transaction ID and the command ID were set up
+ * before the parallel operation started, as the leader of a parallel COPY
+ * FROM does for its workers.  GetCurrentTransactionId() and
+ * GetCurrentCommandId() check for that.
+ *
  * Note that most of these options will be applied when inserting into the
  * heap's TOAST table, too, if the tuple requires any out-of-line data.  Only
  * HEAP_INSERT_IS_SPECULATIVE is explicitly ignored, as the toast data does
@@ -2568,12 +2575,10 @@ heap_prepare_insert(Relation relation, HeapTuple tup, TransactionId xid,
 					CommandId cid, int options)
 {
 	/*
-	 * For now, parallel operations are required to be strictly read-only.
-	 * Unlike heap_update() and heap_delete(), an insert should never create a
-	 * combo CID, so it might be possible to relax this restriction, but not
-	 * without more thought and testing.
+	 * For now, parallel operations are required to be strictly read-only,
+	 * except for callers that pass HEAP_INSERT_PARALLEL, see heap_insert.
 	 */
-	if (IsInParallelMode())
+	if (IsInParallelMode() && !(options & HEAP_INSERT_PARALLEL))
 		ereport(ERROR,
 				(errcode(ERRCODE_INVALID_TRANSACTION_STATE),
 				 errmsg("cannot insert tuples during a parallel operation")));
@@ -7942,9 +7947,10 @@ heap_xlog_freeze_page(XLogReaderState *record)
 
 	/*
 	 * In Hot Standby mode, ensure that there's no queries running which still
-	 * consider the frozen xids as running.
+	 * consider the frozen xids as running.  An invalid cutoff means that no
+	 * normal xmin was frozen, so there's nothing to conflict with.
 	 */
-	if (InHotStandby)
+	if (InHotStandby && TransactionIdIsValid(cutoff_xid))
 	{
 		RelFileNode rnode;
 		TransactionId latestRemovedXid = cutoff_xid;
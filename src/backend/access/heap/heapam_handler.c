@@ -0,0 +1,152 @@
+/*-------------------------------------------------------------------------
+ *
+ * heapam_handler.c
+ *	  heap table access method code
+ *
+ * This connects the heap to the table access method API.  Most callbacks
+ * are thin wrappers around the functions in heapam.c, which remain
+ * available for code that works on heap pages directly.
+ *
+ * Portions Copyright (c) 1996-2016, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/access/heap/heapam_handler.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/relscan.h"
+#include "access/tableam.h"
+#include "commands/vacuum.h"
+#include "executor/tuptable.h"
+#include "storage/bufmgr.h"
+
+
+static TableScanDesc
+heapam_beginscan(Relation rel, Snapshot snapshot, int nkeys, ScanKey key)
+{
+	return (TableScanDesc) heap_beginscan(rel, snapshot, nkeys, key);
+}
+
+static void
+heapam_rescan(TableScanDesc scan, ScanKey key)
+{
+	heap_rescan((HeapScanDesc) scan, key);
+}
+
+static bool
+heapam_getnextslot(TableScanDesc sscan, ScanDirection direction,
+				   TupleTableSlot *slot)
+{
+	HeapScanDesc scan = (HeapScanDesc) sscan;
+	HeapTuple	tuple;
+
+	tuple = heap_getnext(scan, direction);
+	if (tuple == NULL)
+	{
+		ExecClearTuple(slot);
+		return false;
+	}
+
+	/*
+	 * The tuple points into the buffer, which ExecStoreTuple pins until the
+	 * slot is cleared.
+	 */
+	ExecStoreTuple(tuple, slot, scan->rs_cbuf, false);
+	return true;
+}
+
+static void
+heapam_endscan(TableScanDesc scan)
+{
+	heap_endscan((HeapScanDesc) scan);
+}
+
+static Size
+heapam_parallelscan_estimate(Relation rel, Snapshot snapshot)
+{
+	return heap_parallelscan_estimate(snapshot);
+}
+
+static void
+heapam_parallelscan_initialize(Relation rel, ParallelTableScanDesc pscan,
+							   Snapshot snapshot)
+{
+	heap_parallelscan_initialize((ParallelHeapScanDesc) pscan, rel, snapshot);
+}
+
+static TableScanDesc
+heapam_beginscan_parallel(Relation rel, ParallelTableScanDesc pscan)
+{
+	return (TableScanDesc)
+		heap_beginscan_parallel(rel, (ParallelHeapScanDesc) pscan);
+}
+
+static bool
+heapam_fetch(Relation rel, ItemPointer tid, Snapshot snapshot,
+			 TupleTableSlot *slot)
+{
+	HeapTupleData tuple;
+	Buffer		buffer;
+
+	tuple.t_self = *tid;
+	if (!heap_fetch(rel, snapshot, &tuple, &buffer, false, NULL))
+		return false;
+
+	/*
+	 * tuple lives on our stack, so the slot can't keep pointing to it; give
+	 * the slot its own copy.
+	 */
+	ExecStoreTuple(heap_copytuple(&tuple), slot, InvalidBuffer, true);
+	ReleaseBuffer(buffer);
+
+	return true;
+}
+
+static void
+heapam_finish_bulk_insert(Relation rel, int options)
+{
+	/* tuples inserted without WAL-logging must reach disk before commit */
+	if (options & HEAP_INSERT_SKIP_WAL)
+		heap_sync(rel);
+}
+
+static void
+heapam_vacuum(Relation rel, int options, struct VacuumParams *params,
+			  BufferAccessStrategy bstrategy)
+{
+	lazy_vacuum_rel(rel, options, params, bstrategy);
+}
+
+
+/*
+ * Heap handler function: return TableAmRoutine with access method parameters
+ * and callbacks.
+ */
+Datum
+heap_tableam_handler(PG_FUNCTION_ARGS)
+{
+	TableAmRoutine *amroutine = makeNode(TableAmRoutine);
+
+	amroutine->scan_begin = heapam_beginscan;
+	amroutine->scan_rescan = heapam_rescan;
+	amroutine->scan_getnextslot = heapam_getnextslot;
+	amroutine->scan_end = heapam_endscan;
+	amroutine->parallelscan_estimate = heapam_parallelscan_estimate;
+	amroutine->parallelscan_initialize = heapam_parallelscan_initialize;
+	amroutine->scan_begin_parallel = heapam_beginscan_parallel;
+	amroutine->tuple_fetch = heapam_fetch;
+	amroutine->tuple_insert = heap_insert;
+	amroutine->multi_insert = heap_multi_insert;
+	amroutine->finish_bulk_insert = heapam_finish_bulk_insert;
+	amroutine->tuple_delete = heap_delete;
+	amroutine->tuple_update = heap_update;
+	amroutine->relation_vacuum = heapam_vacuum;
+	/* estimate_rel_size's block-based estimate is meant for the heap */
+	amroutine->relation_estimate_size = NULL;
+
+	PG_RETURN_POINTER(amroutine);
+}
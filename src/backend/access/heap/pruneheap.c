@@ -16,6 +16,7 @@
 
 #include "access/heapam.h"
 #include "access/heapam_xlog.h"
+#include "access/multixact.h"
 #include "access/transam.h"
 #include "access/htup_details.h"
 #include "access/xlog.h"
@@ -27,6 +28,9 @@
 #include "utils/rel.h"
 #include "utils/tqual.h"
 
+/* GUC parameter */
+bool		opportunistic_freeze = true;
+
 /* Working data for heap_page_prune and subroutines */
 typedef struct
 {
@@ -42,6 +46,10 @@ typedef struct
 	OffsetNumber nowunused[MaxHeapTuplesPerPage];
 	/* marked[i] is TRUE if item i is entered in one of the above arrays */
 	bool		marked[MaxHeapTuplesPerPage + 1];
+	/* freeze plans for the tuples to be frozen along with pruning */
+	int			nfrozen;
+	xl_heap_freeze_tuple frozen[MaxHeapTuplesPerPage];
+	TransactionId newest_frozen_xmin;	/* newest xmin among them */
 } PruneState;
 
 /* Local functions */
@@ -54,6 +62,9 @@ static void heap_prune_record_redirect(PruneState *prstate,
 						   OffsetNumber offnum, OffsetNumber rdoffnum);
 static void heap_prune_record_dead(PruneState *prstate, OffsetNumber offnum);
 static void heap_prune_record_unused(PruneState *prstate, OffsetNumber offnum);
+static void heap_prune_prepare_freeze(Relation relation, Buffer buffer,
+						  TransactionId OldestXmin,
+						  PruneState *prstate);
 
 
 /*
@@ -153,7 +164,8 @@ heap_page_prune_opt(Relation relation, Buffer buffer)
 																 * needed */
 
 			/* OK to prune */
-			(void) heap_page_prune(relation, buffer, OldestXmin, true, &ignore);
+			(void) heap_page_prune(relation, buffer, OldestXmin, true,
+								   opportunistic_freeze, &ignore);
 		}
 
 		/* And release buffer lock */
@@ -175,12 +187,21 @@ heap_page_prune_opt(Relation relation, Buffer buffer)
  * send its own new total to pgstats, and we don't want this delta applied
  * on top of that.)
  *
+ * If freeze is true, and we are going to modify and WAL-log the page anyway
+ * because there is something to prune, we also freeze the tuples remaining
+ * on the page, provided that all of them are visible to everyone.  Such a
+ * page would otherwise have to be dirtied and written again by a later
+ * vacuum to freeze it, quite possibly an anti-wraparound vacuum that has to
+ * do the same for a large part of the table at once.  Freezing now costs
+ * only a freeze record added to the WAL we are writing anyway.
+ *
  * Returns the number of tuples deleted from the page and sets
  * latestRemovedXid.
  */
 int
 heap_page_prune(Relation relation, Buffer buffer, TransactionId OldestXmin,
-				bool report_stats, TransactionId *latestRemovedXid)
+				bool report_stats, bool freeze,
+				TransactionId *latestRemovedXid)
 {
 	int			ndeleted = 0;
 	Page		page = BufferGetPage(buffer);
@@ -202,6 +223,8 @@ heap_page_prune(Relation relation, Buffer buffer, TransactionId OldestXmin,
 	prstate.new_prune_xid = InvalidTransactionId;
 	prstate.latestRemovedXid = *latestRemovedXid;
 	prstate.nredirected = prstate.ndead = prstate.nunused = 0;
+	prstate.nfrozen = 0;
+	prstate.newest_frozen_xmin = InvalidTransactionId;
 	memset(prstate.marked, 0, sizeof(prstate.marked));
 
 	/* Scan the page */
@@ -227,6 +250,14 @@ heap_page_prune(Relation relation, Buffer buffer, TransactionId OldestXmin,
 									 &prstate);
 	}
 
+	/*
+	 * If we're going to prune, see whether the rest of the page can be
+	 * frozen at the same time.
+	 */
+	if (freeze &&
+		(prstate.nredirected > 0 || prstate.ndead > 0 || prstate.nunused > 0))
+		heap_prune_prepare_freeze(relation, buffer, OldestXmin, &prstate);
+
 	/* Any error while applying the changes is critical */
 	START_CRIT_SECTION();
 
@@ -242,6 +273,23 @@ heap_page_prune(Relation relation, Buffer buffer, TransactionId OldestXmin,
 								prstate.nowdead, prstate.ndead,
 								prstate.nowunused, prstate.nunused);
 
+		/* Freeze the remaining tuples, if we decided to do so */
+		if (prstate.nfrozen > 0)
+		{
+			int			i;
+
+			for (i = 0; i < prstate.nfrozen; i++)
+			{
+				ItemId		itemid;
+				HeapTupleHeader htup;
+
+				itemid = PageGetItemId(page, prstate.frozen[i].offset);
+				htup = (HeapTupleHeader) PageGetItem(page, itemid);
+
+				heap_execute_freeze_tuple(htup, &prstate.frozen[i]);
+			}
+		}
+
 		/*
 		 * Update the page's pd_prune_xid field to either zero, or the lowest
 		 * XID of any soon-prunable tuple.
@@ -270,7 +318,31 @@ heap_page_prune(Relation relation, Buffer buffer, TransactionId OldestXmin,
 									prstate.nowunused, prstate.nunused,
 									prstate.latestRemovedXid);
 
+			/*
+			 * Set the LSN now, so that the freeze record below doesn't see a
+			 * page older than the redo pointer and log a second full-page
+			 * image of it.
+			 */
 			PageSetLSN(BufferGetPage(buffer), recptr);
+
+			/*
+			 * And a HEAP2_FREEZE_PAGE record for the frozen tuples.  Standby
+			 * queries only conflict with it if they might still consider the
+			 * newest frozen xmin as running; redo retreats the cutoff by one.
+			 * If we froze no normal xmin, say because only an aborted xmax is
+			 * being cleared, log an invalid cutoff, for which redo doesn't
+			 * resolve conflicts at all.
+			 */
+			if (prstate.nfrozen > 0)
+			{
+				TransactionId cutoff_xid = prstate.newest_frozen_xmin;
+
+				if (TransactionIdIsValid(cutoff_xid))
+					TransactionIdAdvance(cutoff_xid);
+				recptr = log_heap_freeze(relation, buffer, cutoff_xid,
+										 prstate.frozen, prstate.nfrozen);
+				PageSetLSN(BufferGetPage(buffer), recptr);
+			}
 		}
 	}
 	else
@@ -303,6 +375,9 @@ heap_page_prune(Relation relation, Buffer buffer, TransactionId OldestXmin,
 	if (report_stats && ndeleted > prstate.ndead)
 		pgstat_update_heap_dead_tuples(relation, ndeleted - prstate.ndead);
 
+	if (prstate.nfrozen > 0)
+		pgstat_count_heap_eager_freeze(relation);
+
 	*latestRemovedXid = prstate.latestRemovedXid;
 
 	/*
@@ -615,6 +690,89 @@ heap_prune_chain(Relation relation, Buffer buffer, OffsetNumber rootoffnum,
 	return ndeleted;
 }
 
+/*
+ * Decide whether to freeze the tuples that remain on the page after pruning,
+ * and if so, prepare the freeze plans in prstate->frozen.
+ *
+ * We freeze only if every remaining tuple is visible to everyone, that is,
+ * it was inserted by a transaction older than OldestXmin and hasn't been
+ * deleted or locked.  If any tuple doesn't qualify, the page is still in
+ * flux and would likely have to be frozen again later, so we don't freeze
+ * any of them.  Since no tuple then carries a MultiXactId, no multixact
+ * cutoff is needed.
+ */
+static void
+heap_prune_prepare_freeze(Relation relation, Buffer buffer,
+						  TransactionId OldestXmin,
+						  PruneState *prstate)
+{
+	Page		page = BufferGetPage(buffer);
+	OffsetNumber offnum,
+				maxoff;
+	int			nfrozen = 0;
+	TransactionId newest_xmin = InvalidTransactionId;
+	bool		rdtarget[MaxHeapTuplesPerPage + 1];
+	int			i;
+
+	/* the tuples that redirected items will point to stay on the page */
+	memset(rdtarget, 0, sizeof(rdtarget));
+	for (i = 0; i < prstate->nredirected; i++)
+		rdtarget[prstate->redirected[i * 2 + 1]] = true;
+
+	maxoff = PageGetMaxOffsetNumber(page);
+	for (offnum = FirstOffsetNumber;
+		 offnum <= maxoff;
+		 offnum = OffsetNumberNext(offnum))
+	{
+		ItemId		itemid;
+		HeapTupleData tup;
+		HeapTupleHeader htup;
+
+		/* Items that pruning is about to remove don't carry tuples */
+		if (prstate->marked[offnum] && !rdtarget[offnum])
+			continue;
+
+		itemid = PageGetItemId(page, offnum);
+		if (!ItemIdIsNormal(itemid))
+			continue;
+
+		htup = (HeapTupleHeader) PageGetItem(page, itemid);
+		tup.t_data = htup;
+		tup.t_len = ItemIdGetLength(itemid);
+		tup.t_tableOid = RelationGetRelid(relation);
+		ItemPointerSet(&(tup.t_self), BufferGetBlockNumber(buffer), offnum);
+
+		if (HeapTupleSatisfiesVacuum(&tup, OldestXmin, buffer) != HEAPTUPLE_LIVE)
+			return;
+
+		/* xmin must be older than every running transaction's snapshot */
+		if (TransactionIdIsNormal(HeapTupleHeaderGetXmin(htup)) &&
+			!TransactionIdPrecedes(HeapTupleHeaderGetXmin(htup), OldestXmin))
+			return;
+
+		/* no updater or locker, and no leftovers of old-style VACUUM FULL */
+		if (!(htup->t_infomask & HEAP_XMAX_INVALID) ||
+			(htup->t_infomask & HEAP_XMAX_IS_MULTI) ||
+			(htup->t_infomask & HEAP_MOVED))
+			return;
+
+		if (heap_prepare_freeze_tuple(htup, OldestXmin, InvalidMultiXactId,
+									  &prstate->frozen[nfrozen]))
+		{
+			TransactionId xmin = HeapTupleHeaderGetXmin(htup);
+
+			prstate->frozen[nfrozen++].offset = offnum;
+			if (TransactionIdIsNormal(xmin) &&
+				(!TransactionIdIsValid(newest_xmin) ||
+				 TransactionIdFollows(xmin, newest_xmin)))
+				newest_xmin = xmin;
+		}
+	}
+
+	prstate->nfrozen = nfrozen;
+	prstate->newest_frozen_xmin = newest_xmin;
+}
+
 /* Record lowest soon-prunable XID */
 static void
 heap_prune_record_prunable(PruneState *prstate, TransactionId xid)
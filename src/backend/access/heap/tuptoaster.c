@@ -29,6 +29,9 @@
 
 #include <unistd.h>
 #include <fcntl.h>
+#ifdef USE_LZ4
+#include <lz4.h>
+#endif
 
 #include "access/genam.h"
 #include "access/heapam.h"
@@ -37,6 +40,7 @@
 #include "catalog/catalog.h"
 #include "common/pg_lzcompress.h"
 #include "miscadmin.h"
+#include "utils/attoptcache.h"
 #include "utils/expandeddatum.h"
 #include "utils/fmgroids.h"
 #include "utils/rel.h"
@@ -52,7 +56,7 @@
 typedef struct toast_compress_header
 {
 	int32		vl_len_;		/* varlena header (do not touch directly!) */
-	int32		rawsize;
+	uint32		rawsize;		/* raw size and compression method */
 } toast_compress_header;
 
 /*
@@ -60,12 +64,26 @@ typedef struct toast_compress_header
  * toast entries.
  */
 #define TOAST_COMPRESS_HDRSZ		((int32) sizeof(toast_compress_header))
-#define TOAST_COMPRESS_RAWSIZE(ptr) (((toast_compress_header *) (ptr))->rawsize)
+#define TOAST_COMPRESS_RAWSIZE(ptr) \
+	((int32) (((toast_compress_header *) (ptr))->rawsize & VARLENA_RAWSIZE_MASK))
+#define TOAST_COMPRESS_METHOD(ptr) \
+	((int) (((toast_compress_header *) (ptr))->rawsize >> VARLENA_RAWSIZE_BITS))
 #define TOAST_COMPRESS_RAWDATA(ptr) \
 	(((char *) (ptr)) + TOAST_COMPRESS_HDRSZ)
-#define TOAST_COMPRESS_SET_RAWSIZE(ptr, len) \
-	(((toast_compress_header *) (ptr))->rawsize = (len))
+#define TOAST_COMPRESS_SET_RAWSIZE(ptr, len, cmethod) \
+	(((toast_compress_header *) (ptr))->rawsize = \
+	 (uint32) (len) | ((uint32) (cmethod) << VARLENA_RAWSIZE_BITS))
+
+#define NO_LZ4_SUPPORT() \
+	ereport(ERROR, \
+			(errcode(ERRCODE_FEATURE_NOT_SUPPORTED), \
+			 errmsg("LZ4 compression is not supported by this build"), \
+			 errdetail("This requires a server built with --with-lz4.")))
+
+/* GUC variable */
+int			default_toast_compression = TOAST_PGLZ_COMPRESSION_ID;
 
+static void toast_compression_methods(Relation rel, int *cmethods);
 static void toast_delete_datum(Relation rel, Datum value);
 static Datum toast_save_datum(Relation rel, Datum value,
 				 struct varlena * oldexternal, int options);
@@ -74,7 +92,11 @@ static bool toastid_valueid_exists(Oid toastrelid, Oid valueid);
 static struct varlena *toast_fetch_datum(struct varlena * attr);
 static struct varlena *toast_fetch_datum_slice(struct varlena * attr,
 						int32 sliceoffset, int32 length);
+static struct varlena *toast_fetch_compressed_prefix(struct varlena * attr,
+							  int32 rawlength);
 static struct varlena *toast_decompress_datum(struct varlena * attr);
+static struct varlena *toast_decompress_datum_slice(struct varlena * attr,
+							 int32 slicelength);
 static int toast_open_indexes(Relation toastrel,
 				   LOCKMODE lock,
 				   Relation **toastidxs,
@@ -271,8 +293,14 @@ heap_tuple_untoast_attr_slice(struct varlena * attr,
 		if (!VARATT_EXTERNAL_IS_COMPRESSED(toast_pointer))
 			return toast_fetch_datum_slice(attr, sliceoffset, slicelength);
 
-		/* fetch it back (compressed marker will get set automatically) */
-		preslice = toast_fetch_datum(attr);
+		/* if only a prefix of the value is wanted, try to fetch less */
+		if (slicelength >= 0 &&
+			(int64) sliceoffset + slicelength <
+			toast_pointer.va_rawsize - VARHDRSZ)
+			preslice = toast_fetch_compressed_prefix(attr,
+												sliceoffset + slicelength);
+		else
+			preslice = toast_fetch_datum(attr);
 	}
 	else if (VARATT_IS_EXTERNAL_INDIRECT(attr))
 	{
@@ -300,7 +328,13 @@ heap_tuple_untoast_attr_slice(struct varlena * attr,
 	{
 		struct varlena *tmp = preslice;
 
-		preslice = toast_decompress_datum(tmp);
+		/* decompress no more than the slice and the data before it */
+		if (slicelength >= 0 &&
+			(int64) sliceoffset + slicelength < TOAST_COMPRESS_RAWSIZE(tmp))
+			preslice = toast_decompress_datum_slice(tmp,
+													sliceoffset + slicelength);
+		else
+			preslice = toast_decompress_datum(tmp);
 
 		if (tmp != attr)
 			pfree(tmp);
@@ -340,6 +374,166 @@ heap_tuple_untoast_attr_slice(struct varlena * attr,
 }
 
 
+/* ----------
+ * toast_fetch_compressed_prefix -
+ *
+ *	Fetch as much of an out-of-line compressed value as pglz could need to
+ *	produce its first rawlength bytes, which must be fewer than all of
+ *	them.  We don't know the compression method until we have the header,
+ *	and LZ4 can't work from a truncated block, so in that case the rest is
+ *	fetched too.  (The compressed marker gets set automatically either way.)
+ * ----------
+ */
+static struct varlena *
+toast_fetch_compressed_prefix(struct varlena * attr, int32 rawlength)
+{
+	struct varatt_external toast_pointer;
+	struct varlena *result;
+	int32		hdrsz = TOAST_COMPRESS_HDRSZ - VARHDRSZ;
+	int32		max_size;
+
+	VARATT_EXTERNAL_GET_POINTER(toast_pointer, attr);
+	Assert(VARATT_EXTERNAL_IS_COMPRESSED(toast_pointer));
+	Assert(rawlength < toast_pointer.va_rawsize - VARHDRSZ);
+
+	max_size = pglz_maximum_compressed_size(rawlength,
+										   toast_pointer.va_extsize - hdrsz);
+	result = toast_fetch_datum_slice(attr, 0, max_size + hdrsz);
+
+	if (TOAST_COMPRESS_METHOD(result) != TOAST_PGLZ_COMPRESSION_ID &&
+		max_size + hdrsz < toast_pointer.va_extsize)
+	{
+		pfree(result);
+		result = toast_fetch_datum(attr);
+	}
+
+	return result;
+}
+
+/* ----------
+ * create_detoast_iterator -
+ *
+ *	Set up to read a varlena datum from the start, detoasting only as much
+ *	of it as the caller asks for with detoast_iterate.  Out-of-line and
+ *	compressed values are fetched and decompressed a prefix at a time; any
+ *	other value is made available in full right away.
+ * ----------
+ */
+DetoastIterator
+create_detoast_iterator(struct varlena * attr)
+{
+	DetoastIterator iter = (DetoastIterator) palloc(sizeof(DetoastIteratorData));
+
+	iter->attr = attr;
+	iter->compressed = NULL;
+	iter->buf = NULL;
+
+	if (VARATT_IS_EXTERNAL_ONDISK(attr) || VARATT_IS_COMPRESSED(attr))
+	{
+		iter->data = NULL;
+		iter->rawsize = toast_raw_datum_size(PointerGetDatum(attr)) - VARHDRSZ;
+		iter->done = 0;
+	}
+	else
+	{
+		struct varlena *value = attr;
+
+		/* this also copies short-header values, so that data is aligned */
+		if (VARATT_IS_EXTENDED(attr))
+			value = iter->buf = heap_tuple_untoast_attr(attr);
+
+		iter->data = VARDATA(value);
+		iter->rawsize = VARSIZE(value) - VARHDRSZ;
+		iter->done = iter->rawsize;
+	}
+
+	return iter;
+}
+
+/* ----------
+ * detoast_iterate -
+ *
+ *	Make sure at least the first upto bytes of the value are available at
+ *	iter->data.  The data may move, so pointers into it must be recomputed
+ *	afterwards.
+ *
+ *	Every call decompresses the value from its start again, since the
+ *	decompressors can't resume where they stopped.  To keep the total work
+ *	proportional to what is finally read, the prefix at least doubles each
+ *	time.  Once an out-of-line compressed value has been fetched in full,
+ *	as LZ4 values always are, it is kept, so that later calls only need to
+ *	decompress it.
+ * ----------
+ */
+void
+detoast_iterate(DetoastIterator iter, int32 upto)
+{
+	struct varlena *oldbuf = iter->buf;
+	struct varlena *source;
+	struct varlena *fetched = NULL;
+	struct varatt_external toast_pointer;
+	int64		want;
+
+	if (upto <= iter->done)
+		return;
+
+	if (upto > iter->rawsize)
+		elog(ERROR, "unexpected end of toasted value");
+
+	want = Max((int64) upto, (int64) iter->done * 2);
+	want = Max(want, TOAST_MAX_CHUNK_SIZE);
+	want = Min(want, iter->rawsize);
+
+	source = iter->attr;
+	if (iter->compressed != NULL)
+		source = iter->compressed;
+	else if (VARATT_IS_EXTERNAL_ONDISK(iter->attr))
+	{
+		VARATT_EXTERNAL_GET_POINTER(toast_pointer, iter->attr);
+		if (VARATT_EXTERNAL_IS_COMPRESSED(toast_pointer))
+		{
+			if (want < iter->rawsize)
+				fetched = toast_fetch_compressed_prefix(iter->attr,
+														(int32) want);
+			else
+				fetched = toast_fetch_datum(iter->attr);
+			source = fetched;
+
+			if (VARSIZE(fetched) - VARHDRSZ >= toast_pointer.va_extsize)
+				iter->compressed = fetched;
+		}
+	}
+
+	iter->buf = heap_tuple_untoast_attr_slice(source, 0, (int32) want);
+	iter->data = VARDATA(iter->buf);
+	iter->done = VARSIZE(iter->buf) - VARHDRSZ;
+
+	if (fetched != NULL && fetched != iter->compressed)
+		pfree(fetched);
+	if (oldbuf != NULL)
+		pfree(oldbuf);
+
+	if (iter->done < upto)
+		elog(ERROR, "unexpected end of toasted value");
+}
+
+/* ----------
+ * free_detoast_iterator -
+ *
+ *	Release an iterator and the data it detoasted.
+ * ----------
+ */
+void
+free_detoast_iterator(DetoastIterator iter)
+{
+	if (iter->compressed != NULL)
+		pfree(iter->compressed);
+	if (iter->buf != NULL)
+		pfree(iter->buf);
+	pfree(iter);
+}
+
+
 /* ----------
  * toast_raw_datum_size -
  *
@@ -557,6 +751,8 @@ toast_insert_or_update(Relation rel, HeapTuple newtup, HeapTuple oldtup,
 	int32		toast_sizes[MaxHeapAttributeNumber];
 	bool		toast_free[MaxHeapAttributeNumber];
 	bool		toast_delold[MaxHeapAttributeNumber];
+	int			toast_cmethod[MaxHeapAttributeNumber];
+	bool		have_cmethods = false;
 
 	/*
 	 * Ignore the INSERT_SPECULATIVE option. Speculative insertions/super
@@ -771,8 +967,14 @@ toast_insert_or_update(Relation rel, HeapTuple newtup, HeapTuple oldtup,
 		i = biggest_attno;
 		if (att[i]->attstorage == 'x')
 		{
+			/* look up the columns' compression methods on first use */
+			if (!have_cmethods)
+			{
+				toast_compression_methods(rel, toast_cmethod);
+				have_cmethods = true;
+			}
 			old_value = toast_values[i];
-			new_value = toast_compress_datum(old_value);
+			new_value = toast_compress_datum(old_value, toast_cmethod[i]);
 
 			if (DatumGetPointer(new_value) != NULL)
 			{
@@ -910,8 +1112,13 @@ toast_insert_or_update(Relation rel, HeapTuple newtup, HeapTuple oldtup,
 		 * Attempt to compress it inline
 		 */
 		i = biggest_attno;
+		if (!have_cmethods)
+		{
+			toast_compression_methods(rel, toast_cmethod);
+			have_cmethods = true;
+		}
 		old_value = toast_values[i];
-		new_value = toast_compress_datum(old_value);
+		new_value = toast_compress_datum(old_value, toast_cmethod[i]);
 
 		if (DatumGetPointer(new_value) != NULL)
 		{
@@ -1295,12 +1502,14 @@ toast_flatten_tuple_to_datum(HeapTupleHeader tup,
  *	then return NULL.  We must not use compressed data if it'd expand
  *	the tuple!
  *
+ *	cmethod is the ToastCompressionId of the method to use.
+ *
  *	We use VAR{SIZE,DATA}_ANY so we can handle short varlenas here without
  *	copying them.  But we can't handle external or compressed datums.
  * ----------
  */
 Datum
-toast_compress_datum(Datum value)
+toast_compress_datum(Datum value, int cmethod)
 {
 	struct varlena *tmp;
 	int32		valsize = VARSIZE_ANY_EXHDR(DatumGetPointer(value));
@@ -1311,17 +1520,14 @@ toast_compress_datum(Datum value)
 
 	/*
 	 * No point in wasting a palloc cycle if value size is out of the allowed
-	 * range for compression
+	 * range for compression.  pglz's limits serve for all methods.
 	 */
 	if (valsize < PGLZ_strategy_default->min_input_size ||
 		valsize > PGLZ_strategy_default->max_input_size)
 		return PointerGetDatum(NULL);
 
-	tmp = (struct varlena *) palloc(PGLZ_MAX_OUTPUT(valsize) +
-									TOAST_COMPRESS_HDRSZ);
-
 	/*
-	 * We recheck the actual size even if pglz_compress() reports success,
+	 * We recheck the actual size even if the compressor reports success,
 	 * because it might be satisfied with having saved as little as one byte
 	 * in the compressed data --- which could turn into a net loss once you
 	 * consider header and alignment padding.  Worst case, the compressed
@@ -1330,14 +1536,44 @@ toast_compress_datum(Datum value)
 	 * only one header byte and no padding if the value is short enough.  So
 	 * we insist on a savings of more than 2 bytes to ensure we have a gain.
 	 */
-	len = pglz_compress(VARDATA_ANY(DatumGetPointer(value)),
-						valsize,
-						TOAST_COMPRESS_RAWDATA(tmp),
-						PGLZ_strategy_default);
+	switch (cmethod)
+	{
+		case TOAST_PGLZ_COMPRESSION_ID:
+			tmp = (struct varlena *) palloc(PGLZ_MAX_OUTPUT(valsize) +
+											TOAST_COMPRESS_HDRSZ);
+			len = pglz_compress(VARDATA_ANY(DatumGetPointer(value)),
+								valsize,
+								TOAST_COMPRESS_RAWDATA(tmp),
+								PGLZ_strategy_default);
+			break;
+		case TOAST_LZ4_COMPRESSION_ID:
+#ifdef USE_LZ4
+
+			/*
+			 * Give LZ4 only as much room as a useful result may take; it
+			 * gives up as soon as the output doesn't fit.
+			 */
+			tmp = (struct varlena *) palloc(valsize);
+			len = LZ4_compress_default(VARDATA_ANY(DatumGetPointer(value)),
+									   TOAST_COMPRESS_RAWDATA(tmp),
+									   valsize,
+									   valsize - TOAST_COMPRESS_HDRSZ - 3);
+			if (len == 0)
+				len = -1;
+			break;
+#else
+			NO_LZ4_SUPPORT();
+			return PointerGetDatum(NULL);		/* keep compiler quiet */
+#endif
+		default:
+			elog(ERROR, "invalid compression method %d", cmethod);
+			return PointerGetDatum(NULL);		/* keep compiler quiet */
+	}
+
 	if (len >= 0 &&
 		len + TOAST_COMPRESS_HDRSZ < valsize - 2)
 	{
-		TOAST_COMPRESS_SET_RAWSIZE(tmp, valsize);
+		TOAST_COMPRESS_SET_RAWSIZE(tmp, valsize, cmethod);
 		SET_VARSIZE_COMPRESSED(tmp, len + TOAST_COMPRESS_HDRSZ);
 		/* successful compression */
 		return PointerGetDatum(tmp);
@@ -1998,10 +2234,11 @@ toast_fetch_datum_slice(struct varlena * attr, int32 sliceoffset, int32 length)
 	VARATT_EXTERNAL_GET_POINTER(toast_pointer, attr);
 
 	/*
-	 * It's nonsense to fetch slices of a compressed datum -- this isn't lo_*
-	 * we can't return a compressed datum which is meaningful to toast later
+	 * It's meaningless to fetch a slice from the middle of a compressed
+	 * datum, but a prefix of one can be decompressed as far as it goes; see
+	 * heap_tuple_untoast_attr_slice.
 	 */
-	Assert(!VARATT_EXTERNAL_IS_COMPRESSED(toast_pointer));
+	Assert(!VARATT_EXTERNAL_IS_COMPRESSED(toast_pointer) || sliceoffset == 0);
 
 	attrsize = toast_pointer.va_extsize;
 	totalchunks = ((attrsize - 1) / TOAST_MAX_CHUNK_SIZE) + 1;
@@ -2195,6 +2432,7 @@ static struct varlena *
 toast_decompress_datum(struct varlena * attr)
 {
 	struct varlena *result;
+	int32		rawsize;
 
 	Assert(VARATT_IS_COMPRESSED(attr));
 
@@ -2202,15 +2440,195 @@ toast_decompress_datum(struct varlena * attr)
 		palloc(TOAST_COMPRESS_RAWSIZE(attr) + VARHDRSZ);
 	SET_VARSIZE(result, TOAST_COMPRESS_RAWSIZE(attr) + VARHDRSZ);
 
-	if (pglz_decompress(TOAST_COMPRESS_RAWDATA(attr),
-						VARSIZE(attr) - TOAST_COMPRESS_HDRSZ,
-						VARDATA(result),
-						TOAST_COMPRESS_RAWSIZE(attr)) < 0)
+	switch (TOAST_COMPRESS_METHOD(attr))
+	{
+		case TOAST_PGLZ_COMPRESSION_ID:
+			rawsize = pglz_decompress(TOAST_COMPRESS_RAWDATA(attr),
+									  VARSIZE(attr) - TOAST_COMPRESS_HDRSZ,
+									  VARDATA(result),
+									  TOAST_COMPRESS_RAWSIZE(attr), true);
+			break;
+		case TOAST_LZ4_COMPRESSION_ID:
+#ifdef USE_LZ4
+			rawsize = LZ4_decompress_safe(TOAST_COMPRESS_RAWDATA(attr),
+										  VARDATA(result),
+										  VARSIZE(attr) - TOAST_COMPRESS_HDRSZ,
+										  TOAST_COMPRESS_RAWSIZE(attr));
+			break;
+#else
+			NO_LZ4_SUPPORT();
+#endif
+		default:
+			rawsize = -1;
+			break;
+	}
+
+	if (rawsize != TOAST_COMPRESS_RAWSIZE(attr))
 		elog(ERROR, "compressed data is corrupted");
 
 	return result;
 }
 
+/* ----------
+ * toast_decompress_datum_slice -
+ *
+ * Decompress the first slicelength bytes of a compressed version of a
+ * varlena datum.  attr may hold just a prefix of the compressed data, as
+ * long as that is enough to produce the slice.
+ */
+static struct varlena *
+toast_decompress_datum_slice(struct varlena * attr, int32 slicelength)
+{
+	struct varlena *result;
+	int32		rawsize;
+
+	Assert(VARATT_IS_COMPRESSED(attr));
+
+	result = (struct varlena *) palloc(slicelength + VARHDRSZ);
+
+	switch (TOAST_COMPRESS_METHOD(attr))
+	{
+		case TOAST_PGLZ_COMPRESSION_ID:
+			rawsize = pglz_decompress(TOAST_COMPRESS_RAWDATA(attr),
+									  VARSIZE(attr) - TOAST_COMPRESS_HDRSZ,
+									  VARDATA(result),
+									  slicelength, false);
+			break;
+		case TOAST_LZ4_COMPRESSION_ID:
+#ifdef USE_LZ4
+			rawsize = LZ4_decompress_safe_partial(TOAST_COMPRESS_RAWDATA(attr),
+												  VARDATA(result),
+										 VARSIZE(attr) - TOAST_COMPRESS_HDRSZ,
+												  slicelength,
+												  slicelength);
+			break;
+#else
+			NO_LZ4_SUPPORT();
+#endif
+		default:
+			rawsize = -1;
+			break;
+	}
+
+	if (rawsize < 0)
+		elog(ERROR, "compressed data is corrupted");
+
+	SET_VARSIZE(result, rawsize + VARHDRSZ);
+
+	return result;
+}
+
+/* ----------
+ * toast_compression_methods -
+ *
+ *	Choose the compression method for each column of a table: the one named
+ *	by the column's compression option, or else default_toast_compression.
+ *	Only columns that can be compressed inline have their options looked up.
+ * ----------
+ */
+static void
+toast_compression_methods(Relation rel, int *cmethods)
+{
+	TupleDesc	tupleDesc = RelationGetDescr(rel);
+	int			i;
+
+	for (i = 0; i < tupleDesc->natts; i++)
+	{
+		Form_pg_attribute att = tupleDesc->attrs[i];
+		AttributeOpts *aopt;
+
+		cmethods[i] = default_toast_compression;
+
+		/* attribute options can't be looked up while bootstrapping */
+		if (IsBootstrapProcessingMode())
+			continue;
+		if (att->attlen != -1 ||
+			(att->attstorage != 'x' && att->attstorage != 'm'))
+			continue;
+
+		aopt = get_attribute_options(RelationGetRelid(rel), i + 1);
+		if (aopt != NULL)
+		{
+			if (aopt->compression_offset != 0)
+			{
+				char	   *name = (char *) aopt + aopt->compression_offset;
+
+				if (strcmp(name, "lz4") == 0)
+					cmethods[i] = TOAST_LZ4_COMPRESSION_ID;
+				else
+					cmethods[i] = TOAST_PGLZ_COMPRESSION_ID;
+			}
+			pfree(aopt);
+		}
+	}
+}
+
+/* ----------
+ * toast_validate_compression_option -
+ *
+ *	Validate the compression option of a column.  LZ4 is accepted only if
+ *	this build can use it.
+ * ----------
+ */
+void
+toast_validate_compression_option(char *value)
+{
+	if (value == NULL ||
+		(strcmp(value, "pglz") != 0 &&
+		 strcmp(value, "lz4") != 0))
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("invalid value for \"compression\" option"),
+				 errdetail("Valid values are \"pglz\" and \"lz4\".")));
+#ifndef USE_LZ4
+	if (strcmp(value, "lz4") == 0)
+		NO_LZ4_SUPPORT();
+#endif
+}
+
+/* ----------
+ * toast_get_compression_id -
+ *
+ *	Return the ToastCompressionId of the method a varlena datum is
+ *	compressed with, or -1 if it isn't compressed.  A compressed value
+ *	stored out of line must be fetched to find out.
+ * ----------
+ */
+int
+toast_get_compression_id(struct varlena * attr)
+{
+	int			cmethod = -1;
+
+	if (VARATT_IS_EXTERNAL_ONDISK(attr))
+	{
+		struct varatt_external toast_pointer;
+
+		VARATT_EXTERNAL_GET_POINTER(toast_pointer, attr);
+		if (VARATT_EXTERNAL_IS_COMPRESSED(toast_pointer))
+		{
+			struct varlena *tmp = toast_fetch_datum(attr);
+
+			cmethod = TOAST_COMPRESS_METHOD(tmp);
+			pfree(tmp);
+		}
+	}
+	else if (VARATT_IS_EXTERNAL_INDIRECT(attr))
+	{
+		struct varatt_indirect redirect;
+
+		VARATT_EXTERNAL_GET_POINTER(redirect, attr);
+
+		/* nested indirect Datums aren't allowed */
+		Assert(!VARATT_IS_EXTERNAL_INDIRECT(redirect.pointer));
+
+		cmethod = toast_get_compression_id(redirect.pointer);
+	}
+	else if (VARATT_IS_COMPRESSED(attr))
+		cmethod = TOAST_COMPRESS_METHOD(attr);
+
+	return cmethod;
+}
+
 
 /* ----------
  * toast_open_indexes
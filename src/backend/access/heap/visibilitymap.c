@@ -627,7 +627,7 @@ vm_extend(Relation rel, BlockNumber vm_nblocks)
 	if ((rel->rd_smgr->smgr_vm_nblocks == 0 ||
 		 rel->rd_smgr->smgr_vm_nblocks == InvalidBlockNumber) &&
 		!smgrexists(rel->rd_smgr, VISIBILITYMAP_FORKNUM))
-		smgrcreate(rel->rd_smgr, VISIBILITYMAP_FORKNUM, false);
+		smgrcreate(rel->rd_smgr, VISIBILITYMAP_FORKNUM, false, false);
 
 	vm_nblocks_now = smgrnblocks(rel->rd_smgr, VISIBILITYMAP_FORKNUM);
 
@@ -97,6 +97,7 @@ bthandler(PG_FUNCTION_ARGS)
 	amroutine->amstorage = false;
 	amroutine->amclusterable = true;
 	amroutine->ampredlocks = true;
+	amroutine->amcanparallelvacuum = true;
 	amroutine->amkeytype = InvalidOid;
 
 	amroutine->ambuild = btbuild;
@@ -30,6 +30,8 @@ smgr_desc(StringInfo buf, XLogReaderState *record)
 		char	   *path = relpathperm(xlrec->rnode, xlrec->forkNum);
 
 		appendStringInfoString(buf, path);
+		if (xlrec->compressed)
+			appendStringInfoString(buf, " compressed");
 		pfree(path);
 	}
 	else if (info == XLOG_SMGR_TRUNCATE)
@@ -0,0 +1,145 @@
+/*-------------------------------------------------------------------------
+ *
+ * tableamapi.c
+ *	  Support routines for API for Postgres table access methods.
+ *
+ * Copyright (c) 2016, PostgreSQL Global Development Group
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/access/table/tableamapi.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/htup_details.h"
+#include "access/tableam.h"
+#include "catalog/pg_am.h"
+#include "utils/catcache.h"
+#include "utils/fmgroids.h"
+#include "utils/memutils.h"
+#include "utils/syscache.h"
+
+
+/*
+ * The API structs we have handed out, one per handler function.  Every
+ * relcache entry of a table points to one of them, so they are never freed.
+ */
+typedef struct TableAmCacheEntry
+{
+	Oid			amhandler;
+	TableAmRoutine *routine;
+} TableAmCacheEntry;
+
+static List *table_am_cache = NIL;
+
+
+/*
+ * GetTableAmRoutine - call the specified access method handler routine to get
+ * its TableAmRoutine struct.
+ *
+ * The handler is only called the first time; the struct is kept in
+ * CacheMemoryContext and returned again on later calls.  Tables whose access
+ * methods share a handler therefore share the struct, so comparing the
+ * pointers tells whether two tables store their data the same way.
+ *
+ * Like GetIndexAmRoutine, this doesn't involve any catalog access if the
+ * amhandler function is built-in, so it's safe to use while bootstrapping.
+ */
+const TableAmRoutine *
+GetTableAmRoutine(Oid amhandler)
+{
+	ListCell   *lc;
+	Datum		datum;
+	TableAmRoutine *routine;
+	TableAmCacheEntry *entry;
+	MemoryContext oldcxt;
+
+	foreach(lc, table_am_cache)
+	{
+		entry = (TableAmCacheEntry *) lfirst(lc);
+		if (entry->amhandler == amhandler)
+			return entry->routine;
+	}
+
+	datum = OidFunctionCall0(amhandler);
+	routine = (TableAmRoutine *) DatumGetPointer(datum);
+
+	if (routine == NULL || !IsA(routine, TableAmRoutine))
+		elog(ERROR, "table access method handler function %u did not return a TableAmRoutine struct",
+			 amhandler);
+
+	if (!CacheMemoryContext)
+		CreateCacheMemoryContext();
+	oldcxt = MemoryContextSwitchTo(CacheMemoryContext);
+
+	entry = (TableAmCacheEntry *) palloc(sizeof(TableAmCacheEntry));
+	entry->amhandler = amhandler;
+	entry->routine = (TableAmRoutine *) palloc(sizeof(TableAmRoutine));
+	memcpy(entry->routine, routine, sizeof(TableAmRoutine));
+	table_am_cache = lappend(table_am_cache, entry);
+
+	MemoryContextSwitchTo(oldcxt);
+
+	pfree(routine);
+
+	return entry->routine;
+}
+
+/*
+ * GetTableAmRoutineByAmId - look up the handler of the table access method
+ * with the given OID, and get its TableAmRoutine struct.
+ */
+const TableAmRoutine *
+GetTableAmRoutineByAmId(Oid amoid)
+{
+	HeapTuple	tuple;
+	Form_pg_am	amform;
+	regproc		amhandler;
+
+	/* Get handler function OID for the access method */
+	tuple = SearchSysCache1(AMOID, ObjectIdGetDatum(amoid));
+	if (!HeapTupleIsValid(tuple))
+		elog(ERROR, "cache lookup failed for access method %u",
+			 amoid);
+	amform = (Form_pg_am) GETSTRUCT(tuple);
+
+	/* Check if it's table access method */
+	if (amform->amtype != AMTYPE_TABLE)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("access method \"%s\" is not of type %s",
+						NameStr(amform->amname), "TABLE")));
+
+	amhandler = amform->amhandler;
+
+	/* Complain if handler OID is invalid */
+	if (!RegProcedureIsValid(amhandler))
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("table access method \"%s\" does not have a handler",
+						NameStr(amform->amname))));
+
+	ReleaseSysCache(tuple);
+
+	/* And finally, call the handler function to get the API struct. */
+	return GetTableAmRoutine(amhandler);
+}
+
+/*
+ * GetHeapamTableAmRoutine - get the TableAmRoutine struct of the heap.
+ *
+ * This is what tables with relam = InvalidOid use, which includes all the
+ * system catalogs.
+ */
+const TableAmRoutine *
+GetHeapamTableAmRoutine(void)
+{
+	static const TableAmRoutine *heap_routine = NULL;
+
+	if (heap_routine == NULL)
+		heap_routine = GetTableAmRoutine(F_HEAP_TABLEAM_HANDLER);
+
+	return heap_routine;
+}
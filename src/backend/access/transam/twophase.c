@@ -1335,6 +1335,7 @@ FinishPreparedTransaction(const char *gid, bool isCommit)
 	RelFileNode *delrels;
 	int			ndelrels;
 	SharedInvalidationMessage *invalmsgs;
+	bool		initfilelocked;
 	int			i;
 
 	/*
@@ -1439,10 +1440,15 @@ FinishPreparedTransaction(const char *gid, bool isCommit)
 	 * Relcache init file invalidation requires processing both before and
 	 * after we send the SI messages. See AtEOXact_Inval()
 	 */
-	if (hdr->initfileinval)
+	initfilelocked = hdr->initfileinval;
+	if (initfilelocked)
 		RelationCacheInitFilePreInvalidate();
+	else
+		initfilelocked = PreInvalidatePreloadedRels(invalmsgs,
+													hdr->ninvalmsgs,
+													MyDatabaseId);
 	SendSharedInvalidMessages(invalmsgs, hdr->ninvalmsgs);
-	if (hdr->initfileinval)
+	if (initfilelocked)
 		RelationCacheInitFilePostInvalidate();
 
 	/* And now do the callbacks */
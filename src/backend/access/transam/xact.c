@@ -688,11 +688,12 @@ GetCurrentCommandId(bool used)
 	{
 		/*
 		 * Forbid setting currentCommandIdUsed in parallel mode, because we
-		 * have no provision for communicating this back to the master.  We
-		 * could relax this restriction when currentCommandIdUsed was already
-		 * true at the start of the parallel operation.
+		 * have no provision for communicating this back to the master.  It's
+		 * OK if it was already true at the start of the parallel operation,
+		 * as it is when the workers of a parallel COPY FROM insert tuples.
 		 */
-		Assert(CurrentTransactionState->parallelModeLevel == 0);
+		Assert(CurrentTransactionState->parallelModeLevel == 0 ||
+			   currentCommandIdUsed);
 		currentCommandIdUsed = true;
 	}
 	return currentCommandId;
@@ -4812,8 +4813,9 @@ Size
 EstimateTransactionStateSpace(void)
 {
 	TransactionState s;
-	Size		nxids = 6;		/* iso level, deferrable, top & current XID,
-								 * command counter, XID count */
+	Size		nxids = 7;		/* iso level, deferrable, top & current XID,
+								 * command counter and whether it's used,
+								 * XID count */
 
 	for (s = CurrentTransactionState; s != NULL; s = s->parent)
 	{
@@ -4836,10 +4838,11 @@ EstimateTransactionStateSpace(void)
  * contain XactDeferrable and XactIsoLevel; the next twelve bytes contain the
  * XID of the top-level transaction, the XID of the current transaction
  * (or, in each case, InvalidTransactionId if none), and the current command
- * counter.  After that, the next 4 bytes contain a count of how many
- * additional XIDs follow; this is followed by all of those XIDs one after
- * another.  We emit the XIDs in sorted order for the convenience of the
- * receiving process.
+ * counter.  The next 4 bytes tell whether the command counter has been used
+ * to mark tuples already.  After that, the next 4 bytes contain a count of
+ * how many additional XIDs follow; this is followed by all of those XIDs one
+ * after another.  We emit the XIDs in sorted order for the convenience of
+ * the receiving process.
  */
 void
 SerializeTransactionState(Size maxsize, char *start_address)
@@ -4856,6 +4859,7 @@ SerializeTransactionState(Size maxsize, char *start_address)
 	result[c++] = XactTopTransactionId;
 	result[c++] = CurrentTransactionState->transactionId;
 	result[c++] = (TransactionId) currentCommandId;
+	result[c++] = (TransactionId) currentCommandIdUsed;
 	Assert(maxsize >= c * sizeof(TransactionId));
 
 	/*
@@ -4922,8 +4926,9 @@ StartParallelWorkerTransaction(char *tstatespace)
 	XactTopTransactionId = tstate[2];
 	CurrentTransactionState->transactionId = tstate[3];
 	currentCommandId = tstate[4];
-	nParallelCurrentXids = (int) tstate[5];
-	ParallelCurrentXids = &tstate[6];
+	currentCommandIdUsed = (bool) tstate[5];
+	nParallelCurrentXids = (int) tstate[6];
+	ParallelCurrentXids = &tstate[7];
 
 	CurrentTransactionState->blockState = TBLOCK_PARALLEL_INPROGRESS;
 }
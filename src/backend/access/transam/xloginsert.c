@@ -32,6 +32,10 @@
 #include "utils/memutils.h"
 #include "pg_trace.h"
 
+#ifdef USE_LZ4
+#include <lz4.h>
+#endif
+
 /* Buffer size required to store a compressed version of backup block image */
 #define PGLZ_MAX_BLCKSZ PGLZ_MAX_OUTPUT(BLCKSZ)
 
@@ -76,6 +80,15 @@ static uint32 mainrdata_len;	/* total # of bytes in chain */
 /* Should the in-progress insertion log the origin? */
 static bool include_origin = false;
 
+/*
+ * Buffers used to compress the block data and main data of a record, see
+ * XLogCompressData().  They are allocated in advance, because records are
+ * normally assembled in a critical section.
+ */
+static char *uncompressed_data = NULL;
+static char *compressed_data = NULL;
+static XLogRecData compressed_rdt;
+
 /*
  * These are used to hold the record header while constructing a record.
  * 'hdr_scratch' is not a plain variable, but is palloc'd at initialization,
@@ -91,6 +104,7 @@ static char *hdr_scratch = NULL;
 
 #define HEADER_SCRATCH_SIZE \
 	(SizeOfXLogRecord + \
+	 SizeOfXLogRecordCompressedDataHeader + \
 	 MaxSizeOfXLogRecordBlockHeader * (XLR_MAX_BLOCK_ID + 1) + \
 	 SizeOfXLogRecordDataHeaderLong + SizeOfXlogOrigin)
 
@@ -111,6 +125,8 @@ static XLogRecData *XLogRecordAssemble(RmgrId rmid, uint8 info,
 				   XLogRecPtr *fpw_lsn);
 static bool XLogCompressBackupBlock(char *page, uint16 hole_offset,
 						uint16 hole_length, char *dest, uint16 *dlen);
+static bool XLogCompressData(bool *needs_data, uint32 len, uint8 *method,
+				 uint32 *dlen);
 
 /*
  * Begin constructing a WAL record. This must be called before the
@@ -483,6 +499,12 @@ XLogRecordAssemble(RmgrId rmid, uint8 info,
 	XLogRecData *rdt_datas_last;
 	XLogRecord *rechdr;
 	char	   *scratch = hdr_scratch;
+	bool		needs_backup[XLR_MAX_BLOCK_ID + 1];
+	bool		needs_data[XLR_MAX_BLOCK_ID + 1];
+	uint32		data_len = 0;
+	bool		data_compressed = false;
+	uint8		data_method = 0;
+	uint32		compressed_data_len = 0;
 
 	/*
 	 * Note: this function can be called multiple times for the same record.
@@ -498,32 +520,24 @@ XLogRecordAssemble(RmgrId rmid, uint8 info,
 	hdr_rdt.data = hdr_scratch;
 
 	/*
-	 * Make an rdata chain containing all the data portions of all block
-	 * references. This includes the data for full-page images. Also append
-	 * the headers for the block references in the scratch buffer.
+	 * Determine which blocks need to be backed up, and which need their
+	 * registered data included.
 	 */
 	*fpw_lsn = InvalidXLogRecPtr;
 	for (block_id = 0; block_id < max_registered_block_id; block_id++)
 	{
 		registered_buffer *regbuf = &registered_buffers[block_id];
-		bool		needs_backup;
-		bool		needs_data;
-		XLogRecordBlockHeader bkpb;
-		XLogRecordBlockImageHeader bimg;
-		XLogRecordBlockCompressHeader cbimg = {0};
-		bool		samerel;
-		bool		is_compressed = false;
 
 		if (!regbuf->in_use)
 			continue;
 
 		/* Determine if this block needs to be backed up */
 		if (regbuf->flags & REGBUF_FORCE_IMAGE)
-			needs_backup = true;
+			needs_backup[block_id] = true;
 		else if (regbuf->flags & REGBUF_NO_IMAGE)
-			needs_backup = false;
+			needs_backup[block_id] = false;
 		else if (!doPageWrites)
-			needs_backup = false;
+			needs_backup[block_id] = false;
 		else
 		{
 			/*
@@ -533,8 +547,8 @@ XLogRecordAssemble(RmgrId rmid, uint8 info,
 			 */
 			XLogRecPtr	page_lsn = PageGetLSN(regbuf->page);
 
-			needs_backup = (page_lsn <= RedoRecPtr);
-			if (!needs_backup)
+			needs_backup[block_id] = (page_lsn <= RedoRecPtr);
+			if (!needs_backup[block_id])
 			{
 				if (*fpw_lsn == InvalidXLogRecPtr || page_lsn < *fpw_lsn)
 					*fpw_lsn = page_lsn;
@@ -543,11 +557,58 @@ XLogRecordAssemble(RmgrId rmid, uint8 info,
 
 		/* Determine if the buffer data needs to included */
 		if (regbuf->rdata_len == 0)
-			needs_data = false;
+			needs_data[block_id] = false;
 		else if ((regbuf->flags & REGBUF_KEEP_DATA) != 0)
-			needs_data = true;
+			needs_data[block_id] = true;
 		else
-			needs_data = !needs_backup;
+			needs_data[block_id] = !needs_backup[block_id];
+
+		if (needs_data[block_id])
+			data_len += regbuf->rdata_len;
+	}
+	data_len += mainrdata_len;
+
+	/*
+	 * Compress the block data and main data together if there is enough of
+	 * it.  The header saying so goes first.  RM_XLOG_ID records are never
+	 * compressed: checkpoint records in particular are read back with
+	 * ReadCheckpointRecord, which insists on their exact uncompressed
+	 * length, and they are small anyway.
+	 */
+	if (wal_compression != WAL_COMPRESSION_NONE &&
+		rmid != RM_XLOG_ID &&
+		wal_compression_data_threshold >= 0 &&
+		data_len > 0 &&
+		data_len >= (uint32) wal_compression_data_threshold &&
+		data_len <= XLR_MAX_COMPRESSED_DATA)
+	{
+		data_compressed = XLogCompressData(needs_data, data_len,
+										   &data_method, &compressed_data_len);
+	}
+	if (data_compressed)
+	{
+		*(scratch++) = XLR_BLOCK_ID_COMPRESSED;
+		*(scratch++) = data_method;
+		memcpy(scratch, &compressed_data_len, sizeof(uint32));
+		scratch += sizeof(uint32);
+	}
+
+	/*
+	 * Make an rdata chain containing all the data portions of all block
+	 * references. This includes the data for full-page images. Also append
+	 * the headers for the block references in the scratch buffer.
+	 */
+	for (block_id = 0; block_id < max_registered_block_id; block_id++)
+	{
+		registered_buffer *regbuf = &registered_buffers[block_id];
+		XLogRecordBlockHeader bkpb;
+		XLogRecordBlockImageHeader bimg;
+		XLogRecordBlockCompressHeader cbimg = {0};
+		bool		samerel;
+		bool		is_compressed = false;
+
+		if (!regbuf->in_use)
+			continue;
 
 		bkpb.id = block_id;
 		bkpb.fork_flags = regbuf->forkno;
@@ -556,7 +617,7 @@ XLogRecordAssemble(RmgrId rmid, uint8 info,
 		if ((regbuf->flags & REGBUF_WILL_INIT) == REGBUF_WILL_INIT)
 			bkpb.fork_flags |= BKPBLOCK_WILL_INIT;
 
-		if (needs_backup)
+		if (needs_backup[block_id])
 		{
 			Page		page = regbuf->page;
 			uint16		compressed_len;
@@ -595,7 +656,7 @@ XLogRecordAssemble(RmgrId rmid, uint8 info,
 			/*
 			 * Try to compress a block image if wal_compression is enabled
 			 */
-			if (wal_compression)
+			if (wal_compression != WAL_COMPRESSION_NONE)
 			{
 				is_compressed =
 					XLogCompressBackupBlock(page, bimg.hole_offset,
@@ -622,6 +683,8 @@ XLogRecordAssemble(RmgrId rmid, uint8 info,
 			{
 				bimg.length = compressed_len;
 				bimg.bimg_info |= BKPIMAGE_IS_COMPRESSED;
+				if (wal_compression == WAL_COMPRESSION_LZ4)
+					bimg.bimg_info |= BKPIMAGE_COMPRESS_LZ4;
 
 				rdt_datas_last->data = regbuf->compressed_page;
 				rdt_datas_last->len = compressed_len;
@@ -654,18 +717,22 @@ XLogRecordAssemble(RmgrId rmid, uint8 info,
 			total_len += bimg.length;
 		}
 
-		if (needs_data)
+		if (needs_data[block_id])
 		{
+			bkpb.fork_flags |= BKPBLOCK_HAS_DATA;
+			bkpb.data_length = regbuf->rdata_len;
+
 			/*
 			 * Link the caller-supplied rdata chain for this buffer to the
-			 * overall list.
+			 * overall list, unless it's part of the compressed data.
 			 */
-			bkpb.fork_flags |= BKPBLOCK_HAS_DATA;
-			bkpb.data_length = regbuf->rdata_len;
-			total_len += regbuf->rdata_len;
+			if (!data_compressed)
+			{
+				total_len += regbuf->rdata_len;
 
-			rdt_datas_last->next = regbuf->rdata_head;
-			rdt_datas_last = regbuf->rdata_tail;
+				rdt_datas_last->next = regbuf->rdata_head;
+				rdt_datas_last = regbuf->rdata_tail;
+			}
 		}
 
 		if (prev_regbuf && RelFileNodeEquals(regbuf->rnode, prev_regbuf->rnode))
@@ -680,7 +747,7 @@ XLogRecordAssemble(RmgrId rmid, uint8 info,
 		/* Ok, copy the header to the scratch buffer */
 		memcpy(scratch, &bkpb, SizeOfXLogRecordBlockHeader);
 		scratch += SizeOfXLogRecordBlockHeader;
-		if (needs_backup)
+		if (needs_backup[block_id])
 		{
 			memcpy(scratch, &bimg, SizeOfXLogRecordBlockImageHeader);
 			scratch += SizeOfXLogRecordBlockImageHeader;
@@ -722,9 +789,22 @@ XLogRecordAssemble(RmgrId rmid, uint8 info,
 			*(scratch++) = XLR_BLOCK_ID_DATA_SHORT;
 			*(scratch++) = (uint8) mainrdata_len;
 		}
-		rdt_datas_last->next = mainrdata_head;
-		rdt_datas_last = mainrdata_last;
-		total_len += mainrdata_len;
+		if (!data_compressed)
+		{
+			rdt_datas_last->next = mainrdata_head;
+			rdt_datas_last = mainrdata_last;
+			total_len += mainrdata_len;
+		}
+	}
+
+	/* the compressed data, if any, comes after all the page images */
+	if (data_compressed)
+	{
+		compressed_rdt.data = compressed_data;
+		compressed_rdt.len = compressed_data_len;
+		rdt_datas_last->next = &compressed_rdt;
+		rdt_datas_last = &compressed_rdt;
+		total_len += compressed_data_len;
 	}
 	rdt_datas_last->next = NULL;
 
@@ -799,7 +879,31 @@ XLogCompressBackupBlock(char *page, uint16 hole_offset, uint16 hole_length,
 	 * see if the number of bytes saved by compression is larger than the
 	 * length of extra data needed for the compressed version of block image.
 	 */
-	len = pglz_compress(source, orig_len, dest, PGLZ_strategy_default);
+	switch (wal_compression)
+	{
+		case WAL_COMPRESSION_PGLZ:
+			len = pglz_compress(source, orig_len, dest, PGLZ_strategy_default);
+			break;
+
+		case WAL_COMPRESSION_LZ4:
+#ifdef USE_LZ4
+			/* no point in producing more than we could use */
+			len = LZ4_compress_default(source, dest, orig_len,
+									   orig_len - extra_bytes - 1);
+			if (len <= 0)
+				len = -1;		/* failure */
+#else
+			elog(ERROR, "LZ4 is not supported by this build");
+#endif
+			break;
+
+		default:
+			elog(ERROR, "unrecognized WAL compression method: %d",
+				 wal_compression);
+			len = -1;			/* keep compiler quiet */
+			break;
+	}
+
 	if (len >= 0 &&
 		len + extra_bytes < orig_len)
 	{
@@ -809,6 +913,91 @@ XLogCompressBackupBlock(char *page, uint16 hole_offset, uint16 hole_length,
 	return false;
 }
 
+/*
+ * Create a compressed version of the block data and main data of a record.
+ *
+ * The data registered with the blocks marked in needs_data, followed by the
+ * main data, len bytes in all, are compressed into compressed_data with the
+ * wal_compression method.  Returns FALSE if compression doesn't save more than
+ * the extra header it needs.  Otherwise, returns TRUE and sets 'method' and
+ * 'dlen' to the compression method and the length of the compressed data.
+ */
+static bool
+XLogCompressData(bool *needs_data, uint32 len, uint8 *method, uint32 *dlen)
+{
+	char	   *ptr = uncompressed_data;
+	int			block_id;
+	int32		clen;
+	XLogRecData *rdt;
+	uint32		left;
+
+	Assert(len <= XLR_MAX_COMPRESSED_DATA);
+
+	/* too little to ever pay for the header */
+	if (len <= SizeOfXLogRecordCompressedDataHeader + 1)
+		return false;
+
+	/* Gather the data into one contiguous buffer */
+	for (block_id = 0; block_id < max_registered_block_id; block_id++)
+	{
+		registered_buffer *regbuf = &registered_buffers[block_id];
+
+		if (!regbuf->in_use || !needs_data[block_id])
+			continue;
+
+		left = regbuf->rdata_len;
+		for (rdt = regbuf->rdata_head; left > 0; rdt = rdt->next)
+		{
+			memcpy(ptr, rdt->data, rdt->len);
+			ptr += rdt->len;
+			left -= rdt->len;
+		}
+	}
+	left = mainrdata_len;
+	for (rdt = mainrdata_head; left > 0; rdt = rdt->next)
+	{
+		memcpy(ptr, rdt->data, rdt->len);
+		ptr += rdt->len;
+		left -= rdt->len;
+	}
+	Assert(ptr - uncompressed_data == len);
+
+	switch (wal_compression)
+	{
+		case WAL_COMPRESSION_PGLZ:
+			*method = XLR_COMPRESS_PGLZ;
+			clen = pglz_compress(uncompressed_data, len, compressed_data,
+								 PGLZ_strategy_default);
+			break;
+
+		case WAL_COMPRESSION_LZ4:
+#ifdef USE_LZ4
+			*method = XLR_COMPRESS_LZ4;
+			clen = LZ4_compress_default(uncompressed_data, compressed_data, len,
+							 len - SizeOfXLogRecordCompressedDataHeader - 1);
+			if (clen <= 0)
+				clen = -1;		/* failure */
+#else
+			elog(ERROR, "LZ4 is not supported by this build");
+#endif
+			break;
+
+		default:
+			elog(ERROR, "unrecognized WAL compression method: %d",
+				 wal_compression);
+			clen = -1;			/* keep compiler quiet */
+			break;
+	}
+
+	if (clen >= 0 &&
+		clen + SizeOfXLogRecordCompressedDataHeader < len)
+	{
+		*dlen = (uint32) clen;	/* successful compression */
+		return true;
+	}
+	return false;
+}
+
 /*
  * Determine whether the buffer referenced has to be backed up.
  *
@@ -1022,4 +1211,15 @@ InitXLogInsert(void)
 	if (hdr_scratch == NULL)
 		hdr_scratch = MemoryContextAllocZero(xloginsert_cxt,
 											 HEADER_SCRATCH_SIZE);
+
+	/*
+	 * And buffers to compress record data in.  wal_compression can be
+	 * changed at any time, so we need them whether it's set or not.
+	 */
+	if (uncompressed_data == NULL)
+		uncompressed_data = MemoryContextAlloc(xloginsert_cxt,
+											   XLR_MAX_COMPRESSED_DATA);
+	if (compressed_data == NULL)
+		compressed_data = MemoryContextAlloc(xloginsert_cxt,
+							   PGLZ_MAX_OUTPUT(XLR_MAX_COMPRESSED_DATA));
 }
@@ -25,6 +25,10 @@
 #include "common/pg_lzcompress.h"
 #include "replication/origin.h"
 
+#ifdef USE_LZ4
+#include <lz4.h>
+#endif
+
 static bool allocate_recordbuf(XLogReaderState *state, uint32 reclength);
 
 static bool ValidXLogPageHeader(XLogReaderState *state, XLogRecPtr recptr,
@@ -133,6 +137,8 @@ XLogReaderFree(XLogReaderState *state)
 	}
 	if (state->main_data)
 		pfree(state->main_data);
+	if (state->decompress_buf)
+		pfree(state->decompress_buf);
 
 	pfree(state->errormsg_buf);
 	if (state->readRecordBuf)
@@ -989,6 +995,10 @@ DecodeXLogRecord(XLogReaderState *state, XLogRecord *record, char **errormsg)
 	uint32		datatotal;
 	RelFileNode *rnode = NULL;
 	uint8		block_id;
+	bool		data_compressed = false;
+	uint8		data_method = 0;
+	uint32		compressed_len = 0;
+	uint32		rawtotal = 0;
 
 	ResetDecoder(state);
 
@@ -1013,7 +1023,9 @@ DecodeXLogRecord(XLogReaderState *state, XLogRecord *record, char **errormsg)
 			COPY_HEADER_FIELD(&main_data_len, sizeof(uint8));
 
 			state->main_data_len = main_data_len;
-			datatotal += main_data_len;
+			rawtotal += main_data_len;
+			if (!data_compressed)
+				datatotal += main_data_len;
 			break;				/* by convention, the main data fragment is
 								 * always last */
 		}
@@ -1024,10 +1036,31 @@ DecodeXLogRecord(XLogReaderState *state, XLogRecord *record, char **errormsg)
 
 			COPY_HEADER_FIELD(&main_data_len, sizeof(uint32));
 			state->main_data_len = main_data_len;
-			datatotal += main_data_len;
+			/* don't let rawtotal overflow; it's checked below */
+			if (data_compressed && main_data_len > XLR_MAX_COMPRESSED_DATA)
+				main_data_len = XLR_MAX_COMPRESSED_DATA + 1;
+			rawtotal += main_data_len;
+			if (!data_compressed)
+				datatotal += main_data_len;
 			break;				/* by convention, the main data fragment is
 								 * always last */
 		}
+		else if (block_id == XLR_BLOCK_ID_COMPRESSED)
+		{
+			/* XLogRecordCompressedDataHeader, always the first fragment */
+			if (ptr != (char *) record + SizeOfXLogRecord + sizeof(uint8))
+			{
+				report_invalid_record(state,
+									  "out-of-order compressed data header at %X/%X",
+									  (uint32) (state->ReadRecPtr >> 32),
+									  (uint32) state->ReadRecPtr);
+				goto err;
+			}
+			COPY_HEADER_FIELD(&data_method, sizeof(uint8));
+			COPY_HEADER_FIELD(&compressed_len, sizeof(uint32));
+			data_compressed = true;
+			datatotal += compressed_len;
+		}
 		else if (block_id == XLR_BLOCK_ID_ORIGIN)
 		{
 			COPY_HEADER_FIELD(&state->record_origin, sizeof(RepOriginId));
@@ -1075,7 +1108,9 @@ DecodeXLogRecord(XLogReaderState *state, XLogRecord *record, char **errormsg)
 									  (uint32) (state->ReadRecPtr >> 32), (uint32) state->ReadRecPtr);
 				goto err;
 			}
-			datatotal += blk->data_len;
+			rawtotal += blk->data_len;
+			if (!data_compressed)
+				datatotal += blk->data_len;
 
 			if (blk->has_image)
 			{
@@ -1188,6 +1223,16 @@ DecodeXLogRecord(XLogReaderState *state, XLogRecord *record, char **errormsg)
 	if (remaining != datatotal)
 		goto shortdata_err;
 
+	if (data_compressed && rawtotal > XLR_MAX_COMPRESSED_DATA)
+	{
+		report_invalid_record(state,
+							  "compressed data length %u too long at %X/%X",
+							  (unsigned int) rawtotal,
+							  (uint32) (state->ReadRecPtr >> 32),
+							  (uint32) state->ReadRecPtr);
+		goto err;
+	}
+
 	/*
 	 * Ok, we've parsed the fragment headers, and verified that the total
 	 * length of the payload in the fragments is equal to the amount of data
@@ -1196,7 +1241,63 @@ DecodeXLogRecord(XLogReaderState *state, XLogRecord *record, char **errormsg)
 	 * We could just set up pointers into readRecordBuf, but we want to align
 	 * the data for the convenience of the callers. Backup images are not
 	 * copied, however; they don't need alignment.
+	 *
+	 * If the block data and main data are compressed, all the page images
+	 * come first, followed by the compressed data.  Find the images, and
+	 * decompress the rest to copy the data from.
 	 */
+	if (data_compressed)
+	{
+		int32		decompressed;
+
+		for (block_id = 0; block_id <= state->max_block_id; block_id++)
+		{
+			DecodedBkpBlock *blk = &state->blocks[block_id];
+
+			if (blk->in_use && blk->has_image)
+			{
+				blk->bkp_image = ptr;
+				ptr += blk->bimg_len;
+			}
+		}
+
+		if (!state->decompress_buf)
+			state->decompress_buf = palloc(XLR_MAX_COMPRESSED_DATA);
+
+		switch (data_method)
+		{
+			case XLR_COMPRESS_PGLZ:
+				decompressed = pglz_decompress(ptr, compressed_len,
+											   state->decompress_buf,
+											   rawtotal, true);
+				break;
+			case XLR_COMPRESS_LZ4:
+#ifdef USE_LZ4
+				decompressed = LZ4_decompress_safe(ptr, state->decompress_buf,
+												   compressed_len, rawtotal);
+				break;
+#else
+				report_invalid_record(state,
+									  "could not decompress data at %X/%X: LZ4 is not supported by this build",
+									  (uint32) (state->ReadRecPtr >> 32),
+									  (uint32) state->ReadRecPtr);
+				goto err;
+#endif
+			default:
+				decompressed = -1;
+				break;
+		}
+
+		if (decompressed != rawtotal)
+		{
+			report_invalid_record(state,
+								  "invalid compressed data at %X/%X",
+								  (uint32) (state->ReadRecPtr >> 32),
+								  (uint32) state->ReadRecPtr);
+			goto err;
+		}
+		ptr = state->decompress_buf;
+	}
 
 	/* block data first */
 	for (block_id = 0; block_id <= state->max_block_id; block_id++)
@@ -1205,7 +1306,7 @@ DecodeXLogRecord(XLogReaderState *state, XLogRecord *record, char **errormsg)
 
 		if (!blk->in_use)
 			continue;
-		if (blk->has_image)
+		if (blk->has_image && !data_compressed)
 		{
 			blk->bkp_image = ptr;
 			ptr += blk->bimg_len;
@@ -1327,9 +1428,27 @@ RestoreBlockImage(XLogReaderState *record, uint8 block_id, char *page)
 
 	if (bkpb->bimg_info & BKPIMAGE_IS_COMPRESSED)
 	{
+		int32		decompressed;
+
 		/* If a backup block image is compressed, decompress it */
-		if (pglz_decompress(ptr, bkpb->bimg_len, tmp,
-							BLCKSZ - bkpb->hole_length) < 0)
+		if (bkpb->bimg_info & BKPIMAGE_COMPRESS_LZ4)
+		{
+#ifdef USE_LZ4
+			decompressed = LZ4_decompress_safe(ptr, tmp, bkpb->bimg_len,
+											   BLCKSZ - bkpb->hole_length);
+#else
+			report_invalid_record(record, "could not restore image at %X/%X compressed with LZ4, block %d: not supported by this build",
+								  (uint32) (record->ReadRecPtr >> 32),
+								  (uint32) record->ReadRecPtr,
+								  block_id);
+			return false;
+#endif
+		}
+		else
+			decompressed = pglz_decompress(ptr, bkpb->bimg_len, tmp,
+										   BLCKSZ - bkpb->hole_length, true);
+
+		if (decompressed != BLCKSZ - bkpb->hole_length)
 		{
 			report_invalid_record(record, "invalid compressed image at %X/%X, block %d",
 								  (uint32) (record->ReadRecPtr >> 32),
@@ -451,7 +451,7 @@ XLogReadBufferExtended(RelFileNode rnode, ForkNumber forknum,
 	 * filesystem loses an inode during a crash.  Better to write the data
 	 * until we are actually told to delete the file.)
 	 */
-	smgrcreate(smgr, forknum, true);
+	smgrcreate(smgr, forknum, true, false);
 
 	lastblock = smgrnblocks(smgr, forknum);
 
@@ -238,6 +238,7 @@ Boot_CreateStmt:
 													  $7,
 													  InvalidOid,
 													  BOOTSTRAP_SUPERUSERID,
+													  InvalidOid,
 													  tupdesc,
 													  NIL,
 													  RELKIND_RELATION,
@@ -41,6 +41,7 @@
 #include "catalog/heap.h"
 #include "catalog/index.h"
 #include "catalog/objectaccess.h"
+#include "catalog/pg_am.h"
 #include "catalog/pg_attrdef.h"
 #include "catalog/pg_collation.h"
 #include "catalog/pg_constraint.h"
@@ -993,6 +994,7 @@ AddNewRelationType(const char *typeName,
  *	reltypeid: OID to assign to rel's rowtype, or InvalidOid to select one
  *	reloftypeid: if a typed table, OID of underlying type; else InvalidOid
  *	ownerid: OID of new rel's owner
+ *	accessmtd: OID of the table access method, or InvalidOid for the heap
  *	tupdesc: tuple descriptor (source of column definitions)
  *	cooked_constraints: list of precooked check constraints and defaults
  *	relkind: relkind for new rel
@@ -1022,6 +1024,7 @@ heap_create_with_catalog(const char *relname,
 						 Oid reltypeid,
 						 Oid reloftypeid,
 						 Oid ownerid,
+						 Oid accessmtd,
 						 TupleDesc tupdesc,
 						 List *cooked_constraints,
 						 char relkind,
@@ -1171,6 +1174,18 @@ heap_create_with_catalog(const char *relname,
 
 	Assert(relid == RelationGetRelid(new_rel_desc));
 
+	/*
+	 * heap_create set the relcache entry up for the heap; switch it to the
+	 * requested table access method, which AddNewRelationTuple will also
+	 * store in pg_class.
+	 */
+	if (OidIsValid(accessmtd))
+	{
+		Assert(relkind == RELKIND_RELATION || relkind == RELKIND_MATVIEW);
+		new_rel_desc->rd_rel->relam = accessmtd;
+		RelationInitTableAccessMethod(new_rel_desc);
+	}
+
 	/*
 	 * Decide whether to create an array type over the relation's rowtype. We
 	 * do not create any array types for system catalogs (ie, those made
@@ -1319,6 +1334,14 @@ heap_create_with_catalog(const char *relname,
 			recordDependencyOn(&myself, &referenced, DEPENDENCY_NORMAL);
 		}
 
+		if (OidIsValid(accessmtd))
+		{
+			referenced.classId = AccessMethodRelationId;
+			referenced.objectId = accessmtd;
+			referenced.objectSubId = 0;
+			recordDependencyOn(&myself, &referenced, DEPENDENCY_NORMAL);
+		}
+
 		if (relacl != NULL)
 		{
 			int			nnewmembers;
@@ -1377,10 +1400,13 @@ heap_create_with_catalog(const char *relname,
 void
 heap_create_init_fork(Relation rel)
 {
+	bool		compress = UsePageCompression(rel->rd_node.spcNode);
+
 	RelationOpenSmgr(rel);
-	smgrcreate(rel->rd_smgr, INIT_FORKNUM, false);
+	smgrcreate(rel->rd_smgr, INIT_FORKNUM, false, compress);
 	if (XLogIsNeeded())
-		log_smgrcreate(&rel->rd_smgr->smgr_rnode.node, INIT_FORKNUM);
+		log_smgrcreate(&rel->rd_smgr->smgr_rnode.node, INIT_FORKNUM,
+					   compress);
 	smgrimmedsync(rel->rd_smgr, INIT_FORKNUM);
 }
 
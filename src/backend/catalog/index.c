@@ -2033,7 +2033,8 @@ index_build(Relation heapRelation,
 		!smgrexists(indexRelation->rd_smgr, INIT_FORKNUM))
 	{
 		RelationOpenSmgr(indexRelation);
-		smgrcreate(indexRelation->rd_smgr, INIT_FORKNUM, false);
+		smgrcreate(indexRelation->rd_smgr, INIT_FORKNUM, false,
+				   UsePageCompression(indexRelation->rd_node.spcNode));
 		indexRelation->rd_amroutine->ambuildempty(indexRelation);
 	}
 
@@ -3060,6 +3060,15 @@ GetTempNamespaceBackendId(Oid namespaceId)
 	return result;
 }
 
+/*
+ * HaveTempNamespace - has this backend set up a temporary-table namespace?
+ */
+bool
+HaveTempNamespace(void)
+{
+	return OidIsValid(myTempNamespace);
+}
+
 /*
  * GetTempToastNamespace - get the OID of my temporary-toast-table namespace,
  * which must already be assigned.  (This is only used when creating a toast
@@ -27,10 +27,12 @@
 #include "catalog/catalog.h"
 #include "catalog/storage.h"
 #include "catalog/storage_xlog.h"
+#include "miscadmin.h"
 #include "storage/freespace.h"
 #include "storage/smgr.h"
 #include "utils/memutils.h"
 #include "utils/rel.h"
+#include "utils/spccache.h"
 
 /*
  * We keep a list of all relations (represented as RelFileNode values)
@@ -69,7 +71,8 @@ static PendingRelDelete *pendingDeletes = NULL; /* head of linked list */
  *
  * Create the underlying disk file storage for the relation. This only
  * creates the main fork; additional forks are created lazily by the
- * modules that need them.
+ * modules that need them.  The main fork stores compressed pages if the
+ * tablespace's page_compression option is set.
  *
  * This function is transactional. The creation is WAL-logged, and if the
  * transaction aborts later on, the storage will be destroyed.
@@ -81,6 +84,7 @@ RelationCreateStorage(RelFileNode rnode, char relpersistence)
 	SMgrRelation srel;
 	BackendId	backend;
 	bool		needs_wal;
+	bool		compress;
 
 	switch (relpersistence)
 	{
@@ -101,11 +105,13 @@ RelationCreateStorage(RelFileNode rnode, char relpersistence)
 			return;				/* placate compiler */
 	}
 
+	compress = UsePageCompression(rnode.spcNode);
+
 	srel = smgropen(rnode, backend);
-	smgrcreate(srel, MAIN_FORKNUM, false);
+	smgrcreate(srel, MAIN_FORKNUM, false, compress);
 
 	if (needs_wal)
-		log_smgrcreate(&srel->smgr_rnode.node, MAIN_FORKNUM);
+		log_smgrcreate(&srel->smgr_rnode.node, MAIN_FORKNUM, compress);
 
 	/* Add the relation to the list of stuff to delete at abort */
 	pending = (PendingRelDelete *)
@@ -118,11 +124,50 @@ RelationCreateStorage(RelFileNode rnode, char relpersistence)
 	pendingDeletes = pending;
 }
 
+/*
+ * UsePageCompression
+ *		Should new main and init forks in the given tablespace store
+ *		compressed pages?
+ */
+bool
+UsePageCompression(Oid spcNode)
+{
+	/* we can't look at pg_tablespace while bootstrapping */
+	if (IsBootstrapProcessingMode())
+		return false;
+
+	if (!get_tablespace_page_compression(spcNode))
+		return false;
+
+	/* the settings might have changed since the tablespace was set up */
+	CheckPageCompressionSettings();
+	return true;
+}
+
+/*
+ * CheckPageCompressionSettings
+ *		Complain unless the server is set up to protect compressed pages.
+ *
+ * md.c rewrites a compressed page in place, so a torn write leaves a page
+ * that can't be decompressed at all.  Crash recovery can only repair it from
+ * a full page image, so one must have been logged since the last checkpoint
+ * before every write of the page, including writes that only set hint bits.
+ */
+void
+CheckPageCompressionSettings(void)
+{
+	if (!fullPageWrites || !XLogHintBitIsNeeded())
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("page compression is not available with the current settings"),
+				 errdetail("Page compression requires full_page_writes, and either wal_log_hints or data checksums, to be enabled.")));
+}
+
 /*
  * Perform XLogInsert of an XLOG_SMGR_CREATE record to WAL.
  */
 void
-log_smgrcreate(RelFileNode *rnode, ForkNumber forkNum)
+log_smgrcreate(RelFileNode *rnode, ForkNumber forkNum, bool compressed)
 {
 	xl_smgr_create xlrec;
 
@@ -131,6 +176,7 @@ log_smgrcreate(RelFileNode *rnode, ForkNumber forkNum)
 	 */
 	xlrec.rnode = *rnode;
 	xlrec.forkNum = forkNum;
+	xlrec.compressed = compressed;
 
 	XLogBeginInsert();
 	XLogRegisterData((char *) &xlrec, sizeof(xlrec));
@@ -487,7 +533,7 @@ smgr_redo(XLogReaderState *record)
 		SMgrRelation reln;
 
 		reln = smgropen(xlrec->rnode, InvalidBackendId);
-		smgrcreate(reln, xlrec->forkNum, true);
+		smgrcreate(reln, xlrec->forkNum, true, xlrec->compressed);
 	}
 	else if (info == XLOG_SMGR_TRUNCATE)
 	{
@@ -503,7 +549,7 @@ smgr_redo(XLogReaderState *record)
 		 * XLogReadBufferForRedo, we prefer to recreate the rel and replay the
 		 * log as best we can until the drop is seen.
 		 */
-		smgrcreate(reln, MAIN_FORKNUM, true);
+		smgrcreate(reln, MAIN_FORKNUM, true, false);
 
 		/*
 		 * Before we perform the truncation, update minimum recovery point to
@@ -458,6 +458,7 @@ CREATE VIEW pg_stat_all_tables AS
             pg_stat_get_live_tuples(C.oid) AS n_live_tup,
             pg_stat_get_dead_tuples(C.oid) AS n_dead_tup,
             pg_stat_get_mod_since_analyze(C.oid) AS n_mod_since_analyze,
+            pg_stat_get_ins_since_vacuum(C.oid) AS n_ins_since_vacuum,
             pg_stat_get_last_vacuum_time(C.oid) as last_vacuum,
             pg_stat_get_last_autovacuum_time(C.oid) as last_autovacuum,
             pg_stat_get_last_analyze_time(C.oid) as last_analyze,
@@ -465,7 +466,8 @@ CREATE VIEW pg_stat_all_tables AS
             pg_stat_get_vacuum_count(C.oid) AS vacuum_count,
             pg_stat_get_autovacuum_count(C.oid) AS autovacuum_count,
             pg_stat_get_analyze_count(C.oid) AS analyze_count,
-            pg_stat_get_autoanalyze_count(C.oid) AS autoanalyze_count
+            pg_stat_get_autoanalyze_count(C.oid) AS autoanalyze_count,
+            pg_stat_get_eager_frozen_pages(C.oid) AS eager_frozen_pages
     FROM pg_class C LEFT JOIN
          pg_index I ON C.oid = I.indrelid
          LEFT JOIN pg_namespace N ON (N.oid = C.relnamespace)
@@ -646,6 +648,18 @@ CREATE VIEW pg_stat_activity AS
     WHERE S.datid = D.oid AND
             S.usesysid = U.oid;
 
+CREATE VIEW pg_wait_sampling_history AS
+    SELECT * FROM pg_stat_get_wait_samples() AS S;
+
+CREATE VIEW pg_wait_sampling_profile AS
+    SELECT
+            S.wait_event_type,
+            S.wait_event,
+            S.queryid,
+            count(*) AS samples
+    FROM pg_stat_get_wait_samples() AS S
+    GROUP BY S.wait_event_type, S.wait_event, S.queryid;
+
 CREATE VIEW pg_stat_replication AS
     SELECT
             S.pid,
@@ -747,6 +761,9 @@ CREATE VIEW pg_stat_database_conflicts AS
             pg_stat_get_db_conflict_startup_deadlock(D.oid) AS confl_deadlock
     FROM pg_database D;
 
+CREATE VIEW pg_stat_lwlocks AS
+    SELECT * FROM pg_stat_get_lwlocks() AS S;
+
 CREATE VIEW pg_stat_user_functions AS
     SELECT
             P.oid AS funcid,
@@ -1027,3 +1044,4 @@ REVOKE EXECUTE ON FUNCTION pg_stat_reset() FROM public;
 REVOKE EXECUTE ON FUNCTION pg_stat_reset_shared(text) FROM public;
 REVOKE EXECUTE ON FUNCTION pg_stat_reset_single_table_counters(oid) FROM public;
 REVOKE EXECUTE ON FUNCTION pg_stat_reset_single_function_counters(oid) FROM public;
+REVOKE EXECUTE ON FUNCTION pg_stat_get_wait_samples() FROM public;
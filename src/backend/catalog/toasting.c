@@ -278,6 +278,7 @@ create_toast_table(Relation rel, Oid toastOid, Oid toastIndexOid,
 										   toast_typid,
 										   InvalidOid,
 										   rel->rd_rel->relowner,
+										   InvalidOid,
 										   tupdesc,
 										   NIL,
 										   RELKIND_TOASTVALUE,
@@ -17,6 +17,7 @@
 #include <math.h>
 
 #include "access/multixact.h"
+#include "access/tableam.h"
 #include "access/transam.h"
 #include "access/tupconvert.h"
 #include "access/tuptoaster.h"
@@ -29,6 +30,7 @@
 #include "catalog/pg_inherits_fn.h"
 #include "catalog/pg_namespace.h"
 #include "commands/dbcommands.h"
+#include "commands/defrem.h"
 #include "commands/tablecmds.h"
 #include "commands/vacuum.h"
 #include "executor/executor.h"
@@ -195,6 +197,22 @@ analyze_rel(Oid relid, RangeVar *relation, int options,
 		return;
 	}
 
+	/*
+	 * acquire_sample_rows reads heap pages directly, so tables using other
+	 * access methods can't be sampled.
+	 */
+	if ((onerel->rd_rel->relkind == RELKIND_RELATION ||
+		 onerel->rd_rel->relkind == RELKIND_MATVIEW) &&
+		!RelationUsesHeapAm(onerel))
+	{
+		ereport(WARNING,
+				(errmsg("skipping \"%s\" --- access method \"%s\" does not support ANALYZE",
+						RelationGetRelationName(onerel),
+						get_am_name(onerel->rd_rel->relam))));
+		relation_close(onerel, ShareUpdateExclusiveLock);
+		return;
+	}
+
 	/*
 	 * Check that it's a plain table, materialized view, or foreign table; we
 	 * used to do this in get_rel_oids() but seems safer to check after we've
@@ -1318,9 +1336,14 @@ acquire_inherited_sample_rows(Relation onerel, int elevel,
 			continue;
 		}
 
-		/* Check table type (MATVIEW can't happen, but might as well allow) */
-		if (childrel->rd_rel->relkind == RELKIND_RELATION ||
-			childrel->rd_rel->relkind == RELKIND_MATVIEW)
+		/*
+		 * Check table type (MATVIEW can't happen, but might as well allow).
+		 * Tables that don't use the heap are ignored, like foreign tables
+		 * that can't be analyzed.
+		 */
+		if ((childrel->rd_rel->relkind == RELKIND_RELATION ||
+			 childrel->rd_rel->relkind == RELKIND_MATVIEW) &&
+			RelationUsesHeapAm(childrel))
 		{
 			/* Regular table, so use the regular row acquisition function */
 			acquirefunc = acquire_sample_rows;
@@ -20,11 +20,21 @@
 #include <netinet/in.h>
 #include <arpa/inet.h>
 
+/* SSE2 is part of the baseline instruction set on x86-64 */
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define USE_SSE2_COPY_SCAN
+#endif
+
+#include "access/genam.h"
 #include "access/heapam.h"
 #include "access/htup_details.h"
+#include "access/parallel.h"
 #include "access/sysattr.h"
+#include "access/tableam.h"
 #include "access/xact.h"
 #include "access/xlog.h"
+#include "catalog/index.h"
 #include "catalog/pg_type.h"
 #include "commands/copy.h"
 #include "commands/defrem.h"
@@ -37,10 +47,12 @@
 #include "optimizer/clauses.h"
 #include "optimizer/planner.h"
 #include "nodes/makefuncs.h"
+#include "postmaster/postmaster.h"
 #include "rewrite/rewriteHandler.h"
 #include "storage/fd.h"
 #include "tcop/tcopprot.h"
 #include "utils/builtins.h"
+#include "utils/fmgroids.h"
 #include "utils/lsyscache.h"
 #include "utils/memutils.h"
 #include "utils/portal.h"
@@ -52,6 +64,62 @@
 #define ISOCTAL(c) (((c) >= '0') && ((c) <= '7'))
 #define OCTVALUE(c) ((c) - '0')
 
+/*
+ * Scan at most len bytes starting at s, looking for any of the characters
+ * c1 to c4, or if highbit is true, for any byte with the high bit set.
+ * Returns the number of bytes before the first such byte, or len if there is
+ * none.  Callers that look for fewer than four characters repeat one.
+ *
+ * The input loops of COPY FROM spend most of their time stepping over bytes
+ * that need no special treatment, so we look at 16 bytes at a time where
+ * SSE2 is available, and find the exact position within the chunk with the
+ * plain loop.
+ */
+static inline int
+CopyScanForChars(const char *s, int len, char c1, char c2, char c3, char c4,
+				 bool highbit)
+{
+	int			i = 0;
+
+#ifdef USE_SSE2_COPY_SCAN
+	if (len >= 16)
+	{
+		const __m128i v1 = _mm_set1_epi8(c1);
+		const __m128i v2 = _mm_set1_epi8(c2);
+		const __m128i v3 = _mm_set1_epi8(c3);
+		const __m128i v4 = _mm_set1_epi8(c4);
+
+		for (; i + 16 <= len; i += 16)
+		{
+			__m128i		chunk = _mm_loadu_si128((const __m128i *) (s + i));
+			__m128i		match;
+			int			mask;
+
+			match = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, v1),
+											  _mm_cmpeq_epi8(chunk, v2)),
+								 _mm_or_si128(_mm_cmpeq_epi8(chunk, v3),
+											  _mm_cmpeq_epi8(chunk, v4)));
+			mask = _mm_movemask_epi8(match);
+			if (highbit)
+				mask |= _mm_movemask_epi8(chunk);
+			if (mask != 0)
+				break;
+		}
+	}
+#endif
+
+	for (; i < len; i++)
+	{
+		char		c = s[i];
+
+		if (c == c1 || c == c2 || c == c3 || c == c4 ||
+			(highbit && IS_HIGHBIT_SET(c)))
+			break;
+	}
+
+	return i;
+}
+
 /*
  * Represents the different source/dest cases we need to worry about at
  * the bottom level
@@ -60,9 +128,28 @@ typedef enum CopyDest
 {
 	COPY_FILE,					/* to/from file (or a piped program) */
 	COPY_OLD_FE,				/* to/from frontend (2.0 protocol) */
-	COPY_NEW_FE					/* to/from frontend (3.0 protocol) */
+	COPY_NEW_FE,				/* to/from frontend (3.0 protocol) */
+	COPY_PARALLEL				/* from the leader of a parallel COPY FROM */
 } CopyDest;
 
+/*
+ * How binary COPY TO sends the value of a column.  For some common types, we
+ * know what the send function would produce and can write it directly from
+ * the datum, which saves a function call and a palloc'd copy of every value;
+ * see CopyBinarySendMethod.
+ */
+typedef enum CopyBinarySend
+{
+	COPY_SEND_FUNCTION,			/* call the type's send function */
+	COPY_SEND_BOOL,				/* one byte, 0 or 1 */
+	COPY_SEND_INT2,				/* 2-byte integer in network byte order */
+	COPY_SEND_INT4,				/* 4-byte integer in network byte order */
+	COPY_SEND_INT8,				/* 8-byte integer in network byte order */
+	COPY_SEND_FLOAT4,			/* float4, sent like an int4 */
+	COPY_SEND_FLOAT8,			/* float8, sent like an int8 */
+	COPY_SEND_VARLENA			/* contents of the varlena, as they are */
+} CopyBinarySend;
+
 /*
  *	Represents the end-of-line terminator type of the input
  */
@@ -130,12 +217,15 @@ typedef struct CopyStateData
 	bool		convert_selectively;	/* do selective binary conversion? */
 	List	   *convert_select; /* list of column names (can be NIL) */
 	bool	   *convert_select_flags;	/* per-column CSV/TEXT CS flags */
+	int			nworkers;		/* # of parallel workers for COPY FROM */
 
 	/* these are just for error messages, see CopyFromErrorCallback */
 	const char *cur_relname;	/* table name for error messages */
 	int			cur_lineno;		/* line number for error messages */
 	const char *cur_attname;	/* current att for error messages */
 	const char *cur_attval;		/* current att value for error messages */
+	int		   *batch_linenos;	/* line numbers of a batch being indexed */
+	int			batch_tuple;	/* tuple of that batch being indexed */
 
 	/*
 	 * Working state for COPY TO/FROM
@@ -146,6 +236,7 @@ typedef struct CopyStateData
 	 * Working state for COPY TO
 	 */
 	FmgrInfo   *out_functions;	/* lookup info for output functions */
+	CopyBinarySend *binary_send;	/* how to send each column, if binary */
 	MemoryContext rowcontext;	/* per-row evaluation context */
 
 	/*
@@ -160,6 +251,7 @@ typedef struct CopyStateData
 	int		   *defmap;			/* array of default att numbers */
 	ExprState **defexprs;		/* array of default att expressions */
 	bool		volatile_defexprs;		/* is any of defexprs volatile? */
+	bool		parallel_unsafe_defexprs;	/* is any of them parallel unsafe? */
 	List	   *range_table;
 
 	/*
@@ -199,8 +291,50 @@ typedef struct CopyStateData
 	char	   *raw_buf;
 	int			raw_buf_index;	/* next byte to process */
 	int			raw_buf_len;	/* total # of bytes stored */
+
+	/*
+	 * In a worker of a parallel COPY FROM, the leader has already split the
+	 * input into lines and converted them to the server encoding.  They
+	 * arrive in batches through line_mqh, and are copied to line_buf one at a
+	 * time.  The leader also decides the heap_insert options, see
+	 * CopyFromParallel.
+	 */
+	shm_mq_handle *line_mqh;
+	char	   *line_batch;		/* current batch of lines */
+	Size		line_batch_len; /* total # of bytes in it */
+	Size		line_batch_pos; /* next byte to process */
+	int			leader_hi_options;	/* heap_insert options to use */
 } CopyStateData;
 
+/*
+ * Shared state of a parallel COPY FROM, in the parallel context's DSM
+ * segment.  Next to it, the table of contents holds the COPY options, the
+ * column list and the range table as node strings, and one queue per worker
+ * through which the leader passes the lines of input to the worker.
+ */
+typedef struct ParallelCopyShared
+{
+	Oid			relid;			/* table to load */
+	int			hi_options;		/* heap_insert options for the workers */
+	uint64		processed[FLEXIBLE_ARRAY_MEMBER];	/* # of rows per worker */
+} ParallelCopyShared;
+
+/* Keys for the parallel COPY FROM's DSM table of contents */
+#define PARALLEL_COPY_KEY_SHARED		UINT64CONST(0xC000000000000001)
+#define PARALLEL_COPY_KEY_OPTIONS		UINT64CONST(0xC000000000000002)
+#define PARALLEL_COPY_KEY_ATTNAMES		UINT64CONST(0xC000000000000003)
+#define PARALLEL_COPY_KEY_RANGE_TABLE	UINT64CONST(0xC000000000000004)
+#define PARALLEL_COPY_KEY_QUEUES		UINT64CONST(0xC000000000000005)
+
+/*
+ * The leader of a parallel COPY FROM passes the lines to each worker in
+ * batches of about this many bytes, through a queue that holds a few of
+ * them.  In a batch, each line is preceded by its line number and length,
+ * as two ints.
+ */
+#define PARALLEL_COPY_BATCH_SIZE	65536
+#define PARALLEL_COPY_QUEUE_SIZE	(4 * PARALLEL_COPY_BATCH_SIZE)
+
 /* DestReceiver for COPY (query) TO */
 typedef struct
 {
@@ -292,21 +426,36 @@ static uint64 DoCopyTo(CopyState cstate);
 static uint64 CopyTo(CopyState cstate);
 static void CopyOneRowTo(CopyState cstate, Oid tupleOid,
 			 Datum *values, bool *nulls);
+static CopyState BeginCopyFromInternal(Relation rel, const char *filename,
+					  bool is_program, List *attnamelist, List *options,
+					  shm_mq_handle *line_mqh);
+static int	CopyFromHeapInsertOptions(CopyState cstate);
 static uint64 CopyFrom(CopyState cstate);
+static bool CopyFromParallelSafe(CopyState cstate);
+static uint64 CopyFromParallel(CopyState cstate, List *attnamelist,
+				 List *options);
+static int	ParallelCopyNextWorker(shm_mq_handle **mqh,
+					   StringInfoData *batches, int nworkers, int cur);
+static bool ParallelCopySendBatch(shm_mq_handle *mqh, StringInfo batch,
+					  bool nowait);
+static void ParallelCopyMain(dsm_segment *seg, shm_toc *toc);
 static void CopyFromInsertBatch(CopyState cstate, EState *estate,
 					CommandId mycid, int hi_options,
 					ResultRelInfo *resultRelInfo, TupleTableSlot *myslot,
 					BulkInsertState bistate,
 					int nBufferedTuples, HeapTuple *bufferedTuples,
-					int firstBufferedLineNo);
+					int *bufferedLineNos);
 static bool CopyReadLine(CopyState cstate);
 static bool CopyReadLineText(CopyState cstate);
+static bool CopyReadLineFromLeader(CopyState cstate);
 static int	CopyReadAttributesText(CopyState cstate);
 static int	CopyReadAttributesCSV(CopyState cstate);
 static Datum CopyReadBinaryAttribute(CopyState cstate,
 						int column_no, FmgrInfo *flinfo,
 						Oid typioparam, int32 typmod,
 						bool *isnull);
+static inline void CopySendBinaryAttribute(CopyState cstate, int attnum,
+						Datum value);
 static void CopyAttributeOutText(CopyState cstate, char *string);
 static void CopyAttributeOutCSV(CopyState cstate, char *string,
 					bool use_quote, bool single_attr);
@@ -327,6 +476,8 @@ static int CopyGetData(CopyState cstate, void *databuf,
 static void CopySendInt32(CopyState cstate, int32 val);
 static bool CopyGetInt32(CopyState cstate, int32 *val);
 static void CopySendInt16(CopyState cstate, int16 val);
+static void CopySendInt64(CopyState cstate, int64 val);
+static CopyBinarySend CopyBinarySendMethod(Oid send_func_oid);
 static bool CopyGetInt16(CopyState cstate, int16 *val);
 
 
@@ -546,6 +697,10 @@ CopySendEndOfRow(CopyState cstate)
 			/* Dump the accumulated row as one CopyData message */
 			(void) pq_putmessage('d', fe_msgbuf->data, fe_msgbuf->len);
 			break;
+		case COPY_PARALLEL:
+			/* only used for COPY FROM */
+			elog(ERROR, "unexpected COPY destination");
+			break;
 	}
 
 	resetStringInfo(fe_msgbuf);
@@ -660,6 +815,10 @@ CopyGetData(CopyState cstate, void *databuf, int minread, int maxread)
 				bytesread += avail;
 			}
 			break;
+		case COPY_PARALLEL:
+			/* the workers get their lines from CopyReadLineFromLeader */
+			elog(ERROR, "unexpected COPY source");
+			break;
 	}
 
 	return bytesread;
@@ -713,6 +872,23 @@ CopySendInt16(CopyState cstate, int16 val)
 	CopySendData(cstate, &buf, sizeof(buf));
 }
 
+/*
+ * CopySendInt64 sends an int64 in network byte order, like pq_sendint64
+ */
+static void
+CopySendInt64(CopyState cstate, int64 val)
+{
+	uint32		n32;
+
+	/* High order half first, since we're doing MSB-first */
+	n32 = (uint32) (val >> 32);
+	CopySendInt32(cstate, (int32) n32);
+
+	/* Now the low order half */
+	n32 = (uint32) val;
+	CopySendInt32(cstate, (int32) n32);
+}
+
 /*
  * CopyGetInt16 reads an int16 that appears in network byte order
  */
@@ -939,7 +1115,12 @@ DoCopy(const CopyStmt *stmt, const char *queryString, uint64 *processed)
 		cstate = BeginCopyFrom(rel, stmt->filename, stmt->is_program,
 							   stmt->attlist, stmt->options);
 		cstate->range_table = range_table;
-		*processed = CopyFrom(cstate);	/* copy from file to database */
+		/* copy from file to database */
+		if (cstate->nworkers > 0 && CopyFromParallelSafe(cstate))
+			*processed = CopyFromParallel(cstate, stmt->attlist,
+										  stmt->options);
+		else
+			*processed = CopyFrom(cstate);
 		EndCopyFrom(cstate);
 	}
 	else
@@ -985,6 +1166,7 @@ ProcessCopyOptions(CopyState cstate,
 				   List *options)
 {
 	bool		format_specified = false;
+	bool		parallel_specified = false;
 	ListCell   *option;
 
 	/* Support external use for option sanity checking */
@@ -1138,6 +1320,20 @@ ProcessCopyOptions(CopyState cstate,
 						 errmsg("argument to option \"%s\" must be a list of column names",
 								defel->defname)));
 		}
+		else if (strcmp(defel->defname, "parallel") == 0)
+		{
+			if (parallel_specified)
+				ereport(ERROR,
+						(errcode(ERRCODE_SYNTAX_ERROR),
+						 errmsg("conflicting or redundant options")));
+			parallel_specified = true;
+			cstate->nworkers = defGetInt32(defel);
+			if (cstate->nworkers < 0 || cstate->nworkers > MAX_BACKENDS)
+				ereport(ERROR,
+						(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+						 errmsg("argument to option \"%s\" must be between 0 and %d",
+								defel->defname, MAX_BACKENDS)));
+		}
 		else if (strcmp(defel->defname, "encoding") == 0)
 		{
 			if (cstate->file_encoding >= 0)
@@ -1172,6 +1368,11 @@ ProcessCopyOptions(CopyState cstate,
 				(errcode(ERRCODE_SYNTAX_ERROR),
 				 errmsg("cannot specify NULL in BINARY mode")));
 
+	if (cstate->binary && cstate->nworkers > 0)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("cannot specify PARALLEL in BINARY mode")));
+
 	/* Set defaults for omitted options */
 	if (!cstate->delim)
 		cstate->delim = cstate->csv_mode ? "," : "\t";
@@ -1288,6 +1489,16 @@ ProcessCopyOptions(CopyState cstate,
 				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
 				 errmsg("COPY force null only available using COPY FROM")));
 
+	/* Check parallel */
+	if (cstate->nworkers > 0 && !is_from)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("COPY parallel only available using COPY FROM")));
+	if (cstate->nworkers > 0 && cstate->freeze)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("COPY parallel cannot be used with FREEZE")));
+
 	/* Don't allow the delimiter to appear in the null string. */
 	if (strchr(cstate->null_print, cstate->delim[0]) != NULL)
 		ereport(ERROR,
@@ -1870,6 +2081,9 @@ CopyTo(CopyState cstate)
 
 	/* Get info about the columns we need to process. */
 	cstate->out_functions = (FmgrInfo *) palloc(num_phys_attrs * sizeof(FmgrInfo));
+	if (cstate->binary)
+		cstate->binary_send = (CopyBinarySend *)
+			palloc(num_phys_attrs * sizeof(CopyBinarySend));
 	foreach(cur, cstate->attnumlist)
 	{
 		int			attnum = lfirst_int(cur);
@@ -1877,9 +2091,13 @@ CopyTo(CopyState cstate)
 		bool		isvarlena;
 
 		if (cstate->binary)
+		{
 			getTypeBinaryOutputInfo(attr[attnum - 1]->atttypid,
 									&out_func_oid,
 									&isvarlena);
+			cstate->binary_send[attnum - 1] =
+				CopyBinarySendMethod(out_func_oid);
+		}
 		else
 			getTypeOutputInfo(attr[attnum - 1]->atttypid,
 							  &out_func_oid,
@@ -1952,33 +2170,31 @@ CopyTo(CopyState cstate)
 
 	if (cstate->rel)
 	{
-		Datum	   *values;
-		bool	   *nulls;
-		HeapScanDesc scandesc;
-		HeapTuple	tuple;
-
-		values = (Datum *) palloc(num_phys_attrs * sizeof(Datum));
-		nulls = (bool *) palloc(num_phys_attrs * sizeof(bool));
+		TupleTableSlot *slot;
+		TableScanDesc scandesc;
 
-		scandesc = heap_beginscan(cstate->rel, GetActiveSnapshot(), 0, NULL);
+		slot = MakeSingleTupleTableSlot(tupDesc);
+		scandesc = table_beginscan(cstate->rel, GetActiveSnapshot(), 0, NULL);
 
 		processed = 0;
-		while ((tuple = heap_getnext(scandesc, ForwardScanDirection)) != NULL)
+		while (table_getnextslot(cstate->rel, scandesc, ForwardScanDirection,
+								 slot))
 		{
 			CHECK_FOR_INTERRUPTS();
 
 			/* Deconstruct the tuple ... faster than repeated heap_getattr */
-			heap_deform_tuple(tuple, tupDesc, values, nulls);
+			slot_getallattrs(slot);
 
 			/* Format and send the data */
-			CopyOneRowTo(cstate, HeapTupleGetOid(tuple), values, nulls);
+			CopyOneRowTo(cstate,
+						 cstate->oids ?
+						 HeapTupleGetOid(ExecFetchSlotTuple(slot)) : InvalidOid,
+						 slot->tts_values, slot->tts_isnull);
 			processed++;
 		}
 
-		heap_endscan(scandesc);
-
-		pfree(values);
-		pfree(nulls);
+		table_endscan(cstate->rel, scandesc);
+		ExecDropSingleTupleTableSlot(slot);
 	}
 	else
 	{
@@ -2074,24 +2290,138 @@ CopyOneRowTo(CopyState cstate, Oid tupleOid, Datum *values, bool *nulls)
 					CopyAttributeOutText(cstate, string);
 			}
 			else
+				CopySendBinaryAttribute(cstate, attnum, value);
+		}
+	}
+
+	CopySendEndOfRow(cstate);
+
+	MemoryContextSwitchTo(oldcontext);
+}
+
+
+/*
+ * Send the binary representation of a non-null attribute, with its length
+ * word, either directly or by calling its send function.
+ */
+static inline void
+CopySendBinaryAttribute(CopyState cstate, int attnum, Datum value)
+{
+	switch (cstate->binary_send[attnum - 1])
+	{
+		case COPY_SEND_BOOL:
+			CopySendInt32(cstate, 1);
+			CopySendChar(cstate, DatumGetBool(value) ? 1 : 0);
+			break;
+		case COPY_SEND_INT2:
+			CopySendInt32(cstate, sizeof(int16));
+			CopySendInt16(cstate, DatumGetInt16(value));
+			break;
+		case COPY_SEND_INT4:
+			CopySendInt32(cstate, sizeof(int32));
+			CopySendInt32(cstate, DatumGetInt32(value));
+			break;
+		case COPY_SEND_INT8:
+			CopySendInt32(cstate, sizeof(int64));
+			CopySendInt64(cstate, DatumGetInt64(value));
+			break;
+		case COPY_SEND_FLOAT4:
+			{
+				union
+				{
+					float4		f;
+					int32		i;
+				}			swap;
+
+				swap.f = DatumGetFloat4(value);
+				CopySendInt32(cstate, sizeof(int32));
+				CopySendInt32(cstate, swap.i);
+			}
+			break;
+		case COPY_SEND_FLOAT8:
+			{
+				union
+				{
+					float8		f;
+					int64		i;
+				}			swap;
+
+				swap.f = DatumGetFloat8(value);
+				CopySendInt32(cstate, sizeof(int64));
+				CopySendInt64(cstate, swap.i);
+			}
+			break;
+		case COPY_SEND_VARLENA:
+			{
+				/* this only detoasts if the value is compressed or external */
+				struct varlena *v = PG_DETOAST_DATUM_PACKED(value);
+
+				CopySendInt32(cstate, VARSIZE_ANY_EXHDR(v));
+				CopySendData(cstate, VARDATA_ANY(v), VARSIZE_ANY_EXHDR(v));
+			}
+			break;
+		case COPY_SEND_FUNCTION:
 			{
 				bytea	   *outputbytes;
 
-				outputbytes = SendFunctionCall(&out_functions[attnum - 1],
-											   value);
+				outputbytes =
+					SendFunctionCall(&cstate->out_functions[attnum - 1],
+									 value);
 				CopySendInt32(cstate, VARSIZE(outputbytes) - VARHDRSZ);
 				CopySendData(cstate, VARDATA(outputbytes),
 							 VARSIZE(outputbytes) - VARHDRSZ);
 			}
-		}
+			break;
 	}
+}
 
-	CopySendEndOfRow(cstate);
+/*
+ * Decide how binary COPY TO sends values whose type has the given send
+ * function.  The types handled directly are those whose send function just
+ * writes out the datum in network byte order.  The text types qualify only
+ * if no encoding conversion is needed, as textsend converts to the client
+ * encoding.
+ */
+static CopyBinarySend
+CopyBinarySendMethod(Oid send_func_oid)
+{
+	switch (send_func_oid)
+	{
+		case F_BOOLSEND:
+			return COPY_SEND_BOOL;
+		case F_INT2SEND:
+			return COPY_SEND_INT2;
+		case F_INT4SEND:
+		case F_OIDSEND:
+		case F_DATE_SEND:
+			return COPY_SEND_INT4;
+		case F_INT8SEND:
+			return COPY_SEND_INT8;
+		case F_TIMESTAMP_SEND:
+		case F_TIMESTAMPTZ_SEND:
+#ifdef HAVE_INT64_TIMESTAMP
+			return COPY_SEND_INT8;
+#else
+			return COPY_SEND_FLOAT8;
+#endif
+		case F_FLOAT4SEND:
+			return COPY_SEND_FLOAT4;
+		case F_FLOAT8SEND:
+			return COPY_SEND_FLOAT8;
+		case F_BYTEASEND:
+			return COPY_SEND_VARLENA;
+		case F_TEXTSEND:
+		case F_VARCHARSEND:
+		case F_BPCHARSEND:
+			if (pg_get_client_encoding() == GetDatabaseEncoding() ||
+				pg_get_client_encoding() == PG_SQL_ASCII)
+				return COPY_SEND_VARLENA;
+			break;
+	}
 
-	MemoryContextSwitchTo(oldcontext);
+	return COPY_SEND_FUNCTION;
 }
 
-
 /*
  * error context callback for COPY FROM
  *
@@ -2102,6 +2432,10 @@ CopyFromErrorCallback(void *arg)
 {
 	CopyState	cstate = (CopyState) arg;
 
+	/* While inserting index entries for a batch, report the tuple at hand */
+	if (cstate->batch_linenos != NULL)
+		cstate->cur_lineno = cstate->batch_linenos[cstate->batch_tuple];
+
 	if (cstate->binary)
 	{
 		/* can't usefully display the data */
@@ -2199,6 +2533,59 @@ limit_printout_length(const char *str)
 	return res;
 }
 
+/*----------
+ * Check to see if we can avoid writing WAL, for CopyFrom.  Returns the
+ * heap_insert options to use.
+ *
+ * If archive logging/streaming is not enabled *and* either
+ *	- table was created in same transaction as this COPY
+ *	- data is being written to relfilenode created in this transaction
+ * then we can skip writing WAL.  It's safe because if the transaction
+ * doesn't commit, we'll discard the table (or the new relfilenode file).
+ * If it does commit, we'll have done the heap_sync at the bottom of
+ * CopyFrom or CopyFromParallel first.
+ *
+ * As mentioned in comments in utils/rel.h, the in-same-transaction test
+ * is not always set correctly, since in rare cases rd_newRelfilenodeSubid
+ * can be cleared before the end of the transaction. The exact case is
+ * when a relation sets a new relfilenode twice in same transaction, yet
+ * the second one fails in an aborted subtransaction, e.g.
+ *
+ * BEGIN;
+ * TRUNCATE t;
+ * SAVEPOINT save;
+ * TRUNCATE t;
+ * ROLLBACK TO save;
+ * COPY ...
+ *
+ * Also, if the target file is new-in-transaction, we assume that checking
+ * FSM for free space is a waste of time, even if we must use WAL because
+ * of archiving.  This could possibly be wrong, but it's unlikely.
+ *
+ * The comments for heap_insert and RelationGetBufferForTuple specify that
+ * skipping WAL logging is only safe if we ensure that our tuples do not
+ * go into pages containing tuples from any other transactions --- but this
+ * must be the case if we have a new table or new relfilenode, so we need
+ * no additional work to enforce that.
+ *----------
+ */
+static int
+CopyFromHeapInsertOptions(CopyState cstate)
+{
+	int			hi_options = 0; /* start with default heap_insert options */
+
+	/* createSubid is creation check, newRelfilenodeSubid is truncation check */
+	if (cstate->rel->rd_createSubid != InvalidSubTransactionId ||
+		cstate->rel->rd_newRelfilenodeSubid != InvalidSubTransactionId)
+	{
+		hi_options |= HEAP_INSERT_SKIP_FSM;
+		if (!XLogIsNeeded())
+			hi_options |= HEAP_INSERT_SKIP_WAL;
+	}
+
+	return hi_options;
+}
+
 /*
  * Copy FROM file to relation.
  */
@@ -2217,7 +2604,7 @@ CopyFrom(CopyState cstate)
 
 	ErrorContextCallback errcallback;
 	CommandId	mycid = GetCurrentCommandId(true);
-	int			hi_options = 0; /* start with default heap_insert options */
+	int			hi_options;
 	BulkInsertState bistate;
 	uint64		processed = 0;
 	bool		useHeapMultiInsert;
@@ -2225,8 +2612,8 @@ CopyFrom(CopyState cstate)
 
 #define MAX_BUFFERED_TUPLES 1000
 	HeapTuple  *bufferedTuples = NULL;	/* initialize to silence warning */
+	int		   *bufferedLineNos = NULL;
 	Size		bufferedTuplesSize = 0;
-	int			firstBufferedLineNo = 0;
 
 	Assert(cstate->rel);
 
@@ -2261,49 +2648,11 @@ CopyFrom(CopyState cstate)
 
 	tupDesc = RelationGetDescr(cstate->rel);
 
-	/*----------
-	 * Check to see if we can avoid writing WAL
-	 *
-	 * If archive logging/streaming is not enabled *and* either
-	 *	- table was created in same transaction as this COPY
-	 *	- data is being written to relfilenode created in this transaction
-	 * then we can skip writing WAL.  It's safe because if the transaction
-	 * doesn't commit, we'll discard the table (or the new relfilenode file).
-	 * If it does commit, we'll have done the heap_sync at the bottom of this
-	 * routine first.
-	 *
-	 * As mentioned in comments in utils/rel.h, the in-same-transaction test
-	 * is not always set correctly, since in rare cases rd_newRelfilenodeSubid
-	 * can be cleared before the end of the transaction. The exact case is
-	 * when a relation sets a new relfilenode twice in same transaction, yet
-	 * the second one fails in an aborted subtransaction, e.g.
-	 *
-	 * BEGIN;
-	 * TRUNCATE t;
-	 * SAVEPOINT save;
-	 * TRUNCATE t;
-	 * ROLLBACK TO save;
-	 * COPY ...
-	 *
-	 * Also, if the target file is new-in-transaction, we assume that checking
-	 * FSM for free space is a waste of time, even if we must use WAL because
-	 * of archiving.  This could possibly be wrong, but it's unlikely.
-	 *
-	 * The comments for heap_insert and RelationGetBufferForTuple specify that
-	 * skipping WAL logging is only safe if we ensure that our tuples do not
-	 * go into pages containing tuples from any other transactions --- but this
-	 * must be the case if we have a new table or new relfilenode, so we need
-	 * no additional work to enforce that.
-	 *----------
-	 */
-	/* createSubid is creation check, newRelfilenodeSubid is truncation check */
-	if (cstate->rel->rd_createSubid != InvalidSubTransactionId ||
-		cstate->rel->rd_newRelfilenodeSubid != InvalidSubTransactionId)
-	{
-		hi_options |= HEAP_INSERT_SKIP_FSM;
-		if (!XLogIsNeeded())
-			hi_options |= HEAP_INSERT_SKIP_WAL;
-	}
+	/* In a parallel worker, the leader has checked this for us */
+	if (cstate->copy_dest == COPY_PARALLEL)
+		hi_options = cstate->leader_hi_options;
+	else
+		hi_options = CopyFromHeapInsertOptions(cstate);
 
 	/*
 	 * Optimize if new relfilenode was created in this subxact or one of its
@@ -2373,6 +2722,7 @@ CopyFrom(CopyState cstate)
 	{
 		useHeapMultiInsert = true;
 		bufferedTuples = palloc(MAX_BUFFERED_TUPLES * sizeof(HeapTuple));
+		bufferedLineNos = palloc(MAX_BUFFERED_TUPLES * sizeof(int));
 	}
 
 	/* Prepare to catch AFTER triggers. */
@@ -2463,9 +2813,12 @@ CopyFrom(CopyState cstate)
 
 			if (useHeapMultiInsert)
 			{
-				/* Add this tuple to the tuple buffer */
-				if (nBufferedTuples == 0)
-					firstBufferedLineNo = cstate->cur_lineno;
+				/*
+				 * Add this tuple to the tuple buffer.  Remember its line
+				 * number too; in a parallel worker, the buffered tuples don't
+				 * necessarily come from consecutive lines.
+				 */
+				bufferedLineNos[nBufferedTuples] = cstate->cur_lineno;
 				bufferedTuples[nBufferedTuples++] = tuple;
 				bufferedTuplesSize += tuple->t_len;
 
@@ -2481,7 +2834,7 @@ CopyFrom(CopyState cstate)
 					CopyFromInsertBatch(cstate, estate, mycid, hi_options,
 										resultRelInfo, myslot, bistate,
 										nBufferedTuples, bufferedTuples,
-										firstBufferedLineNo);
+										bufferedLineNos);
 					nBufferedTuples = 0;
 					bufferedTuplesSize = 0;
 				}
@@ -2491,7 +2844,7 @@ CopyFrom(CopyState cstate)
 				List	   *recheckIndexes = NIL;
 
 				/* OK, store the tuple and create index entries for it */
-				heap_insert(cstate->rel, tuple, mycid, hi_options, bistate);
+				table_insert(cstate->rel, tuple, mycid, hi_options, bistate);
 
 				if (resultRelInfo->ri_NumIndices > 0)
 					recheckIndexes = ExecInsertIndexTuples(slot, &(tuple->t_self),
@@ -2519,7 +2872,7 @@ CopyFrom(CopyState cstate)
 		CopyFromInsertBatch(cstate, estate, mycid, hi_options,
 							resultRelInfo, myslot, bistate,
 							nBufferedTuples, bufferedTuples,
-							firstBufferedLineNo);
+							bufferedLineNos);
 
 	/* Done, clean up */
 	error_context_stack = errcallback.previous;
@@ -2551,11 +2904,13 @@ CopyFrom(CopyState cstate)
 	FreeExecutorState(estate);
 
 	/*
-	 * If we skipped writing WAL, then we need to sync the heap (but not
-	 * indexes since those use WAL anyway)
+	 * Let the table access method finish the load.  For the heap, if we
+	 * skipped writing WAL, this syncs the heap (but not indexes since those
+	 * use WAL anyway).  Parallel workers leave that to the leader, which does
+	 * it once they have all finished.
 	 */
-	if (hi_options & HEAP_INSERT_SKIP_WAL)
-		heap_sync(cstate->rel);
+	if (cstate->copy_dest != COPY_PARALLEL)
+		table_finish_bulk_insert(cstate->rel, hi_options);
 
 	return processed;
 }
@@ -2570,7 +2925,7 @@ CopyFromInsertBatch(CopyState cstate, EState *estate, CommandId mycid,
 					int hi_options, ResultRelInfo *resultRelInfo,
 					TupleTableSlot *myslot, BulkInsertState bistate,
 					int nBufferedTuples, HeapTuple *bufferedTuples,
-					int firstBufferedLineNo)
+					int *bufferedLineNos)
 {
 	MemoryContext oldcontext;
 	int			i;
@@ -2588,34 +2943,42 @@ CopyFromInsertBatch(CopyState cstate, EState *estate, CommandId mycid,
 	 * before calling it.
 	 */
 	oldcontext = MemoryContextSwitchTo(GetPerTupleMemoryContext(estate));
-	heap_multi_insert(cstate->rel,
-					  bufferedTuples,
-					  nBufferedTuples,
-					  mycid,
-					  hi_options,
-					  bistate);
+	table_multi_insert(cstate->rel,
+					   bufferedTuples,
+					   nBufferedTuples,
+					   mycid,
+					   hi_options,
+					   bistate);
 	MemoryContextSwitchTo(oldcontext);
 
 	/*
 	 * If there are any indexes, update them for all the inserted tuples, and
-	 * run AFTER ROW INSERT triggers.
+	 * run AFTER ROW INSERT triggers.  The index entries are inserted one index
+	 * at a time, and in key order for btrees; see ExecInsertIndexTuplesMulti.
 	 */
 	if (resultRelInfo->ri_NumIndices > 0)
 	{
+		List	  **recheckIndexes;
+
+		recheckIndexes = (List **) palloc(nBufferedTuples * sizeof(List *));
+
+		cstate->batch_linenos = bufferedLineNos;
+		cstate->batch_tuple = 0;
+		ExecInsertIndexTuplesMulti(myslot, bufferedTuples, nBufferedTuples,
+								   estate, recheckIndexes,
+								   &cstate->batch_tuple);
+		cstate->batch_linenos = NULL;
+
 		for (i = 0; i < nBufferedTuples; i++)
 		{
-			List	   *recheckIndexes;
-
-			cstate->cur_lineno = firstBufferedLineNo + i;
-			ExecStoreTuple(bufferedTuples[i], myslot, InvalidBuffer, false);
-			recheckIndexes =
-				ExecInsertIndexTuples(myslot, &(bufferedTuples[i]->t_self),
-									  estate, false, NULL, NIL);
+			cstate->cur_lineno = bufferedLineNos[i];
 			ExecARInsertTriggers(estate, resultRelInfo,
 								 bufferedTuples[i],
-								 recheckIndexes);
-			list_free(recheckIndexes);
+								 recheckIndexes[i]);
+			list_free(recheckIndexes[i]);
 		}
+
+		pfree(recheckIndexes);
 	}
 
 	/*
@@ -2627,7 +2990,7 @@ CopyFromInsertBatch(CopyState cstate, EState *estate, CommandId mycid,
 	{
 		for (i = 0; i < nBufferedTuples; i++)
 		{
-			cstate->cur_lineno = firstBufferedLineNo + i;
+			cstate->cur_lineno = bufferedLineNos[i];
 			ExecARInsertTriggers(estate, resultRelInfo,
 								 bufferedTuples[i],
 								 NIL);
@@ -2638,6 +3001,378 @@ CopyFromInsertBatch(CopyState cstate, EState *estate, CommandId mycid,
 	cstate->cur_lineno = save_cur_lineno;
 }
 
+/*
+ * Can the rows of a COPY FROM be loaded by parallel workers?
+ *
+ * The workers insert the rows the same way CopyFrom does, but nothing they
+ * do may need to run in the leader, or depend on seeing the rows inserted
+ * by the other workers.  So there must be no triggers, which also rules out
+ * foreign keys and deferred uniqueness checks, and no exclusion
+ * constraints; and default expressions, CHECK constraints and index
+ * expressions and predicates must be parallel safe.  Columns of a domain
+ * type are ruled out too, since the domain's constraints could call
+ * anything.  Like parallel query, this isn't possible for temporary tables,
+ * which live in the leader's local buffers, or in serializable
+ * transactions, whose predicate locking state the workers don't share.
+ * Only the heap is known to cope with inserts from several processes at
+ * once, so the table must use it.
+ */
+static bool
+CopyFromParallelSafe(CopyState cstate)
+{
+	Relation	rel = cstate->rel;
+	TupleDesc	tupDesc = RelationGetDescr(rel);
+	List	   *indexoidlist;
+	ListCell   *lc;
+	bool		safe = true;
+	int			i;
+
+	if (rel->rd_rel->relkind != RELKIND_RELATION ||
+		!RelationUsesHeapAm(rel) ||
+		RelationUsesLocalBuffers(rel) ||
+		IsolationIsSerializable() ||
+		rel->trigdesc != NULL ||
+		cstate->parallel_unsafe_defexprs)
+		return false;
+
+	for (i = 0; i < tupDesc->natts; i++)
+	{
+		Form_pg_attribute attr = tupDesc->attrs[i];
+
+		if (!attr->attisdropped &&
+			get_typtype(attr->atttypid) == TYPTYPE_DOMAIN)
+			return false;
+	}
+
+	if (tupDesc->constr != NULL)
+	{
+		ConstrCheck *check = tupDesc->constr->check;
+
+		for (i = 0; i < tupDesc->constr->num_check; i++)
+		{
+			if (has_parallel_hazard(stringToNode(check[i].ccbin), false))
+				return false;
+		}
+	}
+
+	indexoidlist = RelationGetIndexList(rel);
+	foreach(lc, indexoidlist)
+	{
+		Relation	indexDesc;
+		IndexInfo  *ii;
+
+		indexDesc = index_open(lfirst_oid(lc), RowExclusiveLock);
+		ii = BuildIndexInfo(indexDesc);
+		if (ii->ii_ExclusionOps != NULL ||
+			has_parallel_hazard((Node *) ii->ii_Expressions, false) ||
+			has_parallel_hazard((Node *) ii->ii_Predicate, false))
+			safe = false;
+		index_close(indexDesc, NoLock);
+
+		if (!safe)
+			break;
+	}
+	list_free(indexoidlist);
+
+	return safe;
+}
+
+/*
+ * Copy FROM file to relation, with the help of parallel workers.
+ *
+ * The leader reads the input and splits it into lines, and hands them out
+ * in batches to the workers, through a shared memory queue per worker.  The
+ * workers parse the lines, convert the fields with the input functions and
+ * insert the tuples and index entries, running CopyFrom on their share of
+ * the input.  Finding the line boundaries stays in the leader, because in
+ * CSV mode it depends on the quoting in all of the preceding input, and
+ * because the input may have to be converted to the server encoding first.
+ * It's a small part of the work, compared with the rest.
+ *
+ * The workers insert with our transaction and command IDs.  If no worker
+ * can be launched, the leader does all the work by itself.
+ */
+static uint64
+CopyFromParallel(CopyState cstate, List *attnamelist, List *options)
+{
+	ParallelContext *pcxt;
+	ParallelCopyShared *shared;
+	shm_mq_handle **mqh;
+	StringInfoData *batches;
+	ErrorContextCallback errcallback;
+	char	   *options_str;
+	char	   *attnames_str;
+	char	   *rtable_str;
+	char	   *space;
+	Size		size;
+	int			hi_options;
+	int			nworkers;
+	int			cur;
+	bool		done = false;
+	uint64		processed = 0;
+	int			i;
+
+	hi_options = CopyFromHeapInsertOptions(cstate);
+
+	/* These can't be assigned once we're in parallel mode */
+	(void) GetCurrentTransactionId();
+	(void) GetCurrentCommandId(true);
+
+	EnterParallelMode();
+
+	pcxt = CreateParallelContext(ParallelCopyMain, cstate->nworkers);
+
+	options_str = nodeToString(options);
+	attnames_str = nodeToString(attnamelist);
+	rtable_str = nodeToString(cstate->range_table);
+
+	size = add_size(offsetof(ParallelCopyShared, processed),
+					mul_size(cstate->nworkers, sizeof(uint64)));
+	shm_toc_estimate_chunk(&pcxt->estimator, size);
+	shm_toc_estimate_chunk(&pcxt->estimator, strlen(options_str) + 1);
+	shm_toc_estimate_chunk(&pcxt->estimator, strlen(attnames_str) + 1);
+	shm_toc_estimate_chunk(&pcxt->estimator, strlen(rtable_str) + 1);
+	shm_toc_estimate_chunk(&pcxt->estimator,
+						   mul_size(PARALLEL_COPY_QUEUE_SIZE,
+									cstate->nworkers));
+	shm_toc_estimate_keys(&pcxt->estimator, 5);
+
+	InitializeParallelDSM(pcxt);
+
+	shared = (ParallelCopyShared *) shm_toc_allocate(pcxt->toc, size);
+	shared->relid = RelationGetRelid(cstate->rel);
+	shared->hi_options = hi_options;
+	memset(shared->processed, 0, cstate->nworkers * sizeof(uint64));
+	shm_toc_insert(pcxt->toc, PARALLEL_COPY_KEY_SHARED, shared);
+
+	space = shm_toc_allocate(pcxt->toc, strlen(options_str) + 1);
+	strcpy(space, options_str);
+	shm_toc_insert(pcxt->toc, PARALLEL_COPY_KEY_OPTIONS, space);
+	space = shm_toc_allocate(pcxt->toc, strlen(attnames_str) + 1);
+	strcpy(space, attnames_str);
+	shm_toc_insert(pcxt->toc, PARALLEL_COPY_KEY_ATTNAMES, space);
+	space = shm_toc_allocate(pcxt->toc, strlen(rtable_str) + 1);
+	strcpy(space, rtable_str);
+	shm_toc_insert(pcxt->toc, PARALLEL_COPY_KEY_RANGE_TABLE, space);
+
+	/* Set up the queues, with us as the sender */
+	space = shm_toc_allocate(pcxt->toc,
+							 mul_size(PARALLEL_COPY_QUEUE_SIZE,
+									  pcxt->nworkers));
+	mqh = (shm_mq_handle **) palloc(pcxt->nworkers * sizeof(shm_mq_handle *));
+	for (i = 0; i < pcxt->nworkers; i++)
+	{
+		shm_mq	   *mq;
+
+		mq = shm_mq_create(space + (Size) i * PARALLEL_COPY_QUEUE_SIZE,
+						   PARALLEL_COPY_QUEUE_SIZE);
+		shm_mq_set_sender(mq, MyProc);
+		mqh[i] = shm_mq_attach(mq, pcxt->seg, NULL);
+	}
+	shm_toc_insert(pcxt->toc, PARALLEL_COPY_KEY_QUEUES, space);
+
+	LaunchParallelWorkers(pcxt);
+
+	nworkers = pcxt->nworkers_launched;
+	if (nworkers == 0)
+	{
+		DestroyParallelContext(pcxt);
+		ExitParallelMode();
+		return CopyFrom(cstate);
+	}
+
+	/* Notice if a worker fails to start, rather than wait for it forever */
+	for (i = 0; i < nworkers; i++)
+		shm_mq_set_handle(mqh[i], pcxt->worker[i].bgwhandle);
+
+	batches = (StringInfoData *) palloc(nworkers * sizeof(StringInfoData));
+	for (i = 0; i < nworkers; i++)
+		initStringInfo(&batches[i]);
+
+	/*
+	 * Set up callback to identify error line number.  It's only installed
+	 * while reading, so that it isn't added to errors rethrown from the
+	 * workers, which report their own line numbers.
+	 */
+	errcallback.callback = CopyFromErrorCallback;
+	errcallback.arg = (void *) cstate;
+	errcallback.previous = error_context_stack;
+
+	/* on input just throw the header line away */
+	if (cstate->header_line)
+	{
+		cstate->cur_lineno++;
+		error_context_stack = &errcallback;
+		done = CopyReadLine(cstate);
+		error_context_stack = errcallback.previous;
+	}
+
+	cur = 0;
+	while (!done)
+	{
+		StringInfo	batch = &batches[cur];
+
+		CHECK_FOR_INTERRUPTS();
+
+		cstate->cur_lineno++;
+		error_context_stack = &errcallback;
+		done = CopyReadLine(cstate);
+		error_context_stack = errcallback.previous;
+
+		/* EOF at start of line means we're done, see NextCopyFromRawFields */
+		if (done && cstate->line_buf.len == 0)
+			break;
+
+		appendBinaryStringInfo(batch, (char *) &cstate->cur_lineno,
+							   sizeof(int));
+		appendBinaryStringInfo(batch, (char *) &cstate->line_buf.len,
+							   sizeof(int));
+		appendBinaryStringInfo(batch, cstate->line_buf.data,
+							   cstate->line_buf.len);
+
+		if (batch->len >= PARALLEL_COPY_BATCH_SIZE)
+			cur = ParallelCopyNextWorker(mqh, batches, nworkers, cur);
+	}
+
+	/*
+	 * In the old protocol, tell pqcomm that we can process normal protocol
+	 * messages again.
+	 */
+	if (cstate->copy_dest == COPY_OLD_FE)
+		pq_endmsgread();
+
+	/* Send what's left, and tell the workers there's no more to come */
+	for (i = 0; i < nworkers; i++)
+	{
+		if (batches[i].len > 0)
+			(void) ParallelCopySendBatch(mqh[i], &batches[i], false);
+		shm_mq_detach(shm_mq_get_queue(mqh[i]));
+		pfree(batches[i].data);
+	}
+
+	WaitForParallelWorkersToFinish(pcxt);
+
+	for (i = 0; i < nworkers; i++)
+		processed += shared->processed[i];
+
+	DestroyParallelContext(pcxt);
+	ExitParallelMode();
+
+	/* See CopyFrom */
+	table_finish_bulk_insert(cstate->rel, hi_options);
+
+	return processed;
+}
+
+/*
+ * Find the worker whose batch of lines the leader of a parallel COPY FROM
+ * should fill next, once batch 'cur' is full.
+ *
+ * Only the batch being filled is ever partially filled; the others are
+ * either empty, or full and waiting to be sent.  A batch that couldn't be
+ * sent in full must be sent again as it is, since part of it may already
+ * be in the queue.  If all the queues are full, wait until a worker makes
+ * room in one.
+ */
+static int
+ParallelCopyNextWorker(shm_mq_handle **mqh, StringInfoData *batches,
+					   int nworkers, int cur)
+{
+	for (;;)
+	{
+		int			n;
+
+		/* Try the others first, and the one we just filled last */
+		for (n = 1; n <= nworkers; n++)
+		{
+			int			i = (cur + n) % nworkers;
+
+			if (batches[i].len == 0 ||
+				ParallelCopySendBatch(mqh[i], &batches[i], true))
+				return i;
+		}
+
+		WaitLatch(MyLatch, WL_LATCH_SET, 0);
+		ResetLatch(MyLatch);
+		CHECK_FOR_INTERRUPTS();
+	}
+}
+
+/*
+ * Send a batch of lines to a worker of a parallel COPY FROM, and empty it.
+ * With 'nowait', return false if the queue is too full to take it all.
+ */
+static bool
+ParallelCopySendBatch(shm_mq_handle *mqh, StringInfo batch, bool nowait)
+{
+	shm_mq_result res;
+
+	res = shm_mq_send(mqh, batch->len, batch->data, nowait);
+	if (res == SHM_MQ_WOULD_BLOCK)
+		return false;
+	if (res == SHM_MQ_DETACHED)
+	{
+		/* Report the worker's error instead, if it's already there */
+		CHECK_FOR_INTERRUPTS();
+		ereport(ERROR,
+				(errcode(ERRCODE_INTERNAL_ERROR),
+				 errmsg("lost connection to parallel worker")));
+	}
+
+	resetStringInfo(batch);
+	return true;
+}
+
+/*
+ * Main entry point of a worker of a parallel COPY FROM.
+ *
+ * The worker opens the table and sets up for COPY FROM like the leader did,
+ * then loads the lines that the leader sends it.  Thanks to group locking,
+ * its lock on the table doesn't conflict with the leader's.
+ */
+static void
+ParallelCopyMain(dsm_segment *seg, shm_toc *toc)
+{
+	ParallelCopyShared *shared;
+	List	   *options;
+	List	   *attnamelist;
+	List	   *range_table;
+	char	   *space;
+	shm_mq	   *mq;
+	Relation	rel;
+	CopyState	cstate;
+
+	shared = (ParallelCopyShared *) shm_toc_lookup(toc,
+												   PARALLEL_COPY_KEY_SHARED);
+	if (shared == NULL)
+		elog(ERROR, "could not find parallel COPY state");
+
+	options = (List *) stringToNode(shm_toc_lookup(toc,
+												   PARALLEL_COPY_KEY_OPTIONS));
+	attnamelist = (List *) stringToNode(shm_toc_lookup(toc,
+												PARALLEL_COPY_KEY_ATTNAMES));
+	range_table = (List *) stringToNode(shm_toc_lookup(toc,
+											 PARALLEL_COPY_KEY_RANGE_TABLE));
+
+	space = shm_toc_lookup(toc, PARALLEL_COPY_KEY_QUEUES);
+	mq = (shm_mq *) (space + (Size) ParallelWorkerNumber *
+					 PARALLEL_COPY_QUEUE_SIZE);
+	shm_mq_set_receiver(mq, MyProc);
+
+	rel = heap_open(shared->relid, RowExclusiveLock);
+
+	cstate = BeginCopyFromInternal(rel, NULL, false, attnamelist, options,
+								   shm_mq_attach(mq, seg, NULL));
+	cstate->range_table = range_table;
+	cstate->leader_hi_options = shared->hi_options | HEAP_INSERT_PARALLEL;
+
+	shared->processed[ParallelWorkerNumber] = CopyFrom(cstate);
+
+	EndCopyFrom(cstate);
+
+	heap_close(rel, NoLock);
+}
+
 /*
  * Setup to read tuples from a file for COPY FROM.
  *
@@ -2654,6 +3389,23 @@ BeginCopyFrom(Relation rel,
 			  bool is_program,
 			  List *attnamelist,
 			  List *options)
+{
+	return BeginCopyFromInternal(rel, filename, is_program, attnamelist,
+								 options, NULL);
+}
+
+/*
+ * Workhorse of BeginCopyFrom.  In a worker of a parallel COPY FROM, the
+ * lines come from the leader through 'line_mqh' rather than from a file or
+ * the client.
+ */
+static CopyState
+BeginCopyFromInternal(Relation rel,
+					  const char *filename,
+					  bool is_program,
+					  List *attnamelist,
+					  List *options,
+					  shm_mq_handle *line_mqh)
 {
 	CopyState	cstate;
 	bool		pipe = (filename == NULL);
@@ -2669,6 +3421,7 @@ BeginCopyFrom(Relation rel,
 	ExprState **defexprs;
 	MemoryContext oldcontext;
 	bool		volatile_defexprs;
+	bool		parallel_unsafe_defexprs;
 
 	cstate = BeginCopy(true, rel, NULL, NULL, InvalidOid, attnamelist, options);
 	oldcontext = MemoryContextSwitchTo(cstate->copycontext);
@@ -2693,6 +3446,7 @@ BeginCopyFrom(Relation rel,
 	num_phys_attrs = tupDesc->natts;
 	num_defaults = 0;
 	volatile_defexprs = false;
+	parallel_unsafe_defexprs = false;
 
 	/*
 	 * Pick up the required catalog information for each attribute in the
@@ -2753,6 +3507,11 @@ BeginCopyFrom(Relation rel,
 				 */
 				if (!volatile_defexprs)
 					volatile_defexprs = contain_volatile_functions_not_nextval((Node *) defexpr);
+
+				/* Parallel workers can only use parallel-safe defaults */
+				if (cstate->nworkers > 0 && !parallel_unsafe_defexprs)
+					parallel_unsafe_defexprs = has_parallel_hazard((Node *) defexpr,
+																   false);
 			}
 		}
 	}
@@ -2763,10 +3522,19 @@ BeginCopyFrom(Relation rel,
 	cstate->defmap = defmap;
 	cstate->defexprs = defexprs;
 	cstate->volatile_defexprs = volatile_defexprs;
+	cstate->parallel_unsafe_defexprs = parallel_unsafe_defexprs;
 	cstate->num_defaults = num_defaults;
 	cstate->is_program = is_program;
 
-	if (pipe)
+	if (line_mqh != NULL)
+	{
+		/* The leader reads the input, and has thrown the header line away */
+		Assert(pipe && !is_program && !cstate->binary);
+		cstate->copy_dest = COPY_PARALLEL;
+		cstate->line_mqh = line_mqh;
+		cstate->header_line = false;
+	}
+	else if (pipe)
 	{
 		Assert(!is_program);	/* the grammar does not allow this */
 		if (whereToSendOutput == DestRemote)
@@ -2897,26 +3665,35 @@ NextCopyFromRawFields(CopyState cstate, char ***fields, int *nfields)
 	/* only available for text or csv input */
 	Assert(!cstate->binary);
 
-	/* on input just throw the header line away */
-	if (cstate->cur_lineno == 0 && cstate->header_line)
+	/* in a parallel worker, the leader has done the reading */
+	if (cstate->copy_dest == COPY_PARALLEL)
 	{
-		cstate->cur_lineno++;
-		if (CopyReadLine(cstate))
+		if (!CopyReadLineFromLeader(cstate))
 			return false;		/* done */
 	}
+	else
+	{
+		/* on input just throw the header line away */
+		if (cstate->cur_lineno == 0 && cstate->header_line)
+		{
+			cstate->cur_lineno++;
+			if (CopyReadLine(cstate))
+				return false;	/* done */
+		}
 
-	cstate->cur_lineno++;
+		cstate->cur_lineno++;
 
-	/* Actually read the line into memory here */
-	done = CopyReadLine(cstate);
+		/* Actually read the line into memory here */
+		done = CopyReadLine(cstate);
 
-	/*
-	 * EOF at start of line means we're done.  If we see EOF after some
-	 * characters, we act as though it was newline followed by EOF, ie,
-	 * process the line and then exit loop on next iteration.
-	 */
-	if (done && cstate->line_buf.len == 0)
-		return false;
+		/*
+		 * EOF at start of line means we're done.  If we see EOF after some
+		 * characters, we act as though it was newline followed by EOF, ie,
+		 * process the line and then exit loop on next iteration.
+		 */
+		if (done && cstate->line_buf.len == 0)
+			return false;
+	}
 
 	/* Parse the line into de-escaped field values */
 	if (cstate->csv_mode)
@@ -3283,6 +4060,52 @@ CopyReadLine(CopyState cstate)
 	return result;
 }
 
+/*
+ * Get the next line from the leader of a parallel COPY FROM, and stash it in
+ * line_buf along with its line number.  The leader has already removed the
+ * newline and converted the line to the server encoding.
+ *
+ * Result is false if there are no more lines.
+ */
+static bool
+CopyReadLineFromLeader(CopyState cstate)
+{
+	int			len;
+
+	if (cstate->line_batch_pos >= cstate->line_batch_len)
+	{
+		shm_mq_result res;
+		Size		nbytes;
+		void	   *data;
+
+		/* The leader detaches from the queue once it has sent everything */
+		res = shm_mq_receive(cstate->line_mqh, &nbytes, &data, false);
+		if (res == SHM_MQ_DETACHED)
+			return false;
+		Assert(res == SHM_MQ_SUCCESS);
+
+		cstate->line_batch = (char *) data;
+		cstate->line_batch_len = nbytes;
+		cstate->line_batch_pos = 0;
+	}
+
+	memcpy(&cstate->cur_lineno, cstate->line_batch + cstate->line_batch_pos,
+		   sizeof(int));
+	cstate->line_batch_pos += sizeof(int);
+	memcpy(&len, cstate->line_batch + cstate->line_batch_pos, sizeof(int));
+	cstate->line_batch_pos += sizeof(int);
+
+	resetStringInfo(&cstate->line_buf);
+	appendBinaryStringInfo(&cstate->line_buf,
+						   cstate->line_batch + cstate->line_batch_pos, len);
+	cstate->line_batch_pos += len;
+
+	cstate->line_buf_valid = true;
+	cstate->line_buf_converted = true;
+
+	return true;
+}
+
 /*
  * CopyReadLineText - inner loop of CopyReadLine for text mode
  */
@@ -3304,6 +4127,10 @@ CopyReadLineText(CopyState cstate)
 	char		quotec = '\0';
 	char		escapec = '\0';
 
+	/* characters that CopyScanForChars must stop at */
+	char		special3 = '\\';
+	char		special4 = '\\';
+
 	if (cstate->csv_mode)
 	{
 		quotec = cstate->quote[0];
@@ -3311,6 +4138,10 @@ CopyReadLineText(CopyState cstate)
 		/* ignore special escape processing if it's the same as quotec */
 		if (quotec == escapec)
 			escapec = '\0';
+
+		/* backslash only matters at the start of a line, see below */
+		special3 = quotec;
+		special4 = (escapec != '\0') ? escapec : quotec;
 	}
 
 	mblen_str[1] = '\0';
@@ -3380,6 +4211,30 @@ CopyReadLineText(CopyState cstate)
 			need_data = false;
 		}
 
+		/*
+		 * Skip over any run of characters that can't end the line or change
+		 * the CSV quoting state.  They become part of the line as they are.
+		 * In CSV mode a backslash is only of interest as the first character
+		 * of a line, so we don't try this there.  If the run extends to the
+		 * end of the buffer, go back to the top to load more data.
+		 */
+		if (!first_char_in_line)
+		{
+			int			skip;
+
+			skip = CopyScanForChars(copy_raw_buf + raw_buf_ptr,
+									copy_buf_len - raw_buf_ptr,
+									'\n', '\r', special3, special4,
+									cstate->encoding_embeds_ascii);
+			if (skip > 0)
+			{
+				raw_buf_ptr += skip;
+				last_was_esc = false;
+				if (raw_buf_ptr >= copy_buf_len)
+					continue;
+			}
+		}
+
 		/* OK to fetch a character */
 		prev_raw_ptr = raw_buf_ptr;
 		c = copy_raw_buf[raw_buf_ptr++];
@@ -3748,6 +4603,17 @@ CopyReadAttributesText(CopyState cstate)
 		for (;;)
 		{
 			char		c;
+			int			n;
+
+			/* Copy any run of characters that need no de-escaping at once */
+			n = CopyScanForChars(cur_ptr, line_end_ptr - cur_ptr,
+								 delimc, '\\', '\\', '\\', false);
+			if (n > 0)
+			{
+				memcpy(output_ptr, cur_ptr, n);
+				output_ptr += n;
+				cur_ptr += n;
+			}
 
 			end_ptr = cur_ptr;
 			if (cur_ptr >= line_end_ptr)
@@ -3974,10 +4840,21 @@ CopyReadAttributesCSV(CopyState cstate)
 		for (;;)
 		{
 			char		c;
+			int			n;
 
 			/* Not in quote */
 			for (;;)
 			{
+				/* Copy any run of ordinary characters at once */
+				n = CopyScanForChars(cur_ptr, line_end_ptr - cur_ptr,
+									 delimc, quotec, quotec, quotec, false);
+				if (n > 0)
+				{
+					memcpy(output_ptr, cur_ptr, n);
+					output_ptr += n;
+					cur_ptr += n;
+				}
+
 				end_ptr = cur_ptr;
 				if (cur_ptr >= line_end_ptr)
 					goto endfield;
@@ -4001,6 +4878,16 @@ CopyReadAttributesCSV(CopyState cstate)
 			/* In quote */
 			for (;;)
 			{
+				/* Likewise, up to the next escape or quote character */
+				n = CopyScanForChars(cur_ptr, line_end_ptr - cur_ptr,
+									 escapec, quotec, quotec, quotec, false);
+				if (n > 0)
+				{
+					memcpy(output_ptr, cur_ptr, n);
+					output_ptr += n;
+					cur_ptr += n;
+				}
+
 				end_ptr = cur_ptr;
 				if (cur_ptr >= line_end_ptr)
 					ereport(ERROR,
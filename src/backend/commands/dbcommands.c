@@ -59,6 +59,7 @@
 #include "utils/builtins.h"
 #include "utils/fmgroids.h"
 #include "utils/pg_locale.h"
+#include "utils/relcache.h"
 #include "utils/snapmgr.h"
 #include "utils/syscache.h"
 #include "utils/tqual.h"
@@ -900,6 +901,9 @@ dropdb(const char *dbname, bool missing_ok)
 	 */
 	pgstat_drop_database(db_id);
 
+	/* Likewise for any relcache entries preloaded into its init file */
+	RelationCacheInitFileForgetDatabase(db_id);
+
 	/*
 	 * Tell checkpointer to forget any pending fsync and unlink requests for
 	 * files in the database; else the fsyncs will fail at next checkpoint, or
@@ -2114,6 +2118,9 @@ dbase_redo(XLogReaderState *record)
 		/* Clean out the xlog relcache too */
 		XLogDropDatabase(xlrec->db_id);
 
+		/* ... and the registry of preloaded relcache entries */
+		RelationCacheInitFileForgetDatabase(xlrec->db_id);
+
 		/* And remove the physical files */
 		if (!rmtree(dst_path, true))
 			ereport(WARNING,
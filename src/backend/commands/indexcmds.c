@@ -19,6 +19,7 @@
 #include "access/htup_details.h"
 #include "access/reloptions.h"
 #include "access/sysattr.h"
+#include "access/tableam.h"
 #include "access/xact.h"
 #include "catalog/catalog.h"
 #include "catalog/index.h"
@@ -128,7 +129,6 @@ CheckIndexCompatible(Oid oldId,
 	Oid			relationId;
 	HeapTuple	tuple;
 	Form_pg_index indexForm;
-	Form_pg_am	accessMethodForm;
 	IndexAmRoutine *amRoutine;
 	bool		amcanorder;
 	int16	   *coloptions;
@@ -164,8 +164,7 @@ CheckIndexCompatible(Oid oldId,
 				 errmsg("access method \"%s\" does not exist",
 						accessMethodName)));
 	accessMethodId = HeapTupleGetOid(tuple);
-	accessMethodForm = (Form_pg_am) GETSTRUCT(tuple);
-	amRoutine = GetIndexAmRoutine(accessMethodForm->amhandler);
+	amRoutine = GetIndexAmRoutineByAmId(accessMethodId);
 	ReleaseSysCache(tuple);
 
 	amcanorder = amRoutine->amcanorder;
@@ -321,7 +320,6 @@ DefineIndex(Oid relationId,
 	Relation	rel;
 	Relation	indexRelation;
 	HeapTuple	tuple;
-	Form_pg_am	accessMethodForm;
 	IndexAmRoutine *amRoutine;
 	bool		amcanorder;
 	amoptions_function amoptions;
@@ -390,6 +388,18 @@ DefineIndex(Oid relationId,
 							RelationGetRelationName(rel))));
 	}
 
+	/*
+	 * Index builds and index scans read heap pages directly, so only tables
+	 * using the heap can be indexed.
+	 */
+	if (!RelationUsesHeapAm(rel))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("cannot create index on table \"%s\"",
+						RelationGetRelationName(rel)),
+				 errdetail("Access method \"%s\" does not support indexes.",
+						   get_am_name(rel->rd_rel->relam))));
+
 	/*
 	 * Don't try to CREATE INDEX on temp tables of other backends.
 	 */
@@ -496,8 +506,7 @@ DefineIndex(Oid relationId,
 							accessMethodName)));
 	}
 	accessMethodId = HeapTupleGetOid(tuple);
-	accessMethodForm = (Form_pg_am) GETSTRUCT(tuple);
-	amRoutine = GetIndexAmRoutine(accessMethodForm->amhandler);
+	amRoutine = GetIndexAmRoutineByAmId(accessMethodId);
 
 	if (strcmp(accessMethodName, "hash") == 0 &&
 		RelationNeedsWAL(rel))
@@ -20,6 +20,7 @@
 #include "access/reloptions.h"
 #include "access/relscan.h"
 #include "access/sysattr.h"
+#include "access/tableam.h"
 #include "access/xact.h"
 #include "access/xlog.h"
 #include "catalog/catalog.h"
@@ -475,6 +476,7 @@ DefineRelation(CreateStmt *stmt, char relkind, Oid ownerId,
 	AttrNumber	attnum;
 	static char *validnsps[] = HEAP_RELOPT_NAMESPACES;
 	Oid			ofTypeId;
+	Oid			accessMethodId = InvalidOid;
 	ObjectAddress address;
 
 	/*
@@ -572,6 +574,18 @@ DefineRelation(CreateStmt *stmt, char relkind, Oid ownerId,
 	else
 		ofTypeId = InvalidOid;
 
+	/*
+	 * Look up the table access method, if one was given.  Tables using the
+	 * heap store InvalidOid as their relam, as the system catalogs do.
+	 */
+	if (stmt->accessMethod != NULL)
+	{
+		Assert(relkind == RELKIND_RELATION);
+		accessMethodId = get_table_am_oid(stmt->accessMethod, false);
+		if (accessMethodId == HEAP_TABLE_AM_OID)
+			accessMethodId = InvalidOid;
+	}
+
 	/*
 	 * Look up inheritance ancestors and generate relation schema, including
 	 * inherited attributes.
@@ -664,6 +678,7 @@ DefineRelation(CreateStmt *stmt, char relkind, Oid ownerId,
 										  InvalidOid,
 										  ofTypeId,
 										  ownerId,
+										  accessMethodId,
 										  descriptor,
 										  list_concat(cookedDefaults,
 													  old_constraints),
@@ -3730,6 +3745,25 @@ ATRewriteTables(AlterTableStmt *parsetree, List **wqueue, LOCKMODE lockmode)
 		if (tab->relkind == RELKIND_FOREIGN_TABLE)
 			continue;
 
+		/*
+		 * Rewriting the table and checking its contents against new
+		 * constraints both read heap pages directly.
+		 */
+		if (tab->rewrite > 0 || tab->constraints != NIL || tab->new_notnull)
+		{
+			Relation	rel;
+
+			rel = heap_open(tab->relid, NoLock);
+			if (!RelationUsesHeapAm(rel))
+				ereport(ERROR,
+						(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+						 errmsg("cannot rewrite or check the contents of table \"%s\"",
+								RelationGetRelationName(rel)),
+						 errdetail("Access method \"%s\" does not support this.",
+								   get_am_name(rel->rd_rel->relam))));
+			heap_close(rel, NoLock);
+		}
+
 		/*
 		 * If we change column data types or add/remove OIDs, the operation
 		 * has to be propagated to tables that use this table's rowtype as a
@@ -7312,8 +7346,7 @@ validateCheckConstraint(Relation rel, HeapTuple constrtup)
 	Expr	   *origexpr;
 	List	   *exprstate;
 	TupleDesc	tupdesc;
-	HeapScanDesc scan;
-	HeapTuple	tuple;
+	TableScanDesc scan;
 	ExprContext *econtext;
 	MemoryContext oldcxt;
 	TupleTableSlot *slot;
@@ -7350,7 +7383,7 @@ validateCheckConstraint(Relation rel, HeapTuple constrtup)
 	econtext->ecxt_scantuple = slot;
 
 	snapshot = RegisterSnapshot(GetLatestSnapshot());
-	scan = heap_beginscan(rel, snapshot, 0, NULL);
+	scan = table_beginscan(rel, snapshot, 0, NULL);
 
 	/*
 	 * Switch to per-tuple memory context and reset it for each tuple
@@ -7358,10 +7391,8 @@ validateCheckConstraint(Relation rel, HeapTuple constrtup)
 	 */
 	oldcxt = MemoryContextSwitchTo(GetPerTupleMemoryContext(estate));
 
-	while ((tuple = heap_getnext(scan, ForwardScanDirection)) != NULL)
+	while (table_getnextslot(rel, scan, ForwardScanDirection, slot))
 	{
-		ExecStoreTuple(tuple, slot, InvalidBuffer, false);
-
 		if (!ExecQual(exprstate, econtext, true))
 			ereport(ERROR,
 					(errcode(ERRCODE_CHECK_VIOLATION),
@@ -7373,7 +7404,7 @@ validateCheckConstraint(Relation rel, HeapTuple constrtup)
 	}
 
 	MemoryContextSwitchTo(oldcxt);
-	heap_endscan(scan);
+	table_endscan(rel, scan);
 	UnregisterSnapshot(snapshot);
 	ExecDropSingleTupleTableSlot(slot);
 	FreeExecutorState(estate);
@@ -9666,7 +9697,12 @@ ATExecSetTableSpace(Oid tableOid, Oid newTableSpace, LOCKMODE lockmode)
 	{
 		if (smgrexists(rel->rd_smgr, forkNum))
 		{
-			smgrcreate(dstrel, forkNum, false);
+			bool		compress;
+
+			/* an init fork is compressed like the main fork */
+			compress = (forkNum == INIT_FORKNUM &&
+						UsePageCompression(newrnode.spcNode));
+			smgrcreate(dstrel, forkNum, false, compress);
 
 			/*
 			 * WAL log creation if the relation is persistent, or this is the
@@ -9675,7 +9711,7 @@ ATExecSetTableSpace(Oid tableOid, Oid newTableSpace, LOCKMODE lockmode)
 			if (rel->rd_rel->relpersistence == RELPERSISTENCE_PERMANENT ||
 				(rel->rd_rel->relpersistence == RELPERSISTENCE_UNLOGGED &&
 				 forkNum == INIT_FORKNUM))
-				log_smgrcreate(&newrnode, forkNum);
+				log_smgrcreate(&newrnode, forkNum, compress);
 			copy_relation_data(rel->rd_smgr, dstrel, forkNum,
 							   rel->rd_rel->relpersistence);
 		}
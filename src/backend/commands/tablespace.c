@@ -65,6 +65,7 @@
 #include "catalog/objectaccess.h"
 #include "catalog/pg_namespace.h"
 #include "catalog/pg_tablespace.h"
+#include "catalog/storage.h"
 #include "commands/comment.h"
 #include "commands/seclabel.h"
 #include "commands/tablecmds.h"
@@ -241,6 +242,7 @@ CreateTableSpace(CreateTableSpaceStmt *stmt)
 	char	   *location;
 	Oid			ownerId;
 	Datum		newOptions;
+	TableSpaceOpts *spcopts;
 
 	/* Must be super user */
 	if (!superuser())
@@ -339,7 +341,9 @@ CreateTableSpace(CreateTableSpaceStmt *stmt)
 	newOptions = transformRelOptions((Datum) 0,
 									 stmt->options,
 									 NULL, NULL, false, false);
-	(void) tablespace_reloptions(newOptions, true);
+	spcopts = (TableSpaceOpts *) tablespace_reloptions(newOptions, true);
+	if (spcopts != NULL && spcopts->page_compression)
+		CheckPageCompressionSettings();
 	if (newOptions != (Datum) 0)
 		values[Anum_pg_tablespace_spcoptions - 1] = newOptions;
 	else
@@ -999,6 +1003,7 @@ AlterTableSpaceOptions(AlterTableSpaceOptionsStmt *stmt)
 	Oid			tablespaceoid;
 	Datum		datum;
 	Datum		newOptions;
+	TableSpaceOpts *spcopts;
 	Datum		repl_val[Natts_pg_tablespace];
 	bool		isnull;
 	bool		repl_null[Natts_pg_tablespace];
@@ -1033,7 +1038,9 @@ AlterTableSpaceOptions(AlterTableSpaceOptionsStmt *stmt)
 	newOptions = transformRelOptions(isnull ? (Datum) 0 : datum,
 									 stmt->options, NULL, NULL, false,
 									 stmt->isReset);
-	(void) tablespace_reloptions(newOptions, true);
+	spcopts = (TableSpaceOpts *) tablespace_reloptions(newOptions, true);
+	if (spcopts != NULL && spcopts->page_compression)
+		CheckPageCompressionSettings();
 
 	/* Build new tuple. */
 	memset(repl_null, false, sizeof(repl_null));
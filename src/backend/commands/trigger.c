@@ -17,6 +17,7 @@
 #include "access/heapam.h"
 #include "access/sysattr.h"
 #include "access/htup_details.h"
+#include "access/tableam.h"
 #include "access/xact.h"
 #include "catalog/catalog.h"
 #include "catalog/dependency.h"
@@ -184,6 +185,18 @@ CreateTrigger(CreateTrigStmt *stmt, const char *queryString,
 					 errmsg("\"%s\" is a table",
 							RelationGetRelationName(rel)),
 					 errdetail("Tables cannot have INSTEAD OF triggers.")));
+
+		/*
+		 * Row-level triggers fetch and lock the old and new row versions
+		 * directly in the heap.
+		 */
+		if (stmt->row && !RelationUsesHeapAm(rel))
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg("cannot create row-level trigger on table \"%s\"",
+							RelationGetRelationName(rel)),
+					 errdetail("Access method \"%s\" does not support row-level triggers.",
+							   get_am_name(rel->rd_rel->relam))));
 	}
 	else if (rel->rd_rel->relkind == RELKIND_VIEW)
 	{
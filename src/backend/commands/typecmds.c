@@ -32,6 +32,7 @@
 #include "postgres.h"
 
 #include "access/htup_details.h"
+#include "access/tableam.h"
 #include "access/xact.h"
 #include "catalog/binary_upgrade.h"
 #include "catalog/catalog.h"
@@ -2317,14 +2318,15 @@ AlterDomainNotNull(List *names, bool notNull)
 			RelToCheck *rtc = (RelToCheck *) lfirst(rt);
 			Relation	testrel = rtc->rel;
 			TupleDesc	tupdesc = RelationGetDescr(testrel);
-			HeapScanDesc scan;
-			HeapTuple	tuple;
+			TableScanDesc scan;
+			TupleTableSlot *slot;
 			Snapshot	snapshot;
 
 			/* Scan all tuples in this relation */
 			snapshot = RegisterSnapshot(GetLatestSnapshot());
-			scan = heap_beginscan(testrel, snapshot, 0, NULL);
-			while ((tuple = heap_getnext(scan, ForwardScanDirection)) != NULL)
+			slot = MakeSingleTupleTableSlot(tupdesc);
+			scan = table_beginscan(testrel, snapshot, 0, NULL);
+			while (table_getnextslot(testrel, scan, ForwardScanDirection, slot))
 			{
 				int			i;
 
@@ -2333,7 +2335,7 @@ AlterDomainNotNull(List *names, bool notNull)
 				{
 					int			attnum = rtc->atts[i];
 
-					if (heap_attisnull(tuple, attnum))
+					if (slot_attisnull(slot, attnum))
 					{
 						/*
 						 * In principle the auxiliary information for this
@@ -2352,7 +2354,8 @@ AlterDomainNotNull(List *names, bool notNull)
 					}
 				}
 			}
-			heap_endscan(scan);
+			table_endscan(testrel, scan);
+			ExecDropSingleTupleTableSlot(slot);
 			UnregisterSnapshot(snapshot);
 
 			/* Close each rel after processing, but keep lock */
@@ -2715,14 +2718,15 @@ validateDomainConstraint(Oid domainoid, char *ccbin)
 		RelToCheck *rtc = (RelToCheck *) lfirst(rt);
 		Relation	testrel = rtc->rel;
 		TupleDesc	tupdesc = RelationGetDescr(testrel);
-		HeapScanDesc scan;
-		HeapTuple	tuple;
+		TableScanDesc scan;
+		TupleTableSlot *slot;
 		Snapshot	snapshot;
 
 		/* Scan all tuples in this relation */
 		snapshot = RegisterSnapshot(GetLatestSnapshot());
-		scan = heap_beginscan(testrel, snapshot, 0, NULL);
-		while ((tuple = heap_getnext(scan, ForwardScanDirection)) != NULL)
+		slot = MakeSingleTupleTableSlot(tupdesc);
+		scan = table_beginscan(testrel, snapshot, 0, NULL);
+		while (table_getnextslot(testrel, scan, ForwardScanDirection, slot))
 		{
 			int			i;
 
@@ -2734,7 +2738,7 @@ validateDomainConstraint(Oid domainoid, char *ccbin)
 				bool		isNull;
 				Datum		conResult;
 
-				d = heap_getattr(tuple, attnum, tupdesc, &isNull);
+				d = slot_getattr(slot, attnum, &isNull);
 
 				econtext->domainValue_datum = d;
 				econtext->domainValue_isNull = isNull;
@@ -2764,7 +2768,8 @@ validateDomainConstraint(Oid domainoid, char *ccbin)
 
 			ResetExprContext(econtext);
 		}
-		heap_endscan(scan);
+		table_endscan(testrel, scan);
+		ExecDropSingleTupleTableSlot(slot);
 		UnregisterSnapshot(snapshot);
 
 		/* Hold relation lock till commit (XXX bad for concurrency) */
@@ -28,12 +28,14 @@
 #include "access/heapam.h"
 #include "access/htup_details.h"
 #include "access/multixact.h"
+#include "access/tableam.h"
 #include "access/transam.h"
 #include "access/xact.h"
 #include "catalog/namespace.h"
 #include "catalog/pg_database.h"
 #include "catalog/pg_namespace.h"
 #include "commands/cluster.h"
+#include "commands/defrem.h"
 #include "commands/vacuum.h"
 #include "miscadmin.h"
 #include "pgstat.h"
@@ -59,6 +61,14 @@ int			vacuum_freeze_table_age;
 int			vacuum_multixact_freeze_min_age;
 int			vacuum_multixact_freeze_table_age;
 
+/*
+ * During a parallel index vacuum, the cost balance of the leader and all the
+ * workers is pooled here, in the parallel context's DSM segment, and
+ * VacuumCostBalanceLocal tracks what this process has added to it.
+ */
+pg_atomic_uint32 *VacuumSharedCostBalance = NULL;
+int			VacuumCostBalanceLocal = 0;
+
 
 /* A few variables that don't seem worth passing around as parameters */
 static MemoryContext vac_context = NULL;
@@ -73,6 +83,7 @@ static void vac_truncate_clog(TransactionId frozenXID,
 				  MultiXactId lastSaneMinMulti);
 static bool vacuum_rel(Oid relid, RangeVar *relation, int options,
 		   VacuumParams *params);
+static int	compute_parallel_delay(void);
 
 /*
  * Primary entry point for manual VACUUM and ANALYZE commands
@@ -280,6 +291,8 @@ vacuum(int options, RangeVar *relation, Oid relid, VacuumParams *params,
 		in_vacuum = true;
 		VacuumCostActive = (VacuumCostDelay > 0);
 		VacuumCostBalance = 0;
+		VacuumSharedCostBalance = NULL;
+		VacuumCostBalanceLocal = 0;
 		VacuumPageHit = 0;
 		VacuumPageMiss = 0;
 		VacuumPageDirty = 0;
@@ -325,6 +338,7 @@ vacuum(int options, RangeVar *relation, Oid relid, VacuumParams *params,
 	{
 		in_vacuum = false;
 		VacuumCostActive = false;
+		VacuumSharedCostBalance = NULL;
 		PG_RE_THROW();
 	}
 	PG_END_TRY();
@@ -1325,6 +1339,22 @@ vacuum_rel(Oid relid, RangeVar *relation, int options, VacuumParams *params)
 		return false;
 	}
 
+	/*
+	 * VACUUM FULL copies the table with the heap's own code (see cluster.c),
+	 * so tables using other access methods can only get a plain VACUUM.
+	 */
+	if ((options & VACOPT_FULL) && !RelationUsesHeapAm(onerel))
+	{
+		ereport(WARNING,
+				(errmsg("skipping \"%s\" --- access method \"%s\" does not support VACUUM FULL",
+						RelationGetRelationName(onerel),
+						get_am_name(onerel->rd_rel->relam))));
+		relation_close(onerel, lmode);
+		PopActiveSnapshot();
+		CommitTransactionCommand();
+		return false;
+	}
+
 	/*
 	 * Get a session-level lock too. This will protect our access to the
 	 * relation across multiple transactions, so that we can vacuum the
@@ -1373,7 +1403,8 @@ vacuum_rel(Oid relid, RangeVar *relation, int options, VacuumParams *params)
 					(options & VACOPT_VERBOSE) != 0);
 	}
 	else
-		lazy_vacuum_rel(onerel, options, params, vac_strategy);
+		onerel->rd_tableam->relation_vacuum(onerel, options, params,
+											vac_strategy);
 
 	/* Roll back any GUC changes executed by index functions */
 	AtEOXact_GUC(false, save_nestlevel);
@@ -1490,23 +1521,30 @@ vac_close_indexes(int nindexes, Relation *Irel, LOCKMODE lockmode)
 void
 vacuum_delay_point(void)
 {
+	int			msec = 0;
+
 	/* Always check for interrupts */
 	CHECK_FOR_INTERRUPTS();
 
+	if (!VacuumCostActive || InterruptPending)
+		return;
+
 	/* Nap if appropriate */
-	if (VacuumCostActive && !InterruptPending &&
-		VacuumCostBalance >= VacuumCostLimit)
+	if (VacuumSharedCostBalance != NULL)
+		msec = compute_parallel_delay();
+	else if (VacuumCostBalance >= VacuumCostLimit)
 	{
-		int			msec;
-
 		msec = VacuumCostDelay * VacuumCostBalance / VacuumCostLimit;
+		VacuumCostBalance = 0;
+	}
+
+	if (msec > 0)
+	{
 		if (msec > VacuumCostDelay * 4)
 			msec = VacuumCostDelay * 4;
 
 		pg_usleep(msec * 1000L);
 
-		VacuumCostBalance = 0;
-
 		/* update balance values for workers */
 		AutoVacuumUpdateDelay();
 
@@ -1514,3 +1552,33 @@ vacuum_delay_point(void)
 		CHECK_FOR_INTERRUPTS();
 	}
 }
+
+/*
+ * compute_parallel_delay --- nap time of a process of a parallel vacuum
+ *
+ * The processes add their costs to the shared balance, so that together they
+ * don't do more I/O than a single process would.  Once the balance reaches
+ * the limit, whichever process notices naps for its own share of it, and
+ * takes that share off the balance.
+ */
+static int
+compute_parallel_delay(void)
+{
+	uint32		shared_balance;
+	int			msec = 0;
+
+	shared_balance = pg_atomic_add_fetch_u32(VacuumSharedCostBalance,
+											 VacuumCostBalance);
+	VacuumCostBalanceLocal += VacuumCostBalance;
+	VacuumCostBalance = 0;
+
+	if (shared_balance >= VacuumCostLimit && VacuumCostBalanceLocal > 0)
+	{
+		msec = VacuumCostDelay * VacuumCostBalanceLocal / VacuumCostLimit;
+		pg_atomic_sub_fetch_u32(VacuumSharedCostBalance,
+								VacuumCostBalanceLocal);
+		VacuumCostBalanceLocal = 0;
+	}
+
+	return msec;
+}
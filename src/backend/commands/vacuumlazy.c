@@ -4,24 +4,41 @@
  *	  Concurrent ("lazy") vacuuming.
  *
  *
- * The major space usage for LAZY VACUUM is storage for the array of dead
- * tuple TIDs, with the next biggest need being storage for per-disk-page
- * free space info.  We want to ensure we can vacuum even the very largest
- * relations with finite memory space usage.  To do that, we set upper bounds
- * on the number of tuples and pages we will keep track of at once.
+ * The major space usage for LAZY VACUUM is storage for the dead tuple TIDs,
+ * with the next biggest need being storage for per-disk-page free space info.
+ * We want to ensure we can vacuum even the very largest relations with finite
+ * memory space usage.  To do that, we set upper bounds on the number of
+ * tuples and pages we will keep track of at once.
  *
  * We are willing to use at most maintenance_work_mem (or perhaps
  * autovacuum_work_mem) memory space to keep track of dead tuples.  We
- * initially allocate an array of TIDs of that size, with an upper limit that
- * depends on table size (this limit ensures we don't allocate a huge area
- * uselessly for vacuuming small tables).  If the array threatens to overflow,
- * we suspend the heap scan phase and perform a pass of index cleanup and page
- * compaction, then resume the heap scan with an empty TID array.
+ * initially allocate a dead tuple store of that size, with an upper limit
+ * that depends on table size (this limit ensures we don't allocate a huge
+ * area uselessly for vacuuming small tables).  If the store threatens to
+ * overflow, we suspend the heap scan phase and perform a pass of index
+ * cleanup and page compaction, then resume the heap scan with an empty store.
+ *
+ * The dead tuple store keeps the TIDs of each heap page together, encoded as
+ * a bitmap of offset numbers when the page has many dead tuples, and as a
+ * short list of offsets otherwise.  The pages are found through a directory
+ * indexed by the high bits of the block number, so that checking whether an
+ * index entry points to a dead tuple takes only a few steps however many
+ * tuples there are.  See the comments at LVDeadTuples.
  *
  * If we're processing a table with no indexes, we can just vacuum each page
  * as we go; there's no need to save up multiple tuples to minimize the number
- * of index scans performed.  So we don't use maintenance_work_mem memory for
- * the TID array, just enough to hold as many heap tuples as fit on one page.
+ * of index scans performed.  So we don't allocate a dead tuple store at all.
+ *
+ * Each pass over the indexes can be performed by parallel workers, when a
+ * manual VACUUM processes a table with several large indexes.  The indexes
+ * are handed out one at a time to the workers and the leader, largest first,
+ * and every index is processed entirely by a single process; indexes whose
+ * access method doesn't support that are processed by the leader.  The
+ * processes share a single cost-based delay balance.  To let the
+ * workers see the dead tuple TIDs, the dead tuple store is then allocated in
+ * a dynamic shared memory segment of its own, which lives for the duration
+ * of the vacuum of the table.  The heap itself is still scanned and vacuumed by
+ * the leader alone.
  *
  *
  * Portions Copyright (c) 1996-2016, PostgreSQL Global Development Group
@@ -37,15 +54,19 @@
 
 #include <math.h>
 
+#include "access/amapi.h"
 #include "access/genam.h"
 #include "access/heapam.h"
 #include "access/heapam_xlog.h"
 #include "access/htup_details.h"
 #include "access/multixact.h"
+#include "access/parallel.h"
 #include "access/transam.h"
 #include "access/visibilitymap.h"
+#include "access/xact.h"
 #include "access/xlog.h"
 #include "catalog/catalog.h"
+#include "catalog/pg_index.h"
 #include "catalog/storage.h"
 #include "commands/dbcommands.h"
 #include "commands/progress.h"
@@ -55,8 +76,10 @@
 #include "portability/instr_time.h"
 #include "postmaster/autovacuum.h"
 #include "storage/bufmgr.h"
+#include "storage/dsm.h"
 #include "storage/freespace.h"
 #include "storage/lmgr.h"
+#include "storage/proc.h"
 #include "utils/lsyscache.h"
 #include "utils/memutils.h"
 #include "utils/pg_rusage.h"
@@ -98,6 +121,66 @@
  */
 #define SKIP_PAGES_THRESHOLD	((BlockNumber) 32)
 
+/* Key for the shared state in the parallel index vacuum's DSM table of contents */
+#define PARALLEL_VACUUM_KEY_SHARED		UINT64CONST(0xD000000000000001)
+
+/*
+ * The dead tuple store.
+ *
+ * All of it is in a single memory area, which can be larger than
+ * MaxAllocSize and can be put in dynamic shared memory, so it contains no
+ * pointers.  After the fixed header comes a directory with one entry per
+ * chunk of LV_DEAD_CHUNK_BLOCKS heap blocks, then the array of per-page
+ * entries, which grows upwards, and finally the payloads of the entries,
+ * which are allocated downwards from the end of the area.  Pages must be
+ * added in block number order, so the entries are sorted and chunkdir[c] is
+ * the index of the first entry of chunk c; chunks beyond lastchunk have no
+ * entries.
+ *
+ * A page's dead offsets are stored in whichever form takes the least space:
+ * a single offset inline in the entry, a list of offsets, or a bitmap with
+ * bit (offset - 1) set for each dead offset.  The payload of a page never
+ * exceeds LV_DEAD_MAX_PAYLOAD bytes, so a page with n dead tuples takes at
+ * most 8 * n bytes including its entry.
+ */
+#define LV_DEAD_CHUNK_BITS		8
+#define LV_DEAD_CHUNK_BLOCKS	(1 << LV_DEAD_CHUNK_BITS)
+#define LV_DEAD_MAX_PAYLOAD		SHORTALIGN((MaxHeapTuplesPerPage + 7) / 8)
+
+/*
+ * Offsets within the store are kept in 32 bits to keep the entries small, so
+ * the store can't be any larger than this, whatever maintenance_work_mem
+ * says.  That's still room for over 500 million dead tuples.
+ */
+#define LV_DEAD_MAX_SIZE		((Size) PG_UINT32_MAX - MAXIMUM_ALIGNOF + 1)
+
+#define LV_DEAD_SINGLE			0
+#define LV_DEAD_LIST			1
+#define LV_DEAD_BITMAP			2
+
+typedef struct LVDeadBlock
+{
+	uint8		blklow;			/* block number % LV_DEAD_CHUNK_BLOCKS */
+	uint8		format;			/* LV_DEAD_SINGLE, _LIST or _BITMAP */
+	uint16		len;			/* the offset, # of offsets or bitmap bytes */
+	uint32		start;			/* offset of the payload in the store */
+} LVDeadBlock;
+
+typedef struct LVDeadTuples
+{
+	Size		size;			/* total size of the store */
+	uint32		blocks_offset;	/* offset of the blocks array */
+	uint32		payload_start;	/* offset of the lowest payload byte */
+	uint32		nchunks;		/* # of entries in chunkdir */
+	int			lastchunk;		/* last chunk with any entries, or -1 */
+	int			nblocks;		/* # of entries in the blocks array */
+	int64		ntuples;		/* # of TIDs stored */
+	uint32		chunkdir[FLEXIBLE_ARRAY_MEMBER];
+} LVDeadTuples;
+
+#define LVDeadTuplesBlocks(dt) \
+	((LVDeadBlock *) ((char *) (dt) + (dt)->blocks_offset))
+
 typedef struct LVRelStats
 {
 	/* hasindex = true means two-pass strategy; false means one-pass */
@@ -115,16 +198,72 @@ typedef struct LVRelStats
 	BlockNumber pages_removed;
 	double		tuples_deleted;
 	BlockNumber nonempty_pages; /* actually, last nonempty page + 1 */
-	/* List of TIDs of tuples we intend to delete */
-	/* NB: this list is ordered by TID address */
-	int			num_dead_tuples;	/* current # of entries */
-	int			max_dead_tuples;	/* # slots allocated in array */
-	ItemPointer dead_tuples;	/* array of ItemPointerData */
+	/* TIDs of tuples we intend to delete, NULL if no indexes */
+	LVDeadTuples *dead_tuples;
+	int64		num_dead_tuples;	/* current # of TIDs */
+	int64		max_dead_tuples;	/* # of TIDs guaranteed to fit */
 	int			num_index_scans;
 	TransactionId latestRemovedXid;
 	bool		lock_waiter_detected;
+	/* Index vacuuming skipped because there were few dead tuples */
+	bool		index_vacuum_skipped;
+	int64		skipped_dead_tuples;	/* # of dead item identifiers left */
+	BlockNumber skipped_pages;	/* # of pages they're on */
+	/* Parallel index vacuuming */
+	int			nworkers;		/* # of workers to request, 0 if serial */
+	dsm_segment *dead_tuples_seg;		/* DSM holding dead_tuples, or NULL */
 } LVRelStats;
 
+/*
+ * State of one index during a parallel index vacuum pass.  The stats are
+ * valid if "updated" is set.  Only indexes whose access method sets
+ * amcanparallelvacuum are listed, as that promises that the stats are a plain
+ * IndexBulkDeleteResult, which can be copied back and forth between
+ * backend-local and shared memory.
+ */
+typedef struct LVSharedIndex
+{
+	Oid			indexoid;
+	int			irelidx;		/* position in the leader's Irel array */
+	BlockNumber nblocks;		/* size at the start of the pass */
+	bool		updated;
+	IndexBulkDeleteResult stats;
+} LVSharedIndex;
+
+/*
+ * Shared state of a parallel index vacuum pass, in the parallel context's DSM
+ * segment.  Indexes are sorted by size, largest first, and each process takes
+ * the next one to process by incrementing nextidx.
+ */
+typedef struct LVShared
+{
+	Oid			relid;
+	int			elevel;
+	bool		for_cleanup;	/* amvacuumcleanup, rather than ambulkdelete? */
+
+	/* fields of LVRelStats needed to build the IndexVacuumInfo */
+	BlockNumber rel_pages;
+	BlockNumber scanned_pages;
+	double		old_rel_tuples;
+	double		new_rel_tuples;
+
+	/* the dead tuple TIDs */
+	dsm_handle	dead_tuples_handle;
+	int64		num_dead_tuples;
+
+	/* cost-based delay balance of all the processes, see vacuum_delay_point */
+	pg_atomic_uint32 cost_balance;
+
+	pg_atomic_uint32 nextidx;
+	int			nindexes;
+	LVSharedIndex indexes[FLEXIBLE_ARRAY_MEMBER];
+} LVShared;
+
+/* GUC parameters */
+int			max_parallel_vacuum_workers = 2;
+int			min_parallel_vacuum_index_size = (8 * 1024 * 1024) / BLCKSZ;
+double		vacuum_skip_index_fraction = 0;
+
 
 /* A few variables that don't seem worth passing around as parameters */
 static int	elevel = -1;
@@ -144,20 +283,48 @@ static bool lazy_check_needs_freeze(Buffer buf, bool *hastup);
 static void lazy_vacuum_index(Relation indrel,
 				  IndexBulkDeleteResult **stats,
 				  LVRelStats *vacrelstats);
-static void lazy_cleanup_index(Relation indrel,
+static IndexBulkDeleteResult *lazy_cleanup_index(Relation indrel,
 				   IndexBulkDeleteResult *stats,
 				   LVRelStats *vacrelstats);
-static int lazy_vacuum_page(Relation onerel, BlockNumber blkno, Buffer buffer,
-				 int tupindex, LVRelStats *vacrelstats, Buffer *vmbuffer);
+static void lazy_update_index_stats(Relation indrel,
+						IndexBulkDeleteResult *stats);
+static void lazy_vacuum_all_indexes(Relation *Irel,
+						IndexBulkDeleteResult **indstats, int nindexes,
+						LVRelStats *vacrelstats);
+static void lazy_update_skipped_index_stats(Relation *Irel, int nindexes,
+								LVRelStats *vacrelstats);
+static void lazy_cleanup_all_indexes(Relation *Irel,
+						 IndexBulkDeleteResult **indstats, int nindexes,
+						 LVRelStats *vacrelstats);
+static int	compute_parallel_vacuum_workers(Relation *Irel, int nindexes);
+static void lazy_parallel_vacuum_indexes(Relation *Irel,
+							 IndexBulkDeleteResult **indstats, int nindexes,
+							 LVRelStats *vacrelstats, bool for_cleanup);
+static void lazy_parallel_process_index(LVShared *shared, LVSharedIndex *ent,
+							Relation indrel, LVRelStats *vacrelstats);
+static void lazy_process_index(Relation indrel,
+				   IndexBulkDeleteResult **stats,
+				   LVRelStats *vacrelstats, bool for_cleanup);
+static int	lvshared_index_cmp(const void *a, const void *b);
+static void lazy_parallel_vacuum_main(dsm_segment *seg, shm_toc *toc);
+static void lazy_vacuum_page(Relation onerel, BlockNumber blkno, Buffer buffer,
+				 OffsetNumber *deadoffsets, int ndeadoffsets,
+				 LVRelStats *vacrelstats, Buffer *vmbuffer);
+static bool lazy_skip_index_vacuum(LVRelStats *vacrelstats, double num_tuples,
+					   double nunpruned);
 static bool should_attempt_truncation(LVRelStats *vacrelstats);
 static void lazy_truncate_heap(Relation onerel, LVRelStats *vacrelstats);
 static BlockNumber count_nondeletable_pages(Relation onerel,
 						 LVRelStats *vacrelstats);
 static void lazy_space_alloc(LVRelStats *vacrelstats, BlockNumber relblocks);
-static void lazy_record_dead_tuple(LVRelStats *vacrelstats,
-					   ItemPointer itemptr);
+static void lazy_record_dead_tuples(LVRelStats *vacrelstats,
+						BlockNumber blkno,
+						OffsetNumber *deadoffsets, int ndeadoffsets);
+static bool lazy_space_is_full(LVRelStats *vacrelstats);
 static bool lazy_tid_reaped(ItemPointer itemptr, void *state);
-static int	vac_cmp_itemptr(const void *left, const void *right);
+static void dead_tuples_reset(LVDeadTuples *dt);
+static int dead_tuples_get_page(LVDeadTuples *dt, int i, BlockNumber *blkno,
+					 OffsetNumber *offsets);
 static bool heap_page_is_all_visible(Relation rel, Buffer buf,
 					 TransactionId *visibility_cutoff_xid, bool *all_frozen);
 
@@ -245,12 +412,25 @@ lazy_vacuum_rel(Relation onerel, int options, VacuumParams *params,
 	vac_open_indexes(onerel, RowExclusiveLock, &nindexes, &Irel);
 	vacrelstats->hasindex = (nindexes > 0);
 
+	/* Decide whether to use parallel workers for the indexes */
+	vacrelstats->nworkers = compute_parallel_vacuum_workers(Irel, nindexes);
+
 	/* Do the vacuuming */
 	lazy_scan_heap(onerel, vacrelstats, Irel, nindexes, aggressive);
 
 	/* Done with indexes */
 	vac_close_indexes(nindexes, Irel, NoLock);
 
+	/* ... and with the dead tuple store, which can be large */
+	if (vacrelstats->dead_tuples_seg != NULL)
+	{
+		dsm_detach(vacrelstats->dead_tuples_seg);
+		vacrelstats->dead_tuples_seg = NULL;
+	}
+	else if (vacrelstats->dead_tuples != NULL)
+		pfree(vacrelstats->dead_tuples);
+	vacrelstats->dead_tuples = NULL;
+
 	/*
 	 * Compute whether we actually scanned the whole relation. If we did, we
 	 * can adjust relfrozenxid and relminmxid.
@@ -326,6 +506,12 @@ lazy_vacuum_rel(Relation onerel, int options, VacuumParams *params,
 	if (new_live_tuples < 0)
 		new_live_tuples = 0;	/* just in case */
 
+	/*
+	 * Dead item identifiers left behind by skipping index vacuuming don't
+	 * count as dead tuples.  Otherwise, with vacuum_skip_index_fraction above
+	 * the autovacuum scale factor, autovacuum would come back for them every
+	 * time and skip them again.  The next vacuum takes care of them.
+	 */
 	pgstat_report_vacuum(RelationGetRelid(onerel),
 						 onerel->rd_rel->relisshared,
 						 new_live_tuples,
@@ -365,6 +551,10 @@ lazy_vacuum_rel(Relation onerel, int options, VacuumParams *params,
 							 get_namespace_name(RelationGetNamespace(onerel)),
 							 RelationGetRelationName(onerel),
 							 vacrelstats->num_index_scans);
+			if (vacrelstats->index_vacuum_skipped)
+				appendStringInfo(&buf, _("index vacuuming skipped: %.0f dead item identifiers left in %u pages\n"),
+								 (double) vacrelstats->skipped_dead_tuples,
+								 vacrelstats->skipped_pages);
 			appendStringInfo(&buf, _("pages: %u removed, %u remain, %u skipped due to pins, %u skipped frozen\n"),
 							 vacrelstats->pages_removed,
 							 vacrelstats->rel_pages,
@@ -453,7 +643,8 @@ lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 	double		num_tuples,
 				tups_vacuumed,
 				nkeep,
-				nunused;
+				nunused,
+				nunpruned;
 	IndexBulkDeleteResult **indstats;
 	int			i;
 	PGRUsage	ru0;
@@ -478,7 +669,7 @@ lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 					relname)));
 
 	empty_pages = vacuumed_pages = 0;
-	num_tuples = tups_vacuumed = nkeep = nunused = 0;
+	num_tuples = tups_vacuumed = nkeep = nunused = nunpruned = 0;
 
 	indstats = (IndexBulkDeleteResult **)
 		palloc0(nindexes * sizeof(IndexBulkDeleteResult *));
@@ -576,7 +767,8 @@ lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 					maxoff;
 		bool		tupgone,
 					hastup;
-		int			prev_dead_count;
+		OffsetNumber deadoffsets[MaxHeapTuplesPerPage];
+		int			ndeadoffsets;
 		int			nfrozen;
 		Size		freespace;
 		bool		all_visible_according_to_vm = false;
@@ -668,8 +860,7 @@ lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 		 * If we are close to overrunning the available space for dead-tuple
 		 * TIDs, pause and do a cycle of vacuuming before we tackle this page.
 		 */
-		if ((vacrelstats->max_dead_tuples - vacrelstats->num_dead_tuples) < MaxHeapTuplesPerPage &&
-			vacrelstats->num_dead_tuples > 0)
+		if (vacrelstats->num_dead_tuples > 0 && lazy_space_is_full(vacrelstats))
 		{
 			const int	hvp_index[] = {
 				PROGRESS_VACUUM_PHASE,
@@ -697,10 +888,7 @@ lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 										 PROGRESS_VACUUM_PHASE_VACUUM_INDEX);
 
 			/* Remove index entries */
-			for (i = 0; i < nindexes; i++)
-				lazy_vacuum_index(Irel[i],
-								  &indstats[i],
-								  vacrelstats);
+			lazy_vacuum_all_indexes(Irel, indstats, nindexes, vacrelstats);
 
 			/*
 			 * Report that we are now vacuuming the heap.  We also increase
@@ -720,6 +908,7 @@ lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 			 * not to reset latestRemovedXid since we want that value to be
 			 * valid.
 			 */
+			dead_tuples_reset(vacrelstats->dead_tuples);
 			vacrelstats->num_dead_tuples = 0;
 			vacrelstats->num_index_scans++;
 
@@ -892,7 +1081,7 @@ lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 		 * We count tuples removed by the pruning step as removed by VACUUM.
 		 */
 		tups_vacuumed += heap_page_prune(onerel, buf, OldestXmin, false,
-										 &vacrelstats->latestRemovedXid);
+										 false, &vacrelstats->latestRemovedXid);
 
 		/*
 		 * Now scan the page to collect vacuumable items and check for tuples
@@ -902,7 +1091,7 @@ lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 		has_dead_tuples = false;
 		nfrozen = 0;
 		hastup = false;
-		prev_dead_count = vacrelstats->num_dead_tuples;
+		ndeadoffsets = 0;
 		maxoff = PageGetMaxOffsetNumber(page);
 
 		/*
@@ -941,7 +1130,7 @@ lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 			 */
 			if (ItemIdIsDead(itemid))
 			{
-				lazy_record_dead_tuple(vacrelstats, &(tuple.t_self));
+				deadoffsets[ndeadoffsets++] = offnum;
 				all_visible = false;
 				continue;
 			}
@@ -1046,10 +1235,11 @@ lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 
 			if (tupgone)
 			{
-				lazy_record_dead_tuple(vacrelstats, &(tuple.t_self));
+				deadoffsets[ndeadoffsets++] = offnum;
 				HeapTupleHeaderAdvanceLatestRemovedXid(tuple.t_data,
 											 &vacrelstats->latestRemovedXid);
 				tups_vacuumed += 1;
+				nunpruned += 1;
 				has_dead_tuples = true;
 			}
 			else
@@ -1109,21 +1299,17 @@ lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 		 * If there are no indexes then we can vacuum the page right now
 		 * instead of doing a second scan.
 		 */
-		if (nindexes == 0 &&
-			vacrelstats->num_dead_tuples > 0)
+		if (nindexes == 0 && ndeadoffsets > 0)
 		{
 			/* Remove tuples from heap */
-			lazy_vacuum_page(onerel, blkno, buf, 0, vacrelstats, &vmbuffer);
+			lazy_vacuum_page(onerel, blkno, buf, deadoffsets, ndeadoffsets,
+							 vacrelstats, &vmbuffer);
 			has_dead_tuples = false;
-
-			/*
-			 * Forget the now-vacuumed tuples, and press on, but be careful
-			 * not to reset latestRemovedXid since we want that value to be
-			 * valid.
-			 */
-			vacrelstats->num_dead_tuples = 0;
 			vacuumed_pages++;
 		}
+		else if (ndeadoffsets > 0)
+			lazy_record_dead_tuples(vacrelstats, blkno,
+									deadoffsets, ndeadoffsets);
 
 		freespace = PageGetHeapFreeSpace(page);
 
@@ -1222,7 +1408,7 @@ lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 		 * page, so remember its free space as-is.  (This path will always be
 		 * taken if there are no indexes.)
 		 */
-		if (vacrelstats->num_dead_tuples == prev_dead_count)
+		if (nindexes == 0 || ndeadoffsets == 0)
 			RecordPageWithFreeSpace(onerel, blkno, freespace);
 	}
 
@@ -1251,9 +1437,25 @@ lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 		vmbuffer = InvalidBuffer;
 	}
 
+	/*
+	 * If only a few dead tuples remain, we may leave them for a later vacuum
+	 * rather than scan all the indexes for them now.
+	 */
+	if (vacrelstats->num_dead_tuples > 0 &&
+		lazy_skip_index_vacuum(vacrelstats, num_tuples, nunpruned))
+	{
+		vacrelstats->index_vacuum_skipped = true;
+		vacrelstats->skipped_dead_tuples = vacrelstats->num_dead_tuples;
+		vacrelstats->skipped_pages = vacrelstats->dead_tuples->nblocks;
+
+		ereport(elevel,
+				(errmsg("\"%s\": skipped index vacuuming, leaving %.0f dead item identifiers in %u pages",
+						RelationGetRelationName(onerel),
+						(double) vacrelstats->skipped_dead_tuples,
+						vacrelstats->skipped_pages)));
+	}
 	/* If any tuples need to be deleted, perform final vacuum cycle */
-	/* XXX put a threshold on min number of tuples here? */
-	if (vacrelstats->num_dead_tuples > 0)
+	else if (vacrelstats->num_dead_tuples > 0)
 	{
 		const int	hvp_index[] = {
 			PROGRESS_VACUUM_PHASE,
@@ -1269,10 +1471,7 @@ lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 									 PROGRESS_VACUUM_PHASE_VACUUM_INDEX);
 
 		/* Remove index entries */
-		for (i = 0; i < nindexes; i++)
-			lazy_vacuum_index(Irel[i],
-							  &indstats[i],
-							  vacrelstats);
+		lazy_vacuum_all_indexes(Irel, indstats, nindexes, vacrelstats);
 
 		/* Report that we are now vacuuming the heap */
 		hvp_val[0] = PROGRESS_VACUUM_PHASE_VACUUM_HEAP;
@@ -1291,9 +1490,16 @@ lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 	pgstat_progress_update_param(PROGRESS_VACUUM_PHASE,
 								 PROGRESS_VACUUM_PHASE_INDEX_CLEANUP);
 
-	/* Do post-vacuum cleanup and statistics update for each index */
-	for (i = 0; i < nindexes; i++)
-		lazy_cleanup_index(Irel[i], indstats[i], vacrelstats);
+	/*
+	 * Do post-vacuum cleanup and statistics update for each index.  If we
+	 * skipped index vacuuming, skip this as well, because without a preceding
+	 * bulk-delete pass some index AMs, btree among them, scan the whole index
+	 * in amvacuumcleanup.  Just update the indexes' statistics then.
+	 */
+	if (vacrelstats->index_vacuum_skipped)
+		lazy_update_skipped_index_stats(Irel, nindexes, vacrelstats);
+	else
+		lazy_cleanup_all_indexes(Irel, indstats, nindexes, vacrelstats);
 
 	/* If no indexes, make log report that lazy_vacuum_heap would've made */
 	if (vacuumed_pages)
@@ -1347,35 +1553,39 @@ lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 static void
 lazy_vacuum_heap(Relation onerel, LVRelStats *vacrelstats)
 {
-	int			tupindex;
+	LVDeadTuples *dt = vacrelstats->dead_tuples;
+	double		ntuples;
 	int			npages;
+	int			i;
 	PGRUsage	ru0;
 	Buffer		vmbuffer = InvalidBuffer;
 
 	pg_rusage_init(&ru0);
+	ntuples = 0;
 	npages = 0;
 
-	tupindex = 0;
-	while (tupindex < vacrelstats->num_dead_tuples)
+	for (i = 0; i < dt->nblocks; i++)
 	{
 		BlockNumber tblk;
+		OffsetNumber deadoffsets[MaxHeapTuplesPerPage];
+		int			ndeadoffsets;
 		Buffer		buf;
 		Page		page;
 		Size		freespace;
 
 		vacuum_delay_point();
 
-		tblk = ItemPointerGetBlockNumber(&vacrelstats->dead_tuples[tupindex]);
+		ndeadoffsets = dead_tuples_get_page(dt, i, &tblk, deadoffsets);
 		buf = ReadBufferExtended(onerel, MAIN_FORKNUM, tblk, RBM_NORMAL,
 								 vac_strategy);
 		if (!ConditionalLockBufferForCleanup(buf))
 		{
 			ReleaseBuffer(buf);
-			++tupindex;
 			continue;
 		}
-		tupindex = lazy_vacuum_page(onerel, tblk, buf, tupindex, vacrelstats,
-									&vmbuffer);
+		lazy_vacuum_page(onerel, tblk, buf, deadoffsets, ndeadoffsets,
+						 vacrelstats, &vmbuffer);
+		ntuples += ndeadoffsets;
 
 		/* Now that we've compacted the page, record its available space */
 		page = BufferGetPage(buf);
@@ -1393,9 +1603,9 @@ lazy_vacuum_heap(Relation onerel, LVRelStats *vacrelstats)
 	}
 
 	ereport(elevel,
-			(errmsg("\"%s\": removed %d row versions in %d pages",
+			(errmsg("\"%s\": removed %.0f row versions in %d pages",
 					RelationGetRelationName(onerel),
-					tupindex, npages),
+					ntuples, npages),
 			 errdetail("%s.",
 					   pg_rusage_show(&ru0))));
 }
@@ -1406,37 +1616,29 @@ lazy_vacuum_heap(Relation onerel, LVRelStats *vacrelstats)
  *
  * Caller must hold pin and buffer cleanup lock on the buffer.
  *
- * tupindex is the index in vacrelstats->dead_tuples of the first dead
- * tuple for this page.  We assume the rest follow sequentially.
- * The return value is the first tupindex after the tuples of this page.
+ * deadoffsets[] holds the offsets of the ndeadoffsets dead tuples of the
+ * page, in increasing order.
  */
-static int
+static void
 lazy_vacuum_page(Relation onerel, BlockNumber blkno, Buffer buffer,
-				 int tupindex, LVRelStats *vacrelstats, Buffer *vmbuffer)
+				 OffsetNumber *deadoffsets, int ndeadoffsets,
+				 LVRelStats *vacrelstats, Buffer *vmbuffer)
 {
 	Page		page = BufferGetPage(buffer);
-	OffsetNumber unused[MaxOffsetNumber];
-	int			uncnt = 0;
 	TransactionId visibility_cutoff_xid;
 	bool		all_frozen;
+	int			i;
 
 	pgstat_progress_update_param(PROGRESS_VACUUM_HEAP_BLKS_VACUUMED, blkno);
 
 	START_CRIT_SECTION();
 
-	for (; tupindex < vacrelstats->num_dead_tuples; tupindex++)
+	for (i = 0; i < ndeadoffsets; i++)
 	{
-		BlockNumber tblk;
-		OffsetNumber toff;
 		ItemId		itemid;
 
-		tblk = ItemPointerGetBlockNumber(&vacrelstats->dead_tuples[tupindex]);
-		if (tblk != blkno)
-			break;				/* past end of tuples for this block */
-		toff = ItemPointerGetOffsetNumber(&vacrelstats->dead_tuples[tupindex]);
-		itemid = PageGetItemId(page, toff);
+		itemid = PageGetItemId(page, deadoffsets[i]);
 		ItemIdSetUnused(itemid);
-		unused[uncnt++] = toff;
 	}
 
 	PageRepairFragmentation(page);
@@ -1453,7 +1655,7 @@ lazy_vacuum_page(Relation onerel, BlockNumber blkno, Buffer buffer,
 
 		recptr = log_heap_clean(onerel, buffer,
 								NULL, 0, NULL, 0,
-								unused, uncnt,
+								deadoffsets, ndeadoffsets,
 								vacrelstats->latestRemovedXid);
 		PageSetLSN(page, recptr);
 	}
@@ -1497,8 +1699,6 @@ lazy_vacuum_page(Relation onerel, BlockNumber blkno, Buffer buffer,
 			visibilitymap_set(onerel, blkno, buffer, InvalidXLogRecPtr,
 							  *vmbuffer, visibility_cutoff_xid, flags);
 	}
-
-	return tupindex;
 }
 
 /*
@@ -1582,16 +1782,20 @@ lazy_vacuum_index(Relation indrel,
 							   lazy_tid_reaped, (void *) vacrelstats);
 
 	ereport(elevel,
-			(errmsg("scanned index \"%s\" to remove %d row versions",
+			(errmsg("scanned index \"%s\" to remove %.0f row versions",
 					RelationGetRelationName(indrel),
-					vacrelstats->num_dead_tuples),
+					(double) vacrelstats->num_dead_tuples),
 			 errdetail("%s.", pg_rusage_show(&ru0))));
 }
 
 /*
  *	lazy_cleanup_index() -- do post-vacuum cleanup for one index relation.
+ *
+ *		Returns the final statistics of the index, or NULL if the index AM
+ *		didn't provide any.  The caller is responsible for updating pg_class
+ *		with them, see lazy_update_index_stats().
  */
-static void
+static IndexBulkDeleteResult *
 lazy_cleanup_index(Relation indrel,
 				   IndexBulkDeleteResult *stats,
 				   LVRelStats *vacrelstats)
@@ -1611,11 +1815,36 @@ lazy_cleanup_index(Relation indrel,
 	stats = index_vacuum_cleanup(&ivinfo, stats);
 
 	if (!stats)
-		return;
+		return NULL;
+
+	ereport(elevel,
+			(errmsg("index \"%s\" now contains %.0f row versions in %u pages",
+					RelationGetRelationName(indrel),
+					stats->num_index_tuples,
+					stats->num_pages),
+			 errdetail("%.0f index row versions were removed.\n"
+			 "%u index pages have been deleted, %u are currently reusable.\n"
+					   "%s.",
+					   stats->tuples_removed,
+					   stats->pages_deleted, stats->pages_free,
+					   pg_rusage_show(&ru0))));
 
+	return stats;
+}
+
+/*
+ *	lazy_update_index_stats() -- update pg_class entry of an index after
+ *		post-vacuum cleanup, and free the statistics.
+ *
+ *		This is kept separate from lazy_cleanup_index() because it can't be
+ *		done in parallel mode.
+ */
+static void
+lazy_update_index_stats(Relation indrel, IndexBulkDeleteResult *stats)
+{
 	/*
-	 * Now update statistics in pg_class, but only if the index says the count
-	 * is accurate.
+	 * Update statistics in pg_class, but only if the index says the count is
+	 * accurate.
 	 */
 	if (!stats->estimated_count)
 		vac_update_relstats(indrel,
@@ -1627,19 +1856,435 @@ lazy_cleanup_index(Relation indrel,
 							InvalidMultiXactId,
 							false);
 
+	pfree(stats);
+}
+
+/*
+ *	lazy_vacuum_all_indexes() -- delete the dead tuples from all indexes,
+ *		using parallel workers if that was decided at the start.
+ */
+static void
+lazy_vacuum_all_indexes(Relation *Irel, IndexBulkDeleteResult **indstats,
+						int nindexes, LVRelStats *vacrelstats)
+{
+	int			i;
+
+	if (vacrelstats->nworkers > 0)
+	{
+		lazy_parallel_vacuum_indexes(Irel, indstats, nindexes, vacrelstats,
+									 false);
+		return;
+	}
+
+	for (i = 0; i < nindexes; i++)
+		lazy_vacuum_index(Irel[i],
+						  &indstats[i],
+						  vacrelstats);
+}
+
+/*
+ *	lazy_update_skipped_index_stats() -- update pg_class entries of all
+ *		indexes when index vacuuming was skipped.
+ *
+ *		Without amvacuumcleanup we have no index statistics, so estimate them
+ *		from the heap: every tuple left in it still has its index entry, and
+ *		so do the dead item identifiers we left behind.  For partial indexes
+ *		only the size is updated.
+ */
+static void
+lazy_update_skipped_index_stats(Relation *Irel, int nindexes,
+								LVRelStats *vacrelstats)
+{
+	bool		estimated;
+	int			i;
+
+	estimated = (vacrelstats->scanned_pages < vacrelstats->rel_pages);
+
+	for (i = 0; i < nindexes; i++)
+	{
+		Relation	indrel = Irel[i];
+		double		num_index_tuples;
+
+		if (estimated || !heap_attisnull(indrel->rd_indextuple,
+										 Anum_pg_index_indpred))
+			num_index_tuples = indrel->rd_rel->reltuples;
+		else
+			num_index_tuples = vacrelstats->new_rel_tuples +
+				vacrelstats->skipped_dead_tuples;
+
+		vac_update_relstats(indrel,
+							RelationGetNumberOfBlocks(indrel),
+							num_index_tuples,
+							0,
+							false,
+							InvalidTransactionId,
+							InvalidMultiXactId,
+							false);
+	}
+}
+
+/*
+ *	lazy_cleanup_all_indexes() -- do post-vacuum cleanup and statistics
+ *		update for all indexes.
+ */
+static void
+lazy_cleanup_all_indexes(Relation *Irel, IndexBulkDeleteResult **indstats,
+						 int nindexes, LVRelStats *vacrelstats)
+{
+	int			i;
+
+	if (vacrelstats->nworkers > 0)
+		lazy_parallel_vacuum_indexes(Irel, indstats, nindexes, vacrelstats,
+									 true);
+	else
+	{
+		for (i = 0; i < nindexes; i++)
+			indstats[i] = lazy_cleanup_index(Irel[i], indstats[i],
+											 vacrelstats);
+	}
+
+	for (i = 0; i < nindexes; i++)
+	{
+		if (indstats[i] != NULL)
+			lazy_update_index_stats(Irel[i], indstats[i]);
+		indstats[i] = NULL;
+	}
+}
+
+/*
+ * compute_parallel_vacuum_workers - how many workers to use for the indexes
+ *
+ * Parallel workers are only worth starting if at least two indexes that
+ * support parallel vacuum are at least min_parallel_vacuum_index_size large;
+ * the leader takes care of one of them itself.  Autovacuum doesn't use them,
+ * it has its own way of running several vacuums at a time.
+ */
+static int
+compute_parallel_vacuum_workers(Relation *Irel, int nindexes)
+{
+	int			nlarge = 0;
+	int			i;
+
+	if (IsAutoVacuumWorkerProcess() ||
+		max_parallel_vacuum_workers == 0 ||
+		dynamic_shared_memory_type == DSM_IMPL_NONE ||
+		nindexes < 2)
+		return 0;
+
+	for (i = 0; i < nindexes; i++)
+	{
+		if (Irel[i]->rd_amroutine->amcanparallelvacuum &&
+			RelationGetNumberOfBlocks(Irel[i]) >=
+			(BlockNumber) min_parallel_vacuum_index_size)
+			nlarge++;
+	}
+
+	if (nlarge < 2)
+		return 0;
+
+	return Min(max_parallel_vacuum_workers, nlarge - 1);
+}
+
+/*
+ *	lazy_parallel_vacuum_indexes() -- perform one pass of index vacuuming or
+ *		cleanup with the help of parallel workers.
+ *
+ *		The statistics of each index are passed to the worker processing it
+ *		through shared memory, and copied back into indstats afterwards.
+ *		Indexes that don't support parallel vacuum are processed by the
+ *		leader, before it joins in the work on the others.
+ */
+static void
+lazy_parallel_vacuum_indexes(Relation *Irel, IndexBulkDeleteResult **indstats,
+							 int nindexes, LVRelStats *vacrelstats,
+							 bool for_cleanup)
+{
+	ParallelContext *pcxt;
+	LVShared   *shared;
+	Size		size;
+	int			nshared = 0;
+	int			i;
+
+	for (i = 0; i < nindexes; i++)
+	{
+		if (Irel[i]->rd_amroutine->amcanparallelvacuum)
+			nshared++;
+	}
+
+	EnterParallelMode();
+
+	pcxt = CreateParallelContext(lazy_parallel_vacuum_main,
+								 vacrelstats->nworkers);
+
+	size = add_size(offsetof(LVShared, indexes),
+					mul_size(nshared, sizeof(LVSharedIndex)));
+	shm_toc_estimate_chunk(&pcxt->estimator, size);
+	shm_toc_estimate_keys(&pcxt->estimator, 1);
+
+	InitializeParallelDSM(pcxt);
+
+	shared = (LVShared *) shm_toc_allocate(pcxt->toc, size);
+	shared->relid = Irel[0]->rd_index->indrelid;
+	shared->elevel = elevel;
+	shared->for_cleanup = for_cleanup;
+	shared->rel_pages = vacrelstats->rel_pages;
+	shared->scanned_pages = vacrelstats->scanned_pages;
+	shared->old_rel_tuples = vacrelstats->old_rel_tuples;
+	shared->new_rel_tuples = vacrelstats->new_rel_tuples;
+	shared->dead_tuples_handle = dsm_segment_handle(vacrelstats->dead_tuples_seg);
+	shared->num_dead_tuples = vacrelstats->num_dead_tuples;
+	pg_atomic_init_u32(&shared->cost_balance, VacuumCostBalance);
+	pg_atomic_init_u32(&shared->nextidx, 0);
+	shared->nindexes = nshared;
+
+	nshared = 0;
+	for (i = 0; i < nindexes; i++)
+	{
+		LVSharedIndex *ent;
+
+		if (!Irel[i]->rd_amroutine->amcanparallelvacuum)
+			continue;
+		ent = &shared->indexes[nshared++];
+		ent->indexoid = RelationGetRelid(Irel[i]);
+		ent->irelidx = i;
+		ent->nblocks = RelationGetNumberOfBlocks(Irel[i]);
+		if (indstats[i] != NULL)
+		{
+			ent->updated = true;
+			memcpy(&ent->stats, indstats[i], sizeof(IndexBulkDeleteResult));
+		}
+		else
+			ent->updated = false;
+	}
+
+	/* Process the largest indexes first, to finish at about the same time */
+	qsort(shared->indexes, nshared, sizeof(LVSharedIndex),
+		  lvshared_index_cmp);
+
+	shm_toc_insert(pcxt->toc, PARALLEL_VACUUM_KEY_SHARED, shared);
+
+	/* Our cost balance so far becomes our share of the common one */
+	VacuumSharedCostBalance = &shared->cost_balance;
+	VacuumCostBalanceLocal = VacuumCostBalance;
+	VacuumCostBalance = 0;
+
+	LaunchParallelWorkers(pcxt);
+
 	ereport(elevel,
-			(errmsg("index \"%s\" now contains %.0f row versions in %u pages",
-					RelationGetRelationName(indrel),
-					stats->num_index_tuples,
-					stats->num_pages),
-			 errdetail("%.0f index row versions were removed.\n"
-			 "%u index pages have been deleted, %u are currently reusable.\n"
-					   "%s.",
-					   stats->tuples_removed,
-					   stats->pages_deleted, stats->pages_free,
-					   pg_rusage_show(&ru0))));
+			(errmsg(ngettext("launched %d parallel vacuum worker for %d indexes (planned: %d)",
+							 "launched %d parallel vacuum workers for %d indexes (planned: %d)",
+							 pcxt->nworkers_launched),
+					pcxt->nworkers_launched,
+					nindexes, vacrelstats->nworkers)));
 
-	pfree(stats);
+	/* Process the indexes only we can, join in the work on the others */
+	for (i = 0; i < nindexes; i++)
+	{
+		if (!Irel[i]->rd_amroutine->amcanparallelvacuum)
+			lazy_process_index(Irel[i], &indstats[i], vacrelstats,
+							   for_cleanup);
+	}
+	for (;;)
+	{
+		uint32		idx = pg_atomic_fetch_add_u32(&shared->nextidx, 1);
+		LVSharedIndex *ent;
+
+		if (idx >= (uint32) nshared)
+			break;
+		ent = &shared->indexes[idx];
+		lazy_parallel_process_index(shared, ent, Irel[ent->irelidx],
+									vacrelstats);
+	}
+
+	/* Then wait for the workers to finish theirs */
+	WaitForParallelWorkersToFinish(pcxt);
+
+	/* Carry over what's left of the common cost balance */
+	VacuumCostBalance = (int) pg_atomic_read_u32(&shared->cost_balance);
+	VacuumSharedCostBalance = NULL;
+	VacuumCostBalanceLocal = 0;
+
+	/* Copy the statistics back, before the DSM segment goes away */
+	for (i = 0; i < nshared; i++)
+	{
+		LVSharedIndex *ent = &shared->indexes[i];
+
+		if (!ent->updated)
+			continue;
+		if (indstats[ent->irelidx] == NULL)
+			indstats[ent->irelidx] = (IndexBulkDeleteResult *)
+				palloc(sizeof(IndexBulkDeleteResult));
+		memcpy(indstats[ent->irelidx], &ent->stats,
+			   sizeof(IndexBulkDeleteResult));
+	}
+
+	DestroyParallelContext(pcxt);
+	ExitParallelMode();
+}
+
+/*
+ *	lazy_parallel_process_index() -- vacuum or clean up one index as part
+ *		of a parallel pass, in the leader or in a worker.
+ */
+static void
+lazy_parallel_process_index(LVShared *shared, LVSharedIndex *ent,
+							Relation indrel, LVRelStats *vacrelstats)
+{
+	IndexBulkDeleteResult *stats;
+
+	stats = ent->updated ? &ent->stats : NULL;
+
+	lazy_process_index(indrel, &stats, vacrelstats, shared->for_cleanup);
+
+	if (stats == NULL)
+		return;
+
+	/* The AM allocates the result if none was passed in; move it over */
+	if (stats != &ent->stats)
+	{
+		memcpy(&ent->stats, stats, sizeof(IndexBulkDeleteResult));
+		pfree(stats);
+	}
+	ent->updated = true;
+}
+
+/*
+ *	lazy_process_index() -- vacuum or clean up one index.
+ */
+static void
+lazy_process_index(Relation indrel, IndexBulkDeleteResult **stats,
+				   LVRelStats *vacrelstats, bool for_cleanup)
+{
+	if (for_cleanup)
+		*stats = lazy_cleanup_index(indrel, *stats, vacrelstats);
+	else
+		lazy_vacuum_index(indrel, stats, vacrelstats);
+}
+
+/*
+ * qsort comparator for LVSharedIndex, sorting by size in descending order
+ */
+static int
+lvshared_index_cmp(const void *a, const void *b)
+{
+	const LVSharedIndex *ia = (const LVSharedIndex *) a;
+	const LVSharedIndex *ib = (const LVSharedIndex *) b;
+
+	if (ia->nblocks > ib->nblocks)
+		return -1;
+	if (ia->nblocks < ib->nblocks)
+		return 1;
+	return 0;
+}
+
+/*
+ * lazy_parallel_vacuum_main - main entry point of a parallel vacuum worker
+ *
+ * The worker processes indexes until there are none left.  It locks the heap
+ * and the indexes the same way as the leader did; thanks to group locking
+ * that doesn't conflict with the leader's locks.
+ */
+static void
+lazy_parallel_vacuum_main(dsm_segment *seg, shm_toc *toc)
+{
+	LVShared   *shared;
+	LVRelStats	vacrelstats;
+	dsm_segment *dead_tuples_seg = NULL;
+	Relation	onerel;
+
+	shared = (LVShared *) shm_toc_lookup(toc, PARALLEL_VACUUM_KEY_SHARED);
+	if (shared == NULL)
+		elog(ERROR, "could not find parallel vacuum state");
+
+	/* Like the leader, don't hold back other vacuums' xmin horizons */
+	LWLockAcquire(ProcArrayLock, LW_EXCLUSIVE);
+	MyPgXact->vacuumFlags |= PROC_IN_VACUUM;
+	LWLockRelease(ProcArrayLock);
+
+	/* Set up the state used by lazy_vacuum_index and lazy_cleanup_index */
+	elevel = shared->elevel;
+	vac_strategy = GetAccessStrategy(BAS_VACUUM);
+	VacuumCostActive = (VacuumCostDelay > 0);
+	VacuumCostBalance = 0;
+	VacuumSharedCostBalance = &shared->cost_balance;
+	VacuumCostBalanceLocal = 0;
+
+	memset(&vacrelstats, 0, sizeof(LVRelStats));
+	vacrelstats.hasindex = true;
+	vacrelstats.rel_pages = shared->rel_pages;
+	vacrelstats.scanned_pages = shared->scanned_pages;
+	vacrelstats.old_rel_tuples = shared->old_rel_tuples;
+	vacrelstats.new_rel_tuples = shared->new_rel_tuples;
+	vacrelstats.num_dead_tuples = shared->num_dead_tuples;
+
+	if (!shared->for_cleanup)
+	{
+		dead_tuples_seg = dsm_attach(shared->dead_tuples_handle);
+		if (dead_tuples_seg == NULL)
+			ereport(ERROR,
+					(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+					 errmsg("could not map dynamic shared memory segment")));
+		vacrelstats.dead_tuples = (LVDeadTuples *)
+			dsm_segment_address(dead_tuples_seg);
+	}
+
+	onerel = heap_open(shared->relid, ShareUpdateExclusiveLock);
+
+	for (;;)
+	{
+		uint32		idx = pg_atomic_fetch_add_u32(&shared->nextidx, 1);
+		LVSharedIndex *ent;
+		Relation	indrel;
+
+		if (idx >= (uint32) shared->nindexes)
+			break;
+		ent = &shared->indexes[idx];
+
+		indrel = index_open(ent->indexoid, RowExclusiveLock);
+		lazy_parallel_process_index(shared, ent, indrel, &vacrelstats);
+		index_close(indrel, NoLock);
+	}
+
+	heap_close(onerel, NoLock);
+
+	VacuumSharedCostBalance = NULL;
+	if (dead_tuples_seg != NULL)
+		dsm_detach(dead_tuples_seg);
+	FreeAccessStrategy(vac_strategy);
+	vac_strategy = NULL;
+}
+
+/*
+ * lazy_skip_index_vacuum - should we leave the dead tuples for later?
+ *
+ * Scanning every index to remove a handful of dead tuples costs a lot and
+ * gains little.  If the dead tuples are fewer than vacuum_skip_index_fraction
+ * of the table's tuples, they are left in place, and the next vacuum will
+ * find them again.  This is safe, and doesn't keep us from advancing
+ * relfrozenxid, as long as all of them are dead item identifiers without
+ * storage, as heap_page_prune leaves them: those carry no transaction IDs.
+ * Dead tuples that pruning didn't get to, because they became dead only
+ * after it ran, must be removed now.
+ *
+ * This only applies if the dead tuples all fit in memory at once; once an
+ * index vacuum cycle has been needed, there are plenty of them anyway.
+ */
+static bool
+lazy_skip_index_vacuum(LVRelStats *vacrelstats, double num_tuples,
+					   double nunpruned)
+{
+	double		reltuples;
+
+	if (vacuum_skip_index_fraction <= 0)
+		return false;
+
+	if (vacrelstats->num_index_scans > 0 || nunpruned > 0)
+		return false;
+
+	reltuples = Max(vacrelstats->old_rel_tuples,
+					num_tuples + vacrelstats->num_dead_tuples);
+
+	return vacrelstats->num_dead_tuples < reltuples * vacuum_skip_index_fraction;
 }
 
 /*
@@ -1919,106 +2564,308 @@ count_nondeletable_pages(Relation onerel, LVRelStats *vacrelstats)
 static void
 lazy_space_alloc(LVRelStats *vacrelstats, BlockNumber relblocks)
 {
-	long		maxtuples;
+	LVDeadTuples *dt;
+	Size		header;
+	Size		size;
+	Size		perpage = sizeof(LVDeadBlock) + LV_DEAD_MAX_PAYLOAD;
+	uint32		nchunks;
 	int			vac_work_mem = IsAutoVacuumWorkerProcess() &&
 	autovacuum_work_mem != -1 ?
 	autovacuum_work_mem : maintenance_work_mem;
 
-	if (vacrelstats->hasindex)
+	vacrelstats->num_dead_tuples = 0;
+
+	/* With no indexes, dead tuples are never saved up */
+	if (!vacrelstats->hasindex)
 	{
-		maxtuples = (vac_work_mem * 1024L) / sizeof(ItemPointerData);
-		maxtuples = Min(maxtuples, INT_MAX);
-		maxtuples = Min(maxtuples, MaxAllocSize / sizeof(ItemPointerData));
+		vacrelstats->max_dead_tuples = 0;
+		vacrelstats->dead_tuples = NULL;
+		return;
+	}
 
-		/* curious coding here to ensure the multiplication can't overflow */
-		if ((BlockNumber) (maxtuples / LAZY_ALLOC_TUPLES) > relblocks)
-			maxtuples = relblocks * LAZY_ALLOC_TUPLES;
+	nchunks = relblocks / LV_DEAD_CHUNK_BLOCKS + 1;
+	header = MAXALIGN(offsetof(LVDeadTuples, chunkdir) +
+					  nchunks * sizeof(uint32));
 
-		/* stay sane if small maintenance_work_mem */
-		maxtuples = Max(maxtuples, MaxHeapTuplesPerPage);
-	}
-	else
+	size = (Size) vac_work_mem * 1024L;
+
+	/* curious coding here to ensure the multiplication can't overflow */
+	if (size <= header || (Size) ((size - header) / perpage) > relblocks)
+		size = header + (Size) relblocks * perpage;
+
+	/* stay sane if small maintenance_work_mem, or very large */
+	size = Max(size, header + perpage);
+	size = MAXALIGN(size);
+	size = Min(size, LV_DEAD_MAX_SIZE);
+
+	/* each TID takes at most the size of a page entry, see LVDeadTuples */
+	vacrelstats->max_dead_tuples = (size - header) / sizeof(LVDeadBlock);
+
+	/*
+	 * If the indexes are going to be vacuumed in parallel, put the store in
+	 * shared memory.  If we're out of DSM segments, just do without workers.
+	 */
+	dt = NULL;
+	if (vacrelstats->nworkers > 0)
 	{
-		maxtuples = MaxHeapTuplesPerPage;
+		vacrelstats->dead_tuples_seg =
+			dsm_create(size, DSM_CREATE_NULL_IF_MAXSEGMENTS);
+		if (vacrelstats->dead_tuples_seg != NULL)
+			dt = (LVDeadTuples *)
+				dsm_segment_address(vacrelstats->dead_tuples_seg);
+		else
+			vacrelstats->nworkers = 0;
 	}
 
-	vacrelstats->num_dead_tuples = 0;
-	vacrelstats->max_dead_tuples = (int) maxtuples;
-	vacrelstats->dead_tuples = (ItemPointer)
-		palloc(maxtuples * sizeof(ItemPointerData));
+	if (dt == NULL)
+		dt = (LVDeadTuples *) MemoryContextAllocHuge(CurrentMemoryContext,
+													 size);
+
+	dt->size = size;
+	dt->blocks_offset = header;
+	dt->nchunks = nchunks;
+	dead_tuples_reset(dt);
+
+	vacrelstats->dead_tuples = dt;
+}
+
+/*
+ * lazy_space_is_full - is there no room left for another page's dead tuples?
+ */
+static bool
+lazy_space_is_full(LVRelStats *vacrelstats)
+{
+	LVDeadTuples *dt = vacrelstats->dead_tuples;
+	Size		used;
+
+	used = dt->blocks_offset + dt->nblocks * sizeof(LVDeadBlock);
+	return (dt->payload_start - used) <
+		sizeof(LVDeadBlock) + LV_DEAD_MAX_PAYLOAD;
 }
 
 /*
- * lazy_record_dead_tuple - remember one deletable tuple
+ * lazy_record_dead_tuples - remember the deletable tuples of one page
+ *
+ * deadoffsets[] must be in increasing order, and pages must be added in block
+ * number order.
  */
 static void
-lazy_record_dead_tuple(LVRelStats *vacrelstats,
-					   ItemPointer itemptr)
+lazy_record_dead_tuples(LVRelStats *vacrelstats, BlockNumber blkno,
+						OffsetNumber *deadoffsets, int ndeadoffsets)
 {
+	LVDeadTuples *dt = vacrelstats->dead_tuples;
+	LVDeadBlock *entry;
+	int			chunk = blkno >> LV_DEAD_CHUNK_BITS;
+	Size		listbytes;
+	Size		bitmapbytes;
+
+	Assert(ndeadoffsets > 0);
+	Assert(chunk < dt->nchunks && chunk >= dt->lastchunk);
+
 	/*
-	 * The array shouldn't overflow under normal behavior, but perhaps it
-	 * could if we are given a really small maintenance_work_mem. In that
-	 * case, just forget the last few tuples (we'll get 'em next time).
+	 * The store shouldn't overflow under normal behavior, since the caller
+	 * checks for room before each page.  Just in case, forget the tuples
+	 * (we'll get 'em next time).
 	 */
-	if (vacrelstats->num_dead_tuples < vacrelstats->max_dead_tuples)
+	if (lazy_space_is_full(vacrelstats))
+		return;
+
+	while (dt->lastchunk < chunk)
+		dt->chunkdir[++dt->lastchunk] = dt->nblocks;
+
+	entry = &LVDeadTuplesBlocks(dt)[dt->nblocks];
+	entry->blklow = blkno & (LV_DEAD_CHUNK_BLOCKS - 1);
+
+	listbytes = ndeadoffsets * sizeof(OffsetNumber);
+	bitmapbytes = (deadoffsets[ndeadoffsets - 1] + 7) / 8;
+
+	if (ndeadoffsets == 1)
+	{
+		entry->format = LV_DEAD_SINGLE;
+		entry->len = deadoffsets[0];
+		entry->start = 0;
+	}
+	else if (listbytes <= bitmapbytes)
 	{
-		vacrelstats->dead_tuples[vacrelstats->num_dead_tuples] = *itemptr;
-		vacrelstats->num_dead_tuples++;
-		pgstat_progress_update_param(PROGRESS_VACUUM_NUM_DEAD_TUPLES,
-									 vacrelstats->num_dead_tuples);
+		entry->format = LV_DEAD_LIST;
+		entry->len = ndeadoffsets;
+		dt->payload_start -= SHORTALIGN(listbytes);
+		entry->start = dt->payload_start;
+		memcpy((char *) dt + entry->start, deadoffsets, listbytes);
 	}
+	else
+	{
+		uint8	   *bitmap;
+		int			i;
+
+		entry->format = LV_DEAD_BITMAP;
+		entry->len = bitmapbytes;
+		dt->payload_start -= SHORTALIGN(bitmapbytes);
+		entry->start = dt->payload_start;
+		bitmap = (uint8 *) dt + entry->start;
+		memset(bitmap, 0, bitmapbytes);
+		for (i = 0; i < ndeadoffsets; i++)
+		{
+			int			bit = deadoffsets[i] - 1;
+
+			bitmap[bit / 8] |= 1 << (bit % 8);
+		}
+	}
+
+	dt->nblocks++;
+	dt->ntuples += ndeadoffsets;
+	vacrelstats->num_dead_tuples += ndeadoffsets;
+	pgstat_progress_update_param(PROGRESS_VACUUM_NUM_DEAD_TUPLES,
+								 vacrelstats->num_dead_tuples);
 }
 
 /*
  *	lazy_tid_reaped() -- is a particular tid deletable?
  *
  *		This has the right signature to be an IndexBulkDeleteCallback.
- *
- *		Assumes dead_tuples array is in sorted order.
  */
 static bool
 lazy_tid_reaped(ItemPointer itemptr, void *state)
 {
 	LVRelStats *vacrelstats = (LVRelStats *) state;
-	ItemPointer res;
+	LVDeadTuples *dt = vacrelstats->dead_tuples;
+	LVDeadBlock *blocks = LVDeadTuplesBlocks(dt);
+	BlockNumber blkno = ItemPointerGetBlockNumber(itemptr);
+	OffsetNumber offnum = ItemPointerGetOffsetNumber(itemptr);
+	int			chunk = blkno >> LV_DEAD_CHUNK_BITS;
+	uint8		blklow = blkno & (LV_DEAD_CHUNK_BLOCKS - 1);
+	LVDeadBlock *entry;
+	int			lo,
+				hi;
+
+	/* Find the page's entry by binary search within its chunk */
+	if (chunk > dt->lastchunk)
+		return false;
+	lo = dt->chunkdir[chunk];
+	hi = (chunk == dt->lastchunk) ? dt->nblocks : dt->chunkdir[chunk + 1];
+
+	entry = NULL;
+	while (lo < hi)
+	{
+		int			mid = (lo + hi) / 2;
+
+		if (blocks[mid].blklow < blklow)
+			lo = mid + 1;
+		else if (blocks[mid].blklow > blklow)
+			hi = mid;
+		else
+		{
+			entry = &blocks[mid];
+			break;
+		}
+	}
+	if (entry == NULL)
+		return false;
+
+	switch (entry->format)
+	{
+		case LV_DEAD_SINGLE:
+			return offnum == entry->len;
+
+		case LV_DEAD_LIST:
+			{
+				OffsetNumber *list = (OffsetNumber *) ((char *) dt + entry->start);
+				int			i;
+
+				for (i = 0; i < entry->len && list[i] <= offnum; i++)
+				{
+					if (list[i] == offnum)
+						return true;
+				}
+				return false;
+			}
 
-	res = (ItemPointer) bsearch((void *) itemptr,
-								(void *) vacrelstats->dead_tuples,
-								vacrelstats->num_dead_tuples,
-								sizeof(ItemPointerData),
-								vac_cmp_itemptr);
+		case LV_DEAD_BITMAP:
+			{
+				uint8	   *bitmap = (uint8 *) dt + entry->start;
+				int			bit = offnum - 1;
+
+				if (bit / 8 >= entry->len)
+					return false;
+				return (bitmap[bit / 8] & (1 << (bit % 8))) != 0;
+			}
+	}
+
+	return false;				/* keep compiler quiet */
+}
 
-	return (res != NULL);
+/*
+ * dead_tuples_reset - empty the dead tuple store
+ */
+static void
+dead_tuples_reset(LVDeadTuples *dt)
+{
+	dt->payload_start = dt->size;
+	dt->lastchunk = -1;
+	dt->nblocks = 0;
+	dt->ntuples = 0;
 }
 
 /*
- * Comparator routines for use with qsort() and bsearch().
+ * dead_tuples_get_page - return the block number and dead offsets of the i'th
+ * page in the dead tuple store
+ *
+ * The offsets are stored into offsets[], which must have room for
+ * MaxHeapTuplesPerPage entries, and their number is returned.
  */
 static int
-vac_cmp_itemptr(const void *left, const void *right)
+dead_tuples_get_page(LVDeadTuples *dt, int i, BlockNumber *blkno,
+					 OffsetNumber *offsets)
 {
-	BlockNumber lblk,
-				rblk;
-	OffsetNumber loff,
-				roff;
+	LVDeadBlock *entry = &LVDeadTuplesBlocks(dt)[i];
+	int			lo,
+				hi;
+	int			n;
 
-	lblk = ItemPointerGetBlockNumber((ItemPointer) left);
-	rblk = ItemPointerGetBlockNumber((ItemPointer) right);
+	Assert(i < dt->nblocks);
 
-	if (lblk < rblk)
-		return -1;
-	if (lblk > rblk)
-		return 1;
+	/* find the last chunk starting at or before entry i */
+	lo = 0;
+	hi = dt->lastchunk;
+	while (lo < hi)
+	{
+		int			mid = (lo + hi + 1) / 2;
 
-	loff = ItemPointerGetOffsetNumber((ItemPointer) left);
-	roff = ItemPointerGetOffsetNumber((ItemPointer) right);
+		if (dt->chunkdir[mid] <= i)
+			lo = mid;
+		else
+			hi = mid - 1;
+	}
+	*blkno = ((BlockNumber) lo << LV_DEAD_CHUNK_BITS) | entry->blklow;
 
-	if (loff < roff)
-		return -1;
-	if (loff > roff)
-		return 1;
+	switch (entry->format)
+	{
+		case LV_DEAD_SINGLE:
+			offsets[0] = entry->len;
+			return 1;
 
-	return 0;
+		case LV_DEAD_LIST:
+			memcpy(offsets, (char *) dt + entry->start,
+				   entry->len * sizeof(OffsetNumber));
+			return entry->len;
+
+		case LV_DEAD_BITMAP:
+			{
+				uint8	   *bitmap = (uint8 *) dt + entry->start;
+				int			bit;
+
+				n = 0;
+				for (bit = 0; bit < entry->len * 8; bit++)
+				{
+					if (bitmap[bit / 8] & (1 << (bit % 8)))
+						offsets[n++] = bit + 1;
+				}
+				return n;
+			}
+	}
+
+	elog(ERROR, "unrecognized dead tuple format: %d", entry->format);
+	return 0;					/* keep compiler quiet */
 }
 
 /*
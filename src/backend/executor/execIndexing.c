@@ -106,12 +106,15 @@
  */
 #include "postgres.h"
 
+#include "access/nbtree.h"
 #include "access/relscan.h"
 #include "access/xact.h"
 #include "catalog/index.h"
+#include "catalog/pg_am.h"
 #include "executor/executor.h"
 #include "nodes/nodeFuncs.h"
 #include "storage/lmgr.h"
+#include "utils/sortsupport.h"
 #include "utils/tqual.h"
 
 /* waitMode argument to check_exclusion_or_unique_constraint() */
@@ -122,6 +125,21 @@ typedef enum
 	CEOUC_LIVELOCK_PREVENTING_WAIT
 } CEOUC_WAIT_MODE;
 
+/* One index entry to insert, for ExecInsertIndexTuplesMulti() */
+typedef struct IndexBatchEntry
+{
+	int			tupno;			/* position of the heap tuple in the batch */
+	Datum	   *values;			/* index column values */
+	bool	   *isnull;			/* index column null flags */
+} IndexBatchEntry;
+
+/* Sort state for ordering IndexBatchEntrys */
+typedef struct IndexBatchSortState
+{
+	int			nkeys;
+	SortSupport sortKeys;
+} IndexBatchSortState;
+
 static bool check_exclusion_or_unique_constraint(Relation heap, Relation index,
 									 IndexInfo *indexInfo,
 									 ItemPointer tupleid,
@@ -131,6 +149,9 @@ static bool check_exclusion_or_unique_constraint(Relation heap, Relation index,
 									 bool errorOK,
 									 ItemPointer conflictTid);
 
+static void sort_index_batch(Relation indexRelation, IndexBatchEntry *entries,
+				 int nentries);
+static int	cmp_index_batch_entry(const void *a, const void *b, void *arg);
 static bool index_recheck_constraint(Relation index, Oid *constr_procs,
 						 Datum *existing_values, bool *existing_isnull,
 						 Datum *new_values);
@@ -450,6 +471,193 @@ ExecInsertIndexTuples(TupleTableSlot *slot,
 	return result;
 }
 
+/* ----------------------------------------------------------------
+ *		ExecInsertIndexTuplesMulti
+ *
+ *		Like ExecInsertIndexTuples, but for a batch of heap tuples
+ *		that have all been inserted already, as by heap_multi_insert.
+ *		Instead of inserting each tuple into all the indexes in turn,
+ *		this inserts all the tuples into one index at a time, and into
+ *		btree indexes in key order.  Consecutive insertions then
+ *		mostly descend to the same or a neighbouring leaf page, which
+ *		is likely to be in cache still, which saves a lot of buffer
+ *		lookups and random I/O when the indexes are large.
+ *
+ *		recheckIndexes[i] is set to the list of index OIDs that
+ *		ExecInsertIndexTuples would have returned for tuples[i].
+ *		While the entries of a tuple are being formed or inserted,
+ *		*curtuple is set to its position in tuples[], so that an
+ *		error context callback of the caller can identify it.
+ *
+ *		Speculative insertion is not supported.
+ * ----------------------------------------------------------------
+ */
+void
+ExecInsertIndexTuplesMulti(TupleTableSlot *slot, HeapTuple *tuples,
+						   int ntuples, EState *estate,
+						   List **recheckIndexes, int *curtuple)
+{
+	ResultRelInfo *resultRelInfo;
+	int			i;
+	int			numIndices;
+	RelationPtr relationDescs;
+	Relation	heapRelation;
+	IndexInfo **indexInfoArray;
+	ExprContext *econtext;
+	MemoryContext oldcontext;
+
+	/*
+	 * Get information from the result relation info structure.
+	 */
+	resultRelInfo = estate->es_result_relation_info;
+	numIndices = resultRelInfo->ri_NumIndices;
+	relationDescs = resultRelInfo->ri_IndexRelationDescs;
+	indexInfoArray = resultRelInfo->ri_IndexRelationInfo;
+	heapRelation = resultRelInfo->ri_RelationDesc;
+
+	for (i = 0; i < ntuples; i++)
+		recheckIndexes[i] = NIL;
+
+	/*
+	 * Predicates and index expressions are evaluated in the EState's
+	 * per-tuple context, as in ExecInsertIndexTuples, and we keep our working
+	 * arrays there too.  The index values formed for the whole batch must
+	 * stay valid until they have been inserted, so the caller mustn't reset
+	 * the context while we run.
+	 */
+	econtext = GetPerTupleExprContext(estate);
+	econtext->ecxt_scantuple = slot;
+
+	for (i = 0; i < numIndices; i++)
+	{
+		Relation	indexRelation = relationDescs[i];
+		IndexInfo  *indexInfo;
+		IndexUniqueCheck checkUnique;
+		IndexBatchEntry *entries;
+		Datum	   *values;
+		bool	   *isnull;
+		int			natts;
+		int			nentries;
+		int			j;
+
+		if (indexRelation == NULL)
+			continue;
+
+		indexInfo = indexInfoArray[i];
+
+		/* If the index is marked as read-only, ignore it */
+		if (!indexInfo->ii_ReadyForInserts)
+			continue;
+
+		/* Set up predicate state as ExecInsertIndexTuples would */
+		if (indexInfo->ii_Predicate != NIL &&
+			indexInfo->ii_PredicateState == NIL)
+			indexInfo->ii_PredicateState = (List *)
+				ExecPrepareExpr((Expr *) indexInfo->ii_Predicate, estate);
+
+		natts = indexInfo->ii_NumIndexAttrs;
+
+		oldcontext = MemoryContextSwitchTo(GetPerTupleMemoryContext(estate));
+		entries = (IndexBatchEntry *) palloc(ntuples * sizeof(IndexBatchEntry));
+		values = (Datum *) palloc(ntuples * natts * sizeof(Datum));
+		isnull = (bool *) palloc(ntuples * natts * sizeof(bool));
+		MemoryContextSwitchTo(oldcontext);
+
+		/*
+		 * Form the index entries of all the tuples that belong in the index.
+		 */
+		nentries = 0;
+		for (j = 0; j < ntuples; j++)
+		{
+			IndexBatchEntry *entry = &entries[nentries];
+
+			*curtuple = j;
+			ExecStoreTuple(tuples[j], slot, InvalidBuffer, false);
+
+			/* Skip this tuple if the predicate isn't satisfied */
+			if (indexInfo->ii_Predicate != NIL &&
+				!ExecQual(indexInfo->ii_PredicateState, econtext, false))
+				continue;
+
+			entry->tupno = j;
+			entry->values = values + nentries * natts;
+			entry->isnull = isnull + nentries * natts;
+			FormIndexDatum(indexInfo, slot, estate,
+						   entry->values, entry->isnull);
+			nentries++;
+		}
+
+		if (indexRelation->rd_rel->relam == BTREE_AM_OID && nentries > 1)
+		{
+			oldcontext = MemoryContextSwitchTo(GetPerTupleMemoryContext(estate));
+			sort_index_batch(indexRelation, entries, nentries);
+			MemoryContextSwitchTo(oldcontext);
+		}
+
+		/* Choose the uniqueness check the same way as ExecInsertIndexTuples */
+		if (!indexRelation->rd_index->indisunique)
+			checkUnique = UNIQUE_CHECK_NO;
+		else if (indexRelation->rd_index->indimmediate)
+			checkUnique = UNIQUE_CHECK_YES;
+		else
+			checkUnique = UNIQUE_CHECK_PARTIAL;
+
+		for (j = 0; j < nentries; j++)
+		{
+			IndexBatchEntry *entry = &entries[j];
+			HeapTuple	tuple = tuples[entry->tupno];
+			bool		satisfiesConstraint;
+
+			*curtuple = entry->tupno;
+
+			satisfiesConstraint =
+				index_insert(indexRelation, entry->values, entry->isnull,
+							 &(tuple->t_self), heapRelation, checkUnique);
+
+			/*
+			 * Exclusion constraints are checked right after inserting each
+			 * entry, as in ExecInsertIndexTuples.  The order of the entries
+			 * doesn't matter for that, since each one is checked against all
+			 * those inserted before it.
+			 */
+			if (indexInfo->ii_ExclusionOps != NULL)
+			{
+				bool		violationOK;
+				CEOUC_WAIT_MODE waitMode;
+
+				if (!indexRelation->rd_index->indimmediate)
+				{
+					violationOK = true;
+					waitMode = CEOUC_NOWAIT;
+				}
+				else
+				{
+					violationOK = false;
+					waitMode = CEOUC_WAIT;
+				}
+
+				satisfiesConstraint =
+					check_exclusion_or_unique_constraint(heapRelation,
+														 indexRelation,
+														 indexInfo,
+														 &(tuple->t_self),
+														 entry->values,
+														 entry->isnull,
+														 estate, false,
+														 waitMode,
+														 violationOK, NULL);
+			}
+
+			if ((checkUnique == UNIQUE_CHECK_PARTIAL ||
+				 indexInfo->ii_ExclusionOps != NULL) &&
+				!satisfiesConstraint)
+				recheckIndexes[entry->tupno] =
+					lappend_oid(recheckIndexes[entry->tupno],
+								RelationGetRelid(indexRelation));
+		}
+	}
+}
+
 /* ----------------------------------------------------------------
  *		ExecCheckIndexConstraints
  *
@@ -897,3 +1105,72 @@ index_recheck_constraint(Relation index, Oid *constr_procs,
 
 	return true;
 }
+
+/*
+ * Sort a batch of entries for a btree index into index order.  Entries with
+ * equal keys are kept in the order of the heap tuples, so that the index
+ * entries of duplicates are added in TID order.  Sort support state is
+ * allocated in the current memory context.
+ */
+static void
+sort_index_batch(Relation indexRelation, IndexBatchEntry *entries,
+				 int nentries)
+{
+	IndexBatchSortState state;
+	int16	   *indoption = indexRelation->rd_indoption;
+	int			i;
+
+	state.nkeys = RelationGetNumberOfAttributes(indexRelation);
+	state.sortKeys = (SortSupport) palloc0(state.nkeys *
+										   sizeof(SortSupportData));
+
+	for (i = 0; i < state.nkeys; i++)
+	{
+		SortSupport sortKey = state.sortKeys + i;
+		int16		strategy;
+
+		sortKey->ssup_cxt = CurrentMemoryContext;
+		sortKey->ssup_collation = indexRelation->rd_indcollation[i];
+		sortKey->ssup_nulls_first =
+			(indoption[i] & INDOPTION_NULLS_FIRST) != 0;
+		sortKey->ssup_attno = i + 1;
+		sortKey->abbreviate = false;
+
+		strategy = (indoption[i] & INDOPTION_DESC) != 0 ?
+			BTGreaterStrategyNumber : BTLessStrategyNumber;
+
+		PrepareSortSupportFromIndexRel(indexRelation, strategy, sortKey);
+	}
+
+	qsort_arg(entries, nentries, sizeof(IndexBatchEntry),
+			  cmp_index_batch_entry, &state);
+
+	pfree(state.sortKeys);
+}
+
+/*
+ * qsort_arg comparator for sort_index_batch
+ */
+static int
+cmp_index_batch_entry(const void *a, const void *b, void *arg)
+{
+	const IndexBatchEntry *ea = (const IndexBatchEntry *) a;
+	const IndexBatchEntry *eb = (const IndexBatchEntry *) b;
+	IndexBatchSortState *state = (IndexBatchSortState *) arg;
+	int			i;
+
+	for (i = 0; i < state->nkeys; i++)
+	{
+		int			compare;
+
+		compare = ApplySortComparator(ea->values[i], ea->isnull[i],
+									  eb->values[i], eb->isnull[i],
+									  &state->sortKeys[i]);
+		if (compare != 0)
+			return compare;
+	}
+
+	if (ea->tupno < eb->tupno)
+		return -1;
+	return (ea->tupno > eb->tupno) ? 1 : 0;
+}
@@ -39,9 +39,11 @@
 
 #include "access/htup_details.h"
 #include "access/sysattr.h"
+#include "access/tableam.h"
 #include "access/transam.h"
 #include "access/xact.h"
 #include "catalog/namespace.h"
+#include "commands/defrem.h"
 #include "commands/matview.h"
 #include "commands/trigger.h"
 #include "executor/execdebug.h"
@@ -1152,7 +1154,15 @@ CheckValidRowMarkRel(Relation rel, RowMarkType markType)
 	switch (rel->rd_rel->relkind)
 	{
 		case RELKIND_RELATION:
-			/* OK */
+			/* Row locks are stored in the heap tuples themselves */
+			if (RowMarkRequiresRowShareLock(markType) &&
+				!RelationUsesHeapAm(rel))
+				ereport(ERROR,
+						(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+						 errmsg("cannot lock rows in table \"%s\"",
+								RelationGetRelationName(rel)),
+						 errdetail("Access method \"%s\" does not support row locking.",
+								   get_am_name(rel->rd_rel->relam))));
 			break;
 		case RELKIND_SEQUENCE:
 			/* Must disallow this because we don't vacuum sequences */
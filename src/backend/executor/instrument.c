@@ -20,11 +20,29 @@
 BufferUsage pgBufferUsage;
 static BufferUsage save_pgBufferUsage;
 
+int			timing_clock_source = INSTR_CLOCK_AUTO;
+
 static void BufferUsageAdd(BufferUsage *dst, const BufferUsage *add);
 static void BufferUsageAccumDiff(BufferUsage *dst,
 					 const BufferUsage *add, const BufferUsage *sub);
 
 
+/*
+ * Choose the clock source for timing plan nodes and I/O, according to
+ * timing_clock_source.  Called once at postmaster or standalone backend
+ * start; children inherit the result.
+ */
+void
+InstrInitClock(void)
+{
+	if (pg_instr_clock_init((InstrClockSource) timing_clock_source))
+		elog(DEBUG1, "timing with the TSC at %.0f MHz",
+			 pg_instr_tsc_frequency());
+	else if (timing_clock_source == INSTR_CLOCK_TSC)
+		ereport(LOG,
+				(errmsg("TSC cannot be used as clock source, using the system clock instead")));
+}
+
 /* Allocate new instrumentation structure(s) */
 Instrumentation *
 InstrAlloc(int n, int instrument_options)
@@ -65,7 +83,7 @@ InstrStartNode(Instrumentation *instr)
 	if (instr->need_timer)
 	{
 		if (INSTR_TIME_IS_ZERO(instr->starttime))
-			INSTR_TIME_SET_CURRENT(instr->starttime);
+			INSTR_TIME_SET_CURRENT_FAST(instr->starttime);
 		else
 			elog(ERROR, "InstrStartNode called twice in a row");
 	}
@@ -90,7 +108,7 @@ InstrStopNode(Instrumentation *instr, double nTuples)
 		if (INSTR_TIME_IS_ZERO(instr->starttime))
 			elog(ERROR, "InstrStopNode called without start");
 
-		INSTR_TIME_SET_CURRENT(endtime);
+		INSTR_TIME_SET_CURRENT_FAST(endtime);
 		INSTR_TIME_ACCUM_DIFF(instr->counter, endtime, instr->starttime);
 
 		INSTR_TIME_SET_ZERO(instr->starttime);
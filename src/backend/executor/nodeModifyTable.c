@@ -38,6 +38,7 @@
 #include "postgres.h"
 
 #include "access/htup_details.h"
+#include "access/tableam.h"
 #include "access/xact.h"
 #include "commands/trigger.h"
 #include "executor/executor.h"
@@ -469,12 +470,12 @@ ExecInsert(ModifyTableState *mtstate,
 			/*
 			 * insert the tuple normally.
 			 *
-			 * Note: heap_insert returns the tid (location) of the new tuple
+			 * Note: table_insert returns the tid (location) of the new tuple
 			 * in the t_self field.
 			 */
-			newId = heap_insert(resultRelationDesc, tuple,
-								estate->es_output_cid,
-								0, NULL);
+			newId = table_insert(resultRelationDesc, tuple,
+								 estate->es_output_cid,
+								 0, NULL);
 
 			/* insert index entries for tuple */
 			if (resultRelInfo->ri_NumIndices > 0)
@@ -625,11 +626,11 @@ ExecDelete(ItemPointer tupleid,
 		 * mode transactions.
 		 */
 ldelete:;
-		result = heap_delete(resultRelationDesc, tupleid,
-							 estate->es_output_cid,
-							 estate->es_crosscheck_snapshot,
-							 true /* wait for commit */ ,
-							 &hufd);
+		result = table_delete(resultRelationDesc, tupleid,
+							  estate->es_output_cid,
+							  estate->es_crosscheck_snapshot,
+							  true /* wait for commit */ ,
+							  &hufd);
 		switch (result)
 		{
 			case HeapTupleSelfUpdated:
@@ -671,7 +672,14 @@ ldelete:;
 				break;
 
 			case HeapTupleUpdated:
-				if (IsolationUsesXactSnapshot())
+
+				/*
+				 * EvalPlanQual locks and re-fetches the new row version in
+				 * the heap, so for other access methods all we can do is
+				 * report the conflict.
+				 */
+				if (IsolationUsesXactSnapshot() ||
+					!RelationUsesHeapAm(resultRelationDesc))
 					ereport(ERROR,
 							(errcode(ERRCODE_T_R_SERIALIZATION_FAILURE),
 							 errmsg("could not serialize access due to concurrent update")));
@@ -725,33 +733,26 @@ ldelete:;
 		 */
 		TupleTableSlot *rslot;
 		HeapTupleData deltuple;
-		Buffer		delbuffer;
 
 		if (resultRelInfo->ri_FdwRoutine)
 		{
 			/* FDW must have provided a slot containing the deleted row */
 			Assert(!TupIsNull(slot));
-			delbuffer = InvalidBuffer;
 		}
 		else
 		{
 			slot = estate->es_trig_tuple_slot;
+			if (slot->tts_tupleDescriptor != RelationGetDescr(resultRelationDesc))
+				ExecSetSlotDescriptor(slot, RelationGetDescr(resultRelationDesc));
+
 			if (oldtuple != NULL)
 			{
 				deltuple = *oldtuple;
-				delbuffer = InvalidBuffer;
-			}
-			else
-			{
-				deltuple.t_self = *tupleid;
-				if (!heap_fetch(resultRelationDesc, SnapshotAny,
-								&deltuple, &delbuffer, false, NULL))
-					elog(ERROR, "failed to fetch deleted tuple for DELETE RETURNING");
+				ExecStoreTuple(&deltuple, slot, InvalidBuffer, false);
 			}
-
-			if (slot->tts_tupleDescriptor != RelationGetDescr(resultRelationDesc))
-				ExecSetSlotDescriptor(slot, RelationGetDescr(resultRelationDesc));
-			ExecStoreTuple(&deltuple, slot, InvalidBuffer, false);
+			else if (!table_fetch_slot(resultRelationDesc, tupleid,
+									   SnapshotAny, slot))
+				elog(ERROR, "failed to fetch deleted tuple for DELETE RETURNING");
 		}
 
 		rslot = ExecProcessReturning(resultRelInfo, slot, planSlot);
@@ -763,8 +764,6 @@ ldelete:;
 		ExecMaterializeSlot(rslot);
 
 		ExecClearTuple(slot);
-		if (BufferIsValid(delbuffer))
-			ReleaseBuffer(delbuffer);
 
 		return rslot;
 	}
@@ -919,11 +918,11 @@ lreplace:;
 		 * needed for referential integrity updates in transaction-snapshot
 		 * mode transactions.
 		 */
-		result = heap_update(resultRelationDesc, tupleid, tuple,
-							 estate->es_output_cid,
-							 estate->es_crosscheck_snapshot,
-							 true /* wait for commit */ ,
-							 &hufd, &lockmode);
+		result = table_update(resultRelationDesc, tupleid, tuple,
+							  estate->es_output_cid,
+							  estate->es_crosscheck_snapshot,
+							  true /* wait for commit */ ,
+							  &hufd, &lockmode);
 		switch (result)
 		{
 			case HeapTupleSelfUpdated:
@@ -964,7 +963,9 @@ lreplace:;
 				break;
 
 			case HeapTupleUpdated:
-				if (IsolationUsesXactSnapshot())
+				/* as in ExecDelete, only the heap supports EvalPlanQual */
+				if (IsolationUsesXactSnapshot() ||
+					!RelationUsesHeapAm(resultRelationDesc))
 					ereport(ERROR,
 							(errcode(ERRCODE_T_R_SERIALIZATION_FAILURE),
 							 errmsg("could not serialize access due to concurrent update")));
@@ -16,7 +16,9 @@
 
 #include "access/hash.h"
 #include "access/relscan.h"
+#include "access/tableam.h"
 #include "access/tsmapi.h"
+#include "commands/defrem.h"
 #include "executor/executor.h"
 #include "executor/nodeSamplescan.h"
 #include "miscadmin.h"
@@ -124,6 +126,15 @@ InitScanRelation(SampleScanState *node, EState *estate, int eflags)
 
 	node->ss.ss_currentRelation = currentRelation;
 
+	/* the sampling methods work on heap pages */
+	if (!RelationUsesHeapAm(currentRelation))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("cannot use TABLESAMPLE on table \"%s\"",
+						RelationGetRelationName(currentRelation)),
+				 errdetail("Access method \"%s\" does not support TABLESAMPLE.",
+						   get_am_name(currentRelation->rd_rel->relam))));
+
 	/* we won't set up the HeapScanDesc till later */
 	node->ss.ss_currentScanDesc = NULL;
 
@@ -27,6 +27,7 @@
 #include "postgres.h"
 
 #include "access/relscan.h"
+#include "access/tableam.h"
 #include "executor/execdebug.h"
 #include "executor/nodeSeqscan.h"
 #include "utils/rel.h"
@@ -48,8 +49,7 @@ static TupleTableSlot *SeqNext(SeqScanState *node);
 static TupleTableSlot *
 SeqNext(SeqScanState *node)
 {
-	HeapTuple	tuple;
-	HeapScanDesc scandesc;
+	TableScanDesc scandesc;
 	EState	   *estate;
 	ScanDirection direction;
 	TupleTableSlot *slot;
@@ -57,7 +57,7 @@ SeqNext(SeqScanState *node)
 	/*
 	 * get information from the estate and scan state
 	 */
-	scandesc = node->ss.ss_currentScanDesc;
+	scandesc = node->scandesc;
 	estate = node->ss.ps.state;
 	direction = estate->es_direction;
 	slot = node->ss.ss_ScanTupleSlot;
@@ -68,33 +68,18 @@ SeqNext(SeqScanState *node)
 		 * We reach here if the scan is not parallel, or if we're executing
 		 * a scan that was intended to be parallel serially.
 		 */
-		scandesc = heap_beginscan(node->ss.ss_currentRelation,
-								  estate->es_snapshot,
-								  0, NULL);
-		node->ss.ss_currentScanDesc = scandesc;
+		scandesc = table_beginscan(node->ss.ss_currentRelation,
+								   estate->es_snapshot,
+								   0, NULL);
+		node->scandesc = scandesc;
 	}
 
 	/*
-	 * get the next tuple from the table
+	 * get the next tuple from the table into our scan tuple slot.  The
+	 * access method clears the slot at the end of the scan.
 	 */
-	tuple = heap_getnext(scandesc, direction);
-
-	/*
-	 * save the tuple and the buffer returned to us by the access methods in
-	 * our scan tuple slot and return the slot.  Note: we pass 'false' because
-	 * tuples returned by heap_getnext() are pointers onto disk pages and were
-	 * not created with palloc() and so should not be pfree()'d.  Note also
-	 * that ExecStoreTuple will increment the refcount of the buffer; the
-	 * refcount will not be dropped until the tuple table slot is cleared.
-	 */
-	if (tuple)
-		ExecStoreTuple(tuple,	/* tuple to store */
-					   slot,	/* slot to store in */
-					   scandesc->rs_cbuf,		/* buffer associated with this
-												 * tuple */
-					   false);	/* don't pfree this pointer */
-	else
-		ExecClearTuple(slot);
+	(void) table_getnextslot(node->ss.ss_currentRelation, scandesc,
+							 direction, slot);
 
 	return slot;
 }
@@ -227,13 +212,13 @@ void
 ExecEndSeqScan(SeqScanState *node)
 {
 	Relation	relation;
-	HeapScanDesc scanDesc;
+	TableScanDesc scanDesc;
 
 	/*
 	 * get information from node
 	 */
 	relation = node->ss.ss_currentRelation;
-	scanDesc = node->ss.ss_currentScanDesc;
+	scanDesc = node->scandesc;
 
 	/*
 	 * Free the exprcontext
@@ -247,10 +232,10 @@ ExecEndSeqScan(SeqScanState *node)
 	ExecClearTuple(node->ss.ss_ScanTupleSlot);
 
 	/*
-	 * close heap scan
+	 * close table scan
 	 */
 	if (scanDesc != NULL)
-		heap_endscan(scanDesc);
+		table_endscan(relation, scanDesc);
 
 	/*
 	 * close the heap relation.
@@ -272,13 +257,14 @@ ExecEndSeqScan(SeqScanState *node)
 void
 ExecReScanSeqScan(SeqScanState *node)
 {
-	HeapScanDesc scan;
+	TableScanDesc scan;
 
-	scan = node->ss.ss_currentScanDesc;
+	scan = node->scandesc;
 
 	if (scan != NULL)
-		heap_rescan(scan,			/* scan desc */
-					NULL);			/* new scan keys */
+		table_rescan(node->ss.ss_currentRelation,
+					 scan,			/* scan desc */
+					 NULL);			/* new scan keys */
 
 	ExecScanReScan((ScanState *) node);
 }
@@ -300,7 +286,9 @@ ExecSeqScanEstimate(SeqScanState *node,
 {
 	EState	   *estate = node->ss.ps.state;
 
-	node->pscan_len = heap_parallelscan_estimate(estate->es_snapshot);
+	node->pscan_len =
+		table_parallelscan_estimate(node->ss.ss_currentRelation,
+									estate->es_snapshot);
 	shm_toc_estimate_chunk(&pcxt->estimator, node->pscan_len);
 	shm_toc_estimate_keys(&pcxt->estimator, 1);
 }
@@ -308,7 +296,7 @@ ExecSeqScanEstimate(SeqScanState *node,
 /* ----------------------------------------------------------------
  *		ExecSeqScanInitializeDSM
  *
- *		Set up a parallel heap scan descriptor.
+ *		Set up a parallel table scan descriptor.
  * ----------------------------------------------------------------
  */
 void
@@ -316,15 +304,15 @@ ExecSeqScanInitializeDSM(SeqScanState *node,
 						 ParallelContext *pcxt)
 {
 	EState	   *estate = node->ss.ps.state;
-	ParallelHeapScanDesc	pscan;
+	ParallelTableScanDesc pscan;
 
 	pscan = shm_toc_allocate(pcxt->toc, node->pscan_len);
-	heap_parallelscan_initialize(pscan,
-								 node->ss.ss_currentRelation,
-								 estate->es_snapshot);
+	table_parallelscan_initialize(node->ss.ss_currentRelation,
+								  pscan,
+								  estate->es_snapshot);
 	shm_toc_insert(pcxt->toc, node->ss.ps.plan->plan_node_id, pscan);
-	node->ss.ss_currentScanDesc =
-		heap_beginscan_parallel(node->ss.ss_currentRelation, pscan);
+	node->scandesc =
+		table_beginscan_parallel(node->ss.ss_currentRelation, pscan);
 }
 
 /* ----------------------------------------------------------------
@@ -336,9 +324,9 @@ ExecSeqScanInitializeDSM(SeqScanState *node,
 void
 ExecSeqScanInitializeWorker(SeqScanState *node, shm_toc *toc)
 {
-	ParallelHeapScanDesc	pscan;
+	ParallelTableScanDesc pscan;
 
 	pscan = shm_toc_lookup(toc, node->ss.ps.plan->plan_node_id);
-	node->ss.ss_currentScanDesc =
-		heap_beginscan_parallel(node->ss.ss_currentRelation, pscan);
+	node->scandesc =
+		table_beginscan_parallel(node->ss.ss_currentRelation, pscan);
 }
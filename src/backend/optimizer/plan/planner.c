@@ -21,6 +21,7 @@
 #include "access/htup_details.h"
 #include "access/parallel.h"
 #include "access/sysattr.h"
+#include "access/tableam.h"
 #include "access/xact.h"
 #include "catalog/pg_constraint_fn.h"
 #include "executor/executor.h"
@@ -2200,6 +2201,25 @@ select_rowmark_type(RangeTblEntry *rte, LockClauseStrength strength)
 				 */
 				if (rte->securityQuals != NIL)
 					return ROW_MARK_COPY;
+
+				/*
+				 * EvalPlanQual re-fetches the row by TID straight from the
+				 * heap, so tables using other access methods need a copy of
+				 * the row instead.
+				 */
+				if (rte->relkind == RELKIND_RELATION)
+				{
+					Relation	rel;
+					bool		uses_heap;
+
+					/* parser already locked the table */
+					rel = heap_open(rte->relid, NoLock);
+					uses_heap = RelationUsesHeapAm(rel);
+					heap_close(rel, NoLock);
+
+					if (!uses_heap)
+						return ROW_MARK_COPY;
+				}
 				return ROW_MARK_REFERENCE;
 				break;
 			case LCS_FORKEYSHARE:
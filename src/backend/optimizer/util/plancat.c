@@ -22,6 +22,7 @@
 #include "access/htup_details.h"
 #include "access/nbtree.h"
 #include "access/sysattr.h"
+#include "access/tableam.h"
 #include "access/transam.h"
 #include "access/xlog.h"
 #include "catalog/catalog.h"
@@ -136,6 +137,11 @@ get_relation_info(PlannerInfo *root, Oid relationObjectId, bool inhparent,
 	/* Retrive the parallel_degree reloption, if set. */
 	rel->rel_parallel_degree = RelationGetParallelDegree(relation, -1);
 
+	/* Parallel scans also need support from the table access method. */
+	if (relation->rd_tableam != NULL &&
+		relation->rd_tableam->parallelscan_estimate == NULL)
+		rel->rel_parallel_degree = 0;
+
 	/*
 	 * Make list of indexes.  Ignore indexes on system catalogs if told to.
 	 * Don't bother with indexes for an inheritance parent, either.
@@ -878,6 +884,8 @@ infer_collation_opclass_match(InferenceElem *elem, Relation idxRel,
  * If attr_widths isn't NULL, it points to the zero-index entry of the
  * relation's attr_widths[] cache; we fill this in if we have need to compute
  * the attribute widths for estimation purposes.
+ *
+ * Tables whose access method provides its own estimate use that instead.
  */
 void
 estimate_rel_size(Relation rel, int32 *attr_widths,
@@ -889,6 +897,14 @@ estimate_rel_size(Relation rel, int32 *attr_widths,
 	BlockNumber relallvisible;
 	double		density;
 
+	if (rel->rd_tableam != NULL &&
+		rel->rd_tableam->relation_estimate_size != NULL)
+	{
+		rel->rd_tableam->relation_estimate_size(rel, attr_widths, pages,
+												tuples, allvisfrac);
+		return;
+	}
+
 	switch (rel->rd_rel->relkind)
 	{
 		case RELKIND_RELATION:
@@ -50,6 +50,13 @@
  * there is a window (caused by pgstat delay) on which a worker may choose a
  * table that was already vacuumed; this is a bug in the current design.
  *
+ * Within a database, the worker processes the tables it has selected in
+ * order of urgency: tables that must be vacuumed to prevent wraparound come
+ * first, and the rest are sorted by how far past their vacuum or analyze
+ * threshold they are, or how close to the freeze limits.  All workers in a
+ * database compute the same ordering, so concurrent workers naturally work
+ * their way down the same list, skipping tables another worker is busy on.
+ *
  * Portions Copyright (c) 1996-2016, PostgreSQL Global Development Group
  * Portions Copyright (c) 1994, Regents of the University of California
  *
@@ -113,6 +120,8 @@ int			autovacuum_work_mem = -1;
 int			autovacuum_naptime;
 int			autovacuum_vac_thresh;
 double		autovacuum_vac_scale;
+int			autovacuum_vac_ins_thresh;
+double		autovacuum_vac_ins_scale;
 int			autovacuum_anl_thresh;
 double		autovacuum_anl_scale;
 int			autovacuum_freeze_max_age;
@@ -181,6 +190,17 @@ typedef struct av_relation
 								 * reloptions, or NULL if none */
 } av_relation;
 
+/*
+ * struct to keep track of a table selected for processing in do_autovacuum,
+ * with the priority it is to be processed with
+ */
+typedef struct av_candidate
+{
+	Oid			ac_relid;
+	bool		ac_wraparound;	/* vacuum is needed to prevent wraparound */
+	double		ac_score;		/* higher is more urgent */
+} av_candidate;
+
 /* struct to keep track of tables to vacuum and/or analyze, after rechecking */
 typedef struct autovac_table
 {
@@ -292,6 +312,10 @@ static void launch_worker(TimestampTz now);
 static List *get_database_list(void);
 static void rebuild_database_list(Oid newdb);
 static int	db_comparator(const void *a, const void *b);
+static int	candidate_comparator(const void *a, const void *b);
+static void add_candidate(av_candidate **candidates, int *ncandidates,
+			  int *maxcandidates, Oid relid, bool wraparound,
+			  double score);
 static void autovac_balance_cost(void);
 
 static void do_autovacuum(void);
@@ -304,15 +328,13 @@ static void relation_needs_vacanalyze(Oid relid, AutoVacOpts *relopts,
 						  Form_pg_class classForm,
 						  PgStat_StatTabEntry *tabentry,
 						  int effective_multixact_freeze_max_age,
-						  bool *dovacuum, bool *doanalyze, bool *wraparound);
+						  bool *dovacuum, bool *doanalyze, bool *wraparound,
+						  double *score);
 
 static void autovacuum_do_vac_analyze(autovac_table *tab,
 						  BufferAccessStrategy bstrategy);
 static AutoVacOpts *extract_autovac_opts(HeapTuple tup,
 					 TupleDesc pg_class_desc);
-static PgStat_StatTabEntry *get_pgstat_tabentry_relid(Oid relid, bool isshared,
-						  PgStat_StatDBEntry *shared,
-						  PgStat_StatDBEntry *dbentry);
 static void autovac_report_activity(autovac_table *tab);
 static void av_sighup_handler(SIGNAL_ARGS);
 static void avl_sigusr2_handler(SIGNAL_ARGS);
@@ -1063,6 +1085,48 @@ db_comparator(const void *a, const void *b)
 		return (((const avl_dbase *) a)->adl_score < ((const avl_dbase *) b)->adl_score) ? 1 : -1;
 }
 
+/*
+ * qsort comparator for av_candidate: tables in danger of wraparound first,
+ * then by descending score.  Ties are broken by OID to keep the order the
+ * same in all workers.
+ */
+static int
+candidate_comparator(const void *a, const void *b)
+{
+	const av_candidate *ca = (const av_candidate *) a;
+	const av_candidate *cb = (const av_candidate *) b;
+
+	if (ca->ac_wraparound != cb->ac_wraparound)
+		return ca->ac_wraparound ? -1 : 1;
+	if (ca->ac_score != cb->ac_score)
+		return (ca->ac_score > cb->ac_score) ? -1 : 1;
+	if (ca->ac_relid != cb->ac_relid)
+		return (ca->ac_relid < cb->ac_relid) ? -1 : 1;
+	return 0;
+}
+
+/*
+ * Append a table to the array of candidates of do_autovacuum, enlarging it
+ * as needed.
+ */
+static void
+add_candidate(av_candidate **candidates, int *ncandidates,
+			  int *maxcandidates, Oid relid, bool wraparound, double score)
+{
+	av_candidate *cand;
+
+	if (*ncandidates >= *maxcandidates)
+	{
+		*maxcandidates *= 2;
+		*candidates = (av_candidate *)
+			repalloc(*candidates, *maxcandidates * sizeof(av_candidate));
+	}
+	cand = &(*candidates)[(*ncandidates)++];
+	cand->ac_relid = relid;
+	cand->ac_wraparound = wraparound;
+	cand->ac_score = score;
+}
+
 /*
  * do_start_worker
  *
@@ -1885,11 +1949,13 @@ do_autovacuum(void)
 	HeapScanDesc relScan;
 	Form_pg_database dbForm;
 	List	   *table_oids = NIL;
+	av_candidate *candidates;
+	int			ncandidates = 0;
+	int			maxcandidates = 64;
+	int			i;
 	HASHCTL		ctl;
 	HTAB	   *table_toast_map;
 	ListCell   *volatile cell;
-	PgStat_StatDBEntry *shared;
-	PgStat_StatDBEntry *dbentry;
 	BufferAccessStrategy bstrategy;
 	ScanKeyData key;
 	TupleDesc	pg_class_desc;
@@ -1907,12 +1973,6 @@ do_autovacuum(void)
 										  ALLOCSET_DEFAULT_MAXSIZE);
 	MemoryContextSwitchTo(AutovacMemCxt);
 
-	/*
-	 * may be NULL if we couldn't find an entry (only happens if we are
-	 * forcing a vacuum for anti-wrap purposes).
-	 */
-	dbentry = pgstat_fetch_stat_dbentry(MyDatabaseId);
-
 	/* Start a transaction so our commands have one to play into. */
 	StartTransactionCommand();
 
@@ -1960,9 +2020,6 @@ do_autovacuum(void)
 	/* StartTransactionCommand changed elsewhere */
 	MemoryContextSwitchTo(AutovacMemCxt);
 
-	/* The database hash where pgstat keeps shared relations */
-	shared = pgstat_fetch_stat_dbentry(InvalidOid);
-
 	classRel = heap_open(RelationRelationId, AccessShareLock);
 
 	/* create a copy so we can use it after closing pg_class */
@@ -1978,6 +2035,8 @@ do_autovacuum(void)
 								  &ctl,
 								  HASH_ELEM | HASH_BLOBS);
 
+	candidates = (av_candidate *) palloc(maxcandidates * sizeof(av_candidate));
+
 	/*
 	 * Scan pg_class to determine which tables to vacuum.
 	 *
@@ -2007,6 +2066,7 @@ do_autovacuum(void)
 		bool		dovacuum;
 		bool		doanalyze;
 		bool		wraparound;
+		double		score;
 
 		if (classForm->relkind != RELKIND_RELATION &&
 			classForm->relkind != RELKIND_MATVIEW)
@@ -2016,13 +2076,13 @@ do_autovacuum(void)
 
 		/* Fetch reloptions and the pgstat entry for this table */
 		relopts = extract_autovac_opts(tuple, pg_class_desc);
-		tabentry = get_pgstat_tabentry_relid(relid, classForm->relisshared,
-											 shared, dbentry);
+		tabentry = pgstat_fetch_stat_tabentry_extended(classForm->relisshared,
+													   relid);
 
 		/* Check if it needs vacuum or analyze */
 		relation_needs_vacanalyze(relid, relopts, classForm, tabentry,
 								  effective_multixact_freeze_max_age,
-								  &dovacuum, &doanalyze, &wraparound);
+								  &dovacuum, &doanalyze, &wraparound, &score);
 
 		/*
 		 * Check if it is a temp table (presumably, of some other backend's).
@@ -2069,9 +2129,10 @@ do_autovacuum(void)
 		}
 		else
 		{
-			/* relations that need work are added to table_oids */
+			/* relations that need work are added to the candidates */
 			if (dovacuum || doanalyze)
-				table_oids = lappend_oid(table_oids, relid);
+				add_candidate(&candidates, &ncandidates, &maxcandidates,
+							  relid, wraparound, score);
 
 			/*
 			 * Remember the association for the second pass.  Note: we must do
@@ -2121,6 +2182,7 @@ do_autovacuum(void)
 		bool		dovacuum;
 		bool		doanalyze;
 		bool		wraparound;
+		double		score;
 
 		/*
 		 * We cannot safely process other backends' temp tables, so skip 'em.
@@ -2146,21 +2208,36 @@ do_autovacuum(void)
 		}
 
 		/* Fetch the pgstat entry for this table */
-		tabentry = get_pgstat_tabentry_relid(relid, classForm->relisshared,
-											 shared, dbentry);
+		tabentry = pgstat_fetch_stat_tabentry_extended(classForm->relisshared,
+													   relid);
 
 		relation_needs_vacanalyze(relid, relopts, classForm, tabentry,
 								  effective_multixact_freeze_max_age,
-								  &dovacuum, &doanalyze, &wraparound);
+								  &dovacuum, &doanalyze, &wraparound, &score);
 
 		/* ignore analyze for toast tables */
 		if (dovacuum)
-			table_oids = lappend_oid(table_oids, relid);
+			add_candidate(&candidates, &ncandidates, &maxcandidates,
+						  relid, wraparound, score);
 	}
 
 	heap_endscan(relScan);
 	heap_close(classRel, AccessShareLock);
 
+	/*
+	 * Sort the collected tables so that the most urgent ones are processed
+	 * first.  A worker may not get through the whole list before it is asked
+	 * to shut down, or before the tables at the end of it are handled by
+	 * other workers, so it matters that the tables we get to are the ones
+	 * that need it most.
+	 */
+	if (ncandidates > 1)
+		qsort(candidates, ncandidates, sizeof(av_candidate),
+			  candidate_comparator);
+	for (i = 0; i < ncandidates; i++)
+		table_oids = lappend_oid(table_oids, candidates[i].ac_relid);
+	pfree(candidates);
+
 	/*
 	 * Create a buffer access strategy object for VACUUM to use.  We want to
 	 * use the same one across all the vacuum operations we perform, since the
@@ -2431,30 +2508,6 @@ extract_autovac_opts(HeapTuple tup, TupleDesc pg_class_desc)
 	return av;
 }
 
-/*
- * get_pgstat_tabentry_relid
- *
- * Fetch the pgstat entry of a table, either local to a database or shared.
- */
-static PgStat_StatTabEntry *
-get_pgstat_tabentry_relid(Oid relid, bool isshared, PgStat_StatDBEntry *shared,
-						  PgStat_StatDBEntry *dbentry)
-{
-	PgStat_StatTabEntry *tabentry = NULL;
-
-	if (isshared)
-	{
-		if (PointerIsValid(shared))
-			tabentry = hash_search(shared->tables, &relid,
-								   HASH_FIND, NULL);
-	}
-	else if (PointerIsValid(dbentry))
-		tabentry = hash_search(dbentry->tables, &relid,
-							   HASH_FIND, NULL);
-
-	return tabentry;
-}
-
 /*
  * table_recheck_autovac
  *
@@ -2474,17 +2527,13 @@ table_recheck_autovac(Oid relid, HTAB *table_toast_map,
 	bool		doanalyze;
 	autovac_table *tab = NULL;
 	PgStat_StatTabEntry *tabentry;
-	PgStat_StatDBEntry *shared;
-	PgStat_StatDBEntry *dbentry;
 	bool		wraparound;
+	double		score;
 	AutoVacOpts *avopts;
 
 	/* use fresh stats */
 	autovac_refresh_stats();
 
-	shared = pgstat_fetch_stat_dbentry(InvalidOid);
-	dbentry = pgstat_fetch_stat_dbentry(MyDatabaseId);
-
 	/* fetch the relation's relcache entry */
 	classTup = SearchSysCacheCopy1(RELOID, ObjectIdGetDatum(relid));
 	if (!HeapTupleIsValid(classTup))
@@ -2508,12 +2557,12 @@ table_recheck_autovac(Oid relid, HTAB *table_toast_map,
 	}
 
 	/* fetch the pgstat table entry */
-	tabentry = get_pgstat_tabentry_relid(relid, classForm->relisshared,
-										 shared, dbentry);
+	tabentry = pgstat_fetch_stat_tabentry_extended(classForm->relisshared,
+												   relid);
 
 	relation_needs_vacanalyze(relid, avopts, classForm, tabentry,
 							  effective_multixact_freeze_max_age,
-							  &dovacuum, &doanalyze, &wraparound);
+							  &dovacuum, &doanalyze, &wraparound, &score);
 
 	/* ignore ANALYZE for toast tables */
 	if (classForm->relkind == RELKIND_TOASTVALUE)
@@ -2612,7 +2661,9 @@ table_recheck_autovac(Oid relid, HTAB *table_toast_map,
  *
  * Check whether a relation needs to be vacuumed or analyzed; return each into
  * "dovacuum" and "doanalyze", respectively.  Also return whether the vacuum is
- * being forced because of Xid or multixact wraparound.
+ * being forced because of Xid or multixact wraparound, and a "score" telling
+ * how urgently the relation needs attention, used to decide the order in
+ * which to process relations.
  *
  * relopts is a pointer to the AutoVacOpts options (either for itself in the
  * case of a plain table, or for either itself or its parent table in the case
@@ -2624,6 +2675,14 @@ table_recheck_autovac(Oid relid, HTAB *table_toast_map,
  *
  * threshold = vac_base_thresh + vac_scale_factor * reltuples
  *
+ * A table is also vacuumed if the number of tuples inserted since the last
+ * vacuum exceeds a threshold calculated in the same fashion from
+ * vac_ins_base_thresh and vac_ins_scale_factor.  Insert-only tables never
+ * accumulate dead tuples, but vacuuming them is still worthwhile to set
+ * their pages all-visible for index-only scans, and to freeze them a bit at
+ * a time rather than all at once in an anti-wraparound vacuum.  This can be
+ * disabled by setting vac_ins_base_thresh to -1.
+ *
  * For analyze, the analysis done is that the number of tuples inserted,
  * deleted and updated since the last analyze exceeds a threshold calculated
  * in the same fashion as above.  Note that the collector actually stores
@@ -2642,7 +2701,18 @@ table_recheck_autovac(Oid relid, HTAB *table_toast_map,
  * A table whose vac_base_thresh value is < 0 takes the base value from the
  * autovacuum_vacuum_threshold GUC variable.  Similarly, a vac_scale_factor
  * value < 0 is substituted with the value of
- * autovacuum_vacuum_scale_factor GUC variable.  Ditto for analyze.
+ * autovacuum_vacuum_scale_factor GUC variable.  Ditto for the insert
+ * thresholds, for which -2 means to use the GUC variables, and for analyze.
+ *
+ * The score is the largest of the ratios of the dead, inserted and changed
+ * tuple counts to their respective thresholds, and of the relfrozenxid and
+ * relminmxid ages to freeze_max_age and multixact_freeze_max_age.  So a
+ * score above 1 means that something is due, and a table with twice as many
+ * dead tuples as its threshold allows ranks above one that is just past its
+ * threshold.  The freeze ages stay below 1 until the anti-wraparound vacuum
+ * is forced, so before that they only matter for tables with little else to
+ * do; once it is forced, candidate_comparator puts the table ahead of all
+ * those that aren't, whatever their scores.
  */
 static void
 relation_needs_vacanalyze(Oid relid,
@@ -2653,7 +2723,8 @@ relation_needs_vacanalyze(Oid relid,
  /* output params below */
 						  bool *dovacuum,
 						  bool *doanalyze,
-						  bool *wraparound)
+						  bool *wraparound,
+						  double *score)
 {
 	bool		force_vacuum;
 	bool		av_enabled;
@@ -2661,16 +2732,20 @@ relation_needs_vacanalyze(Oid relid,
 
 	/* constants from reloptions or GUC variables */
 	int			vac_base_thresh,
+				vac_ins_base_thresh,
 				anl_base_thresh;
 	float4		vac_scale_factor,
+				vac_ins_scale_factor,
 				anl_scale_factor;
 
 	/* thresholds calculated from above constants */
 	float4		vacthresh,
+				vacinsthresh,
 				anlthresh;
 
 	/* number of vacuum (resp. analyze) tuples at this time */
 	float4		vactuples,
+				instuples,
 				anltuples;
 
 	/* freeze parameters */
@@ -2697,6 +2772,15 @@ relation_needs_vacanalyze(Oid relid,
 		? relopts->vacuum_threshold
 		: autovacuum_vac_thresh;
 
+	vac_ins_scale_factor = (relopts && relopts->vacuum_ins_scale_factor >= 0)
+		? relopts->vacuum_ins_scale_factor
+		: autovacuum_vac_ins_scale;
+
+	/* -1 is a valid value here, it disables insert-driven vacuums */
+	vac_ins_base_thresh = (relopts && relopts->vacuum_ins_threshold >= -1)
+		? relopts->vacuum_ins_threshold
+		: autovacuum_vac_ins_thresh;
+
 	anl_scale_factor = (relopts && relopts->analyze_scale_factor >= 0)
 		? relopts->analyze_scale_factor
 		: autovacuum_anl_scale;
@@ -2732,6 +2816,15 @@ relation_needs_vacanalyze(Oid relid,
 	}
 	*wraparound = force_vacuum;
 
+	/* Score relation by its freeze ages; more is added below */
+	*score = 0;
+	if (TransactionIdIsNormal(classForm->relfrozenxid))
+		*score = Max(*score, (double) (recentXid - classForm->relfrozenxid) /
+					 Max(freeze_max_age, 1));
+	if (MultiXactIdIsValid(classForm->relminmxid))
+		*score = Max(*score, (double) (recentMulti - classForm->relminmxid) /
+					 Max(multixact_freeze_max_age, 1));
+
 	/* User disabled it in pg_class.reloptions?  (But ignore if at risk) */
 	if (!av_enabled && !force_vacuum)
 	{
@@ -2751,9 +2844,11 @@ relation_needs_vacanalyze(Oid relid,
 	{
 		reltuples = classForm->reltuples;
 		vactuples = tabentry->n_dead_tuples;
+		instuples = tabentry->inserts_since_vacuum;
 		anltuples = tabentry->changes_since_analyze;
 
 		vacthresh = (float4) vac_base_thresh + vac_scale_factor * reltuples;
+		vacinsthresh = (float4) vac_ins_base_thresh + vac_ins_scale_factor * reltuples;
 		anlthresh = (float4) anl_base_thresh + anl_scale_factor * reltuples;
 
 		/*
@@ -2761,13 +2856,26 @@ relation_needs_vacanalyze(Oid relid,
 		 * reset, because if that happens, the last vacuum and analyze counts
 		 * will be reset too.
 		 */
-		elog(DEBUG3, "%s: vac: %.0f (threshold %.0f), anl: %.0f (threshold %.0f)",
-			 NameStr(classForm->relname),
-			 vactuples, vacthresh, anltuples, anlthresh);
+		if (vac_ins_base_thresh >= 0)
+			elog(DEBUG3, "%s: vac: %.0f (threshold %.0f), ins: %.0f (threshold %.0f), anl: %.0f (threshold %.0f)",
+				 NameStr(classForm->relname),
+				 vactuples, vacthresh, instuples, vacinsthresh,
+				 anltuples, anlthresh);
+		else
+			elog(DEBUG3, "%s: vac: %.0f (threshold %.0f), ins: (disabled), anl: %.0f (threshold %.0f)",
+				 NameStr(classForm->relname),
+				 vactuples, vacthresh, anltuples, anlthresh);
 
 		/* Determine if this table needs vacuum or analyze. */
-		*dovacuum = force_vacuum || (vactuples > vacthresh);
+		*dovacuum = force_vacuum || (vactuples > vacthresh) ||
+			(vac_ins_base_thresh >= 0 && instuples > vacinsthresh);
 		*doanalyze = (anltuples > anlthresh);
+
+		*score = Max(*score, vactuples / Max(vacthresh, 1));
+		if (vac_ins_base_thresh >= 0)
+			*score = Max(*score, instuples / Max(vacinsthresh, 1));
+		if (*doanalyze)
+			*score = Max(*score, anltuples / Max(anlthresh, 1));
 	}
 	else
 	{
@@ -398,6 +398,8 @@ CheckpointerMain(void)
 			ExitOnAnyError = true;
 			/* Close down the database */
 			ShutdownXLOG(0, 0);
+			/* Save table statistics for the next startup */
+			pgstat_save_table_stats();
 			/* Normal exit from the checkpointer is here */
 			proc_exit(0);		/* done */
 		}
@@ -54,8 +54,10 @@
 #include "storage/ipc.h"
 #include "storage/latch.h"
 #include "storage/lmgr.h"
+#include "storage/lwlock.h"
 #include "storage/pg_shmem.h"
 #include "storage/procsignal.h"
+#include "storage/shmem.h"
 #include "storage/sinvaladt.h"
 #include "utils/ascii.h"
 #include "utils/guc.h"
@@ -108,6 +110,7 @@ bool		pgstat_track_activities = false;
 bool		pgstat_track_counts = false;
 int			pgstat_track_functions = TRACK_FUNC_OFF;
 int			pgstat_track_activity_query_size = 1024;
+int			pgstat_track_counts_max_relations = 100000;
 
 /* ----------
  * Built from GUC parameter
@@ -136,6 +139,46 @@ static time_t last_pgstat_start_time;
 
 static bool pgStatRunningInCollector = false;
 
+/*
+ * Per-table statistics are kept in a hash table in shared memory, keyed by
+ * database and table OID (the database is InvalidOid for shared relations).
+ * Backends add their counts to it directly in pgstat_report_stat(), and
+ * VACUUM and ANALYZE update it in place, so there's no need to go through
+ * the collector and its stats files to read or write them.  The hash is
+ * partitioned the same way as the lock manager's tables, so that backends
+ * flushing counts for different tables seldom block each other.  Its size
+ * is fixed at postmaster start by track_counts_max_relations.  When it is
+ * full, entries that autovacuum has no use for are evicted to make room, see
+ * pgstat_evict_tabentries().
+ *
+ * The collector still keeps database-wide totals, function, bgwriter and
+ * archiver statistics.
+ */
+typedef struct PgStat_TabHashKey
+{
+	Oid			databaseid;		/* database, or InvalidOid if shared */
+	Oid			tableid;		/* table OID */
+} PgStat_TabHashKey;
+
+typedef struct PgStat_TabHashEntry
+{
+	PgStat_TabHashKey key;		/* hash key --- MUST BE FIRST */
+	PgStat_StatTabEntry stats;
+} PgStat_TabHashEntry;
+
+static HTAB *pgStatTabHash = NULL;
+
+#define PgStatTabHashPartition(hashcode) \
+	((hashcode) % NUM_PGSTAT_PARTITIONS)
+#define PgStatTabPartitionLock(hashcode) \
+	(&MainLWLockArray[PGSTAT_TABLES_LWLOCK_OFFSET + \
+		PgStatTabHashPartition(hashcode)].lock)
+#define PgStatTabPartitionLockByIndex(i) \
+	(&MainLWLockArray[PGSTAT_TABLES_LWLOCK_OFFSET + (i)].lock)
+
+/* Have we already complained about the shared hash being full? */
+static bool pgStatTabHashFullReported = false;
+
 /*
  * Structures in which backends store per-table info that's waiting to be
  * sent to the collector.
@@ -205,11 +248,24 @@ typedef struct TwoPhasePgStatRecord
 	bool		t_truncated;	/* was the relation truncated? */
 } TwoPhasePgStatRecord;
 
+/*
+ * Entry of the local copy of table statistics taken from the shared hash.
+ * We remember tables that weren't found, too, so that repeated lookups give
+ * the same answer for the rest of the transaction.
+ */
+typedef struct PgStat_TabSnapshotEntry
+{
+	PgStat_TabHashKey key;		/* hash key --- MUST BE FIRST */
+	bool		found;			/* was there an entry in the shared hash? */
+	PgStat_StatTabEntry stats;
+} PgStat_TabSnapshotEntry;
+
 /*
  * Info about current "snapshot" of stats file
  */
 static MemoryContext pgStatLocalContext = NULL;
 static HTAB *pgStatDBHash = NULL;
+static HTAB *pgStatTabSnapshot = NULL;
 static LocalPgBackendStatus *localBackendStatusTable = NULL;
 static int	localNumBackends = 0;
 
@@ -257,18 +313,24 @@ static void pgstat_beshutdown_hook(int code, Datum arg);
 static void pgstat_sighup_handler(SIGNAL_ARGS);
 
 static PgStat_StatDBEntry *pgstat_get_db_entry(Oid databaseid, bool create);
-static PgStat_StatTabEntry *pgstat_get_tab_entry(PgStat_StatDBEntry *dbentry,
-					 Oid tableoid, bool create);
+static PgStat_StatTabEntry *pgstat_lock_tab_entry(Oid databaseid, Oid tableoid,
+					  LWLock **partitionLock);
+static bool pgstat_evict_tabentries(void);
+static void pgstat_remove_tabentries(Oid databaseid, bool alldbs, HTAB *keep);
+static void pgstat_remove_tabentry(Oid databaseid, Oid tableoid);
+static void pgstat_restore_table_stats(void);
 static void pgstat_write_statsfiles(bool permanent, bool allDbs);
 static void pgstat_write_db_statsfile(PgStat_StatDBEntry *dbentry, bool permanent);
 static HTAB *pgstat_read_statsfiles(Oid onlydb, bool permanent, bool deep);
-static void pgstat_read_db_statsfile(Oid databaseid, HTAB *tabhash, HTAB *funchash, bool permanent);
+static void pgstat_read_db_statsfile(Oid databaseid, HTAB *funchash, bool permanent);
 static void backend_read_statsfile(void);
 static void pgstat_read_current_status(void);
 
 static bool pgstat_write_statsfile_needed(void);
 static bool pgstat_db_requested(Oid databaseid);
 
+static void pgstat_flush_tabstat(PgStat_TableStatus *entry,
+					 PgStat_MsgTabstat *tsmsg);
 static void pgstat_send_tabstat(PgStat_MsgTabstat *tsmsg);
 static void pgstat_send_funcstats(void);
 static HTAB *pgstat_collect_oids(Oid catalogid);
@@ -282,14 +344,11 @@ static void pgstat_send(void *msg, int len);
 
 static void pgstat_recv_inquiry(PgStat_MsgInquiry *msg, int len);
 static void pgstat_recv_tabstat(PgStat_MsgTabstat *msg, int len);
-static void pgstat_recv_tabpurge(PgStat_MsgTabpurge *msg, int len);
 static void pgstat_recv_dropdb(PgStat_MsgDropdb *msg, int len);
 static void pgstat_recv_resetcounter(PgStat_MsgResetcounter *msg, int len);
 static void pgstat_recv_resetsharedcounter(PgStat_MsgResetsharedcounter *msg, int len);
 static void pgstat_recv_resetsinglecounter(PgStat_MsgResetsinglecounter *msg, int len);
 static void pgstat_recv_autovac(PgStat_MsgAutovacStart *msg, int len);
-static void pgstat_recv_vacuum(PgStat_MsgVacuum *msg, int len);
-static void pgstat_recv_analyze(PgStat_MsgAnalyze *msg, int len);
 static void pgstat_recv_archiver(PgStat_MsgArchiver *msg, int len);
 static void pgstat_recv_bgwriter(PgStat_MsgBgWriter *msg, int len);
 static void pgstat_recv_funcstat(PgStat_MsgFuncstat *msg, int len);
@@ -584,6 +643,8 @@ pgstat_reset_remove_files(const char *directory)
 		 */
 		if (strncmp(entry->d_name, "global.", 7) == 0)
 			nchars = 7;
+		else if (strncmp(entry->d_name, "tables.", 7) == 0)
+			nchars = 7;
 		else
 		{
 			nchars = 0;
@@ -610,14 +671,18 @@ pgstat_reset_remove_files(const char *directory)
 /*
  * pgstat_reset_all() -
  *
- * Remove the stats files.  This is currently used only if WAL
- * recovery is needed after a crash.
+ * Remove the stats files, and forget the table statistics in shared
+ * memory.  This is currently used only if WAL recovery is needed after
+ * a crash.
  */
 void
 pgstat_reset_all(void)
 {
 	pgstat_reset_remove_files(pgstat_stat_directory);
 	pgstat_reset_remove_files(PGSTAT_STAT_PERMANENT_DIRECTORY);
+
+	if (pgStatTabHash != NULL)
+		pgstat_remove_tabentries(InvalidOid, true, NULL);
 }
 
 #ifdef EXEC_BACKEND
@@ -749,6 +814,8 @@ pgstat_report_stat(bool force)
 	TimestampTz now;
 	PgStat_MsgTabstat regular_msg;
 	PgStat_MsgTabstat shared_msg;
+	int			nregular = 0;
+	int			nshared = 0;
 	TabStatusArray *tsa;
 	int			i;
 
@@ -770,22 +837,21 @@ pgstat_report_stat(bool force)
 
 	/*
 	 * Scan through the TabStatusArray struct(s) to find tables that actually
-	 * have counts, and build messages to send.  We have to separate shared
+	 * have counts, and add them to the shared table statistics.  The totals
+	 * for the database go to the collector.  We have to separate shared
 	 * relations from regular ones because the databaseid field in the message
 	 * header has to depend on that.
 	 */
+	MemSet(&regular_msg, 0, sizeof(regular_msg));
+	MemSet(&shared_msg, 0, sizeof(shared_msg));
 	regular_msg.m_databaseid = MyDatabaseId;
 	shared_msg.m_databaseid = InvalidOid;
-	regular_msg.m_nentries = 0;
-	shared_msg.m_nentries = 0;
 
 	for (tsa = pgStatTabList; tsa != NULL; tsa = tsa->tsa_next)
 	{
 		for (i = 0; i < tsa->tsa_used; i++)
 		{
 			PgStat_TableStatus *entry = &tsa->tsa_entries[i];
-			PgStat_MsgTabstat *this_msg;
-			PgStat_TableEntry *this_ent;
 
 			/* Shouldn't have any pending transaction-dependent counts */
 			Assert(entry->trans == NULL);
@@ -799,17 +865,18 @@ pgstat_report_stat(bool force)
 				continue;
 
 			/*
-			 * OK, insert data into the appropriate message, and send if full.
+			 * OK, add the counts to the shared entry and to the appropriate
+			 * message.
 			 */
-			this_msg = entry->t_shared ? &shared_msg : &regular_msg;
-			this_ent = &this_msg->m_entry[this_msg->m_nentries];
-			this_ent->t_id = entry->t_id;
-			memcpy(&this_ent->t_counts, &entry->t_counts,
-				   sizeof(PgStat_TableCounts));
-			if (++this_msg->m_nentries >= PGSTAT_NUM_TABENTRIES)
+			if (entry->t_shared)
 			{
-				pgstat_send_tabstat(this_msg);
-				this_msg->m_nentries = 0;
+				pgstat_flush_tabstat(entry, &shared_msg);
+				nshared++;
+			}
+			else
+			{
+				pgstat_flush_tabstat(entry, &regular_msg);
+				nregular++;
 			}
 		}
 		/* zero out TableStatus structs after use */
@@ -819,28 +886,83 @@ pgstat_report_stat(bool force)
 	}
 
 	/*
-	 * Send partial messages.  Make sure that any pending xact commit/abort
+	 * Send the database totals.  Make sure that any pending xact commit/abort
 	 * gets counted, even if there are no table stats to send.
 	 */
-	if (regular_msg.m_nentries > 0 ||
+	if (nregular > 0 ||
 		pgStatXactCommit > 0 || pgStatXactRollback > 0)
 		pgstat_send_tabstat(&regular_msg);
-	if (shared_msg.m_nentries > 0)
+	if (nshared > 0)
 		pgstat_send_tabstat(&shared_msg);
 
 	/* Now, send function statistics */
 	pgstat_send_funcstats();
 }
 
+/*
+ * Subroutine for pgstat_report_stat: add one table's counts to its entry in
+ * the shared hash table, and to the database totals in *tsmsg.  If the hash
+ * table is full, the counts for the table are lost.
+ */
+static void
+pgstat_flush_tabstat(PgStat_TableStatus *entry, PgStat_MsgTabstat *tsmsg)
+{
+	PgStat_TableCounts *counts = &entry->t_counts;
+	PgStat_StatTabEntry *tabentry;
+	LWLock	   *partitionLock;
+
+	tabentry = pgstat_lock_tab_entry(tsmsg->m_databaseid, entry->t_id,
+									 &partitionLock);
+	if (tabentry != NULL)
+	{
+		tabentry->numscans += counts->t_numscans;
+		tabentry->tuples_returned += counts->t_tuples_returned;
+		tabentry->tuples_fetched += counts->t_tuples_fetched;
+		tabentry->tuples_inserted += counts->t_tuples_inserted;
+		tabentry->tuples_updated += counts->t_tuples_updated;
+		tabentry->tuples_deleted += counts->t_tuples_deleted;
+		tabentry->tuples_hot_updated += counts->t_tuples_hot_updated;
+		/* If table was truncated, first reset the live/dead counters */
+		if (counts->t_truncated)
+		{
+			tabentry->n_live_tuples = 0;
+			tabentry->n_dead_tuples = 0;
+			tabentry->inserts_since_vacuum = 0;
+		}
+		tabentry->n_live_tuples += counts->t_delta_live_tuples;
+		tabentry->n_dead_tuples += counts->t_delta_dead_tuples;
+		tabentry->changes_since_analyze += counts->t_changed_tuples;
+		tabentry->inserts_since_vacuum += counts->t_tuples_inserted;
+		tabentry->blocks_fetched += counts->t_blocks_fetched;
+		tabentry->blocks_hit += counts->t_blocks_hit;
+		tabentry->eager_frozen_pages += counts->t_eager_frozen_pages;
+
+		/* Clamp n_live_tuples in case of negative delta_live_tuples */
+		tabentry->n_live_tuples = Max(tabentry->n_live_tuples, 0);
+		/* Likewise for n_dead_tuples */
+		tabentry->n_dead_tuples = Max(tabentry->n_dead_tuples, 0);
+
+		LWLockRelease(partitionLock);
+	}
+
+	/*
+	 * Add per-table stats to the per-database totals, too.
+	 */
+	tsmsg->m_tuples_returned += counts->t_tuples_returned;
+	tsmsg->m_tuples_fetched += counts->t_tuples_fetched;
+	tsmsg->m_tuples_inserted += counts->t_tuples_inserted;
+	tsmsg->m_tuples_updated += counts->t_tuples_updated;
+	tsmsg->m_tuples_deleted += counts->t_tuples_deleted;
+	tsmsg->m_blocks_fetched += counts->t_blocks_fetched;
+	tsmsg->m_blocks_hit += counts->t_blocks_hit;
+}
+
 /*
  * Subroutine for pgstat_report_stat: finish and send a tabstat message
  */
 static void
 pgstat_send_tabstat(PgStat_MsgTabstat *tsmsg)
 {
-	int			n;
-	int			len;
-
 	/* It's unlikely we'd get here with no socket, but maybe not impossible */
 	if (pgStatSock == PGINVALID_SOCKET)
 		return;
@@ -868,12 +990,8 @@ pgstat_send_tabstat(PgStat_MsgTabstat *tsmsg)
 		tsmsg->m_block_write_time = 0;
 	}
 
-	n = tsmsg->m_nentries;
-	len = offsetof(PgStat_MsgTabstat, m_entry[0]) +
-		n * sizeof(PgStat_TableEntry);
-
 	pgstat_setheader(&tsmsg->m_hdr, PGSTAT_MTYPE_TABSTAT);
-	pgstat_send(tsmsg, len);
+	pgstat_send(tsmsg, sizeof(PgStat_MsgTabstat));
 }
 
 /*
@@ -935,21 +1053,28 @@ pgstat_send_funcstats(void)
 /* ----------
  * pgstat_vacuum_stat() -
  *
- *	Will tell the collector about objects he can get rid of.
+ *	Remove the shared statistics of tables that no longer exist in our
+ *	database, and tell the collector about other objects he can get rid of.
  * ----------
  */
 void
 pgstat_vacuum_stat(void)
 {
 	HTAB	   *htab;
-	PgStat_MsgTabpurge msg;
 	PgStat_MsgFuncpurge f_msg;
 	HASH_SEQ_STATUS hstat;
 	PgStat_StatDBEntry *dbentry;
-	PgStat_StatTabEntry *tabentry;
 	PgStat_StatFuncEntry *funcentry;
 	int			len;
 
+	/*
+	 * Make a list of all known relations in this DB, and throw away the
+	 * table statistics of anything else.
+	 */
+	htab = pgstat_collect_oids(RelationRelationId);
+	pgstat_remove_tabentries(MyDatabaseId, false, htab);
+	hash_destroy(htab);
+
 	if (pgStatSock == PGINVALID_SOCKET)
 		return;
 
@@ -990,69 +1115,9 @@ pgstat_vacuum_stat(void)
 	dbentry = (PgStat_StatDBEntry *) hash_search(pgStatDBHash,
 												 (void *) &MyDatabaseId,
 												 HASH_FIND, NULL);
-	if (dbentry == NULL || dbentry->tables == NULL)
+	if (dbentry == NULL)
 		return;
 
-	/*
-	 * Similarly to above, make a list of all known relations in this DB.
-	 */
-	htab = pgstat_collect_oids(RelationRelationId);
-
-	/*
-	 * Initialize our messages table counter to zero
-	 */
-	msg.m_nentries = 0;
-
-	/*
-	 * Check for all tables listed in stats hashtable if they still exist.
-	 */
-	hash_seq_init(&hstat, dbentry->tables);
-	while ((tabentry = (PgStat_StatTabEntry *) hash_seq_search(&hstat)) != NULL)
-	{
-		Oid			tabid = tabentry->tableid;
-
-		CHECK_FOR_INTERRUPTS();
-
-		if (hash_search(htab, (void *) &tabid, HASH_FIND, NULL) != NULL)
-			continue;
-
-		/*
-		 * Not there, so add this table's Oid to the message
-		 */
-		msg.m_tableid[msg.m_nentries++] = tabid;
-
-		/*
-		 * If the message is full, send it out and reinitialize to empty
-		 */
-		if (msg.m_nentries >= PGSTAT_NUM_TABPURGE)
-		{
-			len = offsetof(PgStat_MsgTabpurge, m_tableid[0])
-				+msg.m_nentries * sizeof(Oid);
-
-			pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_TABPURGE);
-			msg.m_databaseid = MyDatabaseId;
-			pgstat_send(&msg, len);
-
-			msg.m_nentries = 0;
-		}
-	}
-
-	/*
-	 * Send the rest
-	 */
-	if (msg.m_nentries > 0)
-	{
-		len = offsetof(PgStat_MsgTabpurge, m_tableid[0])
-			+msg.m_nentries * sizeof(Oid);
-
-		pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_TABPURGE);
-		msg.m_databaseid = MyDatabaseId;
-		pgstat_send(&msg, len);
-	}
-
-	/* Clean up */
-	hash_destroy(htab);
-
 	/*
 	 * Now repeat the above steps for functions.  However, we needn't bother
 	 * in the common case where no function stats are being collected.
@@ -1161,7 +1226,8 @@ pgstat_collect_oids(Oid catalogid)
 /* ----------
  * pgstat_drop_database() -
  *
- *	Tell the collector that we just dropped a database.
+ *	Forget the statistics of the tables in a database we just dropped, and
+ *	tell the collector about it.
  *	(If the message gets lost, we will still clean the dead DB eventually
  *	via future invocations of pgstat_vacuum_stat().)
  * ----------
@@ -1171,6 +1237,8 @@ pgstat_drop_database(Oid databaseid)
 {
 	PgStat_MsgDropdb msg;
 
+	pgstat_remove_tabentries(databaseid, false, NULL);
+
 	if (pgStatSock == PGINVALID_SOCKET)
 		return;
 
@@ -1183,9 +1251,7 @@ pgstat_drop_database(Oid databaseid)
 /* ----------
  * pgstat_drop_relation() -
  *
- *	Tell the collector that we just dropped a relation.
- *	(If the message gets lost, we will still clean the dead entry eventually
- *	via future invocations of pgstat_vacuum_stat().)
+ *	Forget the statistics of a relation we just dropped.
  *
  *	Currently not used for lack of any good place to call it; we rely
  *	entirely on pgstat_vacuum_stat() to clean out stats for dead rels.
@@ -1195,20 +1261,7 @@ pgstat_drop_database(Oid databaseid)
 void
 pgstat_drop_relation(Oid relid)
 {
-	PgStat_MsgTabpurge msg;
-	int			len;
-
-	if (pgStatSock == PGINVALID_SOCKET)
-		return;
-
-	msg.m_tableid[0] = relid;
-	msg.m_nentries = 1;
-
-	len = offsetof(PgStat_MsgTabpurge, m_tableid[0]) +sizeof(Oid);
-
-	pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_TABPURGE);
-	msg.m_databaseid = MyDatabaseId;
-	pgstat_send(&msg, len);
+	pgstat_remove_tabentry(MyDatabaseId, relid);
 }
 #endif   /* NOT_USED */
 
@@ -1216,7 +1269,8 @@ pgstat_drop_relation(Oid relid)
 /* ----------
  * pgstat_reset_counters() -
  *
- *	Tell the statistics collector to reset counters for our database.
+ *	Reset the table statistics of our database, and tell the statistics
+ *	collector to reset the other counters.
  *
  *	Permission checking for this function is managed through the normal
  *	GRANT system.
@@ -1227,6 +1281,8 @@ pgstat_reset_counters(void)
 {
 	PgStat_MsgResetcounter msg;
 
+	pgstat_remove_tabentries(MyDatabaseId, false, NULL);
+
 	if (pgStatSock == PGINVALID_SOCKET)
 		return;
 
@@ -1249,6 +1305,13 @@ pgstat_reset_shared_counters(const char *target)
 {
 	PgStat_MsgResetsharedcounter msg;
 
+	/* LWLock counters live in shared memory, not in the collector */
+	if (strcmp(target, "lwlocks") == 0)
+	{
+		LWLockResetContentionStats();
+		return;
+	}
+
 	if (pgStatSock == PGINVALID_SOCKET)
 		return;
 
@@ -1260,7 +1323,7 @@ pgstat_reset_shared_counters(const char *target)
 		ereport(ERROR,
 				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
 				 errmsg("unrecognized reset target: \"%s\"", target),
-				 errhint("Target must be \"archiver\" or \"bgwriter\".")));
+				 errhint("Target must be \"archiver\", \"bgwriter\" or \"lwlocks\".")));
 
 	pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_RESETSHAREDCOUNTER);
 	pgstat_send(&msg, sizeof(msg));
@@ -1280,6 +1343,13 @@ pgstat_reset_single_counter(Oid objoid, PgStat_Single_Reset_Type type)
 {
 	PgStat_MsgResetsinglecounter msg;
 
+	/*
+	 * Table statistics are in shared memory; the collector only updates the
+	 * database's reset timestamp for them.
+	 */
+	if (type == RESET_TABLE)
+		pgstat_remove_tabentry(MyDatabaseId, objoid);
+
 	if (pgStatSock == PGINVALID_SOCKET)
 		return;
 
@@ -1318,41 +1388,65 @@ pgstat_report_autovac(Oid dboid)
 /* ---------
  * pgstat_report_vacuum() -
  *
- *	Tell the collector about the table we just vacuumed.
+ *	Record the results of the VACUUM we just did on a table.
  * ---------
  */
 void
 pgstat_report_vacuum(Oid tableoid, bool shared,
 					 PgStat_Counter livetuples, PgStat_Counter deadtuples)
 {
-	PgStat_MsgVacuum msg;
+	PgStat_StatTabEntry *tabentry;
+	LWLock	   *partitionLock;
+	TimestampTz now;
 
-	if (pgStatSock == PGINVALID_SOCKET || !pgstat_track_counts)
+	if (!pgstat_track_counts)
 		return;
 
-	pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_VACUUM);
-	msg.m_databaseid = shared ? InvalidOid : MyDatabaseId;
-	msg.m_tableoid = tableoid;
-	msg.m_autovacuum = IsAutoVacuumWorkerProcess();
-	msg.m_vacuumtime = GetCurrentTimestamp();
-	msg.m_live_tuples = livetuples;
-	msg.m_dead_tuples = deadtuples;
-	pgstat_send(&msg, sizeof(msg));
+	now = GetCurrentTimestamp();
+
+	tabentry = pgstat_lock_tab_entry(shared ? InvalidOid : MyDatabaseId,
+									 tableoid, &partitionLock);
+	if (tabentry == NULL)
+		return;
+
+	tabentry->n_live_tuples = livetuples;
+	tabentry->n_dead_tuples = deadtuples;
+
+	/*
+	 * Reset the insert counter; the pages the inserted tuples went to have
+	 * now been visited, and marked all-visible if possible.
+	 */
+	tabentry->inserts_since_vacuum = 0;
+
+	if (IsAutoVacuumWorkerProcess())
+	{
+		tabentry->autovac_vacuum_timestamp = now;
+		tabentry->autovac_vacuum_count++;
+	}
+	else
+	{
+		tabentry->vacuum_timestamp = now;
+		tabentry->vacuum_count++;
+	}
+
+	LWLockRelease(partitionLock);
 }
 
 /* --------
  * pgstat_report_analyze() -
  *
- *	Tell the collector about the table we just analyzed.
+ *	Record the results of the ANALYZE we just did on a table.
  * --------
  */
 void
 pgstat_report_analyze(Relation rel,
 					  PgStat_Counter livetuples, PgStat_Counter deadtuples)
 {
-	PgStat_MsgAnalyze msg;
+	PgStat_StatTabEntry *tabentry;
+	LWLock	   *partitionLock;
+	TimestampTz now;
 
-	if (pgStatSock == PGINVALID_SOCKET || !pgstat_track_counts)
+	if (!pgstat_track_counts)
 		return;
 
 	/*
@@ -1360,10 +1454,9 @@ pgstat_report_analyze(Relation rel,
 	 * already inserted and/or deleted rows in the target table. ANALYZE will
 	 * have counted such rows as live or dead respectively. Because we will
 	 * report our counts of such rows at transaction end, we should subtract
-	 * off these counts from what we send to the collector now, else they'll
-	 * be double-counted after commit.  (This approach also ensures that the
-	 * collector ends up with the right numbers if we abort instead of
-	 * committing.)
+	 * off these counts from what we store now, else they'll be double-counted
+	 * after commit.  (This approach also ensures that we end up with the
+	 * right numbers if we abort instead of committing.)
 	 */
 	if (rel->pgstat_info != NULL)
 	{
@@ -1381,14 +1474,35 @@ pgstat_report_analyze(Relation rel,
 		deadtuples = Max(deadtuples, 0);
 	}
 
-	pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_ANALYZE);
-	msg.m_databaseid = rel->rd_rel->relisshared ? InvalidOid : MyDatabaseId;
-	msg.m_tableoid = RelationGetRelid(rel);
-	msg.m_autovacuum = IsAutoVacuumWorkerProcess();
-	msg.m_analyzetime = GetCurrentTimestamp();
-	msg.m_live_tuples = livetuples;
-	msg.m_dead_tuples = deadtuples;
-	pgstat_send(&msg, sizeof(msg));
+	now = GetCurrentTimestamp();
+
+	tabentry = pgstat_lock_tab_entry(rel->rd_rel->relisshared ?
+									 InvalidOid : MyDatabaseId,
+									 RelationGetRelid(rel), &partitionLock);
+	if (tabentry == NULL)
+		return;
+
+	tabentry->n_live_tuples = livetuples;
+	tabentry->n_dead_tuples = deadtuples;
+
+	/*
+	 * We reset changes_since_analyze to zero, forgetting any changes that
+	 * occurred while the ANALYZE was in progress.
+	 */
+	tabentry->changes_since_analyze = 0;
+
+	if (IsAutoVacuumWorkerProcess())
+	{
+		tabentry->autovac_analyze_timestamp = now;
+		tabentry->autovac_analyze_count++;
+	}
+	else
+	{
+		tabentry->analyze_timestamp = now;
+		tabentry->analyze_count++;
+	}
+
+	LWLockRelease(partitionLock);
 }
 
 /* --------
@@ -2290,56 +2404,86 @@ pgstat_fetch_stat_dbentry(Oid dbid)
  *
  *	Support function for the SQL-callable pgstat* functions. Returns
  *	the collected statistics for one table or NULL. NULL doesn't mean
- *	that the table doesn't exist, it is just not yet known by the
- *	collector, so the caller is better off to report ZERO instead.
+ *	that the table doesn't exist, it is just not yet known to the
+ *	statistics system, so the caller is better off to report ZERO instead.
  * ----------
  */
 PgStat_StatTabEntry *
 pgstat_fetch_stat_tabentry(Oid relid)
 {
-	Oid			dbid;
-	PgStat_StatDBEntry *dbentry;
 	PgStat_StatTabEntry *tabentry;
 
 	/*
-	 * If not done for this transaction, read the statistics collector stats
-	 * file into some hash tables.
+	 * Look in our database first; if we don't find it there, maybe it's a
+	 * shared table.
 	 */
-	backend_read_statsfile();
+	tabentry = pgstat_fetch_stat_tabentry_extended(false, relid);
+	if (tabentry == NULL)
+		tabentry = pgstat_fetch_stat_tabentry_extended(true, relid);
 
-	/*
-	 * Lookup our database, then look in its table hash table.
-	 */
-	dbid = MyDatabaseId;
-	dbentry = (PgStat_StatDBEntry *) hash_search(pgStatDBHash,
-												 (void *) &dbid,
-												 HASH_FIND, NULL);
-	if (dbentry != NULL && dbentry->tables != NULL)
+	return tabentry;
+}
+
+
+/* ----------
+ * pgstat_fetch_stat_tabentry_extended() -
+ *
+ *	Like pgstat_fetch_stat_tabentry(), but the caller says whether the table
+ *	is a shared one.  The entry is copied out of shared memory the first
+ *	time it's asked for in a transaction, and the copy is returned after
+ *	that, until pgstat_clear_snapshot() is called.
+ * ----------
+ */
+PgStat_StatTabEntry *
+pgstat_fetch_stat_tabentry_extended(bool shared, Oid relid)
+{
+	PgStat_TabHashKey key;
+	PgStat_TabSnapshotEntry *snapentry;
+	bool		found;
+
+	if (pgStatTabSnapshot == NULL)
 	{
-		tabentry = (PgStat_StatTabEntry *) hash_search(dbentry->tables,
-													   (void *) &relid,
-													   HASH_FIND, NULL);
-		if (tabentry)
-			return tabentry;
+		HASHCTL		hash_ctl;
+
+		pgstat_setup_memcxt();
+
+		memset(&hash_ctl, 0, sizeof(hash_ctl));
+		hash_ctl.keysize = sizeof(PgStat_TabHashKey);
+		hash_ctl.entrysize = sizeof(PgStat_TabSnapshotEntry);
+		hash_ctl.hcxt = pgStatLocalContext;
+		pgStatTabSnapshot = hash_create("Table statistics snapshot",
+										PGSTAT_TAB_HASH_SIZE,
+										&hash_ctl,
+									  HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
 	}
 
-	/*
-	 * If we didn't find it, maybe it's a shared table.
-	 */
-	dbid = InvalidOid;
-	dbentry = (PgStat_StatDBEntry *) hash_search(pgStatDBHash,
-												 (void *) &dbid,
-												 HASH_FIND, NULL);
-	if (dbentry != NULL && dbentry->tables != NULL)
+	key.databaseid = shared ? InvalidOid : MyDatabaseId;
+	key.tableid = relid;
+
+	snapentry = (PgStat_TabSnapshotEntry *) hash_search(pgStatTabSnapshot,
+														(void *) &key,
+														HASH_ENTER, &found);
+	if (!found)
 	{
-		tabentry = (PgStat_StatTabEntry *) hash_search(dbentry->tables,
-													   (void *) &relid,
-													   HASH_FIND, NULL);
-		if (tabentry)
-			return tabentry;
+		PgStat_TabHashEntry *hentry;
+		uint32		hashcode;
+		LWLock	   *partitionLock;
+
+		hashcode = get_hash_value(pgStatTabHash, (void *) &key);
+		partitionLock = PgStatTabPartitionLock(hashcode);
+
+		LWLockAcquire(partitionLock, LW_SHARED);
+		hentry = (PgStat_TabHashEntry *)
+			hash_search_with_hash_value(pgStatTabHash, (void *) &key,
+										hashcode, HASH_FIND, NULL);
+		snapentry->found = (hentry != NULL);
+		if (hentry != NULL)
+			memcpy(&snapentry->stats, &hentry->stats,
+				   sizeof(PgStat_StatTabEntry));
+		LWLockRelease(partitionLock);
 	}
 
-	return NULL;
+	return snapentry->found ? &snapentry->stats : NULL;
 }
 
 
@@ -2796,6 +2940,13 @@ pgstat_report_activity(BackendState state, const char *cmd_str)
 
 	TRACE_POSTGRESQL_STATEMENT_STATUS(cmd_str);
 
+	/*
+	 * The query ID is set for each top-level statement by postgres.c; make
+	 * sure it's forgotten even if the statement failed.
+	 */
+	if (MyProc != NULL && state != STATE_RUNNING && state != STATE_FASTPATH)
+		MyProc->queryId = 0;
+
 	if (!beentry)
 		return;
 
@@ -3117,6 +3268,28 @@ pgstat_read_current_status(void)
 	localBackendStatusTable = localtable;
 }
 
+/* ----------
+ * pgstat_get_backend_state() -
+ *
+ *	Return the current state of the backend with the given backend ID.
+ *	This reads shared memory directly, without the changecount protocol
+ *	and without taking a snapshot, so it is only suitable for callers
+ *	that can live with an occasional stale value, like the wait sampler.
+ * ----------
+ */
+BackendState
+pgstat_get_backend_state(BackendId backendId)
+{
+	volatile PgBackendStatus *beentry;
+
+	if (BackendStatusArray == NULL ||
+		backendId < 1 || backendId > MaxBackends)
+		return STATE_UNDEFINED;
+
+	beentry = &BackendStatusArray[backendId - 1];
+	return beentry->st_state;
+}
+
 /* ----------
  * pgstat_get_wait_event_type() -
  *
@@ -3606,10 +3779,6 @@ PgstatCollectorMain(int argc, char *argv[])
 					pgstat_recv_tabstat((PgStat_MsgTabstat *) &msg, len);
 					break;
 
-				case PGSTAT_MTYPE_TABPURGE:
-					pgstat_recv_tabpurge((PgStat_MsgTabpurge *) &msg, len);
-					break;
-
 				case PGSTAT_MTYPE_DROPDB:
 					pgstat_recv_dropdb((PgStat_MsgDropdb *) &msg, len);
 					break;
@@ -3635,14 +3804,6 @@ PgstatCollectorMain(int argc, char *argv[])
 					pgstat_recv_autovac((PgStat_MsgAutovacStart *) &msg, len);
 					break;
 
-				case PGSTAT_MTYPE_VACUUM:
-					pgstat_recv_vacuum((PgStat_MsgVacuum *) &msg, len);
-					break;
-
-				case PGSTAT_MTYPE_ANALYZE:
-					pgstat_recv_analyze((PgStat_MsgAnalyze *) &msg, len);
-					break;
-
 				case PGSTAT_MTYPE_ARCHIVER:
 					pgstat_recv_archiver((PgStat_MsgArchiver *) &msg, len);
 					break;
@@ -3744,7 +3905,7 @@ pgstat_sighup_handler(SIGNAL_ARGS)
 /*
  * Subroutine to clear stats in a database entry
  *
- * Tables and functions hashes are initialized to empty.
+ * Functions hash is initialized to empty.
  */
 static void
 reset_dbentry_counters(PgStat_StatDBEntry *dbentry)
@@ -3776,13 +3937,6 @@ reset_dbentry_counters(PgStat_StatDBEntry *dbentry)
 	dbentry->stats_timestamp = 0;
 
 	memset(&hash_ctl, 0, sizeof(hash_ctl));
-	hash_ctl.keysize = sizeof(Oid);
-	hash_ctl.entrysize = sizeof(PgStat_StatTabEntry);
-	dbentry->tables = hash_create("Per-database table",
-								  PGSTAT_TAB_HASH_SIZE,
-								  &hash_ctl,
-								  HASH_ELEM | HASH_BLOBS);
-
 	hash_ctl.keysize = sizeof(Oid);
 	hash_ctl.entrysize = sizeof(PgStat_StatFuncEntry);
 	dbentry->functions = hash_create("Per-database function",
@@ -3812,8 +3966,8 @@ pgstat_get_db_entry(Oid databaseid, bool create)
 		return NULL;
 
 	/*
-	 * If not found, initialize the new one.  This creates empty hash tables
-	 * for tables and functions, too.
+	 * If not found, initialize the new one.  This creates an empty hash table
+	 * for functions, too.
 	 */
 	if (!found)
 		reset_dbentry_counters(result);
@@ -3822,78 +3976,469 @@ pgstat_get_db_entry(Oid databaseid, bool create)
 }
 
 
+/* ----------
+ * PgStatTablesShmemSize() -
+ *
+ *	Compute space needed for the shared table statistics hash.
+ * ----------
+ */
+Size
+PgStatTablesShmemSize(void)
+{
+	return hash_estimate_size(pgstat_track_counts_max_relations,
+							  sizeof(PgStat_TabHashEntry));
+}
+
+/* ----------
+ * PgStatTablesShmemInit() -
+ *
+ *	Create or attach to the shared table statistics hash.  When the
+ *	postmaster creates it, the statistics saved at the last shutdown are
+ *	loaded into it.
+ * ----------
+ */
+void
+PgStatTablesShmemInit(void)
+{
+	HASHCTL		info;
+
+	memset(&info, 0, sizeof(info));
+	info.keysize = sizeof(PgStat_TabHashKey);
+	info.entrysize = sizeof(PgStat_TabHashEntry);
+	info.num_partitions = NUM_PGSTAT_PARTITIONS;
+
+	pgStatTabHash = ShmemInitHash("Table Statistics Hash",
+								  pgstat_track_counts_max_relations,
+								  pgstat_track_counts_max_relations,
+								  &info,
+								  HASH_ELEM | HASH_BLOBS | HASH_PARTITION |
+								  HASH_FIXED_SIZE);
+
+	if (!IsUnderPostmaster && IsPostmasterEnvironment)
+		pgstat_restore_table_stats();
+}
+
 /*
- * Lookup the hash table entry for the specified table. If no hash
- * table entry exists, initialize it, if the create parameter is true.
- * Else, return NULL.
+ * Find or create the shared hash table entry for the specified table, and
+ * return it with its partition lock held in exclusive mode.  The caller must
+ * release the lock, which is returned in *partitionLock.
+ *
+ * Returns NULL if the entry doesn't exist and there's no room for a new one.
  */
 static PgStat_StatTabEntry *
-pgstat_get_tab_entry(PgStat_StatDBEntry *dbentry, Oid tableoid, bool create)
+pgstat_lock_tab_entry(Oid databaseid, Oid tableoid, LWLock **partitionLock)
 {
-	PgStat_StatTabEntry *result;
+	PgStat_TabHashKey key;
+	PgStat_TabHashEntry *hentry;
+	uint32		hashcode;
 	bool		found;
-	HASHACTION	action = (create ? HASH_ENTER : HASH_FIND);
 
-	/* Lookup or create the hash table entry for this table */
-	result = (PgStat_StatTabEntry *) hash_search(dbentry->tables,
-												 &tableoid,
-												 action, &found);
+	key.databaseid = databaseid;
+	key.tableid = tableoid;
+	hashcode = get_hash_value(pgStatTabHash, (void *) &key);
+	*partitionLock = PgStatTabPartitionLock(hashcode);
 
-	if (!create && !found)
+	LWLockAcquire(*partitionLock, LW_EXCLUSIVE);
+	hentry = (PgStat_TabHashEntry *)
+		hash_search_with_hash_value(pgStatTabHash, (void *) &key, hashcode,
+									HASH_ENTER_NULL, &found);
+	if (hentry == NULL)
+	{
+		LWLockRelease(*partitionLock);
+
+		/* Make room, and try again */
+		if (pgstat_evict_tabentries())
+		{
+			LWLockAcquire(*partitionLock, LW_EXCLUSIVE);
+			hentry = (PgStat_TabHashEntry *)
+				hash_search_with_hash_value(pgStatTabHash, (void *) &key,
+											hashcode, HASH_ENTER_NULL,
+											&found);
+			if (hentry == NULL)
+				LWLockRelease(*partitionLock);
+		}
+	}
+	if (hentry == NULL)
+	{
+		/*
+		 * Complain only once per process, this could happen a lot.  Make it
+		 * a warning, since autovacuum can't see the changes to tables
+		 * without an entry.
+		 */
+		if (!pgStatTabHashFullReported)
+		{
+			ereport(WARNING,
+					(errmsg("table statistics hash is full, some table statistics will be lost"),
+					 errhint("Consider increasing the configuration parameter \"track_counts_max_relations\".")));
+			pgStatTabHashFullReported = true;
+		}
 		return NULL;
+	}
 
 	/* If not found, initialize the new one. */
 	if (!found)
 	{
-		result->numscans = 0;
-		result->tuples_returned = 0;
-		result->tuples_fetched = 0;
-		result->tuples_inserted = 0;
-		result->tuples_updated = 0;
-		result->tuples_deleted = 0;
-		result->tuples_hot_updated = 0;
-		result->n_live_tuples = 0;
-		result->n_dead_tuples = 0;
-		result->changes_since_analyze = 0;
-		result->blocks_fetched = 0;
-		result->blocks_hit = 0;
-		result->vacuum_timestamp = 0;
-		result->vacuum_count = 0;
-		result->autovac_vacuum_timestamp = 0;
-		result->autovac_vacuum_count = 0;
-		result->analyze_timestamp = 0;
-		result->analyze_count = 0;
-		result->autovac_analyze_timestamp = 0;
-		result->autovac_analyze_count = 0;
+		MemSet(&hentry->stats, 0, sizeof(PgStat_StatTabEntry));
+		hentry->stats.tableid = tableoid;
 	}
 
-	return result;
+	return &hentry->stats;
 }
 
-
-/* ----------
- * pgstat_write_statsfiles() -
- *		Write the global statistics file, as well as requested DB files.
- *
- *	If writing to the permanent files (happens when the collector is
- *	shutting down only), remove the temporary files so that backends
- *	starting up under a new postmaster can't read the old data before
- *	the new collector is ready.
+/*
+ * Evict some entries from the full shared hash, to make room for new ones.
+ * Returns false if there was nothing to evict.
  *
- *	When 'allDbs' is false, only the requested databases (listed in
- *	last_statrequests) will be written; otherwise, all databases will be
- *	written.
- * ----------
+ * Only entries without changes that autovacuum has yet to act on are
+ * evicted, which includes those of all indexes.  Autovacuum treats a table
+ * without an entry as unchanged, so it loses nothing; the entry is recreated
+ * when the table changes again.  Only the cumulative counters shown in the
+ * statistics views are lost.  A batch of entries is evicted at a time, as
+ * this has to lock the whole hash.
  */
-static void
-pgstat_write_statsfiles(bool permanent, bool allDbs)
+static bool
+pgstat_evict_tabentries(void)
 {
 	HASH_SEQ_STATUS hstat;
-	PgStat_StatDBEntry *dbentry;
-	FILE	   *fpout;
-	int32		format_id;
-	const char *tmpfile = permanent ? PGSTAT_STAT_PERMANENT_TMPFILE : pgstat_stat_tmpname;
-	const char *statfile = permanent ? PGSTAT_STAT_PERMANENT_FILENAME : pgstat_stat_filename;
+	PgStat_TabHashEntry *hentry;
+	PgStat_TabHashKey *victims;
+	int			nvictims = 0;
+	int			maxvictims;
+	int			i;
+
+	maxvictims = Max(pgstat_track_counts_max_relations / 64, 1);
+	victims = (PgStat_TabHashKey *)
+		palloc(maxvictims * sizeof(PgStat_TabHashKey));
+
+	for (i = 0; i < NUM_PGSTAT_PARTITIONS; i++)
+		LWLockAcquire(PgStatTabPartitionLockByIndex(i), LW_EXCLUSIVE);
+
+	hash_seq_init(&hstat, pgStatTabHash);
+	while ((hentry = (PgStat_TabHashEntry *) hash_seq_search(&hstat)) != NULL)
+	{
+		PgStat_StatTabEntry *tabentry = &hentry->stats;
+
+		if (tabentry->n_dead_tuples != 0 ||
+			tabentry->changes_since_analyze != 0 ||
+			tabentry->inserts_since_vacuum != 0)
+			continue;
+
+		victims[nvictims++] = hentry->key;
+		if (nvictims >= maxvictims)
+		{
+			hash_seq_term(&hstat);
+			break;
+		}
+	}
+
+	for (i = 0; i < nvictims; i++)
+		(void) hash_search(pgStatTabHash, (void *) &victims[i],
+						   HASH_REMOVE, NULL);
+
+	for (i = NUM_PGSTAT_PARTITIONS; --i >= 0;)
+		LWLockRelease(PgStatTabPartitionLockByIndex(i));
+
+	pfree(victims);
+
+	return nvictims > 0;
+}
+
+/*
+ * Remove table entries from the shared hash: those of the given database,
+ * or all of them if alldbs is true.  If keep isn't NULL, it's a hash table of
+ * table OIDs, and the entries for tables listed in it are kept.
+ *
+ * Scanning the hash requires all the partition locks, but only in shared
+ * mode, so that backends can go on reading statistics meanwhile.  The keys
+ * of the entries to remove are collected first, and each one is then
+ * removed under its own partition lock.  An entry that is recreated in
+ * between is removed anyway, which just loses a few counts.
+ */
+static void
+pgstat_remove_tabentries(Oid databaseid, bool alldbs, HTAB *keep)
+{
+	HASH_SEQ_STATUS hstat;
+	PgStat_TabHashEntry *hentry;
+	PgStat_TabHashKey *victims;
+	int			nvictims = 0;
+	int			maxvictims = 64;
+	int			i;
+
+	victims = (PgStat_TabHashKey *)
+		palloc(maxvictims * sizeof(PgStat_TabHashKey));
+
+	for (i = 0; i < NUM_PGSTAT_PARTITIONS; i++)
+		LWLockAcquire(PgStatTabPartitionLockByIndex(i), LW_SHARED);
+
+	hash_seq_init(&hstat, pgStatTabHash);
+	while ((hentry = (PgStat_TabHashEntry *) hash_seq_search(&hstat)) != NULL)
+	{
+		if (!alldbs && hentry->key.databaseid != databaseid)
+			continue;
+		if (keep != NULL &&
+			hash_search(keep, (void *) &hentry->key.tableid,
+						HASH_FIND, NULL) != NULL)
+			continue;
+
+		if (nvictims >= maxvictims)
+		{
+			maxvictims *= 2;
+			victims = (PgStat_TabHashKey *)
+				repalloc(victims, maxvictims * sizeof(PgStat_TabHashKey));
+		}
+		victims[nvictims++] = hentry->key;
+	}
+
+	for (i = NUM_PGSTAT_PARTITIONS; --i >= 0;)
+		LWLockRelease(PgStatTabPartitionLockByIndex(i));
+
+	for (i = 0; i < nvictims; i++)
+		pgstat_remove_tabentry(victims[i].databaseid, victims[i].tableid);
+
+	pfree(victims);
+}
+
+/*
+ * Remove the shared hash entry for one table, if there is one.
+ */
+static void
+pgstat_remove_tabentry(Oid databaseid, Oid tableoid)
+{
+	PgStat_TabHashKey key;
+	uint32		hashcode;
+	LWLock	   *partitionLock;
+
+	key.databaseid = databaseid;
+	key.tableid = tableoid;
+	hashcode = get_hash_value(pgStatTabHash, (void *) &key);
+	partitionLock = PgStatTabPartitionLock(hashcode);
+
+	LWLockAcquire(partitionLock, LW_EXCLUSIVE);
+	(void) hash_search_with_hash_value(pgStatTabHash, (void *) &key,
+									   hashcode, HASH_REMOVE, NULL);
+	LWLockRelease(partitionLock);
+}
+
+/* ----------
+ * pgstat_save_table_stats() -
+ *
+ *	Write the shared table statistics to the permanent stats directory, so
+ *	that they survive a restart.  This is called by the checkpointer at
+ *	shutdown, after the shutdown checkpoint.  The file is read back, and
+ *	removed, by the postmaster when it next creates shared memory.
+ * ----------
+ */
+void
+pgstat_save_table_stats(void)
+{
+	HASH_SEQ_STATUS hstat;
+	PgStat_TabHashEntry *hentry;
+	FILE	   *fpout;
+	int32		format_id;
+	const char *tmpfile = PGSTAT_STAT_PERMANENT_TABLES_TMPFILE;
+	const char *statfile = PGSTAT_STAT_PERMANENT_TABLES_FILENAME;
+	int			rc;
+	int			i;
+
+	elog(DEBUG2, "writing stats file \"%s\"", statfile);
+
+	/*
+	 * Open the statistics temp file to write out the current values.
+	 */
+	fpout = AllocateFile(tmpfile, PG_BINARY_W);
+	if (fpout == NULL)
+	{
+		ereport(LOG,
+				(errcode_for_file_access(),
+				 errmsg("could not open temporary statistics file \"%s\": %m",
+						tmpfile)));
+		return;
+	}
+
+	/*
+	 * Write the file header --- currently just a format ID.
+	 */
+	format_id = PGSTAT_FILE_FORMAT_ID;
+	rc = fwrite(&format_id, sizeof(format_id), 1, fpout);
+	(void) rc;					/* we'll check for error with ferror */
+
+	/*
+	 * Walk through the shared hash.  Nobody should be updating it anymore,
+	 * but take the locks anyway for the benefit of hash_seq_search.
+	 */
+	for (i = 0; i < NUM_PGSTAT_PARTITIONS; i++)
+		LWLockAcquire(PgStatTabPartitionLockByIndex(i), LW_SHARED);
+
+	hash_seq_init(&hstat, pgStatTabHash);
+	while ((hentry = (PgStat_TabHashEntry *) hash_seq_search(&hstat)) != NULL)
+	{
+		fputc('T', fpout);
+		rc = fwrite(hentry, sizeof(PgStat_TabHashEntry), 1, fpout);
+		(void) rc;				/* we'll check for error with ferror */
+	}
+
+	for (i = NUM_PGSTAT_PARTITIONS; --i >= 0;)
+		LWLockRelease(PgStatTabPartitionLockByIndex(i));
+
+	/*
+	 * No more output to be done. Close the temp file and replace the old
+	 * tables.stat with it.  The ferror() check replaces testing for error
+	 * after each individual fputc or fwrite above.
+	 */
+	fputc('E', fpout);
+
+	if (ferror(fpout))
+	{
+		ereport(LOG,
+				(errcode_for_file_access(),
+			   errmsg("could not write temporary statistics file \"%s\": %m",
+					  tmpfile)));
+		FreeFile(fpout);
+		unlink(tmpfile);
+	}
+	else if (FreeFile(fpout) < 0)
+	{
+		ereport(LOG,
+				(errcode_for_file_access(),
+			   errmsg("could not close temporary statistics file \"%s\": %m",
+					  tmpfile)));
+		unlink(tmpfile);
+	}
+	else if (rename(tmpfile, statfile) < 0)
+	{
+		ereport(LOG,
+				(errcode_for_file_access(),
+				 errmsg("could not rename temporary statistics file \"%s\" to \"%s\": %m",
+						tmpfile, statfile)));
+		unlink(tmpfile);
+	}
+}
+
+/* ----------
+ * pgstat_restore_table_stats() -
+ *
+ *	Load the table statistics saved by pgstat_save_table_stats() into the
+ *	newly created shared hash, and remove the file.  This runs in the
+ *	postmaster before any other process is started, so no locking is needed.
+ * ----------
+ */
+static void
+pgstat_restore_table_stats(void)
+{
+	PgStat_TabHashEntry hbuf;
+	PgStat_TabHashEntry *hentry;
+	FILE	   *fpin;
+	int32		format_id;
+	bool		found;
+	const char *statfile = PGSTAT_STAT_PERMANENT_TABLES_FILENAME;
+
+	/*
+	 * Try to open the stats file.  If it doesn't exist, we simply start from
+	 * scratch with empty counters.
+	 */
+	if ((fpin = AllocateFile(statfile, PG_BINARY_R)) == NULL)
+	{
+		if (errno != ENOENT)
+			ereport(LOG,
+					(errcode_for_file_access(),
+					 errmsg("could not open statistics file \"%s\": %m",
+							statfile)));
+		return;
+	}
+
+	/*
+	 * Verify it's of the expected format.
+	 */
+	if (fread(&format_id, 1, sizeof(format_id), fpin) != sizeof(format_id) ||
+		format_id != PGSTAT_FILE_FORMAT_ID)
+	{
+		ereport(LOG,
+				(errmsg("corrupted statistics file \"%s\"", statfile)));
+		goto done;
+	}
+
+	for (;;)
+	{
+		switch (fgetc(fpin))
+		{
+				/*
+				 * 'T'	A PgStat_TabHashEntry follows.
+				 */
+			case 'T':
+				if (fread(&hbuf, 1, sizeof(PgStat_TabHashEntry),
+						  fpin) != sizeof(PgStat_TabHashEntry))
+				{
+					ereport(LOG,
+							(errmsg("corrupted statistics file \"%s\"",
+									statfile)));
+					goto done;
+				}
+
+				hentry = (PgStat_TabHashEntry *) hash_search(pgStatTabHash,
+														  (void *) &hbuf.key,
+															HASH_ENTER_NULL,
+															 &found);
+
+				/* If track_counts_max_relations was lowered, keep what fits */
+				if (hentry == NULL)
+					goto done;
+
+				if (found)
+				{
+					ereport(LOG,
+							(errmsg("corrupted statistics file \"%s\"",
+									statfile)));
+					goto done;
+				}
+
+				memcpy(hentry, &hbuf, sizeof(hbuf));
+				break;
+
+				/*
+				 * 'E'	The EOF marker of a complete stats file.
+				 */
+			case 'E':
+				goto done;
+
+			default:
+				ereport(LOG,
+						(errmsg("corrupted statistics file \"%s\"",
+								statfile)));
+				goto done;
+		}
+	}
+
+done:
+	FreeFile(fpin);
+
+	elog(DEBUG2, "removing permanent stats file \"%s\"", statfile);
+	unlink(statfile);
+}
+
+
+/* ----------
+ * pgstat_write_statsfiles() -
+ *		Write the global statistics file, as well as requested DB files.
+ *
+ *	If writing to the permanent files (happens when the collector is
+ *	shutting down only), remove the temporary files so that backends
+ *	starting up under a new postmaster can't read the old data before
+ *	the new collector is ready.
+ *
+ *	When 'allDbs' is false, only the requested databases (listed in
+ *	last_statrequests) will be written; otherwise, all databases will be
+ *	written.
+ * ----------
+ */
+static void
+pgstat_write_statsfiles(bool permanent, bool allDbs)
+{
+	HASH_SEQ_STATUS hstat;
+	PgStat_StatDBEntry *dbentry;
+	FILE	   *fpout;
+	int32		format_id;
+	const char *tmpfile = permanent ? PGSTAT_STAT_PERMANENT_TMPFILE : pgstat_stat_tmpname;
+	const char *statfile = permanent ? PGSTAT_STAT_PERMANENT_FILENAME : pgstat_stat_filename;
 	int			rc;
 
 	elog(DEBUG2, "writing stats file \"%s\"", statfile);
@@ -3955,11 +4500,11 @@ pgstat_write_statsfiles(bool permanent, bool allDbs)
 		}
 
 		/*
-		 * Write out the DB entry. We don't write the tables or functions
-		 * pointers, since they're of no use to any other process.
+		 * Write out the DB entry. We don't write the functions pointer,
+		 * since it's of no use to any other process.
 		 */
 		fputc('D', fpout);
-		rc = fwrite(dbentry, offsetof(PgStat_StatDBEntry, tables), 1, fpout);
+		rc = fwrite(dbentry, offsetof(PgStat_StatDBEntry, functions), 1, fpout);
 		(void) rc;				/* we'll check for error with ferror */
 	}
 
@@ -4059,9 +4604,7 @@ get_dbstat_filename(bool permanent, bool tempname, Oid databaseid,
 static void
 pgstat_write_db_statsfile(PgStat_StatDBEntry *dbentry, bool permanent)
 {
-	HASH_SEQ_STATUS tstat;
 	HASH_SEQ_STATUS fstat;
-	PgStat_StatTabEntry *tabentry;
 	PgStat_StatFuncEntry *funcentry;
 	FILE	   *fpout;
 	int32		format_id;
@@ -4095,17 +4638,6 @@ pgstat_write_db_statsfile(PgStat_StatDBEntry *dbentry, bool permanent)
 	rc = fwrite(&format_id, sizeof(format_id), 1, fpout);
 	(void) rc;					/* we'll check for error with ferror */
 
-	/*
-	 * Walk through the database's access stats per table.
-	 */
-	hash_seq_init(&tstat, dbentry->tables);
-	while ((tabentry = (PgStat_StatTabEntry *) hash_seq_search(&tstat)) != NULL)
-	{
-		fputc('T', fpout);
-		rc = fwrite(tabentry, sizeof(PgStat_StatTabEntry), 1, fpout);
-		(void) rc;				/* we'll check for error with ferror */
-	}
-
 	/*
 	 * Walk through the database's function stats table.
 	 */
@@ -4168,8 +4700,8 @@ pgstat_write_db_statsfile(PgStat_StatDBEntry *dbentry, bool permanent)
  *	reading; the in-memory status is now authoritative, and the permanent file
  *	would be out of date in case somebody else reads it.
  *
- *	If a deep read is requested, table/function stats are read also, otherwise
- *	the table/function hash tables remain empty.
+ *	If a deep read is requested, function stats are read also, otherwise
+ *	the function hash tables remain empty.
  * ----------
  */
 static HTAB *
@@ -4276,8 +4808,8 @@ pgstat_read_statsfiles(Oid onlydb, bool permanent, bool deep)
 				 * follows.
 				 */
 			case 'D':
-				if (fread(&dbbuf, 1, offsetof(PgStat_StatDBEntry, tables),
-						  fpin) != offsetof(PgStat_StatDBEntry, tables))
+				if (fread(&dbbuf, 1, offsetof(PgStat_StatDBEntry, functions),
+						  fpin) != offsetof(PgStat_StatDBEntry, functions))
 				{
 					ereport(pgStatRunningInCollector ? LOG : WARNING,
 							(errmsg("corrupted statistics file \"%s\"",
@@ -4301,11 +4833,10 @@ pgstat_read_statsfiles(Oid onlydb, bool permanent, bool deep)
 				}
 
 				memcpy(dbentry, &dbbuf, sizeof(PgStat_StatDBEntry));
-				dbentry->tables = NULL;
 				dbentry->functions = NULL;
 
 				/*
-				 * Don't collect tables if not the requested DB (or the
+				 * Don't collect functions if not the requested DB (or the
 				 * shared-table info)
 				 */
 				if (onlydb != InvalidOid)
@@ -4316,14 +4847,6 @@ pgstat_read_statsfiles(Oid onlydb, bool permanent, bool deep)
 				}
 
 				memset(&hash_ctl, 0, sizeof(hash_ctl));
-				hash_ctl.keysize = sizeof(Oid);
-				hash_ctl.entrysize = sizeof(PgStat_StatTabEntry);
-				hash_ctl.hcxt = pgStatLocalContext;
-				dbentry->tables = hash_create("Per-database table",
-											  PGSTAT_TAB_HASH_SIZE,
-											  &hash_ctl,
-									  HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
-
 				hash_ctl.keysize = sizeof(Oid);
 				hash_ctl.entrysize = sizeof(PgStat_StatFuncEntry);
 				hash_ctl.hcxt = pgStatLocalContext;
@@ -4340,7 +4863,6 @@ pgstat_read_statsfiles(Oid onlydb, bool permanent, bool deep)
 				 */
 				if (deep)
 					pgstat_read_db_statsfile(dbentry->databaseid,
-											 dbentry->tables,
 											 dbentry->functions,
 											 permanent);
 
@@ -4375,18 +4897,15 @@ done:
  * pgstat_read_db_statsfile() -
  *
  *	Reads in the existing statistics collector file for the given database,
- *	and initializes the tables and functions hash tables.
+ *	and initializes the functions hash table.
  *
  *	As pgstat_read_statsfiles, if the permanent file is requested, it is
  *	removed after reading.
  * ----------
  */
 static void
-pgstat_read_db_statsfile(Oid databaseid, HTAB *tabhash, HTAB *funchash,
-						 bool permanent)
+pgstat_read_db_statsfile(Oid databaseid, HTAB *funchash, bool permanent)
 {
-	PgStat_StatTabEntry *tabentry;
-	PgStat_StatTabEntry tabbuf;
 	PgStat_StatFuncEntry funcbuf;
 	PgStat_StatFuncEntry *funcentry;
 	FILE	   *fpin;
@@ -4434,40 +4953,6 @@ pgstat_read_db_statsfile(Oid databaseid, HTAB *tabhash, HTAB *funchash,
 	{
 		switch (fgetc(fpin))
 		{
-				/*
-				 * 'T'	A PgStat_StatTabEntry follows.
-				 */
-			case 'T':
-				if (fread(&tabbuf, 1, sizeof(PgStat_StatTabEntry),
-						  fpin) != sizeof(PgStat_StatTabEntry))
-				{
-					ereport(pgStatRunningInCollector ? LOG : WARNING,
-							(errmsg("corrupted statistics file \"%s\"",
-									statfile)));
-					goto done;
-				}
-
-				/*
-				 * Skip if table belongs to a not requested database.
-				 */
-				if (tabhash == NULL)
-					break;
-
-				tabentry = (PgStat_StatTabEntry *) hash_search(tabhash,
-													(void *) &tabbuf.tableid,
-														 HASH_ENTER, &found);
-
-				if (found)
-				{
-					ereport(pgStatRunningInCollector ? LOG : WARNING,
-							(errmsg("corrupted statistics file \"%s\"",
-									statfile)));
-					goto done;
-				}
-
-				memcpy(tabentry, &tabbuf, sizeof(tabbuf));
-				break;
-
 				/*
 				 * 'F'	A PgStat_StatFuncEntry follows.
 				 */
@@ -4622,8 +5107,8 @@ pgstat_read_db_statsfile_timestamp(Oid databaseid, bool permanent,
 				 * follows.
 				 */
 			case 'D':
-				if (fread(&dbentry, 1, offsetof(PgStat_StatDBEntry, tables),
-						  fpin) != offsetof(PgStat_StatDBEntry, tables))
+				if (fread(&dbentry, 1, offsetof(PgStat_StatDBEntry, functions),
+						  fpin) != offsetof(PgStat_StatDBEntry, functions))
 				{
 					ereport(pgStatRunningInCollector ? LOG : WARNING,
 							(errmsg("corrupted statistics file \"%s\"",
@@ -4817,6 +5302,7 @@ pgstat_clear_snapshot(void)
 	/* Reset variables */
 	pgStatLocalContext = NULL;
 	pgStatDBHash = NULL;
+	pgStatTabSnapshot = NULL;
 	localBackendStatusTable = NULL;
 	localNumBackends = 0;
 }
@@ -4908,16 +5394,15 @@ pgstat_recv_inquiry(PgStat_MsgInquiry *msg, int len)
 /* ----------
  * pgstat_recv_tabstat() -
  *
- *	Count what the backend has done.
+ *	Count what the backend has done.  The per-table counts have already
+ *	been stored in shared memory by the backend; we only keep the totals
+ *	for the database.
  * ----------
  */
 static void
 pgstat_recv_tabstat(PgStat_MsgTabstat *msg, int len)
 {
 	PgStat_StatDBEntry *dbentry;
-	PgStat_StatTabEntry *tabentry;
-	int			i;
-	bool		found;
 
 	dbentry = pgstat_get_db_entry(msg->m_databaseid, true);
 
@@ -4928,120 +5413,13 @@ pgstat_recv_tabstat(PgStat_MsgTabstat *msg, int len)
 	dbentry->n_xact_rollback += (PgStat_Counter) (msg->m_xact_rollback);
 	dbentry->n_block_read_time += msg->m_block_read_time;
 	dbentry->n_block_write_time += msg->m_block_write_time;
-
-	/*
-	 * Process all table entries in the message.
-	 */
-	for (i = 0; i < msg->m_nentries; i++)
-	{
-		PgStat_TableEntry *tabmsg = &(msg->m_entry[i]);
-
-		tabentry = (PgStat_StatTabEntry *) hash_search(dbentry->tables,
-													(void *) &(tabmsg->t_id),
-													   HASH_ENTER, &found);
-
-		if (!found)
-		{
-			/*
-			 * If it's a new table entry, initialize counters to the values we
-			 * just got.
-			 */
-			tabentry->numscans = tabmsg->t_counts.t_numscans;
-			tabentry->tuples_returned = tabmsg->t_counts.t_tuples_returned;
-			tabentry->tuples_fetched = tabmsg->t_counts.t_tuples_fetched;
-			tabentry->tuples_inserted = tabmsg->t_counts.t_tuples_inserted;
-			tabentry->tuples_updated = tabmsg->t_counts.t_tuples_updated;
-			tabentry->tuples_deleted = tabmsg->t_counts.t_tuples_deleted;
-			tabentry->tuples_hot_updated = tabmsg->t_counts.t_tuples_hot_updated;
-			tabentry->n_live_tuples = tabmsg->t_counts.t_delta_live_tuples;
-			tabentry->n_dead_tuples = tabmsg->t_counts.t_delta_dead_tuples;
-			tabentry->changes_since_analyze = tabmsg->t_counts.t_changed_tuples;
-			tabentry->blocks_fetched = tabmsg->t_counts.t_blocks_fetched;
-			tabentry->blocks_hit = tabmsg->t_counts.t_blocks_hit;
-
-			tabentry->vacuum_timestamp = 0;
-			tabentry->vacuum_count = 0;
-			tabentry->autovac_vacuum_timestamp = 0;
-			tabentry->autovac_vacuum_count = 0;
-			tabentry->analyze_timestamp = 0;
-			tabentry->analyze_count = 0;
-			tabentry->autovac_analyze_timestamp = 0;
-			tabentry->autovac_analyze_count = 0;
-		}
-		else
-		{
-			/*
-			 * Otherwise add the values to the existing entry.
-			 */
-			tabentry->numscans += tabmsg->t_counts.t_numscans;
-			tabentry->tuples_returned += tabmsg->t_counts.t_tuples_returned;
-			tabentry->tuples_fetched += tabmsg->t_counts.t_tuples_fetched;
-			tabentry->tuples_inserted += tabmsg->t_counts.t_tuples_inserted;
-			tabentry->tuples_updated += tabmsg->t_counts.t_tuples_updated;
-			tabentry->tuples_deleted += tabmsg->t_counts.t_tuples_deleted;
-			tabentry->tuples_hot_updated += tabmsg->t_counts.t_tuples_hot_updated;
-			/* If table was truncated, first reset the live/dead counters */
-			if (tabmsg->t_counts.t_truncated)
-			{
-				tabentry->n_live_tuples = 0;
-				tabentry->n_dead_tuples = 0;
-			}
-			tabentry->n_live_tuples += tabmsg->t_counts.t_delta_live_tuples;
-			tabentry->n_dead_tuples += tabmsg->t_counts.t_delta_dead_tuples;
-			tabentry->changes_since_analyze += tabmsg->t_counts.t_changed_tuples;
-			tabentry->blocks_fetched += tabmsg->t_counts.t_blocks_fetched;
-			tabentry->blocks_hit += tabmsg->t_counts.t_blocks_hit;
-		}
-
-		/* Clamp n_live_tuples in case of negative delta_live_tuples */
-		tabentry->n_live_tuples = Max(tabentry->n_live_tuples, 0);
-		/* Likewise for n_dead_tuples */
-		tabentry->n_dead_tuples = Max(tabentry->n_dead_tuples, 0);
-
-		/*
-		 * Add per-table stats to the per-database entry, too.
-		 */
-		dbentry->n_tuples_returned += tabmsg->t_counts.t_tuples_returned;
-		dbentry->n_tuples_fetched += tabmsg->t_counts.t_tuples_fetched;
-		dbentry->n_tuples_inserted += tabmsg->t_counts.t_tuples_inserted;
-		dbentry->n_tuples_updated += tabmsg->t_counts.t_tuples_updated;
-		dbentry->n_tuples_deleted += tabmsg->t_counts.t_tuples_deleted;
-		dbentry->n_blocks_fetched += tabmsg->t_counts.t_blocks_fetched;
-		dbentry->n_blocks_hit += tabmsg->t_counts.t_blocks_hit;
-	}
-}
-
-
-/* ----------
- * pgstat_recv_tabpurge() -
- *
- *	Arrange for dead table removal.
- * ----------
- */
-static void
-pgstat_recv_tabpurge(PgStat_MsgTabpurge *msg, int len)
-{
-	PgStat_StatDBEntry *dbentry;
-	int			i;
-
-	dbentry = pgstat_get_db_entry(msg->m_databaseid, false);
-
-	/*
-	 * No need to purge if we don't even know the database.
-	 */
-	if (!dbentry || !dbentry->tables)
-		return;
-
-	/*
-	 * Process all table entries in the message.
-	 */
-	for (i = 0; i < msg->m_nentries; i++)
-	{
-		/* Remove from hashtable if present; we don't care if it's not. */
-		(void) hash_search(dbentry->tables,
-						   (void *) &(msg->m_tableid[i]),
-						   HASH_REMOVE, NULL);
-	}
+	dbentry->n_tuples_returned += msg->m_tuples_returned;
+	dbentry->n_tuples_fetched += msg->m_tuples_fetched;
+	dbentry->n_tuples_inserted += msg->m_tuples_inserted;
+	dbentry->n_tuples_updated += msg->m_tuples_updated;
+	dbentry->n_tuples_deleted += msg->m_tuples_deleted;
+	dbentry->n_blocks_fetched += msg->m_blocks_fetched;
+	dbentry->n_blocks_hit += msg->m_blocks_hit;
 }
 
 
@@ -5074,8 +5452,6 @@ pgstat_recv_dropdb(PgStat_MsgDropdb *msg, int len)
 		elog(DEBUG2, "removing stats file \"%s\"", statfile);
 		unlink(statfile);
 
-		if (dbentry->tables != NULL)
-			hash_destroy(dbentry->tables);
 		if (dbentry->functions != NULL)
 			hash_destroy(dbentry->functions);
 
@@ -5108,20 +5484,18 @@ pgstat_recv_resetcounter(PgStat_MsgResetcounter *msg, int len)
 		return;
 
 	/*
-	 * We simply throw away all the database's table entries by recreating a
-	 * new hash table for them.
+	 * We simply throw away all the database's function entries by recreating
+	 * a new hash table for them.  (The table entries are in shared memory,
+	 * and were already removed by the sender.)
 	 */
-	if (dbentry->tables != NULL)
-		hash_destroy(dbentry->tables);
 	if (dbentry->functions != NULL)
 		hash_destroy(dbentry->functions);
 
-	dbentry->tables = NULL;
 	dbentry->functions = NULL;
 
 	/*
-	 * Reset database-level stats, too.  This creates empty hash tables for
-	 * tables and functions.
+	 * Reset database-level stats, too.  This creates an empty hash table for
+	 * functions.
 	 */
 	reset_dbentry_counters(dbentry);
 }
@@ -5173,11 +5547,11 @@ pgstat_recv_resetsinglecounter(PgStat_MsgResetsinglecounter *msg, int len)
 	/* Set the reset timestamp for the whole database */
 	dbentry->stat_reset_timestamp = GetCurrentTimestamp();
 
-	/* Remove object if it exists, ignore it if not */
-	if (msg->m_resettype == RESET_TABLE)
-		(void) hash_search(dbentry->tables, (void *) &(msg->m_objectid),
-						   HASH_REMOVE, NULL);
-	else if (msg->m_resettype == RESET_FUNCTION)
+	/*
+	 * Remove object if it exists, ignore it if not.  Table entries are in
+	 * shared memory, and were already removed by the sender.
+	 */
+	if (msg->m_resettype == RESET_FUNCTION)
 		(void) hash_search(dbentry->functions, (void *) &(msg->m_objectid),
 						   HASH_REMOVE, NULL);
 }
@@ -5201,81 +5575,6 @@ pgstat_recv_autovac(PgStat_MsgAutovacStart *msg, int len)
 	dbentry->last_autovac_time = msg->m_start_time;
 }
 
-/* ----------
- * pgstat_recv_vacuum() -
- *
- *	Process a VACUUM message.
- * ----------
- */
-static void
-pgstat_recv_vacuum(PgStat_MsgVacuum *msg, int len)
-{
-	PgStat_StatDBEntry *dbentry;
-	PgStat_StatTabEntry *tabentry;
-
-	/*
-	 * Store the data in the table's hashtable entry.
-	 */
-	dbentry = pgstat_get_db_entry(msg->m_databaseid, true);
-
-	tabentry = pgstat_get_tab_entry(dbentry, msg->m_tableoid, true);
-
-	tabentry->n_live_tuples = msg->m_live_tuples;
-	tabentry->n_dead_tuples = msg->m_dead_tuples;
-
-	if (msg->m_autovacuum)
-	{
-		tabentry->autovac_vacuum_timestamp = msg->m_vacuumtime;
-		tabentry->autovac_vacuum_count++;
-	}
-	else
-	{
-		tabentry->vacuum_timestamp = msg->m_vacuumtime;
-		tabentry->vacuum_count++;
-	}
-}
-
-/* ----------
- * pgstat_recv_analyze() -
- *
- *	Process an ANALYZE message.
- * ----------
- */
-static void
-pgstat_recv_analyze(PgStat_MsgAnalyze *msg, int len)
-{
-	PgStat_StatDBEntry *dbentry;
-	PgStat_StatTabEntry *tabentry;
-
-	/*
-	 * Store the data in the table's hashtable entry.
-	 */
-	dbentry = pgstat_get_db_entry(msg->m_databaseid, true);
-
-	tabentry = pgstat_get_tab_entry(dbentry, msg->m_tableoid, true);
-
-	tabentry->n_live_tuples = msg->m_live_tuples;
-	tabentry->n_dead_tuples = msg->m_dead_tuples;
-
-	/*
-	 * We reset changes_since_analyze to zero, forgetting any changes that
-	 * occurred while the ANALYZE was in progress.
-	 */
-	tabentry->changes_since_analyze = 0;
-
-	if (msg->m_autovacuum)
-	{
-		tabentry->autovac_analyze_timestamp = msg->m_analyzetime;
-		tabentry->autovac_analyze_count++;
-	}
-	else
-	{
-		tabentry->analyze_timestamp = msg->m_analyzetime;
-		tabentry->analyze_count++;
-	}
-}
-
-
 /* ----------
  * pgstat_recv_archiver() -
  *
@@ -99,6 +99,7 @@
 #include "access/xlog.h"
 #include "bootstrap/bootstrap.h"
 #include "catalog/pg_control.h"
+#include "executor/instrument.h"
 #include "lib/ilist.h"
 #include "libpq/auth.h"
 #include "libpq/ip.h"
@@ -113,6 +114,7 @@
 #include "postmaster/pgarch.h"
 #include "postmaster/postmaster.h"
 #include "postmaster/syslogger.h"
+#include "postmaster/waitsampler.h"
 #include "replication/walsender.h"
 #include "storage/fd.h"
 #include "storage/ipc.h"
@@ -488,6 +490,7 @@ typedef struct
 	int			NamedLWLockTrancheRequests;
 	NamedLWLockTranche *NamedLWLockTrancheArray;
 	LWLockPadded *MainLWLockArray;
+	LWLockStatsData *LWLockStats;
 	slock_t    *ProcStructLock;
 	PROC_HDR   *ProcGlobal;
 	PGPROC	   *AuxiliaryProcs;
@@ -502,6 +505,9 @@ typedef struct
 	bool		IsBinaryUpgrade;
 	int			max_safe_fds;
 	int			MaxBackends;
+#ifdef HAVE_INSTR_TIME_TSC
+	InstrTscClock instr_tsc_clock;
+#endif
 #ifdef WIN32
 	HANDLE		PostmasterHandle;
 	HANDLE		initial_signal_pipe;
@@ -925,6 +931,9 @@ PostmasterMain(int argc, char *argv[])
 	 */
 	process_shared_preload_libraries();
 
+	/* Register the built-in wait sampler, if enabled */
+	WaitSamplerRegister();
+
 	/*
 	 * Now that loadable modules have had their chance to register background
 	 * workers, calculate MaxBackends.
@@ -1122,6 +1131,13 @@ PostmasterMain(int argc, char *argv[])
 	 */
 	set_stack_base();
 
+	/*
+	 * Choose the clock source for EXPLAIN ANALYZE and I/O timing.  This
+	 * takes a few milliseconds, so do it once here rather than in every
+	 * backend.
+	 */
+	InstrInitClock();
+
 	/*
 	 * Initialize pipe (or process handle on Windows) that allows children to
 	 * wake up from sleep on postmaster death.
@@ -5805,6 +5821,7 @@ save_backend_variables(BackendParameters *param, Port *port,
 	param->NamedLWLockTrancheRequests = NamedLWLockTrancheRequests;
 	param->NamedLWLockTrancheArray = NamedLWLockTrancheArray;
 	param->MainLWLockArray = MainLWLockArray;
+	param->LWLockStats = LWLockStats;
 	param->ProcStructLock = ProcStructLock;
 	param->ProcGlobal = ProcGlobal;
 	param->AuxiliaryProcs = AuxiliaryProcs;
@@ -5823,6 +5840,9 @@ save_backend_variables(BackendParameters *param, Port *port,
 	param->max_safe_fds = max_safe_fds;
 
 	param->MaxBackends = MaxBackends;
+#ifdef HAVE_INSTR_TIME_TSC
+	param->instr_tsc_clock = pg_instr_tsc_clock;
+#endif
 
 #ifdef WIN32
 	param->PostmasterHandle = PostmasterHandle;
@@ -6038,6 +6058,7 @@ restore_backend_variables(BackendParameters *param, Port *port)
 	NamedLWLockTrancheRequests = param->NamedLWLockTrancheRequests;
 	NamedLWLockTrancheArray = param->NamedLWLockTrancheArray;
 	MainLWLockArray = param->MainLWLockArray;
+	LWLockStats = param->LWLockStats;
 	ProcStructLock = param->ProcStructLock;
 	ProcGlobal = param->ProcGlobal;
 	AuxiliaryProcs = param->AuxiliaryProcs;
@@ -6055,6 +6076,9 @@ restore_backend_variables(BackendParameters *param, Port *port)
 	max_safe_fds = param->max_safe_fds;
 
 	MaxBackends = param->MaxBackends;
+#ifdef HAVE_INSTR_TIME_TSC
+	pg_instr_tsc_clock = param->instr_tsc_clock;
+#endif
 
 #ifdef WIN32
 	PostmasterHandle = param->PostmasterHandle;
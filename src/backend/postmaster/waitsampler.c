@@ -0,0 +1,300 @@
+/*-------------------------------------------------------------------------
+ *
+ * waitsampler.c
+ *
+ * The wait sampler is a background worker that periodically records what
+ * every process in the cluster is doing: the wait event it is waiting for,
+ * if any, its backend state and the query ID of the statement it runs.  The
+ * samples go into a ring buffer in shared memory, where they can be examined
+ * through the pg_wait_sampling_history and pg_wait_sampling_profile views.
+ * Unlike pg_stat_activity, which only shows the present moment, this makes
+ * it possible to see where time went over the last several seconds or
+ * minutes, including short waits on LWLocks or I/O that are too brief to be
+ * caught by polling pg_stat_activity.
+ *
+ * Sampling reads the fields of other processes' PGPROC and PgBackendStatus
+ * entries without locking.  A sample may therefore now and then combine a
+ * wait event and a query ID that were not current at quite the same moment,
+ * which doesn't matter for the statistical picture we are after.  Idle
+ * processes that aren't waiting for anything aren't recorded, so that the
+ * history isn't swamped by them.
+ *
+ * The worker is registered at postmaster start if wait_sampling_history_size
+ * is greater than zero, which also determines the size of the ring buffer.
+ *
+ *
+ * Portions Copyright (c) 1996-2016, PostgreSQL Global Development Group
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/postmaster/waitsampler.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include <signal.h>
+
+#include "miscadmin.h"
+#include "pgstat.h"
+#include "postmaster/bgworker.h"
+#include "postmaster/waitsampler.h"
+#include "storage/ipc.h"
+#include "storage/latch.h"
+#include "storage/lwlock.h"
+#include "storage/proc.h"
+#include "storage/shmem.h"
+#include "utils/guc.h"
+
+
+/*
+ * Shared ring buffer of samples.  nwritten counts all samples ever written;
+ * the most recent one is at index (nwritten - 1) % wait_sampling_history_size.
+ * Protected by WaitSamplingLock.
+ */
+typedef struct WaitSamplerShmemStruct
+{
+	uint64		nwritten;
+	WaitSample	samples[FLEXIBLE_ARRAY_MEMBER];
+} WaitSamplerShmemStruct;
+
+static WaitSamplerShmemStruct *WaitSamplerShmem = NULL;
+
+/*
+ * GUC parameters
+ */
+int			wait_sampling_history_size = 0;
+int			wait_sampling_interval = 10;
+
+/* Flags set by signal handlers */
+static volatile sig_atomic_t got_SIGHUP = false;
+static volatile sig_atomic_t got_SIGTERM = false;
+
+static void WaitSamplerSigHupHandler(SIGNAL_ARGS);
+static void WaitSamplerSigTermHandler(SIGNAL_ARGS);
+static void WaitSamplerTakeSamples(void);
+
+
+/*
+ * Register the wait sampler background worker, if it is enabled.  Called by
+ * the postmaster at startup.
+ */
+void
+WaitSamplerRegister(void)
+{
+	BackgroundWorker worker;
+
+	if (wait_sampling_history_size <= 0)
+		return;
+
+	MemSet(&worker, 0, sizeof(worker));
+	snprintf(worker.bgw_name, BGW_MAXLEN, "wait sampler");
+	worker.bgw_flags = BGWORKER_SHMEM_ACCESS;
+	worker.bgw_start_time = BgWorkerStart_PostmasterStart;
+	worker.bgw_restart_time = 10;
+	worker.bgw_main = WaitSamplerMain;
+	worker.bgw_main_arg = (Datum) 0;
+	worker.bgw_notify_pid = 0;
+
+	RegisterBackgroundWorker(&worker);
+}
+
+/*
+ * Main entry point for the wait sampler process
+ */
+void
+WaitSamplerMain(Datum main_arg)
+{
+	pqsignal(SIGHUP, WaitSamplerSigHupHandler);
+	pqsignal(SIGTERM, WaitSamplerSigTermHandler);
+	BackgroundWorkerUnblockSignals();
+
+	/*
+	 * Loop forever
+	 */
+	while (!got_SIGTERM)
+	{
+		int			rc;
+
+		if (got_SIGHUP)
+		{
+			got_SIGHUP = false;
+			ProcessConfigFile(PGC_SIGHUP);
+		}
+
+		WaitSamplerTakeSamples();
+
+		rc = WaitLatch(MyLatch,
+					   WL_LATCH_SET | WL_TIMEOUT | WL_POSTMASTER_DEATH,
+					   wait_sampling_interval);
+		ResetLatch(MyLatch);
+
+		/* emergency bailout if postmaster has died */
+		if (rc & WL_POSTMASTER_DEATH)
+			proc_exit(1);
+	}
+
+	proc_exit(0);
+}
+
+/*
+ * Record one sample of every process that is waiting or running a
+ * statement.
+ */
+static void
+WaitSamplerTakeSamples(void)
+{
+	TimestampTz now = GetCurrentTimestamp();
+	uint32		i;
+
+	LWLockAcquire(WaitSamplingLock, LW_EXCLUSIVE);
+
+	for (i = 0; i < ProcGlobal->allProcCount; i++)
+	{
+		volatile PGPROC *proc = &ProcGlobal->allProcs[i];
+		WaitSample *sample;
+		int			pid = proc->pid;
+		uint32		wait_event_info = proc->wait_event_info;
+		BackendId	backendId = proc->backendId;
+		BackendState state = STATE_UNDEFINED;
+
+		/* skip unused entries, prepared transactions, and ourselves */
+		if (pid == 0 || pid == MyProcPid)
+			continue;
+
+		if (backendId != InvalidBackendId)
+			state = pgstat_get_backend_state(backendId);
+
+		if (wait_event_info == 0 &&
+			state != STATE_RUNNING && state != STATE_FASTPATH)
+			continue;
+
+		sample = &WaitSamplerShmem->samples[WaitSamplerShmem->nwritten %
+											wait_sampling_history_size];
+		sample->ts = now;
+		sample->pid = pid;
+		sample->wait_event_info = wait_event_info;
+		sample->queryid = proc->queryId;
+		sample->state = state;
+		WaitSamplerShmem->nwritten++;
+	}
+
+	LWLockRelease(WaitSamplingLock);
+}
+
+/*
+ * Return a palloc'd copy of the samples currently in the ring buffer,
+ * oldest first.
+ */
+WaitSample *
+WaitSamplerGetSamples(int *nsamples)
+{
+	WaitSample *result;
+	uint64		nwritten;
+	int			n;
+	int			start;
+
+	if (WaitSamplerShmem == NULL)
+	{
+		*nsamples = 0;
+		return NULL;
+	}
+
+	/* Allocate before taking the lock, the buffer might be large */
+	result = (WaitSample *) palloc(wait_sampling_history_size *
+								   sizeof(WaitSample));
+
+	LWLockAcquire(WaitSamplingLock, LW_SHARED);
+
+	nwritten = WaitSamplerShmem->nwritten;
+	if (nwritten <= (uint64) wait_sampling_history_size)
+	{
+		n = (int) nwritten;
+		start = 0;
+	}
+	else
+	{
+		n = wait_sampling_history_size;
+		start = (int) (nwritten % wait_sampling_history_size);
+	}
+
+	/* copy in two pieces, from the oldest sample to the end and the rest */
+	memcpy(result, &WaitSamplerShmem->samples[start],
+		   (n - start) * sizeof(WaitSample));
+	memcpy(result + (n - start), WaitSamplerShmem->samples,
+		   start * sizeof(WaitSample));
+
+	LWLockRelease(WaitSamplingLock);
+
+	*nsamples = n;
+	return result;
+}
+
+/*
+ * WaitSamplerShmemSize
+ *		Compute space needed for the wait sampler's shared memory
+ */
+Size
+WaitSamplerShmemSize(void)
+{
+	Size		size;
+
+	if (wait_sampling_history_size <= 0)
+		return 0;
+
+	size = offsetof(WaitSamplerShmemStruct, samples);
+	size = add_size(size, mul_size(wait_sampling_history_size,
+								   sizeof(WaitSample)));
+	return size;
+}
+
+/*
+ * WaitSamplerShmemInit
+ *		Allocate and initialize the wait sampler's shared memory
+ */
+void
+WaitSamplerShmemInit(void)
+{
+	bool		found;
+
+	if (wait_sampling_history_size <= 0)
+		return;
+
+	WaitSamplerShmem = (WaitSamplerShmemStruct *)
+		ShmemInitStruct("Wait Sampler Data",
+						WaitSamplerShmemSize(),
+						&found);
+
+	if (!found)
+		WaitSamplerShmem->nwritten = 0;
+}
+
+
+/* --------------------------------
+ *		signal handler routines
+ * --------------------------------
+ */
+
+/* SIGHUP: set flag to re-read config file at next convenient time */
+static void
+WaitSamplerSigHupHandler(SIGNAL_ARGS)
+{
+	int			save_errno = errno;
+
+	got_SIGHUP = true;
+	SetLatch(MyLatch);
+
+	errno = save_errno;
+}
+
+/* SIGTERM: set flag to exit normally */
+static void
+WaitSamplerSigTermHandler(SIGNAL_ARGS)
+{
+	int			save_errno = errno;
+
+	got_SIGTERM = true;
+	SetLatch(MyLatch);
+
+	errno = save_errno;
+}
@@ -17,6 +17,7 @@
 #include "access/heapam.h"
 #include "access/htup_details.h"
 #include "access/multixact.h"
+#include "access/tableam.h"
 #include "access/transam.h"
 #include "access/xact.h"
 #include "catalog/catalog.h"
@@ -25,6 +26,7 @@
 #include "catalog/indexing.h"
 #include "catalog/namespace.h"
 #include "catalog/objectaccess.h"
+#include "catalog/pg_am.h"
 #include "catalog/pg_rewrite.h"
 #include "catalog/storage.h"
 #include "commands/policy.h"
@@ -421,17 +423,21 @@ DefineQueryRewrite(char *rulename,
 		if (event_relation->rd_rel->relkind != RELKIND_VIEW &&
 			event_relation->rd_rel->relkind != RELKIND_MATVIEW)
 		{
-			HeapScanDesc scanDesc;
+			TableScanDesc scanDesc;
+			TupleTableSlot *slot;
 			Snapshot	snapshot;
 
 			snapshot = RegisterSnapshot(GetLatestSnapshot());
-			scanDesc = heap_beginscan(event_relation, snapshot, 0, NULL);
-			if (heap_getnext(scanDesc, ForwardScanDirection) != NULL)
+			slot = MakeSingleTupleTableSlot(RelationGetDescr(event_relation));
+			scanDesc = table_beginscan(event_relation, snapshot, 0, NULL);
+			if (table_getnextslot(event_relation, scanDesc,
+								  ForwardScanDirection, slot))
 				ereport(ERROR,
 						(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
 						 errmsg("could not convert table \"%s\" to a view because it is not empty",
 								RelationGetRelationName(event_relation))));
-			heap_endscan(scanDesc);
+			table_endscan(event_relation, scanDesc);
+			ExecDropSingleTupleTableSlot(slot);
 			UnregisterSnapshot(snapshot);
 
 			if (event_relation->rd_rel->relhastriggers)
@@ -557,6 +563,12 @@ DefineQueryRewrite(char *rulename,
 		RelationDropStorage(event_relation);
 		DeleteSystemAttributeTuples(event_relid);
 
+		/* views have no table access method */
+		if (OidIsValid(event_relation->rd_rel->relam))
+			deleteDependencyRecordsForClass(RelationRelationId, event_relid,
+											AccessMethodRelationId,
+											DEPENDENCY_NORMAL);
+
 		/*
 		 * Drop the toast table if any.  (This won't take care of updating the
 		 * toast fields in the relation's own pg_class entry; we handle that
@@ -601,6 +613,7 @@ DefineQueryRewrite(char *rulename,
 		classForm = (Form_pg_class) GETSTRUCT(classTup);
 
 		classForm->reltablespace = InvalidOid;
+		classForm->relam = InvalidOid;
 		classForm->relpages = 0;
 		classForm->reltuples = 0;
 		classForm->relallvisible = 0;
@@ -618,7 +618,7 @@ fsm_extend(Relation rel, BlockNumber fsm_nblocks)
 	if ((rel->rd_smgr->smgr_fsm_nblocks == 0 ||
 		 rel->rd_smgr->smgr_fsm_nblocks == InvalidBlockNumber) &&
 		!smgrexists(rel->rd_smgr, FSM_FORKNUM))
-		smgrcreate(rel->rd_smgr, FSM_FORKNUM, false);
+		smgrcreate(rel->rd_smgr, FSM_FORKNUM, false, false);
 
 	fsm_nblocks_now = smgrnblocks(rel->rd_smgr, FSM_FORKNUM);
 
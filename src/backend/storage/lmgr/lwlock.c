@@ -72,20 +72,40 @@
  *
  * This protects us against the problem from above as nobody can release too
  *	  quick, before we're queued, since after Phase 2 we're already queued.
+ *
+ * Going to sleep on the semaphore is expensive, both for us and for the
+ * releaser who has to wake us up, and most LWLocks are held only for a few
+ * hundred instructions.  So between Phase 1 and Phase 2 we first spin for a
+ * while, watching the lock state with plain reads so that we don't pull the
+ * cache line away from the holder, and retry as soon as the lock looks free.
+ * How long we spin adapts to how often spinning has paid off recently, much
+ * like spins_per_delay in s_lock.c: on a uniprocessor, or when locks are held
+ * for long periods, it quickly shrinks to a token amount.  Hold times differ
+ * a lot between locks, so the amount is tracked separately for each of the
+ * individual locks in the main array and for each tranche.
+ *
+ * Contended acquisitions are counted in shared memory, per lock for the
+ * locks in the main array and per tranche for all others, and exposed in
+ * the pg_stat_lwlocks view.  Uncontended acquisitions don't touch the
+ * counters, so that the fast path stays free of additional shared writes.
  * -------------------------------------------------------------------------
  */
 #include "postgres.h"
 
+#include "funcapi.h"
 #include "miscadmin.h"
 #include "pgstat.h"
 #include "pg_trace.h"
+#include "portability/instr_time.h"
 #include "postmaster/postmaster.h"
 #include "replication/slot.h"
 #include "storage/ipc.h"
 #include "storage/predicate.h"
 #include "storage/proc.h"
 #include "storage/spin.h"
+#include "utils/builtins.h"
 #include "utils/memutils.h"
+#include "utils/tuplestore.h"
 
 #ifdef LWLOCK_STATS
 #include "utils/hsearch.h"
@@ -106,6 +126,56 @@ extern slock_t *ShmemLock;
 /* Must be greater than MAX_BACKENDS - which is 2^23-1, so we're fine. */
 #define LW_SHARED_MASK				((uint32) ((1 << 24)-1))
 
+/*
+ * Bounds for the number of times LWLockAcquire spins waiting for a contended
+ * lock to become free before it queues itself and sleeps.  The current value
+ * is grown by LWLOCK_SPINS_INCREASE whenever spinning gets us the lock, and
+ * shrunk by LWLOCK_SPINS_DECREASE whenever it doesn't.
+ */
+#define MIN_LWLOCK_SPINS			10
+#define MAX_LWLOCK_SPINS			1000
+#define DEFAULT_LWLOCK_SPINS		100
+#define LWLOCK_SPINS_INCREASE		100
+#define LWLOCK_SPINS_DECREASE		10
+
+/*
+ * Contention counters for one LWLock, or for all LWLocks of a tranche.
+ */
+typedef struct LWLockContentionStats
+{
+	pg_atomic_uint64 contended; /* acquisitions that found the lock taken */
+	pg_atomic_uint64 spin_acquired;		/* ... and got it by spinning */
+	pg_atomic_uint64 blocked;	/* times we slept waiting for the lock */
+	pg_atomic_uint64 wait_time; /* time slept, in microseconds */
+} LWLockContentionStats;
+
+/*
+ * Counters are kept per lock for the first nmainlocks entries, one for each
+ * lock in MainLWLockArray, followed by LWLOCK_STATS_TRANCHES per-tranche
+ * entries for locks stored elsewhere.  Locks of tranches with higher IDs
+ * are not tracked.
+ */
+#define LWLOCK_STATS_TRANCHES		64
+
+struct LWLockStatsData
+{
+	int			nmainlocks;
+	LWLockContentionStats slots[FLEXIBLE_ARRAY_MEMBER];
+};
+
+LWLockStatsData *LWLockStats = NULL;
+
+/*
+ * Current number of spins, in this backend, for each individual lock of the
+ * main array, followed by one entry for each of the first
+ * LWLOCK_STATS_TRANCHES tranches, and one shared by all other tranches.
+ * Zero stands for DEFAULT_LWLOCK_SPINS.
+ */
+#define LWLOCK_SPIN_SLOTS \
+	(NUM_INDIVIDUAL_LWLOCKS + LWLOCK_STATS_TRANCHES + 1)
+
+static int	lwlock_spins[LWLOCK_SPIN_SLOTS];
+
 /*
  * This is indexed by tranche ID and stores metadata for all tranches known
  * to the current backend.
@@ -130,6 +200,7 @@ static LWLockTranche MainLWLockTranche;
 static LWLockTranche BufMappingLWLockTranche;
 static LWLockTranche LockManagerLWLockTranche;
 static LWLockTranche PredicateLockManagerLWLockTranche;
+static LWLockTranche PgStatTablesLWLockTranche;
 
 /*
  * We use this structure to keep track of locked LWLocks for release
@@ -399,6 +470,12 @@ LWLockShmemSize(void)
 	for (i = 0; i < NamedLWLockTrancheRequests; i++)
 		size = add_size(size, strlen(NamedLWLockTrancheRequestArray[i].tranche_name) + 1);
 
+	/* space for contention counters */
+	size = add_size(size, MAXIMUM_ALIGNOF);
+	size = add_size(size, offsetof(LWLockStatsData, slots));
+	size = add_size(size, mul_size(numLocks + LWLOCK_STATS_TRANCHES,
+								   sizeof(LWLockContentionStats)));
+
 	/* Disallow named LWLocks' requests after startup */
 	lock_named_request_allowed = false;
 
@@ -424,10 +501,25 @@ CreateLWLocks(void)
 		Size		spaceLocks = LWLockShmemSize();
 		int		   *LWLockCounter;
 		char	   *ptr;
+		int			nmainlocks;
+		int			i;
 
 		/* Allocate space */
 		ptr = (char *) ShmemAlloc(spaceLocks);
 
+		/* Contention counters go first */
+		nmainlocks = NUM_FIXED_LWLOCKS + NumLWLocksByNamedTranches();
+		LWLockStats = (LWLockStatsData *) MAXALIGN(ptr);
+		LWLockStats->nmainlocks = nmainlocks;
+		for (i = 0; i < nmainlocks + LWLOCK_STATS_TRANCHES; i++)
+		{
+			pg_atomic_init_u64(&LWLockStats->slots[i].contended, 0);
+			pg_atomic_init_u64(&LWLockStats->slots[i].spin_acquired, 0);
+			pg_atomic_init_u64(&LWLockStats->slots[i].blocked, 0);
+			pg_atomic_init_u64(&LWLockStats->slots[i].wait_time, 0);
+		}
+		ptr = (char *) &LWLockStats->slots[nmainlocks + LWLOCK_STATS_TRANCHES];
+
 		/* Leave room for dynamic allocation of tranches */
 		ptr += sizeof(int);
 
@@ -483,6 +575,11 @@ InitializeLWLocks(void)
 	for (id = 0; id < NUM_PREDICATELOCK_PARTITIONS; id++, lock++)
 		LWLockInitialize(&lock->lock, LWTRANCHE_PREDICATE_LOCK_MANAGER);
 
+	/* Initialize table statistics LWLocks in main array */
+	lock = MainLWLockArray + PGSTAT_TABLES_LWLOCK_OFFSET;
+	for (id = 0; id < NUM_PGSTAT_PARTITIONS; id++, lock++)
+		LWLockInitialize(&lock->lock, LWTRANCHE_PGSTAT_TABLES);
+
 	/* Initialize named tranches. */
 	if (NamedLWLockTrancheRequests > 0)
 	{
@@ -557,6 +654,12 @@ RegisterLWLockTranches(void)
 	PredicateLockManagerLWLockTranche.array_stride = sizeof(LWLockPadded);
 	LWLockRegisterTranche(LWTRANCHE_PREDICATE_LOCK_MANAGER, &PredicateLockManagerLWLockTranche);
 
+	PgStatTablesLWLockTranche.name = "pgstat_tables";
+	PgStatTablesLWLockTranche.array_base = MainLWLockArray +
+		PGSTAT_TABLES_LWLOCK_OFFSET;
+	PgStatTablesLWLockTranche.array_stride = sizeof(LWLockPadded);
+	LWLockRegisterTranche(LWTRANCHE_PGSTAT_TABLES, &PgStatTablesLWLockTranche);
+
 	/* Register named tranches. */
 	for (i = 0; i < NamedLWLockTrancheRequests; i++)
 		LWLockRegisterTranche(NamedLWLockTrancheArray[i].trancheId,
@@ -842,6 +945,86 @@ LWLockAttemptLock(LWLock *lock, LWLockMode mode)
 	pg_unreachable();
 }
 
+/*
+ * Find the contention counters for a lock, or NULL if it isn't tracked.
+ */
+static LWLockContentionStats *
+LWLockGetContentionStats(LWLock *lock)
+{
+	char	   *base = (char *) MainLWLockArray;
+
+	if (LWLockStats == NULL)
+		return NULL;
+
+	if ((char *) lock >= base &&
+		(char *) lock < base + LWLockStats->nmainlocks * sizeof(LWLockPadded))
+		return &LWLockStats->slots[((char *) lock - base) / sizeof(LWLockPadded)];
+
+	if (lock->tranche < LWLOCK_STATS_TRANCHES)
+		return &LWLockStats->slots[LWLockStats->nmainlocks + lock->tranche];
+
+	return NULL;
+}
+
+/*
+ * Return the entry of lwlock_spins that applies to the lock.
+ */
+static int *
+LWLockGetSpins(LWLock *lock)
+{
+	char	   *base = (char *) MainLWLockArray;
+	int			slot;
+
+	if ((char *) lock >= base &&
+		(char *) lock < base + NUM_INDIVIDUAL_LWLOCKS * sizeof(LWLockPadded))
+		slot = ((char *) lock - base) / sizeof(LWLockPadded);
+	else if (lock->tranche < LWLOCK_STATS_TRANCHES)
+		slot = NUM_INDIVIDUAL_LWLOCKS + lock->tranche;
+	else
+		slot = NUM_INDIVIDUAL_LWLOCKS + LWLOCK_STATS_TRANCHES;
+
+	if (lwlock_spins[slot] == 0)
+		lwlock_spins[slot] = DEFAULT_LWLOCK_SPINS;
+	return &lwlock_spins[slot];
+}
+
+/*
+ * Spin until the lock looks free, then try to grab it.
+ *
+ * Returns true if the lock still isn't ours after the current number of
+ * spins for this lock, like LWLockAttemptLock.  Adjusts that number
+ * depending on the outcome.
+ */
+static bool
+LWLockSpinAttemptLock(LWLock *lock, LWLockMode mode)
+{
+	int		   *maxspins = LWLockGetSpins(lock);
+	uint32		mask;
+	int			spins;
+
+	/* the bits that must be clear for us to get the lock */
+	mask = (mode == LW_EXCLUSIVE) ? LW_LOCK_MASK : LW_VAL_EXCLUSIVE;
+
+	for (spins = 0; spins < *maxspins; spins++)
+	{
+		pg_spin_delay();
+
+		if ((pg_atomic_read_u32(&lock->state) & mask) != 0)
+			continue;
+
+		if (!LWLockAttemptLock(lock, mode))
+		{
+			*maxspins = Min(*maxspins + LWLOCK_SPINS_INCREASE,
+							MAX_LWLOCK_SPINS);
+			return false;
+		}
+	}
+
+	*maxspins = Max(*maxspins - LWLOCK_SPINS_DECREASE,
+					MIN_LWLOCK_SPINS);
+	return true;
+}
+
 /*
  * Lock the LWLock's wait list against concurrent activity.
  *
@@ -1169,6 +1352,7 @@ LWLockAcquire(LWLock *lock, LWLockMode mode)
 	PGPROC	   *proc = MyProc;
 	bool		result = true;
 	int			extraWaits = 0;
+	LWLockContentionStats *cstats = NULL;
 #ifdef LWLOCK_STATS
 	lwlock_stats *lwstats;
 
@@ -1224,6 +1408,8 @@ LWLockAcquire(LWLock *lock, LWLockMode mode)
 	for (;;)
 	{
 		bool		mustwait;
+		instr_time	wait_start;
+		instr_time	wait_time;
 
 		/*
 		 * Try to grab the lock the first time, we're not in the waitqueue
@@ -1237,6 +1423,28 @@ LWLockAcquire(LWLock *lock, LWLockMode mode)
 			break;				/* got the lock */
 		}
 
+		/* Count the contention once, not on every retry after wakeup */
+		if (result)
+		{
+			cstats = LWLockGetContentionStats(lock);
+			if (cstats)
+				pg_atomic_fetch_add_u64(&cstats->contended, 1);
+		}
+
+		/*
+		 * The holder will likely release the lock soon, so spin for a bit
+		 * before resorting to sleeping.
+		 */
+		mustwait = LWLockSpinAttemptLock(lock, mode);
+
+		if (!mustwait)
+		{
+			LOG_LWDEBUG("LWLockAcquire", lock, "acquired lock by spinning");
+			if (cstats)
+				pg_atomic_fetch_add_u64(&cstats->spin_acquired, 1);
+			break;				/* got the lock */
+		}
+
 		/*
 		 * Ok, at this point we couldn't grab the lock on the first try. We
 		 * cannot simply queue ourselves to the end of the list and wait to be
@@ -1284,6 +1492,9 @@ LWLockAcquire(LWLock *lock, LWLockMode mode)
 		LWLockReportWaitStart(lock);
 		TRACE_POSTGRESQL_LWLOCK_WAIT_START(T_NAME(lock), T_ID(lock), mode);
 
+		if (cstats)
+			INSTR_TIME_SET_CURRENT(wait_start);
+
 		for (;;)
 		{
 			PGSemaphoreLock(&proc->sem);
@@ -1295,6 +1506,15 @@ LWLockAcquire(LWLock *lock, LWLockMode mode)
 		/* Retrying, allow LWLockRelease to release waiters again. */
 		pg_atomic_fetch_or_u32(&lock->state, LW_FLAG_RELEASE_OK);
 
+		if (cstats)
+		{
+			INSTR_TIME_SET_CURRENT(wait_time);
+			INSTR_TIME_SUBTRACT(wait_time, wait_start);
+			pg_atomic_fetch_add_u64(&cstats->blocked, 1);
+			pg_atomic_fetch_add_u64(&cstats->wait_time,
+									INSTR_TIME_GET_MICROSEC(wait_time));
+		}
+
 #ifdef LOCK_DEBUG
 		{
 			/* not waiting anymore */
@@ -1900,3 +2120,155 @@ LWLockHeldByMe(LWLock *l)
 	}
 	return false;
 }
+
+/*
+ * LWLockResetContentionStats - zero the counters shown in pg_stat_lwlocks
+ */
+void
+LWLockResetContentionStats(void)
+{
+	int			i;
+
+	if (LWLockStats == NULL)
+		return;
+
+	for (i = 0; i < LWLockStats->nmainlocks + LWLOCK_STATS_TRANCHES; i++)
+	{
+		pg_atomic_write_u64(&LWLockStats->slots[i].contended, 0);
+		pg_atomic_write_u64(&LWLockStats->slots[i].spin_acquired, 0);
+		pg_atomic_write_u64(&LWLockStats->slots[i].blocked, 0);
+		pg_atomic_write_u64(&LWLockStats->slots[i].wait_time, 0);
+	}
+}
+
+/*
+ * Does the given tranche keep its locks in MainLWLockArray?  Such locks
+ * have counters of their own, so the tranche has no per-tranche counters.
+ */
+static bool
+LWLockTrancheIsInMainArray(int tranche_id)
+{
+	int			i;
+
+	if (tranche_id == LWTRANCHE_MAIN ||
+		tranche_id == LWTRANCHE_BUFFER_MAPPING ||
+		tranche_id == LWTRANCHE_LOCK_MANAGER ||
+		tranche_id == LWTRANCHE_PREDICATE_LOCK_MANAGER ||
+		tranche_id == LWTRANCHE_PGSTAT_TABLES)
+		return true;
+
+	for (i = 0; i < NamedLWLockTrancheRequests; i++)
+	{
+		if (NamedLWLockTrancheArray[i].trancheId == tranche_id)
+			return true;
+	}
+	return false;
+}
+
+/*
+ * SQL function pg_stat_get_lwlocks
+ *
+ * Returns the contention counters: one row for each lock in the main array,
+ * and one row for each other tranche that is known to this backend or has
+ * seen contention.
+ */
+Datum
+pg_stat_get_lwlocks(PG_FUNCTION_ARGS)
+{
+#define PG_STAT_GET_LWLOCKS_COLS	7
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	TupleDesc	tupdesc;
+	Tuplestorestate *tupstore;
+	MemoryContext per_query_ctx;
+	MemoryContext oldcontext;
+	int			i;
+
+	/* check to see if caller supports us returning a tuplestore */
+	if (rsinfo == NULL || !IsA(rsinfo, ReturnSetInfo))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("set-valued function called in context that cannot accept a set")));
+	if (!(rsinfo->allowedModes & SFRM_Materialize))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("materialize mode required, but it is not " \
+						"allowed in this context")));
+
+	/* Build a tuple descriptor for our result type */
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+
+	per_query_ctx = rsinfo->econtext->ecxt_per_query_memory;
+	oldcontext = MemoryContextSwitchTo(per_query_ctx);
+
+	tupstore = tuplestore_begin_heap(true, false, work_mem);
+	rsinfo->returnMode = SFRM_Materialize;
+	rsinfo->setResult = tupstore;
+	rsinfo->setDesc = tupdesc;
+
+	MemoryContextSwitchTo(oldcontext);
+
+	for (i = 0; LWLockStats != NULL &&
+		 i < LWLockStats->nmainlocks + LWLOCK_STATS_TRANCHES; i++)
+	{
+		LWLockContentionStats *cstats = &LWLockStats->slots[i];
+		Datum		values[PG_STAT_GET_LWLOCKS_COLS];
+		bool		nulls[PG_STAT_GET_LWLOCKS_COLS];
+		const char *tranche_name;
+		uint64		contended = pg_atomic_read_u64(&cstats->contended);
+
+		MemSet(nulls, 0, sizeof(nulls));
+
+		if (i < LWLockStats->nmainlocks)
+		{
+			LWLock	   *lock = &MainLWLockArray[i].lock;
+
+			if (lock->tranche >= LWLockTranchesAllocated ||
+				LWLockTrancheArray[lock->tranche] == NULL)
+				continue;
+
+			tranche_name = T_NAME(lock);
+			if (lock->tranche == LWTRANCHE_MAIN)
+			{
+				/* skip over gaps in the numbering of individual locks */
+				if (strncmp(MainLWLockNames[i], "<unassigned", 11) == 0)
+					continue;
+				values[1] = CStringGetTextDatum(MainLWLockNames[i]);
+			}
+			else
+				nulls[1] = true;
+			values[2] = Int32GetDatum(T_ID(lock));
+		}
+		else
+		{
+			int			tranche_id = i - LWLockStats->nmainlocks;
+
+			if (LWLockTrancheIsInMainArray(tranche_id))
+				continue;
+
+			if (tranche_id < LWLockTranchesAllocated &&
+				LWLockTrancheArray[tranche_id] != NULL)
+				tranche_name = LWLockTrancheArray[tranche_id]->name;
+			else if (contended > 0)
+				tranche_name = "extension";
+			else
+				continue;
+			nulls[1] = true;
+			nulls[2] = true;
+		}
+
+		values[0] = CStringGetTextDatum(tranche_name);
+		values[3] = Int64GetDatum((int64) contended);
+		values[4] = Int64GetDatum((int64) pg_atomic_read_u64(&cstats->spin_acquired));
+		values[5] = Int64GetDatum((int64) pg_atomic_read_u64(&cstats->blocked));
+		/* convert to msec */
+		values[6] = Float8GetDatum(pg_atomic_read_u64(&cstats->wait_time) / 1000.0);
+
+		tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+	}
+
+	/* clean up and return the tuplestore */
+	tuplestore_donestoring(tupstore);
+
+	return (Datum) 0;
+}
@@ -408,6 +408,7 @@ InitProcess(void)
 
 	/* Initialize wait event information. */
 	MyProc->wait_event_info = 0;
+	MyProc->queryId = 0;
 
 	/*
 	 * Acquire ownership of the PGPROC's latch, so that we can use WaitLatch
@@ -550,6 +551,8 @@ InitAuxiliaryProcess(void)
 	MyProc->lwWaitMode = 0;
 	MyProc->waitLock = NULL;
 	MyProc->waitProcLock = NULL;
+	MyProc->wait_event_info = 0;
+	MyProc->queryId = 0;
 #ifdef USE_ASSERT_CHECKING
 	{
 		int			i;
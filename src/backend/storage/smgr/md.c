@@ -28,14 +28,17 @@
 #include "miscadmin.h"
 #include "access/xlog.h"
 #include "catalog/catalog.h"
+#include "common/pg_lzcompress.h"
 #include "portability/instr_time.h"
 #include "postmaster/bgwriter.h"
 #include "storage/fd.h"
 #include "storage/bufmgr.h"
+#include "storage/lwlock.h"
 #include "storage/relfilenode.h"
 #include "storage/smgr.h"
 #include "utils/hsearch.h"
 #include "utils/memutils.h"
+#include "utils/timestamp.h"
 #include "pg_trace.h"
 
 
@@ -112,12 +115,100 @@ typedef struct _MdfdVec
 {
 	File		mdfd_vfd;		/* fd number in fd.c's pool */
 	BlockNumber mdfd_segno;		/* segment number, from 0 */
+	bool		mdfd_compressed;	/* segment stores compressed pages? */
 	struct _MdfdVec *mdfd_chain;	/* next segment, or NULL */
 } MdfdVec;
 
 static MemoryContext MdCxt;		/* context for all MdfdVec objects */
 
 
+/*
+ *	The main and init forks of a relation can be created with compressed
+ *	pages (see RelationCreateStorage).  Each of their segment files then
+ *	consists of
+ *		-- a PageCompressHeader, giving the length of the segment in blocks
+ *		   and where each part of the address map is,
+ *		-- PC_CHUNK_SIZE chunks, numbered from 1 in the order they were
+ *		   allocated, holding the compressed pages and the address map.
+ *	The address map has a PageCompressAddr for each block.  It is allocated
+ *	PC_GROUP_SIZE blocks at a time, as the first of them is written, so that
+ *	a small relation takes little more room than its compressed pages.
+ *	Whether a fork is compressed is recorded nowhere else: mdopen() looks for
+ *	the header in the first segment, and the other segments follow it.
+ *
+ *	A block keeps the chunks it has been given, and only gets more when its
+ *	page compresses worse than ever before, so writing a page never moves
+ *	the pages of other blocks.  A page of zeroes takes no chunks at all, and
+ *	a page that would not save a chunk is stored uncompressed.  Truncation
+ *	keeps the chunks of the blocks it removes, for reuse when the relation
+ *	grows again, unless it empties the segment.
+ *
+ *	The buffer manager makes sure only one process writes a given block at a
+ *	time, and relations are only extended under the relation extension lock,
+ *	so the only updates that can race are those of the segment header;
+ *	PageCompressLock serializes them.  The header is not fsync'd as chunks
+ *	are allocated, though, so see mdc_read_alloc_header for how the
+ *	allocations survive an operating system crash.
+ *
+ *	Pages are compressed and decompressed only here, so shared buffers hold
+ *	them uncompressed as always.  A write replaces the page's image in
+ *	place, so a torn write leaves a page that can't be decompressed; full
+ *	page writes repair that during crash recovery, as they do for regular
+ *	pages.  That only works if every write, even one of just hint bits, was
+ *	WAL-logged since the last checkpoint, so compressed relations can only
+ *	be created with full_page_writes, and wal_log_hints or data checksums,
+ *	enabled; see CheckPageCompressionSettings.
+ */
+#define PC_MAGIC			0x50474331	/* "PGC1" */
+#define PC_CHUNK_SIZE		(BLCKSZ / 8)
+#define PC_MAX_CHUNKS		(BLCKSZ / PC_CHUNK_SIZE)
+#define PC_GROUP_SIZE		256		/* blocks per part of the address map */
+#define PC_NGROUPS			((RELSEG_SIZE + PC_GROUP_SIZE - 1) / PC_GROUP_SIZE)
+#define PC_RESERVE_CHUNKS	1024	/* chunks to reserve at a time */
+
+typedef struct PageCompressHeader
+{
+	uint32		pc_magic;		/* PC_MAGIC */
+	uint32		pc_chunk_size;	/* PC_CHUNK_SIZE */
+	uint32		pc_nblocks;		/* length of the segment in blocks */
+	uint32		pc_nchunks;		/* number of chunks allocated */
+	TimestampTz pc_startup;		/* PgStartTime of the last allocation */
+	uint32		pc_reserved;	/* chunks that may be handed out */
+	uint32		pc_reserving;	/* chunks reserved, possibly not yet fsync'd */
+	uint32		pc_groups[PC_NGROUPS];	/* first chunk of each part of the
+										 * address map, or 0 if none yet */
+} PageCompressHeader;
+
+/* the part of the header that mdc_read_header and mdc_write_header cover */
+#define PC_FIXED_SIZE		offsetof(PageCompressHeader, pc_groups)
+
+typedef struct PageCompressAddr
+{
+	uint16		pca_size;		/* bytes in the stored image; 0 for a page of
+								 * zeroes, BLCKSZ if stored uncompressed */
+	uint8		pca_nchunks;	/* chunks holding the image */
+	uint8		pca_allocated;	/* chunks owned by the block */
+	uint32		pca_chunknos[PC_MAX_CHUNKS];	/* owned chunks, in order */
+} PageCompressAddr;
+
+/* chunks taken by one part of the address map */
+#define PC_GROUP_CHUNKS \
+	((PC_GROUP_SIZE * sizeof(PageCompressAddr) + PC_CHUNK_SIZE - 1) / \
+	 PC_CHUNK_SIZE)
+
+/* file offsets within a compressed segment */
+#define PC_GROUP_POS(group) \
+	(PC_FIXED_SIZE + (off_t) (group) * sizeof(uint32))
+#define PC_HEADER_SIZE \
+	((PC_GROUP_POS(PC_NGROUPS) + PC_CHUNK_SIZE - 1) / PC_CHUNK_SIZE * \
+	 PC_CHUNK_SIZE)
+#define PC_CHUNK_POS(chunkno) \
+	(PC_HEADER_SIZE + (off_t) ((chunkno) - 1) * PC_CHUNK_SIZE)
+
+/* workspace for compressing and decompressing a page */
+static char *mdc_buffer;
+
+
 /*
  * In some contexts (currently, standalone backends and the checkpointer)
  * we keep track of pending fsync operations: we need to remember all relation
@@ -198,6 +289,16 @@ static MdfdVec *_mdfd_getseg(SMgrRelation reln, ForkNumber forkno,
 			 BlockNumber blkno, bool skipFsync, int behavior);
 static BlockNumber _mdnblocks(SMgrRelation reln, ForkNumber forknum,
 		   MdfdVec *seg);
+static bool mdc_detect(MdfdVec *seg);
+static void mdc_read_header(MdfdVec *seg, PageCompressHeader *hdr);
+static void mdc_write_header(MdfdVec *seg, PageCompressHeader *hdr);
+static void mdc_extend(MdfdVec *seg, BlockNumber segblocks);
+static void mdc_truncate(MdfdVec *seg, BlockNumber segblocks);
+static bool mdc_read(MdfdVec *seg, BlockNumber blocknum, char *buffer);
+static void mdc_write(MdfdVec *seg, BlockNumber blocknum, char *buffer);
+#ifdef USE_PREFETCH
+static void mdc_prefetch(MdfdVec *seg, BlockNumber blocknum);
+#endif
 
 
 /*
@@ -212,6 +313,16 @@ mdinit(void)
 								  ALLOCSET_DEFAULT_INITSIZE,
 								  ALLOCSET_DEFAULT_MAXSIZE);
 
+	/* chunk numbers of a compressed segment must fit in a uint32 */
+	StaticAssertStmt((uint64) RELSEG_SIZE * PC_MAX_CHUNKS <= PG_UINT32_MAX,
+					 "RELSEG_SIZE too large for compressed segments");
+
+	/*
+	 * Allocate this up front, as writes may happen in critical sections,
+	 * where we mustn't allocate memory.
+	 */
+	mdc_buffer = MemoryContextAlloc(MdCxt, PGLZ_MAX_OUTPUT(BLCKSZ));
+
 	/*
 	 * Create pending-operations hashtable if we need it.  Currently, we need
 	 * it if we are standalone (not under a postmaster) or if we are a startup
@@ -293,18 +404,24 @@ mdexists(SMgrRelation reln, ForkNumber forkNum)
 /*
  *	mdcreate() -- Create a new relation on magnetic disk.
  *
- * If isRedo is true, it's okay for the relation to exist already.
+ * If isRedo is true, it's okay for the relation to exist already.  If
+ * compress is true, the fork stores compressed pages, unless it exists
+ * already and says otherwise.
  */
 void
-mdcreate(SMgrRelation reln, ForkNumber forkNum, bool isRedo)
+mdcreate(SMgrRelation reln, ForkNumber forkNum, bool isRedo, bool compress)
 {
 	char	   *path;
 	File		fd;
+	bool		existed = false;
+	MdfdVec    *v;
 
 	if (isRedo && reln->md_fd[forkNum] != NULL)
 		return;					/* created and opened already... */
 
 	Assert(reln->md_fd[forkNum] == NULL);
+	Assert(!compress ||
+		   forkNum == MAIN_FORKNUM || forkNum == INIT_FORKNUM);
 
 	path = relpath(reln->smgr_rnode, forkNum);
 
@@ -321,7 +438,10 @@ mdcreate(SMgrRelation reln, ForkNumber forkNum, bool isRedo)
 		 * already, even if isRedo is not set.  (See also mdopen)
 		 */
 		if (isRedo || IsBootstrapProcessingMode())
+		{
 			fd = PathNameOpenFile(path, O_RDWR | PG_BINARY, 0600);
+			existed = true;
+		}
 		if (fd < 0)
 		{
 			/* be sure to report the error reported by create, not open */
@@ -334,11 +454,28 @@ mdcreate(SMgrRelation reln, ForkNumber forkNum, bool isRedo)
 
 	pfree(path);
 
-	reln->md_fd[forkNum] = _fdvec_alloc();
+	reln->md_fd[forkNum] = v = _fdvec_alloc();
+
+	v->mdfd_vfd = fd;
+	v->mdfd_segno = 0;
+	v->mdfd_compressed = compress;
+	v->mdfd_chain = NULL;
 
-	reln->md_fd[forkNum]->mdfd_vfd = fd;
-	reln->md_fd[forkNum]->mdfd_segno = 0;
-	reln->md_fd[forkNum]->mdfd_chain = NULL;
+	/*
+	 * A file that exists already keeps its format, unless it's empty, as
+	 * after a crash between creating it and writing the header.
+	 */
+	if (existed && FileSeek(fd, 0L, SEEK_END) > 0)
+		v->mdfd_compressed = ((forkNum == MAIN_FORKNUM ||
+							   forkNum == INIT_FORKNUM) &&
+							  mdc_detect(v));
+	else if (compress)
+	{
+		PageCompressHeader hdr;
+
+		MemSet(&hdr, 0, sizeof(hdr));
+		mdc_write_header(v, &hdr);
+	}
 }
 
 /*
@@ -523,6 +660,17 @@ mdextend(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 
 	v = _mdfd_getseg(reln, forknum, blocknum, skipFsync, EXTENSION_CREATE);
 
+	if (v->mdfd_compressed)
+	{
+		/* store the page first, so that it's there once it's counted */
+		mdc_write(v, blocknum, buffer);
+		mdc_extend(v, blocknum % ((BlockNumber) RELSEG_SIZE) + 1);
+
+		if (!skipFsync && !SmgrIsTemp(reln))
+			register_dirty_segment(reln, forknum, v);
+		return;
+	}
+
 	seekpos = (off_t) BLCKSZ *(blocknum % ((BlockNumber) RELSEG_SIZE));
 
 	Assert(seekpos < (off_t) BLCKSZ * RELSEG_SIZE);
@@ -620,7 +768,10 @@ mdopen(SMgrRelation reln, ForkNumber forknum, int behavior)
 
 	mdfd->mdfd_vfd = fd;
 	mdfd->mdfd_segno = 0;
+	mdfd->mdfd_compressed = false;
 	mdfd->mdfd_chain = NULL;
+	if (forknum == MAIN_FORKNUM || forknum == INIT_FORKNUM)
+		mdfd->mdfd_compressed = mdc_detect(mdfd);
 	Assert(_mdnblocks(reln, forknum, mdfd) <= ((BlockNumber) RELSEG_SIZE));
 
 	return mdfd;
@@ -665,6 +816,12 @@ mdprefetch(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum)
 
 	v = _mdfd_getseg(reln, forknum, blocknum, false, EXTENSION_FAIL);
 
+	if (v->mdfd_compressed)
+	{
+		mdc_prefetch(v, blocknum);
+		return;
+	}
+
 	seekpos = (off_t) BLCKSZ *(blocknum % ((BlockNumber) RELSEG_SIZE));
 
 	Assert(seekpos < (off_t) BLCKSZ * RELSEG_SIZE);
@@ -718,7 +875,12 @@ mdwriteback(SMgrRelation reln, ForkNumber forknum,
 
 		seekpos = (off_t) BLCKSZ *(blocknum % ((BlockNumber) RELSEG_SIZE));
 
-		FileWriteback(v->mdfd_vfd, seekpos, (off_t) BLCKSZ * nflush);
+		/*
+		 * The pages of a compressed segment aren't stored in block order;
+		 * leave writing them back to the kernel.
+		 */
+		if (!v->mdfd_compressed)
+			FileWriteback(v->mdfd_vfd, seekpos, (off_t) BLCKSZ * nflush);
 
 		nblocks -= nflush;
 		blocknum += nflush;
@@ -745,17 +907,25 @@ mdread(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 	v = _mdfd_getseg(reln, forknum, blocknum, false,
 					 EXTENSION_FAIL | EXTENSION_CREATE_RECOVERY);
 
-	seekpos = (off_t) BLCKSZ *(blocknum % ((BlockNumber) RELSEG_SIZE));
+	if (v->mdfd_compressed)
+	{
+		/* a block past the end of the segment reads like one past EOF */
+		nbytes = mdc_read(v, blocknum, buffer) ? BLCKSZ : 0;
+	}
+	else
+	{
+		seekpos = (off_t) BLCKSZ *(blocknum % ((BlockNumber) RELSEG_SIZE));
 
-	Assert(seekpos < (off_t) BLCKSZ * RELSEG_SIZE);
+		Assert(seekpos < (off_t) BLCKSZ * RELSEG_SIZE);
 
-	if (FileSeek(v->mdfd_vfd, seekpos, SEEK_SET) != seekpos)
-		ereport(ERROR,
-				(errcode_for_file_access(),
-				 errmsg("could not seek to block %u in file \"%s\": %m",
-						blocknum, FilePathName(v->mdfd_vfd))));
+		if (FileSeek(v->mdfd_vfd, seekpos, SEEK_SET) != seekpos)
+			ereport(ERROR,
+					(errcode_for_file_access(),
+				   errmsg("could not seek to block %u in file \"%s\": %m",
+						  blocknum, FilePathName(v->mdfd_vfd))));
 
-	nbytes = FileRead(v->mdfd_vfd, buffer, BLCKSZ);
+		nbytes = FileRead(v->mdfd_vfd, buffer, BLCKSZ);
+	}
 
 	TRACE_POSTGRESQL_SMGR_MD_READ_DONE(forknum, blocknum,
 									   reln->smgr_rnode.node.spcNode,
@@ -821,17 +991,26 @@ mdwrite(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 	v = _mdfd_getseg(reln, forknum, blocknum, skipFsync,
 					 EXTENSION_FAIL | EXTENSION_CREATE_RECOVERY);
 
-	seekpos = (off_t) BLCKSZ *(blocknum % ((BlockNumber) RELSEG_SIZE));
+	if (v->mdfd_compressed)
+	{
+		/* mdc_write reports its own errors */
+		mdc_write(v, blocknum, buffer);
+		nbytes = BLCKSZ;
+	}
+	else
+	{
+		seekpos = (off_t) BLCKSZ *(blocknum % ((BlockNumber) RELSEG_SIZE));
 
-	Assert(seekpos < (off_t) BLCKSZ * RELSEG_SIZE);
+		Assert(seekpos < (off_t) BLCKSZ * RELSEG_SIZE);
 
-	if (FileSeek(v->mdfd_vfd, seekpos, SEEK_SET) != seekpos)
-		ereport(ERROR,
-				(errcode_for_file_access(),
-				 errmsg("could not seek to block %u in file \"%s\": %m",
-						blocknum, FilePathName(v->mdfd_vfd))));
+		if (FileSeek(v->mdfd_vfd, seekpos, SEEK_SET) != seekpos)
+			ereport(ERROR,
+					(errcode_for_file_access(),
+				   errmsg("could not seek to block %u in file \"%s\": %m",
+						  blocknum, FilePathName(v->mdfd_vfd))));
 
-	nbytes = FileWrite(v->mdfd_vfd, buffer, BLCKSZ);
+		nbytes = FileWrite(v->mdfd_vfd, buffer, BLCKSZ);
+	}
 
 	TRACE_POSTGRESQL_SMGR_MD_WRITE_DONE(forknum, blocknum,
 										reln->smgr_rnode.node.spcNode,
@@ -994,7 +1173,9 @@ mdtruncate(SMgrRelation reln, ForkNumber forknum, BlockNumber nblocks)
 			 */
 			BlockNumber lastsegblocks = nblocks - priorblocks;
 
-			if (FileTruncate(v->mdfd_vfd, (off_t) lastsegblocks * BLCKSZ) < 0)
+			if (v->mdfd_compressed)
+				mdc_truncate(v, lastsegblocks);
+			else if (FileTruncate(v->mdfd_vfd, (off_t) lastsegblocks * BLCKSZ) < 0)
 				ereport(ERROR,
 						(errcode_for_file_access(),
 					errmsg("could not truncate file \"%s\" to %u blocks: %m",
@@ -1765,6 +1946,7 @@ _mdfd_openseg(SMgrRelation reln, ForkNumber forknum, BlockNumber segno,
 	/* fill the entry */
 	v->mdfd_vfd = fd;
 	v->mdfd_segno = segno;
+	v->mdfd_compressed = reln->md_fd[forknum]->mdfd_compressed;
 	v->mdfd_chain = NULL;
 	Assert(_mdnblocks(reln, forknum, v) <= ((BlockNumber) RELSEG_SIZE));
 
@@ -1895,6 +2077,16 @@ _mdnblocks(SMgrRelation reln, ForkNumber forknum, MdfdVec *seg)
 {
 	off_t		len;
 
+	if (seg->mdfd_compressed)
+	{
+		PageCompressHeader hdr;
+
+		LWLockAcquire(PageCompressLock, LW_SHARED);
+		mdc_read_header(seg, &hdr);
+		LWLockRelease(PageCompressLock);
+		return hdr.pc_nblocks;
+	}
+
 	len = FileSeek(seg->mdfd_vfd, 0L, SEEK_END);
 	if (len < 0)
 		ereport(ERROR,
@@ -1904,3 +2096,594 @@ _mdnblocks(SMgrRelation reln, ForkNumber forknum, MdfdVec *seg)
 	/* note that this calculation will ignore any partial block at EOF */
 	return (BlockNumber) (len / BLCKSZ);
 }
+
+/*
+ * Read len bytes at pos in a compressed segment.  Whatever lies past EOF
+ * reads as zeroes, like the holes within the file.
+ */
+static void
+mdc_pread(MdfdVec *seg, off_t pos, char *buf, int len)
+{
+	int			nbytes;
+
+	if (FileSeek(seg->mdfd_vfd, pos, SEEK_SET) != pos)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not seek in file \"%s\": %m",
+						FilePathName(seg->mdfd_vfd))));
+
+	nbytes = FileRead(seg->mdfd_vfd, buf, len);
+	if (nbytes < 0)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not read file \"%s\": %m",
+						FilePathName(seg->mdfd_vfd))));
+	if (nbytes < len)
+		MemSet(buf + nbytes, 0, len - nbytes);
+}
+
+/*
+ * Write len bytes at pos in a compressed segment.
+ */
+static void
+mdc_pwrite(MdfdVec *seg, off_t pos, char *buf, int len)
+{
+	int			nbytes;
+
+	if (FileSeek(seg->mdfd_vfd, pos, SEEK_SET) != pos)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not seek in file \"%s\": %m",
+						FilePathName(seg->mdfd_vfd))));
+
+	nbytes = FileWrite(seg->mdfd_vfd, buf, len);
+	if (nbytes != len)
+	{
+		if (nbytes < 0)
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not write to file \"%s\": %m",
+							FilePathName(seg->mdfd_vfd)),
+					 errhint("Check free disk space.")));
+		/* short write: complain appropriately */
+		ereport(ERROR,
+				(errcode(ERRCODE_DISK_FULL),
+				 errmsg("could not write to file \"%s\": wrote only %d of %d bytes",
+						FilePathName(seg->mdfd_vfd),
+						nbytes, len),
+				 errhint("Check free disk space.")));
+	}
+}
+
+/*
+ * Does this segment start with the header of a compressed segment?
+ */
+static bool
+mdc_detect(MdfdVec *seg)
+{
+	PageCompressHeader hdr;
+
+	mdc_pread(seg, 0, (char *) &hdr, sizeof(hdr));
+
+	return hdr.pc_magic == PC_MAGIC && hdr.pc_chunk_size == PC_CHUNK_SIZE;
+}
+
+/*
+ * Read the header of a compressed segment, except for pc_groups.  An empty
+ * file, such as a segment truncated away earlier, has zero blocks and
+ * chunks.
+ *
+ * The caller must hold PageCompressLock.
+ */
+static void
+mdc_read_header(MdfdVec *seg, PageCompressHeader *hdr)
+{
+	mdc_pread(seg, 0, (char *) hdr, PC_FIXED_SIZE);
+
+	if (hdr->pc_magic == 0)
+		return;
+	if (hdr->pc_magic != PC_MAGIC || hdr->pc_chunk_size != PC_CHUNK_SIZE ||
+		hdr->pc_nblocks > RELSEG_SIZE)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg("invalid compressed segment header in file \"%s\"",
+						FilePathName(seg->mdfd_vfd))));
+}
+
+/*
+ * Write the header of a compressed segment, except for pc_groups.
+ *
+ * The caller must hold PageCompressLock exclusively, unless nobody else can
+ * see the file yet.
+ */
+static void
+mdc_write_header(MdfdVec *seg, PageCompressHeader *hdr)
+{
+	hdr->pc_magic = PC_MAGIC;
+	hdr->pc_chunk_size = PC_CHUNK_SIZE;
+	mdc_pwrite(seg, 0, (char *) hdr, PC_FIXED_SIZE);
+}
+
+/*
+ * Read the header of a compressed segment for allocating chunks.
+ *
+ * After an operating system crash, pc_nchunks might not count every chunk
+ * that the blocks point to, since the header isn't fsync'd along with them.
+ * So chunks are reserved PC_RESERVE_CHUNKS at a time, and a reservation is
+ * fsync'd before any chunk in it is handed out: pc_reserving is raised and
+ * fsync'd first, and only then is pc_reserved raised to match, see
+ * mdc_reserve.  The first allocation after the server has been restarted,
+ * recognized by a different PgStartTime, therefore skips everything up to
+ * pc_reserving.  A crash of just the server loses nothing, as the kernel
+ * still has all the writes.
+ *
+ * A base backup, on the other hand, copies the header before the rest of
+ * the file, so the copy's pc_reserving can be older than chunks that the
+ * copied address map points to.  Every chunk is written before anything
+ * points to it, though, so such chunks lie within the copied file, and the
+ * first allocation skips everything up to the end of the file as well.
+ *
+ * The caller must hold PageCompressLock exclusively, and write the header
+ * back if it changes anything.
+ */
+static void
+mdc_read_alloc_header(MdfdVec *seg, PageCompressHeader *hdr)
+{
+	mdc_read_header(seg, hdr);
+	if (hdr->pc_startup != PgStartTime)
+	{
+		off_t		len;
+		uint32		inuse = 0;
+
+		len = FileSeek(seg->mdfd_vfd, 0L, SEEK_END);
+		if (len < 0)
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not seek to end of file \"%s\": %m",
+							FilePathName(seg->mdfd_vfd))));
+		if (len > PC_HEADER_SIZE)
+			inuse = (len - PC_HEADER_SIZE + PC_CHUNK_SIZE - 1) / PC_CHUNK_SIZE;
+
+		hdr->pc_reserving = Max(hdr->pc_reserving, inuse);
+		hdr->pc_nchunks = hdr->pc_reserving;
+		hdr->pc_reserved = hdr->pc_reserving;
+		hdr->pc_startup = PgStartTime;
+	}
+}
+
+/*
+ * Allocate n consecutive chunks in a compressed segment from its current
+ * reservation.  Returns the number of the first, or 0 if the reservation
+ * is too small; mdc_reserve must then be called before trying again.
+ *
+ * The caller must hold PageCompressLock exclusively.
+ */
+static uint32
+mdc_allocate(MdfdVec *seg, int n)
+{
+	PageCompressHeader hdr;
+	uint32		first;
+
+	mdc_read_alloc_header(seg, &hdr);
+	if (hdr.pc_nchunks > PG_UINT32_MAX - PC_RESERVE_CHUNKS - n)
+		ereport(ERROR,
+				(errcode(ERRCODE_PROGRAM_LIMIT_EXCEEDED),
+				 errmsg("too many chunks in file \"%s\"",
+						FilePathName(seg->mdfd_vfd))));
+	if (hdr.pc_nchunks + n > hdr.pc_reserved)
+		return 0;
+
+	first = hdr.pc_nchunks + 1;
+	hdr.pc_nchunks += n;
+	mdc_write_header(seg, &hdr);
+
+	return first;
+}
+
+/*
+ * Extend the reservation of a compressed segment so that at least n more
+ * chunks can be allocated, unless another process has done so meanwhile.
+ *
+ * The caller must not hold PageCompressLock.  The reservation is fsync'd
+ * without the lock, so that other processes can go on reading and
+ * extending compressed relations meanwhile.  Processes extending the same
+ * reservation all fsync, and each of them can only publish the new
+ * reservation once its own fsync has covered it.
+ */
+static void
+mdc_reserve(MdfdVec *seg, int n)
+{
+	PageCompressHeader hdr;
+	uint32		target;
+
+	LWLockAcquire(PageCompressLock, LW_EXCLUSIVE);
+	mdc_read_alloc_header(seg, &hdr);
+	if (hdr.pc_nchunks + n <= hdr.pc_reserved)
+	{
+		/* somebody else already made room */
+		LWLockRelease(PageCompressLock);
+		return;
+	}
+	if (hdr.pc_nchunks + n > hdr.pc_reserving)
+		hdr.pc_reserving = hdr.pc_nchunks + n + PC_RESERVE_CHUNKS;
+	mdc_write_header(seg, &hdr);
+	target = hdr.pc_reserving;
+	LWLockRelease(PageCompressLock);
+
+	if (FileSync(seg->mdfd_vfd) < 0)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not fsync file \"%s\": %m",
+						FilePathName(seg->mdfd_vfd))));
+
+	/*
+	 * Publish the reservation, unless the segment was truncated or the
+	 * server restarted in the meantime.
+	 */
+	LWLockAcquire(PageCompressLock, LW_EXCLUSIVE);
+	mdc_read_header(seg, &hdr);
+	if (hdr.pc_startup == PgStartTime &&
+		hdr.pc_reserved < target && target <= hdr.pc_reserving)
+	{
+		hdr.pc_reserved = target;
+		mdc_write_header(seg, &hdr);
+	}
+	LWLockRelease(PageCompressLock);
+}
+
+/*
+ * Find the position of a block's entry in the address map.  If the part of
+ * the map it belongs in hasn't been allocated yet, allocate it if create is
+ * true, else return 0.
+ */
+static off_t
+mdc_addr_pos(MdfdVec *seg, BlockNumber segblock, bool create)
+{
+	int			group = segblock / PC_GROUP_SIZE;
+	uint32		chunkno;
+
+	mdc_pread(seg, PC_GROUP_POS(group), (char *) &chunkno, sizeof(chunkno));
+	while (chunkno == 0 && create)
+	{
+		LWLockAcquire(PageCompressLock, LW_EXCLUSIVE);
+		/* somebody else might have allocated it in the meantime */
+		mdc_pread(seg, PC_GROUP_POS(group), (char *) &chunkno,
+				  sizeof(chunkno));
+		if (chunkno != 0)
+		{
+			LWLockRelease(PageCompressLock);
+			break;
+		}
+		chunkno = mdc_allocate(seg, PC_GROUP_CHUNKS);
+		if (chunkno != 0)
+		{
+			char		zeroes[PC_CHUNK_SIZE];
+			int			i;
+
+			/*
+			 * Write out the new part of the map before pointing to it, see
+			 * mdc_read_alloc_header.
+			 */
+			MemSet(zeroes, 0, sizeof(zeroes));
+			for (i = 0; i < PC_GROUP_CHUNKS; i++)
+				mdc_pwrite(seg, PC_CHUNK_POS(chunkno + i), zeroes,
+						   PC_CHUNK_SIZE);
+			mdc_pwrite(seg, PC_GROUP_POS(group), (char *) &chunkno,
+					   sizeof(chunkno));
+		}
+		LWLockRelease(PageCompressLock);
+
+		if (chunkno == 0)
+			mdc_reserve(seg, PC_GROUP_CHUNKS);
+	}
+
+	if (chunkno == 0)
+		return 0;
+	return PC_CHUNK_POS(chunkno) +
+		(off_t) (segblock % PC_GROUP_SIZE) * sizeof(PageCompressAddr);
+}
+
+/*
+ * Read the address map entry of a block, checking it for sanity, and return
+ * its position.  A block whose part of the map doesn't exist yet has an
+ * entry of zeroes, at position 0 unless create is true; see mdc_addr_pos.
+ */
+static off_t
+mdc_read_addr(MdfdVec *seg, BlockNumber blocknum, PageCompressAddr *addr,
+			  bool create)
+{
+	BlockNumber segblock = blocknum % ((BlockNumber) RELSEG_SIZE);
+	off_t		pos;
+	int			i;
+
+	pos = mdc_addr_pos(seg, segblock, create);
+	if (pos == 0)
+	{
+		MemSet(addr, 0, sizeof(PageCompressAddr));
+		return 0;
+	}
+	mdc_pread(seg, pos, (char *) addr, sizeof(PageCompressAddr));
+
+	if (addr->pca_size > BLCKSZ ||
+		addr->pca_allocated > PC_MAX_CHUNKS ||
+		addr->pca_nchunks > addr->pca_allocated ||
+		addr->pca_nchunks !=
+		(addr->pca_size + PC_CHUNK_SIZE - 1) / PC_CHUNK_SIZE)
+		goto corrupted;
+	for (i = 0; i < addr->pca_allocated; i++)
+	{
+		if (addr->pca_chunknos[i] == 0)
+			goto corrupted;
+	}
+	return pos;
+
+corrupted:
+	ereport(ERROR,
+			(errcode(ERRCODE_DATA_CORRUPTED),
+			 errmsg("invalid address of block %u in file \"%s\"",
+					blocknum, FilePathName(seg->mdfd_vfd))));
+}
+
+/*
+ * Read or write the first len bytes of a page image from or to the chunks
+ * of a block, in as few calls as the chunk numbers allow.
+ */
+static void
+mdc_chunks_io(MdfdVec *seg, PageCompressAddr *addr, char *image, int len,
+			  bool write)
+{
+	int			done = 0;
+	int			i = 0;
+
+	while (done < len)
+	{
+		int			first = i;
+		int			nbytes;
+		off_t		pos;
+
+		while (i + 1 < addr->pca_nchunks &&
+			   addr->pca_chunknos[i + 1] == addr->pca_chunknos[i] + 1)
+			i++;
+		i++;
+
+		nbytes = Min(len - done, (i - first) * PC_CHUNK_SIZE);
+		pos = PC_CHUNK_POS(addr->pca_chunknos[first]);
+		if (write)
+			mdc_pwrite(seg, pos, image + done, nbytes);
+		else
+			mdc_pread(seg, pos, image + done, nbytes);
+		done += nbytes;
+	}
+}
+
+/*
+ * Make a compressed segment at least segblocks blocks long.
+ */
+static void
+mdc_extend(MdfdVec *seg, BlockNumber segblocks)
+{
+	PageCompressHeader hdr;
+
+	LWLockAcquire(PageCompressLock, LW_EXCLUSIVE);
+	mdc_read_header(seg, &hdr);
+	if (hdr.pc_nblocks < segblocks || hdr.pc_magic == 0)
+	{
+		hdr.pc_nblocks = Max(hdr.pc_nblocks, segblocks);
+		mdc_write_header(seg, &hdr);
+	}
+	LWLockRelease(PageCompressLock);
+}
+
+/*
+ * Truncate a compressed segment to segblocks blocks.
+ *
+ * The blocks cut off keep their chunks, but read as zeroes should the
+ * relation grow again.  If nothing is left, the chunks are released too.
+ */
+static void
+mdc_truncate(MdfdVec *seg, BlockNumber segblocks)
+{
+	PageCompressHeader hdr;
+
+	LWLockAcquire(PageCompressLock, LW_EXCLUSIVE);
+	mdc_read_header(seg, &hdr);
+
+	if (segblocks == 0)
+	{
+		/*
+		 * Release everything, including the address map.  The header is
+		 * written again below, so that the segment stays recognizable.
+		 */
+		if (FileTruncate(seg->mdfd_vfd, 0) < 0)
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not truncate file \"%s\": %m",
+							FilePathName(seg->mdfd_vfd))));
+		hdr.pc_nchunks = 0;
+		hdr.pc_reserved = 0;
+		hdr.pc_reserving = 0;
+	}
+	else
+	{
+		PageCompressAddr addrs[64];
+		BlockNumber blkno = segblocks;
+
+		/* go through the address map a batch at a time */
+		while (blkno < hdr.pc_nblocks)
+		{
+			int			n = Min(lengthof(addrs), hdr.pc_nblocks - blkno);
+			off_t		pos;
+
+			/* a batch mustn't span two parts of the map */
+			n = Min(n, PC_GROUP_SIZE - blkno % PC_GROUP_SIZE);
+
+			pos = mdc_addr_pos(seg, blkno, false);
+			if (pos != 0)
+			{
+				bool		changed = false;
+				int			i;
+
+				mdc_pread(seg, pos, (char *) addrs,
+						  n * sizeof(PageCompressAddr));
+				for (i = 0; i < n; i++)
+				{
+					if (addrs[i].pca_size != 0)
+					{
+						addrs[i].pca_size = 0;
+						addrs[i].pca_nchunks = 0;
+						changed = true;
+					}
+				}
+				if (changed)
+					mdc_pwrite(seg, pos, (char *) addrs,
+							   n * sizeof(PageCompressAddr));
+			}
+			blkno += n;
+		}
+	}
+
+	hdr.pc_nblocks = segblocks;
+	mdc_write_header(seg, &hdr);
+	LWLockRelease(PageCompressLock);
+}
+
+/*
+ * Read a block of a compressed segment.  Returns false if it lies past the
+ * end of the segment.
+ */
+static bool
+mdc_read(MdfdVec *seg, BlockNumber blocknum, char *buffer)
+{
+	PageCompressAddr addr;
+
+	(void) mdc_read_addr(seg, blocknum, &addr, false);
+
+	if (addr.pca_size == 0)
+	{
+		PageCompressHeader hdr;
+
+		/* a page of zeroes, unless the block doesn't exist at all */
+		LWLockAcquire(PageCompressLock, LW_SHARED);
+		mdc_read_header(seg, &hdr);
+		LWLockRelease(PageCompressLock);
+		if (blocknum % ((BlockNumber) RELSEG_SIZE) >= hdr.pc_nblocks)
+			return false;
+
+		MemSet(buffer, 0, BLCKSZ);
+	}
+	else if (addr.pca_size == BLCKSZ)
+		mdc_chunks_io(seg, &addr, buffer, BLCKSZ, false);
+	else
+	{
+		mdc_chunks_io(seg, &addr, mdc_buffer, addr.pca_size, false);
+		if (pglz_decompress(mdc_buffer, addr.pca_size,
+							buffer, BLCKSZ, true) != BLCKSZ)
+			ereport(ERROR,
+					(errcode(ERRCODE_DATA_CORRUPTED),
+					 errmsg("could not decompress block %u in file \"%s\"",
+							blocknum, FilePathName(seg->mdfd_vfd))));
+	}
+
+	return true;
+}
+
+/*
+ * Write a block of a compressed segment.
+ */
+static void
+mdc_write(MdfdVec *seg, BlockNumber blocknum, char *buffer)
+{
+	PageCompressAddr addr;
+	off_t		pos;
+	char	   *image;
+	int			size;
+	int			nchunks;
+	int			i;
+
+	/* find out how much space the page needs */
+	for (i = 0; i < BLCKSZ; i++)
+	{
+		if (buffer[i] != 0)
+			break;
+	}
+	if (i == BLCKSZ)
+	{
+		image = NULL;
+		size = 0;
+	}
+	else
+	{
+		image = mdc_buffer;
+		size = pglz_compress(buffer, BLCKSZ, mdc_buffer,
+							 PGLZ_strategy_always);
+		if (size < 0 || size > BLCKSZ - PC_CHUNK_SIZE)
+		{
+			image = buffer;
+			size = BLCKSZ;
+		}
+	}
+	nchunks = (size + PC_CHUNK_SIZE - 1) / PC_CHUNK_SIZE;
+
+	/*
+	 * A page of zeroes needn't be recorded if its part of the address map
+	 * doesn't exist yet.
+	 */
+	pos = mdc_read_addr(seg, blocknum, &addr, size > 0);
+	if (pos == 0)
+		return;
+
+	/* get more chunks if the block doesn't own enough of them yet */
+	if (nchunks > addr.pca_allocated)
+	{
+		uint32		first;
+
+		for (;;)
+		{
+			LWLockAcquire(PageCompressLock, LW_EXCLUSIVE);
+			first = mdc_allocate(seg, nchunks - addr.pca_allocated);
+			LWLockRelease(PageCompressLock);
+			if (first != 0)
+				break;
+			mdc_reserve(seg, nchunks - addr.pca_allocated);
+		}
+
+		for (i = addr.pca_allocated; i < nchunks; i++)
+			addr.pca_chunknos[i] = first++;
+		addr.pca_allocated = nchunks;
+	}
+
+	/* store the image before the address that points to it */
+	addr.pca_nchunks = nchunks;
+	if (size > 0)
+		mdc_chunks_io(seg, &addr, image, size, true);
+	addr.pca_size = size;
+	mdc_pwrite(seg, pos, (char *) &addr, sizeof(addr));
+}
+
+#ifdef USE_PREFETCH
+/*
+ * Initiate an asynchronous read of a block of a compressed segment.
+ */
+static void
+mdc_prefetch(MdfdVec *seg, BlockNumber blocknum)
+{
+	PageCompressAddr addr;
+	int			i = 0;
+
+	(void) mdc_read_addr(seg, blocknum, &addr, false);
+
+	while (i < addr.pca_nchunks)
+	{
+		int			first = i;
+
+		while (i + 1 < addr.pca_nchunks &&
+			   addr.pca_chunknos[i + 1] == addr.pca_chunknos[i] + 1)
+			i++;
+		i++;
+
+		(void) FilePrefetch(seg->mdfd_vfd,
+							PC_CHUNK_POS(addr.pca_chunknos[first]),
+							(i - first) * PC_CHUNK_SIZE);
+	}
+}
+#endif   /* USE_PREFETCH */
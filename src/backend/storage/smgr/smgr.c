@@ -41,7 +41,7 @@ typedef struct f_smgr
 	void		(*smgr_shutdown) (void);		/* may be NULL */
 	void		(*smgr_close) (SMgrRelation reln, ForkNumber forknum);
 	void		(*smgr_create) (SMgrRelation reln, ForkNumber forknum,
-											bool isRedo);
+											bool isRedo, bool compress);
 	bool		(*smgr_exists) (SMgrRelation reln, ForkNumber forknum);
 	void		(*smgr_unlink) (RelFileNodeBackend rnode, ForkNumber forknum,
 											bool isRedo);
@@ -371,9 +371,12 @@ smgrclosenode(RelFileNodeBackend rnode)
  *
  *		If isRedo is true, it is okay for the underlying file to exist
  *		already because we are in a WAL replay sequence.
+ *
+ *		If compress is true, the fork stores its pages compressed; this is
+ *		only supported for the main and init forks.
  */
 void
-smgrcreate(SMgrRelation reln, ForkNumber forknum, bool isRedo)
+smgrcreate(SMgrRelation reln, ForkNumber forknum, bool isRedo, bool compress)
 {
 	/*
 	 * Exit quickly in WAL replay mode if we've already opened the file. If
@@ -395,7 +398,8 @@ smgrcreate(SMgrRelation reln, ForkNumber forknum, bool isRedo)
 							reln->smgr_rnode.node.dbNode,
 							isRedo);
 
-	(*(smgrsw[reln->smgr_which].smgr_create)) (reln, forknum, isRedo);
+	(*(smgrsw[reln->smgr_which].smgr_create)) (reln, forknum, isRedo,
+											   compress);
 }
 
 /*
@@ -42,6 +42,7 @@
 #include "catalog/pg_type.h"
 #include "commands/async.h"
 #include "commands/prepare.h"
+#include "executor/instrument.h"
 #include "libpq/libpq.h"
 #include "libpq/pqformat.h"
 #include "libpq/pqsignal.h"
@@ -176,6 +177,7 @@ static int	ReadCommand(StringInfo inBuf);
 static void forbidden_in_wal_sender(char firstchar);
 static List *pg_rewrite_query(Query *query);
 static bool check_log_statement(List *stmt_list);
+static void report_query_id(List *stmts);
 static int	errdetail_execute(List *raw_parsetree_list);
 static int	errdetail_params(ParamListInfo params);
 static int	errdetail_abort(void);
@@ -1019,6 +1021,8 @@ exec_simple_query(const char *query_string)
 		querytree_list = pg_analyze_and_rewrite(parsetree, query_string,
 												NULL, 0);
 
+		report_query_id(querytree_list);
+
 		plantree_list = pg_plan_queries(querytree_list,
 										CURSOR_OPT_PARALLEL_OK, NULL);
 
@@ -1102,6 +1106,8 @@ exec_simple_query(const char *query_string)
 
 		PortalDrop(portal, false);
 
+		report_query_id(NIL);
+
 		if (IsA(parsetree, TransactionStmt))
 		{
 			/*
@@ -1976,6 +1982,8 @@ exec_execute_message(const char *portal_name, long max_rows)
 	if (max_rows <= 0)
 		max_rows = FETCH_ALL;
 
+	report_query_id(portal->stmts);
+
 	completed = PortalRun(portal,
 						  max_rows,
 						  true, /* always top level */
@@ -1985,6 +1993,8 @@ exec_execute_message(const char *portal_name, long max_rows)
 
 	(*receiver->rDestroy) (receiver);
 
+	report_query_id(NIL);
+
 	if (completed)
 	{
 		if (is_xact_command)
@@ -2046,6 +2056,39 @@ exec_execute_message(const char *portal_name, long max_rows)
 	debug_query_string = NULL;
 }
 
+/*
+ * report_query_id
+ *		Advertise the query ID of the top-level statement about to run, for
+ *		the wait sampler
+ *
+ * stmts can be either a list of querytrees or a list of planned statements;
+ * the first nonzero query ID among them is used.  Passing NIL forgets the
+ * ID once the statement has finished.
+ */
+static void
+report_query_id(List *stmts)
+{
+	uint32		queryId = 0;
+	ListCell   *lc;
+
+	if (MyProc == NULL)
+		return;
+
+	foreach(lc, stmts)
+	{
+		Node	   *stmt = (Node *) lfirst(lc);
+
+		if (IsA(stmt, Query))
+			queryId = ((Query *) stmt)->queryId;
+		else if (IsA(stmt, PlannedStmt))
+			queryId = ((PlannedStmt *) stmt)->queryId;
+		if (queryId != 0)
+			break;
+	}
+
+	MyProc->queryId = queryId;
+}
+
 /*
  * check_log_statement
  *		Determine whether command should be logged because of log_statement
@@ -3600,6 +3643,8 @@ PostgresMain(int argc, char *argv[],
 	{
 		if (!SelectConfigFiles(userDoption, progname))
 			proc_exit(1);
+
+		InstrInitClock();
 	}
 
 	/*
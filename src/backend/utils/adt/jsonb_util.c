@@ -14,6 +14,7 @@
 #include "postgres.h"
 
 #include "access/hash.h"
+#include "access/tuptoaster.h"
 #include "catalog/pg_collation.h"
 #include "miscadmin.h"
 #include "utils/builtins.h"
@@ -409,6 +410,121 @@ findJsonbValueFromContainer(JsonbContainer *container, uint32 flags,
 	return NULL;
 }
 
+/*
+ * Like findJsonbValueFromContainer, but search the top-level container of a
+ * jsonb datum, which may be toasted.
+ *
+ * When looking up a key in a compressed or out-of-line object, we detoast
+ * only as much of it as the binary search over the keys and the value found
+ * need, so that fetching a field from the start of a large document doesn't
+ * read all of it.  Arrays have to be searched sequentially, so they are
+ * detoasted in full.  The result points into memory allocated in the
+ * current memory context.
+ */
+JsonbValue *
+findJsonbValueFromDatum(Datum jsonb, uint32 flags, JsonbValue *key)
+{
+	DetoastIterator iter;
+	JsonbContainer *container;
+	uint32		header;
+	int			count;
+	uint32		base_off;
+	uint32		stopLow,
+				stopHigh;
+
+	iter = create_detoast_iterator((struct varlena *) DatumGetPointer(jsonb));
+
+	detoast_iterate(iter, sizeof(uint32));
+	header = ((JsonbContainer *) iter->data)->header;
+	count = (header & JB_CMASK);
+
+	if (!(flags & JB_FOBJECT & header))
+	{
+		JsonbValue *result = NULL;
+
+		if (flags & JB_FARRAY & header)
+		{
+			detoast_iterate(iter, iter->rawsize);
+			result = findJsonbValueFromContainer((JsonbContainer *) iter->data,
+												 flags, key);
+		}
+
+		if (result == NULL)
+			free_detoast_iterator(iter);
+		return result;
+	}
+
+	/* Object key passed by caller must be a string */
+	Assert(key->type == jbvString);
+
+	/* The JEntrys of the keys and the values precede the data */
+	base_off = offsetof(JsonbContainer, children) + sizeof(JEntry) * count * 2;
+	detoast_iterate(iter, base_off);
+
+	/* Binary search on object/pair keys *only* */
+	stopLow = 0;
+	stopHigh = count;
+	while (stopLow < stopHigh)
+	{
+		uint32		stopMiddle;
+		uint32		offset;
+		int			difference;
+		JsonbValue	candidate;
+
+		stopMiddle = stopLow + (stopHigh - stopLow) / 2;
+
+		container = (JsonbContainer *) iter->data;
+		offset = getJsonbOffset(container, stopMiddle);
+
+		candidate.type = jbvString;
+		candidate.val.string.len = getJsonbLength(container, stopMiddle);
+
+		/*
+		 * Keys are ordered by length first, so we only need the bytes of a
+		 * key that is as long as the one we're looking for.
+		 */
+		if (candidate.val.string.len == key->val.string.len)
+		{
+			detoast_iterate(iter, base_off + offset + candidate.val.string.len);
+			candidate.val.string.val = iter->data + base_off + offset;
+			difference = lengthCompareJsonbStringValue(&candidate, key);
+		}
+		else
+			difference = (candidate.val.string.len > key->val.string.len) ? 1 : -1;
+
+		if (difference == 0)
+		{
+			/* Found our key, return corresponding value */
+			int			index = stopMiddle + count;
+			JsonbValue *result;
+
+			container = (JsonbContainer *) iter->data;
+			offset = getJsonbOffset(container, index);
+			detoast_iterate(iter, base_off + offset +
+							getJsonbLength(container, index));
+
+			result = palloc(sizeof(JsonbValue));
+			fillJsonbValue((JsonbContainer *) iter->data, index,
+						   iter->data + base_off, offset, result);
+
+			/* the result points into the detoasted data, so keep that */
+			pfree(iter);
+			return result;
+		}
+		else
+		{
+			if (difference < 0)
+				stopLow = stopMiddle + 1;
+			else
+				stopHigh = stopMiddle;
+		}
+	}
+
+	/* Not found */
+	free_detoast_iterator(iter);
+	return NULL;
+}
+
 /*
  * Get i-th value of a Jsonb array.
  *
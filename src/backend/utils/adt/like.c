@@ -269,22 +269,69 @@ namenlike(PG_FUNCTION_ARGS)
 	PG_RETURN_BOOL(result);
 }
 
+/*
+ * If the LIKE pattern p is a literal string followed by a single trailing
+ * '%', return the length of the literal part; else return -1.
+ *
+ * Such patterns are common, and can be decided by looking at no more than
+ * the start of the string, which saves detoasting all of a long value.
+ */
+static int
+like_fixed_prefix_len(const char *p, int plen)
+{
+	int			i;
+
+	if (plen < 1 || p[plen - 1] != '%')
+		return -1;
+
+	for (i = 0; i < plen - 1; i++)
+	{
+		if (p[i] == '%' || p[i] == '_' || p[i] == '\\')
+			return -1;
+	}
+
+	return plen - 1;
+}
+
+/*
+ * Does the text or bytea datum str begin with the prefixlen bytes at p?
+ * Only that much of a toasted value is fetched and decompressed.
+ */
+static bool
+like_prefix_match(Datum str, const char *p, int prefixlen)
+{
+	struct varlena *s = (struct varlena *) DatumGetPointer(str);
+
+	if (VARATT_IS_EXTERNAL(s) || VARATT_IS_COMPRESSED(s))
+		s = pg_detoast_datum_slice(s, 0, prefixlen);
+
+	return VARSIZE_ANY_EXHDR(s) >= prefixlen &&
+		memcmp(VARDATA_ANY(s), p, prefixlen) == 0;
+}
+
 Datum
 textlike(PG_FUNCTION_ARGS)
 {
-	text	   *str = PG_GETARG_TEXT_PP(0);
+	text	   *str;
 	text	   *pat = PG_GETARG_TEXT_PP(1);
 	bool		result;
 	char	   *s,
 			   *p;
 	int			slen,
-				plen;
+				plen,
+				prefixlen;
 
-	s = VARDATA_ANY(str);
-	slen = VARSIZE_ANY_EXHDR(str);
 	p = VARDATA_ANY(pat);
 	plen = VARSIZE_ANY_EXHDR(pat);
 
+	prefixlen = like_fixed_prefix_len(p, plen);
+	if (prefixlen >= 0)
+		PG_RETURN_BOOL(like_prefix_match(PG_GETARG_DATUM(0), p, prefixlen));
+
+	str = PG_GETARG_TEXT_PP(0);
+	s = VARDATA_ANY(str);
+	slen = VARSIZE_ANY_EXHDR(str);
+
 	result = (GenericMatchText(s, slen, p, plen) == LIKE_TRUE);
 
 	PG_RETURN_BOOL(result);
@@ -293,19 +340,26 @@ textlike(PG_FUNCTION_ARGS)
 Datum
 textnlike(PG_FUNCTION_ARGS)
 {
-	text	   *str = PG_GETARG_TEXT_PP(0);
+	text	   *str;
 	text	   *pat = PG_GETARG_TEXT_PP(1);
 	bool		result;
 	char	   *s,
 			   *p;
 	int			slen,
-				plen;
+				plen,
+				prefixlen;
 
-	s = VARDATA_ANY(str);
-	slen = VARSIZE_ANY_EXHDR(str);
 	p = VARDATA_ANY(pat);
 	plen = VARSIZE_ANY_EXHDR(pat);
 
+	prefixlen = like_fixed_prefix_len(p, plen);
+	if (prefixlen >= 0)
+		PG_RETURN_BOOL(!like_prefix_match(PG_GETARG_DATUM(0), p, prefixlen));
+
+	str = PG_GETARG_TEXT_PP(0);
+	s = VARDATA_ANY(str);
+	slen = VARSIZE_ANY_EXHDR(str);
+
 	result = (GenericMatchText(s, slen, p, plen) != LIKE_TRUE);
 
 	PG_RETURN_BOOL(result);
@@ -314,19 +368,26 @@ textnlike(PG_FUNCTION_ARGS)
 Datum
 bytealike(PG_FUNCTION_ARGS)
 {
-	bytea	   *str = PG_GETARG_BYTEA_PP(0);
+	bytea	   *str;
 	bytea	   *pat = PG_GETARG_BYTEA_PP(1);
 	bool		result;
 	char	   *s,
 			   *p;
 	int			slen,
-				plen;
+				plen,
+				prefixlen;
 
-	s = VARDATA_ANY(str);
-	slen = VARSIZE_ANY_EXHDR(str);
 	p = VARDATA_ANY(pat);
 	plen = VARSIZE_ANY_EXHDR(pat);
 
+	prefixlen = like_fixed_prefix_len(p, plen);
+	if (prefixlen >= 0)
+		PG_RETURN_BOOL(like_prefix_match(PG_GETARG_DATUM(0), p, prefixlen));
+
+	str = PG_GETARG_BYTEA_PP(0);
+	s = VARDATA_ANY(str);
+	slen = VARSIZE_ANY_EXHDR(str);
+
 	result = (SB_MatchText(s, slen, p, plen, 0, true) == LIKE_TRUE);
 
 	PG_RETURN_BOOL(result);
@@ -335,19 +396,26 @@ bytealike(PG_FUNCTION_ARGS)
 Datum
 byteanlike(PG_FUNCTION_ARGS)
 {
-	bytea	   *str = PG_GETARG_BYTEA_PP(0);
+	bytea	   *str;
 	bytea	   *pat = PG_GETARG_BYTEA_PP(1);
 	bool		result;
 	char	   *s,
 			   *p;
 	int			slen,
-				plen;
+				plen,
+				prefixlen;
 
-	s = VARDATA_ANY(str);
-	slen = VARSIZE_ANY_EXHDR(str);
 	p = VARDATA_ANY(pat);
 	plen = VARSIZE_ANY_EXHDR(pat);
 
+	prefixlen = like_fixed_prefix_len(p, plen);
+	if (prefixlen >= 0)
+		PG_RETURN_BOOL(!like_prefix_match(PG_GETARG_DATUM(0), p, prefixlen));
+
+	str = PG_GETARG_BYTEA_PP(0);
+	s = VARDATA_ANY(str);
+	slen = VARSIZE_ANY_EXHDR(str);
+
 	result = (SB_MatchText(s, slen, p, plen, 0, true) != LIKE_TRUE);
 
 	PG_RETURN_BOOL(result);
@@ -20,6 +20,7 @@
 #include "libpq/ip.h"
 #include "miscadmin.h"
 #include "pgstat.h"
+#include "postmaster/waitsampler.h"
 #include "storage/proc.h"
 #include "storage/procarray.h"
 #include "utils/acl.h"
@@ -40,6 +41,8 @@ extern Datum pg_stat_get_tuples_hot_updated(PG_FUNCTION_ARGS);
 extern Datum pg_stat_get_live_tuples(PG_FUNCTION_ARGS);
 extern Datum pg_stat_get_dead_tuples(PG_FUNCTION_ARGS);
 extern Datum pg_stat_get_mod_since_analyze(PG_FUNCTION_ARGS);
+extern Datum pg_stat_get_ins_since_vacuum(PG_FUNCTION_ARGS);
+extern Datum pg_stat_get_eager_frozen_pages(PG_FUNCTION_ARGS);
 extern Datum pg_stat_get_blocks_fetched(PG_FUNCTION_ARGS);
 extern Datum pg_stat_get_blocks_hit(PG_FUNCTION_ARGS);
 extern Datum pg_stat_get_last_vacuum_time(PG_FUNCTION_ARGS);
@@ -57,6 +60,7 @@ extern Datum pg_stat_get_function_self_time(PG_FUNCTION_ARGS);
 
 extern Datum pg_stat_get_backend_idset(PG_FUNCTION_ARGS);
 extern Datum pg_stat_get_activity(PG_FUNCTION_ARGS);
+extern Datum pg_stat_get_wait_samples(PG_FUNCTION_ARGS);
 extern Datum pg_backend_pid(PG_FUNCTION_ARGS);
 extern Datum pg_stat_get_backend_pid(PG_FUNCTION_ARGS);
 extern Datum pg_stat_get_backend_dbid(PG_FUNCTION_ARGS);
@@ -292,6 +296,38 @@ pg_stat_get_mod_since_analyze(PG_FUNCTION_ARGS)
 }
 
 
+Datum
+pg_stat_get_ins_since_vacuum(PG_FUNCTION_ARGS)
+{
+	Oid			relid = PG_GETARG_OID(0);
+	int64		result;
+	PgStat_StatTabEntry *tabentry;
+
+	if ((tabentry = pgstat_fetch_stat_tabentry(relid)) == NULL)
+		result = 0;
+	else
+		result = (int64) (tabentry->inserts_since_vacuum);
+
+	PG_RETURN_INT64(result);
+}
+
+
+Datum
+pg_stat_get_eager_frozen_pages(PG_FUNCTION_ARGS)
+{
+	Oid			relid = PG_GETARG_OID(0);
+	int64		result;
+	PgStat_StatTabEntry *tabentry;
+
+	if ((tabentry = pgstat_fetch_stat_tabentry(relid)) == NULL)
+		result = 0;
+	else
+		result = (int64) (tabentry->eager_frozen_pages);
+
+	PG_RETURN_INT64(result);
+}
+
+
 Datum
 pg_stat_get_blocks_fetched(PG_FUNCTION_ARGS)
 {
@@ -635,6 +671,33 @@ pg_stat_get_progress_info(PG_FUNCTION_ARGS)
 /*
  * Returns activity of PG backends.
  */
+/*
+ * Return the name of a backend state as shown in pg_stat_activity, or NULL
+ * if it is undefined.
+ */
+static const char *
+backend_state_name(BackendState state)
+{
+	switch (state)
+	{
+		case STATE_IDLE:
+			return "idle";
+		case STATE_RUNNING:
+			return "active";
+		case STATE_IDLEINTRANSACTION:
+			return "idle in transaction";
+		case STATE_FASTPATH:
+			return "fastpath function call";
+		case STATE_IDLEINTRANSACTION_ABORTED:
+			return "idle in transaction (aborted)";
+		case STATE_DISABLED:
+			return "disabled";
+		case STATE_UNDEFINED:
+			break;
+	}
+	return NULL;
+}
+
 Datum
 pg_stat_get_activity(PG_FUNCTION_ARGS)
 {
@@ -682,6 +745,7 @@ pg_stat_get_activity(PG_FUNCTION_ARGS)
 		LocalPgBackendStatus *local_beentry;
 		PgBackendStatus *beentry;
 		PGPROC	   *proc;
+		const char *state;
 		const char *wait_event_type;
 		const char *wait_event;
 
@@ -757,30 +821,11 @@ pg_stat_get_activity(PG_FUNCTION_ARGS)
 		{
 			SockAddr	zero_clientaddr;
 
-			switch (beentry->st_state)
-			{
-				case STATE_IDLE:
-					values[4] = CStringGetTextDatum("idle");
-					break;
-				case STATE_RUNNING:
-					values[4] = CStringGetTextDatum("active");
-					break;
-				case STATE_IDLEINTRANSACTION:
-					values[4] = CStringGetTextDatum("idle in transaction");
-					break;
-				case STATE_FASTPATH:
-					values[4] = CStringGetTextDatum("fastpath function call");
-					break;
-				case STATE_IDLEINTRANSACTION_ABORTED:
-					values[4] = CStringGetTextDatum("idle in transaction (aborted)");
-					break;
-				case STATE_DISABLED:
-					values[4] = CStringGetTextDatum("disabled");
-					break;
-				case STATE_UNDEFINED:
-					nulls[4] = true;
-					break;
-			}
+			state = backend_state_name(beentry->st_state);
+			if (state)
+				values[4] = CStringGetTextDatum(state);
+			else
+				nulls[4] = true;
 
 			values[5] = CStringGetTextDatum(beentry->st_activity);
 
@@ -927,6 +972,96 @@ pg_stat_get_activity(PG_FUNCTION_ARGS)
 	return (Datum) 0;
 }
 
+/*
+ * Returns the samples collected by the wait sampler, oldest first.
+ */
+Datum
+pg_stat_get_wait_samples(PG_FUNCTION_ARGS)
+{
+#define PG_STAT_GET_WAIT_SAMPLES_COLS	6
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	TupleDesc	tupdesc;
+	Tuplestorestate *tupstore;
+	MemoryContext per_query_ctx;
+	MemoryContext oldcontext;
+	WaitSample *samples;
+	int			nsamples;
+	int			i;
+
+	/* check to see if caller supports us returning a tuplestore */
+	if (rsinfo == NULL || !IsA(rsinfo, ReturnSetInfo))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("set-valued function called in context that cannot accept a set")));
+	if (!(rsinfo->allowedModes & SFRM_Materialize))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("materialize mode required, but it is not " \
+						"allowed in this context")));
+
+	/* Build a tuple descriptor for our result type */
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+
+	per_query_ctx = rsinfo->econtext->ecxt_per_query_memory;
+	oldcontext = MemoryContextSwitchTo(per_query_ctx);
+
+	tupstore = tuplestore_begin_heap(true, false, work_mem);
+	rsinfo->returnMode = SFRM_Materialize;
+	rsinfo->setResult = tupstore;
+	rsinfo->setDesc = tupdesc;
+
+	MemoryContextSwitchTo(oldcontext);
+
+	samples = WaitSamplerGetSamples(&nsamples);
+
+	for (i = 0; i < nsamples; i++)
+	{
+		WaitSample *sample = &samples[i];
+		Datum		values[PG_STAT_GET_WAIT_SAMPLES_COLS];
+		bool		nulls[PG_STAT_GET_WAIT_SAMPLES_COLS];
+		const char *state;
+		const char *wait_event_type;
+		const char *wait_event;
+
+		MemSet(values, 0, sizeof(values));
+		MemSet(nulls, 0, sizeof(nulls));
+
+		values[0] = Int32GetDatum(sample->pid);
+		values[1] = TimestampTzGetDatum(sample->ts);
+
+		state = backend_state_name(sample->state);
+		if (state)
+			values[2] = CStringGetTextDatum(state);
+		else
+			nulls[2] = true;
+
+		wait_event_type = pgstat_get_wait_event_type(sample->wait_event_info);
+		if (wait_event_type)
+			values[3] = CStringGetTextDatum(wait_event_type);
+		else
+			nulls[3] = true;
+
+		wait_event = pgstat_get_wait_event(sample->wait_event_info);
+		if (wait_event)
+			values[4] = CStringGetTextDatum(wait_event);
+		else
+			nulls[4] = true;
+
+		if (sample->queryid != 0)
+			values[5] = Int64GetDatum((int64) sample->queryid);
+		else
+			nulls[5] = true;
+
+		tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+	}
+
+	/* clean up and return the tuplestore */
+	tuplestore_donestoring(tupstore);
+
+	return (Datum) 0;
+}
+
 
 Datum
 pg_backend_pid(PG_FUNCTION_ARGS)
@@ -400,6 +400,33 @@ index_am_handler_out(PG_FUNCTION_ARGS)
 }
 
 
+/*
+ * table_am_handler_in		- input routine for pseudo-type TABLE_AM_HANDLER.
+ */
+Datum
+table_am_handler_in(PG_FUNCTION_ARGS)
+{
+	ereport(ERROR,
+			(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+			 errmsg("cannot accept a value of type table_am_handler")));
+
+	PG_RETURN_VOID();			/* keep compiler quiet */
+}
+
+/*
+ * table_am_handler_out		- output routine for pseudo-type TABLE_AM_HANDLER.
+ */
+Datum
+table_am_handler_out(PG_FUNCTION_ARGS)
+{
+	ereport(ERROR,
+			(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+			 errmsg("cannot display a value of type table_am_handler")));
+
+	PG_RETURN_VOID();			/* keep compiler quiet */
+}
+
+
 /*
  * tsm_handler_in		- input routine for pseudo-type TSM_HANDLER.
  */
@@ -24,6 +24,7 @@
 #include "access/xact.h"
 #include "catalog/pg_operator.h"
 #include "catalog/pg_type.h"
+#include "funcapi.h"
 #include "miscadmin.h"
 #ifdef CATCACHE_STATS
 #include "storage/ipc.h"		/* for on_proc_exit */
@@ -34,9 +35,11 @@
 #include "utils/inval.h"
 #include "utils/memutils.h"
 #include "utils/rel.h"
+#include "utils/relcache.h"
 #include "utils/resowner_private.h"
 #include "utils/syscache.h"
 #include "utils/tqual.h"
+#include "utils/tuplestore.h"
 
 
  /* #define CACHEDEBUG */	/* turns DEBUG elogs on */
@@ -69,9 +72,28 @@
 #define CACHE6_elog(a,b,c,d,e,f,g)
 #endif
 
+/*
+ * Approximate memory used by a cache entry or list, for enforcing
+ * catalog_cache_memory_limit.  We don't try to account for palloc overhead.
+ */
+#define CATCTUP_MEMUSAGE(ct) \
+	(sizeof(CatCTup) + (ct)->tuple.t_len)
+#define CATCLIST_MEMUSAGE(cl) \
+	(offsetof(CatCList, members) + (cl)->n_members * sizeof(CatCTup *) + \
+	 (cl)->tuple.t_len)
+
 /* Cache management header --- pointer is NULL until created */
 static CatCacheHeader *CacheHdr = NULL;
 
+/* GUC parameter: memory budget for all catcaches, in kilobytes */
+int			catalog_cache_memory_limit = 0;
+
+/*
+ * Logical clock for LRU eviction: advanced by every search, and stored into
+ * the entry or list the search returned.
+ */
+static uint64 catcacheClock = 0;
+
 
 static uint32 CatalogCacheComputeHashValue(CatCache *cache, int nkeys,
 							 ScanKey cur_skey);
@@ -83,6 +105,7 @@ static void CatCachePrintStats(int code, Datum arg);
 #endif
 static void CatCacheRemoveCTup(CatCache *cache, CatCTup *ct);
 static void CatCacheRemoveCList(CatCache *cache, CatCList *cl);
+static void CatCacheEnforceMemoryLimit(void);
 static void CatalogCacheInitializeCache(CatCache *cache);
 static CatCTup *CatalogCacheCreateEntry(CatCache *cache, HeapTuple ntp,
 						uint32 hashValue, Index hashIndex,
@@ -376,6 +399,9 @@ CatCacheRemoveCTup(CatCache *cache, CatCTup *ct)
 	/* delink from linked list */
 	dlist_delete(&ct->cache_elem);
 
+	cache->cc_memusage -= CATCTUP_MEMUSAGE(ct);
+	CacheHdr->ch_memusage -= CATCTUP_MEMUSAGE(ct);
+
 	/* free associated tuple data */
 	if (ct->tuple.t_data != NULL)
 		pfree(ct->tuple.t_data);
@@ -419,6 +445,9 @@ CatCacheRemoveCList(CatCache *cache, CatCList *cl)
 	/* delink from linked list */
 	dlist_delete(&cl->cache_elem);
 
+	cache->cc_memusage -= CATCLIST_MEMUSAGE(cl);
+	CacheHdr->ch_memusage -= CATCLIST_MEMUSAGE(cl);
+
 	/* free associated tuple data */
 	if (cl->tuple.t_data != NULL)
 		pfree(cl->tuple.t_data);
@@ -426,6 +455,133 @@ CatCacheRemoveCList(CatCache *cache, CatCList *cl)
 }
 
 
+/*
+ * An unreferenced entry or list that CatCacheEnforceMemoryLimit may evict
+ */
+typedef struct CatCacheVictim
+{
+	uint64		lastaccess;
+	CatCache   *cache;
+	CatCTup    *ct;				/* entry not belonging to any list, or */
+	CatCList   *cl;				/* list, together with its members */
+} CatCacheVictim;
+
+static int
+catcache_victim_cmp(const void *a, const void *b)
+{
+	const CatCacheVictim *va = (const CatCacheVictim *) a;
+	const CatCacheVictim *vb = (const CatCacheVictim *) b;
+
+	if (va->lastaccess < vb->lastaccess)
+		return -1;
+	if (va->lastaccess > vb->lastaccess)
+		return 1;
+	return 0;
+}
+
+/*
+ *		CatCacheEnforceMemoryLimit
+ *
+ * If the catcaches together use more than catalog_cache_memory_limit, evict
+ * least-recently-used entries that nobody holds a reference to, until usage
+ * is down to 90% of the limit.  Going below the limit means we don't have to
+ * do this again for every new entry.
+ *
+ * Evicting an entry has the same effect as an invalidation of it, so callers
+ * of SearchCatCache need not care.  Members of a CatCList are only evicted
+ * together with the list; removing a member alone would destroy the list
+ * anyway.
+ */
+static void
+CatCacheEnforceMemoryLimit(void)
+{
+	Size		limit = (Size) catalog_cache_memory_limit * 1024;
+	Size		target = limit - limit / 10;
+	CatCacheVictim *victims;
+	int			nvictims = 0;
+	int			maxvictims = 0;
+	slist_iter	cache_iter;
+	int			i;
+
+	if (CacheHdr == NULL || CacheHdr->ch_memusage <= limit)
+		return;
+
+	/* Count lists, so we can size the array */
+	slist_foreach(cache_iter, &CacheHdr->ch_caches)
+	{
+		CatCache   *cache = slist_container(CatCache, cc_next, cache_iter.cur);
+		dlist_iter	iter;
+
+		dlist_foreach(iter, &cache->cc_lists)
+			maxvictims++;
+	}
+	maxvictims += CacheHdr->ch_ntup;
+	if (maxvictims == 0)
+		return;
+	victims = (CatCacheVictim *) palloc(maxvictims * sizeof(CatCacheVictim));
+
+	slist_foreach(cache_iter, &CacheHdr->ch_caches)
+	{
+		CatCache   *cache = slist_container(CatCache, cc_next, cache_iter.cur);
+		dlist_iter	iter;
+
+		dlist_foreach(iter, &cache->cc_lists)
+		{
+			CatCList   *cl = dlist_container(CatCList, cache_elem, iter.cur);
+
+			if (cl->refcount > 0)
+				continue;
+			victims[nvictims].lastaccess = cl->lastaccess;
+			victims[nvictims].cache = cache;
+			victims[nvictims].ct = NULL;
+			victims[nvictims].cl = cl;
+			nvictims++;
+		}
+
+		for (i = 0; i < cache->cc_nbuckets; i++)
+		{
+			dlist_foreach(iter, &cache->cc_bucket[i])
+			{
+				CatCTup    *ct = dlist_container(CatCTup, cache_elem, iter.cur);
+
+				if (ct->refcount > 0 || ct->c_list != NULL)
+					continue;
+				victims[nvictims].lastaccess = ct->lastaccess;
+				victims[nvictims].cache = cache;
+				victims[nvictims].ct = ct;
+				victims[nvictims].cl = NULL;
+				nvictims++;
+			}
+		}
+	}
+
+	qsort(victims, nvictims, sizeof(CatCacheVictim), catcache_victim_cmp);
+
+	for (i = 0; i < nvictims && CacheHdr->ch_memusage > target; i++)
+	{
+		CatCacheVictim *v = &victims[i];
+
+		if (v->ct)
+			CatCacheRemoveCTup(v->cache, v->ct);
+		else
+		{
+			int			j;
+
+			/* have CatCacheRemoveCList free the unreferenced members too */
+			for (j = 0; j < v->cl->n_members; j++)
+			{
+				if (v->cl->members[j]->refcount == 0)
+					v->cl->members[j]->dead = true;
+			}
+			CatCacheRemoveCList(v->cache, v->cl);
+		}
+		v->cache->cc_evictions++;
+	}
+
+	pfree(victims);
+}
+
+
 /*
  *	CatalogCacheIdInvalidate
  *
@@ -503,9 +659,7 @@ CatalogCacheIdInvalidate(int cacheId, uint32 hashValue)
 				else
 					CatCacheRemoveCTup(ccp, ct);
 				CACHE1_elog(DEBUG2, "CatalogCacheIdInvalidate: invalidated");
-#ifdef CATCACHE_STATS
 				ccp->cc_invals++;
-#endif
 				/* could be multiple matches, so keep looking! */
 			}
 		}
@@ -636,9 +790,7 @@ ResetCatalogCache(CatCache *cache)
 			}
 			else
 				CatCacheRemoveCTup(cache, ct);
-#ifdef CATCACHE_STATS
 			cache->cc_invals++;
-#endif
 		}
 	}
 }
@@ -764,6 +916,7 @@ InitCatCache(int id,
 		CacheHdr = (CatCacheHeader *) palloc(sizeof(CatCacheHeader));
 		slist_init(&CacheHdr->ch_caches);
 		CacheHdr->ch_ntup = 0;
+		CacheHdr->ch_memusage = 0;
 #ifdef CATCACHE_STATS
 		/* set up to dump stats at backend exit */
 		on_proc_exit(CatCachePrintStats, 0);
@@ -1132,9 +1285,7 @@ SearchCatCache(CatCache *cache,
 	if (cache->cc_tupdesc == NULL)
 		CatalogCacheInitializeCache(cache);
 
-#ifdef CATCACHE_STATS
 	cache->cc_searches++;
-#endif
 
 	/*
 	 * initialize the search key information
@@ -1188,6 +1339,7 @@ SearchCatCache(CatCache *cache,
 		 * near the front of the hashbucket's list.)
 		 */
 		dlist_move_head(bucket, &ct->cache_elem);
+		ct->lastaccess = ++catcacheClock;
 
 		/*
 		 * If it's a positive entry, bump its refcount and return it. If it's
@@ -1202,9 +1354,7 @@ SearchCatCache(CatCache *cache,
 			CACHE3_elog(DEBUG2, "SearchCatCache(%s): found in bucket %d",
 						cache->cc_relname, hashIndex);
 
-#ifdef CATCACHE_STATS
 			cache->cc_hits++;
-#endif
 
 			return &ct->tuple;
 		}
@@ -1213,9 +1363,7 @@ SearchCatCache(CatCache *cache,
 			CACHE3_elog(DEBUG2, "SearchCatCache(%s): found neg entry in bucket %d",
 						cache->cc_relname, hashIndex);
 
-#ifdef CATCACHE_STATS
 			cache->cc_neg_hits++;
-#endif
 
 			return NULL;
 		}
@@ -1284,6 +1432,9 @@ SearchCatCache(CatCache *cache,
 									 true);
 		heap_freetuple(ntp);
 
+		if (catalog_cache_memory_limit > 0)
+			CatCacheEnforceMemoryLimit();
+
 		CACHE4_elog(DEBUG2, "SearchCatCache(%s): Contains %d/%d tuples",
 					cache->cc_relname, cache->cc_ntup, CacheHdr->ch_ntup);
 		CACHE3_elog(DEBUG2, "SearchCatCache(%s): put neg entry in bucket %d",
@@ -1302,9 +1453,11 @@ SearchCatCache(CatCache *cache,
 	CACHE3_elog(DEBUG2, "SearchCatCache(%s): put in bucket %d",
 				cache->cc_relname, hashIndex);
 
-#ifdef CATCACHE_STATS
 	cache->cc_newloads++;
-#endif
+
+	/* The new entry is pinned, so this can't remove it */
+	if (catalog_cache_memory_limit > 0)
+		CatCacheEnforceMemoryLimit();
 
 	return &ct->tuple;
 }
@@ -1421,9 +1574,7 @@ SearchCatCacheList(CatCache *cache,
 
 	Assert(nkeys > 0 && nkeys < cache->cc_nkeys);
 
-#ifdef CATCACHE_STATS
 	cache->cc_lsearches++;
-#endif
 
 	/*
 	 * initialize the search key information
@@ -1480,6 +1631,7 @@ SearchCatCacheList(CatCache *cache,
 		 * individually.)
 		 */
 		dlist_move_head(&cache->cc_lists, &cl->cache_elem);
+		cl->lastaccess = ++catcacheClock;
 
 		/* Bump the list's refcount and return it */
 		ResourceOwnerEnlargeCatCacheListRefs(CurrentResourceOwner);
@@ -1489,9 +1641,7 @@ SearchCatCacheList(CatCache *cache,
 		CACHE2_elog(DEBUG2, "SearchCatCacheList(%s): found list",
 					cache->cc_relname);
 
-#ifdef CATCACHE_STATS
 		cache->cc_lhits++;
-#endif
 
 		return cl;
 	}
@@ -1634,6 +1784,7 @@ SearchCatCacheList(CatCache *cache,
 	cl->ordered = ordered;
 	cl->nkeys = nkeys;
 	cl->hash_value = lHashValue;
+	cl->lastaccess = ++catcacheClock;
 	cl->n_members = nmembers;
 
 	i = 0;
@@ -1652,11 +1803,16 @@ SearchCatCacheList(CatCache *cache,
 	Assert(i == nmembers);
 
 	dlist_push_head(&cache->cc_lists, &cl->cache_elem);
+	cache->cc_memusage += CATCLIST_MEMUSAGE(cl);
+	CacheHdr->ch_memusage += CATCLIST_MEMUSAGE(cl);
 
 	/* Finally, bump the list's refcount and return it */
 	cl->refcount++;
 	ResourceOwnerRememberCatCacheListRef(CurrentResourceOwner, cl);
 
+	if (catalog_cache_memory_limit > 0)
+		CatCacheEnforceMemoryLimit();
+
 	CACHE3_elog(DEBUG2, "SearchCatCacheList(%s): made list of %d members",
 				cache->cc_relname, nmembers);
 
@@ -1733,11 +1889,14 @@ CatalogCacheCreateEntry(CatCache *cache, HeapTuple ntp,
 	ct->dead = false;
 	ct->negative = negative;
 	ct->hash_value = hashValue;
+	ct->lastaccess = ++catcacheClock;
 
 	dlist_push_head(&cache->cc_bucket[hashIndex], &ct->cache_elem);
 
 	cache->cc_ntup++;
 	CacheHdr->ch_ntup++;
+	cache->cc_memusage += CATCTUP_MEMUSAGE(ct);
+	CacheHdr->ch_memusage += CATCTUP_MEMUSAGE(ct);
 
 	/*
 	 * If the hash table has become too full, enlarge the buckets array. Quite
@@ -1936,3 +2095,109 @@ PrintCatCacheListLeakWarning(CatCList *list)
 		 list->my_cache->cc_relname, list->my_cache->id,
 		 list, list->refcount);
 }
+
+
+/*
+ * SQL function pg_catalog_cache_stats
+ *
+ * Report the size and effectiveness of this backend's catalog caches: one
+ * row per catcache, plus one for the relcache.
+ */
+Datum
+pg_catalog_cache_stats(PG_FUNCTION_ARGS)
+{
+#define PG_CATALOG_CACHE_STATS_COLS	11
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	TupleDesc	tupdesc;
+	Tuplestorestate *tupstore;
+	MemoryContext per_query_ctx;
+	MemoryContext oldcontext;
+	Datum		values[PG_CATALOG_CACHE_STATS_COLS];
+	bool		nulls[PG_CATALOG_CACHE_STATS_COLS];
+	long		rc_entries,
+				rc_searches,
+				rc_hits,
+				rc_evictions,
+				rc_invals;
+	Size		rc_memusage;
+
+	/* check to see if caller supports us returning a tuplestore */
+	if (rsinfo == NULL || !IsA(rsinfo, ReturnSetInfo))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("set-valued function called in context that cannot accept a set")));
+	if (!(rsinfo->allowedModes & SFRM_Materialize))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("materialize mode required, but it is not " \
+						"allowed in this context")));
+
+	/* Build a tuple descriptor for our result type */
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+
+	/* need to build tuplestore in query context */
+	per_query_ctx = rsinfo->econtext->ecxt_per_query_memory;
+	oldcontext = MemoryContextSwitchTo(per_query_ctx);
+
+	tupdesc = CreateTupleDescCopy(tupdesc);
+	tupstore =
+		tuplestore_begin_heap(rsinfo->allowedModes & SFRM_Materialize_Random,
+							  false, work_mem);
+
+	MemoryContextSwitchTo(oldcontext);
+
+	if (CacheHdr != NULL)
+	{
+		slist_iter	iter;
+
+		slist_foreach(iter, &CacheHdr->ch_caches)
+		{
+			CatCache   *cache = slist_container(CatCache, cc_next, iter.cur);
+
+			MemSet(nulls, 0, sizeof(nulls));
+			values[0] = CStringGetTextDatum("catcache");
+			values[1] = Int32GetDatum(cache->id);
+			values[2] = ObjectIdGetDatum(cache->cc_reloid);
+			values[3] = ObjectIdGetDatum(cache->cc_indexoid);
+			values[4] = Int64GetDatum((int64) cache->cc_ntup);
+			values[5] = Int64GetDatum((int64) cache->cc_memusage);
+			values[6] = Int64GetDatum((int64) (cache->cc_searches +
+											   cache->cc_lsearches));
+			values[7] = Int64GetDatum((int64) (cache->cc_hits +
+											   cache->cc_lhits));
+			values[8] = Int64GetDatum((int64) cache->cc_neg_hits);
+			values[9] = Int64GetDatum((int64) cache->cc_evictions);
+			values[10] = Int64GetDatum((int64) cache->cc_invals);
+
+			tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+		}
+	}
+
+	RelationCacheGetStats(&rc_entries, &rc_memusage, &rc_searches, &rc_hits,
+						  &rc_evictions, &rc_invals);
+
+	MemSet(nulls, 0, sizeof(nulls));
+	values[0] = CStringGetTextDatum("relcache");
+	nulls[1] = true;
+	nulls[2] = true;
+	nulls[3] = true;
+	values[4] = Int64GetDatum((int64) rc_entries);
+	values[5] = Int64GetDatum((int64) rc_memusage);
+	values[6] = Int64GetDatum((int64) rc_searches);
+	values[7] = Int64GetDatum((int64) rc_hits);
+	nulls[8] = true;
+	values[9] = Int64GetDatum((int64) rc_evictions);
+	values[10] = Int64GetDatum((int64) rc_invals);
+
+	tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+
+	/* clean up and return the tuplestore */
+	tuplestore_donestoring(tupstore);
+
+	rsinfo->returnMode = SFRM_Materialize;
+	rsinfo->setResult = tupstore;
+	rsinfo->setDesc = tupdesc;
+
+	return (Datum) 0;
+}
@@ -854,13 +854,15 @@ ProcessCommittedInvalidationMessages(SharedInvalidationMessage *msgs,
 									 int nmsgs, bool RelcacheInitFileInval,
 									 Oid dbid, Oid tsid)
 {
+	bool		initFileLocked = false;
+
 	if (nmsgs <= 0)
 		return;
 
 	elog(trace_recovery(DEBUG4), "replaying commit with %d messages%s", nmsgs,
 		 (RelcacheInitFileInval ? " and relcache file invalidation" : ""));
 
-	if (RelcacheInitFileInval)
+	if (RelcacheInitFileInval || relcache_preload_threshold > 0)
 	{
 		/*
 		 * RelationCacheInitFilePreInvalidate requires DatabasePath to be set,
@@ -869,19 +871,94 @@ ProcessCommittedInvalidationMessages(SharedInvalidationMessage *msgs,
 		 * hack: set DatabasePath directly then unset after use.
 		 */
 		DatabasePath = GetDatabasePath(dbid, tsid);
-		elog(trace_recovery(DEBUG4), "removing relcache init file in \"%s\"",
-			 DatabasePath);
-		RelationCacheInitFilePreInvalidate();
+		if (RelcacheInitFileInval)
+		{
+			elog(trace_recovery(DEBUG4), "removing relcache init file in \"%s\"",
+				 DatabasePath);
+			RelationCacheInitFilePreInvalidate();
+			initFileLocked = true;
+		}
+		else
+			initFileLocked = PreInvalidatePreloadedRels(msgs, nmsgs, dbid);
 		pfree(DatabasePath);
 		DatabasePath = NULL;
 	}
 
 	SendSharedInvalidMessages(msgs, nmsgs);
 
-	if (RelcacheInitFileInval)
+	if (initFileLocked)
 		RelationCacheInitFilePostInvalidate();
 }
 
+/*
+ * PreInvalidatePreloadedRels
+ *		Check the relcache invals among msgs[] against the relations that
+ *		relcache_preload_threshold put into the local init file of database
+ *		dbid.  Used at commit when RelcacheInitFileInval is not set.
+ *
+ * Returns true if RelCacheInitLock was acquired; the caller must then call
+ * RelationCacheInitFilePostInvalidate after sending the messages.
+ */
+bool
+PreInvalidatePreloadedRels(const SharedInvalidationMessage *msgs, int nmsgs,
+						   Oid dbid)
+{
+	Oid		   *relids;
+	int			nrelids = 0;
+	int			i;
+	bool		result = false;
+
+	if (relcache_preload_threshold <= 0 || nmsgs <= 0)
+		return false;
+
+	relids = (Oid *) palloc(nmsgs * sizeof(Oid));
+	for (i = 0; i < nmsgs; i++)
+	{
+		if (msgs[i].id == SHAREDINVALRELCACHE_ID &&
+			msgs[i].rc.dbId == dbid && OidIsValid(msgs[i].rc.relId))
+			relids[nrelids++] = msgs[i].rc.relId;
+	}
+	if (nrelids > 0)
+		result = RelationCacheInitFilePreInvalidateRels(dbid, relids, nrelids);
+	pfree(relids);
+
+	return result;
+}
+
+/*
+ * As above, for the relcache invals queued up by the current transaction.
+ */
+static bool
+PreInvalidatePreloadedRelsList(InvalidationListHeader *hdr)
+{
+	Oid		   *relids;
+	int			nrelids = 0;
+	int			maxrelids = 0;
+	bool		result = false;
+
+	if (relcache_preload_threshold <= 0)
+		return false;
+
+	ProcessMessageList(hdr->rclist,
+					   if (msg->id == SHAREDINVALRELCACHE_ID)
+					   maxrelids++);
+	if (maxrelids == 0)
+		return false;
+
+	relids = (Oid *) palloc(maxrelids * sizeof(Oid));
+	ProcessMessageList(hdr->rclist,
+					   if (msg->id == SHAREDINVALRELCACHE_ID &&
+						   msg->rc.dbId == MyDatabaseId &&
+						   OidIsValid(msg->rc.relId))
+					   relids[nrelids++] = msg->rc.relId);
+	if (nrelids > 0)
+		result = RelationCacheInitFilePreInvalidateRels(MyDatabaseId,
+														relids, nrelids);
+	pfree(relids);
+
+	return result;
+}
+
 /*
  * AtEOXact_Inval
  *		Process queued-up invalidation messages at end of main transaction.
@@ -918,21 +995,27 @@ AtEOXact_Inval(bool isCommit)
 
 	if (isCommit)
 	{
+		bool		initFileLocked;
+
+		AppendInvalidationMessages(&transInvalInfo->PriorCmdInvalidMsgs,
+								   &transInvalInfo->CurrentCmdInvalidMsgs);
+
 		/*
 		 * Relcache init file invalidation requires processing both before and
 		 * after we send the SI messages.  However, we need not do anything
 		 * unless we committed.
 		 */
-		if (transInvalInfo->RelcacheInitFileInval)
+		initFileLocked = transInvalInfo->RelcacheInitFileInval;
+		if (initFileLocked)
 			RelationCacheInitFilePreInvalidate();
-
-		AppendInvalidationMessages(&transInvalInfo->PriorCmdInvalidMsgs,
-								   &transInvalInfo->CurrentCmdInvalidMsgs);
+		else
+			initFileLocked =
+				PreInvalidatePreloadedRelsList(&transInvalInfo->PriorCmdInvalidMsgs);
 
 		ProcessInvalidationMessagesMulti(&transInvalInfo->PriorCmdInvalidMsgs,
 										 SendSharedInvalidMessages);
 
-		if (transInvalInfo->RelcacheInitFileInval)
+		if (initFileLocked)
 			RelationCacheInitFilePostInvalidate();
 	}
 	else
@@ -1059,6 +1142,19 @@ CommandEndInvalidationMessages(void)
 							   &transInvalInfo->CurrentCmdInvalidMsgs);
 }
 
+/*
+ * InvalidationMessagesPending
+ *		Has the current transaction registered any invalidations?
+ *
+ * Other backends won't see them until we commit, so anything we derive from
+ * the catalogs meanwhile must not be shared with them.
+ */
+bool
+InvalidationMessagesPending(void)
+{
+	return transInvalInfo != NULL;
+}
+
 
 /*
  * CacheInvalidateHeapTuple
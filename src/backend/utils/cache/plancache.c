@@ -19,6 +19,9 @@
  * re-planning if the active search_path is different from the previous time
  * or, if RLS is involved, if the user changes or the RLS environment changes.
  *
+ * Generic plans of saved queries can also be shared with other backends
+ * through the shared plan cache; see sharedplancache.c.
+ *
  * Note that if the sinval was a result of user DDL actions, parse analysis
  * could throw an error, for example if a column referenced by the query is
  * no longer present.  Another possibility is for the query's output tupdesc
@@ -68,6 +71,7 @@
 #include "utils/memutils.h"
 #include "utils/resowner_private.h"
 #include "utils/rls.h"
+#include "utils/sharedplancache.h"
 #include "utils/snapmgr.h"
 #include "utils/syscache.h"
 
@@ -93,6 +97,9 @@ static List *RevalidateCachedQuery(CachedPlanSource *plansource);
 static bool CheckCachedPlan(CachedPlanSource *plansource);
 static CachedPlan *BuildCachedPlan(CachedPlanSource *plansource, List *qlist,
 				ParamListInfo boundParams);
+static CachedPlan *MakeCachedPlan(CachedPlanSource *plansource, List *plist,
+			   MemoryContext plan_context);
+static bool InstallSharedGenericPlan(CachedPlanSource *plansource);
 static bool choose_custom_plan(CachedPlanSource *plansource,
 				   ParamListInfo boundParams);
 static double cached_plan_cost(CachedPlan *plan, bool include_planner);
@@ -208,6 +215,7 @@ CreateCachedPlan(Node *raw_parse_tree,
 	plansource->generic_cost = -1;
 	plansource->total_custom_cost = 0;
 	plansource->num_custom_plans = 0;
+	plansource->shared_costs_fetched = false;
 	plansource->hasRowSecurity = false;
 	plansource->planUserId = InvalidOid;
 	plansource->row_security_env = false;
@@ -276,6 +284,7 @@ CreateOneShotCachedPlan(Node *raw_parse_tree,
 	plansource->generic_cost = -1;
 	plansource->total_custom_cost = 0;
 	plansource->num_custom_plans = 0;
+	plansource->shared_costs_fetched = false;
 	plansource->planUserId = InvalidOid;
 	plansource->row_security_env = false;
 
@@ -901,7 +910,6 @@ BuildCachedPlan(CachedPlanSource *plansource, List *qlist,
 	bool		spi_pushed;
 	MemoryContext plan_context;
 	MemoryContext oldcxt = CurrentMemoryContext;
-	ListCell	*lc;
 
 	/*
 	 * Normally the querytree should be valid already, but if it's not,
@@ -993,6 +1001,28 @@ BuildCachedPlan(CachedPlanSource *plansource, List *qlist,
 	/*
 	 * Create and fill the CachedPlan struct within the new context.
 	 */
+	plan = MakeCachedPlan(plansource, plist, plan_context);
+
+	MemoryContextSwitchTo(oldcxt);
+
+	return plan;
+}
+
+/*
+ * MakeCachedPlan: create the CachedPlan struct for a finished plan.
+ *
+ * plist is the list of statements making up the plan; it and the new struct
+ * live in plan_context, which must be the current memory context.
+ */
+static CachedPlan *
+MakeCachedPlan(CachedPlanSource *plansource, List *plist,
+			   MemoryContext plan_context)
+{
+	CachedPlan *plan;
+	ListCell   *lc;
+
+	Assert(CurrentMemoryContext == plan_context);
+
 	plan = (CachedPlan *) palloc(sizeof(CachedPlan));
 	plan->magic = CACHEDPLAN_MAGIC;
 	plan->stmt_list = plist;
@@ -1026,9 +1056,56 @@ BuildCachedPlan(CachedPlanSource *plansource, List *qlist,
 	/* assign generation number to new plan */
 	plan->generation = ++(plansource->generation);
 
+	return plan;
+}
+
+/*
+ * InstallSharedGenericPlan: adopt another backend's generic plan, if any.
+ *
+ * If the shared plan cache has a generic plan for this plansource, make a
+ * local CachedPlan out of it and link it in as plansource->gplan, exactly as
+ * if we had built it ourselves.  Returns true if that happened.
+ *
+ * The plan has not been locked or checked for validity; the caller must do
+ * that via CheckCachedPlan before using it.
+ */
+static bool
+InstallSharedGenericPlan(CachedPlanSource *plansource)
+{
+	CachedPlan *plan;
+	List	   *plist;
+	MemoryContext plan_context;
+	MemoryContext oldcxt;
+
+	Assert(plansource->is_saved);
+	Assert(plansource->gplan == NULL);
+
+	plan_context = AllocSetContextCreate(CacheMemoryContext,
+										 "CachedPlan",
+										 ALLOCSET_SMALL_MINSIZE,
+										 ALLOCSET_SMALL_INITSIZE,
+										 ALLOCSET_DEFAULT_MAXSIZE);
+	oldcxt = MemoryContextSwitchTo(plan_context);
+
+	plist = SharedPlanCacheFetchPlan(plansource);
+	if (plist == NIL)
+	{
+		MemoryContextSwitchTo(oldcxt);
+		MemoryContextDelete(plan_context);
+		return false;
+	}
+
+	plan = MakeCachedPlan(plansource, plist, plan_context);
+	plan->is_saved = true;
+
 	MemoryContextSwitchTo(oldcxt);
 
-	return plan;
+	/* Link the new generic plan into the plansource */
+	plansource->gplan = plan;
+	plan->refcount++;
+	plansource->generic_cost = cached_plan_cost(plan, false);
+
+	return true;
 }
 
 /*
@@ -1170,9 +1247,34 @@ GetCachedPlan(CachedPlanSource *plansource, ParamListInfo boundParams,
 	/* Make sure the querytree list is valid and we have parse-time locks */
 	qlist = RevalidateCachedQuery(plansource);
 
+	/*
+	 * If we have no experience with custom plans yet, borrow that of the
+	 * backend that stored the shared generic plan, if any.
+	 */
+	if (boundParams != NULL && plansource->num_custom_plans == 0 &&
+		!plansource->shared_costs_fetched &&
+		SharedPlanCacheUsable(plansource))
+	{
+		(void) SharedPlanCacheFetchCosts(plansource,
+										 &plansource->total_custom_cost,
+										 &plansource->num_custom_plans);
+		/* once is enough, if there are none now, we'll make our own */
+		plansource->shared_costs_fetched = true;
+	}
+
 	/* Decide whether to use a custom plan */
 	customplan = choose_custom_plan(plansource, boundParams);
 
+	/*
+	 * If we want a generic plan but haven't got one, check whether another
+	 * backend has already made it.  Now that the generic plan's cost is
+	 * known, reconsider the decision, as we do below for plans we make.
+	 */
+	if (!customplan && plansource->gplan == NULL &&
+		SharedPlanCacheUsable(plansource) &&
+		InstallSharedGenericPlan(plansource))
+		customplan = choose_custom_plan(plansource, boundParams);
+
 	if (!customplan)
 	{
 		if (CheckCachedPlan(plansource))
@@ -1183,6 +1285,8 @@ GetCachedPlan(CachedPlanSource *plansource, ParamListInfo boundParams,
 		}
 		else
 		{
+			uint32		generation = SharedPlanCacheGeneration();
+
 			/* Build a new generic plan */
 			plan = BuildCachedPlan(plansource, qlist, NULL);
 			/* Just make real sure plansource->gplan is clear */
@@ -1206,6 +1310,10 @@ GetCachedPlan(CachedPlanSource *plansource, ParamListInfo boundParams,
 			/* Update generic_cost whenever we make a new generic plan */
 			plansource->generic_cost = cached_plan_cost(plan, false);
 
+			/* Offer it to other backends, too */
+			if (SharedPlanCacheUsable(plansource))
+				SharedPlanCacheStore(plansource, plan->stmt_list, generation);
+
 			/*
 			 * If, based on the now-known value of generic_cost, we'd not have
 			 * chosen to use a generic plan, then forget it and make a custom
@@ -1414,6 +1522,7 @@ CopyCachedPlan(CachedPlanSource *plansource)
 	newsource->generic_cost = plansource->generic_cost;
 	newsource->total_custom_cost = plansource->total_custom_cost;
 	newsource->num_custom_plans = plansource->num_custom_plans;
+	newsource->shared_costs_fetched = plansource->shared_costs_fetched;
 
 	/*
 	 * Copy over the user the query was planned as, and under what RLS
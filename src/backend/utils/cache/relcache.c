@@ -34,6 +34,8 @@
 #include "access/multixact.h"
 #include "access/reloptions.h"
 #include "access/sysattr.h"
+#include "access/tableam.h"
+#include "access/transam.h"
 #include "access/xact.h"
 #include "access/xlog.h"
 #include "catalog/catalog.h"
@@ -64,9 +66,13 @@
 #include "optimizer/planmain.h"
 #include "optimizer/prep.h"
 #include "optimizer/var.h"
+#include "postmaster/autovacuum.h"
+#include "replication/walsender.h"
 #include "rewrite/rewriteDefine.h"
 #include "rewrite/rowsecurity.h"
+#include "storage/ipc.h"
 #include "storage/lmgr.h"
+#include "storage/shmem.h"
 #include "storage/smgr.h"
 #include "utils/array.h"
 #include "utils/builtins.h"
@@ -86,7 +92,14 @@
  */
 #define RELCACHE_INIT_FILENAME	"pg_internal.init"
 
-#define RELCACHE_INIT_FILEMAGIC		0x573266	/* version ID value */
+#define RELCACHE_INIT_FILEMAGIC		0x573267	/* version ID value */
+
+/*
+ *		limits on the number of non-catalog relations preloaded into the
+ *		local init files (see relcache_preload_threshold)
+ */
+#define MAX_PRELOADED_RELS_PER_DB	1024
+#define MAX_PRELOADED_RELS			8192
 
 /*
  *		hardcoded tuple descriptors, contents generated by genbki.pl
@@ -135,6 +148,46 @@ bool		criticalSharedRelcachesBuilt = false;
  */
 static long relcacheInvalsReceived = 0L;
 
+/* GUC parameters */
+int			relcache_preload_threshold = 0;
+int			relation_cache_memory_limit = 0;	/* kilobytes, 0 = no limit */
+
+/*
+ * Approximate memory used by all relcache entries (see
+ * RelationEstimateMemUsage), the logical clock used to find the least
+ * recently used ones when relation_cache_memory_limit is exceeded, and
+ * statistics for pg_catalog_cache_stats().
+ */
+static Size relcacheMemUsage = 0;
+static uint64 relcacheClock = 0;
+static long relcacheSearches = 0L;
+static long relcacheHits = 0L;
+static long relcacheEvictions = 0L;
+
+/*
+ * When relcache_preload_threshold is enabled, the local init files may also
+ * contain entries for ordinary relations that a backend used heavily.  Unlike
+ * the catalogs selected by RelationIdIsInInitFile, other backends have no way
+ * to know which relations those are, so the writer registers them in shared
+ * memory.  A committing transaction that sends relcache invals for any
+ * registered relation removes the init file, exactly as it would for a
+ * catalog change.  The registry is kept sorted by (dbId, relId) and is
+ * protected by RelCacheInitLock.
+ */
+typedef struct PreloadedRel
+{
+	Oid			dbId;
+	Oid			relId;
+} PreloadedRel;
+
+typedef struct PreloadedRelRegistry
+{
+	int			nrels;
+	PreloadedRel rels[MAX_PRELOADED_RELS];
+} PreloadedRelRegistry;
+
+static PreloadedRelRegistry *preloadedRels = NULL;
+
 /*
  * eoxact_list[] stores the OIDs of relations that (might) need AtEOXact
  * cleanup work.  This list intentionally has limited size; if it overflows,
@@ -176,11 +229,14 @@ do { \
 	hentry = (RelIdCacheEnt *) hash_search(RelationIdCache, \
 										   (void *) &((RELATION)->rd_id), \
 										   HASH_ENTER, &found); \
+	(RELATION)->rd_memusage = RelationEstimateMemUsage(RELATION); \
+	relcacheMemUsage += (RELATION)->rd_memusage; \
 	if (found) \
 	{ \
 		/* see comments in RelationBuildDesc and RelationBuildLocalRelation */ \
 		Relation _old_rel = hentry->reldesc; \
 		Assert(replace_allowed); \
+		relcacheMemUsage -= _old_rel->rd_memusage; \
 		hentry->reldesc = (RELATION); \
 		if (RelationHasReferenceCountZero(_old_rel)) \
 			RelationDestroyRelation(_old_rel, false); \
@@ -213,6 +269,8 @@ do { \
 	if (hentry == NULL) \
 		elog(WARNING, "failed to delete relcache entry for OID %u", \
 			 (RELATION)->rd_id); \
+	else \
+		relcacheMemUsage -= (RELATION)->rd_memusage; \
 } while(0)
 
 
@@ -247,8 +305,20 @@ static void AtEOXact_cleanup(Relation relation, bool isCommit);
 static void AtEOSubXact_cleanup(Relation relation, bool isCommit,
 					SubTransactionId mySubid, SubTransactionId parentSubid);
 static bool load_relcache_init_file(bool shared);
-static void write_relcache_init_file(bool shared);
+static void write_relcache_init_file(bool shared, bool preload);
+static void write_relcache_entry(Relation rel, FILE *fp);
 static void write_item(const void *data, Size len, FILE *fp);
+static bool read_fixed_item(void *data, Size len, FILE *fp);
+static char *read_string_item(FILE *fp);
+static bool RelationIsPreloadCandidate(Relation rel);
+static int	preload_candidate_cmp(const void *a, const void *b);
+static int	preloaded_rel_cmp(const void *a, const void *b);
+static bool preloaded_rel_registered(Oid dbId, Oid relId);
+static void forget_preloaded_rels(Oid dbId);
+static void remove_local_init_file(Oid dbId);
+static void RelationCacheInitFileAtExit(int code, Datum arg);
+static Size RelationEstimateMemUsage(Relation rel);
+static void RelationCacheEnforceMemoryLimit(void);
 
 static void formrdesc(const char *relationName, Oid relationReltype,
 		  bool isshared, bool hasoids,
@@ -1050,10 +1120,13 @@ RelationBuildDesc(Oid targetRelId, bool insertIt)
 		relation->rd_rsdesc = NULL;
 
 	/*
-	 * if it's an index, initialize index-related information
+	 * if it's an index, initialize index-related information; if it's a
+	 * table, find its table access method
 	 */
-	if (OidIsValid(relation->rd_rel->relam))
+	if (relation->rd_rel->relkind == RELKIND_INDEX)
 		RelationInitIndexAccessInfo(relation);
+	else
+		RelationInitTableAccessMethod(relation);
 
 	/* extract reloptions if any */
 	RelationParseRelOptions(relation, pg_class_tuple);
@@ -1188,6 +1261,32 @@ InitIndexAmRoutine(Relation relation)
 	pfree(tmp);
 }
 
+/*
+ * Initialize table-access-method support for a relation
+ *
+ * Only relations with heap-like storage have a table access method.  Those
+ * with relam = InvalidOid, including all the system catalogs, use the heap.
+ */
+void
+RelationInitTableAccessMethod(Relation relation)
+{
+	switch (relation->rd_rel->relkind)
+	{
+		case RELKIND_RELATION:
+		case RELKIND_MATVIEW:
+		case RELKIND_TOASTVALUE:
+			if (OidIsValid(relation->rd_rel->relam))
+				relation->rd_tableam =
+					GetTableAmRoutineByAmId(relation->rd_rel->relam);
+			else
+				relation->rd_tableam = GetHeapamTableAmRoutine();
+			break;
+		default:
+			relation->rd_tableam = NULL;
+			break;
+	}
+}
+
 /*
  * Initialize index-access-method support data for an index relation
  */
@@ -1713,6 +1812,9 @@ formrdesc(const char *relationName, Oid relationReltype,
 	 */
 	RelationInitPhysicalAddr(relation);
 
+	/* all the rels formrdesc is used for are heaps */
+	RelationInitTableAccessMethod(relation);
+
 	/*
 	 * initialize the rel-has-index flag, using hardwired knowledge
 	 */
@@ -1766,6 +1868,8 @@ RelationIdGetRelation(Oid relationId)
 	/* Make sure we're in an xact, even if this ends up being a cache hit */
 	Assert(IsTransactionState());
 
+	relcacheSearches++;
+
 	/*
 	 * first try to find reldesc in the cache
 	 */
@@ -1773,7 +1877,11 @@ RelationIdGetRelation(Oid relationId)
 
 	if (RelationIsValid(rd))
 	{
+		relcacheHits++;
 		RelationIncrementReferenceCount(rd);
+		rd->rd_lastaccess = ++relcacheClock;
+		if (rd->rd_accesscnt < INT_MAX)
+			rd->rd_accesscnt++;
 		/* revalidate cache entry if necessary */
 		if (!rd->rd_isvalid)
 		{
@@ -1797,10 +1905,136 @@ RelationIdGetRelation(Oid relationId)
 	 */
 	rd = RelationBuildDesc(relationId, true);
 	if (RelationIsValid(rd))
+	{
 		RelationIncrementReferenceCount(rd);
+		rd->rd_lastaccess = ++relcacheClock;
+		rd->rd_accesscnt++;
+
+		/* The new entry is referenced, so this can't remove it */
+		if (relation_cache_memory_limit > 0)
+			RelationCacheEnforceMemoryLimit();
+	}
 	return rd;
 }
 
+/*
+ * RelationEstimateMemUsage
+ *		Estimate the memory used by a relcache entry.
+ *
+ * This covers what is set up when the entry is built; data that is filled in
+ * lazily later, such as the index list or index expressions, isn't counted.
+ */
+static Size
+RelationEstimateMemUsage(Relation rel)
+{
+	Size		size;
+
+	size = sizeof(RelationData) + CLASS_TUPLE_SIZE;
+	if (rel->rd_att)
+		size += sizeof(struct tupleDesc) +
+			rel->rd_att->natts * (sizeof(Form_pg_attribute) +
+								  ATTRIBUTE_FIXED_PART_SIZE);
+	if (rel->rd_options)
+		size += VARSIZE(rel->rd_options);
+	if (rel->rd_indextuple)
+		size += HEAPTUPLESIZE + rel->rd_indextuple->t_len;
+	if (rel->rd_indexcxt)
+		size += MemoryContextMemAllocated(rel->rd_indexcxt, true);
+	if (rel->rd_rulescxt)
+		size += MemoryContextMemAllocated(rel->rd_rulescxt, true);
+	if (rel->rd_rsdesc)
+		size += MemoryContextMemAllocated(rel->rd_rsdesc->rscxt, true);
+	if (rel->trigdesc)
+		size += sizeof(TriggerDesc) +
+			rel->trigdesc->numtriggers * sizeof(Trigger);
+
+	return size;
+}
+
+static int
+relcache_lru_cmp(const void *a, const void *b)
+{
+	Relation	ra = *(const Relation *) a;
+	Relation	rb = *(const Relation *) b;
+
+	if (ra->rd_lastaccess < rb->rd_lastaccess)
+		return -1;
+	if (ra->rd_lastaccess > rb->rd_lastaccess)
+		return 1;
+	return 0;
+}
+
+/*
+ * RelationCacheEnforceMemoryLimit
+ *		Evict least-recently-used relcache entries beyond
+ *		relation_cache_memory_limit.
+ *
+ * Only entries with zero refcount are candidates, and removing one is no
+ * different from processing an invalidation for it.  We leave alone nailed
+ * entries, entries with transaction-local state, and the catalogs kept in
+ * the init file, which are few and needed constantly.  Once over the limit,
+ * we evict down to 90% of it so that we don't have to rescan the hashtable
+ * for every new entry.
+ */
+static void
+RelationCacheEnforceMemoryLimit(void)
+{
+	Size		limit = (Size) relation_cache_memory_limit * 1024;
+	Size		target = limit - limit / 10;
+	HASH_SEQ_STATUS status;
+	RelIdCacheEnt *idhentry;
+	Relation   *victims;
+	int			nvictims = 0;
+	int			i;
+
+	if (relcacheMemUsage <= limit || !criticalRelcachesBuilt ||
+		IsBootstrapProcessingMode())
+		return;
+
+	victims = (Relation *)
+		palloc(hash_get_num_entries(RelationIdCache) * sizeof(Relation));
+
+	hash_seq_init(&status, RelationIdCache);
+	while ((idhentry = (RelIdCacheEnt *) hash_seq_search(&status)) != NULL)
+	{
+		Relation	rel = idhentry->reldesc;
+
+		if (!RelationHasReferenceCountZero(rel) || rel->rd_isnailed ||
+			rel->rd_createSubid != InvalidSubTransactionId ||
+			rel->rd_newRelfilenodeSubid != InvalidSubTransactionId ||
+			rel->rd_rel->relisshared ||
+			RelationIdIsInInitFile(RelationGetRelid(rel)))
+			continue;
+		victims[nvictims++] = rel;
+	}
+
+	qsort(victims, nvictims, sizeof(Relation), relcache_lru_cmp);
+
+	for (i = 0; i < nvictims && relcacheMemUsage > target; i++)
+	{
+		RelationClearRelation(victims[i], false);
+		relcacheEvictions++;
+	}
+
+	pfree(victims);
+}
+
+/*
+ * RelationCacheGetStats
+ *		Report relcache size and usage statistics for pg_catalog_cache_stats.
+ */
+void
+RelationCacheGetStats(long *entries, Size *memusage, long *searches,
+					  long *hits, long *evictions, long *invals)
+{
+	*entries = RelationIdCache ? hash_get_num_entries(RelationIdCache) : 0;
+	*memusage = relcacheMemUsage;
+	*searches = relcacheSearches;
+	*hits = relcacheHits;
+	*evictions = relcacheEvictions;
+	*invals = relcacheInvalsReceived;
+}
+
 /* ----------------------------------------------------------------
  *				cache invalidation support routines
  * ----------------------------------------------------------------
@@ -2293,6 +2527,15 @@ RelationClearRelation(Relation relation, bool rebuild)
 		SWAPFIELD(Oid, rd_toastoid);
 		/* pgstat_info must be preserved */
 		SWAPFIELD(struct PgStat_TableStatus *, pgstat_info);
+		/* so must the init-file preloading and LRU state */
+		SWAPFIELD(bool, rd_preloaded);
+		SWAPFIELD(int, rd_accesscnt);
+		SWAPFIELD(uint64, rd_lastaccess);
+		/* the accounted size is the old one; replace it by the new one */
+		SWAPFIELD(Size, rd_memusage);
+		relcacheMemUsage -= relation->rd_memusage;
+		relation->rd_memusage = RelationEstimateMemUsage(relation);
+		relcacheMemUsage += relation->rd_memusage;
 
 #undef SWAPFIELD
 
@@ -3019,6 +3262,9 @@ RelationBuildLocalRelation(const char *relname,
 
 	RelationInitPhysicalAddr(rel);
 
+	/* heap unless the caller sets relam and calls this again */
+	RelationInitTableAccessMethod(rel);
+
 	/*
 	 * Okay to insert into the relcache hash table.
 	 *
@@ -3544,9 +3790,21 @@ RelationCacheInitializePhase3(void)
 		InitCatalogCachePhase2();
 
 		/* now write the files */
-		write_relcache_init_file(true);
-		write_relcache_init_file(false);
+		write_relcache_init_file(true, false);
+		write_relcache_init_file(false, false);
 	}
+
+	/*
+	 * If enabled, arrange to save the relations this backend used heavily
+	 * into the local init file when it exits.  Only regular backends do;
+	 * background workers, including parallel workers, and autovacuum see
+	 * little of what sessions will need.
+	 */
+	if (relcache_preload_threshold > 0 && preloadedRels != NULL &&
+		!IsBootstrapProcessingMode() && IsUnderPostmaster &&
+		!IsBackgroundWorker && !IsAutoVacuumWorkerProcess() &&
+		!am_walsender)
+		before_shmem_exit(RelationCacheInitFileAtExit, 0);
 }
 
 /*
@@ -4693,7 +4951,9 @@ errtableconstraint(Relation rel, const char *conname)
  *		just the ones that are absolutely critical; this allows us to speed
  *		up backend startup by not having to build such entries the hard way.
  *		Presently, all the catalog and index entries that are referred to
- *		by catcaches are stored in the initialization files.
+ *		by catcaches are stored in the initialization files.  Optionally
+ *		(relcache_preload_threshold), the local file also gets the ordinary
+ *		relations that exiting backends used most.
  *
  *		The same mechanism that detects when catcache and relcache entries
  *		need to be invalidated (due to catalog updates) also arranges to
@@ -4722,6 +4982,7 @@ load_relcache_init_file(bool shared)
 				max_rels,
 				nailed_rels,
 				nailed_indexes,
+				preloaded_rels,
 				magic;
 	int			i;
 
@@ -4744,7 +5005,7 @@ load_relcache_init_file(bool shared)
 	max_rels = 100;
 	rels = (Relation *) palloc(max_rels * sizeof(Relation));
 	num_rels = 0;
-	nailed_rels = nailed_indexes = 0;
+	nailed_rels = nailed_indexes = preloaded_rels = 0;
 
 	/* check for correct magic number (compatible version) */
 	if (fread(&magic, 1, sizeof(magic), fp) != sizeof(magic))
@@ -4759,6 +5020,8 @@ load_relcache_init_file(bool shared)
 		Relation	rel;
 		Form_pg_class relform;
 		bool		has_not_null;
+		uint16		num_defval;
+		uint16		num_check;
 
 		/* first read the relation descriptor length */
 		nread = fread(&len, 1, sizeof(len), fp);
@@ -4834,13 +5097,55 @@ load_relcache_init_file(bool shared)
 			rel->rd_options = NULL;
 		}
 
-		/* mark not-null status */
-		if (has_not_null)
+		/* next read the column defaults and check constraints */
+		if (!read_fixed_item(&num_defval, sizeof(num_defval), fp))
+			goto read_failed;
+		if (!read_fixed_item(&num_check, sizeof(num_check), fp))
+			goto read_failed;
+
+		/* mark not-null status, and fill in the other constraints */
+		if (has_not_null || num_defval > 0 || num_check > 0)
 		{
 			TupleConstr *constr = (TupleConstr *) palloc0(sizeof(TupleConstr));
 
-			constr->has_not_null = true;
+			constr->has_not_null = has_not_null;
 			rel->rd_att->constr = constr;
+
+			if (num_defval > 0)
+			{
+				constr->defval = (AttrDefault *)
+					palloc0(num_defval * sizeof(AttrDefault));
+				constr->num_defval = num_defval;
+				for (i = 0; i < num_defval; i++)
+				{
+					AttrDefault *def = &constr->defval[i];
+
+					if (!read_fixed_item(&def->adnum, sizeof(AttrNumber), fp))
+						goto read_failed;
+					if ((def->adbin = read_string_item(fp)) == NULL)
+						goto read_failed;
+				}
+			}
+
+			if (num_check > 0)
+			{
+				constr->check = (ConstrCheck *)
+					palloc0(num_check * sizeof(ConstrCheck));
+				constr->num_check = num_check;
+				for (i = 0; i < num_check; i++)
+				{
+					ConstrCheck *check = &constr->check[i];
+
+					if ((check->ccname = read_string_item(fp)) == NULL)
+						goto read_failed;
+					if ((check->ccbin = read_string_item(fp)) == NULL)
+						goto read_failed;
+					if (!read_fixed_item(&check->ccvalid, sizeof(bool), fp))
+						goto read_failed;
+					if (!read_fixed_item(&check->ccnoinherit, sizeof(bool), fp))
+						goto read_failed;
+				}
+			}
 		}
 
 		/* If it's an index, there's more to do */
@@ -4886,7 +5191,11 @@ load_relcache_init_file(bool shared)
 			 * that in the init file, since it contains function pointers that
 			 * might vary across server executions.  Fortunately, it should be
 			 * safe to call the amhandler even while bootstrapping indexes.)
+			 * Only built-in handlers can be called without catalog access, and
+			 * only indexes using them are written to the file.
 			 */
+			if (rel->rd_amhandler >= FirstBootstrapObjectId)
+				goto read_failed;
 			InitIndexAmRoutine(rel);
 
 			/* next, read the vector of opfamily OIDs */
@@ -4942,6 +5251,8 @@ load_relcache_init_file(bool shared)
 			nsupport = relform->relnatts * rel->rd_amroutine->amsupport;
 			rel->rd_supportinfo = (FmgrInfo *)
 				MemoryContextAllocZero(indexcxt, nsupport * sizeof(FmgrInfo));
+
+			rel->rd_tableam = NULL;
 		}
 		else
 		{
@@ -4959,6 +5270,16 @@ load_relcache_init_file(bool shared)
 			Assert(rel->rd_supportinfo == NULL);
 			Assert(rel->rd_indoption == NULL);
 			Assert(rel->rd_indcollation == NULL);
+
+			/*
+			 * The pointer we saved is meaningless in this process.  Only
+			 * heap tables are written to the file, so this needs no catalog
+			 * access; reject anything else rather than calling an AM handler
+			 * this early.
+			 */
+			if (OidIsValid(relform->relam))
+				goto read_failed;
+			RelationInitTableAccessMethod(rel);
 		}
 
 		/*
@@ -4999,6 +5320,18 @@ load_relcache_init_file(bool shared)
 		rel->rd_newRelfilenodeSubid = InvalidSubTransactionId;
 		rel->rd_amcache = NULL;
 		MemSet(&rel->pgstat_info, 0, sizeof(rel->pgstat_info));
+		rel->rd_accesscnt = 0;
+		rel->rd_lastaccess = 0;
+		rel->rd_memusage = 0;
+
+		/*
+		 * Anything in the local file that RelationIdIsInInitFile doesn't
+		 * know about was put there by relcache_preload_threshold.
+		 */
+		rel->rd_preloaded = (!shared &&
+							 !RelationIdIsInInitFile(RelationGetRelid(rel)));
+		if (rel->rd_preloaded)
+			preloaded_rels++;
 
 		/*
 		 * Recompute lock and physical addressing info.  This is needed in
@@ -5046,6 +5379,35 @@ load_relcache_init_file(bool shared)
 			/* We don't need an Assert() in this case */
 			goto read_failed;
 		}
+
+		/*
+		 * Preloaded relations are only safe to use if they are still
+		 * registered for this database; otherwise, nobody would have removed
+		 * the file on a change to them.  That covers, among other things, an
+		 * init file that CREATE DATABASE copied from the template database.
+		 */
+		if (preloaded_rels > 0)
+		{
+			bool		registered = (preloadedRels != NULL);
+
+			if (registered)
+			{
+				LWLockAcquire(RelCacheInitLock, LW_SHARED);
+				for (relno = 0; relno < num_rels; relno++)
+				{
+					if (rels[relno]->rd_preloaded &&
+						!preloaded_rel_registered(MyDatabaseId,
+											 RelationGetRelid(rels[relno])))
+					{
+						registered = false;
+						break;
+					}
+				}
+				LWLockRelease(RelCacheInitLock);
+			}
+			if (!registered)
+				goto read_failed;
+		}
 	}
 
 	/*
@@ -5082,9 +5444,15 @@ read_failed:
 /*
  * Write out a new initialization file with the current contents
  * of the relcache (either shared rels or local rels, as indicated).
+ *
+ * If preload is true, the local file also gets the non-catalog relations
+ * that qualify per RelationIsPreloadCandidate.  This is done at backend exit
+ * rather than startup, so unlike the startup case we cannot insist on not
+ * having received any relcache invals at all; it's enough that none arrive
+ * while we're writing.
  */
 static void
-write_relcache_init_file(bool shared)
+write_relcache_init_file(bool shared, bool preload)
 {
 	FILE	   *fp;
 	char		tempfilename[MAXPGPATH];
@@ -5092,13 +5460,20 @@ write_relcache_init_file(bool shared)
 	int			magic;
 	HASH_SEQ_STATUS status;
 	RelIdCacheEnt *idhentry;
+	long		invalsBefore = relcacheInvalsReceived;
+	Relation   *preload_rels = NULL;
+	int			num_preload = 0;
+	int			max_preload = 0;
+	bool		ok;
 	int			i;
 
+	Assert(!(shared && preload));
+
 	/*
 	 * If we have already received any relcache inval events, there's no
 	 * chance of succeeding so we may as well skip the whole thing.
 	 */
-	if (relcacheInvalsReceived != 0L)
+	if (!preload && relcacheInvalsReceived != 0L)
 		return;
 
 	/*
@@ -5146,6 +5521,12 @@ write_relcache_init_file(bool shared)
 	if (fwrite(&magic, 1, sizeof(magic), fp) != sizeof(magic))
 		elog(FATAL, "could not write init file");
 
+	if (preload)
+	{
+		max_preload = 64;
+		preload_rels = (Relation *) palloc(max_preload * sizeof(Relation));
+	}
+
 	/*
 	 * Write all the appropriate reldescs (in no particular order).
 	 */
@@ -5168,68 +5549,56 @@ write_relcache_init_file(bool shared)
 		 * criterion for rels to be kept in the init file, see also inval.c.
 		 * The reason for filtering here is to be sure that we don't put
 		 * anything into the local init file for which a relcache inval would
-		 * not cause invalidation of that init file.)
+		 * not cause invalidation of that init file.)  The exception is
+		 * preloaded relations, which we register in shared memory below for
+		 * the same purpose; collect those separately.
 		 */
 		if (!shared && !RelationIdIsInInitFile(RelationGetRelid(rel)))
 		{
 			/* Nailed rels had better get stored. */
 			Assert(!rel->rd_isnailed);
+			if (preload && RelationIsPreloadCandidate(rel))
+			{
+				if (num_preload >= max_preload)
+				{
+					max_preload *= 2;
+					preload_rels = (Relation *)
+						repalloc(preload_rels, max_preload * sizeof(Relation));
+				}
+				preload_rels[num_preload++] = rel;
+			}
 			continue;
 		}
 
-		/* first write the relcache entry proper */
-		write_item(rel, sizeof(RelationData), fp);
-
-		/* next write the relation tuple form */
-		write_item(relform, CLASS_TUPLE_SIZE, fp);
-
-		/* next, do all the attribute tuple form data entries */
-		for (i = 0; i < relform->relnatts; i++)
+		/*
+		 * At backend exit, an entry invalidated by a concurrent change may
+		 * still be in the cache; if it is a nailed one we can't produce a
+		 * usable file.
+		 */
+		if (!rel->rd_isvalid)
 		{
-			write_item(rel->rd_att->attrs[i], ATTRIBUTE_FIXED_PART_SIZE, fp);
+			if (rel->rd_isnailed)
+			{
+				hash_seq_term(&status);
+				goto write_failed;
+			}
+			continue;
 		}
 
-		/* next, do the access method specific field */
-		write_item(rel->rd_options,
-				   (rel->rd_options ? VARSIZE(rel->rd_options) : 0),
-				   fp);
+		write_relcache_entry(rel, fp);
+	}
 
-		/* If it's an index, there's more to do */
-		if (rel->rd_rel->relkind == RELKIND_INDEX)
-		{
-			/* write the pg_index tuple */
-			/* we assume this was created by heap_copytuple! */
-			write_item(rel->rd_indextuple,
-					   HEAPTUPLESIZE + rel->rd_indextuple->t_len,
-					   fp);
-
-			/* next, write the vector of opfamily OIDs */
-			write_item(rel->rd_opfamily,
-					   relform->relnatts * sizeof(Oid),
-					   fp);
-
-			/* next, write the vector of opcintype OIDs */
-			write_item(rel->rd_opcintype,
-					   relform->relnatts * sizeof(Oid),
-					   fp);
-
-			/* next, write the vector of support procedure OIDs */
-			write_item(rel->rd_support,
-					   relform->relnatts * (rel->rd_amroutine->amsupport * sizeof(RegProcedure)),
-					   fp);
-
-			/* next, write the vector of collation OIDs */
-			write_item(rel->rd_indcollation,
-					   relform->relnatts * sizeof(Oid),
-					   fp);
-
-			/* finally, write the vector of indoption values */
-			write_item(rel->rd_indoption,
-					   relform->relnatts * sizeof(int16),
-					   fp);
-		}
+	/* If there are too many preload candidates, keep the busiest ones */
+	if (num_preload > MAX_PRELOADED_RELS_PER_DB)
+	{
+		qsort(preload_rels, num_preload, sizeof(Relation),
+			  preload_candidate_cmp);
+		num_preload = MAX_PRELOADED_RELS_PER_DB;
 	}
 
+	for (i = 0; i < num_preload; i++)
+		write_relcache_entry(preload_rels[i], fp);
+
 	if (FreeFile(fp))
 		elog(FATAL, "could not write init file");
 
@@ -5250,11 +5619,45 @@ write_relcache_init_file(bool shared)
 	AcceptInvalidationMessages();
 
 	/*
-	 * If we have received any SI relcache invals since backend start, assume
-	 * we may have written out-of-date data.
+	 * If we have received any SI relcache invals since we started, assume we
+	 * may have written out-of-date data.  Likewise if there's no room left to
+	 * register the preloaded relations.
 	 */
-	if (relcacheInvalsReceived == 0L)
+	ok = (relcacheInvalsReceived == invalsBefore);
+	if (ok && num_preload > 0)
+	{
+		int			nother = 0;
+
+		for (i = 0; i < preloadedRels->nrels; i++)
+		{
+			if (preloadedRels->rels[i].dbId != MyDatabaseId)
+				nother++;
+		}
+		ok = (nother + num_preload <= MAX_PRELOADED_RELS);
+	}
+
+	if (ok)
 	{
+		/*
+		 * Replace this database's preloaded relations in the registry by the
+		 * ones we wrote.  This has to happen before the file becomes visible.
+		 */
+		if (!shared && preloadedRels != NULL)
+		{
+			forget_preloaded_rels(MyDatabaseId);
+			for (i = 0; i < num_preload; i++)
+			{
+				PreloadedRel *entry = &preloadedRels->rels[preloadedRels->nrels++];
+
+				entry->dbId = MyDatabaseId;
+				entry->relId = RelationGetRelid(preload_rels[i]);
+				preload_rels[i]->rd_preloaded = true;
+			}
+			if (num_preload > 0)
+				qsort(preloadedRels->rels, preloadedRels->nrels,
+					  sizeof(PreloadedRel), preloaded_rel_cmp);
+		}
+
 		/*
 		 * OK, rename the temp file to its final name, deleting any
 		 * previously-existing init file.
@@ -5274,6 +5677,101 @@ write_relcache_init_file(bool shared)
 	}
 
 	LWLockRelease(RelCacheInitLock);
+
+	if (preload_rels)
+		pfree(preload_rels);
+	return;
+
+write_failed:
+	FreeFile(fp);
+	unlink(tempfilename);
+	if (preload_rels)
+		pfree(preload_rels);
+}
+
+/*
+ * Write one relcache entry to an init file
+ */
+static void
+write_relcache_entry(Relation rel, FILE *fp)
+{
+	Form_pg_class relform = rel->rd_rel;
+	TupleConstr *constr = rel->rd_att->constr;
+	uint16		num_defval = constr ? constr->num_defval : 0;
+	uint16		num_check = constr ? constr->num_check : 0;
+	int			i;
+
+	/* first write the relcache entry proper */
+	write_item(rel, sizeof(RelationData), fp);
+
+	/* next write the relation tuple form */
+	write_item(relform, CLASS_TUPLE_SIZE, fp);
+
+	/* next, do all the attribute tuple form data entries */
+	for (i = 0; i < relform->relnatts; i++)
+	{
+		write_item(rel->rd_att->attrs[i], ATTRIBUTE_FIXED_PART_SIZE, fp);
+	}
+
+	/* next, do the access method specific field */
+	write_item(rel->rd_options,
+			   (rel->rd_options ? VARSIZE(rel->rd_options) : 0),
+			   fp);
+
+	/* next, do the column defaults and check constraints */
+	write_item(&num_defval, sizeof(num_defval), fp);
+	write_item(&num_check, sizeof(num_check), fp);
+	for (i = 0; i < num_defval; i++)
+	{
+		AttrDefault *def = &constr->defval[i];
+
+		write_item(&def->adnum, sizeof(AttrNumber), fp);
+		write_item(def->adbin, strlen(def->adbin) + 1, fp);
+	}
+	for (i = 0; i < num_check; i++)
+	{
+		ConstrCheck *check = &constr->check[i];
+
+		write_item(check->ccname, strlen(check->ccname) + 1, fp);
+		write_item(check->ccbin, strlen(check->ccbin) + 1, fp);
+		write_item(&check->ccvalid, sizeof(bool), fp);
+		write_item(&check->ccnoinherit, sizeof(bool), fp);
+	}
+
+	/* If it's an index, there's more to do */
+	if (rel->rd_rel->relkind == RELKIND_INDEX)
+	{
+		/* write the pg_index tuple */
+		/* we assume this was created by heap_copytuple! */
+		write_item(rel->rd_indextuple,
+				   HEAPTUPLESIZE + rel->rd_indextuple->t_len,
+				   fp);
+
+		/* next, write the vector of opfamily OIDs */
+		write_item(rel->rd_opfamily,
+				   relform->relnatts * sizeof(Oid),
+				   fp);
+
+		/* next, write the vector of opcintype OIDs */
+		write_item(rel->rd_opcintype,
+				   relform->relnatts * sizeof(Oid),
+				   fp);
+
+		/* next, write the vector of support procedure OIDs */
+		write_item(rel->rd_support,
+				   relform->relnatts * (rel->rd_amroutine->amsupport * sizeof(RegProcedure)),
+				   fp);
+
+		/* next, write the vector of collation OIDs */
+		write_item(rel->rd_indcollation,
+				   relform->relnatts * sizeof(Oid),
+				   fp);
+
+		/* finally, write the vector of indoption values */
+		write_item(rel->rd_indoption,
+				   relform->relnatts * sizeof(int16),
+				   fp);
+	}
 }
 
 /* write a chunk of data preceded by its length */
@@ -5286,6 +5784,111 @@ write_item(const void *data, Size len, FILE *fp)
 		elog(FATAL, "could not write init file");
 }
 
+/* read back a chunk written by write_item, which must be of size len */
+static bool
+read_fixed_item(void *data, Size len, FILE *fp)
+{
+	Size		itemlen;
+
+	if (fread(&itemlen, 1, sizeof(itemlen), fp) != sizeof(itemlen))
+		return false;
+	if (itemlen != len)
+		return false;
+	return fread(data, 1, len, fp) == len;
+}
+
+/* read back a null-terminated string written by write_item */
+static char *
+read_string_item(FILE *fp)
+{
+	Size		len;
+	char	   *str;
+
+	if (fread(&len, 1, sizeof(len), fp) != sizeof(len))
+		return NULL;
+	if (len == 0 || len > MaxAllocSize)
+		return NULL;
+	str = (char *) palloc(len);
+	if (fread(str, 1, len, fp) != len || str[len - 1] != '\0')
+		return NULL;
+	return str;
+}
+
+/*
+ * Determine whether a relcache entry that RelationIdIsInInitFile doesn't
+ * cover should nonetheless go into the local init file at backend exit.
+ *
+ * Rules, triggers and row security policies are rebuilt by
+ * RelationCacheInitializePhase3 the same way as for catalogs, and index
+ * expressions and predicates are computed on demand, so we needn't exclude
+ * relations having any of those.
+ */
+static bool
+RelationIsPreloadCandidate(Relation rel)
+{
+	Form_pg_class relform = rel->rd_rel;
+
+	if (relform->relisshared || rel->rd_isnailed || !rel->rd_isvalid)
+		return false;
+	if (rel->rd_createSubid != InvalidSubTransactionId ||
+		rel->rd_newRelfilenodeSubid != InvalidSubTransactionId)
+		return false;
+	if (relform->relpersistence == RELPERSISTENCE_TEMP)
+		return false;
+
+	switch (relform->relkind)
+	{
+		case RELKIND_RELATION:
+		case RELKIND_TOASTVALUE:
+		case RELKIND_MATVIEW:
+
+			/*
+			 * Tables using a non-heap access method are left out:
+			 * load_relcache_init_file would have to look up and call their
+			 * AM handler before the relcache is usable.
+			 */
+			if (OidIsValid(relform->relam))
+				return false;
+			break;
+		case RELKIND_INDEX:
+
+			/*
+			 * Likewise for indexes whose AM handler isn't built in, which
+			 * would need a catalog lookup to call.
+			 */
+			if (rel->rd_amhandler >= FirstBootstrapObjectId)
+				return false;
+			break;
+		default:
+			return false;
+	}
+
+	/* keep whatever was preloaded before, so other backends' work survives */
+	return rel->rd_preloaded ||
+		rel->rd_accesscnt >= relcache_preload_threshold;
+}
+
+/*
+ * qsort comparator ordering preload candidates busiest-first.  Relations
+ * already preloaded count as having reached the threshold once more.
+ */
+static int
+preload_candidate_cmp(const void *a, const void *b)
+{
+	Relation	ra = *(const Relation *) a;
+	Relation	rb = *(const Relation *) b;
+	int64		sa = (int64) ra->rd_accesscnt +
+	(ra->rd_preloaded ? relcache_preload_threshold : 0);
+	int64		sb = (int64) rb->rd_accesscnt +
+	(rb->rd_preloaded ? relcache_preload_threshold : 0);
+
+	if (sa > sb)
+		return -1;
+	if (sa < sb)
+		return 1;
+	return 0;
+}
+
 /*
  * Determine whether a given relation (identified by OID) is one of the ones
  * we should store in the local relcache init file.
@@ -5343,13 +5946,71 @@ RelationIdIsInInitFile(Oid relationId)
  */
 void
 RelationCacheInitFilePreInvalidate(void)
+{
+	LWLockAcquire(RelCacheInitLock, LW_EXCLUSIVE);
+
+	remove_local_init_file(MyDatabaseId);
+}
+
+/*
+ * Like RelationCacheInitFilePreInvalidate, for a committing transaction that
+ * sent relcache invals only for relations outside RelationIdIsInInitFile.
+ * Those matter only if they were preloaded into the init file of database
+ * dbId.  Returns false, without doing anything, if relcache_preload_threshold
+ * is disabled; otherwise takes RelCacheInitLock, removes the init file if
+ * needed, and returns true.  In the latter case the caller must call
+ * RelationCacheInitFilePostInvalidate after sending the SI messages.
+ *
+ * We must hold the lock even if none of the relations is registered right
+ * now, else a concurrent write_relcache_init_file could register one of them
+ * and install its file before our messages are visible to it.  But a shared
+ * lock is enough to keep writers out, so committing transactions don't
+ * serialize on it unless they actually have to remove the file.
+ */
+bool
+RelationCacheInitFilePreInvalidateRels(Oid dbId, const Oid *relids,
+									   int nrelids)
+{
+	int			i;
+
+	if (relcache_preload_threshold <= 0 || preloadedRels == NULL)
+		return false;
+
+	LWLockAcquire(RelCacheInitLock, LW_SHARED);
+
+	for (i = 0; i < nrelids; i++)
+	{
+		if (preloaded_rel_registered(dbId, relids[i]))
+		{
+			/*
+			 * A writer might get in between, but it can only add relations,
+			 * and the file is removed anyway.
+			 */
+			LWLockRelease(RelCacheInitLock);
+			LWLockAcquire(RelCacheInitLock, LW_EXCLUSIVE);
+			remove_local_init_file(dbId);
+			break;
+		}
+	}
+
+	return true;
+}
+
+/*
+ * Remove the local init file, whose path is given by DatabasePath, and
+ * forget about any relations preloaded into it.  Caller must hold
+ * RelCacheInitLock exclusively.
+ */
+static void
+remove_local_init_file(Oid dbId)
 {
 	char		initfilename[MAXPGPATH];
 
 	snprintf(initfilename, sizeof(initfilename), "%s/%s",
 			 DatabasePath, RELCACHE_INIT_FILENAME);
 
-	LWLockAcquire(RelCacheInitLock, LW_EXCLUSIVE);
+	if (OidIsValid(dbId))
+		forget_preloaded_rels(dbId);
 
 	if (unlink(initfilename) < 0)
 	{
@@ -5373,6 +6034,154 @@ RelationCacheInitFilePostInvalidate(void)
 	LWLockRelease(RelCacheInitLock);
 }
 
+/*
+ * Forget the preloaded relations of a database that is being dropped.
+ */
+void
+RelationCacheInitFileForgetDatabase(Oid dbId)
+{
+	if (preloadedRels == NULL)
+		return;
+
+	LWLockAcquire(RelCacheInitLock, LW_EXCLUSIVE);
+	forget_preloaded_rels(dbId);
+	LWLockRelease(RelCacheInitLock);
+}
+
+/* qsort/bsearch comparator for the preloaded-relation registry */
+static int
+preloaded_rel_cmp(const void *a, const void *b)
+{
+	const PreloadedRel *pa = (const PreloadedRel *) a;
+	const PreloadedRel *pb = (const PreloadedRel *) b;
+
+	if (pa->dbId != pb->dbId)
+		return (pa->dbId < pb->dbId) ? -1 : 1;
+	if (pa->relId != pb->relId)
+		return (pa->relId < pb->relId) ? -1 : 1;
+	return 0;
+}
+
+/*
+ * Is the given relation registered as preloaded?  Caller must hold
+ * RelCacheInitLock.
+ */
+static bool
+preloaded_rel_registered(Oid dbId, Oid relId)
+{
+	PreloadedRel key;
+
+	key.dbId = dbId;
+	key.relId = relId;
+	return bsearch(&key, preloadedRels->rels, preloadedRels->nrels,
+				   sizeof(PreloadedRel), preloaded_rel_cmp) != NULL;
+}
+
+/*
+ * Remove all registry entries of the given database, keeping the rest in
+ * order.  Caller must hold RelCacheInitLock exclusively.
+ */
+static void
+forget_preloaded_rels(Oid dbId)
+{
+	int			i,
+				j;
+
+	if (preloadedRels == NULL)
+		return;
+
+	for (i = 0, j = 0; i < preloadedRels->nrels; i++)
+	{
+		if (preloadedRels->rels[i].dbId != dbId)
+			preloadedRels->rels[j++] = preloadedRels->rels[i];
+	}
+	preloadedRels->nrels = j;
+}
+
+/*
+ * before_shmem_exit callback: if this backend opened relations often enough
+ * that they should be preloaded by future backends, and the local init file
+ * doesn't have them yet, rewrite it to include them.
+ */
+static void
+RelationCacheInitFileAtExit(int code, Datum arg)
+{
+	HASH_SEQ_STATUS status;
+	RelIdCacheEnt *idhentry;
+	bool		needed = false;
+
+	/* Don't bother if we're exiting because of an error */
+	if (code != 0 || RelationIdCache == NULL)
+		return;
+
+	/*
+	 * Is there anything worth adding to the file?  Relations that another
+	 * backend has preloaded since we started are in it already.
+	 */
+	LWLockAcquire(RelCacheInitLock, LW_SHARED);
+	hash_seq_init(&status, RelationIdCache);
+	while ((idhentry = (RelIdCacheEnt *) hash_seq_search(&status)) != NULL)
+	{
+		Relation	rel = idhentry->reldesc;
+
+		if (!rel->rd_preloaded &&
+			!RelationIdIsInInitFile(RelationGetRelid(rel)) &&
+			RelationIsPreloadCandidate(rel) &&
+			!preloaded_rel_registered(MyDatabaseId, RelationGetRelid(rel)))
+		{
+			hash_seq_term(&status);
+			needed = true;
+			break;
+		}
+	}
+	LWLockRelease(RelCacheInitLock);
+	if (!needed)
+		return;
+
+	/* Need to ensure we have a usable transaction. */
+	AbortOutOfAnyTransaction();
+	StartTransactionCommand();
+
+	/*
+	 * As at startup, make sure the catalogs used by the catcaches are in the
+	 * relcache so that the rewritten file is no less useful than before.
+	 */
+	InitCatalogCachePhase2();
+
+	write_relcache_init_file(false, true);
+
+	CommitTransactionCommand();
+}
+
+/*
+ * Report shared memory space needed by the preloaded-relation registry
+ */
+Size
+RelationCacheInitFileShmemSize(void)
+{
+	if (relcache_preload_threshold <= 0)
+		return 0;
+	return sizeof(PreloadedRelRegistry);
+}
+
+/*
+ * Allocate and initialize the preloaded-relation registry
+ */
+void
+RelationCacheInitFileShmemInit(void)
+{
+	bool		found;
+
+	if (relcache_preload_threshold <= 0)
+		return;
+
+	preloadedRels = (PreloadedRelRegistry *)
+		ShmemInitStruct("Preloaded Relcache Entries",
+						sizeof(PreloadedRelRegistry), &found);
+	if (!found)
+		preloadedRels->nrels = 0;
+}
+
 /*
  * Remove the init files during postmaster startup.
  *
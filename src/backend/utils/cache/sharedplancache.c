@@ -0,0 +1,896 @@
+/*-------------------------------------------------------------------------
+ *
+ * sharedplancache.c
+ *	  Cross-backend cache of generic plans.
+ *
+ * plancache.c keeps generic plans only for the lifetime of the backend that
+ * made them, so with connection pooling every session replans the same
+ * statements and relearns whether custom or generic plans are cheaper.  When
+ * shared_plan_cache_size is set, generic plans built for saved
+ * CachedPlanSources are additionally stored here, in serialized form
+ * (nodeToString), in a fixed-size area of the main shared memory segment.
+ * Another backend preparing the same query text under the same search_path,
+ * role, parameter types and cursor options can then read the plan back
+ * (stringToNode) instead of running the planner, and can seed its own
+ * custom-versus-generic bookkeeping from the costs observed by the backend
+ * that stored the entry.
+ *
+ * Storage is organized as a circular log: the planning environment (see
+ * spc_make_key), query text and plan string of each entry are written at the
+ * current head of the arena, and whatever older entries are in the way get
+ * evicted.  Eviction is thus in insertion order,
+ * which approximates LRU well enough for a cache whose entries are normally
+ * long-lived.  A FIFO of (key, sequence number) pairs remembers the
+ * insertion order; slots whose entry has since been removed or replaced are
+ * recognized by a mismatching sequence number and just skipped.
+ *
+ * Each entry records the relations and PlanInvalItems its plan depends on.
+ * Invalidation happens once, at the source: whenever a backend sends
+ * invalidation messages to the shared queue, normally when committing DDL,
+ * it removes the entries that depend on the objects they name, see
+ * SharedPlanCacheInvalidateMessages.  This happens after the messages are
+ * queued, so another backend that fetched a plan just before will still see
+ * the messages and throw its copy away, as it would a plan of its own.  A
+ * backend whose own transaction has queued invalidations doesn't use the
+ * cache at all, since its catalog changes aren't visible to the others yet.
+ * To avoid a backend storing a plan that was built just before an
+ * invalidation, we keep a global generation counter that every invalidation
+ * advances; a plan is only stored if the counter hasn't moved since before
+ * the backend processed pending invalidations and started planning.
+ *
+ * Plans are only shared when they are safe to reuse by any backend with the
+ * same key: utility statements, transient plans, plans with pushed-down
+ * foreign joins, and anything planned in a session that has a temporary
+ * namespace are kept private.  Settings that change how the query text is
+ * parsed or how its constants are read, such as standard_conforming_strings
+ * or DateStyle, are part of the key.  Note that planner GUCs (enable_*,
+ * work_mem and so on) are not, so sessions using different planner
+ * settings may end up sharing plans made under other settings.
+ *
+ *
+ * Portions Copyright (c) 1996-2016, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * IDENTIFICATION
+ *	  src/backend/utils/cache/sharedplancache.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/hash.h"
+#include "catalog/namespace.h"
+#include "lib/stringinfo.h"
+#include "miscadmin.h"
+#include "nodes/plannodes.h"
+#include "port/atomics.h"
+#include "storage/lwlock.h"
+#include "storage/shmem.h"
+#include "utils/guc.h"
+#include "utils/hsearch.h"
+#include "utils/inval.h"
+#include "utils/rls.h"
+#include "utils/sharedplancache.h"
+#include "utils/syscache.h"
+
+
+/* GUC parameter: size of the plan arena in kB, or 0 to disable */
+int			shared_plan_cache_size = 0;
+
+/*
+ * Limits on the number of dependencies we track per entry.  Plans depending
+ * on more objects than this are simply not shared.
+ */
+#define SPC_MAX_RELS		32
+#define SPC_MAX_FUNCS		16
+
+/* Average arena space per entry, used to size the hash table */
+#define SPC_AVG_ENTRY_SIZE	2048
+
+/*
+ * Settings that affect parse analysis or the values of constants folded into
+ * the plan.  Their current values are part of the planning environment.
+ */
+static const char *const spc_env_settings[] = {
+	"standard_conforming_strings",
+	"backslash_quote",
+	"array_nulls",
+	"transform_null_equals",
+	"DateStyle",
+	"IntervalStyle",
+	"TimeZone",
+	"extra_float_digits"
+};
+
+typedef struct SharedPlanKey
+{
+	Oid			dbid;			/* database the plan belongs to */
+	Oid			userid;			/* role the plan was made for */
+	uint32		query_hash;		/* hash of the query source text */
+	uint32		env_hash;		/* hash of the planning environment */
+} SharedPlanKey;
+
+typedef struct SharedPlanFuncDep
+{
+	int			cacheId;		/* syscache ID, see PlanInvalItem */
+	uint32		hashValue;		/* hash value of object's cache lookup key */
+} SharedPlanFuncDep;
+
+typedef struct SharedPlanEntry
+{
+	SharedPlanKey key;			/* hash key of entry - MUST BE FIRST */
+	uint64		seq;			/* insertion sequence number */
+	Size		offset;			/* location of entry's data in arena */
+	Size		len;			/* number of arena bytes used */
+	int			env_len;		/* length of planning environment */
+	int			query_len;		/* length of query text */
+	double		total_custom_cost;	/* custom plan costs seen by creator */
+	int			num_custom_plans;	/* number of plans included in total */
+	int			nrels;			/* number of valid entries in rels[] */
+	int			nfuncs;			/* number of valid entries in funcs[] */
+	Oid			rels[SPC_MAX_RELS];
+	SharedPlanFuncDep funcs[SPC_MAX_FUNCS];
+} SharedPlanEntry;
+
+/* Effect of an invalidation message, see spc_message_kind */
+typedef enum SpcMessageKind
+{
+	SPC_MSG_IGNORE,				/* doesn't affect shared plans */
+	SPC_MSG_REL,				/* invalidates plans using a relation */
+	SPC_MSG_FUNC,				/* invalidates plans using a function */
+	SPC_MSG_RESET				/* invalidates all plans */
+} SpcMessageKind;
+
+typedef struct SharedPlanFifoItem
+{
+	SharedPlanKey key;
+	uint64		seq;
+} SharedPlanFifoItem;
+
+/*
+ * Shared control structure.  The FIFO array and the arena follow it in the
+ * same shared memory chunk.
+ */
+typedef struct SharedPlanCacheCtl
+{
+	pg_atomic_uint32 generation;	/* advanced by every invalidation */
+	uint64		next_seq;		/* next insertion sequence number */
+	Size		arena_size;		/* size of arena, in bytes */
+	Size		head;			/* next free arena offset */
+	int			max_entries;	/* size of fifo[] */
+	int			fifo_start;		/* index of oldest FIFO item */
+	int			fifo_count;		/* number of FIFO items in use */
+} SharedPlanCacheCtl;
+
+#define SpcFifo(ctl) \
+	((SharedPlanFifoItem *) ((char *) (ctl) + MAXALIGN(sizeof(SharedPlanCacheCtl))))
+#define SpcArena(ctl) \
+	((char *) SpcFifo(ctl) + MAXALIGN((ctl)->max_entries * sizeof(SharedPlanFifoItem)))
+
+/* Pointers to shared state; NULL if the shared plan cache is disabled */
+static SharedPlanCacheCtl *spc = NULL;
+static HTAB *spc_hash = NULL;
+
+static int	spc_max_entries(void);
+static bool spc_make_key(CachedPlanSource *plansource, SharedPlanKey *key,
+			 StringInfo env);
+static SharedPlanEntry *spc_lookup(CachedPlanSource *plansource,
+		   SharedPlanKey *key, StringInfo env);
+static SharedPlanEntry *spc_fifo_front(void);
+static void spc_fifo_pop(void);
+static bool spc_reserve(Size len, Size *offset);
+static void spc_remove(SharedPlanEntry *entry);
+static void spc_remove_all(void);
+static SpcMessageKind spc_message_kind(const SharedInvalidationMessage *msg);
+static int	spc_oid_cmp(const void *a, const void *b);
+static bool spc_entry_is_invalidated(SharedPlanEntry *entry,
+						 const Oid *relids, int nrelids,
+						 const SharedPlanFuncDep *funcs, int nfuncs);
+
+
+/*
+ * Number of entries we make room for, based on the configured arena size.
+ */
+static int
+spc_max_entries(void)
+{
+	return Max((int) (((Size) shared_plan_cache_size * 1024) /
+					  SPC_AVG_ENTRY_SIZE), 16);
+}
+
+/*
+ * SharedPlanCacheShmemSize --- report amount of shared memory space needed
+ */
+Size
+SharedPlanCacheShmemSize(void)
+{
+	Size		size;
+	int			max_entries;
+
+	if (shared_plan_cache_size <= 0)
+		return 0;
+
+	max_entries = spc_max_entries();
+	size = MAXALIGN(sizeof(SharedPlanCacheCtl));
+	size = add_size(size, MAXALIGN(mul_size(max_entries,
+											sizeof(SharedPlanFifoItem))));
+	size = add_size(size, mul_size(shared_plan_cache_size, 1024));
+	size = add_size(size, hash_estimate_size(max_entries,
+											 sizeof(SharedPlanEntry)));
+	return size;
+}
+
+/*
+ * SharedPlanCacheShmemInit --- initialize this module's shared memory
+ */
+void
+SharedPlanCacheShmemInit(void)
+{
+	HASHCTL		info;
+	int			max_entries;
+	Size		arena_size;
+	bool		found;
+
+	if (shared_plan_cache_size <= 0)
+		return;
+
+	max_entries = spc_max_entries();
+	arena_size = (Size) shared_plan_cache_size * 1024;
+
+	spc = (SharedPlanCacheCtl *)
+		ShmemInitStruct("Shared Plan Cache",
+						MAXALIGN(sizeof(SharedPlanCacheCtl)) +
+						MAXALIGN(max_entries * sizeof(SharedPlanFifoItem)) +
+						arena_size,
+						&found);
+
+	if (!found)
+	{
+		pg_atomic_init_u32(&spc->generation, 0);
+		spc->next_seq = 1;
+		spc->arena_size = arena_size;
+		spc->head = 0;
+		spc->max_entries = max_entries;
+		spc->fifo_start = 0;
+		spc->fifo_count = 0;
+	}
+
+	MemSet(&info, 0, sizeof(info));
+	info.keysize = sizeof(SharedPlanKey);
+	info.entrysize = sizeof(SharedPlanEntry);
+	spc_hash = ShmemInitHash("Shared Plan Cache Hash",
+							 max_entries, max_entries,
+							 &info,
+							 HASH_ELEM | HASH_BLOBS);
+}
+
+/*
+ * SharedPlanCacheUsable --- may this plan source use the shared cache?
+ *
+ * Only saved, non-oneshot plan sources qualify.  Sessions that have a
+ * temporary namespace are excluded altogether: unqualified names might
+ * resolve to their temporary objects, and namespace OIDs of temporary schemas
+ * get reused by later sessions.  So are transactions that have changed the
+ * catalogs, because the shared entries don't reflect their changes, and
+ * plans made in them mustn't be seen by others.
+ */
+bool
+SharedPlanCacheUsable(CachedPlanSource *plansource)
+{
+	if (spc == NULL)
+		return false;
+	if (!plansource->is_saved || plansource->is_oneshot)
+		return false;
+	if (plansource->search_path == NULL || plansource->query_string == NULL)
+		return false;
+	if (HaveTempNamespace())
+		return false;
+	if (InvalidationMessagesPending())
+		return false;
+	return true;
+}
+
+/*
+ * SharedPlanCacheGeneration --- report the current invalidation generation
+ *
+ * Callers planning a query that they intend to store with
+ * SharedPlanCacheStore must fetch this before invoking the planner.  Pending
+ * invalidations are processed after reading the counter, so the plan
+ * reflects every invalidation that advanced it before.  Any later one
+ * changes it, and keeps the plan from being stored.
+ */
+uint32
+SharedPlanCacheGeneration(void)
+{
+	uint32		generation;
+
+	if (spc == NULL)
+		return 0;
+	generation = pg_atomic_read_u32(&spc->generation);
+	pg_memory_barrier();
+	AcceptInvalidationMessages();
+	return generation;
+}
+
+/*
+ * Compute the hash key identifying plansource's query in the shared cache.
+ *
+ * Besides the database, role and query text, the key covers everything else
+ * that influences parse analysis and planning of the query: the search_path,
+ * the parameter types, the cursor options, the row_security setting and the
+ * settings listed in spc_env_settings.  Those are serialized into *env,
+ * which is stored along with each entry and compared on lookup together with
+ * the query text, so hash collisions can never cause a wrong plan to be
+ * returned.
+ *
+ * Returns false if the plan source cannot be shared.
+ */
+static bool
+spc_make_key(CachedPlanSource *plansource, SharedPlanKey *key,
+			 StringInfo env)
+{
+	ListCell   *lc;
+	uint32		flags;
+	int			nschemas;
+	int			i;
+
+	if (!SharedPlanCacheUsable(plansource))
+		return false;
+
+	memset(key, 0, sizeof(SharedPlanKey));
+	key->dbid = MyDatabaseId;
+	key->userid = GetUserId();
+	key->query_hash = DatumGetUInt32(hash_any((const unsigned char *) plansource->query_string,
+											  strlen(plansource->query_string)));
+
+	initStringInfo(env);
+	flags = (plansource->search_path->addCatalog ? 1 : 0) |
+		(plansource->search_path->addTemp ? 2 : 0) |
+		(row_security ? 4 : 0);
+	appendBinaryStringInfo(env, (char *) &flags, sizeof(flags));
+	appendBinaryStringInfo(env, (char *) &plansource->cursor_options,
+						   sizeof(int));
+	appendBinaryStringInfo(env, (char *) &plansource->num_params,
+						   sizeof(int));
+	if (plansource->num_params > 0)
+		appendBinaryStringInfo(env, (char *) plansource->param_types,
+							   plansource->num_params * sizeof(Oid));
+	nschemas = list_length(plansource->search_path->schemas);
+	appendBinaryStringInfo(env, (char *) &nschemas, sizeof(int));
+	foreach(lc, plansource->search_path->schemas)
+	{
+		Oid			nspid = lfirst_oid(lc);
+
+		appendBinaryStringInfo(env, (char *) &nspid, sizeof(Oid));
+	}
+	for (i = 0; i < lengthof(spc_env_settings); i++)
+	{
+		const char *value = GetConfigOption(spc_env_settings[i],
+											false, false);
+
+		appendBinaryStringInfo(env, value, strlen(value) + 1);
+	}
+	key->env_hash = DatumGetUInt32(hash_any((const unsigned char *) env->data,
+											env->len));
+
+	return true;
+}
+
+/*
+ * Look up the entry for plansource.  Caller must hold SharedPlanCacheLock.
+ *
+ * Returns NULL if there is no entry, or if the entry with the same key was
+ * made for a different query text or planning environment.
+ */
+static SharedPlanEntry *
+spc_lookup(CachedPlanSource *plansource, SharedPlanKey *key, StringInfo env)
+{
+	SharedPlanEntry *entry;
+	int			query_len = strlen(plansource->query_string);
+	char	   *data;
+
+	entry = (SharedPlanEntry *) hash_search(spc_hash, key, HASH_FIND, NULL);
+	if (entry == NULL)
+		return NULL;
+	data = SpcArena(spc) + entry->offset;
+	if (entry->env_len != env->len ||
+		memcmp(data, env->data, env->len) != 0)
+		return NULL;
+	if (entry->query_len != query_len ||
+		memcmp(data + env->len, plansource->query_string, query_len) != 0)
+		return NULL;
+	return entry;
+}
+
+/*
+ * SharedPlanCacheFetchPlan --- get a copy of the shared generic plan
+ *
+ * Returns the statement list of the stored plan, built in the current
+ * memory context, or NIL if there is none.  The caller is responsible for
+ * acquiring executor locks and verifying that the plan is still valid
+ * afterwards, as with any cached plan.
+ */
+List *
+SharedPlanCacheFetchPlan(CachedPlanSource *plansource)
+{
+	SharedPlanKey key;
+	StringInfoData env;
+	SharedPlanEntry *entry;
+	char	   *planstr = NULL;
+	List	   *result;
+
+	if (!spc_make_key(plansource, &key, &env))
+		return NIL;
+
+	LWLockAcquire(SharedPlanCacheLock, LW_SHARED);
+	entry = spc_lookup(plansource, &key, &env);
+	if (entry != NULL)
+	{
+		Size		skip = entry->env_len + entry->query_len;
+
+		planstr = palloc(entry->len - skip);
+		memcpy(planstr, SpcArena(spc) + entry->offset + skip,
+			   entry->len - skip);
+	}
+	LWLockRelease(SharedPlanCacheLock);
+
+	pfree(env.data);
+
+	if (planstr == NULL)
+		return NIL;
+
+	result = (List *) stringToNode(planstr);
+	pfree(planstr);
+
+	return result;
+}
+
+/*
+ * SharedPlanCacheFetchCosts --- get plan-choice statistics from the cache
+ *
+ * On success, fills *total_custom_cost and *num_custom_plans with the
+ * custom plan costs that the backend storing the shared generic plan had
+ * observed, and returns true.
+ */
+bool
+SharedPlanCacheFetchCosts(CachedPlanSource *plansource,
+						  double *total_custom_cost,
+						  int *num_custom_plans)
+{
+	SharedPlanKey key;
+	StringInfoData env;
+	SharedPlanEntry *entry;
+	bool		result = false;
+
+	if (!spc_make_key(plansource, &key, &env))
+		return false;
+
+	LWLockAcquire(SharedPlanCacheLock, LW_SHARED);
+	entry = spc_lookup(plansource, &key, &env);
+	if (entry != NULL && entry->num_custom_plans > 0)
+	{
+		*total_custom_cost = entry->total_custom_cost;
+		*num_custom_plans = entry->num_custom_plans;
+		result = true;
+	}
+	LWLockRelease(SharedPlanCacheLock);
+
+	pfree(env.data);
+
+	return result;
+}
+
+/*
+ * SharedPlanCacheStore --- offer a freshly built generic plan to the cache
+ *
+ * generation must be the value SharedPlanCacheGeneration returned before
+ * planning; if any invalidation has happened since then, the plan might be
+ * stale and is not stored.  Plans that are unsuitable for sharing are
+ * silently ignored.  Everything allocated here is freed before returning,
+ * since the caller's memory context may be long-lived.
+ */
+void
+SharedPlanCacheStore(CachedPlanSource *plansource, List *stmt_list,
+					 uint32 generation)
+{
+	SharedPlanKey key;
+	StringInfoData env;
+	SharedPlanEntry *entry;
+	List	   *rels = NIL;
+	List	   *funcs = NIL;
+	ListCell   *lc;
+	char	   *planstr = NULL;
+	Size		planlen;
+	int			query_len;
+	Size		len;
+	Size		offset;
+	SharedPlanFifoItem *item;
+	bool		found;
+
+	if (!spc_make_key(plansource, &key, &env))
+		return;
+
+	/* Collect dependencies, and check the plans are shareable at all */
+	rels = list_copy(plansource->relationOids);
+	funcs = list_copy(plansource->invalItems);
+	foreach(lc, stmt_list)
+	{
+		PlannedStmt *plannedstmt = (PlannedStmt *) lfirst(lc);
+		ListCell   *lc2;
+
+		if (!IsA(plannedstmt, PlannedStmt) ||
+			plannedstmt->commandType == CMD_UTILITY ||
+			plannedstmt->utilityStmt != NULL ||
+			plannedstmt->transientPlan ||
+			plannedstmt->hasForeignJoin)
+			goto done;
+
+		foreach(lc2, plannedstmt->relationOids)
+			rels = list_append_unique_oid(rels, lfirst_oid(lc2));
+		funcs = list_concat(funcs, list_copy(plannedstmt->invalItems));
+	}
+	if (list_length(rels) > SPC_MAX_RELS || list_length(funcs) > SPC_MAX_FUNCS)
+		goto done;
+
+	planstr = nodeToString(stmt_list);
+
+	/*
+	 * Reading back custom scans and extensible nodes requires the providing
+	 * module to be loaded, which need not be the case in other backends.
+	 */
+	if (strstr(planstr, "{CUSTOMSCAN ") != NULL ||
+		strstr(planstr, "{EXTENSIBLENODE ") != NULL)
+		goto done;
+
+	planlen = strlen(planstr) + 1;
+	query_len = strlen(plansource->query_string);
+	len = MAXALIGN(env.len + query_len + planlen);
+
+	/* Don't let a single huge plan wipe out a large part of the cache */
+	if (len > spc->arena_size / 4)
+		goto done;
+
+	/*
+	 * Check under the lock whether anything has been invalidated since the
+	 * caller started planning.  Invalidations sent later will find and remove
+	 * our entry, as the counter is advanced before the entries are removed.
+	 */
+	LWLockAcquire(SharedPlanCacheLock, LW_EXCLUSIVE);
+
+	if (pg_atomic_read_u32(&spc->generation) != generation)
+	{
+		LWLockRelease(SharedPlanCacheLock);
+		goto done;
+	}
+
+	/* Get rid of any previous entry with the same key */
+	entry = (SharedPlanEntry *) hash_search(spc_hash, &key, HASH_FIND, NULL);
+	if (entry != NULL)
+		spc_remove(entry);
+
+	/* Make room in the FIFO, then in the arena */
+	if (spc->fifo_count >= spc->max_entries)
+	{
+		entry = spc_fifo_front();
+		if (entry != NULL)
+			spc_remove(entry);
+		spc_fifo_pop();
+	}
+	if (!spc_reserve(len, &offset))
+	{
+		LWLockRelease(SharedPlanCacheLock);
+		goto done;
+	}
+
+	entry = (SharedPlanEntry *) hash_search(spc_hash, &key, HASH_ENTER_NULL,
+											&found);
+	if (entry == NULL)
+	{
+		/* out of shared memory for the hash table; just skip it */
+		LWLockRelease(SharedPlanCacheLock);
+		goto done;
+	}
+	Assert(!found);
+
+	entry->seq = spc->next_seq++;
+	entry->offset = offset;
+	entry->len = len;
+	entry->env_len = env.len;
+	entry->query_len = query_len;
+	entry->total_custom_cost = plansource->total_custom_cost;
+	entry->num_custom_plans = plansource->num_custom_plans;
+	entry->nrels = 0;
+	foreach(lc, rels)
+		entry->rels[entry->nrels++] = lfirst_oid(lc);
+	entry->nfuncs = 0;
+	foreach(lc, funcs)
+	{
+		PlanInvalItem *inval = (PlanInvalItem *) lfirst(lc);
+
+		entry->funcs[entry->nfuncs].cacheId = inval->cacheId;
+		entry->funcs[entry->nfuncs].hashValue = inval->hashValue;
+		entry->nfuncs++;
+	}
+
+	memcpy(SpcArena(spc) + offset, env.data, env.len);
+	memcpy(SpcArena(spc) + offset + env.len, plansource->query_string,
+		   query_len);
+	memcpy(SpcArena(spc) + offset + env.len + query_len, planstr, planlen);
+
+	item = &SpcFifo(spc)[(spc->fifo_start + spc->fifo_count) % spc->max_entries];
+	item->key = key;
+	item->seq = entry->seq;
+	spc->fifo_count++;
+
+	LWLockRelease(SharedPlanCacheLock);
+
+done:
+	if (planstr != NULL)
+		pfree(planstr);
+	list_free(rels);
+	list_free(funcs);
+	pfree(env.data);
+}
+
+/*
+ * Return the oldest live entry in the FIFO, discarding slots belonging to
+ * entries that no longer exist.  Caller must hold the lock exclusively.
+ */
+static SharedPlanEntry *
+spc_fifo_front(void)
+{
+	while (spc->fifo_count > 0)
+	{
+		SharedPlanFifoItem *item = &SpcFifo(spc)[spc->fifo_start];
+		SharedPlanEntry *entry;
+
+		entry = (SharedPlanEntry *) hash_search(spc_hash, &item->key,
+												HASH_FIND, NULL);
+		if (entry != NULL && entry->seq == item->seq)
+			return entry;
+		spc_fifo_pop();
+	}
+	return NULL;
+}
+
+static void
+spc_fifo_pop(void)
+{
+	Assert(spc->fifo_count > 0);
+	spc->fifo_start = (spc->fifo_start + 1) % spc->max_entries;
+	spc->fifo_count--;
+}
+
+/*
+ * Reserve len bytes at the head of the arena, evicting whatever entries
+ * occupy that space.  Caller must hold the lock exclusively.
+ *
+ * Live entries are laid out in FIFO order starting just after the head, so
+ * the entries in the way are always found at the front of the FIFO.
+ */
+static bool
+spc_reserve(Size len, Size *offset)
+{
+	SharedPlanEntry *entry;
+
+	if (len > spc->arena_size)
+		return false;
+
+	if (spc->head + len > spc->arena_size)
+	{
+		/*
+		 * Wrap around.  Entries stored beyond the old head are the oldest
+		 * ones; retire them now, since the space they leave behind at the
+		 * end of the arena isn't going to be reused on this lap.
+		 */
+		while ((entry = spc_fifo_front()) != NULL &&
+			   entry->offset >= spc->head)
+		{
+			spc_remove(entry);
+			spc_fifo_pop();
+		}
+		spc->head = 0;
+	}
+
+	while ((entry = spc_fifo_front()) != NULL &&
+		   entry->offset < spc->head + len &&
+		   entry->offset + entry->len > spc->head)
+	{
+		spc_remove(entry);
+		spc_fifo_pop();
+	}
+
+	*offset = spc->head;
+	spc->head += len;
+	return true;
+}
+
+/*
+ * Remove an entry from the hash table.  Its FIFO slot is left behind and
+ * will be skipped later.  Caller must hold the lock exclusively.
+ */
+static void
+spc_remove(SharedPlanEntry *entry)
+{
+	SharedPlanKey key = entry->key;
+
+	hash_search(spc_hash, &key, HASH_REMOVE, NULL);
+}
+
+/*
+ * Remove all entries.  Caller must hold the lock exclusively.
+ */
+static void
+spc_remove_all(void)
+{
+	HASH_SEQ_STATUS status;
+	SharedPlanEntry *entry;
+
+	hash_seq_init(&status, spc_hash);
+	while ((entry = (SharedPlanEntry *) hash_seq_search(&status)) != NULL)
+		spc_remove(entry);
+	spc->head = 0;
+	spc->fifo_start = 0;
+	spc->fifo_count = 0;
+}
+
+/* qsort/bsearch comparator for OIDs */
+static int
+spc_oid_cmp(const void *a, const void *b)
+{
+	Oid			oa = *(const Oid *) a;
+	Oid			ob = *(const Oid *) b;
+
+	if (oa < ob)
+		return -1;
+	if (oa > ob)
+		return 1;
+	return 0;
+}
+
+/*
+ * Does the entry depend on one of the given relations, which must be sorted,
+ * or syscache objects?  A hashValue of 0 in funcs[] means all objects of the
+ * cache.
+ */
+static bool
+spc_entry_is_invalidated(SharedPlanEntry *entry,
+						 const Oid *relids, int nrelids,
+						 const SharedPlanFuncDep *funcs, int nfuncs)
+{
+	int			i;
+	int			j;
+
+	for (i = 0; i < entry->nrels; i++)
+	{
+		if (bsearch(&entry->rels[i], relids, nrelids, sizeof(Oid),
+					spc_oid_cmp) != NULL)
+			return true;
+	}
+	for (i = 0; i < entry->nfuncs; i++)
+	{
+		for (j = 0; j < nfuncs; j++)
+		{
+			if (entry->funcs[i].cacheId == funcs[j].cacheId &&
+				(funcs[j].hashValue == 0 ||
+				 entry->funcs[i].hashValue == funcs[j].hashValue))
+				return true;
+		}
+	}
+	return false;
+}
+
+/*
+ * Classify an invalidation message by its effect on the shared cache.  The
+ * messages that matter are those plancache.c's callbacks react to: relcache
+ * invalidations, and syscache invalidations of functions, and of namespaces,
+ * operators and operator families, which affect everything.  Resets of a
+ * whole catalog are rare enough to just affect everything, too.
+ */
+static SpcMessageKind
+spc_message_kind(const SharedInvalidationMessage *msg)
+{
+	if (msg->id >= 0)
+	{
+		switch (msg->cc.id)
+		{
+			case PROCOID:
+				return SPC_MSG_FUNC;
+			case NAMESPACEOID:
+			case OPEROID:
+			case AMOPOPID:
+				return SPC_MSG_RESET;
+			default:
+				return SPC_MSG_IGNORE;
+		}
+	}
+	if (msg->id == SHAREDINVALRELCACHE_ID)
+		return OidIsValid(msg->rc.relId) ? SPC_MSG_REL : SPC_MSG_RESET;
+	if (msg->id == SHAREDINVALCATALOG_ID)
+		return SPC_MSG_RESET;
+	return SPC_MSG_IGNORE;
+}
+
+/*
+ * SharedPlanCacheInvalidateMessages --- remove entries made obsolete by
+ * invalidation messages
+ *
+ * This is called by whoever sends invalidation messages to the shared queue,
+ * right after queuing them, so each invalidation is applied once, by its
+ * source.
+ */
+void
+SharedPlanCacheInvalidateMessages(const SharedInvalidationMessage *msgs,
+								  int n)
+{
+	Oid		   *relids;
+	int			nrelids = 0;
+	SharedPlanFuncDep *funcs;
+	int			nfuncs = 0;
+	bool		reset = false;
+	HASH_SEQ_STATUS status;
+	SharedPlanEntry *entry;
+	int			i;
+
+	if (spc == NULL)
+		return;
+
+	/*
+	 * Most messages, such as smgr invalidations, are of no interest, so
+	 * check before allocating anything.
+	 */
+	for (i = 0; i < n; i++)
+	{
+		if (spc_message_kind(&msgs[i]) != SPC_MSG_IGNORE)
+			break;
+	}
+	if (i >= n)
+		return;
+
+	relids = (Oid *) palloc(n * sizeof(Oid));
+	funcs = (SharedPlanFuncDep *) palloc(n * sizeof(SharedPlanFuncDep));
+
+	for (; i < n && !reset; i++)
+	{
+		const SharedInvalidationMessage *msg = &msgs[i];
+
+		switch (spc_message_kind(msg))
+		{
+			case SPC_MSG_IGNORE:
+				break;
+			case SPC_MSG_REL:
+				relids[nrelids++] = msg->rc.relId;
+				break;
+			case SPC_MSG_FUNC:
+				funcs[nfuncs].cacheId = msg->cc.id;
+				funcs[nfuncs].hashValue = msg->cc.hashValue;
+				nfuncs++;
+				break;
+			case SPC_MSG_RESET:
+				reset = true;
+				break;
+		}
+	}
+
+	pg_atomic_fetch_add_u32(&spc->generation, 1);
+
+	qsort(relids, nrelids, sizeof(Oid), spc_oid_cmp);
+
+	LWLockAcquire(SharedPlanCacheLock, LW_EXCLUSIVE);
+	if (reset)
+		spc_remove_all();
+	else
+	{
+		hash_seq_init(&status, spc_hash);
+		while ((entry = (SharedPlanEntry *) hash_seq_search(&status)) != NULL)
+		{
+			if (spc_entry_is_invalidated(entry, relids, nrelids,
+										 funcs, nfuncs))
+				spc_remove(entry);
+		}
+	}
+	LWLockRelease(SharedPlanCacheLock);
+
+	pfree(relids);
+	pfree(funcs);
+}
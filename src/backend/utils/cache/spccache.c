@@ -210,3 +210,18 @@ get_tablespace_io_concurrency(Oid spcid)
 	else
 		return spc->opts->effective_io_concurrency;
 }
+
+/*
+ * get_tablespace_page_compression
+ *		Should relation files created in the given tablespace be compressed?
+ */
+bool
+get_tablespace_page_compression(Oid spcid)
+{
+	TableSpaceCacheEntry *spc = get_tablespace(spcid);
+
+	if (!spc->opts)
+		return false;
+	else
+		return spc->opts->page_compression;
+}
@@ -28,15 +28,19 @@
 
 #include "access/commit_ts.h"
 #include "access/gin.h"
+#include "access/heapam.h"
 #include "access/transam.h"
+#include "access/tuptoaster.h"
 #include "access/twophase.h"
 #include "access/xact.h"
+#include "access/xlogrecord.h"
 #include "catalog/namespace.h"
 #include "commands/async.h"
 #include "commands/prepare.h"
 #include "commands/vacuum.h"
 #include "commands/variable.h"
 #include "commands/trigger.h"
+#include "executor/instrument.h"
 #include "funcapi.h"
 #include "libpq/auth.h"
 #include "libpq/be-fsstubs.h"
@@ -57,6 +61,7 @@
 #include "postmaster/bgwriter.h"
 #include "postmaster/postmaster.h"
 #include "postmaster/syslogger.h"
+#include "postmaster/waitsampler.h"
 #include "postmaster/walwriter.h"
 #include "replication/slot.h"
 #include "replication/syncrep.h"
@@ -73,13 +78,16 @@
 #include "tsearch/ts_cache.h"
 #include "utils/builtins.h"
 #include "utils/bytea.h"
+#include "utils/catcache.h"
 #include "utils/guc_tables.h"
 #include "utils/memutils.h"
 #include "utils/pg_locale.h"
 #include "utils/plancache.h"
 #include "utils/portal.h"
 #include "utils/ps_status.h"
+#include "utils/relcache.h"
 #include "utils/rls.h"
+#include "utils/sharedplancache.h"
 #include "utils/snapmgr.h"
 #include "utils/tzparser.h"
 #include "utils/xml.h"
@@ -199,6 +207,14 @@ static const struct config_enum_entry bytea_output_options[] = {
 	{NULL, 0, false}
 };
 
+static const struct config_enum_entry default_toast_compression_options[] = {
+	{"pglz", TOAST_PGLZ_COMPRESSION_ID, false},
+#ifdef USE_LZ4
+	{"lz4", TOAST_LZ4_COMPRESSION_ID, false},
+#endif
+	{NULL, 0, false}
+};
+
 /*
  * We have different sets for client and server message level options because
  * they sort slightly different (see "log" level)
@@ -298,6 +314,13 @@ static const struct config_enum_entry track_function_options[] = {
 	{NULL, 0, false}
 };
 
+static const struct config_enum_entry timing_clock_source_options[] = {
+	{"auto", INSTR_CLOCK_AUTO, false},
+	{"tsc", INSTR_CLOCK_TSC, false},
+	{"system", INSTR_CLOCK_SYSTEM, false},
+	{NULL, 0, false}
+};
+
 static const struct config_enum_entry xmlbinary_options[] = {
 	{"base64", XMLBINARY_BASE64, false},
 	{"hex", XMLBINARY_HEX, false},
@@ -399,6 +422,7 @@ static const struct config_enum_entry force_parallel_mode_options[] = {
 extern const struct config_enum_entry wal_level_options[];
 extern const struct config_enum_entry archive_mode_options[];
 extern const struct config_enum_entry sync_method_options[];
+extern const struct config_enum_entry wal_compression_options[];
 extern const struct config_enum_entry dynamic_shared_memory_options[];
 
 /*
@@ -1009,16 +1033,6 @@ static struct config_bool ConfigureNamesBool[] =
 		NULL, NULL, NULL
 	},
 
-	{
-		{"wal_compression", PGC_SUSET, WAL_SETTINGS,
-			gettext_noop("Compresses full-page writes written in WAL file."),
-			NULL
-		},
-		&wal_compression,
-		false,
-		NULL, NULL, NULL
-	},
-
 	{
 		{"log_checkpoints", PGC_SIGHUP, LOGGING_WHAT,
 			gettext_noop("Logs each checkpoint."),
@@ -1407,6 +1421,15 @@ static struct config_bool ConfigureNamesBool[] =
 		true,
 		NULL, NULL, NULL
 	},
+	{
+		{"opportunistic_freeze", PGC_USERSET, CLIENT_CONN_STATEMENT,
+			gettext_noop("Freezes rows on a page while pruning it, if all of them are visible to everyone."),
+			NULL
+		},
+		&opportunistic_freeze,
+		true,
+		NULL, NULL, NULL
+	},
 	{
 		{"array_nulls", PGC_USERSET, COMPAT_OPTIONS_PREVIOUS,
 			gettext_noop("Enable input of NULL elements in arrays."),
@@ -1928,6 +1951,39 @@ static struct config_int ConfigureNamesInt[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"shared_plan_cache_size", PGC_POSTMASTER, RESOURCES_MEM,
+			gettext_noop("Sets the amount of shared memory used to share generic plans between sessions."),
+			gettext_noop("Zero disables the shared plan cache."),
+			GUC_UNIT_KB
+		},
+		&shared_plan_cache_size,
+		0, 0, MAX_KILOBYTES,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"catalog_cache_memory_limit", PGC_USERSET, RESOURCES_MEM,
+			gettext_noop("Sets the maximum memory to be used by the catalog caches of each session."),
+			gettext_noop("Unreferenced entries are evicted in least-recently-used order when the limit is exceeded. Zero means no limit."),
+			GUC_UNIT_KB
+		},
+		&catalog_cache_memory_limit,
+		0, 0, MAX_KILOBYTES,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"relation_cache_memory_limit", PGC_USERSET, RESOURCES_MEM,
+			gettext_noop("Sets the maximum memory to be used by the relation cache of each session."),
+			gettext_noop("Unreferenced entries are evicted in least-recently-used order when the limit is exceeded. Zero means no limit."),
+			GUC_UNIT_KB
+		},
+		&relation_cache_memory_limit,
+		0, 0, MAX_KILOBYTES,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"replacement_sort_tuples", PGC_USERSET, RESOURCES_MEM,
 			gettext_noop("Sets the maximum number of tuples to be sorted using replacement selection."),
@@ -2374,6 +2430,17 @@ static struct config_int ConfigureNamesInt[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"wal_compression_data_threshold", PGC_SUSET, WAL_SETTINGS,
+			gettext_noop("Sets the minimum amount of data other than full-page writes "
+						 "in a WAL record to compress."),
+			gettext_noop("-1 disables compressing such data.")
+		},
+		&wal_compression_data_threshold,
+		-1, -1, XLR_MAX_COMPRESSED_DATA,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"extra_float_digits", PGC_USERSET, CLIENT_CONN_LOCALE,
 			gettext_noop("Sets the number of digits displayed for floating-point values."),
@@ -2615,6 +2682,15 @@ static struct config_int ConfigureNamesInt[] =
 		50, 0, INT_MAX,
 		NULL, NULL, NULL
 	},
+	{
+		{"autovacuum_vacuum_insert_threshold", PGC_SIGHUP, AUTOVACUUM,
+			gettext_noop("Minimum number of tuple inserts prior to vacuum, or -1 to disable insert vacuums."),
+			NULL
+		},
+		&autovacuum_vac_ins_thresh,
+		1000, -1, INT_MAX,
+		NULL, NULL, NULL
+	},
 	{
 		{"autovacuum_analyze_threshold", PGC_SIGHUP, AUTOVACUUM,
 			gettext_noop("Minimum number of tuple inserts, updates, or deletes prior to analyze."),
@@ -2666,6 +2742,27 @@ static struct config_int ConfigureNamesInt[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"max_parallel_vacuum_workers", PGC_USERSET, RESOURCES_ASYNCHRONOUS,
+			gettext_noop("Sets the maximum number of parallel processes used to vacuum the indexes of a table."),
+			NULL
+		},
+		&max_parallel_vacuum_workers,
+		2, 0, MAX_BACKENDS,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"min_parallel_vacuum_index_size", PGC_USERSET, RESOURCES_ASYNCHRONOUS,
+			gettext_noop("Sets the minimum size of indexes worth a parallel vacuum worker."),
+			NULL,
+			GUC_UNIT_BLOCKS
+		},
+		&min_parallel_vacuum_index_size,
+		(8 * 1024 * 1024) / BLCKSZ, 0, INT_MAX / 3,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"autovacuum_work_mem", PGC_SIGHUP, RESOURCES_MEM,
 			gettext_noop("Sets the maximum memory to be used by each autovacuum worker process."),
@@ -2744,6 +2841,16 @@ static struct config_int ConfigureNamesInt[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"relcache_preload_threshold", PGC_POSTMASTER, CLIENT_CONN_OTHER,
+			gettext_noop("Sets how many times a session must open a relation before saving it in the relation cache initialization file."),
+			gettext_noop("Zero disables saving non-catalog relations in that file.")
+		},
+		&relcache_preload_threshold,
+		0, 0, INT_MAX,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"effective_cache_size", PGC_USERSET, QUERY_TUNING_COST,
 			gettext_noop("Sets the planner's assumption about the size of the disk cache."),
@@ -2795,6 +2902,37 @@ static struct config_int ConfigureNamesInt[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"track_counts_max_relations", PGC_POSTMASTER, STATS_COLLECTOR,
+			gettext_noop("Sets the maximum number of tables and indexes whose statistics are tracked."),
+			NULL
+		},
+		&pgstat_track_counts_max_relations,
+		100000, 100, INT_MAX / 2,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"wait_sampling_history_size", PGC_POSTMASTER, STATS_COLLECTOR,
+			gettext_noop("Sets the number of wait event samples kept in shared memory."),
+			gettext_noop("Zero disables the wait sampler.")
+		},
+		&wait_sampling_history_size,
+		0, 0, 32 * 1024 * 1024,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"wait_sampling_interval", PGC_SIGHUP, STATS_COLLECTOR,
+			gettext_noop("Sets the time between wait event samples."),
+			NULL,
+			GUC_UNIT_MS
+		},
+		&wait_sampling_interval,
+		10, 1, 60000,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"gin_pending_list_limit", PGC_USERSET, CLIENT_CONN_STATEMENT,
 			gettext_noop("Sets the maximum size of the pending list for GIN index."),
@@ -2938,6 +3076,15 @@ static struct config_real ConfigureNamesReal[] =
 		check_random_seed, assign_random_seed, show_random_seed
 	},
 
+	{
+		{"vacuum_skip_index_fraction", PGC_USERSET, AUTOVACUUM,
+			gettext_noop("Fraction of dead tuples below which VACUUM leaves them for later rather than vacuum the indexes."),
+			NULL
+		},
+		&vacuum_skip_index_fraction,
+		0.0, 0.0, 1.0,
+		NULL, NULL, NULL
+	},
 	{
 		{"autovacuum_vacuum_scale_factor", PGC_SIGHUP, AUTOVACUUM,
 			gettext_noop("Number of tuple updates or deletes prior to vacuum as a fraction of reltuples."),
@@ -2947,6 +3094,15 @@ static struct config_real ConfigureNamesReal[] =
 		0.2, 0.0, 100.0,
 		NULL, NULL, NULL
 	},
+	{
+		{"autovacuum_vacuum_insert_scale_factor", PGC_SIGHUP, AUTOVACUUM,
+			gettext_noop("Number of tuple inserts prior to vacuum as a fraction of reltuples."),
+			NULL
+		},
+		&autovacuum_vac_ins_scale,
+		0.2, 0.0, 100.0,
+		NULL, NULL, NULL
+	},
 	{
 		{"autovacuum_analyze_scale_factor", PGC_SIGHUP, AUTOVACUUM,
 			gettext_noop("Number of tuple inserts, updates, or deletes prior to analyze as a fraction of reltuples."),
@@ -3578,6 +3734,16 @@ static struct config_enum ConfigureNamesEnum[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"default_toast_compression", PGC_USERSET, CLIENT_CONN_STATEMENT,
+			gettext_noop("Sets the default compression method for compressible values."),
+			NULL
+		},
+		&default_toast_compression,
+		TOAST_PGLZ_COMPRESSION_ID, default_toast_compression_options,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"client_min_messages", PGC_USERSET, LOGGING_WHEN,
 			gettext_noop("Sets the message levels that are sent to the client."),
@@ -3734,6 +3900,16 @@ static struct config_enum ConfigureNamesEnum[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"timing_clock_source", PGC_POSTMASTER, STATS_COLLECTOR,
+			gettext_noop("Selects the clock used for timing plan nodes and I/O."),
+			NULL
+		},
+		&timing_clock_source,
+		INSTR_CLOCK_AUTO, timing_clock_source_options,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"wal_level", PGC_POSTMASTER, WAL_SETTINGS,
 			gettext_noop("Set the level of information written to the WAL."),
@@ -3764,6 +3940,16 @@ static struct config_enum ConfigureNamesEnum[] =
 		NULL, assign_xlog_sync_method, NULL
 	},
 
+	{
+		{"wal_compression", PGC_SUSET, WAL_SETTINGS,
+			gettext_noop("Compresses full-page writes written in WAL file with the specified method."),
+			NULL
+		},
+		&wal_compression,
+		WAL_COMPRESSION_NONE, wal_compression_options,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"xmlbinary", PGC_USERSET, CLIENT_CONN_STATEMENT,
 			gettext_noop("Sets how binary values are to be encoded in XML."),
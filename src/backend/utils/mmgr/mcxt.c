@@ -474,6 +474,33 @@ MemoryContextIsEmpty(MemoryContext context)
 	return (*context->methods->is_empty) (context);
 }
 
+/*
+ * MemoryContextMemAllocated
+ *		Return the total space obtained from malloc by a context, and by its
+ *		descendants too if recurse is true.
+ */
+Size
+MemoryContextMemAllocated(MemoryContext context, bool recurse)
+{
+	MemoryContextCounters totals;
+	MemoryContext child;
+	Size		total;
+
+	AssertArg(MemoryContextIsValid(context));
+
+	memset(&totals, 0, sizeof(totals));
+	(*context->methods->stats) (context, 0, false, &totals);
+	total = totals.totalspace;
+
+	if (recurse)
+	{
+		for (child = context->firstchild; child != NULL; child = child->nextchild)
+			total += MemoryContextMemAllocated(child, true);
+	}
+
+	return total;
+}
+
 /*
  * MemoryContextStats
  *		Print statistics about the named context and all its descendants.
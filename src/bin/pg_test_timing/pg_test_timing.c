@@ -14,7 +14,7 @@ static const char *progname;
 static int32 test_duration = 3;
 
 static void handle_args(int argc, char *argv[]);
-static uint64 test_timing(int32);
+static uint64 test_timing(int32, bool);
 static void output(uint64 loop_count);
 
 /* record duration in powers of 2 microseconds */
@@ -29,10 +29,27 @@ main(int argc, char *argv[])
 
 	handle_args(argc, argv);
 
-	loop_count = test_timing(test_duration);
+	loop_count = test_timing(test_duration, false);
 
 	output(loop_count);
 
+	/*
+	 * Also test the clock source that EXPLAIN ANALYZE uses with the default
+	 * setting of timing_clock_source, if it's not the same.
+	 */
+	if (pg_instr_clock_init(INSTR_CLOCK_AUTO))
+	{
+		printf("\nTesting TSC timing overhead (TSC at %.0f MHz) for %d seconds.\n",
+			   pg_instr_tsc_frequency(), test_duration);
+		memset(histogram, 0, sizeof(histogram));
+
+		loop_count = test_timing(test_duration, true);
+
+		output(loop_count);
+	}
+	else
+		printf("\nThe TSC is not usable as clock source on this system.\n");
+
 	return 0;
 }
 
@@ -104,7 +121,7 @@ handle_args(int argc, char *argv[])
 }
 
 static uint64
-test_timing(int32 duration)
+test_timing(int32 duration, bool fast)
 {
 	uint64		total_time;
 	int64		time_elapsed = 0;
@@ -117,7 +134,10 @@ test_timing(int32 duration)
 
 	total_time = duration > 0 ? duration * INT64CONST(1000000) : 0;
 
-	INSTR_TIME_SET_CURRENT(start_time);
+	if (fast)
+		INSTR_TIME_SET_CURRENT_FAST(start_time);
+	else
+		INSTR_TIME_SET_CURRENT(start_time);
 	cur = INSTR_TIME_GET_MICROSEC(start_time);
 
 	while (time_elapsed < total_time)
@@ -126,7 +146,10 @@ test_timing(int32 duration)
 					bits = 0;
 
 		prev = cur;
-		INSTR_TIME_SET_CURRENT(temp);
+		if (fast)
+			INSTR_TIME_SET_CURRENT_FAST(temp);
+		else
+			INSTR_TIME_SET_CURRENT(temp);
 		cur = INSTR_TIME_GET_MICROSEC(temp);
 		diff = cur - prev;
 
@@ -153,7 +176,10 @@ test_timing(int32 duration)
 		time_elapsed = INSTR_TIME_GET_MICROSEC(temp);
 	}
 
-	INSTR_TIME_SET_CURRENT(end_time);
+	if (fast)
+		INSTR_TIME_SET_CURRENT_FAST(end_time);
+	else
+		INSTR_TIME_SET_CURRENT(end_time);
 
 	INSTR_TIME_SUBTRACT(end_time, start_time);
 
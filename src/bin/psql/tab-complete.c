@@ -1729,7 +1729,7 @@ psql_completion(const char *text, int start, int end)
 	/* ALTER TABLE ALTER [COLUMN] <foo> SET ( */
 	else if (Matches8("ALTER", "TABLE", MatchAny, "ALTER", "COLUMN", MatchAny, "SET", "(") ||
 		 Matches7("ALTER", "TABLE", MatchAny, "ALTER", MatchAny, "SET", "("))
-		COMPLETE_WITH_LIST2("n_distinct", "n_distinct_inherited");
+		COMPLETE_WITH_LIST3("compression", "n_distinct", "n_distinct_inherited");
 	/* ALTER TABLE ALTER [COLUMN] <foo> SET STORAGE */
 	else if (Matches8("ALTER", "TABLE", MatchAny, "ALTER", "COLUMN", MatchAny, "SET", "STORAGE") ||
 	Matches7("ALTER", "TABLE", MatchAny, "ALTER", MatchAny, "SET", "STORAGE"))
@@ -1781,6 +1781,8 @@ psql_completion(const char *text, int start, int end)
 			"autovacuum_multixact_freeze_table_age",
 			"autovacuum_vacuum_cost_delay",
 			"autovacuum_vacuum_cost_limit",
+			"autovacuum_vacuum_insert_scale_factor",
+			"autovacuum_vacuum_insert_threshold",
 			"autovacuum_vacuum_scale_factor",
 			"autovacuum_vacuum_threshold",
 			"fillfactor",
@@ -1795,6 +1797,8 @@ psql_completion(const char *text, int start, int end)
 			"toast.autovacuum_multixact_freeze_table_age",
 			"toast.autovacuum_vacuum_cost_delay",
 			"toast.autovacuum_vacuum_cost_limit",
+			"toast.autovacuum_vacuum_insert_scale_factor",
+			"toast.autovacuum_vacuum_insert_threshold",
 			"toast.autovacuum_vacuum_scale_factor",
 			"toast.autovacuum_vacuum_threshold",
 			"toast.log_autovacuum_min_duration",
@@ -1824,8 +1828,8 @@ psql_completion(const char *text, int start, int end)
 		COMPLETE_WITH_CONST("(");
 	/* ALTER TABLESPACE <foo> SET|RESET ( */
 	else if (Matches5("ALTER", "TABLESPACE", MatchAny, "SET|RESET", "("))
-		COMPLETE_WITH_LIST3("seq_page_cost", "random_page_cost",
-							"effective_io_concurrency");
+		COMPLETE_WITH_LIST4("seq_page_cost", "random_page_cost",
+							"effective_io_concurrency", "page_compression");
 
 	/* ALTER TEXT SEARCH */
 	else if (Matches3("ALTER", "TEXT", "SEARCH"))
@@ -29,7 +29,7 @@
  *
  *			int32
  *			pglz_decompress(const char *source, int32 slen, char *dest,
- *							int32 rawsize)
+ *							int32 rawsize, bool check_complete)
  *
  *				source is the compressed input.
  *
@@ -42,7 +42,11 @@
  *					The data is written to buff exactly as it was handed
  *					to pglz_compress(). No terminating zero byte is added.
  *
- *				rawsize is the length of the uncompressed data.
+ *				rawsize is the length of the uncompressed data.  If
+ *					check_complete is false, rawsize may be less than the
+ *					full length, and source may be just a prefix of the
+ *					compressed data; decompression then stops once rawsize
+ *					bytes have been produced or the input runs out.
  *
  *				The return value is the number of bytes written in the
  *				buffer dest, or -1 if decompression fails.
@@ -676,11 +680,16 @@ pglz_compress(const char *source, int32 slen, char *dest,
  *		Decompresses source into dest. Returns the number of bytes
  *		decompressed in the destination buffer, or -1 if decompression
  *		fails.
+ *
+ *		If check_complete is true, the data is considered corrupted unless
+ *		exactly all of source was consumed and exactly rawsize bytes were
+ *		produced.  If it is false, a prefix of rawsize bytes (or less, if
+ *		source runs out first) is all the caller wants.
  * ----------
  */
 int32
 pglz_decompress(const char *source, int32 slen, char *dest,
-				int32 rawsize)
+				int32 rawsize, bool check_complete)
 {
 	const unsigned char *sp;
 	const unsigned char *srcend;
@@ -726,12 +735,17 @@ pglz_decompress(const char *source, int32 slen, char *dest,
 				 * memory in case of corrupt input.  Note: we must advance dp
 				 * here to ensure the error is detected below the loop.  We
 				 * don't simply put the elog inside the loop since that will
-				 * probably interfere with optimization.
+				 * probably interfere with optimization.  When only a prefix
+				 * was asked for, copy what fits instead.
 				 */
 				if (dp + len > destend)
 				{
-					dp += len;
-					break;
+					if (check_complete)
+					{
+						dp += len;
+						break;
+					}
+					len = destend - dp;
 				}
 
 				/*
@@ -766,13 +780,55 @@ pglz_decompress(const char *source, int32 slen, char *dest,
 	}
 
 	/*
-	 * Check we decompressed the right amount.
+	 * Check we decompressed the right amount.  If we are slicing, then we
+	 * won't necessarily be at the end of the source or dest buffers when we
+	 * hit a stop, so we don't test them.
 	 */
-	if (dp != destend || sp != srcend)
+	if (check_complete && (dp != destend || sp != srcend))
 		return -1;
 
 	/*
 	 * That's it.
 	 */
-	return rawsize;
+	return (char *) dp - dest;
+}
+
+
+/* ----------
+ * pglz_maximum_compressed_size -
+ *
+ *		Calculate the maximum compressed size for a given amount of raw data.
+ *		Return the maximum size, or total compressed size if maximum size is
+ *		larger than total compressed size.
+ *
+ *		Used by the toaster to fetch only as much of a compressed value as is
+ *		needed to decompress a prefix of rawsize bytes.
+ * ----------
+ */
+int32
+pglz_maximum_compressed_size(int32 rawsize, int32 total_compressed_size)
+{
+	int64		compressed_size;
+
+	/*
+	 * pglz uses one control bit per byte, so we need (rawsize * 9) bits. We
+	 * care about bytes though, so we add 7 to make sure we include the last
+	 * incomplete byte (integer division rounds down).
+	 *
+	 * XXX Use int64 to prevent overflow during calculation.
+	 */
+	compressed_size = ((int64) rawsize * 9 + 7) / 8;
+
+	/*
+	 * The last match tag may also describe output beyond rawsize, and its
+	 * tag is up to three bytes long; allow for that.
+	 */
+	compressed_size += 2;
+
+	/*
+	 * Maximum compressed size can't be larger than total compressed size.
+	 */
+	compressed_size = Min(compressed_size, total_compressed_size);
+
+	return (int32) compressed_size;
 }
@@ -142,6 +142,8 @@ typedef struct IndexAmRoutine
 	bool		amclusterable;
 	/* does AM handle predicate locks? */
 	bool		ampredlocks;
+	/* can VACUUM process an index of this type in a parallel worker? */
+	bool		amcanparallelvacuum;
 	/* type of data stored in index, or InvalidOid if variable */
 	Oid			amkeytype;
 
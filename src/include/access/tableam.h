@@ -0,0 +1,281 @@
+/*-------------------------------------------------------------------------
+ *
+ * tableam.h
+ *	  API for Postgres table access methods.
+ *
+ * A table access method provides the storage of ordinary tables.  The
+ * executor and the utility commands reach a table's storage through the
+ * TableAmRoutine in its relcache entry, rd_tableam.  The heap is the
+ * built-in table access method, and the one used when CREATE TABLE doesn't
+ * name another one.
+ *
+ * Tuples are still exchanged as HeapTuples, and TIDs identify them, as the
+ * rest of the system expects: a scan must fill the slot with a tuple whose
+ * t_self the AM's own fetch, update and delete callbacks understand, so that
+ * UPDATE, DELETE and the ctid system column work.  Features that are built
+ * directly on heap pages, namely indexes, row locking, row-level triggers,
+ * TABLESAMPLE, ANALYZE, CLUSTER, VACUUM FULL and commands that rewrite the
+ * table, are only available for tables using the heap; see
+ * RelationUsesHeapAm.
+ *
+ * Copyright (c) 2016, PostgreSQL Global Development Group
+ *
+ * src/include/access/tableam.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef TABLEAM_H
+#define TABLEAM_H
+
+#include "access/heapam.h"
+#include "executor/tuptable.h"
+#include "utils/rel.h"
+
+/* Likewise, this file shouldn't depend on vacuum.h. */
+struct VacuumParams;
+
+/*
+ * Scan descriptors are private to the access method; callers only pass them
+ * back to it.
+ */
+typedef struct TableScanDescData *TableScanDesc;
+typedef struct ParallelTableScanDescData *ParallelTableScanDesc;
+
+
+/*
+ * Callback function signatures --- see tableam.sgml for more info.
+ */
+
+/* prepare for a sequential scan */
+typedef TableScanDesc (*scan_begin_function) (Relation rel,
+														  Snapshot snapshot,
+														  int nkeys,
+														  ScanKey key);
+
+/* restart a sequential scan, with new scan keys if not NULL */
+typedef void (*scan_rescan_function) (TableScanDesc scan,
+												  ScanKey key);
+
+/* store the next visible tuple in slot; return false at end of scan */
+typedef bool (*scan_getnextslot_function) (TableScanDesc scan,
+													   ScanDirection direction,
+													   TupleTableSlot *slot);
+
+/* end a sequential scan */
+typedef void (*scan_end_function) (TableScanDesc scan);
+
+/* size of the shared state of a parallel sequential scan */
+typedef Size (*parallelscan_estimate_function) (Relation rel,
+														 Snapshot snapshot);
+
+/* set up the shared state of a parallel sequential scan */
+typedef void (*parallelscan_initialize_function) (Relation rel,
+											   ParallelTableScanDesc pscan,
+														  Snapshot snapshot);
+
+/* join a parallel sequential scan */
+typedef TableScanDesc (*scan_begin_parallel_function) (Relation rel,
+											  ParallelTableScanDesc pscan);
+
+/* fetch the tuple with the given TID into slot, if visible to snapshot */
+typedef bool (*tuple_fetch_function) (Relation rel,
+												  ItemPointer tid,
+												  Snapshot snapshot,
+												  TupleTableSlot *slot);
+
+/* insert a tuple, setting its t_self; options are HEAP_INSERT_* flags */
+typedef Oid (*tuple_insert_function) (Relation rel,
+												  HeapTuple tup,
+												  CommandId cid,
+												  int options,
+												  BulkInsertState bistate);
+
+/* insert several tuples at once */
+typedef void (*multi_insert_function) (Relation rel,
+												   HeapTuple *tuples,
+												   int ntuples,
+												   CommandId cid,
+												   int options,
+												   BulkInsertState bistate);
+
+/* make the tuples inserted with the given options durable */
+typedef void (*finish_bulk_insert_function) (Relation rel,
+														 int options);
+
+/* delete the tuple with the given TID */
+typedef HTSU_Result (*tuple_delete_function) (Relation rel,
+														  ItemPointer tid,
+														  CommandId cid,
+														Snapshot crosscheck,
+														  bool wait,
+											  HeapUpdateFailureData *hufd);
+
+/* replace the tuple with the given TID by newtup, setting its t_self */
+typedef HTSU_Result (*tuple_update_function) (Relation rel,
+														  ItemPointer otid,
+														  HeapTuple newtup,
+														  CommandId cid,
+														Snapshot crosscheck,
+														  bool wait,
+											   HeapUpdateFailureData *hufd,
+													 LockTupleMode *lockmode);
+
+/* VACUUM (without FULL) the table */
+typedef void (*relation_vacuum_function) (Relation rel,
+													  int options,
+											   struct VacuumParams *params,
+											BufferAccessStrategy bstrategy);
+
+/* estimate the size of the table for the planner */
+typedef void (*relation_estimate_size_function) (Relation rel,
+														 int32 *attr_widths,
+														 BlockNumber *pages,
+														 double *tuples,
+														 double *allvisfrac);
+
+
+/*
+ * API struct for a table AM.  The handler function returns it palloc'd in a
+ * single chunk; GetTableAmRoutine keeps a copy for the life of the backend.
+ */
+typedef struct TableAmRoutine
+{
+	NodeTag		type;
+
+	/* sequential scans */
+	scan_begin_function scan_begin;
+	scan_rescan_function scan_rescan;
+	scan_getnextslot_function scan_getnextslot;
+	scan_end_function scan_end;
+
+	/* parallel sequential scans; all NULL if not supported */
+	parallelscan_estimate_function parallelscan_estimate;
+	parallelscan_initialize_function parallelscan_initialize;
+	scan_begin_parallel_function scan_begin_parallel;
+
+	/* access to individual tuples */
+	tuple_fetch_function tuple_fetch;
+	tuple_insert_function tuple_insert;
+	multi_insert_function multi_insert;
+	finish_bulk_insert_function finish_bulk_insert;		/* can be NULL */
+	tuple_delete_function tuple_delete;
+	tuple_update_function tuple_update;
+
+	/* maintenance and planner support */
+	relation_vacuum_function relation_vacuum;
+	relation_estimate_size_function relation_estimate_size;	/* can be NULL */
+} TableAmRoutine;
+
+
+/* Functions in access/table/tableamapi.c */
+extern const TableAmRoutine *GetTableAmRoutine(Oid amhandler);
+extern const TableAmRoutine *GetTableAmRoutineByAmId(Oid amoid);
+extern const TableAmRoutine *GetHeapamTableAmRoutine(void);
+
+/* Function in access/heap/heapam_handler.c */
+extern Datum heap_tableam_handler(PG_FUNCTION_ARGS);
+
+/*
+ * Does the relation store its tuples in heap pages?  True for tables using
+ * any access method whose handler is the heap's.
+ */
+#define RelationUsesHeapAm(relation) \
+	((relation)->rd_tableam == GetHeapamTableAmRoutine())
+
+
+/* ----------------------------------------------------------------
+ *		Wrappers for the callbacks, for the callers' convenience
+ * ----------------------------------------------------------------
+ */
+
+static inline TableScanDesc
+table_beginscan(Relation rel, Snapshot snapshot, int nkeys, ScanKey key)
+{
+	return rel->rd_tableam->scan_begin(rel, snapshot, nkeys, key);
+}
+
+static inline void
+table_rescan(Relation rel, TableScanDesc scan, ScanKey key)
+{
+	rel->rd_tableam->scan_rescan(scan, key);
+}
+
+static inline bool
+table_getnextslot(Relation rel, TableScanDesc scan, ScanDirection direction,
+				  TupleTableSlot *slot)
+{
+	return rel->rd_tableam->scan_getnextslot(scan, direction, slot);
+}
+
+static inline void
+table_endscan(Relation rel, TableScanDesc scan)
+{
+	rel->rd_tableam->scan_end(scan);
+}
+
+static inline Size
+table_parallelscan_estimate(Relation rel, Snapshot snapshot)
+{
+	return rel->rd_tableam->parallelscan_estimate(rel, snapshot);
+}
+
+static inline void
+table_parallelscan_initialize(Relation rel, ParallelTableScanDesc pscan,
+							  Snapshot snapshot)
+{
+	rel->rd_tableam->parallelscan_initialize(rel, pscan, snapshot);
+}
+
+static inline TableScanDesc
+table_beginscan_parallel(Relation rel, ParallelTableScanDesc pscan)
+{
+	return rel->rd_tableam->scan_begin_parallel(rel, pscan);
+}
+
+static inline bool
+table_fetch_slot(Relation rel, ItemPointer tid, Snapshot snapshot,
+				 TupleTableSlot *slot)
+{
+	return rel->rd_tableam->tuple_fetch(rel, tid, snapshot, slot);
+}
+
+static inline Oid
+table_insert(Relation rel, HeapTuple tup, CommandId cid, int options,
+			 BulkInsertState bistate)
+{
+	return rel->rd_tableam->tuple_insert(rel, tup, cid, options, bistate);
+}
+
+static inline void
+table_multi_insert(Relation rel, HeapTuple *tuples, int ntuples,
+				   CommandId cid, int options, BulkInsertState bistate)
+{
+	rel->rd_tableam->multi_insert(rel, tuples, ntuples, cid, options,
+								  bistate);
+}
+
+static inline void
+table_finish_bulk_insert(Relation rel, int options)
+{
+	if (rel->rd_tableam->finish_bulk_insert)
+		rel->rd_tableam->finish_bulk_insert(rel, options);
+}
+
+static inline HTSU_Result
+table_delete(Relation rel, ItemPointer tid, CommandId cid,
+			 Snapshot crosscheck, bool wait, HeapUpdateFailureData *hufd)
+{
+	return rel->rd_tableam->tuple_delete(rel, tid, cid, crosscheck, wait,
+										 hufd);
+}
+
+static inline HTSU_Result
+table_update(Relation rel, ItemPointer otid, HeapTuple newtup, CommandId cid,
+			 Snapshot crosscheck, bool wait, HeapUpdateFailureData *hufd,
+			 LockTupleMode *lockmode)
+{
+	return rel->rd_tableam->tuple_update(rel, otid, newtup, cid, crosscheck,
+										 wait, hufd, lockmode);
+}
+
+#endif   /* TABLEAM_H */
@@ -95,6 +95,19 @@
 	 sizeof(int32) -									\
 	 VARHDRSZ)
 
+/*
+ * Compression methods of in-line compressed datums, as recorded in their
+ * headers (see VARCOMPRESSMETHOD_4B_C).  These values are stored on disk.
+ */
+typedef enum ToastCompressionId
+{
+	TOAST_PGLZ_COMPRESSION_ID = 0,
+	TOAST_LZ4_COMPRESSION_ID = 1
+} ToastCompressionId;
+
+/* GUC variable */
+extern int	default_toast_compression;
+
 /* Size of an EXTERNAL datum that contains a standard TOAST pointer */
 #define TOAST_POINTER_SIZE (VARHDRSZ_EXTERNAL + sizeof(varatt_external))
 
@@ -174,6 +187,30 @@ extern struct varlena *heap_tuple_untoast_attr_slice(struct varlena * attr,
 							  int32 sliceoffset,
 							  int32 slicelength);
 
+/* ----------
+ * Detoast iterator -
+ *
+ *	Reads a varlena datum from the start, detoasting only as much of it as
+ *	has been asked for so far.  The first done bytes of the raw data, out of
+ *	rawsize, are at data.
+ * ----------
+ */
+typedef struct DetoastIteratorData
+{
+	struct varlena *attr;		/* the value, possibly toasted */
+	struct varlena *compressed; /* attr fetched in full, if compressed */
+	struct varlena *buf;		/* detoasted prefix, or NULL if none */
+	char	   *data;			/* start of the raw data */
+	int32		rawsize;		/* total length of the raw data */
+	int32		done;			/* number of bytes available at data */
+} DetoastIteratorData;
+
+typedef DetoastIteratorData *DetoastIterator;
+
+extern DetoastIterator create_detoast_iterator(struct varlena * attr);
+extern void detoast_iterate(DetoastIterator iter, int32 upto);
+extern void free_detoast_iterator(DetoastIterator iter);
+
 /* ----------
  * toast_flatten_tuple -
  *
@@ -199,7 +236,23 @@ extern Datum toast_flatten_tuple_to_datum(HeapTupleHeader tup,
  *	Create a compressed version of a varlena datum, if possible
  * ----------
  */
-extern Datum toast_compress_datum(Datum value);
+extern Datum toast_compress_datum(Datum value, int cmethod);
+
+/* ----------
+ * toast_get_compression_id -
+ *
+ *	Return the compression method of a varlena datum, or -1
+ * ----------
+ */
+extern int	toast_get_compression_id(struct varlena * attr);
+
+/* ----------
+ * toast_validate_compression_option -
+ *
+ *	Check the value of a column's compression option
+ * ----------
+ */
+extern void toast_validate_compression_option(char *value);
 
 /* ----------
  * toast_raw_datum_size -
@@ -127,6 +127,9 @@ struct XLogReaderState
 	uint32		main_data_len;	/* main data portion's length */
 	uint32		main_data_bufsz;	/* allocated size of the buffer */
 
+	/* buffer for decompressing block data and main data, or NULL */
+	char	   *decompress_buf;
+
 	RepOriginId record_origin;
 
 	/* information about blocks referenced by the record. */
@@ -106,7 +106,8 @@ typedef struct XLogRecordBlockHeader
  * present is BLCKSZ - the length of "hole" bytes.
  *
  * When wal_compression is enabled, a full page image which "hole" was
- * removed is additionally compressed using PGLZ compression algorithm.
+ * removed is additionally compressed using PGLZ or LZ4 compression algorithm
+ * (BKPIMAGE_COMPRESS_LZ4 tells which).
  * This can reduce the WAL volume, but at some extra cost of CPU spent
  * on the compression during WAL logging. In this case, since the "hole"
  * length cannot be calculated by subtracting the number of page image bytes
@@ -137,6 +138,7 @@ typedef struct XLogRecordBlockImageHeader
 /* Information stored in bimg_info */
 #define BKPIMAGE_HAS_HOLE		0x01	/* page image has "hole" */
 #define BKPIMAGE_IS_COMPRESSED		0x02		/* page image is compressed */
+#define BKPIMAGE_COMPRESS_LZ4		0x04		/* ... with LZ4, not PGLZ */
 
 /*
  * Extra header information used when page image has "hole" and
@@ -197,6 +199,33 @@ typedef struct XLogRecordDataHeaderLong
 
 #define SizeOfXLogRecordDataHeaderLong (sizeof(uint8) + sizeof(uint32))
 
+/*
+ * The data of a record other than its full-page images, that is the data
+ * registered with the block references and the main data, can be compressed
+ * as a whole.  An XLogRecordCompressedDataHeader then comes first, before any
+ * other fragment header.  The lengths in the block and main data headers are
+ * still the uncompressed lengths, but after the page images there is only
+ * compressed_length bytes of compressed data, which decompress to the block
+ * data and the main data in the usual order.
+ *
+ * At most XLR_MAX_COMPRESSED_DATA bytes of data are compressed, so that the
+ * buffers for it can be allocated in advance.
+ */
+typedef struct XLogRecordCompressedDataHeader
+{
+	uint8		id;				/* XLR_BLOCK_ID_COMPRESSED */
+	uint8		method;			/* XLR_COMPRESS_PGLZ or XLR_COMPRESS_LZ4 */
+	/* followed by uint32 compressed_length, unaligned */
+}	XLogRecordCompressedDataHeader;
+
+#define SizeOfXLogRecordCompressedDataHeader \
+	(sizeof(uint8) * 2 + sizeof(uint32))
+
+#define XLR_COMPRESS_PGLZ			0
+#define XLR_COMPRESS_LZ4			1
+
+#define XLR_MAX_COMPRESSED_DATA		(2 * BLCKSZ)
+
 /*
  * Block IDs used to distinguish different kinds of record fragments. Block
  * references are numbered from 0 to XLR_MAX_BLOCK_ID. A rmgr is free to use
@@ -213,5 +242,6 @@ typedef struct XLogRecordDataHeaderLong
 #define XLR_BLOCK_ID_DATA_SHORT		255
 #define XLR_BLOCK_ID_DATA_LONG		254
 #define XLR_BLOCK_ID_ORIGIN			253
+#define XLR_BLOCK_ID_COMPRESSED		252
 
 #endif   /* XLOGRECORD_H */
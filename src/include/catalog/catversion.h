@@ -53,6 +53,6 @@
  */
 
 /*							yyyymmddN */
-#define CATALOG_VERSION_NO	201605051
+#define CATALOG_VERSION_NO	201605121
 
 #endif
@@ -124,6 +124,7 @@ extern bool isTempOrTempToastNamespace(Oid namespaceId);
 extern bool isAnyTempNamespace(Oid namespaceId);
 extern bool isOtherTempNamespace(Oid namespaceId);
 extern int	GetTempNamespaceBackendId(Oid namespaceId);
+extern bool HaveTempNamespace(void);
 extern Oid	GetTempToastNamespace(void);
 extern void ResetTempTableNamespace(void);
 
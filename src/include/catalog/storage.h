@@ -22,6 +22,8 @@ extern void RelationCreateStorage(RelFileNode rnode, char relpersistence);
 extern void RelationDropStorage(Relation rel);
 extern void RelationPreserveStorage(RelFileNode rnode, bool atCommit);
 extern void RelationTruncate(Relation rel, BlockNumber nblocks);
+extern bool UsePageCompression(Oid spcNode);
+extern void CheckPageCompressionSettings(void);
 
 /*
  * These functions used to be in storage/smgr/smgr.c, which explains the
@@ -18,6 +18,7 @@
 #include "catalog/pg_statistic.h"
 #include "catalog/pg_type.h"
 #include "nodes/parsenodes.h"
+#include "port/atomics.h"
 #include "storage/buf.h"
 #include "storage/lock.h"
 #include "utils/relcache.h"
@@ -154,6 +155,13 @@ extern int	vacuum_freeze_min_age;
 extern int	vacuum_freeze_table_age;
 extern int	vacuum_multixact_freeze_min_age;
 extern int	vacuum_multixact_freeze_table_age;
+extern int	max_parallel_vacuum_workers;
+extern int	min_parallel_vacuum_index_size;
+extern double vacuum_skip_index_fraction;
+
+/* Cost-based delay state shared by the processes of a parallel vacuum */
+extern pg_atomic_uint32 *VacuumSharedCostBalance;
+extern int	VacuumCostBalanceLocal;
 
 
 /* in commands/vacuum.c */
@@ -368,6 +368,9 @@ extern void ExecCloseIndices(ResultRelInfo *resultRelInfo);
 extern List *ExecInsertIndexTuples(TupleTableSlot *slot, ItemPointer tupleid,
 					  EState *estate, bool noDupErr, bool *specConflict,
 					  List *arbiterIndexes);
+extern void ExecInsertIndexTuplesMulti(TupleTableSlot *slot, HeapTuple *tuples,
+						   int ntuples, EState *estate,
+						   List **recheckIndexes, int *curtuple);
 extern bool ExecCheckIndexConstraints(TupleTableSlot *slot, EState *estate,
 						  ItemPointer conflictTid, List *arbiterIndexes);
 extern void check_exclusion_constraint(Relation heap, Relation index,
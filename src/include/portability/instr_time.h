@@ -20,6 +20,9 @@
  *
  * INSTR_TIME_SET_CURRENT(t)		set t to current time
  *
+ * INSTR_TIME_SET_CURRENT_FAST(t)	set t to current time, using the cheapest
+ *									clock source available (see below)
+ *
  * INSTR_TIME_ADD(x, y)				x += y
  *
  * INSTR_TIME_SUBTRACT(x, y)		x -= y
@@ -40,6 +43,15 @@
  * running sum in instr_time form (ie, use INSTR_TIME_ADD or
  * INSTR_TIME_ACCUM_DIFF) and convert to a result format only at the end.
  *
+ * INSTR_TIME_SET_CURRENT_FAST is meant for code that reads the clock very
+ * often, such as per-node instrumentation of EXPLAIN ANALYZE.  On x86 it
+ * reads the CPU's time-stamp counter (TSC), which is much cheaper than a
+ * system call, once pg_instr_clock_init() has verified that the counter
+ * ticks at a constant rate and measured that rate; otherwise, and on other
+ * platforms, it is the same as INSTR_TIME_SET_CURRENT.  The result is kept
+ * close to what INSTR_TIME_SET_CURRENT would return, but the two can drift
+ * apart, so both ends of an interval should be measured with the same macro.
+ *
  * Beware of multiple evaluations of the macro arguments.
  *
  *
@@ -113,6 +125,59 @@ typedef struct timeval instr_time;
 
 #define INSTR_TIME_GET_MICROSEC(t) \
 	(((uint64) (t).tv_sec * (uint64) 1000000) + (uint64) (t).tv_usec)
+
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+#define HAVE_INSTR_TIME_TSC 1
+#endif
+
+#ifdef HAVE_INSTR_TIME_TSC
+
+/*
+ * Conversion from TSC readings to time of day, set by pg_instr_clock_init().
+ * A TSC reading of base_tsc corresponds to base_usec microseconds since the
+ * epoch.
+ */
+typedef struct InstrTscClock
+{
+	bool		use_tsc;		/* use the TSC at all? */
+	int64		base_tsc;
+	int64		base_usec;
+	double		usec_per_tick;
+} InstrTscClock;
+
+extern InstrTscClock pg_instr_tsc_clock;
+
+static inline int64
+pg_rdtsc(void)
+{
+	uint32		lo,
+				hi;
+
+	__asm__ __volatile__("rdtsc" : "=a"(lo), "=d"(hi));
+	return (int64) (((uint64) hi << 32) | lo);
+}
+
+static inline void
+pg_instr_time_set_current_fast(instr_time *t)
+{
+	if (pg_instr_tsc_clock.use_tsc)
+	{
+		int64		usec;
+
+		usec = pg_instr_tsc_clock.base_usec +
+			(int64) ((double) (pg_rdtsc() - pg_instr_tsc_clock.base_tsc) *
+					 pg_instr_tsc_clock.usec_per_tick);
+		t->tv_sec = usec / 1000000;
+		t->tv_usec = usec % 1000000;
+	}
+	else
+		gettimeofday(t, NULL);
+}
+
+#define INSTR_TIME_SET_CURRENT_FAST(t)	pg_instr_time_set_current_fast(&(t))
+#else
+#define INSTR_TIME_SET_CURRENT_FAST(t)	INSTR_TIME_SET_CURRENT(t)
+#endif   /* HAVE_INSTR_TIME_TSC */
 #else							/* WIN32 */
 
 typedef LARGE_INTEGER instr_time;
@@ -123,6 +188,9 @@ typedef LARGE_INTEGER instr_time;
 
 #define INSTR_TIME_SET_CURRENT(t)	QueryPerformanceCounter(&(t))
 
+/* QueryPerformanceCounter already uses the TSC where that is reliable */
+#define INSTR_TIME_SET_CURRENT_FAST(t)	INSTR_TIME_SET_CURRENT(t)
+
 #define INSTR_TIME_ADD(x,y) \
 	((x).QuadPart += (y).QuadPart)
 
@@ -151,4 +219,19 @@ GetTimerFrequency(void)
 }
 #endif   /* WIN32 */
 
+/*
+ * Clock sources INSTR_TIME_SET_CURRENT_FAST can be asked to use: the TSC if
+ * it looks trustworthy, the TSC whenever it ticks at a constant rate, or
+ * always the same clock as INSTR_TIME_SET_CURRENT.
+ */
+typedef enum InstrClockSource
+{
+	INSTR_CLOCK_AUTO,
+	INSTR_CLOCK_TSC,
+	INSTR_CLOCK_SYSTEM
+} InstrClockSource;
+
+extern bool pg_instr_clock_init(InstrClockSource source);
+extern double pg_instr_tsc_frequency(void);
+
 #endif   /* INSTR_TIME_H */
@@ -0,0 +1,42 @@
+/*-------------------------------------------------------------------------
+ *
+ * waitsampler.h
+ *	  Exports from postmaster/waitsampler.c.
+ *
+ * Portions Copyright (c) 1996-2016, PostgreSQL Global Development Group
+ *
+ * src/include/postmaster/waitsampler.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef _WAITSAMPLER_H
+#define _WAITSAMPLER_H
+
+#include "pgstat.h"
+#include "utils/timestamp.h"
+
+/*
+ * One sample of the state of one process.
+ */
+typedef struct WaitSample
+{
+	TimestampTz ts;				/* when the sample was taken */
+	int			pid;			/* process ID */
+	uint32		wait_event_info;	/* what the process waited for, or 0 */
+	uint32		queryid;		/* query ID of the running statement, or 0 */
+	BackendState state;			/* backend state, STATE_UNDEFINED if none */
+} WaitSample;
+
+/* GUC options */
+extern int	wait_sampling_history_size;
+extern int	wait_sampling_interval;
+
+extern void WaitSamplerRegister(void);
+extern void WaitSamplerMain(Datum main_arg) pg_attribute_noreturn();
+
+extern Size WaitSamplerShmemSize(void);
+extern void WaitSamplerShmemInit(void);
+
+extern WaitSample *WaitSamplerGetSamples(int *nsamples);
+
+#endif   /* _WAITSAMPLER_H */
@@ -115,6 +115,11 @@ typedef union LWLockMinimallyPadded
 extern PGDLLIMPORT LWLockPadded *MainLWLockArray;
 extern char *MainLWLockNames[];
 
+/* Shared contention counters shown in pg_stat_lwlocks; private to lwlock.c */
+typedef struct LWLockStatsData LWLockStatsData;
+
+extern PGDLLIMPORT LWLockStatsData *LWLockStats;
+
 /* struct for storing named tranche information */
 typedef struct NamedLWLockTranche
 {
@@ -145,14 +150,20 @@ extern PGDLLIMPORT int NamedLWLockTrancheRequests;
 #define LOG2_NUM_PREDICATELOCK_PARTITIONS  4
 #define NUM_PREDICATELOCK_PARTITIONS  (1 << LOG2_NUM_PREDICATELOCK_PARTITIONS)
 
+/* Number of partitions the shared table statistics hash is divided into */
+#define LOG2_NUM_PGSTAT_PARTITIONS  4
+#define NUM_PGSTAT_PARTITIONS  (1 << LOG2_NUM_PGSTAT_PARTITIONS)
+
 /* Offsets for various chunks of preallocated lwlocks. */
 #define BUFFER_MAPPING_LWLOCK_OFFSET	NUM_INDIVIDUAL_LWLOCKS
 #define LOCK_MANAGER_LWLOCK_OFFSET		\
 	(BUFFER_MAPPING_LWLOCK_OFFSET + NUM_BUFFER_PARTITIONS)
 #define PREDICATELOCK_MANAGER_LWLOCK_OFFSET \
 	(LOCK_MANAGER_LWLOCK_OFFSET + NUM_LOCK_PARTITIONS)
-#define NUM_FIXED_LWLOCKS \
+#define PGSTAT_TABLES_LWLOCK_OFFSET \
 	(PREDICATELOCK_MANAGER_LWLOCK_OFFSET + NUM_PREDICATELOCK_PARTITIONS)
+#define NUM_FIXED_LWLOCKS \
+	(PGSTAT_TABLES_LWLOCK_OFFSET + NUM_PGSTAT_PARTITIONS)
 
 typedef enum LWLockMode
 {
@@ -185,6 +196,8 @@ extern void InitLWLockAccess(void);
 
 extern const char *GetLWLockIdentifier(uint8 classId, uint16 eventId);
 
+extern void LWLockResetContentionStats(void);
+
 /*
  * Extensions (or core code) can obtain an LWLocks by calling
  * RequestNamedLWLockTranche() during postmaster startup.  Subsequently,
@@ -234,6 +247,7 @@ typedef enum BuiltinTrancheIds
 	LWTRANCHE_BUFFER_MAPPING,
 	LWTRANCHE_LOCK_MANAGER,
 	LWTRANCHE_PREDICATE_LOCK_MANAGER,
+	LWTRANCHE_PGSTAT_TABLES,
 	LWTRANCHE_FIRST_USER_DEFINED
 }	BuiltinTrancheIds;
 
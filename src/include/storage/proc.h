@@ -153,6 +153,8 @@ struct PGPROC
 	TransactionId	procArrayGroupMemberXid;
 
 	uint32          wait_event_info;        /* proc's wait information */
+	uint32		queryId;		/* query ID of the top-level statement being
+								 * executed, or 0 */
 
 	/* Per-backend LWLock.  Protects fields below (but not group fields). */
 	LWLock		backendLock;
@@ -147,6 +147,8 @@ extern int xactGetCommittedInvalidationMessages(SharedInvalidationMessage **msgs
 extern void ProcessCommittedInvalidationMessages(SharedInvalidationMessage *msgs,
 									 int nmsgs, bool RelcacheInitFileInval,
 									 Oid dbid, Oid tsid);
+extern bool PreInvalidatePreloadedRels(const SharedInvalidationMessage *msgs,
+						   int nmsgs, Oid dbid);
 
 extern void LocalExecuteInvalidationMessage(SharedInvalidationMessage *msg);
 
@@ -52,7 +52,9 @@ typedef struct catcache
 												 * heap scans */
 	bool		cc_isname[CATCACHE_MAXKEYS];	/* flag "name" key columns */
 	dlist_head	cc_lists;		/* list of CatCList structs */
-#ifdef CATCACHE_STATS
+	Size		cc_memusage;	/* approx. memory used by tuples and lists */
+
+	/* statistics, reported by pg_catalog_cache_stats() */
 	long		cc_searches;	/* total # searches against this cache */
 	long		cc_hits;		/* # of matches against existing entry */
 	long		cc_neg_hits;	/* # of matches against negative entry */
@@ -65,7 +67,7 @@ typedef struct catcache
 	long		cc_invals;		/* # of entries invalidated from cache */
 	long		cc_lsearches;	/* total # list-searches */
 	long		cc_lhits;		/* # of matches against existing lists */
-#endif
+	long		cc_evictions;	/* # of entries evicted by memory limit */
 	dlist_head *cc_bucket;		/* hash buckets */
 } CatCache;
 
@@ -108,6 +110,7 @@ typedef struct catctup
 	bool		dead;			/* dead but not yet removed? */
 	bool		negative;		/* negative cache entry? */
 	uint32		hash_value;		/* hash value for this tuple's keys */
+	uint64		lastaccess;		/* catcache clock at last search, for LRU */
 	HeapTupleData tuple;		/* tuple management header */
 } CatCTup;
 
@@ -145,6 +148,7 @@ typedef struct catclist
 	bool		ordered;		/* members listed in index order? */
 	short		nkeys;			/* number of lookup keys specified */
 	uint32		hash_value;		/* hash value for lookup keys */
+	uint64		lastaccess;		/* catcache clock at last search, for LRU */
 	HeapTupleData tuple;		/* header for tuple holding keys */
 	int			n_members;		/* number of member tuples */
 	CatCTup    *members[FLEXIBLE_ARRAY_MEMBER]; /* members */
@@ -155,9 +159,14 @@ typedef struct catcacheheader
 {
 	slist_head	ch_caches;		/* head of list of CatCache structs */
 	int			ch_ntup;		/* # of tuples in all caches */
+	Size		ch_memusage;	/* sum of cc_memusage over all caches */
 } CatCacheHeader;
 
 
+/* GUC parameter */
+extern int	catalog_cache_memory_limit;
+
+
 /* this extern duplicates utils/memutils.h... */
 extern PGDLLIMPORT MemoryContext CacheMemoryContext;
 
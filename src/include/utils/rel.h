@@ -62,6 +62,11 @@ typedef struct RelationData
 	bool		rd_isvalid;		/* relcache entry is valid */
 	char		rd_indexvalid;	/* state of rd_indexlist: 0 = not valid, 1 =
 								 * valid, 2 = temporarily forced */
+	bool		rd_preloaded;	/* rel is a non-catalog entry of the local
+								 * relcache init file */
+	int			rd_accesscnt;	/* number of times opened by this backend */
+	uint64		rd_lastaccess;	/* relcache clock at last open, for LRU */
+	Size		rd_memusage;	/* approx. memory used, see relcache.c */
 
 	/*
 	 * rd_createSubid is the ID of the highest subtransaction the rel has
@@ -147,6 +152,15 @@ typedef struct RelationData
 	void	   *rd_amcache;		/* available for use by index AM */
 	Oid		   *rd_indcollation;	/* OIDs of index collations */
 
+	/*
+	 * table access method support, for relations with heap-like storage
+	 * (tables, materialized views and TOAST tables); NULL for others.  This
+	 * points to a struct shared by all tables using the access method, so
+	 * it needs no freeing.
+	 */
+	/* use "struct" here to avoid needing to include tableam.h: */
+	const struct TableAmRoutine *rd_tableam;
+
 	/*
 	 * foreign-table support
 	 *
@@ -186,6 +200,7 @@ typedef struct AutoVacOpts
 {
 	bool		enabled;
 	int			vacuum_threshold;
+	int			vacuum_ins_threshold;
 	int			analyze_threshold;
 	int			vacuum_cost_delay;
 	int			vacuum_cost_limit;
@@ -197,6 +212,7 @@ typedef struct AutoVacOpts
 	int			multixact_freeze_table_age;
 	int			log_min_duration;
 	float8		vacuum_scale_factor;
+	float8		vacuum_ins_scale_factor;
 	float8		analyze_scale_factor;
 } AutoVacOpts;
 
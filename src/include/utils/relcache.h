@@ -63,6 +63,7 @@ extern void RelationSetIndexList(Relation relation,
 					 List *indexIds, Oid oidIndex);
 
 extern void RelationInitIndexAccessInfo(Relation relation);
+extern void RelationInitTableAccessMethod(Relation relation);
 
 /*
  * Routines to support ereport() reports of relation-related errors
@@ -119,9 +120,23 @@ extern void AtEOSubXact_RelationCache(bool isCommit, SubTransactionId mySubid,
  */
 extern bool RelationIdIsInInitFile(Oid relationId);
 extern void RelationCacheInitFilePreInvalidate(void);
+extern bool RelationCacheInitFilePreInvalidateRels(Oid dbId, const Oid *relids,
+									   int nrelids);
 extern void RelationCacheInitFilePostInvalidate(void);
+extern void RelationCacheInitFileForgetDatabase(Oid dbId);
 extern void RelationCacheInitFileRemove(void);
 
+extern Size RelationCacheInitFileShmemSize(void);
+extern void RelationCacheInitFileShmemInit(void);
+
+extern void RelationCacheGetStats(long *entries, Size *memusage,
+					  long *searches, long *hits,
+					  long *evictions, long *invals);
+
+/* GUC parameters */
+extern int	relcache_preload_threshold;
+extern int	relation_cache_memory_limit;
+
 /* should be used only by relcache.c and catcache.c */
 extern bool criticalRelcachesBuilt;
 
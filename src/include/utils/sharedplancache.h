@@ -0,0 +1,39 @@
+/*-------------------------------------------------------------------------
+ *
+ * sharedplancache.h
+ *	  Cross-backend cache of generic plans.
+ *
+ * See sharedplancache.c for comments.
+ *
+ * Portions Copyright (c) 1996-2016, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/utils/sharedplancache.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef SHAREDPLANCACHE_H
+#define SHAREDPLANCACHE_H
+
+#include "storage/sinval.h"
+#include "utils/plancache.h"
+
+/* GUC parameter */
+extern int	shared_plan_cache_size;
+
+extern Size SharedPlanCacheShmemSize(void);
+extern void SharedPlanCacheShmemInit(void);
+
+extern bool SharedPlanCacheUsable(CachedPlanSource *plansource);
+extern uint32 SharedPlanCacheGeneration(void);
+extern List *SharedPlanCacheFetchPlan(CachedPlanSource *plansource);
+extern bool SharedPlanCacheFetchCosts(CachedPlanSource *plansource,
+						  double *total_custom_cost,
+						  int *num_custom_plans);
+extern void SharedPlanCacheStore(CachedPlanSource *plansource,
+					 List *stmt_list, uint32 generation);
+
+extern void SharedPlanCacheInvalidateMessages(const SharedInvalidationMessage *msgs,
+								  int n);
+
+#endif   /* SHAREDPLANCACHE_H */
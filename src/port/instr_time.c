@@ -0,0 +1,200 @@
+/*-------------------------------------------------------------------------
+ *
+ * instr_time.c
+ *	  Set up the clock source used by INSTR_TIME_SET_CURRENT_FAST.
+ *
+ * On x86, reading the time-stamp counter with the RDTSC instruction costs a
+ * few nanoseconds, while gettimeofday() can cost a microsecond or more on
+ * systems where the kernel cannot serve it without entering the kernel,
+ * notably on many virtual machines.  That difference matters a lot for
+ * EXPLAIN ANALYZE, which reads the clock twice per row and plan node.
+ *
+ * The TSC is only usable as a clock if it ticks at a constant rate, whatever
+ * the power state of the CPU, and is synchronized across CPUs.  Modern CPUs
+ * advertise the former as "invariant TSC"; for the latter we rely on the
+ * operating system, which checks it at boot and stops using the TSC as its
+ * own clock source if it finds the counters out of sync.  The tick rate
+ * isn't reported reliably by the CPU, so it is measured against
+ * gettimeofday() over a short interval.
+ *
+ * Portions Copyright (c) 1996-2016, PostgreSQL Global Development Group
+ *
+ *
+ * IDENTIFICATION
+ *	  src/port/instr_time.c
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "c.h"
+
+#ifdef HAVE__GET_CPUID
+#include <cpuid.h>
+#endif
+
+#include "portability/instr_time.h"
+
+#ifdef HAVE_INSTR_TIME_TSC
+
+/* How long to measure the TSC against gettimeofday(), in microseconds */
+#define TSC_CALIBRATION_USEC	20000
+
+InstrTscClock pg_instr_tsc_clock = {false, 0, 0, 0.0};
+
+/*
+ * Does the CPU promise that the TSC ticks at a constant rate?
+ */
+static bool
+tsc_is_invariant(void)
+{
+#ifdef HAVE__GET_CPUID
+	unsigned int exx[4] = {0, 0, 0, 0};
+
+	if (__get_cpuid_max(0x80000000, NULL) < 0x80000007)
+		return false;
+	__get_cpuid(0x80000007, &exx[0], &exx[1], &exx[2], &exx[3]);
+
+	return (exx[3] & (1 << 8)) != 0;	/* invariant TSC */
+#else
+	return false;
+#endif
+}
+
+/*
+ * Does the operating system trust the TSC?
+ *
+ * On Linux, the kernel falls back to a different clock source if it finds
+ * the TSC unstable or unsynchronized, so accept the TSC only if the kernel
+ * is using it too.  Elsewhere, we have no way to tell, and assume it's OK.
+ */
+static bool
+tsc_trusted_by_os(void)
+{
+#ifdef __linux__
+	FILE	   *file;
+	char		buf[64];
+	bool		result = true;
+
+	file = fopen("/sys/devices/system/clocksource/clocksource0/current_clocksource", "r");
+	if (file == NULL)
+		return true;
+	if (fgets(buf, sizeof(buf), file) != NULL)
+		result = (strncmp(buf, "tsc", 3) == 0);
+	fclose(file);
+
+	return result;
+#else
+	return true;
+#endif
+}
+
+/*
+ * Read the TSC and the time of day at (nearly) the same moment.  The TSC is
+ * read on both sides of gettimeofday(), and the midpoint used.
+ */
+static void
+read_tsc_and_time(int64 *tsc, int64 *usec)
+{
+	struct timeval tv;
+	int64		before;
+	int64		after;
+
+	before = pg_rdtsc();
+	gettimeofday(&tv, NULL);
+	after = pg_rdtsc();
+
+	*tsc = before + (after - before) / 2;
+	*usec = (int64) tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+/*
+ * Measure the tick rate of the TSC, in ticks per microsecond.  Returns 0 if
+ * the result doesn't make sense.
+ */
+static double
+tsc_calibrate(int64 *base_tsc, int64 *base_usec)
+{
+	int64		start_tsc,
+				start_usec;
+	int64		end_tsc,
+				end_usec;
+	double		ticks_per_usec;
+
+	read_tsc_and_time(&start_tsc, &start_usec);
+	do
+	{
+		read_tsc_and_time(&end_tsc, &end_usec);
+
+		/* the system clock was set backwards; give up */
+		if (end_usec < start_usec)
+			return 0;
+	} while (end_usec - start_usec < TSC_CALIBRATION_USEC);
+
+	ticks_per_usec = (double) (end_tsc - start_tsc) / (end_usec - start_usec);
+
+	/* accept anything between 100 MHz and 100 GHz */
+	if (ticks_per_usec < 100 || ticks_per_usec > 100000)
+		return 0;
+
+	*base_tsc = end_tsc;
+	*base_usec = end_usec;
+	return ticks_per_usec;
+}
+#endif   /* HAVE_INSTR_TIME_TSC */
+
+/*
+ * Choose the clock source of INSTR_TIME_SET_CURRENT_FAST.
+ *
+ * With INSTR_CLOCK_AUTO, the TSC is used if the CPU reports it as invariant
+ * and the operating system doesn't distrust it.  INSTR_CLOCK_TSC skips the
+ * latter check.  In either case, if the TSC can't be used or its rate can't
+ * be measured, the system clock is used, as it is with INSTR_CLOCK_SYSTEM.
+ *
+ * This busy-waits for a few milliseconds to calibrate the TSC, so it should
+ * be called once at startup, before forking any children.  Returns true if
+ * the TSC will be used.
+ */
+bool
+pg_instr_clock_init(InstrClockSource source)
+{
+#ifdef HAVE_INSTR_TIME_TSC
+	int64		base_tsc;
+	int64		base_usec;
+	double		ticks_per_usec;
+
+	pg_instr_tsc_clock.use_tsc = false;
+
+	if (source == INSTR_CLOCK_SYSTEM)
+		return false;
+	if (!tsc_is_invariant())
+		return false;
+	if (source == INSTR_CLOCK_AUTO && !tsc_trusted_by_os())
+		return false;
+
+	ticks_per_usec = tsc_calibrate(&base_tsc, &base_usec);
+	if (ticks_per_usec == 0)
+		return false;
+
+	pg_instr_tsc_clock.base_tsc = base_tsc;
+	pg_instr_tsc_clock.base_usec = base_usec;
+	pg_instr_tsc_clock.usec_per_tick = 1.0 / ticks_per_usec;
+	pg_instr_tsc_clock.use_tsc = true;
+
+	return true;
+#else
+	return false;
+#endif
+}
+
+/*
+ * Return the measured TSC frequency in MHz, or 0 if the TSC isn't in use.
+ */
+double
+pg_instr_tsc_frequency(void)
+{
+#ifdef HAVE_INSTR_TIME_TSC
+	if (pg_instr_tsc_clock.use_tsc)
+		return 1.0 / pg_instr_tsc_clock.usec_per_tick;
+#endif
+	return 0;
+}
@@ -0,0 +1,52 @@
+--
+-- An autovacuum worker processes the tables that need it most first.
+--
+CREATE FUNCTION wait_for_autovacuum() RETURNS bool
+LANGUAGE plpgsql AS $$
+BEGIN
+  FOR i IN 1..600 LOOP
+    IF (SELECT count(*) FROM pg_stat_user_tables
+        WHERE relname IN ('av_low', 'av_high')
+          AND last_autovacuum IS NOT NULL) = 2 THEN
+      RETURN true;
+    END IF;
+    PERFORM pg_sleep(0.1);
+    PERFORM pg_stat_clear_snapshot();
+  END LOOP;
+  RETURN false;
+END
+$$;
+
+-- av_low is created first, so it comes first in pg_class
+CREATE TABLE av_low (a int) WITH (autovacuum_enabled = off,
+  autovacuum_vacuum_threshold = 100, autovacuum_vacuum_scale_factor = 0,
+  autovacuum_vacuum_insert_threshold = -1,
+  autovacuum_analyze_threshold = 1000000);
+CREATE TABLE av_high (a int) WITH (autovacuum_enabled = off,
+  autovacuum_vacuum_threshold = 100, autovacuum_vacuum_scale_factor = 0,
+  autovacuum_vacuum_insert_threshold = -1,
+  autovacuum_analyze_threshold = 1000000);
+INSERT INTO av_low SELECT generate_series(1, 1000);
+INSERT INTO av_high SELECT generate_series(1, 1000);
+
+-- just past the threshold, and nine times over it
+DELETE FROM av_low WHERE a <= 110;
+DELETE FROM av_high WHERE a <= 900;
+
+-- Counts are flushed to shared memory at most every 500 ms, when idle.
+SELECT pg_sleep(0.6);
+
+-- make both tables visible to the same worker
+BEGIN;
+ALTER TABLE av_low SET (autovacuum_enabled = on);
+ALTER TABLE av_high SET (autovacuum_enabled = on);
+COMMIT;
+
+SELECT wait_for_autovacuum();
+SELECT h.last_autovacuum < l.last_autovacuum AS high_first
+  FROM pg_stat_user_tables h, pg_stat_user_tables l
+  WHERE h.relname = 'av_high' AND l.relname = 'av_low';
+
+DROP TABLE av_low;
+DROP TABLE av_high;
+DROP FUNCTION wait_for_autovacuum();
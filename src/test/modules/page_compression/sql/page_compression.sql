@@ -0,0 +1,26 @@
+--
+-- Page compression, which requires wal_log_hints (see page_compression.conf)
+--
+ALTER TABLESPACE pg_default SET (page_compression = true);
+
+CREATE TABLE compressed (a int, b text);
+INSERT INTO compressed
+    SELECT i, repeat('x', 100) FROM generate_series(1, 5000) i;
+CREATE INDEX compressed_idx ON compressed (a);
+ALTER TABLESPACE pg_default RESET (page_compression);
+CREATE TABLE uncompressed AS SELECT * FROM compressed;
+CHECKPOINT;
+SELECT pg_relation_size('compressed') <
+       pg_relation_size('uncompressed') / 2 AS compressed;
+
+SET enable_seqscan = off;
+SELECT a, length(b) FROM compressed WHERE a IN (1, 2500, 5000) ORDER BY a;
+RESET enable_seqscan;
+
+-- rewrite pages with worse compression, then truncate
+UPDATE compressed SET b = md5(a::text) WHERE a % 10 = 0;
+DELETE FROM compressed WHERE a > 2500;
+VACUUM compressed;
+SELECT count(*), sum(a), count(*) FILTER (WHERE length(b) = 32) FROM compressed;
+
+DROP TABLE compressed, uncompressed;
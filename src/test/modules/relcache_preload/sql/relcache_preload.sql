@@ -0,0 +1,47 @@
+--
+-- Relations a session opened at least relcache_preload_threshold times are
+-- saved in the relcache init file when it exits.
+--
+CREATE FUNCTION init_file_size() RETURNS bigint LANGUAGE sql AS $$
+  SELECT size FROM pg_stat_file('base/' ||
+    (SELECT oid FROM pg_database WHERE datname = current_database()) ||
+    '/pg_internal.init', true)
+$$;
+
+-- the session that exits does so asynchronously, so wait for the file
+CREATE FUNCTION wait_for_init_file(oldsize bigint) RETURNS bool
+LANGUAGE plpgsql AS $$
+BEGIN
+  FOR i IN 1..300 LOOP
+    IF init_file_size() > oldsize THEN
+      RETURN true;
+    END IF;
+    PERFORM pg_sleep(0.1);
+  END LOOP;
+  RETURN false;
+END
+$$;
+
+SELECT init_file_size() AS init_size \gset
+
+CREATE TABLE preload_t (a int);
+CREATE INDEX preload_t_a ON preload_t (a);
+INSERT INTO preload_t VALUES (1), (2), (3);
+DO $$
+BEGIN
+  FOR i IN 1..20 LOOP
+    PERFORM count(*) FROM preload_t WHERE a > 0;
+  END LOOP;
+END
+$$;
+
+\c
+SELECT wait_for_init_file(:init_size);
+
+-- Changing a preloaded table removes the file at commit, so that new
+-- sessions don't use the stale entry.
+ALTER TABLE preload_t ADD COLUMN b text DEFAULT 'x';
+SELECT init_file_size() IS NULL AS removed;
+
+\c
+SELECT * FROM preload_t ORDER BY a;
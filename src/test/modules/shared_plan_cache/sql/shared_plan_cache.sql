@@ -0,0 +1,53 @@
+--
+-- Generic plans are shared between sessions, and must be invalidated for all
+-- of them when the objects they depend on change.
+--
+CREATE TABLE spc_t (a int, b int);
+INSERT INTO spc_t VALUES (1, 10), (2, 20);
+CREATE FUNCTION spc_f() RETURNS int LANGUAGE sql IMMUTABLE AS 'SELECT 1';
+
+-- the sixth execution builds the generic plans and stores them
+PREPARE p1(int) AS SELECT spc_f() + $1;
+PREPARE p2(int) AS SELECT * FROM spc_t WHERE a = $1;
+EXECUTE p1(0);
+EXECUTE p1(0);
+EXECUTE p1(0);
+EXECUTE p1(0);
+EXECUTE p1(0);
+EXECUTE p1(0);
+EXECUTE p2(1);
+EXECUTE p2(1);
+EXECUTE p2(1);
+EXECUTE p2(1);
+EXECUTE p2(1);
+EXECUTE p2(1);
+
+-- changes made by an uncommitted transaction must not leak into the cache
+\c
+BEGIN;
+CREATE OR REPLACE FUNCTION spc_f() RETURNS int LANGUAGE sql IMMUTABLE
+  AS 'SELECT 3';
+PREPARE p1(int) AS SELECT spc_f() + $1;
+EXECUTE p1(0);
+ROLLBACK;
+
+-- a new session picks up the stored plans
+\c
+PREPARE p1(int) AS SELECT spc_f() + $1;
+PREPARE p2(int) AS SELECT * FROM spc_t WHERE a = $1;
+EXECUTE p1(0);
+EXECUTE p2(1);
+
+-- committed DDL removes the entries depending on the changed objects
+CREATE OR REPLACE FUNCTION spc_f() RETURNS int LANGUAGE sql IMMUTABLE
+  AS 'SELECT 2';
+ALTER TABLE spc_t ADD COLUMN c int DEFAULT 0;
+
+\c
+PREPARE p1(int) AS SELECT spc_f() + $1;
+PREPARE p2(int) AS SELECT * FROM spc_t WHERE a = $1;
+EXECUTE p1(0);
+EXECUTE p2(1);
+
+DROP TABLE spc_t;
+DROP FUNCTION spc_f();
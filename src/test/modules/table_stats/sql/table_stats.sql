@@ -0,0 +1,32 @@
+--
+-- The shared table statistics hash holds only track_counts_max_relations
+-- entries.  When it is full, entries autovacuum doesn't need are evicted to
+-- make room for new ones.
+--
+
+-- Counts are flushed to shared memory at most every 500 ms, when idle.
+CREATE TABLE keep_me (a int);
+INSERT INTO keep_me SELECT generate_series(1, 10);
+SELECT pg_sleep(0.6);
+
+-- fill the hash with entries of tables that were only read
+DO $$
+BEGIN
+  FOR i IN 1..400 LOOP
+    EXECUTE format('CREATE TABLE filler_%s (a int)', i);
+    EXECUTE format('SELECT * FROM filler_%s', i);
+  END LOOP;
+END
+$$;
+SELECT pg_sleep(0.6);
+
+CREATE TABLE new_table (a int);
+INSERT INTO new_table SELECT generate_series(1, 5);
+SELECT pg_sleep(0.6);
+
+-- tables with changes for autovacuum keep their entries, new ones get one
+SELECT relname, n_tup_ins, n_mod_since_analyze FROM pg_stat_user_tables
+  WHERE relname IN ('keep_me', 'new_table') ORDER BY relname;
+-- and some of the tables that were only read lost theirs
+SELECT count(*) FILTER (WHERE seq_scan > 0) < 400 AS evicted
+  FROM pg_stat_user_tables WHERE relname LIKE 'filler\_%';
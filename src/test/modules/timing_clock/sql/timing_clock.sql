@@ -0,0 +1,12 @@
+SHOW timing_clock_source;
+
+-- the time EXPLAIN ANALYZE reports for a node must agree with the wall
+-- clock, whichever clock it is measured with
+CREATE FUNCTION sleep_node_time() RETURNS float8 LANGUAGE plpgsql AS $$
+DECLARE
+  plan json;
+BEGIN
+  EXECUTE 'EXPLAIN (ANALYZE, FORMAT JSON) SELECT pg_sleep(0.2)' INTO plan;
+  RETURN (plan->0->'Plan'->>'Actual Total Time')::float8;
+END $$;
+SELECT t >= 200 AND t < 10000 AS plausible FROM sleep_node_time() t;
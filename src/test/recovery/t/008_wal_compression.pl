@@ -0,0 +1,59 @@
+# Test that compressed WAL records are replayed correctly
+use strict;
+use warnings;
+use PostgresNode;
+use TestLib;
+use Test::More tests => 2;
+
+# Initialize master node, compressing full-page images and all other record
+# data too
+my $node_master = get_new_node('master');
+$node_master->init(allows_streaming => 1);
+$node_master->append_conf(
+	'postgresql.conf', qq(
+wal_compression = pglz
+wal_compression_data_threshold = 0
+));
+$node_master->start;
+my $backup_name = 'my_backup';
+
+# Take backup
+$node_master->backup($backup_name);
+
+# Create streaming standby linking to master
+my $node_standby = get_new_node('standby');
+$node_standby->init_from_backup($node_master, $backup_name,
+	has_streaming => 1);
+$node_standby->start;
+
+# Multi-insert, B-tree split and full-page image records, compressed
+my $copy_file = $node_master->basedir . '/tab_comp.data';
+$node_master->safe_psql('postgres',
+	"CREATE TABLE tab_comp (a int, b text)");
+$node_master->safe_psql('postgres',
+	"COPY (SELECT i, 'row ' || i FROM generate_series(1, 10000) i) TO '$copy_file'");
+$node_master->safe_psql('postgres', "COPY tab_comp FROM '$copy_file'");
+$node_master->safe_psql('postgres',
+	"CREATE INDEX tab_comp_b ON tab_comp (b)");
+$node_master->safe_psql('postgres',
+	"CHECKPOINT; UPDATE tab_comp SET b = repeat(a::text, 20)");
+$node_master->safe_psql('postgres',
+	"SET wal_compression = off; INSERT INTO tab_comp SELECT a, b FROM tab_comp WHERE a <= 100");
+
+# Wait for standby to catch up
+my $applname = $node_standby->name;
+my $caughtup_query =
+"SELECT pg_current_xlog_location() <= replay_location FROM pg_stat_replication WHERE application_name = '$applname';";
+$node_master->poll_query_until('postgres', $caughtup_query)
+  or die "Timed out while waiting for standby to catch up";
+
+my $query =
+  "SELECT count(*), sum(a), sum(length(b)) FROM tab_comp WHERE b > '5'";
+my $expected = $node_master->safe_psql('postgres', $query);
+my $result = $node_standby->safe_psql('postgres', $query);
+print "standby: $result\n";
+is($result, $expected, 'check compressed content on standby');
+
+$result = $node_standby->safe_psql('postgres',
+	"SET enable_seqscan = off; SELECT count(*) FROM tab_comp WHERE b = repeat('42', 20)");
+is($result, qq(2), 'check index built from compressed records on standby');
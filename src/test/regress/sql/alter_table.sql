@@ -1267,6 +1267,16 @@ select reltoastrelid <> 0 as has_toast_table
 from pg_class
 where oid = 'test_storage'::regclass;
 
+-- compression methods of TOAST-able columns
+create table test_compression (a text, b text);
+alter table test_compression alter a set (compression = zstd); -- fails
+alter table test_compression alter a set (compression = pglz);
+insert into test_compression values (repeat('12345', 1000), repeat('12345', 1000));
+select pg_column_compression(a) as a, pg_column_compression(b) as b,
+       pg_column_compression(length(a)) as c
+from test_compression;
+drop table test_compression;
+
 -- ALTER COLUMN TYPE with a check constraint and a child table (bug #13779)
 CREATE TABLE test_inh_check (a float check (a > 10.2), b float);
 CREATE TABLE test_inh_check_child() INHERITS(test_inh_check);
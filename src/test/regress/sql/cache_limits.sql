@@ -0,0 +1,42 @@
+--
+-- memory limits of the catalog and relation caches
+--
+DO $$
+BEGIN
+  FOR i IN 1..50 LOOP
+    EXECUTE format('CREATE TABLE cache_limits_%s (a int, b text)', i);
+  END LOOP;
+END $$;
+
+-- limits well below what the lookups below load
+SET catalog_cache_memory_limit = '64kB';
+SET relation_cache_memory_limit = '8kB';
+
+-- open every table in turn
+SELECT count(*) FROM pg_class
+WHERE relname LIKE 'cache\_limits\_%' AND pg_relation_size(oid) = 0;
+
+-- printing function signatures takes many catalog cache lookups
+SELECT count(*) > 2000 AS many FROM pg_proc
+WHERE pronamespace = 'pg_catalog'::regnamespace
+  AND oid::regprocedure::text LIKE '%(%)';
+
+SELECT cache_type, sum(evictions) > 0 AS evicted
+FROM pg_catalog_cache_stats() GROUP BY cache_type ORDER BY cache_type;
+
+-- evicted entries are rebuilt when needed again
+SELECT count(*) FROM pg_class
+WHERE relname LIKE 'cache\_limits\_%' AND pg_relation_size(oid) = 0;
+INSERT INTO cache_limits_1 VALUES (1, 'one');
+SELECT * FROM cache_limits_1;
+SELECT 'cache_limits_1'::regclass, 'int4pl'::regproc;
+
+RESET catalog_cache_memory_limit;
+RESET relation_cache_memory_limit;
+
+DO $$
+BEGIN
+  FOR i IN 1..50 LOOP
+    EXECUTE format('DROP TABLE cache_limits_%s', i);
+  END LOOP;
+END $$;
@@ -0,0 +1,37 @@
+--
+-- TOAST compression methods
+--
+-- The output differs on servers built without LZ4 support; see
+-- compression_1.out.
+--
+CREATE TABLE cmdata (f1 text);
+ALTER TABLE cmdata ALTER f1 SET (compression = lz4);
+INSERT INTO cmdata VALUES (repeat('1234567890', 1000));
+SELECT pg_column_compression(f1) FROM cmdata;
+SELECT length(f1), substr(f1, 9995, 6) FROM cmdata;
+
+-- changing the method leaves the values already stored alone
+ALTER TABLE cmdata ALTER f1 SET (compression = pglz);
+INSERT INTO cmdata VALUES (repeat('abcdefghij', 1000));
+SELECT pg_column_compression(f1), substr(f1, 1, 5) FROM cmdata ORDER BY 2;
+
+-- compressed values keep their method when copied to another table
+CREATE TABLE cmmove (f1 text);
+INSERT INTO cmmove SELECT f1 FROM cmdata;
+SELECT pg_column_compression(f1), substr(f1, 1, 5) FROM cmmove ORDER BY 2;
+
+-- values too large to stay inline after compression, and slices of them
+CREATE TABLE cmlarge (f1 text);
+ALTER TABLE cmlarge ALTER f1 SET (compression = lz4);
+INSERT INTO cmlarge VALUES (repeat('1234567890', 100000));
+SELECT pg_column_compression(f1), length(f1), substr(f1, 500001, 10)
+FROM cmlarge;
+
+-- columns without a compression option follow default_toast_compression
+SET default_toast_compression = 'lz4';
+CREATE TABLE cmdefault (f1 text);
+INSERT INTO cmdefault VALUES (repeat('1234567890', 1000));
+SELECT pg_column_compression(f1) FROM cmdefault;
+RESET default_toast_compression;
+
+DROP TABLE cmdata, cmmove, cmlarge, cmdefault;
@@ -327,6 +327,83 @@ copy check_con_tbl from stdin;
 \.
 select * from check_con_tbl;
 
+-- test parallel COPY FROM; the result is the same with or without workers
+create table parallel_copy_tbl (a int primary key, b text default 'x',
+  c int check (c > 0));
+copy parallel_copy_tbl (a, c) from stdin (parallel 2);
+1	1
+2	2
+3	3
+\.
+copy parallel_copy_tbl from stdin (format csv, header, parallel 2);
+a,b,c
+4,"two
+lines",4
+5,,5
+\.
+select a, replace(b, E'\n', '|') as b, c from parallel_copy_tbl order by a;
+-- should fail
+copy parallel_copy_tbl to stdout (parallel 2);
+copy parallel_copy_tbl from stdin (format binary, parallel 2);
+copy parallel_copy_tbl from stdin (parallel -1);
+drop table parallel_copy_tbl;
+
+-- unique violations found while inserting a batch of rows into the indexes
+-- must report the line of the offending row, not the last one read
+create temp table copy_batch_unique (a int primary key, b int unique);
+copy copy_batch_unique from stdin;
+1	30
+2	20
+3	30
+4	10
+5	40
+\.
+select count(*) from copy_batch_unique;
+drop table copy_batch_unique;
+
+-- binary COPY round trip, covering the types whose values binary COPY TO
+-- writes itself as well as those it leaves to their send functions
+create temp table copy_binary_tbl (b bool, i2 int2, i4 int4, i8 int8, o oid,
+  d date, f4 float4, f8 float8, ts timestamp, tstz timestamptz, by bytea,
+  t text, vc varchar(10), c char(5), n numeric);
+insert into copy_binary_tbl values
+  (true, -2, 400000, 9000000000, 4000000000, '2016-02-29', 1.5, -2.25e100,
+   '2016-02-29 12:34:56.789', '2016-02-29 12:34:56.789+02', '\x00ff10',
+   'text', 'varchar', 'bp', 12.345),
+  (null, null, null, null, null, null, null, null, null, null, null, null,
+   null, null, null),
+  (false, 0, 0, 0, 0, 'infinity', '-Infinity', 'NaN', '-infinity',
+   'infinity', '', '', '', '', 'NaN');
+-- text that is converted to and from the client encoding, where possible
+insert into copy_binary_tbl (t, vc, c)
+  select chr(233) || 't' || chr(233), 'caf' || chr(233), chr(252)
+  where getdatabaseencoding() = 'UTF8';
+create temp table copy_binary_tbl2 (like copy_binary_tbl);
+create function copy_binary_round_trip() returns void language plpgsql as $$
+declare
+  fname text := current_setting('data_directory') || '/copy_binary_tbl.data';
+begin
+  truncate copy_binary_tbl2;
+  execute format('copy copy_binary_tbl to %L (format binary)', fname);
+  execute format('copy copy_binary_tbl2 from %L (format binary)', fname);
+end $$;
+select copy_binary_round_trip();
+select
+  (select count(*) from (select * from copy_binary_tbl
+                         except all select * from copy_binary_tbl2) s) as missing,
+  (select count(*) from (select * from copy_binary_tbl2
+                         except all select * from copy_binary_tbl) s) as extra;
+set client_encoding to latin1;
+select copy_binary_round_trip();
+reset client_encoding;
+select
+  (select count(*) from (select * from copy_binary_tbl
+                         except all select * from copy_binary_tbl2) s) as missing,
+  (select count(*) from (select * from copy_binary_tbl2
+                         except all select * from copy_binary_tbl) s) as extra;
+drop function copy_binary_round_trip();
+drop table copy_binary_tbl, copy_binary_tbl2;
+
 DROP TABLE forcetest;
 DROP TABLE vistest;
 DROP FUNCTION truncate_in_subxact();
@@ -68,3 +68,29 @@ DROP ACCESS METHOD gist2;
 
 -- Drop access method cascade
 DROP ACCESS METHOD gist2 CASCADE;
+
+-- Make heap2 over heap_tableam_handler.  It stores tables exactly like heap.
+CREATE ACCESS METHOD heap2 TYPE TABLE HANDLER heap_tableam_handler;
+
+-- Index access methods can't store tables, nor table access methods indexes
+CREATE TABLE tableam_tbl (a int, b text) USING btree;
+CREATE INDEX ON fast_emp4000 USING heap2 (home_base);
+
+CREATE TABLE tableam_tbl (a int, b text) USING heap2;
+CREATE TABLE tableam_heap (a int) USING heap;
+SELECT c.relname, a.amname
+FROM pg_class c LEFT JOIN pg_am a ON a.oid = c.relam
+WHERE c.relname IN ('tableam_tbl', 'tableam_heap')
+ORDER BY c.relname;
+
+INSERT INTO tableam_tbl SELECT i, 'row ' || i FROM generate_series(1, 5) i;
+UPDATE tableam_tbl SET b = 'updated' WHERE a = 2;
+DELETE FROM tableam_tbl WHERE a = 3 RETURNING *;
+CREATE INDEX tableam_tbl_a_idx ON tableam_tbl (a);
+SELECT * FROM tableam_tbl ORDER BY a;
+
+-- Try to drop access method: fail because of dependent objects
+DROP ACCESS METHOD heap2;
+
+DROP TABLE tableam_tbl, tableam_heap;
+DROP ACCESS METHOD heap2;
@@ -867,3 +867,17 @@ select jsonb_insert('{"a": {"b": "value"}}', '{a, c}', '"new_value"', true);
 
 select jsonb_insert('{"a": {"b": "value"}}', '{a, b}', '"new_value"');
 select jsonb_insert('{"a": {"b": "value"}}', '{a, b}', '"new_value"', true);
+
+-- key lookups in toasted documents detoast only as much as they need
+CREATE TABLE test_jsonb_toast (j jsonb);
+INSERT INTO test_jsonb_toast
+  SELECT jsonb_object_agg('key' || i, i) FROM generate_series(1, 5000) i;
+INSERT INTO test_jsonb_toast
+  SELECT jsonb_agg('e' || i) FROM generate_series(1, 5000) i;
+ALTER TABLE test_jsonb_toast ALTER COLUMN j SET STORAGE external;
+INSERT INTO test_jsonb_toast
+  SELECT jsonb_object_agg('key' || i, i) FROM generate_series(1, 5000) i;
+SELECT j -> 'key1' AS a, j ->> 'key4999' AS b, j ? 'key2500' AS c,
+       j ? 'nokey' AS d, j ? 'e4000' AS e
+  FROM test_jsonb_toast;
+DROP TABLE test_jsonb_toast;
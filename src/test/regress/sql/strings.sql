@@ -366,6 +366,12 @@ SELECT substr(f1, 99995) from toasttest;
 -- string length
 SELECT substr(f1, 99995, 10) from toasttest;
 
+-- Slices and prefixes of compressed values are only decompressed as far as
+-- needed
+SELECT substr(f1, 5001, 10), left(f1, 12) from toasttest;
+SELECT f1 LIKE '1234567890123%' AS a, f1 LIKE '1234567891%' AS b,
+       f1 NOT LIKE '12345%' AS c from toasttest;
+
 DROP TABLE toasttest;
 
 --
@@ -399,6 +405,9 @@ SELECT substr(f1, 99995) from toasttest;
 -- string length
 SELECT substr(f1, 99995, 10) from toasttest;
 
+SELECT f1 LIKE '123456%' AS a, f1 LIKE '2%' AS b,
+       f1 NOT LIKE '1%' AS c from toasttest;
+
 DROP TABLE toasttest;
 
 -- test internally compressing datums
@@ -343,12 +343,18 @@ WHERE relkind NOT IN ('r', 'i', 's', 'S', 'c', 't', 'v', 'f') OR
     relpersistence NOT IN ('p', 'u', 't') OR
     relreplident NOT IN ('d', 'n', 'f', 'i');
 
--- Indexes should have an access method, others not.
+-- Indexes should have an access method, and tables may have one if they
+-- are not stored in the heap; other relations should not.
 
 SELECT p1.oid, p1.relname
 FROM pg_class as p1
 WHERE (p1.relkind = 'i' AND p1.relam = 0) OR
-    (p1.relkind != 'i' AND p1.relam != 0);
+    (p1.relkind NOT IN ('i', 'r') AND p1.relam != 0);
+
+SELECT p1.oid, p1.relname
+FROM pg_class as p1, pg_am as p2
+WHERE p1.relam = p2.oid AND
+    p2.amtype != (CASE p1.relkind WHEN 'i' THEN 'i' ELSE 't' END)::"char";
 
 -- **************** pg_attribute ****************
 
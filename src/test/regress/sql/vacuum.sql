@@ -62,3 +62,43 @@ VACUUM FULL vactst;
 
 DROP TABLE vaccluster;
 DROP TABLE vactst;
+
+-- parallel index vacuuming, with a cost-based delay shared by the workers
+CREATE TABLE vacparallel (a int, b int[]);
+CREATE INDEX vacparallel_a ON vacparallel (a);
+CREATE INDEX vacparallel_b ON vacparallel USING gin (b);
+CREATE INDEX vacparallel_a_brin ON vacparallel USING brin (a);
+INSERT INTO vacparallel SELECT i, ARRAY[i % 10] FROM generate_series(1, 10000) i;
+DELETE FROM vacparallel WHERE a % 3 = 0;
+SET min_parallel_vacuum_index_size = 0;
+SET max_parallel_vacuum_workers = 2;
+SET vacuum_cost_delay = 1;
+SET vacuum_cost_limit = 10000;
+VACUUM vacparallel;
+RESET vacuum_cost_limit;
+RESET vacuum_cost_delay;
+RESET max_parallel_vacuum_workers;
+RESET min_parallel_vacuum_index_size;
+SET enable_seqscan = off;
+SELECT count(*) FROM vacparallel WHERE a < 1000;
+SELECT count(*) FROM vacparallel WHERE b @> ARRAY[1];
+RESET enable_seqscan;
+DROP TABLE vacparallel;
+
+-- pages with one, a few and most of their tuples dead, whose index entries
+-- must all be found by VACUUM; stale entries would lead the index scan to
+-- the rows that reuse the freed line pointers
+CREATE TABLE vacdead (a int, b text) WITH (autovacuum_enabled = off);
+INSERT INTO vacdead SELECT g, repeat('x', 10) FROM generate_series(1, 100000) g;
+CREATE INDEX vacdead_a ON vacdead (a);
+DELETE FROM vacdead
+WHERE a % 200 = 0 OR (a > 20000 AND a % 7 = 0) OR (a > 50000 AND a % 10 <> 1);
+SET maintenance_work_mem = '1MB';
+VACUUM vacdead;
+RESET maintenance_work_mem;
+INSERT INTO vacdead SELECT -g, repeat('y', 10) FROM generate_series(1, 50000) g;
+SET enable_seqscan = off;
+SELECT count(*) FROM vacdead WHERE a > 0;
+RESET enable_seqscan;
+SELECT count(*) FROM vacdead WHERE a > 0;
+DROP TABLE vacdead;
@@ -25,6 +25,7 @@ our $config = {
 	uuid      => undef,    # --with-ossp-uuid
 	xml       => undef,    # --with-libxml=<path>
 	xslt      => undef,    # --with-libxslt=<path>
+	lz4       => undef,    # --with-lz4=<path>
 	iconv     => undef,    # (not in configure, path to iconv)
 	zlib      => undef     # --with-zlib=<path>
 };